@@ -0,0 +1,110 @@
+#ifndef READERD_BLOCKSIZETUNER_H
+#define READERD_BLOCKSIZETUNER_H
+
+#include "readerd/RfChip.h"
+#include "readerd/SecurityObject.h"
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// READ BINARY block sizes the tuner moves between. Above kMaxShortReadBlock each leaves room
+/// for the secure messaging wrapping under a power of two.
+inline constexpr int kReadBlockSizes[] = {112, 224, 480, 992, 2016, 4064};
+inline constexpr size_t kReadBlockSizeCount = sizeof(kReadBlockSizes) / sizeof(kReadBlockSizes[0]);
+
+/// Profiles a tuner holds at most; the one used longest ago makes room for a new one.
+inline constexpr size_t kMaxBlockProfiles = 512;
+
+/// Failed reads in a row at an unmeasured size that make it the ceiling of a profile. A single
+/// failure may just be a chip taken off the reader.
+inline constexpr int kBlockCeilingFailures = 3;
+
+/// Seconds a ceiling lasts before the sizes above it are tried again.
+inline constexpr int64_t kBlockCeilingSeconds = 7 * 24 * 3600;
+
+/// What the tuner has learnt about one kind of chip.
+struct BlockProfile
+{
+    /// Bytes read per millisecond of APDU time at each of kReadBlockSizes; 0 where not
+    /// measured yet.
+    std::array<double, kReadBlockSizeCount> puRates{};
+
+    /// Index of the smallest size the chip failed to answer; kReadBlockSizeCount for none.
+    size_t puCeiling = kReadBlockSizeCount;
+
+    /// When puCeiling was set, in seconds since the epoch.
+    int64_t puCeilingTime = 0;
+
+    /// Failed reads in a row at each size not measured yet.
+    std::array<int, kReadBlockSizeCount> puFailures{};
+
+    /// Index of the size the next read uses.
+    size_t puCurrent = 0;
+
+    /// When the profile was last begun, in sessions of the tuner; not saved.
+    uint64_t puLastUsed = 0;
+};
+
+/// The profile key of chips with the security object \a aSecurityObject, or of chips whose
+/// EF.SOD could not be read when it is null.
+///
+/// The chip identifier is a random UID per session on most passports, so it cannot key what is
+/// learnt. Chips with the same digest algorithm and the same country signing CA (the issuer of
+/// the document signer) come from the same issuing programme and mostly the same chip and
+/// operating system, so they share a profile. Chips without EF.SOD share one profile.
+std::string blockProfileKey(const SecurityObject *aSecurityObject);
+
+/// Picks the READ BINARY block size per chip from the transfer rates it measures.
+///
+/// The right size depends on the chip: a fast chip with extended length support reads DG2 in
+/// a few large APDUs, while some chips take longer per APDU for extended length, and older
+/// ones refuse it. The INI file holds a single puReadBinaryBufferSize for all of them.
+///
+/// After every file the tuner takes the APDU time and the bytes read from the chip's
+/// counters (MMMReader_RFGetChipApduTime and MMMReader_RFGetChipBytesRead), and moves to the
+/// next unmeasured size beside the fastest one measured, trying larger ones first. Once both
+/// neighbours of the fastest are measured, it stays there. When the chip fails to answer a
+/// size, the file is read again at the fastest size below it. kBlockCeilingFailures failures in
+/// a row cap the sizes tried, for kBlockCeilingSeconds. Profiles
+/// are kept per blockProfileKey(), so a chip like one read before starts at the size found
+/// for those, and can be saved between runs. At most kMaxBlockProfiles are kept.
+///
+/// Used from the thread that reads the chip only.
+class BlockSizeTuner
+{
+public:
+    /// Starts a session with the open \a aChip: looks up the profile \a aKey, or starts one at
+    /// the chip's current block size, and sets the block size to use. A ceiling older than
+    /// kBlockCeilingSeconds is lifted.
+    MMMReaderErrorCode begin(RfChip &aChip, const std::string &aKey);
+
+    /// Reads \a aItem from \a aChip, as RfChip::getFile(), and learns from the transfer.
+    MMMReaderErrorCode getFile(RfChip &aChip, MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes);
+
+    /// Block size of the current session.
+    int blockSize() const;
+
+    /// Loads profiles saved by save(), replacing those with the same identifier. A missing
+    /// file is not an error.
+    MMMReaderErrorCode load(const std::string &aPath, std::string *aError);
+
+    /// Saves every profile to \a aPath, replacing the file as a whole. They are written in
+    /// the order they were last used, so that load() keeps the newest when it has to drop some.
+    MMMReaderErrorCode save(const std::string &aPath, std::string *aError) const;
+
+private:
+    void learn(int aApduMs, int aBytes);
+    void evictOldest();
+
+    std::map<std::string, BlockProfile> prProfiles;
+    BlockProfile *prProfile = nullptr;
+    uint64_t prSessions = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_BLOCKSIZETUNER_H
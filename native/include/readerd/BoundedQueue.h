@@ -0,0 +1,137 @@
+#ifndef READERD_BOUNDEDQUEUE_H
+#define READERD_BOUNDEDQUEUE_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace readerd {
+
+/// Fixed-capacity FIFO between the threads that produce work (SDK callback threads, replay
+/// workers) and a pool of workers that consume it.
+///
+/// Producers on a callback thread use tryPush(), which never waits: a full queue is the
+/// signal to shed or defer work, never to stall the reader. Producers that own their thread
+/// can wait with push() or waitForSpace(). Every item popped must be followed by taskDone()
+/// once it has been handled, so that join() can wait for the queue to be fully processed.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t aCapacity)
+        : prCapacity(aCapacity ? aCapacity : 1)
+    {
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    /// Queues \a aItem unless the queue is full or closed.
+    bool tryPush(T &&aItem)
+    {
+        {
+            std::lock_guard<std::mutex> lLock(prMutex);
+            if (prClosed || prItems.size() >= prCapacity)
+                return false;
+            prItems.push_back(std::move(aItem));
+            ++prUnfinished;
+        }
+        prNotEmpty.notify_one();
+        return true;
+    }
+
+    /// Queues \a aItem, waiting up to \a aTimeout for space. Returns \c false on timeout or
+    /// if the queue is closed.
+    bool push(T &&aItem, std::chrono::milliseconds aTimeout)
+    {
+        {
+            std::unique_lock<std::mutex> lLock(prMutex);
+            if (!prNotFull.wait_for(lLock, aTimeout, [this] { return prClosed || prItems.size() < prCapacity; })
+                || prClosed)
+                return false;
+            prItems.push_back(std::move(aItem));
+            ++prUnfinished;
+        }
+        prNotEmpty.notify_one();
+        return true;
+    }
+
+    /// Waits up to \a aTimeout until \a aSlots items (at most the capacity) could be queued.
+    bool waitForSpace(size_t aSlots, std::chrono::milliseconds aTimeout)
+    {
+        const size_t lFree = aSlots < prCapacity ? aSlots : prCapacity;
+        std::unique_lock<std::mutex> lLock(prMutex);
+        return prNotFull.wait_for(lLock, aTimeout,
+                   [this, lFree] { return prClosed || prItems.size() + lFree <= prCapacity; })
+            && !prClosed;
+    }
+
+    /// Takes the oldest item, waiting for one. Returns \c false once the queue is closed and
+    /// empty.
+    bool pop(T *aItem)
+    {
+        {
+            std::unique_lock<std::mutex> lLock(prMutex);
+            prNotEmpty.wait(lLock, [this] { return prClosed || !prItems.empty(); });
+            if (prItems.empty())
+                return false;
+            *aItem = std::move(prItems.front());
+            prItems.pop_front();
+        }
+        // Waiters may want different amounts of space, so wake them all to re-check.
+        prNotFull.notify_all();
+        return true;
+    }
+
+    /// Marks one popped item as handled.
+    void taskDone()
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (--prUnfinished == 0)
+            prFinished.notify_all();
+    }
+
+    /// Blocks until every queued item has been popped and handled.
+    void join()
+    {
+        std::unique_lock<std::mutex> lLock(prMutex);
+        prFinished.wait(lLock, [this] { return prUnfinished == 0; });
+    }
+
+    /// Refuses further items and wakes every waiting thread; items already queued can still
+    /// be popped.
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lLock(prMutex);
+            prClosed = true;
+        }
+        prNotEmpty.notify_all();
+        prNotFull.notify_all();
+    }
+
+    size_t size() const
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        return prItems.size();
+    }
+
+    size_t capacity() const { return prCapacity; }
+
+private:
+    const size_t prCapacity;
+
+    mutable std::mutex prMutex;
+    std::condition_variable prNotEmpty;
+    std::condition_variable prNotFull;
+    std::condition_variable prFinished;
+    std::deque<T> prItems;
+    size_t prUnfinished = 0;
+    bool prClosed = false;
+};
+
+} // namespace readerd
+
+#endif // READERD_BOUNDEDQUEUE_H
@@ -0,0 +1,57 @@
+#ifndef READERD_BUFFERPOOL_H
+#define READERD_BUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace readerd {
+
+/// Size-classed pool of large byte buffers, used for image-sized payloads so that a steady
+/// stream of documents reuses the same memory instead of allocating several full-page images
+/// per scan.
+///
+/// Sizes are rounded up to classes spaced a quarter power of two apart (at most 25% slack).
+/// A buffer returns to its class when the last reference to it goes, wherever that happens;
+/// outstanding buffers keep the pool's state alive, so the pool may be destroyed first.
+/// endOfDocument() trims the cache back to what recent documents actually needed, so one
+/// unusual document does not pin memory for the life of the process.
+class BufferPool
+{
+public:
+    struct Stats
+    {
+        uint64_t puHits = 0;
+        uint64_t puMisses = 0;
+        size_t puCachedBytes = 0;       ///< Free buffers held for reuse.
+        size_t puInUseBytes = 0;        ///< Buffers currently referenced.
+    };
+
+    /// Holds at most \a aMaxCachedBytes of free buffers.
+    explicit BufferPool(size_t aMaxCachedBytes = 256u * 1024u * 1024u);
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    /// Returns an uninitialised buffer of at least \a aSize bytes.
+    std::shared_ptr<uint8_t[]> acquire(size_t aSize);
+
+    /// Marks a document boundary (END_OF_DOCUMENT_DATA or MMMReader_ClearData()) and trims
+    /// the free buffers to twice the peak in use since the previous boundary.
+    void endOfDocument();
+
+    Stats stats() const;
+
+    /// The class \a aSize is rounded up to.
+    static size_t classSize(size_t aSize);
+
+private:
+    struct State;
+    struct Releaser;
+
+    std::shared_ptr<State> prState;
+};
+
+} // namespace readerd
+
+#endif // READERD_BUFFERPOOL_H
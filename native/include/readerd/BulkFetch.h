@@ -0,0 +1,92 @@
+#ifndef READERD_BULKFETCH_H
+#define READERD_BULKFETCH_H
+
+#include "readerd/DataSlab.h"
+#include "readerd/ReaderBackend.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace readerd {
+
+/// Location of one data item inside a BulkResult arena.
+struct BulkEntry
+{
+    MMMReaderDataType puDataType;
+    int puIndex;
+    size_t puOffset;
+    size_t puLength;
+};
+
+/// Every item fetched for one document, packed into a single contiguous arena.
+class BulkResult
+{
+public:
+    const std::vector<BulkEntry> &entries() const { return prEntries; }
+
+    /// The whole arena; entries index into it.
+    const DataRef &arena() const { return prArena; }
+
+    std::span<const uint8_t> bytes(const BulkEntry &aEntry) const
+    {
+        return prArena.bytes().subspan(aEntry.puOffset, aEntry.puLength);
+    }
+
+    /// A view of one entry that shares ownership of the arena.
+    DataRef slice(const BulkEntry &aEntry) const { return prArena.slice(aEntry.puOffset, aEntry.puLength); }
+
+    /// Returns the entry for \a aDataType / \a aIndex, or \c nullptr if it was not present.
+    const BulkEntry *find(MMMReaderDataType aDataType, int aIndex = 0) const;
+
+private:
+    friend class BulkFetcher;
+
+    DataRef prArena;
+    std::vector<BulkEntry> prEntries;
+};
+
+/// Blocking-mode replacement for the MMMReader_GetData() size-probe/fetch double call.
+///
+/// fetch() counts every requested data type, lays all items out in one arena and fills it
+/// in a single pass. The slot for each (type, index) is sized from what the previous
+/// documents returned, so once the fetcher has seen a document it makes one GetData call
+/// per item. Only items that have never been seen, or have outgrown their slot, are probed;
+/// in that case the arena is regrown once and the items already fetched are moved across.
+class BulkFetcher
+{
+public:
+    explicit BulkFetcher(ReaderBackend &aBackend);
+
+    /// Fetches all items of \a aDataTypes for the document last read with
+    /// MMMReader_ReadDocument(). Data types at or above CD_PLUGIN are rejected, as the SDK
+    /// serves those through MMMReader_GetPluginData().
+    MMMReaderErrorCode fetch(std::span<const MMMReaderDataType> aDataTypes, BulkResult *aResult);
+
+    /// Number of MMMReader_GetData() calls made by the last fetch().
+    int lastGetDataCalls() const { return prLastGetDataCalls; }
+
+    /// The data types a kiosk typically enables: codeline, images, security check and the
+    /// RF chip files and validation results.
+    static std::span<const MMMReaderDataType> defaultDataTypes();
+
+private:
+    using SlotKey = std::pair<int, int>;
+
+    size_t slotSize(MMMReaderDataType aDataType, int aIndex) const;
+    MMMReaderErrorCode probe(MMMReaderDataType aDataType, int aIndex, size_t *aSize);
+    void growArena(size_t aRequired);
+
+    ReaderBackend &prBackend;
+    std::map<SlotKey, size_t> prSizeHints;
+    std::shared_ptr<uint8_t[]> prArena;
+    size_t prArenaCapacity = 0;
+    int prLastGetDataCalls = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_BULKFETCH_H
@@ -0,0 +1,198 @@
+#ifndef READERD_CERTIFICATESTORE_H
+#define READERD_CERTIFICATESTORE_H
+
+#include "readerd/ReaderBackend.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// Magic of a certificate store, "RDCS".
+constexpr uint32_t kCertificateStoreMagic = 0x53434452;
+constexpr uint32_t kCertificateStoreVersion = 1;
+
+/// What a certificate is looked up by.
+enum CertificateKey
+{
+    CK_NONE = 0,            ///< Marks an empty index slot.
+    CK_SUBJECT_KEY_ID,      ///< The contents of the subjectKeyIdentifier extension.
+    CK_SUBJECT,             ///< The DER subject Name, i.e. the issuer Name of what it signed.
+    CK_ISSUER_SERIAL,       ///< The DER issuer Name followed by the serialNumber contents.
+};
+
+/// Leads a certificate store. The DER certificates follow, then puCertificates
+/// CertificateRecord and the puSlots CertificateSlot of the index.
+struct CertificateStoreHeader
+{
+    uint32_t puMagic;               ///< Written last, so an interrupted store is never opened.
+    uint32_t puVersion;
+    uint64_t puCertificates;
+    uint64_t puSlots;               ///< A power of two.
+    uint64_t puRecordsOffset;
+    uint64_t puSlotsOffset;
+    uint64_t puLength;              ///< Of the whole file.
+};
+
+/// One certificate, with where its fields lie, as offsets from puOffset.
+struct CertificateRecord
+{
+    uint64_t puOffset;              ///< From the start of the store.
+    uint32_t puLength;
+    uint32_t puSubjectOffset;
+    uint32_t puSubjectLength;
+    uint32_t puIssuerOffset;
+    uint32_t puIssuerLength;
+    uint32_t puSerialOffset;
+    uint32_t puSerialLength;
+    uint32_t puKeyIdOffset;
+    uint32_t puKeyIdLength;         ///< 0 without a subjectKeyIdentifier.
+    uint32_t puReserved;
+};
+
+/// One entry of the open-addressed index.
+struct CertificateSlot
+{
+    uint64_t puHash;                ///< Of the key kind and bytes.
+    uint32_t puKind;                ///< A CertificateKey; CK_NONE for an empty slot.
+    uint32_t puRecord;
+};
+
+/// The fields of an X.509 certificate the store indexes, as views into its DER encoding.
+struct CertificateFields
+{
+    std::span<const uint8_t> puDer;
+    std::span<const uint8_t> puSubject;
+    std::span<const uint8_t> puIssuer;
+    std::span<const uint8_t> puSerial;  ///< Contents of the INTEGER.
+    std::span<const uint8_t> puKeyId;
+};
+
+/// Parses the fields out of the DER certificate \a aDer. Returns \c false if it is not one.
+bool parseCertificate(std::span<const uint8_t> aDer, CertificateFields *aFields);
+
+/// Appends the DER certificates of the ICAO CscaMasterList \a aFile to \a aCertificates, as
+/// views into it. The list's own signature is not checked. Returns \c false if it is not one.
+bool parseMasterList(std::span<const uint8_t> aFile, std::vector<std::span<const uint8_t>> *aCertificates);
+
+/// Whether the file \a aPath ends in one of the semicolon separated \a aExtensions, in any
+/// case, as puCertFileExtensions lists them.
+bool hasFileExtension(const std::string &aPath, const std::string &aExtensions);
+
+/// A file listFiles() found.
+struct ListedFile
+{
+    std::string puPath;
+    uint64_t puSize = 0;
+    int64_t puModified = 0;     ///< In ticks of the file system clock.
+};
+
+/// Lists the regular files in \a aDirectory, and with \a aRecursive in its subdirectories,
+/// that end in one of \a aExtensions (as hasFileExtension()), sorted by path. On failure to
+/// list it returns ERROR_READING_FILE and describes the cause in \a aError.
+MMMReaderErrorCode listFiles(const std::string &aDirectory, bool aRecursive, const std::string &aExtensions,
+                             std::vector<ListedFile> *aFiles, std::string *aError);
+
+/// Reads the whole of the file \a aPath into \a aBytes.
+bool readFile(const std::string &aPath, std::vector<uint8_t> *aBytes);
+
+/// Appends the decoded contents of every PEM block labelled \a aLabel in \a aFile to
+/// \a aBlocks. Returns \c false if \a aFile has no such block, e.g. because it is DER.
+bool decodePem(std::span<const uint8_t> aFile, const std::string &aLabel, std::vector<std::vector<uint8_t>> *aBlocks);
+
+/// Where a store is built from, in the terms of RFProcessSettings.
+struct CertificateSource
+{
+    std::string puDirectory;                        ///< puCertsDir
+    bool puIncludeSubDirs = false;                  ///< puCertsIncludeSubDirs
+    std::string puExtensions = "cer;crt;der;pem;ml";  ///< puCertFileExtensions, plus master lists
+};
+
+struct CertificateBuildStats
+{
+    uint64_t puFiles = 0;
+    uint64_t puCertificates = 0;    ///< Stored, once each.
+    uint64_t puDuplicates = 0;      ///< Found again, as master lists overlap.
+    uint64_t puSkipped = 0;         ///< Files with nothing that parsed.
+};
+
+/// Document signer and country signer certificates indexed for constant time lookup, in one
+/// file mapped read-only.
+///
+/// With ECM_CERT_FILE_STORE the SDK looks for a certificate by walking puCertsDir and parsing
+/// file after file, on every passive authentication. A store is built once from the same
+/// folder by build(): DER and PEM certificates, and ICAO master lists (CscaMasterList in CMS)
+/// unpacked into their certificates. Each certificate is indexed by its subject key
+/// identifier, its subject and its issuer and serial number, and a lookup is one hash, one
+/// probe or two into the mapped index, and a compare against the certificate's own fields.
+///
+/// The SDK is pointed at a store by setting puExternalDSCMode and puExternalCSCMode to
+/// ECM_CERT_CALLBACK and installing certificateCallback().
+class CertificateStore
+{
+public:
+    CertificateStore() = default;
+    ~CertificateStore();
+
+    CertificateStore(const CertificateStore &) = delete;
+    CertificateStore &operator=(const CertificateStore &) = delete;
+
+    /// Reads every certificate under \a aSource into a new store at \a aPath, replacing any
+    /// store there at once. Files that hold no certificate are counted and skipped. On
+    /// failure returns ERROR_READING_FILE or ERROR_WRITING_FILE and describes the cause in
+    /// \a aError.
+    static MMMReaderErrorCode build(const CertificateSource &aSource, const std::string &aPath,
+                                    CertificateBuildStats *aStats, std::string *aError);
+
+    /// On failure returns ERROR_OS_ERROR or ERROR_UNKNOWN_DATA_FORMAT and describes the cause
+    /// in \a aError.
+    MMMReaderErrorCode open(const std::string &aPath, std::string *aError);
+
+    void close();
+
+    size_t size() const { return prRecordCount; }
+
+    /// The DER certificate \a aIndex, in the order they were stored.
+    std::span<const uint8_t> certificate(size_t aIndex) const
+    {
+        return std::span<const uint8_t>(prData + prRecords[aIndex].puOffset, prRecords[aIndex].puLength);
+    }
+
+    /// The DER certificate with key \a aKey of kind \a aKind, valid until close(); empty if
+    /// there is none. Of several with the same key, the first stored is returned.
+    std::span<const uint8_t> find(CertificateKey aKind, std::span<const uint8_t> aKey) const;
+
+    /// The certificate named by a DER SignerIdentifier (an IssuerAndSerialNumber or a [0]
+    /// SubjectKeyIdentifier), as the SDK asks for a document signer certificate.
+    std::span<const uint8_t> findSigner(std::span<const uint8_t> aSignerIdentifier) const;
+
+    /// The certificate named by a DER AuthorityKeyIdentifier, as the SDK asks for a country
+    /// signer certificate: by key identifier, else by issuer and serial number.
+    std::span<const uint8_t> findAuthority(std::span<const uint8_t> aAuthorityKeyId) const;
+
+    /// Answers one certificate request of the SDK, following the buffer protocol of
+    /// MMMReaderCertificateCallback. Handles CT_DOC_SIGNER_CERT and CT_COUNTRY_SIGNER_CERT.
+    bool provide(const char *aCertIdentifier, int aCertIdentifierLen, CERT_TYPE aCertType,
+                 char *aCertBuffer, int *aCertBufferLen) const;
+
+    /// An MMMReaderCertificateCallback for a store passed as \a aParam.
+    static bool certificateCallback(void *aParam, char *aCertIdentifier, int aCertIdentifierLen,
+                                    CERT_TYPE aCertType, char *aCertBuffer, int *aCertBufferLen);
+
+private:
+    std::span<const uint8_t> field(const CertificateRecord &aRecord, uint32_t aOffset, uint32_t aLength) const;
+    bool matches(const CertificateRecord &aRecord, CertificateKey aKind, std::span<const uint8_t> aKey) const;
+
+    const uint8_t *prData = nullptr;
+    size_t prSize = 0;
+    const CertificateRecord *prRecords = nullptr;
+    size_t prRecordCount = 0;
+    const CertificateSlot *prSlots = nullptr;
+    uint64_t prSlotMask = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_CERTIFICATESTORE_H
@@ -0,0 +1,87 @@
+#ifndef READERD_CHIPRESULTCACHE_H
+#define READERD_CHIPRESULTCACHE_H
+
+#include "readerd/SecurityObject.h"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace readerd {
+
+struct ChipCacheOptions
+{
+    /// How long the files of a chip are served after it was read in full.
+    std::chrono::milliseconds puTimeToLive = std::chrono::minutes(10);
+
+    /// Chips held at most; the one closest to expiry makes room for a new one.
+    size_t puMaxChips = 256;
+
+    /// Serve cached files only to a chip whose DG15 matches its EF.SOD and that passes Active
+    /// Authentication with the key in it. Without it, a chip that carries a copy of a cached
+    /// EF.SOD would be served the files of the chip it was copied from.
+    bool puRequireActiveAuthentication = true;
+};
+
+/// What a full read of one chip produced.
+struct CachedChip
+{
+    std::vector<uint8_t> puEfCom;
+
+    /// By data group number. A data group that was read has its file and its check outcome
+    /// against EF.SOD, before any revocation check; one the chip lacks is known but empty.
+    std::array<std::vector<uint8_t>, kMaxDataGroup + 1> puFiles;
+    std::array<int, kMaxDataGroup + 1> puValidation{};
+    std::array<bool, kMaxDataGroup + 1> puKnown{};
+
+    std::chrono::steady_clock::time_point puExpires;
+};
+
+/// The files and check outcomes of chips read recently, keyed by their EF.SOD.
+///
+/// The same passport is read several times in one journey. EF.SOD holds the digest of every
+/// data group and is signed by the issuer, so a chip presenting an EF.SOD byte for byte equal
+/// to one read in full moments ago holds the same data groups. RfReader then reads EF.SOD
+/// alone and serves the rest from here.
+///
+/// EF.SOD can be copied to another chip, but the private key behind Active Authentication
+/// cannot, so by default a cached chip is only served once DG15 is read and matches EF.SOD,
+/// and the chip passes Active Authentication with the key in it.
+///
+/// The data groups include the facial image, so entries are held in memory only and for
+/// ChipCacheOptions::puTimeToLive at most. Safe to share between readers.
+class ChipResultCache
+{
+public:
+    explicit ChipResultCache(const ChipCacheOptions &aOptions);
+
+    const ChipCacheOptions &options() const { return prOptions; }
+
+    /// The chip with EF.SOD \a aEfSod, if it was stored within the time to live.
+    std::shared_ptr<const CachedChip> find(std::span<const uint8_t> aEfSod);
+
+    /// Stores \a aChip under \a aEfSod, replacing any earlier read of it, and sets its expiry.
+    void store(std::span<const uint8_t> aEfSod, CachedChip aChip);
+
+    /// Drops every chip.
+    void clear();
+
+    size_t size() const;
+
+private:
+    void evictExpired(std::chrono::steady_clock::time_point aNow);
+
+    const ChipCacheOptions prOptions;
+    mutable std::mutex prMutex;
+    std::unordered_map<std::string, std::shared_ptr<const CachedChip>> prChips;   ///< By EF.SOD.
+};
+
+} // namespace readerd
+
+#endif // READERD_CHIPRESULTCACHE_H
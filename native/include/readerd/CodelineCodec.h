@@ -0,0 +1,110 @@
+#ifndef READERD_CODELINECODEC_H
+#define READERD_CODELINECODEC_H
+
+#include "MMMReaderHighLevelAPI.h"
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace readerd {
+
+/// String members of MMMReaderCodelineData, in the order they are encoded.
+enum CodelineField
+{
+    CF_DATA,
+    CF_LINE1,
+    CF_LINE2,
+    CF_LINE3,
+    CF_DOC_ID,
+    CF_DOC_TYPE,
+    CF_SURNAME,
+    CF_FORENAME,
+    CF_SECOND_NAME,
+    CF_FORENAMES,
+    CF_DATE_OF_BIRTH_MRZ,
+    CF_EXPIRY_DATE_MRZ,
+    CF_ISSUING_STATE,
+    CF_NATIONALITY,
+    CF_DOC_NUMBER,
+    CF_SEX,
+    CF_OPTIONAL_DATA1,
+    CF_OPTIONAL_DATA2,
+    CF_STRING_COUNT
+};
+
+/// Name of the struct member behind \a aField, e.g. "IssuingState".
+const char *codelineFieldName(CodelineField aField);
+
+/// The string member \a aField of \a aData, which need not be NUL-terminated when it fills
+/// its array.
+std::string_view codelineField(const MMMReaderCodelineData &aData, CodelineField aField);
+
+/// Version byte leading every encoded codeline.
+const uint8_t kCodelineCodecVersion = 1;
+
+/// Appends the compact encoding of \a aData to \a aOut and returns its size.
+///
+/// The layout, shared with the Java decoder (com.readerd.CompactCodeline), is a version byte,
+/// a varint presence bitmap and then only the members that are set:
+///
+/// - bits 0-17: the CodelineField strings, each as a varint length and its bytes;
+/// - bit 18: LineCount; bits 19 and 20: DateOfBirth and ExpiryDate as Day, Month, Year;
+/// - bit 21: ShortSex as one byte;
+/// - bit 22: CheckDigitDataList as a varint count and, per entry, type, line, position,
+///   expected, read and result;
+/// - bit 23: CodelineValidationResult; bit 24: a byte of MrzOnRearSide (bit 0) and
+///   ExpiredDocumentFlag (bit 1); bit 25: ImageSource;
+/// - bit 26: Data is not stored because it is the lines joined with '\\r'.
+///
+/// Integers are zigzag varints, except the check digit bytes. A member is "set" when it is
+/// not zero or empty, so decoding reproduces the struct exactly.
+size_t encodeCodeline(const MMMReaderCodelineData &aData, std::vector<uint8_t> *aOut);
+
+/// Read-only view of an encoded codeline. Strings are views into the encoded buffer, which
+/// must outlive the view; nothing is copied until toStruct().
+class CodelineView
+{
+public:
+    /// Returns \c false if \a aBytes is truncated, has an unknown version or overlong fields.
+    bool parse(std::span<const uint8_t> aBytes);
+
+    std::string_view field(CodelineField aField) const { return prStrings[aField]; }
+
+    /// The full codeline, rebuilt from the lines when the encoder left it out.
+    std::string data() const;
+
+    int lineCount() const { return prLineCount; }
+    const MMMReaderDate &dateOfBirth() const { return prDateOfBirth; }
+    const MMMReaderDate &expiryDate() const { return prExpiryDate; }
+    char shortSex() const { return prShortSex; }
+    std::span<const MMMReaderCodelineCheckDigitData> checkDigits() const
+    {
+        return std::span<const MMMReaderCodelineCheckDigitData>(prCheckDigits.data(), prCheckDigitCount);
+    }
+    MMMReaderCheckDigitResult validationResult() const { return prValidationResult; }
+
+    /// Fills \a aData as the SDK would have delivered it.
+    void toStruct(MMMReaderCodelineData *aData) const;
+
+private:
+    std::array<std::string_view, CF_STRING_COUNT> prStrings{};
+    bool prDataFromLines = false;
+    int prLineCount = 0;
+    MMMReaderDate prDateOfBirth{};
+    MMMReaderDate prExpiryDate{};
+    char prShortSex = 0;
+    std::array<MMMReaderCodelineCheckDigitData, MAX_CHECKDIGITDATA_COUNT> prCheckDigits{};
+    size_t prCheckDigitCount = 0;
+    MMMReaderCheckDigitResult prValidationResult = CDR_Invalid;
+    bool prMrzOnRearSide = false;
+    bool prExpiredDocumentFlag = false;
+    int prImageSource = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_CODELINECODEC_H
@@ -0,0 +1,104 @@
+#ifndef READERD_CORPUSPACK_H
+#define READERD_CORPUSPACK_H
+
+#include "readerd/ReaderBackend.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace readerd {
+
+/// Magic of a corpus pack, "RDCP".
+constexpr uint32_t kCorpusPackMagic = 0x50434452;
+constexpr uint32_t kCorpusPackVersion = 1;
+
+/// Leads a corpus pack. The file contents follow, each on a 64-byte boundary, then the index:
+/// puEntries CorpusPackEntry, the CorpusPackFile of every entry in turn, and the names.
+struct CorpusPackHeader
+{
+    uint32_t puMagic;       ///< Written last, so an interrupted pack is never opened.
+    uint32_t puVersion;
+    uint64_t puEntries;
+    uint64_t puIndexOffset;
+    uint64_t puIndexLength;
+};
+
+/// One scan directory.
+struct CorpusPackEntry
+{
+    uint64_t puNameOffset;  ///< Into the names, like every name offset.
+    uint32_t puNameLength;
+    uint32_t puFiles;
+    uint64_t puFirstFile;
+};
+
+/// One file of a scan directory.
+struct CorpusPackFile
+{
+    uint64_t puOffset;      ///< From the start of the pack.
+    uint64_t puLength;
+    uint64_t puNameOffset;
+    uint64_t puNameLength;
+};
+
+/// A replay corpus bundled into one file and mapped read-only.
+///
+/// Replaying a directory corpus opens and reads every file of every scan again on each pass.
+/// A pack is written once by write(), and each entry is then handed to
+/// ReaderBackend::loadAndProcessScan() as views into the mapping: no open, no read and, with
+/// the simulated backend, no copy before the bytes reach the data callback. Once the pack is
+/// in the page cache a replay is bound by the processing, not the disk.
+class CorpusPack
+{
+public:
+    CorpusPack() = default;
+    ~CorpusPack();
+
+    CorpusPack(const CorpusPack &) = delete;
+    CorpusPack &operator=(const CorpusPack &) = delete;
+
+    /// Packs \a aScanDirectories, in order, into \a aPath. Subdirectories of a scan directory
+    /// are not packed. On failure returns ERROR_READING_FILE or ERROR_WRITING_FILE and
+    /// describes the cause in \a aError.
+    static MMMReaderErrorCode write(const std::vector<std::string> &aScanDirectories, const std::string &aPath,
+                                    std::string *aError);
+
+    /// Whether \a aPath starts like a corpus pack.
+    static bool isPack(const std::string &aPath);
+
+    /// On failure returns ERROR_OS_ERROR or ERROR_UNKNOWN_DATA_FORMAT and describes the cause
+    /// in \a aError.
+    MMMReaderErrorCode open(const std::string &aPath, std::string *aError);
+
+    void close();
+
+    size_t size() const { return prEntryCount; }
+
+    /// The path the scan directory was packed from.
+    std::string_view name(size_t aEntry) const;
+
+    /// Replaces \a aFiles with views of the files of \a aEntry, valid until close().
+    void files(size_t aEntry, std::vector<ScanFile> *aFiles) const;
+
+    /// Asks the kernel to start reading \a aEntry in, so that a worker about to replay it
+    /// does not wait on the disk after a cold start.
+    void prefetch(size_t aEntry) const;
+
+    /// Bytes of file contents in the pack.
+    uint64_t contentBytes() const { return prContentBytes; }
+
+private:
+    const uint8_t *prData = nullptr;
+    size_t prSize = 0;
+    const CorpusPackEntry *prEntries = nullptr;
+    size_t prEntryCount = 0;
+    const CorpusPackFile *prFiles = nullptr;
+    const char *prNames = nullptr;
+    uint64_t prContentBytes = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_CORPUSPACK_H
@@ -0,0 +1,132 @@
+#ifndef READERD_DATASLAB_H
+#define READERD_DATASLAB_H
+
+#include "MMMReaderHighLevelAPI.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace readerd {
+
+class BufferPool;
+
+/// Read-only view of bytes pinned in a reference-counted slab.
+///
+/// Copying a DataRef shares the slab; the bytes are released when the last reference goes.
+/// Sub-views created with slice() keep the whole slab alive.
+class DataRef
+{
+public:
+    DataRef() = default;
+
+    /// Copies \a aLen bytes into a newly allocated slab. This is the only place data
+    /// delivered by the SDK is copied.
+    static DataRef copyOf(const void *aData, size_t aLen);
+
+    /// As copyOf(), but the slab comes from (and returns to) \a aPool when it is not null.
+    static DataRef copyOf(const void *aData, size_t aLen, BufferPool *aPool);
+
+    /// Shares the first \a aLen bytes of an existing slab without copying.
+    static DataRef adopt(std::shared_ptr<const uint8_t[]> aSlab, size_t aLen);
+
+    std::span<const uint8_t> bytes() const { return prBytes; }
+    const uint8_t *data() const { return prBytes.data(); }
+    size_t size() const { return prBytes.size(); }
+    bool empty() const { return prBytes.empty(); }
+
+    /// Returns a view of part of this slab, sharing ownership.
+    DataRef slice(size_t aOffset, size_t aLen) const;
+
+    /// Number of DataRefs (including this one) sharing the slab.
+    long useCount() const { return prSlab.use_count(); }
+
+private:
+    DataRef(std::shared_ptr<const uint8_t[]> aSlab, std::span<const uint8_t> aBytes)
+        : prSlab(std::move(aSlab))
+        , prBytes(aBytes)
+    {
+    }
+
+    std::shared_ptr<const uint8_t[]> prSlab;
+    std::span<const uint8_t> prBytes;
+};
+
+/// One data item as handed over by MMMReaderHLDataCallback.
+///
+/// bytes() borrows the SDK's \a aDataPtr directly and is only valid while the callback is
+/// running. A consumer that needs the data afterwards calls retain(): the first call pins the
+/// bytes into a slab, and every later call shares that same slab, so the item is copied at
+/// most once however many consumers keep it, and not at all if none do.
+///
+/// Consumers are invoked on the callback thread, so retain() needs no locking.
+class DataItem
+{
+public:
+    /// \a aPool, if given, supplies the slab retain() copies into.
+    DataItem(MMMReaderDataType aDataType, uint32_t aDocument, const void *aDataPtr, size_t aDataLen,
+             BufferPool *aPool = nullptr)
+        : prDataType(aDataType)
+        , prDocument(aDocument)
+        , prBytes(static_cast<const uint8_t *>(aDataPtr), aDataLen)
+        , prPool(aPool)
+    {
+    }
+
+    /// An item whose bytes are already pinned, e.g. a slice of a BulkResult arena.
+    DataItem(MMMReaderDataType aDataType, uint32_t aDocument, DataRef aPinned)
+        : prDataType(aDataType)
+        , prDocument(aDocument)
+        , prBytes(aPinned.bytes())
+        , prPinned(std::move(aPinned))
+    {
+    }
+
+    DataItem(const DataItem &) = delete;
+    DataItem &operator=(const DataItem &) = delete;
+
+    MMMReaderDataType type() const { return prDataType; }
+    uint32_t document() const { return prDocument; }
+    std::span<const uint8_t> bytes() const { return prBytes; }
+    size_t size() const { return prBytes.size(); }
+
+    /// Reads the payload as a \a T (e.g. \c int for CD_SECURITYCHECK, MMMReaderCodelineData
+    /// for CD_CODELINE_DATA). Returns \c nullptr if the payload is too short.
+    template <typename T>
+    const T *as() const
+    {
+        return prBytes.size() >= sizeof(T) ? reinterpret_cast<const T *>(prBytes.data()) : nullptr;
+    }
+
+    DataRef retain() const;
+
+    bool retained() const { return !prPinned.empty() || prBytes.empty(); }
+
+private:
+    MMMReaderDataType prDataType;
+    uint32_t prDocument;
+    std::span<const uint8_t> prBytes;
+    BufferPool *prPool = nullptr;
+    mutable DataRef prPinned;
+};
+
+/// Receives everything the reader produces, synchronously on the SDK callback thread.
+///
+/// Implementations must not block: anything slow should retain() the item and hand it off.
+class DataConsumer
+{
+public:
+    virtual ~DataConsumer() = default;
+
+    virtual void onData(const DataItem &aItem) = 0;
+
+    virtual void onEvent(MMMReaderEventCode /*aEventCode*/, uint32_t /*aDocument*/) {}
+
+    virtual void onError(MMMReaderErrorCode /*aErrorCode*/, const char * /*aErrorMsg*/, uint32_t /*aDocument*/) {}
+};
+
+} // namespace readerd
+
+#endif // READERD_DATASLAB_H
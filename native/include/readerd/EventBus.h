@@ -0,0 +1,115 @@
+#ifndef READERD_EVENTBUS_H
+#define READERD_EVENTBUS_H
+
+#include "readerd/DataSlab.h"
+#include "readerd/MpscRing.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+/// What a BusMessage carries.
+enum BusMessageKind : uint8_t
+{
+    BM_DATA,
+    BM_EVENT,
+    BM_ERROR,
+};
+
+/// Descriptor of one callback, small enough to copy into a ring slot. The payload is a
+/// retained DataRef (the data item, or the NUL-terminated error message), so it stays valid
+/// after the callback has returned.
+struct BusMessage
+{
+    BusMessageKind puKind = BM_DATA;
+    uint32_t puCode = 0;        ///< MMMReaderDataType, MMMReaderEventCode or MMMReaderErrorCode.
+    uint32_t puDocument = 0;
+    DataRef puPayload;
+};
+
+/// Moves application handlers off the SDK callback threads.
+///
+/// The bus is itself a DataConsumer. On the callback thread it only retains the item and
+/// pushes a BusMessage into one lock-free MpscRing per subscriber; each subscriber runs on
+/// its own thread, which replays the messages in order as ordinary onData(), onEvent() and
+/// onError() calls. A slow subscriber (a UI update, a blocking socket write) therefore only
+/// delays itself, never the reader or the other subscribers.
+///
+/// Nothing on the callback side waits. When a subscriber's ring is full its data items are
+/// dropped and counted; the last eighth of the ring is kept for events and errors so that a
+/// subscriber that falls behind still sees every document boundary.
+class EventBus : public DataConsumer
+{
+public:
+    struct Stats
+    {
+        uint64_t puDelivered = 0;
+        uint64_t puDropped = 0;
+        size_t puMaxDepth = 0;      ///< Most messages seen waiting in one subscriber's ring.
+    };
+
+    /// Each subscriber gets a ring of \a aCapacity messages (rounded up to a power of two).
+    explicit EventBus(size_t aCapacity = 4096);
+    ~EventBus() override;
+
+    EventBus(const EventBus &) = delete;
+    EventBus &operator=(const EventBus &) = delete;
+
+    /// Adds \a aHandler, which will run on a thread of its own. Must be called before
+    /// start(); the handler must outlive the bus.
+    void subscribe(DataConsumer *aHandler);
+
+    void start();
+
+    /// Delivers everything already queued, then stops the subscriber threads.
+    void stop();
+
+    /// Blocks until every message queued so far has been handled.
+    void drain();
+
+    void onData(const DataItem &aItem) override;
+    void onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument) override;
+    void onError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg, uint32_t aDocument) override;
+
+    /// Totals over all subscribers.
+    Stats stats() const;
+
+private:
+    struct Subscriber
+    {
+        explicit Subscriber(DataConsumer *aHandler, size_t aCapacity)
+            : puHandler(aHandler)
+            , puRing(aCapacity)
+        {
+        }
+
+        DataConsumer *puHandler;
+        MpscRing<BusMessage> puRing;
+        std::thread puThread;
+
+        std::atomic<bool> puSleeping{false};
+        std::atomic<uint32_t> puSignal{0};
+
+        std::atomic<uint64_t> puQueued{0};
+        std::atomic<uint64_t> puHandled{0};
+        std::atomic<uint64_t> puDropped{0};
+        std::atomic<size_t> puMaxDepth{0};
+    };
+
+    void publish(BusMessage &&aMessage);
+    void wake(Subscriber &aSubscriber);
+    void subscriberLoop(Subscriber *aSubscriber);
+    void deliver(DataConsumer &aHandler, const BusMessage &aMessage);
+
+    const size_t prCapacity;
+    std::vector<std::unique_ptr<Subscriber>> prSubscribers;
+    std::atomic<bool> prRunning{false};
+};
+
+} // namespace readerd
+
+#endif // READERD_EVENTBUS_H
@@ -0,0 +1,24 @@
+#ifndef READERD_FNV_H
+#define READERD_FNV_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace readerd {
+
+constexpr uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+constexpr uint64_t kFnvPrime = 0x100000001b3ull;
+
+/// 64-bit FNV-1a of \a aLen bytes at \a aData, continuing from \a aHash. Stable across builds
+/// and hosts, so it may key what is written to disk.
+inline uint64_t fnv1a(const void *aData, size_t aLen, uint64_t aHash = kFnvOffset)
+{
+    const uint8_t *lData = static_cast<const uint8_t *>(aData);
+    for (size_t i = 0; i < aLen; ++i)
+        aHash = (aHash ^ lData[i]) * kFnvPrime;
+    return aHash;
+}
+
+} // namespace readerd
+
+#endif // READERD_FNV_H
@@ -0,0 +1,58 @@
+#ifndef READERD_HISTOGRAM_H
+#define READERD_HISTOGRAM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace readerd {
+
+/// High dynamic range histogram of non-negative integer values (e.g. nanoseconds).
+///
+/// Uses the HdrHistogram layout: values are kept in power-of-two buckets, each split into
+/// linear sub-buckets, so every recorded value is resolved to within 1 part in 10^digits
+/// across the whole trackable range at a fixed memory cost. Recording is a couple of shifts
+/// and an increment, cheap enough for the read loop. Not thread-safe; keep one per thread
+/// and merge().
+class Histogram
+{
+public:
+    /// Tracks values from 1 to \a aHighestTrackable with \a aSignificantDigits (1-5) digits of
+    /// precision. Larger values are clamped into the top bucket; max() stays exact.
+    explicit Histogram(uint64_t aHighestTrackable = 3600ull * 1000 * 1000 * 1000, int aSignificantDigits = 3);
+
+    void record(uint64_t aValue);
+
+    /// Adds every value recorded in \a aOther, which must have the same layout.
+    void merge(const Histogram &aOther);
+
+    void reset();
+
+    uint64_t count() const { return prTotal; }
+    uint64_t min() const { return prTotal ? prMin : 0; }
+    uint64_t max() const { return prMax; }
+    double mean() const { return prTotal ? static_cast<double>(prSum) / static_cast<double>(prTotal) : 0.0; }
+
+    /// Smallest value such that \a aPercentile percent (0-100) of recordings are at or below
+    /// it, reported as the highest value equivalent to its bucket.
+    uint64_t valueAtPercentile(double aPercentile) const;
+
+private:
+    size_t indexOf(uint64_t aValue) const;
+    uint64_t highestEquivalentValue(size_t aIndex) const;
+
+    int prSubBucketHalfCountMagnitude;
+    uint64_t prSubBucketHalfCount;
+    uint64_t prSubBucketMask;
+    uint64_t prHighestTrackable;
+    std::vector<uint64_t> prCounts;
+
+    uint64_t prTotal = 0;
+    uint64_t prMin = UINT64_MAX;
+    uint64_t prMax = 0;
+    uint64_t prSum = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_HISTOGRAM_H
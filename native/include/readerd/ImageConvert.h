@@ -0,0 +1,218 @@
+#ifndef READERD_IMAGECONVERT_H
+#define READERD_IMAGECONVERT_H
+
+#include "readerd/BoundedQueue.h"
+#include "readerd/DataSlab.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+/// Instruction set the conversion kernels run with. Chosen once at startup from the CPU,
+/// overridable with setSimdLevel() or the \c READERD_SIMD environment variable
+/// (\c scalar, \c sse4, \c avx2) so results and timings can be compared.
+enum SimdLevel
+{
+    SIMD_SCALAR,
+    SIMD_SSE4,
+    SIMD_AVX2,
+};
+
+SimdLevel simdLevel();
+
+/// Selects \a aLevel, or the best supported level below it. Returns the level in effect.
+SimdLevel setSimdLevel(SimdLevel aLevel);
+
+const char *simdLevelName(SimdLevel aLevel);
+
+/// A BMP as delivered for the \c CD_IMAGE* data types, parsed in place.
+struct BitmapView
+{
+    const uint8_t *puPixels = nullptr;  ///< First row in memory (the bottom row when bottom-up).
+    int puWidth = 0;
+    int puHeight = 0;
+    int puBitsPerPixel = 0;             ///< 24 (BGR) or 32 (BGRA).
+    ptrdiff_t puStride = 0;             ///< Bytes between rows in memory, including padding.
+    bool puBottomUp = true;
+
+    /// Row \a aRow counted from the top of the image.
+    const uint8_t *row(int aRow) const
+    {
+        return puPixels + (puBottomUp ? puHeight - 1 - aRow : aRow) * puStride;
+    }
+};
+
+/// Parses an uncompressed 24 or 32bpp BMP. Returns \c false for anything else.
+bool parseBitmap(std::span<const uint8_t> aBytes, BitmapView *aView);
+
+/// Whether \a aDataType carries a captured image (\c CD_IMAGEIR, \c CD_IMAGEVIS, ...).
+bool isImageDataType(MMMReaderDataType aDataType);
+
+/// Whether \a aDataType is an infrared image. These are monochrome, stored with equal B, G
+/// and R, so a single channel is already their greyscale.
+bool isInfraredDataType(MMMReaderDataType aDataType);
+
+/// Runs whole-frame work as bands of rows spread over a fixed set of threads.
+///
+/// forRows() blocks until every band is done, and the calling thread takes bands too, so an
+/// executor of N threads starts N - 1 workers. Calls to forRows() are serialised. Bands are
+/// claimed dynamically, so a core that is busy with something else just takes fewer of them.
+class TileExecutor
+{
+public:
+    /// \a aThreads including the caller; 0 uses every hardware thread.
+    explicit TileExecutor(unsigned aThreads = 0);
+    ~TileExecutor();
+
+    TileExecutor(const TileExecutor &) = delete;
+    TileExecutor &operator=(const TileExecutor &) = delete;
+
+    unsigned threads() const { return static_cast<unsigned>(prWorkers.size()) + 1; }
+
+    /// Calls \a aBand(begin, end) over disjoint row ranges covering [0, \a aRows).
+    void forRows(int aRows, const std::function<void(int aBegin, int aEnd)> &aBand);
+
+private:
+    void workerLoop();
+    void runBands();
+
+    std::mutex prRunMutex;
+    std::mutex prMutex;
+    std::condition_variable prStart;
+    std::condition_variable prDone;
+    uint64_t prGeneration = 0;
+    unsigned prActive = 0;
+    bool prStopping = false;
+
+    const std::function<void(int, int)> *prBand = nullptr;
+    int prRows = 0;
+    int prBandRows = 0;
+    int prBandCount = 0;
+    std::atomic<int> prNextBand{0};
+
+    std::vector<std::thread> prWorkers;
+};
+
+// Row kernels. Each processes \a aPixels pixels; buffers must not overlap.
+
+/// BGR to RGB (the same swap also turns RGB into BGR).
+void swizzleBgrToRgb(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels);
+
+/// BGRA to RGB, dropping alpha.
+void unpackBgraToRgb(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels);
+
+/// BGR to 8-bit luma, Y = (38 R + 75 G + 15 B + 64) >> 7 (BT.601 weights in 7 bits).
+void greyscaleBgr(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels);
+
+/// As greyscaleBgr() for BGRA pixels; alpha is ignored.
+void greyscaleBgra(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels);
+
+/// Copies channel \a aChannel (0 = B, 1 = G, 2 = R) of 3 or 4 byte pixels to an 8-bit plane.
+void extractChannel(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels, int aBytesPerPixel, int aChannel);
+
+/// Halves a row pair of 3-channel pixels: each output pixel is the rounded-up average of a
+/// 2x2 block, computed as avg(avg(top, bottom)) per channel. Produces \a aPixels / 2 pixels.
+void downscaleRowPair(const uint8_t *aTop, const uint8_t *aBottom, uint8_t *aDst, size_t aPixels);
+
+// Whole-image helpers built on the row kernels. Outputs are packed, top-down. With a
+// TileExecutor the rows are split across its threads, otherwise they run on the caller.
+
+/// Writes the bitmap as RGB, \a aDst holding width * height * 3 bytes.
+void bitmapToRgb(const BitmapView &aBitmap, uint8_t *aDst, TileExecutor *aTiles = nullptr);
+
+/// Writes the bitmap as 8-bit greyscale, \a aDst holding width * height bytes.
+void bitmapToGrey(const BitmapView &aBitmap, uint8_t *aDst, TileExecutor *aTiles = nullptr);
+
+/// Writes one channel of the bitmap (0 = B, 1 = G, 2 = R), \a aDst holding width * height bytes.
+void bitmapExtractChannel(const BitmapView &aBitmap, int aChannel, uint8_t *aDst, TileExecutor *aTiles = nullptr);
+
+/// Halves a packed 3-channel image; \a aDst holds (width / 2) * (height / 2) * 3 bytes.
+void downscaleRgb(const uint8_t *aSrc, int aWidth, int aHeight, uint8_t *aDst, TileExecutor *aTiles = nullptr);
+
+/// What ImageConverter turns each image into.
+enum ConvertTarget
+{
+    CONVERT_RGB,            ///< Packed top-down RGB, 3 bytes per pixel.
+    CONVERT_GREY,           ///< Packed top-down 8-bit luma.
+    CONVERT_RGB_HALF,       ///< RGB downscaled 2x in each direction, e.g. for previews.
+};
+
+struct ConvertedImage
+{
+    MMMReaderDataType puDataType;
+    uint32_t puDocument = 0;
+    int puWidth = 0;
+    int puHeight = 0;
+    int puChannels = 0;
+    DataRef puPixels;
+    double puConvertUs = 0.0;   ///< Time spent in the kernels.
+};
+
+/// Converts the BMP images a document produces into raw RGB or greyscale pixels on worker
+/// threads, so the SDK callback thread only pays for retain() and a queue push. Greyscale of
+/// an infrared image is its green channel, which is exact for monochrome IR frames.
+///
+/// Images that are not uncompressed 24/32bpp BMPs (CD_IMAGEPHOTO as JPEG, say) are skipped.
+/// The queue is bounded; when the workers fall behind further images are dropped and counted
+/// rather than stalling the reader. Results are handed to the sink on a worker thread, in
+/// completion order.
+class ImageConverter : public DataConsumer
+{
+public:
+    using Sink = std::function<void(ConvertedImage &&aImage)>;
+
+    struct Stats
+    {
+        uint64_t puConverted = 0;
+        uint64_t puSkipped = 0;     ///< Not a BMP the kernels understand.
+        uint64_t puDropped = 0;     ///< Queue full.
+        double puConvertUs = 0.0;
+    };
+
+    /// Output buffers come from \a aPool when it is not null.
+    ImageConverter(ConvertTarget aTarget, Sink aSink, unsigned aThreads = 1, BufferPool *aPool = nullptr,
+                   size_t aMaxQueued = 32);
+    ~ImageConverter() override;
+
+    ImageConverter(const ImageConverter &) = delete;
+    ImageConverter &operator=(const ImageConverter &) = delete;
+
+    void onData(const DataItem &aItem) override;
+
+    /// Blocks until every queued image has been converted.
+    void drain();
+
+    Stats stats() const;
+
+private:
+    struct Job
+    {
+        MMMReaderDataType puDataType = CD_IMAGEVIS;
+        uint32_t puDocument = 0;
+        DataRef puBytes;
+    };
+
+    void workerLoop();
+    bool convert(const Job &aJob, ConvertedImage *aImage);
+
+    const ConvertTarget prTarget;
+    const Sink prSink;
+    BufferPool *const prPool;
+
+    BoundedQueue<Job> prQueue;
+    mutable std::mutex prStatsMutex;
+    Stats prStats;
+    std::vector<std::thread> prWorkers;
+};
+
+} // namespace readerd
+
+#endif // READERD_IMAGECONVERT_H
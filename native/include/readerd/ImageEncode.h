@@ -0,0 +1,132 @@
+#ifndef READERD_IMAGEENCODE_H
+#define READERD_IMAGEENCODE_H
+
+#include "readerd/BoundedQueue.h"
+#include "readerd/DataSlab.h"
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+enum ImageEncoding
+{
+    ENCODE_JPEG,
+    ENCODE_PNG,
+};
+
+const char *imageEncodingName(ImageEncoding aEncoding);
+
+/// Encoding parameters. The quality and scale fields correspond to the remote verification
+/// settings in DocProcessingSettings, which are what upstream systems are configured with.
+struct EncoderOptions
+{
+    ImageEncoding puEncoding = ENCODE_JPEG;
+
+    /// JPEG quality (1-100) of page images, as \c puRemoteImageCompressionLevel.
+    int puImageQuality = 80;
+
+    /// JPEG quality (1-100) of \c CD_IMAGEPHOTO, as \c puRemotePhotoCompressionLevel.
+    int puPhotoQuality = 90;
+
+    /// Page images are shrunk by this factor before encoding, as \c puRemoteImageScaleDown.
+    /// Rounded down to a power of two; 1 keeps the full resolution.
+    int puScaleDown = 1;
+
+    /// zlib level (0-9) for PNG.
+    int puPngLevel = 6;
+
+    unsigned puThreads = 2;
+    size_t puQueueCapacity = 16;
+};
+
+struct EncodedImage
+{
+    MMMReaderDataType puDataType = CD_IMAGEVIS;
+    uint32_t puDocument = 0;
+    ImageEncoding puEncoding = ENCODE_JPEG;
+    int puWidth = 0;
+    int puHeight = 0;
+    int puChannels = 0;     ///< 1 for IR images, which are encoded as greyscale, otherwise 3.
+    DataRef puBytes;
+    double puEncodeUs = 0.0;
+};
+
+/// Pipeline stage that encodes the BMP images of each document to JPEG or PNG on a pool of
+/// worker threads.
+///
+/// The callback thread only retains the image and offers it to a BoundedQueue. When the
+/// queue is full the image is dropped and counted instead of waiting, so encoding never
+/// delays the next data item and RF reading carries on while earlier images are encoded.
+/// Readers that own their read loop (Blocking mode) apply backpressure properly by calling
+/// waitForCapacity() for a document's worth of images before starting the next document. IR images are encoded as greyscale.
+class ImageEncoder : public DataConsumer
+{
+public:
+    using Sink = std::function<void(EncodedImage &&aImage)>;
+
+    struct Stats
+    {
+        uint64_t puEncoded = 0;
+        uint64_t puSkipped = 0;     ///< Not a BMP (CD_IMAGEPHOTO already compressed, say).
+        uint64_t puDropped = 0;     ///< Queue full.
+        uint64_t puFailed = 0;      ///< Codec error or codec not built in.
+        uint64_t puInputBytes = 0;
+        uint64_t puOutputBytes = 0;
+        double puEncodeUs = 0.0;
+    };
+
+    ImageEncoder(const EncoderOptions &aOptions, Sink aSink);
+    ~ImageEncoder() override;
+
+    ImageEncoder(const ImageEncoder &) = delete;
+    ImageEncoder &operator=(const ImageEncoder &) = delete;
+
+    void onData(const DataItem &aItem) override;
+
+    /// Waits up to \a aTimeout for the queue to have room for \a aImages more images.
+    /// Returns \c false on timeout.
+    bool waitForCapacity(size_t aImages, std::chrono::milliseconds aTimeout);
+
+    /// Blocks until every queued image has been encoded.
+    void drain();
+
+    Stats stats() const;
+
+    /// Whether \a aEncoding was found at build time.
+    static bool supported(ImageEncoding aEncoding);
+
+    /// Encodes the BMP \a aBitmap synchronously on the calling thread. Returns \c false and
+    /// describes the problem in \a aError if it is not a BMP the kernels read or the codec
+    /// fails.
+    static bool encode(std::span<const uint8_t> aBitmap, MMMReaderDataType aDataType,
+                       const EncoderOptions &aOptions, EncodedImage *aImage, std::string *aError);
+
+private:
+    struct Job
+    {
+        MMMReaderDataType puDataType = CD_IMAGEVIS;
+        uint32_t puDocument = 0;
+        DataRef puBytes;
+    };
+
+    void workerLoop();
+
+    const EncoderOptions prOptions;
+    const Sink prSink;
+
+    BoundedQueue<Job> prQueue;
+    mutable std::mutex prStatsMutex;
+    Stats prStats;
+    std::vector<std::thread> prWorkers;
+};
+
+} // namespace readerd
+
+#endif // READERD_IMAGEENCODE_H
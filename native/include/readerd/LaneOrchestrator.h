@@ -0,0 +1,119 @@
+#ifndef READERD_LANEORCHESTRATOR_H
+#define READERD_LANEORCHESTRATOR_H
+
+#include "readerd/ResultClient.h"
+#include "readerd/ResultServer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+struct LaneOptions
+{
+    /// The readerd executable each lane runs.
+    std::string puWorkerPath = "readerd";
+
+    /// Backend every lane's worker drives, and that the scanners are listed from.
+    std::string puBackendSpec = "sdk";
+
+    /// Serial numbers to run a lane for; empty for every connected reader.
+    std::vector<std::string> puScanners;
+
+    /// CPUs split into one disjoint set per lane, each worker pinned to its set. Empty for
+    /// the CPUs this process may run on; puPinCpus false leaves the workers unpinned.
+    std::vector<int> puCpus;
+    bool puPinCpus = true;
+
+    /// Further arguments for every worker (e.g. --blocking, --compact-codelines).
+    std::vector<std::string> puWorkerArguments;
+
+    /// The aggregated stream, as for DaemonOptions.
+    std::string puSocketPath = "/tmp/readerd.sock";
+    ServerFraming puFraming = SF_RECORDS;
+    size_t puClientQueueLimit = 256u * 1024u * 1024u;
+};
+
+struct LaneStats
+{
+    std::string puScanner;
+    std::vector<int> puCpus;
+    pid_t puPid = 0;
+    uint64_t puDocuments = 0;
+    uint64_t puRecords = 0;
+    uint64_t puBytes = 0;
+    bool puRunning = false;
+    int puExitStatus = 0;   ///< As from waitpid(), once the worker has ended.
+};
+
+/// Runs one readerd worker process per connected reader and merges their results into one
+/// stream.
+///
+/// The high-level API keeps a single global reader state, so a process can drive one reader.
+/// Each lane is therefore a separate readerd, which selects its reader with --scanner before
+/// initialising. Each lane is pinned to its own set of CPUs, so lanes neither share caches
+/// nor wait on each other's threads. A worker streams to a private socket with
+/// SF_DOCUMENTS framing. One thread per lane reads each whole-document frame and republishes
+/// its records on the orchestrator's own ResultServer. The payloads stay in the frame buffer
+/// that was received. Documents are renumbered into one sequence, and an RK_SCANNER record
+/// after each START_OF_DOCUMENT_DATA says which reader the document came from.
+class LaneOrchestrator
+{
+public:
+    explicit LaneOrchestrator(const LaneOptions &aOptions);
+    ~LaneOrchestrator();
+
+    LaneOrchestrator(const LaneOrchestrator &) = delete;
+    LaneOrchestrator &operator=(const LaneOrchestrator &) = delete;
+
+    /// Lists the readers if need be, starts the aggregated stream and one worker per reader.
+    /// On failure stops whatever was started and describes the cause in \a aError.
+    MMMReaderErrorCode start(std::string *aError);
+
+    /// Asks every worker to stop with SIGTERM and waits for them.
+    void stop();
+
+    /// Blocks until \a aCount documents have arrived across all lanes, every worker has
+    /// ended, or \a aTimeout expires. Returns \c false on timeout.
+    bool waitForDocuments(uint64_t aCount, std::chrono::milliseconds aTimeout);
+
+    uint64_t documents() const { return prDocuments.load(); }
+
+    std::vector<LaneStats> stats() const;
+
+    double elapsedSeconds() const;
+
+private:
+    struct Lane;
+
+    void laneLoop(Lane &aLane);
+    bool connectLane(Lane &aLane, ResultClient &aClient);
+    void reap(Lane &aLane, bool aWait);
+
+    LaneOptions prOptions;
+    ResultServer prServer;
+    std::vector<std::unique_ptr<Lane>> prLanes;
+    std::atomic<uint32_t> prNextDocument{0};
+    std::atomic<uint64_t> prDocuments{0};
+    std::atomic<bool> prStopping{false};
+    std::chrono::steady_clock::time_point prStartTime;
+
+    mutable std::mutex prMutex;
+    std::condition_variable prProgress;
+    size_t prRunningLanes = 0;
+};
+
+/// Parses a CPU list such as "0-3,8,10-11".
+bool parseCpuList(const std::string &aList, std::vector<int> *aCpus);
+
+} // namespace readerd
+
+#endif // READERD_LANEORCHESTRATOR_H
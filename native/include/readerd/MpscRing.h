@@ -0,0 +1,112 @@
+#ifndef READERD_MPSCRING_H
+#define READERD_MPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+
+namespace readerd {
+
+/// Fixed-size lock-free ring for many producers and a single consumer.
+///
+/// Each slot carries a sequence number, so a producer claims a slot with one compare-exchange
+/// on the write position and publishes it with a release store; it never waits for another
+/// producer or for the consumer. A full ring makes tryPush() fail rather than block. Only one
+/// thread may call tryPop().
+template <typename T>
+class MpscRing
+{
+public:
+    /// \a aCapacity is rounded up to a power of two.
+    explicit MpscRing(size_t aCapacity)
+        : prMask(roundUp(aCapacity) - 1)
+        , prSlots(std::make_unique<Slot[]>(prMask + 1))
+    {
+        for (size_t i = 0; i <= prMask; ++i)
+            prSlots[i].puSequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    /// Queues \a aItem unless \a aLimit (at most the capacity) items are already waiting.
+    bool tryPush(T &&aItem, size_t aLimit = SIZE_MAX)
+    {
+        const size_t lLimit = aLimit < capacity() ? aLimit : capacity();
+        size_t lPosition = prWrite.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if (lPosition - prRead.load(std::memory_order_acquire) >= lLimit)
+                return false;
+            Slot &lSlot = prSlots[lPosition & prMask];
+            const size_t lSequence = lSlot.puSequence.load(std::memory_order_acquire);
+            const intptr_t lDiff = static_cast<intptr_t>(lSequence) - static_cast<intptr_t>(lPosition);
+            if (lDiff == 0)
+            {
+                if (prWrite.compare_exchange_weak(lPosition, lPosition + 1, std::memory_order_relaxed))
+                {
+                    lSlot.puItem = std::move(aItem);
+                    lSlot.puSequence.store(lPosition + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (lDiff < 0)
+                return false;
+            else
+                lPosition = prWrite.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// Takes the oldest published item. Consumer thread only.
+    bool tryPop(T *aItem)
+    {
+        const size_t lPosition = prRead.load(std::memory_order_relaxed);
+        Slot &lSlot = prSlots[lPosition & prMask];
+        if (lSlot.puSequence.load(std::memory_order_acquire) != lPosition + 1)
+            return false;
+        *aItem = std::move(lSlot.puItem);
+        lSlot.puItem = T();
+        lSlot.puSequence.store(lPosition + prMask + 1, std::memory_order_release);
+        prRead.store(lPosition + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// Items claimed by producers and not yet popped; approximate while producers are active.
+    size_t size() const
+    {
+        return prWrite.load(std::memory_order_relaxed) - prRead.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return prMask + 1; }
+
+private:
+    static size_t roundUp(size_t aCapacity)
+    {
+        size_t lCapacity = 2;
+        while (lCapacity < aCapacity)
+            lCapacity <<= 1;
+        return lCapacity;
+    }
+
+    struct Slot
+    {
+        std::atomic<size_t> puSequence{0};
+        T puItem{};
+    };
+
+    static constexpr size_t kCacheLine = 64;
+
+    const size_t prMask;
+    std::unique_ptr<Slot[]> prSlots;
+
+    // Producers contend on the write position; keep the consumer's read position off its
+    // cache line.
+    alignas(kCacheLine) std::atomic<size_t> prWrite{0};
+    alignas(kCacheLine) std::atomic<size_t> prRead{0};
+};
+
+} // namespace readerd
+
+#endif // READERD_MPSCRING_H
@@ -0,0 +1,67 @@
+#ifndef READERD_MRZPARSER_H
+#define READERD_MRZPARSER_H
+
+#include "readerd/ImageConvert.h"
+
+#include "MMMReaderHighLevelAPI.h"
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+
+namespace readerd {
+
+/// ICAO 9303 machine readable zone layouts the parser recognises.
+enum MrzFormat
+{
+    MRZ_UNKNOWN,
+    MRZ_TD1,    ///< 3 lines of 30: identity cards.
+    MRZ_TD2,    ///< 2 lines of 36: identity cards and older travel documents.
+    MRZ_TD3,    ///< 2 lines of 44: passports.
+    MRZ_MRVA,   ///< 2 lines of 44 starting with 'V': full-size visas.
+    MRZ_MRVB,   ///< 2 lines of 36 starting with 'V': small visas.
+    MRZ_FORMAT_COUNT
+};
+
+const char *mrzFormatName(MrzFormat aFormat);
+
+/// ICAO 9303 check digit of \a aChars: the 7-3-1 weighted sum of the character values
+/// (digits 0-9, letters 10-35, the filler '<' 0) modulo 10, as '0' to '9'.
+char mrzCheckDigit(std::string_view aChars);
+
+/// Parses one codeline into \a aData the way MMMReader_ParseCodelineWithCsums() does, filling
+/// the lines, the fields, the dates and the check digit list with its overall result, without
+/// the SDK's parse module or a reader.
+///
+/// \a aCodeline holds the MRZ lines separated by '\\r', '\\n' or '|', or concatenated. When it
+/// is not a recognised layout, \a aData is zeroed (again as the SDK does) and MRZ_UNKNOWN is
+/// returned. ExpiredDocumentFlag is left clear: there is no clock to judge it by.
+MrzFormat parseMrz(std::string_view aCodeline, MMMReaderCodelineData *aData);
+
+/// Parses and validates codelines in bulk for back-office re-verification.
+///
+/// Codelines are split into bands across a TileExecutor. Within a band, codelines of the
+/// same layout are gathered sixteen at a time and transposed so that each check digit is a
+/// weighted sum down columns, computed for all sixteen at once by the kernels of the current
+/// SimdLevel. The fields are then cut out per codeline as parseMrz() does.
+class MrzBatchParser
+{
+public:
+    /// \a aThreads including the caller; 0 uses every hardware thread.
+    explicit MrzBatchParser(unsigned aThreads = 0);
+
+    unsigned threads() const { return prTiles.threads(); }
+
+    /// Parses \a aCodelines[i] into \a aResults[i] and, when \a aFormats is not empty, its
+    /// layout into \a aFormats[i]. \a aResults (and \a aFormats) must be as long as
+    /// \a aCodelines. Returns how many codelines passed every check digit.
+    size_t parse(std::span<const std::string_view> aCodelines, std::span<MMMReaderCodelineData> aResults,
+                 std::span<MrzFormat> aFormats = {});
+
+private:
+    TileExecutor prTiles;
+};
+
+} // namespace readerd
+
+#endif // READERD_MRZPARSER_H
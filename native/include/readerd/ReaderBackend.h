@@ -0,0 +1,125 @@
+#ifndef READERD_READERBACKEND_H
+#define READERD_READERBACKEND_H
+
+#include "MMMReaderHighLevelAPI.h"
+
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace readerd {
+
+/// One file of a saved scan already in memory, as a CorpusPack presents it.
+struct ScanFile
+{
+    std::string_view puName;    ///< File name within the scan directory.
+    std::span<const uint8_t> puBytes;
+};
+
+/// The members of MMMReaderSettings that point outside it, at the SDK folder names, in
+/// declaration order. The structure is packed, so they are reached through member pointers.
+inline constexpr RTCHAR *MMMReaderSettings::*kSettingsDirectories[] = {
+    &MMMReaderSettings::puReaderDir, &MMMReaderSettings::puExeDir,  &MMMReaderSettings::puBinDir,
+    &MMMReaderSettings::puCfgDir,    &MMMReaderSettings::puPluginDir, &MMMReaderSettings::puDataDir,
+    &MMMReaderSettings::puLogDir,    &MMMReaderSettings::puLayoutDatabaseDir,
+};
+
+/// Abstraction over the high-level reader API.
+///
+/// Every method mirrors the MMMReader_* function of the same name so that the SDK backend
+/// is a thin pass-through, while the simulated backend can stand in for the hardware DLL on
+/// build machines. As with the SDK, Blocking mode is selected by passing \c NULL data and
+/// event callbacks to initialise(); otherwise data is delivered through the callbacks on a
+/// thread owned by the backend.
+class ReaderBackend
+{
+public:
+    virtual ~ReaderBackend() = default;
+
+    /// Short name used in logs and statistics ("sdk", "sim").
+    virtual const char *name() const = 0;
+
+    virtual MMMReaderErrorCode initialise(
+        MMMReaderHLDataCallback aDataCallback,
+        MMMReaderEventCallback aEventCallback,
+        MMMReaderErrorCallback aErrorCallback,
+        MMMReaderCertificateCallback aCertCallback,
+        void *aParam) = 0;
+
+    virtual MMMReaderErrorCode shutdown() = 0;
+
+    virtual MMMReaderErrorCode reset() = 0;
+
+    virtual ReaderState getState() = 0;
+
+    virtual MMMReaderErrorCode setState(ReaderState aNewState, bool aForceRedetect) = 0;
+
+    virtual bool isDocumentOnWindow() = 0;
+
+    virtual MMMReaderErrorCode waitForDocumentOnWindow(int aTimeout) = 0;
+
+    virtual MMMReaderErrorCode readDocument() = 0;
+
+    virtual MMMReaderErrorCode getData(
+        MMMReaderDataType aDataType,
+        void *aDataPtr,
+        int *aDataLen,
+        int aIndex) = 0;
+
+    virtual MMMReaderErrorCode getDataCount(MMMReaderDataType aDataType, int *aItemCount) = 0;
+
+    virtual MMMReaderErrorCode clearData() = 0;
+
+    /// Serial numbers of the readers connected to the host.
+    virtual MMMReaderErrorCode getConnectedScanners(std::vector<std::string> *aSerialNumbers) = 0;
+
+    /// Attaches to the reader with \a aSerialNumber. The high-level API has one global reader
+    /// state, so a process drives one reader: this is called once, before initialise().
+    virtual MMMReaderErrorCode selectScanner(const char *aSerialNumber) = 0;
+
+    /// Parses the configuration files into \a aSettings, as MMMReader_LL_LoadSettings or, with
+    /// \a aIniPath, MMMReader_LL_LoadSettingsFromIniFile. The directory strings are owned by
+    /// the backend and stay valid until the next call.
+    virtual MMMReaderErrorCode loadSettings(MMMReaderSettings *aSettings, const char *aIniPath) = 0;
+
+    /// Identifies the settings parser, so that settings resolved by one build of the SDK are
+    /// not taken for those of another.
+    virtual std::string settingsVersion() = 0;
+
+    /// Loads a scan saved by an earlier read and runs it through OCR and the rest of the
+    /// processing chain. Data and events are raised through the callbacks as for a live read,
+    /// starting with START_OF_DOCUMENT_DATA and ending with END_OF_DOCUMENT_DATA; with
+    /// \a aSendDataFlag \c false only the events are raised and the data is left for getData().
+    virtual MMMReaderErrorCode loadAndProcessFromScanDirectory(const char *aDirectoryPath, bool aSendDataFlag) = 0;
+
+    /// As loadAndProcessFromScanDirectory(), for a scan whose files are already in memory.
+    /// The bytes must stay valid until clearData() or the next load. The default writes the
+    /// files to a scratch directory, emptied on each call, and loads that, for backends such
+    /// as the SDK that only read scans from disk.
+    virtual MMMReaderErrorCode loadAndProcessScan(std::span<const ScanFile> aFiles, bool aSendDataFlag);
+};
+
+/// Creates a backend from a specification of the form \c "name[:key=value,...]".
+///
+/// Known names are \c "sim" and, when built with READERD_WITH_SDK, \c "sdk". Returns
+/// \c nullptr and fills \a aError if the specification cannot be satisfied.
+std::unique_ptr<ReaderBackend> createBackend(const std::string &aSpec, std::string *aError);
+
+/// Returns the SDK spelling of \a aCode (e.g. "ERROR_TIMED_OUT") for log messages.
+std::string errorCodeName(MMMReaderErrorCode aCode);
+
+/// Returns the SDK spelling of \a aEvent (e.g. "DOC_ON_WINDOW") for log messages.
+std::string eventCodeName(MMMReaderEventCode aEvent);
+
+/// Returns the SDK spelling of \a aDataType (e.g. "CD_IMAGEVIS").
+std::string dataTypeName(MMMReaderDataType aDataType);
+
+/// Looks up a data type by its SDK spelling. Returns \c false if \a aName is not known.
+bool dataTypeFromName(const std::string &aName, MMMReaderDataType *aDataType);
+
+} // namespace readerd
+
+#endif // READERD_READERBACKEND_H
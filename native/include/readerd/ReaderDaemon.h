@@ -0,0 +1,224 @@
+#ifndef READERD_READERDAEMON_H
+#define READERD_READERDAEMON_H
+
+#include "readerd/BufferPool.h"
+#include "readerd/CertificateStore.h"
+#include "readerd/RevocationCache.h"
+#include "readerd/DataSlab.h"
+#include "readerd/EventBus.h"
+#include "readerd/ImageConvert.h"
+#include "readerd/ImageEncode.h"
+#include "readerd/ReaderBackend.h"
+#include "readerd/ResultServer.h"
+#include "readerd/SharedRing.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+struct DaemonOptions
+{
+    /// Serial number of the reader to drive, for hosts with several; empty for the one the
+    /// SDK picks.
+    std::string puScanner;
+
+    /// Initialise with the reader in READER_SUSPENDED, so that settings and plugins are loaded
+    /// but the hardware stays free for the process driving it until activate().
+    bool puStandby = false;
+
+    /// Path of the AF_UNIX socket results are streamed on, or \c tcp:HOST:PORT.
+    std::string puSocketPath = "/tmp/readerd.sock";
+
+    /// SF_DOCUMENTS sends each document as one frame instead of record by record.
+    ServerFraming puFraming = SF_RECORDS;
+
+    /// Send CD_CODELINE_DATA and CD_SCDG1_CODELINE_DATA to clients as RK_CODELINE records in
+    /// the compact encoding rather than as the raw MMMReaderCodelineData struct.
+    bool puCompactCodelines = false;
+
+    /// Bytes a client may fall behind by before it is disconnected.
+    size_t puClientQueueLimit = 256u * 1024u * 1024u;
+
+    /// Drive the reader in Blocking mode instead: wait for a document, read it, then collect
+    /// every item with a single BulkFetcher pass. Data and events reach clients and consumers
+    /// exactly as in Non-Blocking mode.
+    bool puBlocking = false;
+
+    /// Payloads of at least this many bytes (full-page images, large chip files) are retained
+    /// in buffers from a BufferPool that is recycled at each document boundary.
+    size_t puPoolThreshold = 64u * 1024u;
+
+    /// Free pooled buffers kept for reuse; 0 disables pooling.
+    size_t puPoolLimit = 256u * 1024u * 1024u;
+
+    /// Also stream every BMP image converted to raw pixels (RK_IMAGE records). Conversion runs
+    /// on puConvertThreads ImageConverter workers, never on the callback thread.
+    bool puConvertImages = false;
+    ConvertTarget puConvertTarget = CONVERT_RGB;
+    unsigned puConvertThreads = 2;
+
+    /// Also stream every BMP image encoded as JPEG or PNG (RK_IMAGE records), by an
+    /// ImageEncoder worker pool. In Blocking mode the next document is not read while the
+    /// encoder queue is full.
+    bool puEncodeImages = false;
+    EncoderOptions puEncoder;
+
+    /// Messages each consumer added with addAsyncConsumer() may fall behind by before its
+    /// data items are dropped.
+    size_t puBusCapacity = 4096;
+
+    /// Name of a POSIX shared memory object (e.g. "/readerd") to also publish each document
+    /// into, for a reader process on the same host; empty for none.
+    std::string puSharedRing;
+    size_t puSharedRingBytes = 256u * 1024u * 1024u;
+
+    /// CertificateStore to answer the SDK's certificate callback from; empty for none. The
+    /// SDK only asks when the INI sets the external DSC or CSC mode to ECM_CERT_CALLBACK.
+    std::string puCertificateStore;
+
+    /// Directory of revocation lists to answer the SDK's CT_CERTIFICATE_REVOCATION_LIST
+    /// requests from; empty for none. The SDK only asks when the INI enables the DSC or CSC
+    /// revocation check with the CRL mode set to ECM_CERT_CALLBACK.
+    std::string puRevocationLists;
+
+    /// How often the revocation list directory is checked for new or changed lists.
+    int puRevocationRefreshMs = 60000;
+};
+
+struct DaemonStats
+{
+    uint64_t puDocuments = 0;
+    uint64_t puDataItems = 0;
+    uint64_t puDataBytes = 0;
+    uint64_t puPinnedBytes = 0;     ///< Bytes copied out of SDK buffers because a consumer kept them.
+    uint64_t puEvents = 0;
+    uint64_t puErrors = 0;
+    uint64_t puPoolHits = 0;        ///< Retained payloads served from a recycled buffer.
+    uint64_t puPoolMisses = 0;
+    uint64_t puImagesConverted = 0;
+    uint64_t puImagesDropped = 0;   ///< Images not converted because the converter fell behind.
+    uint64_t puImagesEncoded = 0;
+    uint64_t puEncodeDropped = 0;   ///< Images not encoded because the encoder queue was full.
+    uint64_t puEncodedBytes = 0;
+    uint64_t puBusDropped = 0;      ///< Messages an asynchronous consumer was too far behind to take.
+    uint64_t puRingDocuments = 0;   ///< Documents published into the shared ring.
+    uint64_t puRingDropped = 0;     ///< Documents the shared ring had no room for.
+    double puElapsedSeconds = 0.0;
+
+    double documentsPerHour() const
+    {
+        return puElapsedSeconds > 0.0 ? puDocuments * 3600.0 / puElapsedSeconds : 0.0;
+    }
+};
+
+/// Headless owner of the reader.
+///
+/// Initialises the backend in Non-Blocking mode and forwards every data item, event and
+/// error from the SDK callbacks to the ResultServer and any registered DataConsumer. Data
+/// is handed over as a DataItem borrowing the SDK buffer; it is only copied if somebody
+/// retains it. Nothing on the callback path waits for a client.
+///
+/// With DaemonOptions::puBlocking the daemon runs its own read loop instead; items are then
+/// slices of the BulkFetcher arena, so they are already pinned and are never copied again.
+class ReaderDaemon
+{
+public:
+    ReaderDaemon(std::unique_ptr<ReaderBackend> aBackend, const DaemonOptions &aOptions);
+    ~ReaderDaemon();
+
+    ReaderDaemon(const ReaderDaemon &) = delete;
+    ReaderDaemon &operator=(const ReaderDaemon &) = delete;
+
+    /// Registers \a aConsumer to receive every item on the callback thread. Must be called
+    /// before start(); the consumer must outlive the daemon.
+    void addConsumer(DataConsumer *aConsumer);
+
+    /// Registers \a aConsumer to receive every item on a thread of its own, through the
+    /// daemon's EventBus, so that however slow it is it never holds up the callback thread.
+    /// Must be called before start(); the consumer must outlive the daemon.
+    void addAsyncConsumer(DataConsumer *aConsumer);
+
+    /// Opens the stores, starts serving and initialises the reader. On failure everything
+    /// started so far is stopped again, and the cause is described in \a aError if not null.
+    MMMReaderErrorCode start(std::string *aError);
+
+    /// Brings a daemon started with DaemonOptions::puStandby out of READER_SUSPENDED: it
+    /// connects to the reader and reads any document already on the window.
+    MMMReaderErrorCode activate();
+
+    void stop();
+
+    /// Blocks until \a aCount documents have completed or \a aTimeout expires.
+    bool waitForDocuments(uint64_t aCount, std::chrono::milliseconds aTimeout);
+
+    DaemonStats stats() const;
+
+    ReaderBackend &backend() { return *prBackend; }
+
+private:
+    static void onData(void *aParam, MMMReaderDataType aDataType, int aDataLen, void *aDataPtr);
+    static void onEvent(void *aParam, MMMReaderEventCode aEventCode);
+    static void onError(MMMReaderErrorCode aErrorCode, RTCHAR *aErrorMsg, void *aParam);
+    static bool onCertificate(void *aParam, char *aCertIdentifier, int aCertIdentifierLen, CERT_TYPE aCertType,
+                              char *aCertBuffer, int *aCertBufferLen);
+
+    void handleData(MMMReaderDataType aDataType, int aDataLen, const void *aDataPtr);
+    void dispatchData(const DataItem &aItem);
+    void publishData(const DataItem &aItem);
+    void handleEvent(MMMReaderEventCode aEventCode);
+    void handleError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg);
+
+    void blockingLoop();
+    void publishImage(ConvertedImage &&aImage);
+    void publishImage(EncodedImage &&aImage);
+
+    std::unique_ptr<ReaderBackend> prBackend;
+    ResultServer prServer;
+    std::vector<DataConsumer *> prConsumers;
+    BufferPool prPool;
+    BufferPool *prPoolForLarge;
+    size_t prPoolThreshold;
+    std::unique_ptr<ImageConverter> prConverter;
+    std::unique_ptr<ImageEncoder> prEncoder;
+    EventBus prBus;
+    bool prHasBus = false;
+    const std::string prSharedRingName;
+    const size_t prSharedRingBytes;
+    SharedRingWriter prSharedRing;
+    const std::string prCertificatePath;
+    CertificateStore prCertificates;
+    std::unique_ptr<RevocationCache> prRevocations;
+    const int prRevocationRefreshMs;
+    const std::string prScanner;
+    const bool prStandby;
+    bool prCompactCodelines;
+    bool prBlocking;
+    bool prStarted = false;
+
+    std::thread prBlockingThread;
+    std::atomic<bool> prBlockingRunning{false};
+
+    std::chrono::steady_clock::time_point prStartTime;
+    std::atomic<uint32_t> prCurrentDocument{0};
+    std::atomic<uint64_t> prDocuments{0};
+    std::atomic<uint64_t> prDataItems{0};
+    std::atomic<uint64_t> prDataBytes{0};
+    std::atomic<uint64_t> prPinnedBytes{0};
+    std::atomic<uint64_t> prEvents{0};
+    std::atomic<uint64_t> prErrors{0};
+
+    std::mutex prDocumentMutex;
+    std::condition_variable prDocumentDone;
+};
+
+} // namespace readerd
+
+#endif // READERD_READERDAEMON_H
@@ -0,0 +1,133 @@
+#ifndef READERD_READERSUPERVISOR_H
+#define READERD_READERSUPERVISOR_H
+
+#include "readerd/ResultServer.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/types.h>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+struct SupervisorOptions
+{
+    /// The readerd executable the workers run.
+    std::string puWorkerPath = "readerd";
+    std::string puBackendSpec = "sdk";
+
+    /// Serial number of the reader, for hosts with several; empty for the one the SDK picks.
+    std::string puScanner;
+
+    /// Further arguments for every worker (e.g. --blocking, --compact-codelines).
+    std::vector<std::string> puWorkerArguments;
+
+    /// Keep a second worker initialised with the reader suspended, to take over at once. With
+    /// \c false every failover is a cold start.
+    bool puStandby = true;
+
+    /// A worker whose heartbeats stop for this long is taken for hung.
+    std::chrono::milliseconds puHangTimeout{1000};
+
+    /// A worker that has sent no heartbeat this long after starting is taken for hung.
+    std::chrono::milliseconds puStartTimeout{30000};
+
+    /// The stream clients connect to, as for DaemonOptions.
+    std::string puSocketPath = "/tmp/readerd.sock";
+    ServerFraming puFraming = SF_RECORDS;
+    size_t puClientQueueLimit = 256u * 1024u * 1024u;
+};
+
+struct SupervisorStats
+{
+    uint64_t puDocuments = 0;
+    uint64_t puFailovers = 0;
+    uint64_t puColdStarts = 0;      ///< Failovers with no standby ready to take over.
+    uint64_t puWorkersStarted = 0;
+    double puLastRecoveryMs = 0.0;  ///< From noticing the failure to the new worker reading.
+    double puMaxRecoveryMs = 0.0;
+    pid_t puActivePid = 0;
+    pid_t puStandbyPid = 0;
+    bool puStandbyReady = false;
+};
+
+/// Keeps one reader served by a readerd worker process, with a warm standby to fail over to.
+///
+/// MMMReader_Initialise loads the settings, the plugins and the hardware, which takes
+/// seconds. After a crash, or when MMMReader_Reset would be needed, a restarted process pays
+/// all of that again before the next document. The supervisor starts the standby with
+/// --standby instead. That worker initialises in READER_SUSPENDED, which in the SDK leaves
+/// the physical devices to other processes, with its settings and plugins loaded. When the
+/// active worker exits, stops sending heartbeats or reports READER_FATAL_ERRORED, it is
+/// killed and the standby gets SIGUSR1, which moves its reader to READER_ENABLED. Only the
+/// device connection is left to set up. Then a new standby is started behind it.
+///
+/// Workers stream with SF_DOCUMENTS framing to private sockets, and the active worker's
+/// documents are relayed to the supervisor's own ResultServer, so clients stay connected
+/// across a failover. Document numbers continue in one sequence. A document that was being
+/// read when the worker failed is lost.
+class ReaderSupervisor
+{
+public:
+    explicit ReaderSupervisor(const SupervisorOptions &aOptions);
+    ~ReaderSupervisor();
+
+    ReaderSupervisor(const ReaderSupervisor &) = delete;
+    ReaderSupervisor &operator=(const ReaderSupervisor &) = delete;
+
+    /// Starts the stream and the first worker. On failure describes the cause in \a aError.
+    MMMReaderErrorCode start(std::string *aError);
+
+    /// Stops the workers with SIGTERM and waits for them.
+    void stop();
+
+    /// Fails over as if the active worker had failed: a reset of the reader without a cold
+    /// start when a standby is ready.
+    void requestFailover() { prFailoverRequested = true; }
+
+    /// Blocks until \a aCount documents have been relayed or \a aTimeout expires.
+    bool waitForDocuments(uint64_t aCount, std::chrono::milliseconds aTimeout);
+
+    SupervisorStats stats() const;
+
+private:
+    struct Worker;
+
+    std::unique_ptr<Worker> spawn(bool aStandby, std::string *aError);
+    void retire(std::unique_ptr<Worker> &aWorker, int aSignal);
+    void failover(const std::string &aReason);
+    void readHeartbeats(std::chrono::milliseconds aTimeout);
+    bool hasExited(Worker &aWorker);
+    void monitorLoop();
+    void relayLoop(Worker &aWorker);
+
+    const SupervisorOptions prOptions;
+    ResultServer prServer;
+    std::thread prMonitor;
+    std::atomic<bool> prStopping{false};
+    std::atomic<bool> prFailoverRequested{false};
+    std::atomic<uint32_t> prNextDocument{0};
+    uint32_t prNextWorker = 0;
+
+    // Owned by the monitor thread; the pointers are only swapped under prMutex.
+    std::unique_ptr<Worker> prActive;
+    std::unique_ptr<Worker> prStandby;
+    bool prRecovering = false;
+    std::chrono::steady_clock::time_point prFailoverTime;
+    std::chrono::steady_clock::time_point prRetryTime;
+
+    mutable std::mutex prMutex;
+    std::condition_variable prProgress;
+    std::atomic<uint64_t> prDocuments{0};
+    SupervisorStats prStats;
+};
+
+} // namespace readerd
+
+#endif // READERD_READERSUPERVISOR_H
@@ -0,0 +1,115 @@
+#ifndef READERD_REPLAYENGINE_H
+#define READERD_REPLAYENGINE_H
+
+#include "readerd/DataSlab.h"
+#include "readerd/ReaderBackend.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+class CorpusPack;
+
+struct ReplayOptions
+{
+    /// Backend each worker creates. The simulated backend is told not to present documents
+    /// of its own, so everything it raises comes from the corpus.
+    std::string puBackendSpec = "sim:live=0";
+
+    /// Number of backends replaying in parallel. The SDK keeps one reader per process, so the
+    /// \c sdk backend only supports 1.
+    int puConcurrency = 1;
+
+    /// Documents per second started across all workers; 0 replays as fast as possible.
+    double puRate = 0.0;
+
+    /// Number of passes over the corpus.
+    int puRepeat = 1;
+
+    /// Passed to loadAndProcessFromScanDirectory(); when \c false only events are raised.
+    bool puSendData = true;
+
+    /// How long a document may take to reach END_OF_DOCUMENT_DATA.
+    int puDocumentTimeoutMs = 30000;
+};
+
+/// Timing of one replayed document. Times are microseconds since the start of the run.
+struct ReplayRecord
+{
+    uint32_t puSequence = 0;
+    int puWorker = 0;
+    std::string puDirectory;
+    MMMReaderErrorCode puResult = NO_ERROR_OCCURRED;
+    double puStartUs = 0.0;
+    double puFirstDataUs = 0.0;    ///< 0 if the document raised no data.
+    double puEndUs = 0.0;
+    uint32_t puItems = 0;
+    uint64_t puBytes = 0;
+
+    double latencyUs() const { return puEndUs - puStartUs; }
+};
+
+/// Feeds a corpus of saved scan directories through MMMReader_LoadAndProcessFromScanDirectory()
+/// on one or more backends. Data and events arrive on the same callbacks as a live read and
+/// are handed to the registered DataConsumer objects, so the host side of the pipeline can be
+/// measured repeatably without a scanner.
+class ReplayEngine
+{
+public:
+    explicit ReplayEngine(const ReplayOptions &aOptions);
+
+    /// Registers \a aConsumer to receive every replayed item. With more than one worker it is
+    /// called from several callback threads at once. Must be called before run().
+    void addConsumer(DataConsumer *aConsumer);
+
+    /// Returns the scan directories under \a aRoot in name order, or \a aRoot itself if it
+    /// holds scan files directly.
+    static bool listCorpus(const std::string &aRoot, std::vector<std::string> *aCorpus, std::string *aError);
+
+    /// Replays \a aCorpus ReplayOptions::puRepeat times and blocks until every document has
+    /// completed. Per-document failures are recorded rather than stopping the run.
+    MMMReaderErrorCode run(const std::vector<std::string> &aCorpus, std::string *aError);
+
+    /// As above, replaying the entries of \a aPack through loadAndProcessScan().
+    MMMReaderErrorCode run(const CorpusPack &aPack, std::string *aError);
+
+    /// One record per replayed document, in sequence order.
+    const std::vector<ReplayRecord> &records() const { return prRecords; }
+
+    double elapsedSeconds() const { return prElapsedSeconds; }
+
+    static void writeCsv(std::FILE *aFile, const std::vector<ReplayRecord> &aRecords);
+
+private:
+    struct Worker;
+
+    static void onData(void *aParam, MMMReaderDataType aDataType, int aDataLen, void *aDataPtr);
+    static void onEvent(void *aParam, MMMReaderEventCode aEventCode);
+    static void onError(MMMReaderErrorCode aErrorCode, RTCHAR *aErrorMsg, void *aParam);
+
+    MMMReaderErrorCode runCorpus(size_t aEntries, std::string *aError);
+    /// Shuts down the backend of every worker in \a aWorkers, each of which was initialised.
+    static void shutdownWorkers(std::vector<std::unique_ptr<Worker>> &aWorkers);
+    void workerLoop(Worker &aWorker);
+    double microsecondsSinceStart() const;
+
+    ReplayOptions prOptions;
+    std::vector<DataConsumer *> prConsumers;
+    std::vector<ReplayRecord> prRecords;
+    // The corpus of the current run(): scan directories or a pack.
+    const std::vector<std::string> *prDirectories = nullptr;
+    const CorpusPack *prPack = nullptr;
+    std::atomic<size_t> prNext{0};
+    std::chrono::steady_clock::time_point prStartTime;
+    double prElapsedSeconds = 0.0;
+};
+
+} // namespace readerd
+
+#endif // READERD_REPLAYENGINE_H
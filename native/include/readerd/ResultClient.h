@@ -0,0 +1,66 @@
+#ifndef READERD_RESULTCLIENT_H
+#define READERD_RESULTCLIENT_H
+
+#include "readerd/ResultServer.h"
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// One record of a received frame; the payload points into the frame's buffer.
+struct FrameRecord
+{
+    RecordHeader puHeader;
+    std::span<const uint8_t> puPayload;
+};
+
+/// A frame as received from a ResultServer in SF_DOCUMENTS framing.
+struct Frame
+{
+    FrameHeader puHeader{};
+    std::vector<FrameRecord> puRecords;
+    std::vector<uint8_t> puBytes;   ///< The records as sent; reused by the next readFrame().
+
+    bool isDocument() const { return (puHeader.puFlags & FF_DOCUMENT) != 0; }
+};
+
+/// Reads document frames from a readerd result stream.
+///
+/// The client only ever reads: there is no request or acknowledgement, so receiving a
+/// document costs one frame however many items it holds, and the server keeps streaming the
+/// next document while this one is being handled.
+class ResultClient
+{
+public:
+    ResultClient() = default;
+    ~ResultClient();
+
+    ResultClient(const ResultClient &) = delete;
+    ResultClient &operator=(const ResultClient &) = delete;
+
+    /// Connects to \a aAddress (see SocketAddress::parse()). On failure returns
+    /// ERROR_PARAMETER_INVALID or ERROR_OS_ERROR and describes the cause in \a aError.
+    MMMReaderErrorCode connect(const std::string &aAddress, std::string *aError);
+
+    /// Blocks for the next frame. Returns \c false when the server closes the stream, with
+    /// \a aError left empty, or on a read or protocol error, which it describes.
+    bool readFrame(Frame *aFrame, std::string *aError);
+
+    void close();
+
+    /// Splits \a aBytes, the body of a frame announcing \a aRecords records, into records.
+    /// Returns \c false if the lengths do not add up.
+    static bool parseRecords(std::span<const uint8_t> aBytes, uint32_t aRecords, std::vector<FrameRecord> *aOut);
+
+private:
+    bool readFully(void *aBuffer, size_t aLen, std::string *aError);
+
+    int prFd = -1;
+};
+
+} // namespace readerd
+
+#endif // READERD_RESULTCLIENT_H
@@ -0,0 +1,186 @@
+#ifndef READERD_RESULTSERVER_H
+#define READERD_RESULTSERVER_H
+
+#include "readerd/DataSlab.h"
+#include "readerd/SocketAddress.h"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+/// Kind of record streamed to clients.
+enum RecordKind : uint32_t
+{
+    RK_DATA = 1,    ///< puCode is a MMMReaderDataType, followed by puLength payload bytes.
+    RK_EVENT = 2,   ///< puCode is a MMMReaderEventCode, no payload.
+    RK_ERROR = 3,   ///< puCode is a MMMReaderErrorCode, followed by the error message.
+    RK_IMAGE = 4,   ///< puCode is the MMMReaderDataType of a converted or encoded image; the
+                    ///< payload is an ImageRecordHeader followed by the image.
+    RK_CODELINE = 5,///< puCode is CD_CODELINE_DATA or CD_SCDG1_CODELINE_DATA; the payload is
+                    ///< the MMMReaderCodelineData in the encoding of encodeCodeline().
+    RK_SCANNER = 6  ///< Sent by LaneOrchestrator after each START_OF_DOCUMENT_DATA: puCode is
+                    ///< the lane, the payload the serial number of its reader.
+};
+
+/// Form of the image following an ImageRecordHeader.
+enum ImagePayload : uint32_t
+{
+    IP_PIXELS = 0,  ///< Packed top-down pixels, puChannels bytes each.
+    IP_JPEG = 1,
+    IP_PNG = 2
+};
+
+/// Fixed header preceding every record on the socket, in host byte order.
+struct RecordHeader
+{
+    uint32_t puKind;
+    uint32_t puCode;
+    uint32_t puDocument;    ///< Sequence number of the document the record belongs to.
+    uint32_t puLength;      ///< Number of payload bytes following the header.
+};
+
+/// Leads the payload of an RK_IMAGE record.
+struct ImageRecordHeader
+{
+    uint32_t puWidth;
+    uint32_t puHeight;
+    uint32_t puChannels;    ///< 3 for RGB, 1 for greyscale.
+    uint32_t puPayload;     ///< An ImagePayload.
+};
+
+/// How records are laid out on the stream.
+enum ServerFraming
+{
+    SF_RECORDS,     ///< Each record on its own, as soon as it is published.
+    SF_DOCUMENTS,   ///< Records batched into one length-prefixed frame per document.
+};
+
+/// "RDF1" in a little-endian dump.
+const uint32_t kFrameMagic = 0x31464452;
+const uint16_t kFrameVersion = 1;
+
+enum FrameFlags : uint16_t
+{
+    FF_DOCUMENT = 1,    ///< The frame holds a whole document, START_OF_DOCUMENT_DATA to
+                        ///< END_OF_DOCUMENT_DATA; otherwise it is a single record published
+                        ///< outside of one (DOC_ON_WINDOW, late images, errors between documents),
+                        ///< or part of a document too large for one frame.
+};
+
+/// Largest puLength of a frame. ResultClient refuses larger ones rather than allocate them, and
+/// ResultServer sends a document that would not fit as several frames without FF_DOCUMENT.
+constexpr uint64_t kMaxFrameBytes = 64ull << 20;
+
+/// Leads every frame in SF_DOCUMENTS framing, in host byte order. It is followed by
+/// puRecords records (RecordHeader and payload each), puLength bytes in all.
+struct FrameHeader
+{
+    uint32_t puMagic;
+    uint16_t puVersion;
+    uint16_t puFlags;       ///< FrameFlags.
+    uint32_t puDocument;
+    uint32_t puRecords;
+    uint64_t puLength;
+};
+
+/// Streams records to any number of clients connected to a local (AF_UNIX) or TCP socket.
+///
+/// publish() never blocks on a client: records are queued per client and written by a
+/// single I/O thread. Payloads are queued by reference, so every client shares the same
+/// slab and the bytes go from the slab straight to the socket. A client whose queue grows
+/// beyond the configured limit is disconnected rather than allowed to stall the reader.
+///
+/// With SF_DOCUMENTS framing the records of a document are held back from its
+/// START_OF_DOCUMENT_DATA event and sent as one frame at END_OF_DOCUMENT_DATA, still by
+/// reference. Clients never reply, so a document costs one write however many items it has.
+/// A client that connects in the middle of a document starts with the next one.
+class ResultServer
+{
+public:
+    /// \a aAddress is parsed by SocketAddress::parse().
+    ResultServer(const std::string &aAddress, size_t aClientQueueLimit, ServerFraming aFraming = SF_RECORDS);
+    ~ResultServer();
+
+    ResultServer(const ResultServer &) = delete;
+    ResultServer &operator=(const ResultServer &) = delete;
+
+    /// Binds the socket and starts the I/O thread. On failure returns ERROR_PARAMETER_INVALID
+    /// for a bad address or ERROR_OS_ERROR, and describes the cause in \a aError.
+    MMMReaderErrorCode start(std::string *aError);
+
+    void stop();
+
+    /// Queues one record for every connected client. \a aPayload must hold
+    /// \a aHeader.puLength bytes.
+    void publish(const RecordHeader &aHeader, const DataRef &aPayload);
+
+    /// As above, with the payload in two parts: \a aHeader.puLength must equal their sum.
+    void publish(const RecordHeader &aHeader, const DataRef &aPayloadHead, const DataRef &aPayloadBody);
+
+    /// Cheap check used to avoid pinning data nobody is connected to receive.
+    bool hasClients() const { return prClientCount.load(std::memory_order_relaxed) > 0; }
+
+    size_t clientCount() const;
+
+    /// Number of clients dropped because they could not keep up.
+    uint64_t droppedClients() const { return prDroppedClients.load(); }
+
+private:
+    struct Client
+    {
+        int puFd = -1;
+        std::deque<DataRef> puQueue;
+        size_t puQueuedBytes = 0;
+        size_t puOffset = 0;    ///< Bytes of puQueue.front() already written.
+    };
+
+    /// A document being collected for SF_DOCUMENTS framing.
+    struct Batch
+    {
+        std::vector<DataRef> puChunks;
+        uint32_t puRecords = 0;
+        size_t puBytes = 0;
+        bool puSplit = false;   ///< Part of the document went out already, as it was too large.
+        bool puSkipped = false; ///< Begun with no client connected, so not sent to any.
+    };
+
+    void batchRecord(const RecordHeader &aHeader, const DataRef (&aChunks)[3], size_t aBytes);
+    void sendBatch(uint32_t aDocument, Batch &aBatch, uint16_t aFlags);
+    void enqueue(const DataRef *aChunks, size_t aCount, size_t aBytes);
+    static DataRef frameHeader(uint32_t aDocument, uint16_t aFlags, uint32_t aRecords, size_t aBytes);
+
+    void ioLoop();
+    void acceptClients();
+    bool flushClient(Client &aClient);
+    void wake();
+
+    const std::string prAddressSpec;
+    const size_t prClientQueueLimit;
+    const ServerFraming prFraming;
+    SocketAddress prAddress;
+
+    std::mutex prBatchMutex;
+    std::map<uint32_t, Batch> prBatches;
+
+    int prListenFd = -1;
+    int prWakeFd = -1;
+    std::atomic<bool> prRunning{false};
+    std::thread prThread;
+
+    mutable std::mutex prMutex;
+    std::vector<std::unique_ptr<Client>> prClients;
+    std::atomic<size_t> prClientCount{0};
+    std::atomic<uint64_t> prDroppedClients{0};
+};
+
+} // namespace readerd
+
+#endif // READERD_RESULTSERVER_H
@@ -0,0 +1,148 @@
+#ifndef READERD_REVOCATIONCACHE_H
+#define READERD_REVOCATIONCACHE_H
+
+#include "readerd/ReaderBackend.h"
+
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace readerd {
+
+/// Longest serial number a revocation list entry may have, as the contents of the INTEGER.
+/// RFC 5280 allows 20 octets; some issuers exceed that by a little.
+constexpr size_t kMaxSerialLength = 31;
+
+enum RevocationStatus
+{
+    RS_UNKNOWN,     ///< No revocation list of the issuer is loaded.
+    RS_GOOD,
+    RS_REVOKED,
+    RS_STALE,       ///< Not in the issuer's list, but the list is past its nextUpdate.
+};
+
+const char *revocationStatusName(RevocationStatus aStatus);
+
+/// One serial number, its length first and zero padded, so that serials compare as arrays.
+using RevokedSerial = std::array<uint8_t, kMaxSerialLength + 1>;
+
+/// A parsed X.509 CRL.
+struct RevocationList
+{
+    std::vector<uint8_t> puDer;
+    std::span<const uint8_t> puIssuer;      ///< The DER issuer Name, in puDer.
+    std::string puThisUpdate;               ///< As YYYYMMDDHHMMSSZ, so that they sort.
+    std::string puNextUpdate;               ///< Empty if the list has none.
+    int64_t puNextUpdateTime = 0;           ///< puNextUpdate in seconds since the epoch; 0 if none.
+    std::vector<RevokedSerial> puSerials;   ///< Sorted.
+};
+
+/// Parses the DER CRL \a aDer into \a aList. The signature is not checked. Returns \c false
+/// if it is not a CRL or has a serial number longer than kMaxSerialLength.
+bool parseRevocationList(std::vector<uint8_t> aDer, RevocationList *aList);
+
+/// Where revocation lists are loaded from, in the terms of RFProcessSettings.
+struct RevocationSource
+{
+    std::string puDirectory;            ///< puCertsDir, or where the lists are downloaded to.
+    bool puIncludeSubDirs = false;      ///< puCertsIncludeSubDirs
+    std::string puExtensions = "crl";   ///< DER or PEM ("X509 CRL") files.
+};
+
+struct RevocationRefreshStats
+{
+    uint64_t puFiles = 0;
+    uint64_t puParsed = 0;      ///< New or changed files read.
+    uint64_t puRemoved = 0;     ///< Files gone since the last refresh.
+    uint64_t puSkipped = 0;     ///< Files that hold no list that parses.
+    uint64_t puLists = 0;       ///< Issuers with a list, once all are in.
+    uint64_t puSerials = 0;     ///< Revoked serial numbers in those lists.
+};
+
+/// The revocation lists of the document signer and country signer certificates, parsed once
+/// and held as sorted serial numbers.
+///
+/// With puCheckDSCRevocation or puCheckCSCRevocation the SDK reads and parses the lists again
+/// on every passive authentication. Here each list is parsed when its file first appears or
+/// changes, and a check is a hash lookup of the issuer and a binary search of its serials. Of
+/// several lists of one issuer, the one with the latest thisUpdate is used.
+///
+/// refresh() rereads only the files whose size or modification time changed, and drops the
+/// lists of files that are gone, so a directory the lists of a distribution point are
+/// downloaded into can be watched with startWatching(). Checks keep to the lists of the last
+/// completed refresh, so they never wait for a file to be parsed.
+///
+/// The signatures of the lists are not checked: the directory is trusted, as the SDK's file
+/// store trusts puCertsDir.
+class RevocationCache
+{
+public:
+    explicit RevocationCache(const RevocationSource &aSource);
+    ~RevocationCache();
+
+    RevocationCache(const RevocationCache &) = delete;
+    RevocationCache &operator=(const RevocationCache &) = delete;
+
+    /// Brings the lists up to date with the directory. On failure to list it, returns
+    /// ERROR_READING_FILE, describes the cause in \a aError and keeps the lists it had.
+    MMMReaderErrorCode refresh(RevocationRefreshStats *aStats, std::string *aError);
+
+    /// Calls refresh() every \a aIntervalMs on a thread of its own until stopWatching(). A
+    /// refresh that fails is reported on stderr and retried at the next interval.
+    void startWatching(int aIntervalMs);
+    void stopWatching();
+
+    /// Whether the certificate with DER issuer Name \a aIssuer and serial number \a aSerial
+    /// (the contents of the INTEGER) is revoked. A serial the list lacks is RS_STALE rather
+    /// than RS_GOOD once the list's nextUpdate has passed: a newer list may revoke it.
+    RevocationStatus check(std::span<const uint8_t> aIssuer, std::span<const uint8_t> aSerial) const;
+
+    /// As check(), for a DER IssuerAndSerialNumber.
+    RevocationStatus checkIssuerSerial(std::span<const uint8_t> aIssuerAndSerialNumber) const;
+
+    /// The list of issuer \a aIssuer, which stays valid while it is held; null if there is none.
+    std::shared_ptr<const RevocationList> find(std::span<const uint8_t> aIssuer) const;
+
+    /// Answers a CT_CERTIFICATE_REVOCATION_LIST request of the SDK, a DER
+    /// IssuerAndSerialNumber, with the list of that issuer, following the buffer protocol of
+    /// MMMReaderCertificateCallback.
+    bool provide(const char *aCertIdentifier, int aCertIdentifierLen, char *aCertBuffer, int *aCertBufferLen) const;
+
+private:
+    struct FileState
+    {
+        int64_t puModified = 0;
+        uint64_t puSize = 0;
+        std::vector<std::shared_ptr<const RevocationList>> puLists;
+    };
+
+    /// The newest list of each issuer, by a hash of the issuer Name.
+    using IssuerIndex = std::unordered_multimap<uint64_t, std::shared_ptr<const RevocationList>>;
+
+    void watchLoop(int aIntervalMs);
+
+    const RevocationSource prSource;
+
+    std::mutex prRefreshMutex;                  ///< Held by refresh() throughout.
+    std::map<std::string, FileState> prFiles;   ///< By path.
+
+    mutable std::mutex prMutex;                 ///< Guards prIndex.
+    std::shared_ptr<const IssuerIndex> prIndex;
+
+    std::mutex prWatchMutex;
+    std::condition_variable prWatchWake;
+    bool prWatching = false;
+    std::thread prWatcher;
+};
+
+} // namespace readerd
+
+#endif // READERD_REVOCATIONCACHE_H
@@ -0,0 +1,77 @@
+#ifndef READERD_RFCHIP_H
+#define READERD_RFCHIP_H
+
+#include "MMMReaderHighLevelAPI.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// Largest READ BINARY block that still fits a short APDU response once wrapped for secure
+/// messaging; larger blocks need extended length APDUs.
+constexpr int kMaxShortReadBlock = 224;
+
+/// Abstraction over the RFID chip calls of the low-level API.
+///
+/// The high-level API reads the chip on its own thread and only hands over the results, so
+/// anything that changes how the chip is read (the order of the files, what runs while the
+/// next one is in flight) has to drive the chip itself. Every method mirrors the blocking
+/// form of the MMMReader_RF* function of the same name. As with the SDK, one chip is open at
+/// a time and the methods are called from one thread.
+class RfChip
+{
+public:
+    virtual ~RfChip() = default;
+
+    /// Short name used in logs and statistics ("sdk", "sim").
+    virtual const char *name() const = 0;
+
+    /// Waits up to \a aTimeoutMs for a chip and opens it with the BAC key \a aBacKey (the MRZ
+    /// lines), as MMMReader_RFWaitForOpen.
+    virtual MMMReaderErrorCode waitForOpen(const char *aBacKey, int aTimeoutMs) = 0;
+
+    /// Reads the whole of \a aItem into \a aBytes, as MMMReader_RFGetFile. Returns
+    /// ERROR_RF_DG_NOT_PRESENT for a file the chip does not have.
+    virtual MMMReaderErrorCode getFile(MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes) = 0;
+
+    /// Switches the field off, as MMMReader_RFPowerOff.
+    virtual MMMReaderErrorCode powerOff() = 0;
+
+    /// The identifier of the open chip, as MMMReader_RFGetChipId.
+    virtual MMMReaderErrorCode getChipId(std::string *aId) = 0;
+
+    /// Totals since the chip was opened: the time spent waiting for APDU responses in
+    /// milliseconds, as MMMReader_RFGetChipApduTime, and the bytes read, as
+    /// MMMReader_RFGetChipBytesRead.
+    virtual MMMReaderErrorCode getTransferCounters(int *aApduMs, int *aBytesRead) = 0;
+
+    /// Runs Active Authentication on the open chip, as MMMReader_RFCheckActiveAuthentication,
+    /// and sets \a aResult to the RFID_VC_* outcome: RFID_VC_NOT_PERFORMED for a chip without
+    /// DG15.
+    virtual MMMReaderErrorCode checkActiveAuthentication(int *aResult) = 0;
+
+    /// Bytes requested per READ BINARY APDU by the following reads, as
+    /// RFProcessSettings::puReadBinaryBufferSize. Sizes above kMaxShortReadBlock use extended
+    /// length APDUs.
+    virtual int readBlockSize() const = 0;
+    virtual MMMReaderErrorCode setReadBlockSize(int aBytes) = 0;
+};
+
+/// Creates a chip from a specification of the form \c "name[:key=value,...]", as for
+/// createBackend(). Known names are \c "sim" and, when built with READERD_WITH_SDK, \c "sdk",
+/// which takes \c certs=PATH to serve certificates from a CertificateStore.
+std::unique_ptr<RfChip> createChip(const std::string &aSpec, std::string *aError);
+
+/// The item of data group \a aDataGroup (1 to 16), e.g. RFID_DG2.
+MMMReaderRFItem dataGroupItem(int aDataGroup);
+
+/// The CD_SCDGn_FILE and CD_SCDGn_VALIDATE data types of data group \a aDataGroup.
+MMMReaderDataType dataGroupFileType(int aDataGroup);
+MMMReaderDataType dataGroupValidateType(int aDataGroup);
+
+} // namespace readerd
+
+#endif // READERD_RFCHIP_H
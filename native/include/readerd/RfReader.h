@@ -0,0 +1,118 @@
+#ifndef READERD_RFREADER_H
+#define READERD_RFREADER_H
+
+#include "readerd/BlockSizeTuner.h"
+#include "readerd/BoundedQueue.h"
+#include "readerd/ChipResultCache.h"
+#include "readerd/RevocationCache.h"
+#include "readerd/RfChip.h"
+#include "readerd/SecurityObject.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+struct RfReadOptions
+{
+    /// Data groups to read, in this order; empty for every one EF.COM lists.
+    std::vector<int> puDataGroups;
+
+    /// Check each data group against EF.SOD on the validation thread while the next one is
+    /// read. With \c false each is checked before the next read starts, as reading item by
+    /// item through MMMReader_RFGetFile and MMMReader_RFValidateDataGroup does.
+    bool puPipelined = true;
+
+    /// Data groups read ahead of their validation at most.
+    size_t puQueueDepth = 4;
+
+    /// Tunes the READ BINARY block size to each chip; null reads at the chip's configured
+    /// size. Not owned.
+    BlockSizeTuner *puTuner = nullptr;
+
+    /// Checks the document signer EF.SOD names against these revocation lists; a data group
+    /// that matches its digest is then reported as RFID_VC_VALID_WITH_REVOKED_CERT if the
+    /// signer is revoked. Null for no check. Not owned.
+    const RevocationCache *puRevocations = nullptr;
+
+    /// Serves a chip read in full within the cache's time to live from the cache, after
+    /// reading EF.SOD alone, and stores every chip read in full whose data groups all match.
+    /// Null to read every chip in full. Not owned.
+    ChipResultCache *puCache = nullptr;
+};
+
+struct RfReadStats
+{
+    double puTotalMs = 0.0;
+    double puReadMs = 0.0;      ///< In RfChip::getFile().
+    double puValidateMs = 0.0;  ///< Hashing and comparing, on whichever thread did it.
+    double puDrainMs = 0.0;     ///< Waiting for validation after the last read.
+    uint64_t puBytes = 0;
+    int puDataGroups = 0;
+    int puInvalid = 0;
+    int puBlockSize = 0;        ///< READ BINARY size once the read is done.
+    RevocationStatus puSignerStatus = RS_UNKNOWN;
+    double puRevocationUs = 0.0;
+    bool puCacheHit = false;
+    int puActiveAuthentication = RFID_VC_NOT_PERFORMED;   ///< Only checked before a cache hit.
+};
+
+/// Reads the data groups of an open chip and checks each against the EF.SOD digests.
+///
+/// The chip is a half-duplex link: a data group goes over the air block by block, and the
+/// SDK's MMMReader_RFValidateDataGroup runs only once the group is in. Read item by item, the
+/// chip sits idle while each group is checked. Here EF.SOD is read first, and every data
+/// group is handed to a validation thread as soon as its last block arrives, so that it is
+/// hashed while the chip streams the next one. Only the check of the last group is left
+/// once the chip falls quiet.
+///
+/// Only the digests are compared, and the document signer looked up in the revocation lists:
+/// the EF.SOD signature and its certificate chain are not checked here.
+class RfReader
+{
+public:
+    explicit RfReader(const RfReadOptions &aOptions);
+    ~RfReader();
+
+    RfReader(const RfReader &) = delete;
+    RfReader &operator=(const RfReader &) = delete;
+
+    /// Reads EF.COM, EF.SOD and the data groups from \a aChip, which must be open. The files
+    /// are raised through \a aCallback as for the high-level API: CD_SCEF_COM_FILE,
+    /// CD_SCEF_SOD_FILE, then each CD_SCDGn_FILE followed by its CD_SCDGn_VALIDATE (an int
+    /// RFID_VC_* value), in read order and from one thread at a time. Data groups EF.COM
+    /// lists but the chip lacks are skipped. Returns once every group read has been raised,
+    /// with the chip's error code if a read failed. A chip served from
+    /// RfReadOptions::puCache raises the same items, with only EF.SOD read from it.
+    MMMReaderErrorCode read(RfChip &aChip, MMMReaderHLDataCallback aCallback, void *aParam, RfReadStats *aStats);
+
+private:
+    struct Job
+    {
+        int puDataGroup = 0;
+        std::vector<uint8_t> puBytes;
+    };
+
+    void validate(Job &aJob);
+    void validatorLoop();
+    bool serveCached(RfChip &aChip, const std::vector<uint8_t> &aEfSod, RfReadStats *aStats);
+
+    const RfReadOptions prOptions;
+    BoundedQueue<Job> prJobs;
+    std::thread prValidator;
+
+    // Set up by read() before the first job is queued.
+    SecurityObject prSecurityObject;
+    bool prHaveSecurityObject = false;
+    bool prSignerRevoked = false;
+    std::unique_ptr<CachedChip> prFilling;  ///< The chip being read, for puCache.
+    MMMReaderHLDataCallback prCallback = nullptr;
+    void *prParam = nullptr;
+    RfReadStats *prStats = nullptr;
+};
+
+} // namespace readerd
+
+#endif // READERD_RFREADER_H
@@ -0,0 +1,298 @@
+#ifndef READERD_SCANARCHIVE_H
+#define READERD_SCANARCHIVE_H
+
+#include "readerd/BoundedQueue.h"
+#include "readerd/DataSlab.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+/// Magic of an archive file, "RDAR".
+constexpr uint32_t kArchiveMagic = 0x52414452;
+constexpr uint32_t kArchiveVersion = 1;
+
+/// Leads every archive file.
+struct ArchiveFileHeader
+{
+    uint32_t puMagic;
+    uint32_t puVersion;
+    uint64_t puReserved;
+};
+
+enum ArchiveChunkType
+{
+    AC_BLOBS = 1,       ///< The large payloads of one document, back to back.
+    AC_SEGMENT = 2      ///< Columns of the documents archived since the previous segment.
+};
+
+/// Leads every chunk. puLength counts the bytes after the header and is a multiple of 8.
+struct ArchiveChunkHeader
+{
+    uint32_t puMagic;   ///< "RDCK"
+    uint32_t puType;    ///< ArchiveChunkType
+    uint64_t puLength;
+};
+
+constexpr uint32_t kArchiveChunkMagic = 0x4B434452;
+
+enum ArchiveColumnKind
+{
+    ACK_INT32 = 1,      ///< int32 per row: statuses, validation codes, TRISTATEs.
+    ACK_INT64 = 2,      ///< int64 per row.
+    ACK_STRING = 3,     ///< uint32 offsets[rows + 1], then the characters.
+    ACK_BLOB = 4,       ///< ArchiveBlobRef per row into the AC_BLOBS chunks.
+    ACK_FLOAT32 = 5     ///< float per row: CD_READ_PROGRESS.
+};
+
+/// A column holds one MMMReaderDataType, or one field of a codeline data type: the id is the
+/// data type shifted left by 8, plus 1 + the CodelineField (or CF_STRING_COUNT + 1 for the
+/// CodelineValidationResult) for a field.
+constexpr uint32_t archiveColumnId(MMMReaderDataType aDataType, uint32_t aField = 0)
+{
+    return static_cast<uint32_t>(aDataType) << 8 | aField;
+}
+
+/// Sequence number of the document (ACK_INT64).
+constexpr uint32_t kArchiveDocumentColumn = 0xFFFFFF00u;
+/// Wall clock at START_OF_DOCUMENT_DATA, microseconds since the epoch (ACK_INT64).
+constexpr uint32_t kArchiveTimeColumn = 0xFFFFFF01u;
+
+/// Spelling of a column: the data type name, "CD_CODELINE_DATA.IssuingState" for a field.
+std::string archiveColumnName(uint32_t aColumn);
+
+/// Looks up a column by its spelling. Returns \c false if \a aName is not known.
+bool archiveColumnFromName(const std::string &aName, uint32_t *aColumn);
+
+/// Follows the AC_SEGMENT chunk header: the column directory, sorted by id, then the columns.
+struct ArchiveSegmentHeader
+{
+    uint32_t puRows;
+    uint32_t puColumns;
+};
+
+struct ArchiveColumnEntry
+{
+    uint32_t puId;
+    uint32_t puKind;    ///< ArchiveColumnKind
+    uint64_t puOffset;  ///< From the start of the segment header.
+    uint64_t puLength;
+};
+
+/// Where a blob lives in the file. puOffset is kArchiveNotStored when only the size was kept.
+struct ArchiveBlobRef
+{
+    uint64_t puOffset;
+    uint64_t puLength;
+};
+
+constexpr uint64_t kArchiveNotStored = ~0ull;
+
+struct ArchiveOptions
+{
+    /// Documents per segment. Larger segments make scans cheaper; the documents of a segment
+    /// still being filled are lost if the process dies.
+    uint32_t puSegmentDocuments = 1024;
+
+    /// Keep the bytes of images. Without them image columns record only the size.
+    bool puStoreImages = true;
+
+    /// Completed documents waiting for the writer thread. A document that does not fit is
+    /// dropped rather than holding up the callback thread.
+    size_t puQueueDocuments = 64;
+
+    /// Wait for room in the queue instead of dropping, for replays that a live reader does
+    /// not pace.
+    bool puWaitForWriter = false;
+};
+
+/// Appends every document the reader produces to a columnar archive file.
+///
+/// On the callback thread it only retains items and queues each document at
+/// END_OF_DOCUMENT_DATA. A writer thread appends the document's images, chip files and other
+/// large payloads as one AC_BLOBS chunk straight away. Every puSegmentDocuments documents it
+/// appends an AC_SEGMENT chunk holding one column per data type seen, of the kind that
+/// follows from the type the SDK documents for that data type:
+///
+/// - int and enum items (CD_SECURITYCHECK, CD_SCBAC_STATUS, CD_SCDG*_VALIDATE, ...) as ACK_INT32;
+/// - float items (CD_READ_PROGRESS) as ACK_FLOAT32;
+/// - text items (CD_CODELINE, CD_SCDG1_CODELINE, ...) as ACK_STRING;
+/// - CD_CODELINE_DATA and CD_SCDG1_CODELINE_DATA split into a column per field;
+/// - everything else as ACK_BLOB references into the AC_BLOBS chunks.
+///
+/// An item whose size does not fit the kind of its data type is not archived but counted in
+/// Stats::puMismatched, and the first of each data type is reported on stderr.
+///
+/// A chunk whose write fails is cut off again, so the chunks after it stay readable.
+///
+/// Each column carries a presence bitmap, as most data types are missing from some
+/// documents. When a data type occurs more than once in a document, the last item is kept.
+/// Consumers may be called from several threads at once, as under ReplayEngine.
+class ArchiveWriter : public DataConsumer
+{
+public:
+    struct Stats
+    {
+        uint64_t puDocuments = 0;
+        uint64_t puDropped = 0;     ///< Documents the writer queue had no room for.
+        uint64_t puMismatched = 0;  ///< Items whose size does not fit their column kind.
+        uint64_t puSegments = 0;
+        uint64_t puBytes = 0;       ///< Bytes appended to the file.
+    };
+
+    ArchiveWriter();
+    ~ArchiveWriter() override;
+
+    ArchiveWriter(const ArchiveWriter &) = delete;
+    ArchiveWriter &operator=(const ArchiveWriter &) = delete;
+
+    /// Opens \a aPath for appending, creating it if needed. A torn chunk left at the end by a
+    /// crash is cut off first. On failure returns ERROR_OS_ERROR or ERROR_UNKNOWN_DATA_FORMAT
+    /// and describes the cause in \a aError.
+    MMMReaderErrorCode open(const std::string &aPath, const ArchiveOptions &aOptions, std::string *aError);
+
+    /// Writes the queued documents and the last, partial segment, and closes the file.
+    void close();
+
+    void onData(const DataItem &aItem) override;
+    void onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument) override;
+
+    Stats stats() const;
+
+private:
+    struct Document
+    {
+        uint32_t puSequence = 0;
+        int64_t puTimeUs = 0;
+        std::vector<std::pair<MMMReaderDataType, DataRef>> puItems;
+    };
+    struct Column;
+
+    void writerLoop();
+    void appendDocument(Document &aDocument);
+    void flushSegment();
+    bool append(std::span<const std::span<const uint8_t>> aParts);
+
+    ArchiveOptions prOptions;
+    int prFd = -1;
+    uint64_t prFileSize = 0;
+    bool prFailed = false;      ///< A failed chunk could not be cut off again; nothing is appended.
+
+    std::mutex prOpenMutex;
+    std::map<uint32_t, Document> prOpen;    ///< Documents between START and END, by sequence.
+    std::unique_ptr<BoundedQueue<Document>> prQueue;
+    std::thread prWriter;
+
+    // Writer thread only.
+    std::map<uint32_t, Column> prColumns;
+    uint32_t prRows = 0;
+    std::set<MMMReaderDataType> prMismatchedTypes;  ///< Reported on stderr already.
+
+    mutable std::mutex prStatsMutex;
+    Stats prStats;
+};
+
+/// Typed view of one column of a segment. Rows where the data type was absent read as 0,
+/// an empty string or an empty blob; present() tells them apart.
+class ArchiveColumn
+{
+public:
+    ArchiveColumn() = default;
+
+    uint32_t id() const { return prId; }
+    ArchiveColumnKind kind() const { return prKind; }
+    bool valid() const { return prKind != 0; }
+
+    bool present(uint32_t aRow) const { return prBits && (prBits[aRow / 64] >> (aRow % 64) & 1); }
+
+    /// ACK_INT32 and ACK_INT64 values.
+    int64_t integer(uint32_t aRow) const;
+
+    /// ACK_FLOAT32 values.
+    float real(uint32_t aRow) const;
+
+    /// ACK_STRING values.
+    std::string_view string(uint32_t aRow) const;
+
+    /// ACK_BLOB values; empty when the bytes were not stored.
+    std::span<const uint8_t> blob(uint32_t aRow) const;
+    uint64_t blobSize(uint32_t aRow) const;
+
+private:
+    friend class ArchiveSegment;
+
+    uint32_t prId = 0;
+    ArchiveColumnKind prKind = static_cast<ArchiveColumnKind>(0);
+    uint32_t prRows = 0;
+    const uint64_t *prBits = nullptr;
+    const uint8_t *prValues = nullptr;
+    const uint8_t *prFile = nullptr;
+    uint64_t prFileSize = 0;
+};
+
+/// One segment of a mapped archive.
+class ArchiveSegment
+{
+public:
+    uint32_t rows() const { return prHeader->puRows; }
+
+    std::span<const ArchiveColumnEntry> columns() const
+    {
+        return std::span<const ArchiveColumnEntry>(prEntries, prHeader->puColumns);
+    }
+
+    /// The column \a aId; not valid() when no document of the segment had it.
+    ArchiveColumn column(uint32_t aId) const;
+
+private:
+    friend class ArchiveReader;
+
+    /// Whether every column of the directory lies within the segment's \a aLength bytes.
+    bool validate(uint64_t aLength) const;
+
+    const ArchiveSegmentHeader *prHeader = nullptr;
+    const ArchiveColumnEntry *prEntries = nullptr;
+    const uint8_t *prFile = nullptr;
+    uint64_t prFileSize = 0;
+};
+
+/// Maps an archive read-only. Only the chunk headers are read up front; the pages of a
+/// column are touched when a query reads it, so a scan of two columns reads two columns.
+class ArchiveReader
+{
+public:
+    ArchiveReader() = default;
+    ~ArchiveReader();
+
+    ArchiveReader(const ArchiveReader &) = delete;
+    ArchiveReader &operator=(const ArchiveReader &) = delete;
+
+    /// On failure returns ERROR_OS_ERROR or ERROR_UNKNOWN_DATA_FORMAT and describes the cause
+    /// in \a aError. A torn chunk at the end (a writer still running, or one that crashed)
+    /// ends the archive.
+    MMMReaderErrorCode open(const std::string &aPath, std::string *aError);
+
+    void close();
+
+    const std::vector<ArchiveSegment> &segments() const { return prSegments; }
+
+    uint64_t documents() const;
+
+private:
+    const uint8_t *prData = nullptr;
+    size_t prSize = 0;
+    std::vector<ArchiveSegment> prSegments;
+};
+
+} // namespace readerd
+
+#endif // READERD_SCANARCHIVE_H
@@ -0,0 +1,48 @@
+#ifndef READERD_SDKBACKEND_H
+#define READERD_SDKBACKEND_H
+
+#include "readerd/ReaderBackend.h"
+
+namespace readerd {
+
+/// Pass-through to the MMMReaderHighLevelAPI library.
+///
+/// The high-level API keeps a single global reader state, so only one instance may be
+/// initialised per process.
+class SdkBackend : public ReaderBackend
+{
+public:
+    ~SdkBackend() override;
+
+    const char *name() const override { return "sdk"; }
+
+    MMMReaderErrorCode initialise(
+        MMMReaderHLDataCallback aDataCallback,
+        MMMReaderEventCallback aEventCallback,
+        MMMReaderErrorCallback aErrorCallback,
+        MMMReaderCertificateCallback aCertCallback,
+        void *aParam) override;
+    MMMReaderErrorCode shutdown() override;
+    MMMReaderErrorCode reset() override;
+    ReaderState getState() override;
+    MMMReaderErrorCode setState(ReaderState aNewState, bool aForceRedetect) override;
+    bool isDocumentOnWindow() override;
+    MMMReaderErrorCode waitForDocumentOnWindow(int aTimeout) override;
+    MMMReaderErrorCode readDocument() override;
+    MMMReaderErrorCode getData(
+        MMMReaderDataType aDataType,
+        void *aDataPtr,
+        int *aDataLen,
+        int aIndex) override;
+    MMMReaderErrorCode getDataCount(MMMReaderDataType aDataType, int *aItemCount) override;
+    MMMReaderErrorCode clearData() override;
+    MMMReaderErrorCode getConnectedScanners(std::vector<std::string> *aSerialNumbers) override;
+    MMMReaderErrorCode selectScanner(const char *aSerialNumber) override;
+    MMMReaderErrorCode loadSettings(MMMReaderSettings *aSettings, const char *aIniPath) override;
+    std::string settingsVersion() override;
+    MMMReaderErrorCode loadAndProcessFromScanDirectory(const char *aDirectoryPath, bool aSendDataFlag) override;
+};
+
+} // namespace readerd
+
+#endif // READERD_SDKBACKEND_H
@@ -0,0 +1,47 @@
+#ifndef READERD_SDKRFCHIP_H
+#define READERD_SDKRFCHIP_H
+
+#include "readerd/CertificateStore.h"
+#include "readerd/RfChip.h"
+
+#include <memory>
+
+namespace readerd {
+
+/// Pass-through to the RF calls of the MMMReaderLowLevelAPI library.
+///
+/// The RF layer is initialised on the first waitForOpen() with the RFIDSettings that
+/// MMMReader_LL_LoadSettings resolves, and shut down with the chip. Like the high-level
+/// API it keeps global state, so only one instance may exist per process, and not beside an
+/// initialised SdkBackend.
+///
+/// Once setReadBlockSize() is called the SDK no longer takes the size from EF.ATR. Given a
+/// CertificateStore, the SDK gets the external document signer and country signer
+/// certificates from it through the certificate callback instead of scanning puCertsDir.
+class SdkRfChip : public RfChip
+{
+public:
+    explicit SdkRfChip(std::unique_ptr<CertificateStore> aCertificates = nullptr);
+    ~SdkRfChip() override;
+
+    const char *name() const override { return "sdk"; }
+
+    MMMReaderErrorCode waitForOpen(const char *aBacKey, int aTimeoutMs) override;
+    MMMReaderErrorCode getFile(MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes) override;
+    MMMReaderErrorCode powerOff() override;
+    MMMReaderErrorCode getChipId(std::string *aId) override;
+    MMMReaderErrorCode getTransferCounters(int *aApduMs, int *aBytesRead) override;
+    MMMReaderErrorCode checkActiveAuthentication(int *aResult) override;
+    int readBlockSize() const override;
+    MMMReaderErrorCode setReadBlockSize(int aBytes) override;
+
+private:
+    std::unique_ptr<CertificateStore> prCertificates;
+    std::unique_ptr<MMMReaderSettings> prSettings;
+    bool prInitialised = false;
+    int prBlockSize = 0;    ///< Set before initialisation; 0 keeps the INI value.
+};
+
+} // namespace readerd
+
+#endif // READERD_SDKRFCHIP_H
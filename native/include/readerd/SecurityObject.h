@@ -0,0 +1,71 @@
+#ifndef READERD_SECURITYOBJECT_H
+#define READERD_SECURITYOBJECT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace readerd {
+
+enum DigestAlgorithm
+{
+    DA_NONE,
+    DA_SHA1,
+    DA_SHA224,
+    DA_SHA256,
+    DA_SHA384,
+    DA_SHA512,
+};
+
+const char *digestAlgorithmName(DigestAlgorithm aAlgorithm);
+
+/// Whether this build can compute digests: they come from libcrypto, which is optional.
+bool digestSupported();
+
+/// Replaces \a aDigest with the digest of \a aData. Returns \c false if the algorithm is not
+/// supported.
+bool computeDigest(DigestAlgorithm aAlgorithm, std::span<const uint8_t> aData, std::vector<uint8_t> *aDigest);
+
+/// Highest data group number of the LDS.
+constexpr int kMaxDataGroup = 16;
+
+/// The Document Security Object of an ePassport, the LDSSecurityObject signed into EF.SOD:
+/// the digest of every data group on the chip, which passive authentication checks the data
+/// groups against.
+struct SecurityObject
+{
+    DigestAlgorithm puAlgorithm = DA_NONE;
+
+    /// Indexed by data group number; empty for data groups the object has no digest of.
+    std::array<std::vector<uint8_t>, kMaxDataGroup + 1> puDigests;
+
+    /// The document signer certificate named by the first SignerInfo: its DER issuer Name and
+    /// its serial number, as the contents of the INTEGER. A signer named by key identifier is
+    /// looked up among the certificates in EF.SOD. Empty if there is none.
+    std::vector<uint8_t> puSignerIssuer;
+    std::vector<uint8_t> puSignerSerial;
+};
+
+/// Parses the LDSSecurityObject out of the EF.SOD file \a aEfSod (tag 0x77 around a CMS
+/// SignedData). The signature is not checked. Returns \c false if \a aEfSod is not an EF.SOD.
+bool parseEfSod(std::span<const uint8_t> aEfSod, SecurityObject *aObject);
+
+/// Encodes \a aObject as an EF.SOD, as a chip simulation needs it. Given the DER certificate
+/// \a aSigner, it is included and named by a SignerInfo, whose signature is left empty.
+std::vector<uint8_t> buildEfSod(const SecurityObject &aObject, std::span<const uint8_t> aSigner = {});
+
+/// Replaces \a aDataGroups with the numbers of the data groups listed in the EF.COM file
+/// \a aEfCom, in the listed order. Returns \c false if \a aEfCom is not an EF.COM.
+bool parseEfCom(std::span<const uint8_t> aEfCom, std::vector<int> *aDataGroups);
+
+/// Encodes an EF.COM listing \a aDataGroups.
+std::vector<uint8_t> buildEfCom(const std::vector<int> &aDataGroups);
+
+/// The tag a data group file starts with (0x61 for DG1, 0x75 for DG2), or 0.
+uint8_t dataGroupTag(int aDataGroup);
+
+} // namespace readerd
+
+#endif // READERD_SECURITYOBJECT_H
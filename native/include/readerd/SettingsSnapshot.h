@@ -0,0 +1,124 @@
+#ifndef READERD_SETTINGSSNAPSHOT_H
+#define READERD_SETTINGSSNAPSHOT_H
+
+#include "readerd/ReaderBackend.h"
+
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// Magic of a settings snapshot, "RDSS".
+constexpr uint32_t kSettingsSnapshotMagic = 0x53534452;
+constexpr uint32_t kSettingsSnapshotVersion = 1;
+
+/// Marks a directory member that was a null pointer.
+constexpr uint32_t kNoSettingsDirectory = 0xFFFFFFFFu;
+
+/// What a snapshot was resolved from. A snapshot is used only while all of it is unchanged.
+struct SettingsKey
+{
+    uint64_t puFilesHash = 0;       ///< Of the path, size and contents of every INI file read.
+    uint32_t puFiles = 0;
+    char puSdkVersion[32] = {};     ///< ReaderBackend::settingsVersion(), truncated.
+};
+
+/// Leads a settings snapshot. The MMMReaderSettings follows at kSettingsSnapshotBody with its
+/// directory members zeroed, then the directory names, each NUL-terminated.
+struct SettingsSnapshotHeader
+{
+    uint32_t puMagic;               ///< Written last, so an interrupted snapshot is never opened.
+    uint32_t puVersion;
+    uint32_t puSettingsSize;        ///< sizeof(MMMReaderSettings) when written.
+    uint32_t puFiles;
+    uint64_t puFilesHash;
+    char puSdkVersion[32];
+    uint64_t puLength;              ///< Of the whole file.
+    uint64_t puChecksum;            ///< FNV-1a of everything after the header.
+    uint32_t puDirectories[std::size(kSettingsDirectories)];   ///< Offsets into the names.
+};
+
+constexpr uint64_t kSettingsSnapshotBody = 128;
+static_assert(sizeof(SettingsSnapshotHeader) <= kSettingsSnapshotBody);
+
+/// Where the settings come from, and where their snapshot is kept.
+struct SettingsSource
+{
+    /// Location file for MMMReader_LL_LoadSettingsFromIniFile; empty for the MMMReader.ini
+    /// in the SDK binaries folder.
+    std::string puIniPath;
+
+    std::string puSnapshotPath;
+
+    /// Folders whose INI files the settings also depend on, beyond the Config folder.
+    std::vector<std::string> puWatchDirectories;
+};
+
+/// How loadSettingsCached() got the settings.
+struct SettingsLoadResult
+{
+    bool puFromSnapshot = false;
+    bool puSnapshotWritten = false;
+    std::string puMissReason;       ///< Why the snapshot was not used.
+};
+
+/// A fully resolved MMMReaderSettings, saved once and mapped on later starts.
+///
+/// MMMReader_LL_LoadSettings parses the location file, every INI file in the Config folder
+/// and those of the plugins into the settings structure on every start. When none of those
+/// files has changed, the structure it produces is the same, so a snapshot of it can be
+/// mapped instead: one open, one mmap and a checksum. The directory members are saved as
+/// names and pointed into the mapping when it is opened.
+///
+/// The key covers the INI files and the settings parser, not calibration kept in the reader
+/// itself, so a snapshot should not be shared between readers.
+class SettingsSnapshot
+{
+public:
+    SettingsSnapshot() = default;
+    ~SettingsSnapshot();
+
+    SettingsSnapshot(const SettingsSnapshot &) = delete;
+    SettingsSnapshot &operator=(const SettingsSnapshot &) = delete;
+
+    /// Saves \a aSettings under \a aKey to \a aPath, replacing any snapshot there at once. On
+    /// failure returns ERROR_WRITING_FILE and describes the cause in \a aError.
+    static MMMReaderErrorCode write(const MMMReaderSettings &aSettings, const SettingsKey &aKey,
+                                    const std::string &aPath, std::string *aError);
+
+    /// On failure returns ERROR_OS_ERROR or ERROR_UNKNOWN_DATA_FORMAT and describes the cause
+    /// in \a aError.
+    MMMReaderErrorCode open(const std::string &aPath, std::string *aError);
+
+    void close();
+
+    bool matches(const SettingsKey &aKey) const;
+
+    /// The saved settings, with their directories valid until close().
+    const MMMReaderSettings &settings() const { return *prSettings; }
+
+private:
+    uint8_t *prData = nullptr;
+    size_t prSize = 0;
+    const MMMReaderSettings *prSettings = nullptr;
+};
+
+/// Computes the key of \a aSettings, read through \a aSource by a parser of \a aSdkVersion:
+/// the location file, the INI files in the Config folder and in every watched folder. On
+/// failure returns ERROR_READING_FILE and describes the cause in \a aError.
+MMMReaderErrorCode settingsKey(const MMMReaderSettings &aSettings, const SettingsSource &aSource,
+                               const std::string &aSdkVersion, SettingsKey *aKey, std::string *aError);
+
+/// Loads the settings from the snapshot at \a aSource when it matches, otherwise parses them
+/// through \a aBackend and saves a new snapshot. On a hit the directories point into
+/// \a aSnapshot, on a miss into \a aBackend. Fails only when parsing does, with the backend's
+/// error code; a snapshot that cannot be saved is reported on stderr.
+MMMReaderErrorCode loadSettingsCached(ReaderBackend &aBackend, const SettingsSource &aSource,
+                                      SettingsSnapshot *aSnapshot, MMMReaderSettings *aSettings,
+                                      SettingsLoadResult *aResult);
+
+} // namespace readerd
+
+#endif // READERD_SETTINGSSNAPSHOT_H
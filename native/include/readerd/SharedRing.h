@@ -0,0 +1,135 @@
+#ifndef READERD_SHAREDRING_H
+#define READERD_SHAREDRING_H
+
+#include "readerd/DataSlab.h"
+#include "readerd/ResultClient.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// Control block at the start of a shared ring, followed by puCapacity bytes of records.
+///
+/// The ring holds whole documents as a run of records, each a RecordHeader and its payload
+/// padded to 8 bytes, from START_OF_DOCUMENT_DATA to END_OF_DOCUMENT_DATA. A record never
+/// wraps: when one does not fit before the end of the ring, a record of kind 0 (or a tail
+/// shorter than a RecordHeader) pads to the end. Positions are byte counts that only grow.
+struct SharedRingHeader
+{
+    uint32_t puMagic;
+    uint32_t puVersion;
+    uint64_t puCapacity;
+
+    alignas(64) std::atomic<uint64_t> puHead;     ///< End of the last committed document.
+    std::atomic<uint32_t> puSequence;             ///< Bumped per commit; the futex word.
+    std::atomic<uint32_t> puWaiters;              ///< Readers blocked on puSequence.
+    std::atomic<uint32_t> puClosed;               ///< Set when the writer goes away.
+
+    alignas(64) std::atomic<uint64_t> puTail;     ///< Start of the oldest unread document.
+    std::atomic<uint32_t> puReaderPid;            ///< Attached reader, 0 if none.
+};
+
+/// Publishes each document into a POSIX shared-memory ring for a reader on the same host.
+///
+/// Registered as a DataConsumer, it copies each item straight from the SDK buffer (or the
+/// BulkFetcher arena) into the mapping, so the reader sees the bytes in place: no socket,
+/// no kernel copy and no retained slab. A document becomes visible to the reader all at once
+/// at END_OF_DOCUMENT_DATA, and the reader is woken through a futex in the control block.
+///
+/// Nothing waits for the reader. A document that does not fit in the free space is dropped
+/// and counted, and documents are not written at all while no reader is attached. A reader
+/// that exited without detaching is found when the ring fills, and detached.
+class SharedRingWriter : public DataConsumer
+{
+public:
+    struct Stats
+    {
+        uint64_t puDocuments = 0;
+        uint64_t puDropped = 0;
+        uint64_t puBytes = 0;
+    };
+
+    SharedRingWriter() = default;
+    ~SharedRingWriter() override;
+
+    SharedRingWriter(const SharedRingWriter &) = delete;
+    SharedRingWriter &operator=(const SharedRingWriter &) = delete;
+
+    /// Creates (replacing any stale one) the shared memory object \a aName, e.g. "/readerd",
+    /// with room for \a aCapacity bytes of records. On failure returns ERROR_OS_ERROR and
+    /// describes the cause in \a aError.
+    MMMReaderErrorCode create(const std::string &aName, size_t aCapacity, std::string *aError);
+
+    /// Marks the ring closed, wakes the reader and removes the shared memory object.
+    void close();
+
+    void onData(const DataItem &aItem) override;
+    void onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument) override;
+    void onError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg, uint32_t aDocument) override;
+
+    Stats stats() const;
+
+private:
+    void write(uint32_t aKind, uint32_t aCode, uint32_t aDocument, std::span<const uint8_t> aPayload);
+
+    /// Whether the attached reader's process is gone; if so, detaches it and frees the ring.
+    bool readerGone();
+
+    std::string prName;
+    SharedRingHeader *prHeader = nullptr;
+    uint8_t *prData = nullptr;
+    size_t prMappedBytes = 0;
+
+    mutable std::mutex prMutex;
+    bool prInDocument = false;      ///< Writing a document a reader will see.
+    uint64_t prReserve = 0;         ///< Write position within the uncommitted document.
+    Stats prStats;
+};
+
+/// A document read from a shared ring. The payloads point into the shared mapping and stay
+/// valid until the next call to SharedRingReader::next().
+struct SharedDocument
+{
+    uint32_t puDocument = 0;
+    std::vector<FrameRecord> puRecords;
+};
+
+/// Attaches to a SharedRingWriter's ring from another process.
+class SharedRingReader
+{
+public:
+    SharedRingReader() = default;
+    ~SharedRingReader();
+
+    SharedRingReader(const SharedRingReader &) = delete;
+    SharedRingReader &operator=(const SharedRingReader &) = delete;
+
+    /// Maps the ring \a aName and starts from its next document. On failure returns
+    /// ERROR_OS_ERROR or ERROR_UNKNOWN_DATA_FORMAT and describes the cause in \a aError.
+    MMMReaderErrorCode open(const std::string &aName, std::string *aError);
+
+    void close();
+
+    /// Releases the previous document back to the writer and waits up to \a aTimeout for the
+    /// next. Returns \c false on timeout or once the writer has closed the ring; closed()
+    /// tells the two apart.
+    bool next(SharedDocument *aDocument, std::chrono::milliseconds aTimeout);
+
+    bool closed() const;
+
+private:
+    SharedRingHeader *prHeader = nullptr;
+    const uint8_t *prData = nullptr;
+    size_t prMappedBytes = 0;
+    uint64_t prNext = 0;    ///< Position just past the document handed out last.
+};
+
+} // namespace readerd
+
+#endif // READERD_SHAREDRING_H
@@ -0,0 +1,178 @@
+#ifndef READERD_SIMULATEDBACKEND_H
+#define READERD_SIMULATEDBACKEND_H
+
+#include "readerd/ReaderBackend.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace readerd {
+
+/// Settings for the simulated reader. Stage delays are in microseconds and default to zero,
+/// so that the backend measures the cost of the host application rather than the hardware.
+struct SimulatedOptions
+{
+    /// Number of documents to present before the window stays empty; 0 means unlimited.
+    int puDocumentCount = 0;
+
+    /// Whether documents appear on the window by themselves. Turned off for replay, where
+    /// every document comes from loadAndProcessFromScanDirectory().
+    bool puLive = true;
+
+    /// Dimensions of the full-page BMP images returned for each light source.
+    int puImageWidth = 1600;
+    int puImageHeight = 1100;
+
+    /// Whether the UV image and the RF chip data groups are part of each document.
+    bool puCaptureUV = true;
+    bool puReadRF = true;
+
+    /// Size of the DG2 (face) file returned from the simulated chip.
+    int puDG2Size = 24 * 1024;
+
+    /// Readers reported by getConnectedScanners(), with serial numbers SIM00001 and up.
+    int puScannerCount = 1;
+
+    /// Time taken by MMMReader_Initialise() before SETTINGS_INITIALISED is raised.
+    int puInitialiseDelayMs = 0;
+
+    /// Time taken by loadSettings() to parse the configuration files.
+    int puSettingsDelayMs = 0;
+
+    int puDetectUs = 0;
+    int puCaptureUs = 0;
+    int puOcrUs = 0;
+    int puRfGroupUs = 0;
+    int puGapUs = 0;
+
+    /// Parses a comma separated \c key=value list, e.g. \c "docs=100,width=800,rf=0".
+    static bool parse(const std::string &aSpec, SimulatedOptions *aOptions, std::string *aError);
+};
+
+/// A stand-in for the hardware DLL that produces well-formed documents: a TD3 codeline with
+/// valid check digits, full-page BMP images per light source and a set of RF data groups,
+/// delivered with the same event ordering as the high-level API.
+class SimulatedBackend : public ReaderBackend
+{
+public:
+    explicit SimulatedBackend(const SimulatedOptions &aOptions);
+    ~SimulatedBackend() override;
+
+    const char *name() const override { return "sim"; }
+
+    MMMReaderErrorCode initialise(
+        MMMReaderHLDataCallback aDataCallback,
+        MMMReaderEventCallback aEventCallback,
+        MMMReaderErrorCallback aErrorCallback,
+        MMMReaderCertificateCallback aCertCallback,
+        void *aParam) override;
+    MMMReaderErrorCode shutdown() override;
+    MMMReaderErrorCode reset() override;
+    ReaderState getState() override;
+    MMMReaderErrorCode setState(ReaderState aNewState, bool aForceRedetect) override;
+    bool isDocumentOnWindow() override;
+    MMMReaderErrorCode waitForDocumentOnWindow(int aTimeout) override;
+    MMMReaderErrorCode readDocument() override;
+    MMMReaderErrorCode getData(
+        MMMReaderDataType aDataType,
+        void *aDataPtr,
+        int *aDataLen,
+        int aIndex) override;
+    MMMReaderErrorCode getDataCount(MMMReaderDataType aDataType, int *aItemCount) override;
+    MMMReaderErrorCode clearData() override;
+    MMMReaderErrorCode getConnectedScanners(std::vector<std::string> *aSerialNumbers) override;
+    MMMReaderErrorCode selectScanner(const char *aSerialNumber) override;
+    MMMReaderErrorCode loadSettings(MMMReaderSettings *aSettings, const char *aIniPath) override;
+    std::string settingsVersion() override;
+
+    /// Replays a directory holding one file per data item, named after the data type with an
+    /// optional index and any extension (\c CD_IMAGEVIS.bmp, \c CD_SCDG2_FILE.0.bin). Items
+    /// are raised in data type order, with the OCR delay spent before \c CD_CODELINE.
+    MMMReaderErrorCode loadAndProcessFromScanDirectory(const char *aDirectoryPath, bool aSendDataFlag) override;
+
+    /// Replays files named as for loadAndProcessFromScanDirectory() straight from memory:
+    /// the data callback gets pointers into \a aFiles, so nothing is read or copied.
+    MMMReaderErrorCode loadAndProcessScan(std::span<const ScanFile> aFiles, bool aSendDataFlag) override;
+
+    /// Number of documents presented since initialise().
+    int documentsPresented() const { return prDocumentsPresented.load(); }
+
+private:
+    /// The bytes of an item. Built items own a vector behind the pointer; replayed scans in
+    /// memory are views that own nothing.
+    using Payload = std::shared_ptr<const std::span<const uint8_t>>;
+
+    struct Step
+    {
+        int puDelayUs = 0;
+        bool puIsEvent = false;
+        MMMReaderEventCode puEvent = DOC_ON_WINDOW;
+        MMMReaderDataType puDataType = CD_CODELINE;
+        Payload puPayload;
+    };
+
+    struct StoredItem
+    {
+        MMMReaderDataType puDataType;
+        Payload puPayload;
+    };
+
+    struct ScanItem
+    {
+        MMMReaderDataType puDataType;
+        int puIndex;
+        Payload puPayload;
+    };
+
+    void buildSharedPayloads();
+    void buildDocument(int aSerial, std::vector<Step> *aSteps) const;
+    void runDocument(const std::vector<Step> &aSteps, bool aDeliverEvents, bool aDeliverData);
+    MMMReaderErrorCode checkCanLoad();
+    void processScan(std::vector<ScanItem> &aItems, bool aSendDataFlag);
+    bool moreDocuments() const;
+    void workerLoop();
+    void changeState(ReaderState aNewState);
+    void raiseEvent(MMMReaderEventCode aEvent);
+    bool sleepUnlessStopped(int aMicroseconds);
+
+    SimulatedOptions prOptions;
+
+    MMMReaderHLDataCallback prDataCallback = nullptr;
+    MMMReaderEventCallback prEventCallback = nullptr;
+    MMMReaderErrorCallback prErrorCallback = nullptr;
+    void *prParam = nullptr;
+
+    Payload prImageIR;
+    Payload prImageVIS;
+    Payload prImageUV;
+    Payload prImagePhoto;
+    Payload prEFCom;
+    Payload prEFSod;
+    Payload prDG2;
+
+    std::mutex prMutex;
+    std::condition_variable prWakeup;
+    std::thread prWorker;
+    bool prStopping = false;
+    bool prInitialised = false;
+    bool prDocumentPending = false;
+    std::atomic<ReaderState> prState{READER_NOT_INITIALISED};
+    ReaderState prStartupState = READER_ENABLED;    ///< As set by setState() before initialise().
+    std::atomic<int> prDocumentsPresented{0};
+
+    std::vector<StoredItem> prStore;
+
+    /// The directories loadSettings() points the settings at.
+    std::vector<std::string> prSettingsDirectories;
+};
+
+} // namespace readerd
+
+#endif // READERD_SIMULATEDBACKEND_H
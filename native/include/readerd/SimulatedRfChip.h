@@ -0,0 +1,92 @@
+#ifndef READERD_SIMULATEDRFCHIP_H
+#define READERD_SIMULATEDRFCHIP_H
+
+#include "readerd/RfChip.h"
+#include "readerd/SecurityObject.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace readerd {
+
+/// Settings for the simulated chip. As for SimulatedOptions, the delays default to zero.
+struct SimulatedChipOptions
+{
+    /// Sizes of the data group files on the chip; 0 leaves a data group out. DG1 always holds
+    /// a TD3 MRZ.
+    int puDG2Size = 24 * 1024;
+    int puDG3Size = 0;
+    int puDG14Size = 0;
+
+    /// A data group whose contents do not match the EF.SOD digest, for testing; 0 for none.
+    int puTamperedGroup = 0;
+
+    /// Bytes requested per READ BINARY APDU until setReadBlockSize() is called.
+    int puBlockSize = 224;
+
+    /// Largest block the chip answers; a READ BINARY for more fails, as on chips without
+    /// extended length support. 0 for no limit.
+    int puMaxBlock = 0;
+
+    /// Turnaround of one APDU, the extra turnaround of an extended length one, and the
+    /// over-the-air rate in kbit/s (0 for no transfer time).
+    int puApduUs = 0;
+    int puExtendedApduUs = 0;
+    int puKbps = 0;
+
+    /// Active Authentication: 0 for a chip without it, 1 for one that passes it and 2 for
+    /// one that fails it, as a chip carrying copied files would. With 1 or 2 the chip has a
+    /// DG15. The check takes puActiveAuthUs.
+    int puActiveAuth = 0;
+    int puActiveAuthUs = 0;
+
+    /// Reported by getChipId(), as a decimal number.
+    int puChipId = 1;
+
+    /// Time taken to open the chip and establish BAC.
+    int puOpenUs = 0;
+
+    /// DER document signer certificate EF.SOD names, read from the file given as \c signer;
+    /// empty for an EF.SOD without a signer.
+    std::vector<uint8_t> puSigner;
+
+    /// Parses a comma separated \c key=value list, e.g. \c "dg2=30000,apdu_us=4000,kbps=424".
+    static bool parse(const std::string &aSpec, SimulatedChipOptions *aOptions, std::string *aError);
+};
+
+/// A chip that holds an EF.COM, an EF.SOD with the SHA-256 digests of its data groups, and
+/// data groups of the configured sizes, read in READ BINARY blocks with the configured
+/// timing. The EF.SOD is not signed, though it may name a signer.
+class SimulatedRfChip : public RfChip
+{
+public:
+    explicit SimulatedRfChip(const SimulatedChipOptions &aOptions);
+
+    const char *name() const override { return "sim"; }
+
+    MMMReaderErrorCode waitForOpen(const char *aBacKey, int aTimeoutMs) override;
+    MMMReaderErrorCode getFile(MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes) override;
+    MMMReaderErrorCode powerOff() override;
+    MMMReaderErrorCode getChipId(std::string *aId) override;
+    MMMReaderErrorCode getTransferCounters(int *aApduMs, int *aBytesRead) override;
+    MMMReaderErrorCode checkActiveAuthentication(int *aResult) override;
+    int readBlockSize() const override { return prBlockSize; }
+    MMMReaderErrorCode setReadBlockSize(int aBytes) override;
+
+private:
+    bool transfer(size_t aBytes);
+
+    SimulatedChipOptions prOptions;
+    bool prOpen = false;
+    int prBlockSize;
+    int64_t prApduUs = 0;
+    int64_t prBytesRead = 0;
+    std::vector<uint8_t> prEfCom;
+    std::vector<uint8_t> prEfSod;
+    std::array<std::vector<uint8_t>, kMaxDataGroup + 1> prDataGroups;
+};
+
+} // namespace readerd
+
+#endif // READERD_SIMULATEDRFCHIP_H
@@ -0,0 +1,28 @@
+#ifndef READERD_SOCKETADDRESS_H
+#define READERD_SOCKETADDRESS_H
+
+#include <string>
+
+#include <sys/socket.h>
+
+namespace readerd {
+
+/// Endpoint the result stream is served on: an AF_UNIX socket path, or \c tcp:HOST:PORT for
+/// consumers on another machine (HOST may be a dotted address, \c * or \c localhost).
+struct SocketAddress
+{
+    sockaddr_storage puStorage{};
+    socklen_t puLength = 0;
+    bool puTcp = false;
+    std::string puPath;     ///< The AF_UNIX path; empty for TCP.
+
+    /// Returns \c false and describes the problem in \a aError if \a aSpec cannot be used.
+    static bool parse(const std::string &aSpec, SocketAddress *aAddress, std::string *aError);
+
+    int family() const { return puStorage.ss_family; }
+    const sockaddr *get() const { return reinterpret_cast<const sockaddr *>(&puStorage); }
+};
+
+} // namespace readerd
+
+#endif // READERD_SOCKETADDRESS_H
@@ -0,0 +1,106 @@
+#ifndef READERD_TLVREADER_H
+#define READERD_TLVREADER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace readerd {
+
+/// Universal and context-specific tags of the DER structures the readers walk.
+constexpr uint32_t kTagBoolean = 0x01;
+constexpr uint32_t kTagInteger = 0x02;
+constexpr uint32_t kTagOctetString = 0x04;
+constexpr uint32_t kTagOid = 0x06;
+constexpr uint32_t kTagUtcTime = 0x17;
+constexpr uint32_t kTagGeneralizedTime = 0x18;
+constexpr uint32_t kTagSequence = 0x30;
+constexpr uint32_t kTagSet = 0x31;
+constexpr uint32_t kTagImplicit0 = 0x80;
+constexpr uint32_t kTagContext0 = 0xA0;
+constexpr uint32_t kTagContext1 = 0xA1;
+constexpr uint32_t kTagContext3 = 0xA3;
+
+/// Whether two encodings, or an element and an object identifier, are byte for byte equal.
+inline bool equal(std::span<const uint8_t> aLeft, std::span<const uint8_t> aRight)
+{
+    return aLeft.size() == aRight.size() && std::equal(aLeft.begin(), aLeft.end(), aRight.begin());
+}
+
+/// Walks the elements of one level of a BER-TLV encoding, as the LDS files, certificates and
+/// CRLs use it. Definite lengths of up to four bytes only, as DER requires; multi-byte tags
+/// are returned with their bytes packed, e.g. 0x5F01.
+class TlvReader
+{
+public:
+    explicit TlvReader(std::span<const uint8_t> aData)
+        : prData(aData)
+    {
+    }
+
+    bool atEnd() const { return prData.empty(); }
+
+    /// Takes the next element: its tag, its contents and, if \a aElement is given, the whole
+    /// element including the tag and length.
+    bool next(uint32_t *aTag, std::span<const uint8_t> *aContent, std::span<const uint8_t> *aElement = nullptr)
+    {
+        size_t lAt = 0;
+        if (lAt >= prData.size())
+            return false;
+        uint32_t lTag = prData[lAt++];
+        if ((lTag & 0x1F) == 0x1F)
+        {
+            do
+            {
+                if (lAt >= prData.size() || lTag > 0xFFFFFF)
+                    return false;
+                lTag = (lTag << 8) | prData[lAt];
+            } while (prData[lAt++] & 0x80);
+        }
+        if (lAt >= prData.size())
+            return false;
+        size_t lLength = prData[lAt++];
+        if (lLength & 0x80)
+        {
+            const size_t lBytes = lLength & 0x7F;
+            if (lBytes == 0 || lBytes > 4 || prData.size() - lAt < lBytes)
+                return false;
+            lLength = 0;
+            for (size_t i = 0; i < lBytes; ++i)
+                lLength = (lLength << 8) | prData[lAt++];
+        }
+        if (prData.size() - lAt < lLength)
+            return false;
+        *aTag = lTag;
+        *aContent = prData.subspan(lAt, lLength);
+        if (aElement != nullptr)
+            *aElement = prData.first(lAt + lLength);
+        prData = prData.subspan(lAt + lLength);
+        return true;
+    }
+
+    /// Takes the next element, which must have tag \a aTag.
+    bool expect(uint32_t aTag, std::span<const uint8_t> *aContent, std::span<const uint8_t> *aElement = nullptr)
+    {
+        uint32_t lTag = 0;
+        return next(&lTag, aContent, aElement) && lTag == aTag;
+    }
+
+    /// Takes the next element if it has tag \a aTag, and leaves it otherwise.
+    bool optional(uint32_t aTag, std::span<const uint8_t> *aContent)
+    {
+        TlvReader lAhead(prData);
+        if (!lAhead.expect(aTag, aContent))
+            return false;
+        prData = lAhead.prData;
+        return true;
+    }
+
+private:
+    std::span<const uint8_t> prData;
+};
+
+} // namespace readerd
+
+#endif // READERD_TLVREADER_H
@@ -0,0 +1,100 @@
+#ifndef READERD_TRACER_H
+#define READERD_TRACER_H
+
+#include "readerd/DataSlab.h"
+#include "readerd/ReaderBackend.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace readerd {
+
+/// Pipeline stage a span is attributed to.
+enum TraceStage
+{
+    TRACE_DETECT,
+    TRACE_CAPTURE,
+    TRACE_OCR,
+    TRACE_RF,
+    TRACE_PLUGINS,
+    TRACE_PROCESS,
+    TRACE_DOCUMENT,
+};
+
+const char *traceStageName(TraceStage aStage);
+
+/// One interval of a traced document. Times are microseconds since the tracer was created.
+struct TraceSpan
+{
+    TraceStage puStage;
+    std::string puName;
+    double puStartUs;
+    double puEndUs;
+    uint64_t puBytes = 0;
+};
+
+struct TracedDocument
+{
+    uint32_t puDocument = 0;
+    std::vector<TraceSpan> puSpans;
+
+    /// Events as instants, for the trace viewer.
+    std::vector<std::pair<double, MMMReaderEventCode>> puEvents;
+};
+
+/// Timestamps every event and data item with the monotonic clock and turns each document
+/// into spans: detect, image capture per light source, codeline OCR, each RF data group and
+/// each plugin, plus one span per stage and one for the whole document.
+///
+/// The SDK only says when an item is ready, so each item's span runs from the previous item
+/// or event of the same document to its own arrival; the stage spans cover their items.
+/// Register the tracer before any other consumer so that its timestamps are not delayed by
+/// them. Safe to use from several callback threads, as the replay engine does.
+class Tracer : public DataConsumer
+{
+public:
+    /// Keeps the last \a aMaxDocuments completed documents.
+    explicit Tracer(size_t aMaxDocuments = 1000);
+
+    void onData(const DataItem &aItem) override;
+    void onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument) override;
+
+    /// Completed documents, oldest first.
+    std::vector<TracedDocument> documents() const;
+
+    /// Writes the completed documents in the Chrome trace event format (chrome://tracing,
+    /// Perfetto), one row per document.
+    void writeChromeTrace(std::FILE *aFile) const;
+
+    static TraceStage stageOf(MMMReaderDataType aDataType);
+
+private:
+    struct OpenDocument
+    {
+        TracedDocument puTrace;
+        double puStartUs = 0.0;
+        double puLastMarkUs = 0.0;
+    };
+
+    double now() const;
+    void finish(OpenDocument &aDocument, double aEndUs);
+
+    const std::chrono::steady_clock::time_point prOrigin;
+    const size_t prMaxDocuments;
+
+    mutable std::mutex prMutex;
+    double prDocOnWindowUs = -1.0;
+    std::map<uint32_t, OpenDocument> prOpen;
+    std::deque<TracedDocument> prCompleted;
+};
+
+} // namespace readerd
+
+#endif // READERD_TRACER_H
@@ -0,0 +1,56 @@
+#ifndef READERD_WORKERPROCESS_H
+#define READERD_WORKERPROCESS_H
+
+#include "readerd/ResultClient.h"
+#include "readerd/ResultServer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace readerd {
+
+/// Starts a readerd worker process with \a aArguments, the first naming the executable (looked
+/// up in PATH). The worker is sent SIGTERM if this process dies, runs on \a aCpus unless that
+/// is empty, and inherits \a aInheritFd unless it is negative; descriptors opened with
+/// O_CLOEXEC stay behind. Returns the pid, or -1 with the cause in \a aError.
+pid_t spawnWorker(const std::vector<std::string> &aArguments, const std::vector<int> &aCpus, int aInheritFd,
+                  std::string *aError);
+
+/// A socket path for worker \a aIndex of kind \a aKind, unique to this process.
+std::string workerSocketPath(const char *aKind, uint32_t aIndex);
+
+/// Republishes the documents one worker streams with SF_DOCUMENTS framing on another
+/// ResultServer.
+///
+/// The payloads are not copied: each frame's buffer is taken over and the records published
+/// as slices of it. Documents are renumbered from a sequence shared by every relay on the
+/// server, so that several workers, or one worker after another, make up one stream.
+class DocumentRelay
+{
+public:
+    DocumentRelay(ResultServer &aServer, std::atomic<uint32_t> &aNextDocument);
+
+    /// Follows every START_OF_DOCUMENT_DATA with an RK_SCANNER record for \a aLane and
+    /// \a aSerial.
+    void setScanner(uint32_t aLane, const std::string &aSerial);
+
+    /// Republishes the records of \a aFrame, leaving its buffer empty. Returns the number of
+    /// documents it ended.
+    uint32_t relay(Frame &aFrame);
+
+private:
+    ResultServer &prServer;
+    std::atomic<uint32_t> &prNextDocument;
+    uint32_t prLane = 0;
+    DataRef prScanner;
+    bool prHaveDocument = false;
+    uint32_t prLocalDocument = 0;
+    uint32_t prDocument = 0;
+};
+
+} // namespace readerd
+
+#endif // READERD_WORKERPROCESS_H
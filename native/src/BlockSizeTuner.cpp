@@ -0,0 +1,223 @@
+#include "readerd/BlockSizeTuner.h"
+
+#include "readerd/Fnv.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace readerd {
+
+namespace {
+
+// A transfer shorter than this is dominated by the file selection and the counters'
+// millisecond resolution, and says little about the block size.
+constexpr int kMinSampleBlocks = 4;
+constexpr int kMinSampleMs = 5;
+
+size_t fastest(const BlockProfile &aProfile)
+{
+    size_t lBest = kReadBlockSizeCount;
+    for (size_t i = 0; i < aProfile.puCeiling; ++i)
+        if (aProfile.puRates[i] > 0.0 && (lBest == kReadBlockSizeCount || aProfile.puRates[i] > aProfile.puRates[lBest]))
+            lBest = i;
+    return lBest;
+}
+
+} // namespace
+
+std::string blockProfileKey(const SecurityObject *aSecurityObject)
+{
+    if (aSecurityObject == nullptr)
+        return "default";
+    std::string lKey = digestAlgorithmName(aSecurityObject->puAlgorithm);
+    if (!aSecurityObject->puSignerIssuer.empty())
+    {
+        // A hash rather than the Name itself keeps the saved profiles to one short line each.
+        char lHash[20];
+        std::snprintf(lHash, sizeof(lHash), "-%016llx",
+                      static_cast<unsigned long long>(
+                          fnv1a(aSecurityObject->puSignerIssuer.data(), aSecurityObject->puSignerIssuer.size())));
+        lKey += lHash;
+    }
+    return lKey;
+}
+
+MMMReaderErrorCode BlockSizeTuner::begin(RfChip &aChip, const std::string &aKey)
+{
+    prProfile = nullptr;
+    if (prProfiles.size() >= kMaxBlockProfiles && prProfiles.count(aKey) == 0)
+        evictOldest();
+
+    const auto lInserted = prProfiles.try_emplace(aKey);
+    BlockProfile &lProfile = lInserted.first->second;
+    lProfile.puLastUsed = ++prSessions;
+    const int64_t lNow = static_cast<int64_t>(std::time(nullptr));
+    if (lProfile.puCeiling < kReadBlockSizeCount && lNow - lProfile.puCeilingTime >= kBlockCeilingSeconds)
+    {
+        lProfile.puCeiling = kReadBlockSizeCount;
+        lProfile.puFailures.fill(0);
+    }
+    if (lInserted.second)
+    {
+        const int lConfigured = aChip.readBlockSize();
+        while (lProfile.puCurrent + 1 < kReadBlockSizeCount && kReadBlockSizes[lProfile.puCurrent + 1] <= lConfigured)
+            ++lProfile.puCurrent;
+    }
+    prProfile = &lProfile;
+    return aChip.setReadBlockSize(kReadBlockSizes[lProfile.puCurrent]);
+}
+
+int BlockSizeTuner::blockSize() const
+{
+    return prProfile != nullptr ? kReadBlockSizes[prProfile->puCurrent] : 0;
+}
+
+MMMReaderErrorCode BlockSizeTuner::getFile(RfChip &aChip, MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes)
+{
+    if (prProfile == nullptr)
+        return aChip.getFile(aItem, aBytes);
+
+    BlockProfile &lProfile = *prProfile;
+    const size_t lUsed = lProfile.puCurrent;
+    int lStartMs = 0, lStartBytes = 0;
+    const bool lCounted = aChip.getTransferCounters(&lStartMs, &lStartBytes) == NO_ERROR_OCCURRED;
+    const MMMReaderErrorCode lResult = aChip.getFile(aItem, aBytes);
+
+    if (lResult == NO_ERROR_OCCURRED)
+    {
+        lProfile.puFailures[lUsed] = 0;
+        int lEndMs = 0, lEndBytes = 0;
+        if (lCounted && aChip.getTransferCounters(&lEndMs, &lEndBytes) == NO_ERROR_OCCURRED)
+            learn(lEndMs - lStartMs, lEndBytes - lStartBytes);
+    }
+    else if (lResult != ERROR_RF_DG_NOT_PRESENT && lUsed > 0 && lProfile.puRates[lUsed] == 0.0)
+    {
+        // Never read at this size before: read again below it, and take it as the limit of
+        // this kind of chip once it has failed often enough.
+        if (++lProfile.puFailures[lUsed] >= kBlockCeilingFailures && lUsed < lProfile.puCeiling)
+        {
+            lProfile.puCeiling = lUsed;
+            lProfile.puCeilingTime = static_cast<int64_t>(std::time(nullptr));
+        }
+        const size_t lBest = fastest(lProfile);
+        lProfile.puCurrent = lBest != kReadBlockSizeCount ? lBest : lUsed - 1;
+        std::fprintf(stderr, "readerd: chip failed a %d-byte READ BINARY, reading again with %d bytes\n",
+                     kReadBlockSizes[lUsed], kReadBlockSizes[lProfile.puCurrent]);
+        if (aChip.setReadBlockSize(kReadBlockSizes[lProfile.puCurrent]) != NO_ERROR_OCCURRED)
+            return lResult;
+        return getFile(aChip, aItem, aBytes);
+    }
+
+    if (lProfile.puCurrent != lUsed)
+        aChip.setReadBlockSize(kReadBlockSizes[lProfile.puCurrent]);
+    return lResult;
+}
+
+void BlockSizeTuner::evictOldest()
+{
+    prProfiles.erase(std::min_element(prProfiles.begin(), prProfiles.end(), [](const auto &aLeft, const auto &aRight) {
+        return aLeft.second.puLastUsed < aRight.second.puLastUsed;
+    }));
+}
+
+void BlockSizeTuner::learn(int aApduMs, int aBytes)
+{
+    BlockProfile &lProfile = *prProfile;
+    const size_t lUsed = lProfile.puCurrent;
+    if (aBytes < kMinSampleBlocks * kReadBlockSizes[lUsed] || aApduMs < kMinSampleMs)
+        return;
+
+    const double lRate = static_cast<double>(aBytes) / aApduMs;
+    double &lKnown = lProfile.puRates[lUsed];
+    lKnown = lKnown == 0.0 ? lRate : (lKnown + lRate) / 2.0;
+
+    // Measure the neighbours of the fastest size, the larger one first, then stay there.
+    const size_t lBest = fastest(lProfile);
+    lProfile.puCurrent = lBest;
+    if (lBest + 1 < lProfile.puCeiling && lProfile.puRates[lBest + 1] == 0.0)
+        lProfile.puCurrent = lBest + 1;
+    else if (lBest > 0 && lProfile.puRates[lBest - 1] == 0.0)
+        lProfile.puCurrent = lBest - 1;
+}
+
+MMMReaderErrorCode BlockSizeTuner::load(const std::string &aPath, std::string *aError)
+{
+    std::ifstream lIn(aPath);
+    if (!lIn)
+        return NO_ERROR_OCCURRED;
+
+    // One profile per line, oldest first: key, ceiling, current, the rate at each size, when
+    // the ceiling was set, then the failures at each size.
+    std::string lLine;
+    int lLineNumber = 0;
+    while (std::getline(lIn, lLine))
+    {
+        ++lLineNumber;
+        if (lLine.empty())
+            continue;
+        const size_t lTab = lLine.find('\t');
+        std::istringstream lFields(lTab == std::string::npos ? std::string() : lLine.substr(lTab + 1));
+        BlockProfile lProfile;
+        lFields >> lProfile.puCeiling >> lProfile.puCurrent;
+        for (double &lRate : lProfile.puRates)
+            lFields >> lRate;
+        lFields >> lProfile.puCeilingTime;
+        for (int &lFailures : lProfile.puFailures)
+            lFields >> lFailures;
+        if (lTab == std::string::npos || lFields.fail() || lProfile.puCeiling > kReadBlockSizeCount
+            || lProfile.puCurrent >= lProfile.puCeiling)
+        {
+            *aError = aPath + ":" + std::to_string(lLineNumber) + ": invalid block size profile";
+            return ERROR_INVALID_CONFIG_FILE_FORMAT;
+        }
+        lProfile.puLastUsed = ++prSessions;
+        prProfiles[lLine.substr(0, lTab)] = lProfile;
+    }
+    while (prProfiles.size() > kMaxBlockProfiles)
+        evictOldest();
+    prProfile = nullptr;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode BlockSizeTuner::save(const std::string &aPath, std::string *aError) const
+{
+    const std::string lTemp = aPath + ".tmp";
+    {
+        std::vector<std::pair<std::string, BlockProfile>> lProfiles(prProfiles.begin(), prProfiles.end());
+        std::sort(lProfiles.begin(), lProfiles.end(), [](const auto &aLeft, const auto &aRight) {
+            return aLeft.second.puLastUsed < aRight.second.puLastUsed;
+        });
+        std::ofstream lOut(lTemp, std::ios::trunc);
+        for (const auto &lEntry : lProfiles)
+        {
+            if (lEntry.first.find_first_of("\t\n") != std::string::npos)
+                continue;
+            lOut << lEntry.first << '\t' << lEntry.second.puCeiling << ' ' << lEntry.second.puCurrent;
+            for (double lRate : lEntry.second.puRates)
+                lOut << ' ' << lRate;
+            lOut << ' ' << lEntry.second.puCeilingTime;
+            for (int lFailures : lEntry.second.puFailures)
+                lOut << ' ' << lFailures;
+            lOut << '\n';
+        }
+        if (!lOut.flush())
+        {
+            *aError = "cannot write " + lTemp;
+            return ERROR_WRITING_FILE;
+        }
+    }
+    std::error_code lError;
+    std::filesystem::rename(lTemp, aPath, lError);
+    if (lError)
+    {
+        *aError = "cannot replace " + aPath + ": " + lError.message();
+        return ERROR_WRITING_FILE;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+} // namespace readerd
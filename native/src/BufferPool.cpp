@@ -0,0 +1,141 @@
+#include "readerd/BufferPool.h"
+
+#include <algorithm>
+#include <bit>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace readerd {
+
+namespace {
+
+constexpr size_t kMinimumClass = 4096;
+
+} // namespace
+
+struct BufferPool::State
+{
+    explicit State(size_t aMaxCachedBytes)
+        : puMaxCachedBytes(aMaxCachedBytes)
+    {
+    }
+
+    ~State()
+    {
+        for (auto &lClass : puFree)
+        {
+            for (uint8_t *lBuffer : lClass.second)
+                delete[] lBuffer;
+        }
+    }
+
+    void release(uint8_t *aBuffer, size_t aClass)
+    {
+        std::lock_guard<std::mutex> lLock(puMutex);
+        puInUseBytes -= aClass;
+        if (puCachedBytes + aClass > puMaxCachedBytes)
+        {
+            delete[] aBuffer;
+            return;
+        }
+        puFree[aClass].push_back(aBuffer);
+        puCachedBytes += aClass;
+    }
+
+    // Frees cached buffers, largest first, until at most aBudget bytes remain.
+    void trimTo(size_t aBudget)
+    {
+        for (auto lClass = puFree.rbegin(); lClass != puFree.rend() && puCachedBytes > aBudget; ++lClass)
+        {
+            std::vector<uint8_t *> &lBuffers = lClass->second;
+            while (!lBuffers.empty() && puCachedBytes > aBudget)
+            {
+                delete[] lBuffers.back();
+                lBuffers.pop_back();
+                puCachedBytes -= lClass->first;
+            }
+        }
+    }
+
+    const size_t puMaxCachedBytes;
+
+    mutable std::mutex puMutex;
+    std::map<size_t, std::vector<uint8_t *>> puFree;
+    size_t puCachedBytes = 0;
+    size_t puInUseBytes = 0;
+    size_t puPeakInUseBytes = 0;
+    uint64_t puHits = 0;
+    uint64_t puMisses = 0;
+};
+
+struct BufferPool::Releaser
+{
+    std::shared_ptr<State> puState;
+    size_t puClass;
+
+    void operator()(uint8_t *aBuffer) const { puState->release(aBuffer, puClass); }
+};
+
+BufferPool::BufferPool(size_t aMaxCachedBytes)
+    : prState(std::make_shared<State>(aMaxCachedBytes))
+{
+}
+
+size_t BufferPool::classSize(size_t aSize)
+{
+    if (aSize <= kMinimumClass)
+        return kMinimumClass;
+
+    // Four classes per power of two: 1.25, 1.5, 1.75 and 2 times the power below aSize.
+    const size_t lPower = std::bit_floor(aSize - 1);
+    const size_t lStep = lPower / 4;
+    return (aSize + lStep - 1) / lStep * lStep;
+}
+
+std::shared_ptr<uint8_t[]> BufferPool::acquire(size_t aSize)
+{
+    const size_t lClass = classSize(aSize);
+    uint8_t *lBuffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lLock(prState->puMutex);
+        auto lFree = prState->puFree.find(lClass);
+        if (lFree != prState->puFree.end() && !lFree->second.empty())
+        {
+            lBuffer = lFree->second.back();
+            lFree->second.pop_back();
+            prState->puCachedBytes -= lClass;
+            ++prState->puHits;
+        }
+        else
+        {
+            ++prState->puMisses;
+        }
+        prState->puInUseBytes += lClass;
+        prState->puPeakInUseBytes = std::max(prState->puPeakInUseBytes, prState->puInUseBytes);
+    }
+
+    if (lBuffer == nullptr)
+        lBuffer = new uint8_t[lClass];
+    return std::shared_ptr<uint8_t[]>(lBuffer, Releaser{prState, lClass});
+}
+
+void BufferPool::endOfDocument()
+{
+    std::lock_guard<std::mutex> lLock(prState->puMutex);
+    prState->trimTo(std::min(prState->puMaxCachedBytes, 2 * prState->puPeakInUseBytes));
+    prState->puPeakInUseBytes = prState->puInUseBytes;
+}
+
+BufferPool::Stats BufferPool::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prState->puMutex);
+    Stats lStats;
+    lStats.puHits = prState->puHits;
+    lStats.puMisses = prState->puMisses;
+    lStats.puCachedBytes = prState->puCachedBytes;
+    lStats.puInUseBytes = prState->puInUseBytes;
+    return lStats;
+}
+
+} // namespace readerd
@@ -0,0 +1,249 @@
+#include "readerd/BulkFetch.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace readerd {
+
+namespace {
+
+// Offsets are kept aligned so fixed-layout payloads (MMMReaderCodelineData, int results)
+// can be read in place with DataItem::as<T>().
+constexpr size_t kEntryAlignment = 16;
+
+// Room left on top of the largest size seen, so images that vary a little from document to
+// document do not fall back to a probe.
+constexpr size_t kSlotHeadroomShift = 4;
+
+size_t alignUp(size_t aValue)
+{
+    return (aValue + kEntryAlignment - 1) & ~(kEntryAlignment - 1);
+}
+
+bool isBufferTooSmall(MMMReaderErrorCode aResult)
+{
+    return aResult == ERROR_DATA_BUFFER_TOO_SMALL || aResult == ERROR_STRING_BUFFER_TOO_SMALL;
+}
+
+struct Slot
+{
+    MMMReaderDataType puDataType;
+    int puIndex;
+    size_t puOffset;
+    size_t puCapacity;
+    size_t puLength;
+    bool puFetched;
+};
+
+const MMMReaderDataType kDefaultDataTypes[] = {
+    CD_CODELINE,
+    CD_CODELINE_DATA,
+    CD_CHECKSUM,
+    CD_IMAGEIR,
+    CD_IMAGEIRREAR,
+    CD_IMAGEVIS,
+    CD_IMAGEVISREAR,
+    CD_IMAGEUV,
+    CD_IMAGEUVREAR,
+    CD_IMAGECOAXVIS,
+    CD_IMAGECOAXIR,
+    CD_IMAGEPHOTO,
+    CD_SECURITYCHECK,
+    CD_SCBAC_STATUS,
+    CD_SAC_STATUS,
+    CD_SCCHIPID,
+    CD_SCEF_COM_FILE,
+    CD_SCEF_SOD_FILE,
+    CD_SCDG1_FILE,
+    CD_SCDG2_FILE,
+    CD_SCDG3_FILE,
+    CD_SCDG7_FILE,
+    CD_SCDG11_FILE,
+    CD_SCDG12_FILE,
+    CD_SCDG13_FILE,
+    CD_SCDG14_FILE,
+    CD_SCDG15_FILE,
+    CD_SCDG1_CODELINE,
+    CD_SCDG1_CODELINE_DATA,
+    CD_SCDG1_VALIDATE,
+    CD_SCDG2_VALIDATE,
+    CD_SCDG3_VALIDATE,
+    CD_SCDG7_VALIDATE,
+    CD_SCDG11_VALIDATE,
+    CD_SCDG12_VALIDATE,
+    CD_SCDG13_VALIDATE,
+    CD_SCDG14_VALIDATE,
+    CD_SCDG15_VALIDATE,
+    CD_SCSIGNEDATTRS_VALIDATE,
+    CD_SCSIGNATURE_VALIDATE,
+    CD_VALIDATE_DOC_SIGNER_CERT,
+    CD_ACTIVE_AUTHENTICATION,
+    CD_SCCHIP_AUTHENTICATION_STATUS,
+    CD_SCTERMINAL_AUTHENTICATION_STATUS,
+};
+
+} // namespace
+
+const BulkEntry *BulkResult::find(MMMReaderDataType aDataType, int aIndex) const
+{
+    for (const BulkEntry &lEntry : prEntries)
+    {
+        if (lEntry.puDataType == aDataType && lEntry.puIndex == aIndex)
+            return &lEntry;
+    }
+    return nullptr;
+}
+
+BulkFetcher::BulkFetcher(ReaderBackend &aBackend)
+    : prBackend(aBackend)
+{
+}
+
+std::span<const MMMReaderDataType> BulkFetcher::defaultDataTypes()
+{
+    return kDefaultDataTypes;
+}
+
+size_t BulkFetcher::slotSize(MMMReaderDataType aDataType, int aIndex) const
+{
+    const auto lHint = prSizeHints.find(SlotKey(aDataType, aIndex));
+    if (lHint == prSizeHints.end())
+        return 0;
+    return lHint->second + (lHint->second >> kSlotHeadroomShift);
+}
+
+MMMReaderErrorCode BulkFetcher::probe(MMMReaderDataType aDataType, int aIndex, size_t *aSize)
+{
+    int lLen = 0;
+    ++prLastGetDataCalls;
+    const MMMReaderErrorCode lResult = prBackend.getData(aDataType, nullptr, &lLen, aIndex);
+    if (lResult != NO_ERROR_OCCURRED && !isBufferTooSmall(lResult))
+        return lResult;
+    *aSize = lLen > 0 ? static_cast<size_t>(lLen) : 0;
+    return NO_ERROR_OCCURRED;
+}
+
+void BulkFetcher::growArena(size_t aRequired)
+{
+    aRequired = std::max(aRequired, kEntryAlignment);
+
+    // A previous BulkResult may still be reading the current arena; never write under it.
+    const bool lShared = prArena && prArena.use_count() > 1;
+    if (!lShared && aRequired <= prArenaCapacity)
+        return;
+
+    const size_t lCapacity = std::max(aRequired, lShared ? 0 : prArenaCapacity + (prArenaCapacity >> 1));
+    prArena = std::make_shared_for_overwrite<uint8_t[]>(lCapacity);
+    prArenaCapacity = lCapacity;
+}
+
+MMMReaderErrorCode BulkFetcher::fetch(std::span<const MMMReaderDataType> aDataTypes, BulkResult *aResult)
+{
+    if (aResult == nullptr)
+        return ERROR_PARAMETER_INVALID;
+    aResult->prArena = DataRef();
+    aResult->prEntries.clear();
+    prLastGetDataCalls = 0;
+
+    // Layout pass: counts, plus a probe for anything we have no size for yet.
+    std::vector<Slot> lSlots;
+    size_t lTotal = 0;
+    for (MMMReaderDataType lDataType : aDataTypes)
+    {
+        if (lDataType >= CD_PLUGIN)
+            return ERROR_PARAMETER_INVALID;
+
+        int lCount = 0;
+        MMMReaderErrorCode lResult = prBackend.getDataCount(lDataType, &lCount);
+        if (lResult != NO_ERROR_OCCURRED)
+            return lResult;
+
+        for (int lIndex = 0; lIndex < lCount; ++lIndex)
+        {
+            size_t lCapacity = slotSize(lDataType, lIndex);
+            if (lCapacity == 0 && !prSizeHints.count(SlotKey(lDataType, lIndex)))
+            {
+                lResult = probe(lDataType, lIndex, &lCapacity);
+                if (lResult != NO_ERROR_OCCURRED)
+                    return lResult;
+            }
+            lSlots.push_back(Slot{lDataType, lIndex, lTotal, lCapacity, 0, false});
+            lTotal = alignUp(lTotal + lCapacity);
+        }
+    }
+
+    growArena(lTotal);
+
+    // Fill pass. A slot that turns out too small records the size the SDK asked for.
+    bool lOverflow = false;
+    for (Slot &lSlot : lSlots)
+    {
+        int lLen = static_cast<int>(lSlot.puCapacity);
+        ++prLastGetDataCalls;
+        const MMMReaderErrorCode lResult =
+            prBackend.getData(lSlot.puDataType, prArena.get() + lSlot.puOffset, &lLen, lSlot.puIndex);
+        if (isBufferTooSmall(lResult))
+        {
+            lSlot.puCapacity = static_cast<size_t>(std::max(lLen, 0));
+            lOverflow = true;
+            continue;
+        }
+        if (lResult != NO_ERROR_OCCURRED)
+            return lResult;
+        lSlot.puLength = static_cast<size_t>(std::max(lLen, 0));
+        lSlot.puFetched = true;
+    }
+
+    // Items that outgrew their hint: lay the arena out again with the real sizes, move what
+    // was fetched and fetch the rest. Moving is a memcpy, far cheaper than going back to the
+    // SDK for everything.
+    if (lOverflow)
+    {
+        std::vector<size_t> lOldOffsets;
+        lOldOffsets.reserve(lSlots.size());
+        lTotal = 0;
+        for (Slot &lSlot : lSlots)
+        {
+            lOldOffsets.push_back(lSlot.puOffset);
+            lSlot.puOffset = lTotal;
+            lTotal = alignUp(lTotal + (lSlot.puFetched ? lSlot.puLength : lSlot.puCapacity));
+        }
+
+        std::shared_ptr<uint8_t[]> lOld = prArena;
+        prArena.reset();
+        prArenaCapacity = 0;
+        growArena(lTotal);
+
+        for (size_t i = 0; i < lSlots.size(); ++i)
+        {
+            Slot &lSlot = lSlots[i];
+            if (lSlot.puFetched)
+            {
+                if (lSlot.puLength > 0)
+                    std::memcpy(prArena.get() + lSlot.puOffset, lOld.get() + lOldOffsets[i], lSlot.puLength);
+                continue;
+            }
+
+            int lLen = static_cast<int>(lSlot.puCapacity);
+            ++prLastGetDataCalls;
+            const MMMReaderErrorCode lResult =
+                prBackend.getData(lSlot.puDataType, prArena.get() + lSlot.puOffset, &lLen, lSlot.puIndex);
+            if (lResult != NO_ERROR_OCCURRED)
+                return lResult;
+            lSlot.puLength = static_cast<size_t>(std::max(lLen, 0));
+            lSlot.puFetched = true;
+        }
+    }
+
+    aResult->prEntries.reserve(lSlots.size());
+    for (const Slot &lSlot : lSlots)
+    {
+        size_t &lHint = prSizeHints[SlotKey(lSlot.puDataType, lSlot.puIndex)];
+        lHint = std::max(lHint, lSlot.puLength);
+        aResult->prEntries.push_back(BulkEntry{lSlot.puDataType, lSlot.puIndex, lSlot.puOffset, lSlot.puLength});
+    }
+    aResult->prArena = DataRef::adopt(prArena, lTotal);
+    return NO_ERROR_OCCURRED;
+}
+
+} // namespace readerd
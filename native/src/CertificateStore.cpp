@@ -0,0 +1,692 @@
+#include "readerd/CertificateStore.h"
+
+#include "readerd/Fnv.h"
+#include "readerd/TlvReader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_set>
+#include <vector>
+
+namespace readerd {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// kTagImplicit0 tags keyIdentifier and subjectKeyIdentifier.
+constexpr uint32_t kTagImplicit2 = 0x82;        // authorityCertSerialNumber
+constexpr uint32_t kTagGeneralNames = 0xA1;     // authorityCertIssuer
+constexpr uint32_t kTagDirectoryName = 0xA4;
+
+const uint8_t kOidSubjectKeyId[] = {0x55, 0x1D, 0x0E};
+const uint8_t kOidSignedData[] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02};
+const uint8_t kOidCscaMasterList[] = {0x67, 0x81, 0x08, 0x01, 0x01, 0x02};
+
+// Certificates start on an 8-byte boundary after the header; the tables follow them.
+constexpr uint64_t kFirstCertificate = 64;
+static_assert(sizeof(CertificateStoreHeader) <= kFirstCertificate);
+
+uint64_t keyHash(CertificateKey aKind, std::span<const uint8_t> aKey)
+{
+    const uint8_t lKind = static_cast<uint8_t>(aKind);
+    return fnv1a(aKey.data(), aKey.size(), fnv1a(&lKind, 1));
+}
+
+uint64_t alignUp(uint64_t aOffset)
+{
+    return (aOffset + 7) & ~uint64_t(7);
+}
+
+bool decodeBase64(std::string_view aText, std::vector<uint8_t> *aOut)
+{
+    aOut->clear();
+    uint32_t lBits = 0;
+    int lCount = 0;
+    for (char lChar : aText)
+    {
+        int lValue;
+        if (lChar >= 'A' && lChar <= 'Z')
+            lValue = lChar - 'A';
+        else if (lChar >= 'a' && lChar <= 'z')
+            lValue = lChar - 'a' + 26;
+        else if (lChar >= '0' && lChar <= '9')
+            lValue = lChar - '0' + 52;
+        else if (lChar == '+')
+            lValue = 62;
+        else if (lChar == '/')
+            lValue = 63;
+        else if (lChar == '=' || std::isspace(static_cast<unsigned char>(lChar)))
+            continue;
+        else
+            return false;
+        lBits = (lBits << 6) | static_cast<uint32_t>(lValue);
+        if (++lCount == 4)
+        {
+            aOut->insert(aOut->end(), {static_cast<uint8_t>(lBits >> 16), static_cast<uint8_t>(lBits >> 8),
+                                       static_cast<uint8_t>(lBits)});
+            lBits = 0;
+            lCount = 0;
+        }
+    }
+    if (lCount == 2)
+        aOut->push_back(static_cast<uint8_t>(lBits >> 4));
+    else if (lCount == 3)
+        aOut->insert(aOut->end(), {static_cast<uint8_t>(lBits >> 10), static_cast<uint8_t>(lBits >> 2)});
+    return lCount != 1;
+}
+
+// Every certificate in one file: PEM, a DER certificate or a master list.
+void readCertificates(const std::vector<uint8_t> &aFile, std::vector<std::vector<uint8_t>> *aCertificates)
+{
+    std::vector<std::vector<uint8_t>> lBlocks;
+    if (decodePem(aFile, "CERTIFICATE", &lBlocks))
+    {
+        CertificateFields lFields;
+        for (std::vector<uint8_t> &lDer : lBlocks)
+        {
+            if (parseCertificate(lDer, &lFields))
+                aCertificates->push_back(std::move(lDer));
+        }
+        return;
+    }
+
+    CertificateFields lFields;
+    if (parseCertificate(aFile, &lFields))
+    {
+        aCertificates->push_back(aFile);
+        return;
+    }
+    std::vector<std::span<const uint8_t>> lListed;
+    if (parseMasterList(aFile, &lListed))
+    {
+        for (std::span<const uint8_t> lCertificate : lListed)
+        {
+            if (parseCertificate(lCertificate, &lFields))
+                aCertificates->emplace_back(lCertificate.begin(), lCertificate.end());
+        }
+    }
+}
+
+bool writeAll(int aFd, const void *aData, size_t aLen)
+{
+    const uint8_t *lData = static_cast<const uint8_t *>(aData);
+    while (aLen > 0)
+    {
+        const ssize_t lWritten = ::write(aFd, lData, aLen);
+        if (lWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        lData += lWritten;
+        aLen -= static_cast<size_t>(lWritten);
+    }
+    return true;
+}
+
+uint32_t offsetIn(std::span<const uint8_t> aOuter, std::span<const uint8_t> aInner)
+{
+    return static_cast<uint32_t>(aInner.data() - aOuter.data());
+}
+
+} // namespace
+
+bool hasFileExtension(const std::string &aPath, const std::string &aExtensions)
+{
+    std::string lExtension = fs::path(aPath).extension().string();
+    if (lExtension.size() < 2)
+        return false;
+    lExtension.erase(0, 1);
+    std::transform(lExtension.begin(), lExtension.end(), lExtension.begin(),
+                   [](unsigned char aChar) { return static_cast<char>(std::tolower(aChar)); });
+    size_t lStart = 0;
+    while (lStart <= aExtensions.size())
+    {
+        size_t lEnd = aExtensions.find(';', lStart);
+        if (lEnd == std::string::npos)
+            lEnd = aExtensions.size();
+        std::string lWanted = aExtensions.substr(lStart, lEnd - lStart);
+        std::transform(lWanted.begin(), lWanted.end(), lWanted.begin(),
+                       [](unsigned char aChar) { return static_cast<char>(std::tolower(aChar)); });
+        if (lWanted == lExtension)
+            return true;
+        lStart = lEnd + 1;
+    }
+    return false;
+}
+
+MMMReaderErrorCode listFiles(const std::string &aDirectory, bool aRecursive, const std::string &aExtensions,
+                             std::vector<ListedFile> *aFiles, std::string *aError)
+{
+    aFiles->clear();
+    std::error_code lError;
+    auto lAdd = [&](const fs::directory_entry &aEntry) {
+        // A file that goes away while it is listed is left out, not an error.
+        std::error_code lEntryError;
+        if (!aEntry.is_regular_file(lEntryError) || !hasFileExtension(aEntry.path().string(), aExtensions))
+            return;
+        ListedFile lFile;
+        lFile.puPath = aEntry.path().string();
+        lFile.puSize = aEntry.file_size(lEntryError);
+        lFile.puModified = aEntry.last_write_time(lEntryError).time_since_epoch().count();
+        if (!lEntryError)
+            aFiles->push_back(std::move(lFile));
+    };
+    if (aRecursive)
+    {
+        for (fs::recursive_directory_iterator lIt(aDirectory, lError), lEnd; !lError && lIt != lEnd; lIt.increment(lError))
+            lAdd(*lIt);
+    }
+    else
+    {
+        for (fs::directory_iterator lIt(aDirectory, lError), lEnd; !lError && lIt != lEnd; lIt.increment(lError))
+            lAdd(*lIt);
+    }
+    if (lError)
+    {
+        *aError = "cannot list '" + aDirectory + "': " + lError.message();
+        return ERROR_READING_FILE;
+    }
+    std::sort(aFiles->begin(), aFiles->end(),
+              [](const ListedFile &aLeft, const ListedFile &aRight) { return aLeft.puPath < aRight.puPath; });
+    return NO_ERROR_OCCURRED;
+}
+
+bool readFile(const std::string &aPath, std::vector<uint8_t> *aBytes)
+{
+    std::ifstream lIn(aPath, std::ios::binary);
+    if (!lIn)
+        return false;
+    aBytes->assign(std::istreambuf_iterator<char>(lIn), std::istreambuf_iterator<char>());
+    return !lIn.bad();
+}
+
+bool decodePem(std::span<const uint8_t> aFile, const std::string &aLabel, std::vector<std::vector<uint8_t>> *aBlocks)
+{
+    const std::string lBegin = "-----BEGIN " + aLabel + "-----";
+    const std::string lEnd = "-----END " + aLabel + "-----";
+    const std::string_view lText(reinterpret_cast<const char *>(aFile.data()), aFile.size());
+    size_t lAt = lText.find(lBegin);
+    if (lAt == std::string_view::npos)
+        return false;
+    do
+    {
+        lAt += lBegin.size();
+        const size_t lStop = lText.find(lEnd, lAt);
+        if (lStop == std::string_view::npos)
+            break;
+        std::vector<uint8_t> lDer;
+        if (decodeBase64(lText.substr(lAt, lStop - lAt), &lDer))
+            aBlocks->push_back(std::move(lDer));
+        lAt = lText.find(lBegin, lStop);
+    } while (lAt != std::string_view::npos);
+    return true;
+}
+
+bool parseMasterList(std::span<const uint8_t> aFile, std::vector<std::span<const uint8_t>> *aCertificates)
+{
+    std::span<const uint8_t> lContentInfo, lOid, lExplicit, lSignedData, lIgnored, lEncap, lOctets, lList, lCerts;
+
+    // ContentInfo { signedData, [0] SignedData { version, digestAlgorithms, encapContentInfo {
+    // cscaMasterList, [0] OCTET STRING { CscaMasterList { version, certList SET OF Certificate
+    // } } }, ... } }.
+    TlvReader lFile(aFile);
+    if (!lFile.expect(kTagSequence, &lContentInfo))
+        return false;
+    TlvReader lInfo(lContentInfo);
+    if (!lInfo.expect(kTagOid, &lOid) || !equal(lOid, kOidSignedData) || !lInfo.expect(kTagContext0, &lExplicit))
+        return false;
+    TlvReader lSigned(lExplicit);
+    if (!lSigned.expect(kTagSequence, &lSignedData))
+        return false;
+    lSigned = TlvReader(lSignedData);
+    if (!lSigned.expect(kTagInteger, &lIgnored) || !lSigned.expect(kTagSet, &lIgnored)
+        || !lSigned.expect(kTagSequence, &lEncap))
+        return false;
+    TlvReader lEncapReader(lEncap);
+    if (!lEncapReader.expect(kTagOid, &lOid) || !equal(lOid, kOidCscaMasterList)
+        || !lEncapReader.expect(kTagContext0, &lExplicit))
+        return false;
+    TlvReader lOctetReader(lExplicit);
+    if (!lOctetReader.expect(kTagOctetString, &lOctets))
+        return false;
+    TlvReader lListReader(lOctets);
+    if (!lListReader.expect(kTagSequence, &lList))
+        return false;
+    TlvReader lFields(lList);
+    if (!lFields.expect(kTagInteger, &lIgnored) || !lFields.expect(kTagSet, &lCerts))
+        return false;
+
+    TlvReader lCertReader(lCerts);
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lContent, lElement;
+    while (lCertReader.next(&lTag, &lContent, &lElement))
+    {
+        if (lTag == kTagSequence)
+            aCertificates->push_back(lElement);
+    }
+    return lCertReader.atEnd();
+}
+
+bool parseCertificate(std::span<const uint8_t> aDer, CertificateFields *aFields)
+{
+    *aFields = CertificateFields();
+    std::span<const uint8_t> lCertificate, lTbs, lElement, lIgnored, lSerial, lIssuer, lSubject;
+
+    // Certificate { tbsCertificate { [0] version OPTIONAL, serialNumber, signature, issuer,
+    // validity, subject, subjectPublicKeyInfo, [1], [2], [3] extensions OPTIONAL }, ... }.
+    TlvReader lOuter(aDer);
+    if (!lOuter.expect(kTagSequence, &lCertificate, &lElement) || !lOuter.atEnd())
+        return false;
+    TlvReader lCertReader(lCertificate);
+    if (!lCertReader.expect(kTagSequence, &lTbs))
+        return false;
+    TlvReader lFields(lTbs);
+    lFields.optional(kTagContext0, &lIgnored);
+    if (!lFields.expect(kTagInteger, &lSerial) || !lFields.expect(kTagSequence, &lIgnored)
+        || !lFields.expect(kTagSequence, &lIgnored, &lIssuer) || !lFields.expect(kTagSequence, &lIgnored)
+        || !lFields.expect(kTagSequence, &lIgnored, &lSubject) || !lFields.expect(kTagSequence, &lIgnored))
+        return false;
+
+    aFields->puDer = lElement;
+    aFields->puSubject = lSubject;
+    aFields->puIssuer = lIssuer;
+    aFields->puSerial = lSerial;
+
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lContent;
+    while (lFields.next(&lTag, &lContent))
+    {
+        if (lTag != kTagContext3)
+            continue;
+        std::span<const uint8_t> lExtensions;
+        TlvReader lWrapper(lContent);
+        if (!lWrapper.expect(kTagSequence, &lExtensions))
+            return false;
+        TlvReader lExtensionReader(lExtensions);
+        std::span<const uint8_t> lExtension;
+        while (lExtensionReader.expect(kTagSequence, &lExtension))
+        {
+            std::span<const uint8_t> lOid, lValue, lKeyId;
+            TlvReader lParts(lExtension);
+            if (!lParts.expect(kTagOid, &lOid))
+                continue;
+            lParts.optional(kTagBoolean, &lIgnored);
+            if (!equal(lOid, kOidSubjectKeyId) || !lParts.expect(kTagOctetString, &lValue))
+                continue;
+            TlvReader lKeyReader(lValue);
+            if (lKeyReader.expect(kTagOctetString, &lKeyId))
+                aFields->puKeyId = lKeyId;
+        }
+    }
+    return true;
+}
+
+CertificateStore::~CertificateStore()
+{
+    close();
+}
+
+MMMReaderErrorCode CertificateStore::build(const CertificateSource &aSource, const std::string &aPath,
+                                           CertificateBuildStats *aStats, std::string *aError)
+{
+    *aStats = CertificateBuildStats();
+    std::vector<ListedFile> lListed;
+    const MMMReaderErrorCode lResult =
+        listFiles(aSource.puDirectory, aSource.puIncludeSubDirs, aSource.puExtensions, &lListed, aError);
+    if (lResult != NO_ERROR_OCCURRED)
+        return lResult;
+
+    std::vector<std::vector<uint8_t>> lCertificates;
+    std::unordered_set<std::string_view> lSeen;
+    std::vector<uint8_t> lFile;
+    std::vector<std::vector<uint8_t>> lFound;
+    for (const ListedFile &lListedFile : lListed)
+    {
+        if (!readFile(lListedFile.puPath, &lFile))
+        {
+            *aError = "cannot read '" + lListedFile.puPath + "'";
+            return ERROR_READING_FILE;
+        }
+        ++aStats->puFiles;
+        lFound.clear();
+        readCertificates(lFile, &lFound);
+        if (lFound.empty())
+            ++aStats->puSkipped;
+        for (std::vector<uint8_t> &lDer : lFound)
+        {
+            // The bytes of a vector stay put as the outer vector grows, so views stay valid.
+            const std::string_view lView(reinterpret_cast<const char *>(lDer.data()), lDer.size());
+            if (lSeen.count(lView))
+            {
+                ++aStats->puDuplicates;
+                continue;
+            }
+            lCertificates.push_back(std::move(lDer));
+            lSeen.insert(std::string_view(reinterpret_cast<const char *>(lCertificates.back().data()),
+                                          lCertificates.back().size()));
+        }
+    }
+    aStats->puCertificates = lCertificates.size();
+
+    // Lay the file out in memory: header, certificates, records, index.
+    std::vector<uint8_t> lOut(kFirstCertificate, 0);
+    std::vector<CertificateRecord> lRecords;
+    size_t lKeys = 0;
+    for (const std::vector<uint8_t> &lDer : lCertificates)
+    {
+        CertificateFields lFields;
+        parseCertificate(lDer, &lFields);
+        CertificateRecord lRecord = {};
+        lRecord.puOffset = lOut.size();
+        lRecord.puLength = static_cast<uint32_t>(lDer.size());
+        lRecord.puSubjectOffset = offsetIn(lDer, lFields.puSubject);
+        lRecord.puSubjectLength = static_cast<uint32_t>(lFields.puSubject.size());
+        lRecord.puIssuerOffset = offsetIn(lDer, lFields.puIssuer);
+        lRecord.puIssuerLength = static_cast<uint32_t>(lFields.puIssuer.size());
+        lRecord.puSerialOffset = offsetIn(lDer, lFields.puSerial);
+        lRecord.puSerialLength = static_cast<uint32_t>(lFields.puSerial.size());
+        if (!lFields.puKeyId.empty())
+        {
+            lRecord.puKeyIdOffset = offsetIn(lDer, lFields.puKeyId);
+            lRecord.puKeyIdLength = static_cast<uint32_t>(lFields.puKeyId.size());
+            ++lKeys;
+        }
+        lKeys += 2;
+        lRecords.push_back(lRecord);
+        lOut.insert(lOut.end(), lDer.begin(), lDer.end());
+        lOut.resize(alignUp(lOut.size()), 0);
+    }
+
+    // At most half full, so that a miss ends within a probe or two.
+    uint64_t lSlotCount = 16;
+    while (lSlotCount < lKeys * 2)
+        lSlotCount <<= 1;
+    std::vector<CertificateSlot> lSlots(lSlotCount, CertificateSlot{0, CK_NONE, 0});
+    auto lInsert = [&lSlots, lSlotCount](CertificateKey aKind, uint64_t aHash, uint32_t aRecord) {
+        uint64_t lAt = aHash & (lSlotCount - 1);
+        while (lSlots[lAt].puKind != CK_NONE)
+            lAt = (lAt + 1) & (lSlotCount - 1);
+        lSlots[lAt] = CertificateSlot{aHash, static_cast<uint32_t>(aKind), aRecord};
+    };
+    for (uint32_t i = 0; i < lRecords.size(); ++i)
+    {
+        CertificateFields lFields;
+        parseCertificate(lCertificates[i], &lFields);
+        if (!lFields.puKeyId.empty())
+            lInsert(CK_SUBJECT_KEY_ID, keyHash(CK_SUBJECT_KEY_ID, lFields.puKeyId), i);
+        lInsert(CK_SUBJECT, keyHash(CK_SUBJECT, lFields.puSubject), i);
+        std::vector<uint8_t> lIssuerSerial(lFields.puIssuer.begin(), lFields.puIssuer.end());
+        lIssuerSerial.insert(lIssuerSerial.end(), lFields.puSerial.begin(), lFields.puSerial.end());
+        lInsert(CK_ISSUER_SERIAL, keyHash(CK_ISSUER_SERIAL, lIssuerSerial), i);
+    }
+
+    CertificateStoreHeader lHeader = {};
+    lHeader.puVersion = kCertificateStoreVersion;
+    lHeader.puCertificates = lRecords.size();
+    lHeader.puSlots = lSlotCount;
+    lHeader.puRecordsOffset = lOut.size();
+    const uint8_t *lRecordBytes = reinterpret_cast<const uint8_t *>(lRecords.data());
+    lOut.insert(lOut.end(), lRecordBytes, lRecordBytes + lRecords.size() * sizeof(CertificateRecord));
+    lHeader.puSlotsOffset = lOut.size();
+    const uint8_t *lSlotBytes = reinterpret_cast<const uint8_t *>(lSlots.data());
+    lOut.insert(lOut.end(), lSlotBytes, lSlotBytes + lSlots.size() * sizeof(CertificateSlot));
+    lHeader.puLength = lOut.size();
+    std::memcpy(lOut.data(), &lHeader, sizeof(lHeader));
+
+    const std::string lTemporary = aPath + ".tmp";
+    const int lFd = ::open(lTemporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (lFd < 0)
+    {
+        *aError = "open " + lTemporary + ": " + std::strerror(errno);
+        return ERROR_WRITING_FILE;
+    }
+    lHeader.puMagic = kCertificateStoreMagic;
+    bool lWritten = writeAll(lFd, lOut.data(), lOut.size()) && ::fsync(lFd) == 0
+        && ::pwrite(lFd, &lHeader.puMagic, sizeof(lHeader.puMagic), 0) == static_cast<ssize_t>(sizeof(lHeader.puMagic));
+    if (!lWritten)
+        *aError = "write " + lTemporary + ": " + std::strerror(errno);
+    ::close(lFd);
+    if (lWritten && ::rename(lTemporary.c_str(), aPath.c_str()) != 0)
+    {
+        *aError = "rename " + lTemporary + ": " + std::strerror(errno);
+        lWritten = false;
+    }
+    if (!lWritten)
+    {
+        ::unlink(lTemporary.c_str());
+        return ERROR_WRITING_FILE;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode CertificateStore::open(const std::string &aPath, std::string *aError)
+{
+    close();
+    const int lFd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    struct stat lStat;
+    void *lMapping = MAP_FAILED;
+    if (::fstat(lFd, &lStat) == 0 && lStat.st_size >= static_cast<off_t>(kFirstCertificate))
+        lMapping = ::mmap(nullptr, static_cast<size_t>(lStat.st_size), PROT_READ, MAP_SHARED, lFd, 0);
+    const int lErrno = errno;
+    ::close(lFd);
+    if (lMapping == MAP_FAILED)
+    {
+        *aError = "mapping " + aPath + ": " + (lErrno ? std::strerror(lErrno) : "file too short");
+        return ERROR_OS_ERROR;
+    }
+    prData = static_cast<const uint8_t *>(lMapping);
+    prSize = static_cast<size_t>(lStat.st_size);
+
+    // The tables are checked once here, so that lookups can trust them.
+    const CertificateStoreHeader &lHeader = *reinterpret_cast<const CertificateStoreHeader *>(prData);
+    bool lValid = lHeader.puMagic == kCertificateStoreMagic && lHeader.puVersion == kCertificateStoreVersion
+        && lHeader.puLength == prSize && lHeader.puSlots != 0 && (lHeader.puSlots & (lHeader.puSlots - 1)) == 0
+        && lHeader.puRecordsOffset % 8 == 0 && lHeader.puRecordsOffset <= prSize
+        && lHeader.puCertificates <= (prSize - lHeader.puRecordsOffset) / sizeof(CertificateRecord)
+        && lHeader.puSlotsOffset == lHeader.puRecordsOffset + lHeader.puCertificates * sizeof(CertificateRecord)
+        && lHeader.puSlots == (prSize - lHeader.puSlotsOffset) / sizeof(CertificateSlot);
+    if (lValid)
+    {
+        prRecords = reinterpret_cast<const CertificateRecord *>(prData + lHeader.puRecordsOffset);
+        prRecordCount = static_cast<size_t>(lHeader.puCertificates);
+        prSlots = reinterpret_cast<const CertificateSlot *>(prData + lHeader.puSlotsOffset);
+        prSlotMask = lHeader.puSlots - 1;
+        for (size_t i = 0; lValid && i < prRecordCount; ++i)
+        {
+            const CertificateRecord &lRecord = prRecords[i];
+            lValid = lRecord.puOffset >= kFirstCertificate && lRecord.puOffset <= lHeader.puRecordsOffset
+                && lRecord.puLength <= lHeader.puRecordsOffset - lRecord.puOffset
+                && lRecord.puSubjectLength <= lRecord.puLength
+                && lRecord.puSubjectOffset <= lRecord.puLength - lRecord.puSubjectLength
+                && lRecord.puIssuerLength <= lRecord.puLength
+                && lRecord.puIssuerOffset <= lRecord.puLength - lRecord.puIssuerLength
+                && lRecord.puSerialLength <= lRecord.puLength
+                && lRecord.puSerialOffset <= lRecord.puLength - lRecord.puSerialLength
+                && lRecord.puKeyIdLength <= lRecord.puLength
+                && lRecord.puKeyIdOffset <= lRecord.puLength - lRecord.puKeyIdLength;
+        }
+        size_t lEmpty = 0;
+        for (uint64_t i = 0; lValid && i <= prSlotMask; ++i)
+        {
+            const CertificateSlot &lSlot = prSlots[i];
+            if (lSlot.puKind == CK_NONE)
+                ++lEmpty;
+            lValid = lSlot.puKind <= CK_ISSUER_SERIAL && (lSlot.puKind == CK_NONE || lSlot.puRecord < prRecordCount);
+        }
+        // A probe stops at an empty slot, so there must be one.
+        lValid = lValid && lEmpty > 0;
+    }
+    if (!lValid)
+    {
+        *aError = aPath + " is not a readerd certificate store";
+        close();
+        return ERROR_UNKNOWN_DATA_FORMAT;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+void CertificateStore::close()
+{
+    if (prData != nullptr)
+        ::munmap(const_cast<uint8_t *>(prData), prSize);
+    prData = nullptr;
+    prSize = 0;
+    prRecords = nullptr;
+    prRecordCount = 0;
+    prSlots = nullptr;
+    prSlotMask = 0;
+}
+
+std::span<const uint8_t> CertificateStore::field(const CertificateRecord &aRecord, uint32_t aOffset,
+                                                 uint32_t aLength) const
+{
+    return std::span<const uint8_t>(prData + aRecord.puOffset + aOffset, aLength);
+}
+
+bool CertificateStore::matches(const CertificateRecord &aRecord, CertificateKey aKind,
+                               std::span<const uint8_t> aKey) const
+{
+    switch (aKind)
+    {
+    case CK_SUBJECT_KEY_ID:
+        return aRecord.puKeyIdLength != 0 && equal(field(aRecord, aRecord.puKeyIdOffset, aRecord.puKeyIdLength), aKey);
+    case CK_SUBJECT:
+        return equal(field(aRecord, aRecord.puSubjectOffset, aRecord.puSubjectLength), aKey);
+    case CK_ISSUER_SERIAL:
+        return aKey.size() == size_t(aRecord.puIssuerLength) + aRecord.puSerialLength
+            && equal(field(aRecord, aRecord.puIssuerOffset, aRecord.puIssuerLength), aKey.first(aRecord.puIssuerLength))
+            && equal(field(aRecord, aRecord.puSerialOffset, aRecord.puSerialLength),
+                     aKey.subspan(aRecord.puIssuerLength));
+    default:
+        return false;
+    }
+}
+
+std::span<const uint8_t> CertificateStore::find(CertificateKey aKind, std::span<const uint8_t> aKey) const
+{
+    if (prSlots == nullptr || aKey.empty())
+        return {};
+    const uint64_t lHash = keyHash(aKind, aKey);
+    for (uint64_t lAt = lHash & prSlotMask;; lAt = (lAt + 1) & prSlotMask)
+    {
+        const CertificateSlot &lSlot = prSlots[lAt];
+        if (lSlot.puKind == CK_NONE)
+            return {};
+        const CertificateRecord &lRecord = prRecords[lSlot.puRecord];
+        if (lSlot.puHash == lHash && lSlot.puKind == static_cast<uint32_t>(aKind) && matches(lRecord, aKind, aKey))
+            return std::span<const uint8_t>(prData + lRecord.puOffset, lRecord.puLength);
+    }
+}
+
+std::span<const uint8_t> CertificateStore::findSigner(std::span<const uint8_t> aSignerIdentifier) const
+{
+    // SignerIdentifier ::= CHOICE { IssuerAndSerialNumber, [0] SubjectKeyIdentifier }.
+    TlvReader lReader(aSignerIdentifier);
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lContent;
+    if (!lReader.next(&lTag, &lContent))
+        return {};
+    if (lTag == kTagImplicit0)
+        return find(CK_SUBJECT_KEY_ID, lContent);
+    if (lTag != kTagSequence)
+        return {};
+
+    std::span<const uint8_t> lIssuer, lIgnored, lSerial;
+    TlvReader lFields(lContent);
+    if (!lFields.expect(kTagSequence, &lIgnored, &lIssuer) || !lFields.expect(kTagInteger, &lSerial))
+        return {};
+    std::vector<uint8_t> lKey(lIssuer.begin(), lIssuer.end());
+    lKey.insert(lKey.end(), lSerial.begin(), lSerial.end());
+    return find(CK_ISSUER_SERIAL, lKey);
+}
+
+std::span<const uint8_t> CertificateStore::findAuthority(std::span<const uint8_t> aAuthorityKeyId) const
+{
+    // AuthorityKeyIdentifier ::= SEQUENCE { [0] keyIdentifier OPTIONAL, [1] authorityCertIssuer
+    // GeneralNames OPTIONAL, [2] authorityCertSerialNumber OPTIONAL }.
+    std::span<const uint8_t> lContent, lKeyId, lNames, lSerial, lIssuer, lIgnored;
+    TlvReader lReader(aAuthorityKeyId);
+    if (!lReader.expect(kTagSequence, &lContent))
+        return {};
+    TlvReader lFields(lContent);
+    if (lFields.optional(kTagImplicit0, &lKeyId))
+    {
+        const std::span<const uint8_t> lFound = find(CK_SUBJECT_KEY_ID, lKeyId);
+        if (!lFound.empty())
+            return lFound;
+    }
+    if (!lFields.optional(kTagGeneralNames, &lNames) || !lFields.optional(kTagImplicit2, &lSerial))
+        return {};
+
+    // The issuer is the directoryName among the GeneralNames, an explicitly tagged Name.
+    TlvReader lNameReader(lNames);
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lName;
+    while (lNameReader.next(&lTag, &lName))
+    {
+        if (lTag != kTagDirectoryName)
+            continue;
+        TlvReader lDirectory(lName);
+        if (!lDirectory.expect(kTagSequence, &lIgnored, &lIssuer))
+            return {};
+        std::vector<uint8_t> lKey(lIssuer.begin(), lIssuer.end());
+        lKey.insert(lKey.end(), lSerial.begin(), lSerial.end());
+        return find(CK_ISSUER_SERIAL, lKey);
+    }
+    return {};
+}
+
+bool CertificateStore::provide(const char *aCertIdentifier, int aCertIdentifierLen, CERT_TYPE aCertType,
+                               char *aCertBuffer, int *aCertBufferLen) const
+{
+    if (aCertIdentifier == nullptr || aCertIdentifierLen <= 0 || aCertBufferLen == nullptr)
+        return false;
+    const std::span<const uint8_t> lIdentifier(reinterpret_cast<const uint8_t *>(aCertIdentifier),
+                                               static_cast<size_t>(aCertIdentifierLen));
+    std::span<const uint8_t> lFound;
+    if (aCertType == CT_DOC_SIGNER_CERT)
+        lFound = findSigner(lIdentifier);
+    else if (aCertType == CT_COUNTRY_SIGNER_CERT)
+        lFound = findAuthority(lIdentifier);
+    if (lFound.empty())
+        return false;
+
+    // Too small a buffer: say how much is needed, and the SDK calls again with that much.
+    const int lLength = static_cast<int>(lFound.size());
+    if (aCertBuffer == nullptr || *aCertBufferLen < lLength)
+    {
+        *aCertBufferLen = lLength;
+        return false;
+    }
+    std::memcpy(aCertBuffer, lFound.data(), lFound.size());
+    *aCertBufferLen = lLength;
+    return true;
+}
+
+bool CertificateStore::certificateCallback(void *aParam, char *aCertIdentifier, int aCertIdentifierLen,
+                                           CERT_TYPE aCertType, char *aCertBuffer, int *aCertBufferLen)
+{
+    const CertificateStore *lStore = static_cast<const CertificateStore *>(aParam);
+    return lStore != nullptr
+        && lStore->provide(aCertIdentifier, aCertIdentifierLen, aCertType, aCertBuffer, aCertBufferLen);
+}
+
+} // namespace readerd
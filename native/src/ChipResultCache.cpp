@@ -0,0 +1,83 @@
+#include "readerd/ChipResultCache.h"
+
+#include <algorithm>
+
+namespace readerd {
+
+namespace {
+
+std::string keyOf(std::span<const uint8_t> aEfSod)
+{
+    return std::string(reinterpret_cast<const char *>(aEfSod.data()), aEfSod.size());
+}
+
+} // namespace
+
+ChipResultCache::ChipResultCache(const ChipCacheOptions &aOptions)
+    : prOptions(aOptions)
+{
+}
+
+std::shared_ptr<const CachedChip> ChipResultCache::find(std::span<const uint8_t> aEfSod)
+{
+    // The whole EF.SOD is the key, so a hit is a byte for byte match, not a digest collision.
+    std::lock_guard<std::mutex> lLock(prMutex);
+    const auto lFound = prChips.find(keyOf(aEfSod));
+    if (lFound == prChips.end())
+        return nullptr;
+    if (lFound->second->puExpires <= std::chrono::steady_clock::now())
+    {
+        prChips.erase(lFound);
+        return nullptr;
+    }
+    return lFound->second;
+}
+
+void ChipResultCache::store(std::span<const uint8_t> aEfSod, CachedChip aChip)
+{
+    const auto lNow = std::chrono::steady_clock::now();
+    aChip.puExpires = lNow + prOptions.puTimeToLive;
+    auto lChip = std::make_shared<const CachedChip>(std::move(aChip));
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    std::string lKey = keyOf(aEfSod);
+    if (prChips.count(lKey) == 0 && prChips.size() >= prOptions.puMaxChips)
+    {
+        evictExpired(lNow);
+        if (prChips.size() >= prOptions.puMaxChips && !prChips.empty())
+        {
+            const auto lOldest =
+                std::min_element(prChips.begin(), prChips.end(), [](const auto &aLeft, const auto &aRight) {
+                    return aLeft.second->puExpires < aRight.second->puExpires;
+                });
+            prChips.erase(lOldest);
+        }
+    }
+    if (prOptions.puMaxChips > 0)
+        prChips[std::move(lKey)] = std::move(lChip);
+}
+
+void ChipResultCache::clear()
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prChips.clear();
+}
+
+size_t ChipResultCache::size() const
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    return prChips.size();
+}
+
+void ChipResultCache::evictExpired(std::chrono::steady_clock::time_point aNow)
+{
+    for (auto lIt = prChips.begin(); lIt != prChips.end();)
+    {
+        if (lIt->second->puExpires <= aNow)
+            lIt = prChips.erase(lIt);
+        else
+            ++lIt;
+    }
+}
+
+} // namespace readerd
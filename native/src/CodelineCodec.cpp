@@ -0,0 +1,327 @@
+#include "readerd/CodelineCodec.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace readerd {
+
+namespace {
+
+enum CodelineBit : uint32_t
+{
+    CB_LINE_COUNT = 1u << 18,
+    CB_DATE_OF_BIRTH = 1u << 19,
+    CB_EXPIRY_DATE = 1u << 20,
+    CB_SHORT_SEX = 1u << 21,
+    CB_CHECK_DIGITS = 1u << 22,
+    CB_VALIDATION_RESULT = 1u << 23,
+    CB_FLAGS = 1u << 24,
+    CB_IMAGE_SOURCE = 1u << 25,
+    CB_DATA_FROM_LINES = 1u << 26,
+};
+
+// Where each CodelineField lives in the struct, and how long it may be.
+struct FieldSlot
+{
+    size_t puOffset;
+    size_t puSize;
+    const char *puName;
+};
+
+#define READERD_FIELD(aMember) \
+    FieldSlot{offsetof(MMMReaderCodelineData, aMember), sizeof(MMMReaderCodelineData::aMember), #aMember}
+
+const FieldSlot kFieldSlots[CF_STRING_COUNT] = {
+    READERD_FIELD(Data),
+    READERD_FIELD(Line1),
+    READERD_FIELD(Line2),
+    READERD_FIELD(Line3),
+    READERD_FIELD(DocId),
+    READERD_FIELD(DocType),
+    READERD_FIELD(Surname),
+    READERD_FIELD(Forename),
+    READERD_FIELD(SecondName),
+    READERD_FIELD(Forenames),
+    READERD_FIELD(DateOfBirthMRZ),
+    READERD_FIELD(ExpiryDateMRZ),
+    READERD_FIELD(IssuingState),
+    READERD_FIELD(Nationality),
+    READERD_FIELD(DocNumber),
+    READERD_FIELD(Sex),
+    READERD_FIELD(OptionalData1),
+    READERD_FIELD(OptionalData2),
+};
+
+#undef READERD_FIELD
+
+std::string joinLines(std::string_view aLine1, std::string_view aLine2, std::string_view aLine3, int aLineCount)
+{
+    std::string lJoined(aLine1);
+    if (aLineCount >= 2)
+        lJoined.append("\r").append(aLine2);
+    if (aLineCount >= 3)
+        lJoined.append("\r").append(aLine3);
+    return lJoined;
+}
+
+void putVarint(std::vector<uint8_t> *aOut, uint32_t aValue)
+{
+    while (aValue >= 0x80)
+    {
+        aOut->push_back(static_cast<uint8_t>(aValue | 0x80));
+        aValue >>= 7;
+    }
+    aOut->push_back(static_cast<uint8_t>(aValue));
+}
+
+void putSigned(std::vector<uint8_t> *aOut, int aValue)
+{
+    putVarint(aOut, (static_cast<uint32_t>(aValue) << 1) ^ static_cast<uint32_t>(aValue >> 31));
+}
+
+// Bounds-checked cursor over the encoded bytes; once a read fails every later one fails too.
+class ByteReader
+{
+public:
+    explicit ByteReader(std::span<const uint8_t> aBytes)
+        : prBytes(aBytes)
+    {
+    }
+
+    bool ok() const { return prOk; }
+
+    uint8_t byte()
+    {
+        if (prOffset >= prBytes.size())
+        {
+            prOk = false;
+            return 0;
+        }
+        return prBytes[prOffset++];
+    }
+
+    uint32_t varint()
+    {
+        uint32_t lValue = 0;
+        for (int lShift = 0; lShift < 35; lShift += 7)
+        {
+            const uint8_t lByte = byte();
+            lValue |= static_cast<uint32_t>(lByte & 0x7F) << lShift;
+            if ((lByte & 0x80) == 0)
+                return lValue;
+        }
+        prOk = false;
+        return 0;
+    }
+
+    int signedVarint()
+    {
+        const uint32_t lValue = varint();
+        return static_cast<int>((lValue >> 1) ^ (0u - (lValue & 1)));
+    }
+
+    std::string_view string(size_t aMaxLength)
+    {
+        const uint32_t lLength = varint();
+        if (!prOk || lLength > aMaxLength || lLength > prBytes.size() - prOffset)
+        {
+            prOk = false;
+            return {};
+        }
+        const std::string_view lView(reinterpret_cast<const char *>(prBytes.data() + prOffset), lLength);
+        prOffset += lLength;
+        return lView;
+    }
+
+private:
+    std::span<const uint8_t> prBytes;
+    size_t prOffset = 0;
+    bool prOk = true;
+};
+
+} // namespace
+
+const char *codelineFieldName(CodelineField aField)
+{
+    return aField >= 0 && aField < CF_STRING_COUNT ? kFieldSlots[aField].puName : "unknown";
+}
+
+std::string_view codelineField(const MMMReaderCodelineData &aData, CodelineField aField)
+{
+    const char *lChars = reinterpret_cast<const char *>(&aData) + kFieldSlots[aField].puOffset;
+    return std::string_view(lChars, strnlen(lChars, kFieldSlots[aField].puSize));
+}
+
+size_t encodeCodeline(const MMMReaderCodelineData &aData, std::vector<uint8_t> *aOut)
+{
+    const size_t lStart = aOut->size();
+    std::array<std::string_view, CF_STRING_COUNT> lStrings;
+    uint32_t lPresence = 0;
+    for (int i = 0; i < CF_STRING_COUNT; ++i)
+    {
+        lStrings[i] = codelineField(aData, static_cast<CodelineField>(i));
+        lPresence |= lStrings[i].empty() ? 0u : 1u << i;
+    }
+    if (!lStrings[CF_DATA].empty()
+        && lStrings[CF_DATA] == joinLines(lStrings[CF_LINE1], lStrings[CF_LINE2], lStrings[CF_LINE3], aData.LineCount))
+        lPresence = (lPresence & ~1u) | CB_DATA_FROM_LINES;
+
+    const bool lHasDateOfBirth = aData.DateOfBirth.Day || aData.DateOfBirth.Month || aData.DateOfBirth.Year;
+    const bool lHasExpiryDate = aData.ExpiryDate.Day || aData.ExpiryDate.Month || aData.ExpiryDate.Year;
+    // The SDK structs are packed, so the count is copied out before std::clamp binds to it.
+    const int lListCount = aData.CheckDigitDataListCount;
+    const int lCheckDigitCount = std::clamp(lListCount, 0, MAX_CHECKDIGITDATA_COUNT);
+    const uint8_t lFlags = (aData.MrzOnRearSide ? 1 : 0) | (aData.ExpiredDocumentFlag ? 2 : 0);
+    if (aData.LineCount)
+        lPresence |= CB_LINE_COUNT;
+    if (lHasDateOfBirth)
+        lPresence |= CB_DATE_OF_BIRTH;
+    if (lHasExpiryDate)
+        lPresence |= CB_EXPIRY_DATE;
+    if (aData.ShortSex)
+        lPresence |= CB_SHORT_SEX;
+    if (lCheckDigitCount)
+        lPresence |= CB_CHECK_DIGITS;
+    if (aData.CodelineValidationResult != CDR_Invalid)
+        lPresence |= CB_VALIDATION_RESULT;
+    if (lFlags)
+        lPresence |= CB_FLAGS;
+    if (aData.ImageSource)
+        lPresence |= CB_IMAGE_SOURCE;
+
+    aOut->push_back(kCodelineCodecVersion);
+    putVarint(aOut, lPresence);
+    for (int i = 0; i < CF_STRING_COUNT; ++i)
+    {
+        if ((lPresence & (1u << i)) == 0)
+            continue;
+        putVarint(aOut, static_cast<uint32_t>(lStrings[i].size()));
+        aOut->insert(aOut->end(), lStrings[i].begin(), lStrings[i].end());
+    }
+    if (lPresence & CB_LINE_COUNT)
+        putSigned(aOut, aData.LineCount);
+    for (const MMMReaderDate *lDate : {lHasDateOfBirth ? &aData.DateOfBirth : nullptr,
+                                       lHasExpiryDate ? &aData.ExpiryDate : nullptr})
+    {
+        if (lDate == nullptr)
+            continue;
+        putSigned(aOut, lDate->Day);
+        putSigned(aOut, lDate->Month);
+        putSigned(aOut, lDate->Year);
+    }
+    if (lPresence & CB_SHORT_SEX)
+        aOut->push_back(static_cast<uint8_t>(aData.ShortSex));
+    if (lPresence & CB_CHECK_DIGITS)
+    {
+        putVarint(aOut, static_cast<uint32_t>(lCheckDigitCount));
+        for (int i = 0; i < lCheckDigitCount; ++i)
+        {
+            const MMMReaderCodelineCheckDigitData &lDigit = aData.CheckDigitDataList[i];
+            aOut->push_back(static_cast<uint8_t>(lDigit.puCheckDigitType));
+            aOut->push_back(static_cast<uint8_t>(lDigit.puCodelineNumber));
+            putSigned(aOut, lDigit.puCodelinePos);
+            aOut->push_back(static_cast<uint8_t>(lDigit.puValueExpected));
+            aOut->push_back(static_cast<uint8_t>(lDigit.puValueRead));
+            aOut->push_back(static_cast<uint8_t>(lDigit.puResult));
+        }
+    }
+    if (lPresence & CB_VALIDATION_RESULT)
+        putSigned(aOut, aData.CodelineValidationResult);
+    if (lPresence & CB_FLAGS)
+        aOut->push_back(lFlags);
+    if (lPresence & CB_IMAGE_SOURCE)
+        putSigned(aOut, aData.ImageSource);
+    return aOut->size() - lStart;
+}
+
+bool CodelineView::parse(std::span<const uint8_t> aBytes)
+{
+    *this = CodelineView();
+    ByteReader lReader(aBytes);
+    if (lReader.byte() != kCodelineCodecVersion)
+        return false;
+    const uint32_t lPresence = lReader.varint();
+
+    for (int i = 0; i < CF_STRING_COUNT; ++i)
+    {
+        if (lPresence & (1u << i))
+            prStrings[i] = lReader.string(kFieldSlots[i].puSize);
+    }
+    prDataFromLines = (lPresence & CB_DATA_FROM_LINES) != 0;
+    if (lPresence & CB_LINE_COUNT)
+        prLineCount = lReader.signedVarint();
+    for (MMMReaderDate *lDate : {(lPresence & CB_DATE_OF_BIRTH) ? &prDateOfBirth : nullptr,
+                                 (lPresence & CB_EXPIRY_DATE) ? &prExpiryDate : nullptr})
+    {
+        if (lDate == nullptr)
+            continue;
+        lDate->Day = lReader.signedVarint();
+        lDate->Month = lReader.signedVarint();
+        lDate->Year = lReader.signedVarint();
+    }
+    if (lPresence & CB_SHORT_SEX)
+        prShortSex = static_cast<char>(lReader.byte());
+    if (lPresence & CB_CHECK_DIGITS)
+    {
+        prCheckDigitCount = lReader.varint();
+        if (prCheckDigitCount > prCheckDigits.size())
+            return false;
+        for (size_t i = 0; i < prCheckDigitCount; ++i)
+        {
+            MMMReaderCodelineCheckDigitData &lDigit = prCheckDigits[i];
+            lDigit.puCheckDigitType = static_cast<MMMReaderCheckDigitType>(lReader.byte());
+            lDigit.puCodelineNumber = lReader.byte();
+            lDigit.puCodelinePos = lReader.signedVarint();
+            lDigit.puValueExpected = static_cast<char>(lReader.byte());
+            lDigit.puValueRead = static_cast<char>(lReader.byte());
+            lDigit.puResult = static_cast<MMMReaderCheckDigitResult>(lReader.byte());
+        }
+    }
+    if (lPresence & CB_VALIDATION_RESULT)
+        prValidationResult = static_cast<MMMReaderCheckDigitResult>(lReader.signedVarint());
+    if (lPresence & CB_FLAGS)
+    {
+        const uint8_t lFlags = lReader.byte();
+        prMrzOnRearSide = (lFlags & 1) != 0;
+        prExpiredDocumentFlag = (lFlags & 2) != 0;
+    }
+    if (lPresence & CB_IMAGE_SOURCE)
+        prImageSource = lReader.signedVarint();
+    return lReader.ok();
+}
+
+std::string CodelineView::data() const
+{
+    if (!prDataFromLines)
+        return std::string(prStrings[CF_DATA]);
+    return joinLines(prStrings[CF_LINE1], prStrings[CF_LINE2], prStrings[CF_LINE3], prLineCount);
+}
+
+void CodelineView::toStruct(MMMReaderCodelineData *aData) const
+{
+    std::memset(aData, 0, sizeof(*aData));
+    char *lBase = reinterpret_cast<char *>(aData);
+    for (int i = 0; i < CF_STRING_COUNT; ++i)
+    {
+        if (!prStrings[i].empty())
+            std::memcpy(lBase + kFieldSlots[i].puOffset, prStrings[i].data(), prStrings[i].size());
+    }
+    if (prDataFromLines)
+    {
+        const std::string lData = data();
+        std::memcpy(aData->Data, lData.data(), lData.size() < sizeof(aData->Data) ? lData.size() : sizeof(aData->Data));
+    }
+    aData->LineCount = prLineCount;
+    aData->DateOfBirth = prDateOfBirth;
+    aData->ExpiryDate = prExpiryDate;
+    aData->ShortSex = prShortSex;
+    std::memcpy(aData->CheckDigitDataList, prCheckDigits.data(), prCheckDigitCount * sizeof(prCheckDigits[0]));
+    aData->CheckDigitDataListCount = static_cast<int>(prCheckDigitCount);
+    aData->CodelineValidationResult = prValidationResult;
+    aData->MrzOnRearSide = prMrzOnRearSide;
+    aData->ExpiredDocumentFlag = prExpiredDocumentFlag;
+    aData->ImageSource = prImageSource;
+}
+
+} // namespace readerd
@@ -0,0 +1,319 @@
+#include "readerd/CorpusPack.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace readerd {
+
+namespace {
+
+// File contents start on a cache line, for the image kernels that read them in place.
+constexpr uint64_t kContentAlignment = 64;
+constexpr uint64_t kFirstContent = (sizeof(CorpusPackHeader) + kContentAlignment - 1) & ~(kContentAlignment - 1);
+
+uint64_t alignUp(uint64_t aOffset)
+{
+    return (aOffset + kContentAlignment - 1) & ~(kContentAlignment - 1);
+}
+
+bool pwriteAll(int aFd, const void *aData, size_t aLen, uint64_t aOffset)
+{
+    const uint8_t *lData = static_cast<const uint8_t *>(aData);
+    while (aLen > 0)
+    {
+        const ssize_t lWritten = ::pwrite(aFd, lData, aLen, static_cast<off_t>(aOffset));
+        if (lWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        lData += lWritten;
+        aLen -= static_cast<size_t>(lWritten);
+        aOffset += static_cast<uint64_t>(lWritten);
+    }
+    return true;
+}
+
+// Copies the file at aPath to aOffset in aFd, through the kernel where it can.
+bool copyInto(int aFd, uint64_t aOffset, const std::string &aPath, uint64_t aLength, std::string *aError)
+{
+    const int lIn = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lIn < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return false;
+    }
+    loff_t lOut = static_cast<loff_t>(aOffset);
+    uint64_t lLeft = aLength;
+    while (lLeft > 0)
+    {
+        const ssize_t lCopied = ::copy_file_range(lIn, nullptr, aFd, &lOut, lLeft, 0);
+        if (lCopied > 0)
+        {
+            lLeft -= static_cast<uint64_t>(lCopied);
+            continue;
+        }
+        if (lCopied < 0 && errno == EINTR)
+            continue;
+        if (lCopied == 0)
+            break;
+        // Filesystems without copy_file_range between them: fall back to read and write.
+        std::vector<uint8_t> lBuffer(std::min<uint64_t>(lLeft, 1u << 20));
+        const uint64_t lDone = aLength - lLeft;
+        const ssize_t lRead = ::pread(lIn, lBuffer.data(), lBuffer.size(), static_cast<off_t>(lDone));
+        if (lRead <= 0 || !pwriteAll(aFd, lBuffer.data(), static_cast<size_t>(lRead), static_cast<uint64_t>(lOut)))
+            break;
+        lOut += lRead;
+        lLeft -= static_cast<uint64_t>(lRead);
+    }
+    const int lErrno = errno;
+    ::close(lIn);
+    if (lLeft > 0)
+    {
+        *aError = "copy " + aPath + ": " + (lErrno ? std::strerror(lErrno) : "file shrank while packing");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+CorpusPack::~CorpusPack()
+{
+    close();
+}
+
+MMMReaderErrorCode CorpusPack::write(const std::vector<std::string> &aScanDirectories, const std::string &aPath,
+                                     std::string *aError)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<CorpusPackEntry> lEntries;
+    std::vector<CorpusPackFile> lFiles;
+    std::string lNames;
+    std::vector<std::pair<std::string, uint64_t>> lSources;    // Path and size, per file.
+
+    uint64_t lOffset = kFirstContent;
+    for (const std::string &lDirectory : aScanDirectories)
+    {
+        std::error_code lError;
+        std::vector<fs::directory_entry> lDirEntries;
+        for (fs::directory_iterator lDir(lDirectory, lError), lEnd; !lError && lDir != lEnd; lDir.increment(lError))
+        {
+            if (lDir->is_regular_file())
+                lDirEntries.push_back(*lDir);
+        }
+        if (lError)
+        {
+            *aError = "cannot read scan directory '" + lDirectory + "': " + lError.message();
+            return ERROR_READING_FILE;
+        }
+        // Name order, so a pack of the same corpus is the same file.
+        std::sort(lDirEntries.begin(), lDirEntries.end());
+
+        lEntries.push_back(CorpusPackEntry{lNames.size(), static_cast<uint32_t>(lDirectory.size()),
+                                           static_cast<uint32_t>(lDirEntries.size()), lFiles.size()});
+        lNames += lDirectory;
+        for (const fs::directory_entry &lEntry : lDirEntries)
+        {
+            const std::string lName = lEntry.path().filename().string();
+            const uint64_t lLength = lEntry.file_size(lError);
+            if (lError)
+            {
+                *aError = "cannot stat '" + lEntry.path().string() + "': " + lError.message();
+                return ERROR_READING_FILE;
+            }
+            lFiles.push_back(CorpusPackFile{lOffset, lLength, lNames.size(), lName.size()});
+            lNames += lName;
+            lSources.emplace_back(lEntry.path().string(), lLength);
+            lOffset = alignUp(lOffset + lLength);
+        }
+    }
+
+    // Written beside aPath and renamed over it once complete, so an existing pack is replaced
+    // whole or not at all.
+    const std::string lTemporary = aPath + ".tmp";
+    const int lFd = ::open(lTemporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (lFd < 0)
+    {
+        *aError = "open " + lTemporary + ": " + std::strerror(errno);
+        return ERROR_WRITING_FILE;
+    }
+
+    MMMReaderErrorCode lResult = NO_ERROR_OCCURRED;
+    for (size_t i = 0; i < lFiles.size() && lResult == NO_ERROR_OCCURRED; ++i)
+    {
+        if (!copyInto(lFd, lFiles[i].puOffset, lSources[i].first, lSources[i].second, aError))
+            lResult = ERROR_READING_FILE;
+    }
+
+    CorpusPackHeader lHeader{0, kCorpusPackVersion, lEntries.size(), lOffset, 0};
+    if (lResult == NO_ERROR_OCCURRED)
+    {
+        const uint64_t lEntryBytes = lEntries.size() * sizeof(CorpusPackEntry);
+        const uint64_t lFileBytes = lFiles.size() * sizeof(CorpusPackFile);
+        lHeader.puIndexLength = lEntryBytes + lFileBytes + lNames.size();
+        if (!pwriteAll(lFd, lEntries.data(), lEntryBytes, lOffset)
+            || !pwriteAll(lFd, lFiles.data(), lFileBytes, lOffset + lEntryBytes)
+            || !pwriteAll(lFd, lNames.data(), lNames.size(), lOffset + lEntryBytes + lFileBytes)
+            || !pwriteAll(lFd, &lHeader, sizeof(lHeader), 0) || ::fsync(lFd) != 0)
+        {
+            *aError = "write " + lTemporary + ": " + std::strerror(errno);
+            lResult = ERROR_WRITING_FILE;
+        }
+    }
+    if (lResult == NO_ERROR_OCCURRED)
+    {
+        // The magic goes last and is synced before the rename, so the pack at aPath never
+        // carries it without the rest.
+        lHeader.puMagic = kCorpusPackMagic;
+        if (!pwriteAll(lFd, &lHeader.puMagic, sizeof(lHeader.puMagic), 0) || ::fsync(lFd) != 0)
+        {
+            *aError = "write " + lTemporary + ": " + std::strerror(errno);
+            lResult = ERROR_WRITING_FILE;
+        }
+    }
+    ::close(lFd);
+    if (lResult == NO_ERROR_OCCURRED && ::rename(lTemporary.c_str(), aPath.c_str()) != 0)
+    {
+        *aError = "rename " + lTemporary + ": " + std::strerror(errno);
+        lResult = ERROR_WRITING_FILE;
+    }
+    if (lResult != NO_ERROR_OCCURRED)
+        ::unlink(lTemporary.c_str());
+    return lResult;
+}
+
+bool CorpusPack::isPack(const std::string &aPath)
+{
+    const int lFd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+        return false;
+    uint32_t lMagic = 0;
+    const bool lIsPack = ::pread(lFd, &lMagic, sizeof(lMagic), 0) == static_cast<ssize_t>(sizeof(lMagic))
+        && lMagic == kCorpusPackMagic;
+    ::close(lFd);
+    return lIsPack;
+}
+
+MMMReaderErrorCode CorpusPack::open(const std::string &aPath, std::string *aError)
+{
+    close();
+    const int lFd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    struct stat lStat;
+    void *lMapping = MAP_FAILED;
+    if (::fstat(lFd, &lStat) == 0 && lStat.st_size >= static_cast<off_t>(sizeof(CorpusPackHeader)))
+        lMapping = ::mmap(nullptr, static_cast<size_t>(lStat.st_size), PROT_READ, MAP_SHARED, lFd, 0);
+    const int lErrno = errno;
+    ::close(lFd);
+    if (lMapping == MAP_FAILED)
+    {
+        *aError = "mapping " + aPath + ": " + (lErrno ? std::strerror(lErrno) : "file too short");
+        return ERROR_OS_ERROR;
+    }
+    prData = static_cast<const uint8_t *>(lMapping);
+    prSize = static_cast<size_t>(lStat.st_size);
+
+    // The index is checked once here, so that name() and files() can trust it.
+    const CorpusPackHeader &lHeader = *reinterpret_cast<const CorpusPackHeader *>(prData);
+    bool lValid = lHeader.puMagic == kCorpusPackMagic && lHeader.puVersion == kCorpusPackVersion
+        && lHeader.puIndexOffset % alignof(CorpusPackEntry) == 0 && lHeader.puIndexOffset <= prSize
+        && lHeader.puIndexLength <= prSize - lHeader.puIndexOffset
+        && lHeader.puEntries <= lHeader.puIndexLength / sizeof(CorpusPackEntry);
+    if (lValid)
+    {
+        prEntries = reinterpret_cast<const CorpusPackEntry *>(prData + lHeader.puIndexOffset);
+        prEntryCount = static_cast<size_t>(lHeader.puEntries);
+        prFiles = reinterpret_cast<const CorpusPackFile *>(prEntries + prEntryCount);
+        const uint64_t lFileCount = prEntryCount ? prEntries[prEntryCount - 1].puFirstFile
+                                                       + prEntries[prEntryCount - 1].puFiles
+                                                 : 0;
+        const uint64_t lRest = lHeader.puIndexLength - prEntryCount * sizeof(CorpusPackEntry);
+        lValid = lFileCount <= lRest / sizeof(CorpusPackFile);
+        prNames = reinterpret_cast<const char *>(prFiles + lFileCount);
+        const uint64_t lNameBytes = lValid ? lRest - lFileCount * sizeof(CorpusPackFile) : 0;
+
+        uint64_t lNextFile = 0;
+        for (size_t i = 0; lValid && i < prEntryCount; ++i)
+        {
+            const CorpusPackEntry &lEntry = prEntries[i];
+            lValid = lEntry.puFirstFile == lNextFile && lEntry.puNameOffset <= lNameBytes
+                && lEntry.puNameLength <= lNameBytes - lEntry.puNameOffset;
+            lNextFile += lEntry.puFiles;
+        }
+        for (uint64_t i = 0; lValid && i < lFileCount; ++i)
+        {
+            const CorpusPackFile &lFile = prFiles[i];
+            lValid = lFile.puOffset <= lHeader.puIndexOffset && lFile.puLength <= lHeader.puIndexOffset - lFile.puOffset
+                && lFile.puNameOffset <= lNameBytes && lFile.puNameLength <= lNameBytes - lFile.puNameOffset;
+            prContentBytes += lFile.puLength;
+        }
+    }
+    if (!lValid)
+    {
+        *aError = aPath + " is not a readerd corpus pack";
+        close();
+        return ERROR_UNKNOWN_DATA_FORMAT;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+void CorpusPack::close()
+{
+    if (prData != nullptr)
+        ::munmap(const_cast<uint8_t *>(prData), prSize);
+    prData = nullptr;
+    prSize = 0;
+    prEntries = nullptr;
+    prEntryCount = 0;
+    prFiles = nullptr;
+    prNames = nullptr;
+    prContentBytes = 0;
+}
+
+std::string_view CorpusPack::name(size_t aEntry) const
+{
+    const CorpusPackEntry &lEntry = prEntries[aEntry];
+    return std::string_view(prNames + lEntry.puNameOffset, lEntry.puNameLength);
+}
+
+void CorpusPack::files(size_t aEntry, std::vector<ScanFile> *aFiles) const
+{
+    const CorpusPackEntry &lEntry = prEntries[aEntry];
+    aFiles->clear();
+    for (uint64_t i = lEntry.puFirstFile; i < lEntry.puFirstFile + lEntry.puFiles; ++i)
+    {
+        const CorpusPackFile &lFile = prFiles[i];
+        aFiles->push_back(ScanFile{std::string_view(prNames + lFile.puNameOffset, lFile.puNameLength),
+                                   std::span<const uint8_t>(prData + lFile.puOffset, lFile.puLength)});
+    }
+}
+
+void CorpusPack::prefetch(size_t aEntry) const
+{
+    const CorpusPackEntry &lEntry = prEntries[aEntry];
+    if (lEntry.puFiles == 0)
+        return;
+    // An entry's files are contiguous, so one advice covers them.
+    const CorpusPackFile &lFirst = prFiles[lEntry.puFirstFile];
+    const CorpusPackFile &lLast = prFiles[lEntry.puFirstFile + lEntry.puFiles - 1];
+    const uintptr_t lPage = static_cast<uintptr_t>(::sysconf(_SC_PAGESIZE));
+    const uintptr_t lStart = reinterpret_cast<uintptr_t>(prData + lFirst.puOffset) & ~(lPage - 1);
+    const uintptr_t lEnd = reinterpret_cast<uintptr_t>(prData + lLast.puOffset + lLast.puLength);
+    if (lEnd > lStart)
+        ::madvise(reinterpret_cast<void *>(lStart), lEnd - lStart, MADV_WILLNEED);
+}
+
+} // namespace readerd
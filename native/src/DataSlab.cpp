@@ -0,0 +1,55 @@
+#include "readerd/DataSlab.h"
+
+#include "readerd/BufferPool.h"
+
+#include <cstring>
+
+namespace readerd {
+
+DataRef DataRef::copyOf(const void *aData, size_t aLen)
+{
+    if (aLen == 0)
+        return DataRef();
+
+    // for_overwrite: the slab is filled immediately, so skip zero-initialising megabytes.
+    std::shared_ptr<uint8_t[]> lSlab = std::make_shared_for_overwrite<uint8_t[]>(aLen);
+    std::memcpy(lSlab.get(), aData, aLen);
+    const uint8_t *lBytes = lSlab.get();
+    return DataRef(std::move(lSlab), std::span<const uint8_t>(lBytes, aLen));
+}
+
+DataRef DataRef::copyOf(const void *aData, size_t aLen, BufferPool *aPool)
+{
+    if (aPool == nullptr || aLen == 0)
+        return copyOf(aData, aLen);
+
+    std::shared_ptr<uint8_t[]> lSlab = aPool->acquire(aLen);
+    std::memcpy(lSlab.get(), aData, aLen);
+    return adopt(std::move(lSlab), aLen);
+}
+
+DataRef DataRef::adopt(std::shared_ptr<const uint8_t[]> aSlab, size_t aLen)
+{
+    if (!aSlab || aLen == 0)
+        return DataRef();
+    const uint8_t *lBytes = aSlab.get();
+    return DataRef(std::move(aSlab), std::span<const uint8_t>(lBytes, aLen));
+}
+
+DataRef DataRef::slice(size_t aOffset, size_t aLen) const
+{
+    if (aOffset > prBytes.size())
+        aOffset = prBytes.size();
+    if (aLen > prBytes.size() - aOffset)
+        aLen = prBytes.size() - aOffset;
+    return DataRef(prSlab, prBytes.subspan(aOffset, aLen));
+}
+
+DataRef DataItem::retain() const
+{
+    if (prPinned.empty() && !prBytes.empty())
+        prPinned = DataRef::copyOf(prBytes.data(), prBytes.size(), prPool);
+    return prPinned;
+}
+
+} // namespace readerd
@@ -0,0 +1,200 @@
+#include "readerd/EventBus.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace readerd {
+
+namespace {
+
+// Empty polls a subscriber makes before it goes to sleep. Documents arrive as bursts of
+// items, so a short spin usually catches the next one without a futex round trip.
+constexpr int kSpinPolls = 64;
+
+} // namespace
+
+EventBus::EventBus(size_t aCapacity)
+    : prCapacity(aCapacity)
+{
+}
+
+EventBus::~EventBus()
+{
+    stop();
+}
+
+void EventBus::subscribe(DataConsumer *aHandler)
+{
+    prSubscribers.push_back(std::make_unique<Subscriber>(aHandler, prCapacity));
+}
+
+void EventBus::start()
+{
+    if (prRunning.exchange(true))
+        return;
+    for (auto &lSubscriber : prSubscribers)
+        lSubscriber->puThread = std::thread(&EventBus::subscriberLoop, this, lSubscriber.get());
+}
+
+void EventBus::stop()
+{
+    if (!prRunning.exchange(false))
+        return;
+    for (auto &lSubscriber : prSubscribers)
+    {
+        lSubscriber->puSleeping.store(false);
+        lSubscriber->puSignal.fetch_add(1);
+        lSubscriber->puSignal.notify_one();
+    }
+    for (auto &lSubscriber : prSubscribers)
+        lSubscriber->puThread.join();
+}
+
+void EventBus::drain()
+{
+    for (auto &lSubscriber : prSubscribers)
+    {
+        while (prRunning && lSubscriber->puHandled.load() < lSubscriber->puQueued.load())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void EventBus::onData(const DataItem &aItem)
+{
+    if (prSubscribers.empty())
+        return;
+    BusMessage lMessage;
+    lMessage.puKind = BM_DATA;
+    lMessage.puCode = static_cast<uint32_t>(aItem.type());
+    lMessage.puDocument = aItem.document();
+    lMessage.puPayload = aItem.retain();
+    publish(std::move(lMessage));
+}
+
+void EventBus::onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument)
+{
+    BusMessage lMessage;
+    lMessage.puKind = BM_EVENT;
+    lMessage.puCode = static_cast<uint32_t>(aEventCode);
+    lMessage.puDocument = aDocument;
+    publish(std::move(lMessage));
+}
+
+void EventBus::onError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg, uint32_t aDocument)
+{
+    const char *lText = aErrorMsg ? aErrorMsg : "";
+    BusMessage lMessage;
+    lMessage.puKind = BM_ERROR;
+    lMessage.puCode = static_cast<uint32_t>(aErrorCode);
+    lMessage.puDocument = aDocument;
+    lMessage.puPayload = DataRef::copyOf(lText, std::strlen(lText) + 1);
+    publish(std::move(lMessage));
+}
+
+EventBus::Stats EventBus::stats() const
+{
+    Stats lStats;
+    for (const auto &lSubscriber : prSubscribers)
+    {
+        lStats.puDelivered += lSubscriber->puHandled.load();
+        lStats.puDropped += lSubscriber->puDropped.load();
+        const size_t lDepth = lSubscriber->puMaxDepth.load();
+        lStats.puMaxDepth = lDepth > lStats.puMaxDepth ? lDepth : lStats.puMaxDepth;
+    }
+    return lStats;
+}
+
+void EventBus::publish(BusMessage &&aMessage)
+{
+    for (size_t i = 0; i < prSubscribers.size(); ++i)
+    {
+        Subscriber &lSubscriber = *prSubscribers[i];
+        const size_t lCapacity = lSubscriber.puRing.capacity();
+        const size_t lLimit = aMessage.puKind == BM_DATA ? lCapacity - lCapacity / 8 : lCapacity;
+        BusMessage lCopy = i + 1 < prSubscribers.size() ? aMessage : std::move(aMessage);
+        if (!lSubscriber.puRing.tryPush(std::move(lCopy), lLimit))
+        {
+            ++lSubscriber.puDropped;
+            continue;
+        }
+        ++lSubscriber.puQueued;
+
+        const size_t lDepth = lSubscriber.puRing.size();
+        if (lDepth > lSubscriber.puMaxDepth.load(std::memory_order_relaxed))
+            lSubscriber.puMaxDepth.store(lDepth, std::memory_order_relaxed);
+
+        // Pairs with the fence in subscriberLoop(); only a producer that finds the
+        // subscriber asleep pays for the wake-up.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (lSubscriber.puSleeping.load(std::memory_order_relaxed))
+            wake(lSubscriber);
+    }
+}
+
+void EventBus::wake(Subscriber &aSubscriber)
+{
+    if (aSubscriber.puSleeping.exchange(false))
+    {
+        aSubscriber.puSignal.fetch_add(1, std::memory_order_release);
+        aSubscriber.puSignal.notify_one();
+    }
+}
+
+void EventBus::subscriberLoop(Subscriber *aSubscriber)
+{
+    BusMessage lMessage;
+    int lIdlePolls = 0;
+    for (;;)
+    {
+        if (aSubscriber->puRing.tryPop(&lMessage))
+        {
+            deliver(*aSubscriber->puHandler, lMessage);
+            lMessage = BusMessage();
+            ++aSubscriber->puHandled;
+            lIdlePolls = 0;
+            continue;
+        }
+        // After stop(), keep going until a push that raced with it has been published.
+        if (!prRunning.load())
+        {
+            if (aSubscriber->puRing.size() == 0)
+                return;
+            continue;
+        }
+        if (++lIdlePolls < kSpinPolls)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Announce the sleep, then look once more: a producer either sees the flag or its
+        // message is visible to this second poll.
+        const uint32_t lSignal = aSubscriber->puSignal.load(std::memory_order_acquire);
+        aSubscriber->puSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (aSubscriber->puRing.size() == 0 && prRunning.load())
+            aSubscriber->puSignal.wait(lSignal, std::memory_order_acquire);
+        aSubscriber->puSleeping.store(false, std::memory_order_relaxed);
+        lIdlePolls = 0;
+    }
+}
+
+void EventBus::deliver(DataConsumer &aHandler, const BusMessage &aMessage)
+{
+    switch (aMessage.puKind)
+    {
+    case BM_DATA:
+        aHandler.onData(DataItem(static_cast<MMMReaderDataType>(aMessage.puCode), aMessage.puDocument,
+                                 aMessage.puPayload));
+        break;
+    case BM_EVENT:
+        aHandler.onEvent(static_cast<MMMReaderEventCode>(aMessage.puCode), aMessage.puDocument);
+        break;
+    case BM_ERROR:
+        aHandler.onError(static_cast<MMMReaderErrorCode>(aMessage.puCode),
+                         reinterpret_cast<const char *>(aMessage.puPayload.data()), aMessage.puDocument);
+        break;
+    }
+}
+
+} // namespace readerd
@@ -0,0 +1,103 @@
+#include "readerd/Histogram.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+namespace readerd {
+
+Histogram::Histogram(uint64_t aHighestTrackable, int aSignificantDigits)
+{
+    aSignificantDigits = std::clamp(aSignificantDigits, 1, 5);
+    prHighestTrackable = std::max<uint64_t>(aHighestTrackable, 2);
+
+    // Enough linear sub-buckets that adjacent values differ by at most 1 in 10^digits.
+    uint64_t lLargestSingleUnitResolution = 2;
+    for (int i = 0; i < aSignificantDigits; ++i)
+        lLargestSingleUnitResolution *= 10;
+    const int lSubBucketCountMagnitude = std::bit_width(lLargestSingleUnitResolution - 1);
+    prSubBucketHalfCountMagnitude = lSubBucketCountMagnitude - 1;
+    const uint64_t lSubBucketCount = 1ull << lSubBucketCountMagnitude;
+    prSubBucketHalfCount = lSubBucketCount / 2;
+    prSubBucketMask = lSubBucketCount - 1;
+
+    int lBucketCount = 1;
+    uint64_t lSmallestUntrackable = lSubBucketCount;
+    while (lSmallestUntrackable <= prHighestTrackable && lBucketCount < 64 - lSubBucketCountMagnitude)
+    {
+        lSmallestUntrackable <<= 1;
+        ++lBucketCount;
+    }
+    prCounts.assign(static_cast<size_t>(lBucketCount + 1) * prSubBucketHalfCount, 0);
+}
+
+size_t Histogram::indexOf(uint64_t aValue) const
+{
+    const int lPow2Ceiling = 64 - std::countl_zero(aValue | prSubBucketMask);
+    const int lBucket = lPow2Ceiling - (prSubBucketHalfCountMagnitude + 1);
+    const uint64_t lSubBucket = aValue >> lBucket;
+    return (static_cast<size_t>(lBucket + 1) << prSubBucketHalfCountMagnitude)
+        + static_cast<size_t>(lSubBucket - prSubBucketHalfCount);
+}
+
+uint64_t Histogram::highestEquivalentValue(size_t aIndex) const
+{
+    int lBucket = static_cast<int>(aIndex >> prSubBucketHalfCountMagnitude) - 1;
+    uint64_t lSubBucket = (aIndex & (prSubBucketHalfCount - 1)) + prSubBucketHalfCount;
+    if (lBucket < 0)
+    {
+        lSubBucket -= prSubBucketHalfCount;
+        lBucket = 0;
+    }
+    const uint64_t lLowest = lSubBucket << lBucket;
+    return lLowest + (1ull << lBucket) - 1;
+}
+
+void Histogram::record(uint64_t aValue)
+{
+    const uint64_t lClamped = std::min(aValue, prHighestTrackable);
+    ++prCounts[std::min(indexOf(lClamped), prCounts.size() - 1)];
+    ++prTotal;
+    prSum += aValue;
+    prMin = std::min(prMin, aValue);
+    prMax = std::max(prMax, aValue);
+}
+
+void Histogram::merge(const Histogram &aOther)
+{
+    const size_t lCount = std::min(prCounts.size(), aOther.prCounts.size());
+    for (size_t i = 0; i < lCount; ++i)
+        prCounts[i] += aOther.prCounts[i];
+    prTotal += aOther.prTotal;
+    prSum += aOther.prSum;
+    prMin = std::min(prMin, aOther.prMin);
+    prMax = std::max(prMax, aOther.prMax);
+}
+
+void Histogram::reset()
+{
+    std::fill(prCounts.begin(), prCounts.end(), 0);
+    prTotal = 0;
+    prMin = UINT64_MAX;
+    prMax = 0;
+    prSum = 0;
+}
+
+uint64_t Histogram::valueAtPercentile(double aPercentile) const
+{
+    if (prTotal == 0)
+        return 0;
+
+    const double lFraction = std::clamp(aPercentile, 0.0, 100.0) / 100.0;
+    const uint64_t lTarget = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(lFraction * prTotal)));
+    uint64_t lSeen = 0;
+    for (size_t i = 0; i < prCounts.size(); ++i)
+    {
+        lSeen += prCounts[i];
+        if (lSeen >= lTarget)
+            return std::min(highestEquivalentValue(i), prMax);
+    }
+    return prMax;
+}
+
+} // namespace readerd
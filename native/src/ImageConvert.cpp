@@ -0,0 +1,892 @@
+#include "readerd/ImageConvert.h"
+#include "readerd/BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define READERD_X86 1
+#endif
+
+namespace readerd {
+
+namespace {
+
+// Luma weights in 7 bits; they sum to 128 so white stays 255.
+constexpr int kWeightR = 38;
+constexpr int kWeightG = 75;
+constexpr int kWeightB = 15;
+
+inline uint8_t average(uint8_t aA, uint8_t aB)
+{
+    return static_cast<uint8_t>((aA + aB + 1) >> 1);
+}
+
+// Scalar kernels. They are the reference the vector kernels must match bit for bit, and they
+// finish the tail of every row.
+
+void swizzleScalar(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    for (size_t i = 0; i < aPixels; ++i, aSrc += 3, aDst += 3)
+    {
+        const uint8_t lB = aSrc[0];
+        aDst[0] = aSrc[2];
+        aDst[1] = aSrc[1];
+        aDst[2] = lB;
+    }
+}
+
+void unpackScalar(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    for (size_t i = 0; i < aPixels; ++i, aSrc += 4, aDst += 3)
+    {
+        aDst[0] = aSrc[2];
+        aDst[1] = aSrc[1];
+        aDst[2] = aSrc[0];
+    }
+}
+
+void greyScalar(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    for (size_t i = 0; i < aPixels; ++i, aSrc += 3)
+        aDst[i] = static_cast<uint8_t>((kWeightB * aSrc[0] + kWeightG * aSrc[1] + kWeightR * aSrc[2] + 64) >> 7);
+}
+
+void greyBgraScalar(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    for (size_t i = 0; i < aPixels; ++i, aSrc += 4)
+        aDst[i] = static_cast<uint8_t>((kWeightB * aSrc[0] + kWeightG * aSrc[1] + kWeightR * aSrc[2] + 64) >> 7);
+}
+
+void extractScalar(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels, int aBytesPerPixel)
+{
+    for (size_t i = 0; i < aPixels; ++i, aSrc += aBytesPerPixel)
+        aDst[i] = *aSrc;
+}
+
+void downscaleScalar(const uint8_t *aTop, const uint8_t *aBottom, uint8_t *aDst, size_t aPixels)
+{
+    for (size_t i = 0; i + 1 < aPixels; i += 2, aTop += 6, aBottom += 6, aDst += 3)
+    {
+        for (int c = 0; c < 3; ++c)
+            aDst[c] = average(average(aTop[c], aBottom[c]), average(aTop[c + 3], aBottom[c + 3]));
+    }
+}
+
+#ifdef READERD_X86
+
+// The vector kernels load and store whole registers, some of whose bytes belong to the next
+// pixels. Loops stop while a full register still fits in both buffers; stray bytes written past
+// the pixels just produced are always rewritten by the next step or by the scalar tail.
+
+// Reverses the three bytes of each of the first five pixels; byte 15 is left in place.
+#define READERD_SWIZZLE_MASK 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15
+
+__attribute__((target("sse4.1")))
+void swizzleSse4(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m128i lMask = _mm_setr_epi8(READERD_SWIZZLE_MASK);
+    size_t i = 0;
+    for (; i + 6 <= aPixels; i += 5)
+    {
+        const __m128i lIn = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aSrc + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + 3 * i), _mm_shuffle_epi8(lIn, lMask));
+    }
+    swizzleScalar(aSrc + 3 * i, aDst + 3 * i, aPixels - i);
+}
+
+__attribute__((target("avx2")))
+void swizzleAvx2(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m256i lMask = _mm256_setr_epi8(READERD_SWIZZLE_MASK, READERD_SWIZZLE_MASK);
+    size_t i = 0;
+    for (; i + 11 <= aPixels; i += 10)
+    {
+        const uint8_t *lSrc = aSrc + 3 * i;
+        uint8_t *lDst = aDst + 3 * i;
+        const __m256i lIn = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(lSrc + 15),
+                                                reinterpret_cast<const __m128i *>(lSrc));
+        const __m256i lOut = _mm256_shuffle_epi8(lIn, lMask);
+        // Low lane first: its last byte is the high lane's first pixel, not yet written.
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lDst), _mm256_castsi256_si128(lOut));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lDst + 15), _mm256_extracti128_si256(lOut, 1));
+    }
+    swizzleSse4(aSrc + 3 * i, aDst + 3 * i, aPixels - i);
+}
+
+#define READERD_UNPACK_MASK 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+
+__attribute__((target("sse4.1")))
+void unpackSse4(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m128i lMask = _mm_setr_epi8(READERD_UNPACK_MASK);
+    size_t i = 0;
+    for (; i + 6 <= aPixels; i += 4)
+    {
+        const __m128i lIn = _mm_loadu_si128(reinterpret_cast<const __m128i *>(aSrc + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + 3 * i), _mm_shuffle_epi8(lIn, lMask));
+    }
+    unpackScalar(aSrc + 4 * i, aDst + 3 * i, aPixels - i);
+}
+
+__attribute__((target("avx2")))
+void unpackAvx2(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m256i lMask = _mm256_setr_epi8(READERD_UNPACK_MASK, READERD_UNPACK_MASK);
+    // Each lane holds 12 bytes of output; close the 4-byte gap between them.
+    const __m256i lCompact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 11 <= aPixels; i += 8)
+    {
+        const __m256i lIn = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(aSrc + 4 * i));
+        const __m256i lOut = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(lIn, lMask), lCompact);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(aDst + 3 * i), lOut);
+    }
+    unpackSse4(aSrc + 4 * i, aDst + 3 * i, aPixels - i);
+}
+
+// Spreads four BGR pixels to B,G,R,0 so that maddubs yields (15B + 75G) and 38R per pixel.
+#define READERD_GREY_SPREAD 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1
+#define READERD_GREY_WEIGHTS kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0, \
+                             kWeightB, kWeightG, kWeightR, 0, kWeightB, kWeightG, kWeightR, 0
+
+__attribute__((target("sse4.1")))
+void greySse4(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m128i lSpread = _mm_setr_epi8(READERD_GREY_SPREAD);
+    const __m128i lWeights = _mm_setr_epi8(READERD_GREY_WEIGHTS);
+    const __m128i lRound = _mm_set1_epi16(64);
+    size_t i = 0;
+    for (; i + 10 <= aPixels; i += 8)
+    {
+        const uint8_t *lSrc = aSrc + 3 * i;
+        const __m128i lA = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lSrc)), lSpread);
+        const __m128i lB = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lSrc + 12)), lSpread);
+        // Partial sums stay below 2^15, so the signed 16-bit arithmetic cannot saturate.
+        const __m128i lSum = _mm_hadd_epi16(_mm_maddubs_epi16(lA, lWeights), _mm_maddubs_epi16(lB, lWeights));
+        const __m128i lY = _mm_srli_epi16(_mm_add_epi16(lSum, lRound), 7);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(aDst + i), _mm_packus_epi16(lY, lY));
+    }
+    greyScalar(aSrc + 3 * i, aDst + i, aPixels - i);
+}
+
+__attribute__((target("avx2")))
+void greyAvx2(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m256i lSpread = _mm256_setr_epi8(READERD_GREY_SPREAD, READERD_GREY_SPREAD);
+    const __m256i lWeights = _mm256_setr_epi8(READERD_GREY_WEIGHTS, READERD_GREY_WEIGHTS);
+    const __m256i lRound = _mm256_set1_epi16(64);
+    size_t i = 0;
+    for (; i + 18 <= aPixels; i += 16)
+    {
+        // Lanes are arranged so that hadd leaves pixels 0-7 in the low lane and 8-15 in the high.
+        const uint8_t *lSrc = aSrc + 3 * i;
+        const __m256i lA = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(lSrc + 24),
+                                               reinterpret_cast<const __m128i *>(lSrc));
+        const __m256i lB = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(lSrc + 36),
+                                               reinterpret_cast<const __m128i *>(lSrc + 12));
+        const __m256i lSum = _mm256_hadd_epi16(_mm256_maddubs_epi16(_mm256_shuffle_epi8(lA, lSpread), lWeights),
+                                               _mm256_maddubs_epi16(_mm256_shuffle_epi8(lB, lSpread), lWeights));
+        const __m256i lY = _mm256_srli_epi16(_mm256_add_epi16(lSum, lRound), 7);
+        const __m256i lPacked = _mm256_permute4x64_epi64(_mm256_packus_epi16(lY, lY), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + i), _mm256_castsi256_si128(lPacked));
+    }
+    greySse4(aSrc + 3 * i, aDst + i, aPixels - i);
+}
+
+__attribute__((target("sse4.1")))
+void greyBgraSse4(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m128i lWeights = _mm_setr_epi8(READERD_GREY_WEIGHTS);
+    const __m128i lRound = _mm_set1_epi16(64);
+    size_t i = 0;
+    for (; i + 8 <= aPixels; i += 8)
+    {
+        const __m128i *lSrc = reinterpret_cast<const __m128i *>(aSrc + 4 * i);
+        const __m128i lSum = _mm_hadd_epi16(_mm_maddubs_epi16(_mm_loadu_si128(lSrc), lWeights),
+                                            _mm_maddubs_epi16(_mm_loadu_si128(lSrc + 1), lWeights));
+        const __m128i lY = _mm_srli_epi16(_mm_add_epi16(lSum, lRound), 7);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(aDst + i), _mm_packus_epi16(lY, lY));
+    }
+    greyBgraScalar(aSrc + 4 * i, aDst + i, aPixels - i);
+}
+
+__attribute__((target("avx2")))
+void greyBgraAvx2(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+    const __m256i lWeights = _mm256_setr_epi8(READERD_GREY_WEIGHTS, READERD_GREY_WEIGHTS);
+    const __m256i lRound = _mm256_set1_epi16(64);
+    size_t i = 0;
+    for (; i + 16 <= aPixels; i += 16)
+    {
+        const __m256i *lSrc = reinterpret_cast<const __m256i *>(aSrc + 4 * i);
+        const __m256i lSum = _mm256_hadd_epi16(_mm256_maddubs_epi16(_mm256_loadu_si256(lSrc), lWeights),
+                                               _mm256_maddubs_epi16(_mm256_loadu_si256(lSrc + 1), lWeights));
+        // hadd interleaves the lanes as pixels 0-3, 8-11, 4-7, 12-15; restore the order.
+        const __m256i lY = _mm256_permute4x64_epi64(_mm256_srli_epi16(_mm256_add_epi16(lSum, lRound), 7), 0xD8);
+        const __m256i lPacked = _mm256_permute4x64_epi64(_mm256_packus_epi16(lY, lY), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + i), _mm256_castsi256_si128(lPacked));
+    }
+    greyBgraSse4(aSrc + 4 * i, aDst + i, aPixels - i);
+}
+
+// Shuffle masks gathering byte aChannel of sixteen 3-byte pixels spread over three registers;
+// each mask takes the bytes held by one register and zeroes the rest.
+void channelMasks(int aChannel, uint8_t aMasks[3][16])
+{
+    for (int k = 0; k < 16; ++k)
+    {
+        const int lByte = 3 * k + aChannel;
+        for (int v = 0; v < 3; ++v)
+            aMasks[v][k] = lByte / 16 == v ? static_cast<uint8_t>(lByte % 16) : 0x80;
+    }
+}
+
+__attribute__((target("sse4.1")))
+void extractSse4(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels, int aBytesPerPixel, int aChannel)
+{
+    size_t i = 0;
+    if (aBytesPerPixel == 3)
+    {
+        uint8_t lBytes[3][16];
+        channelMasks(aChannel, lBytes);
+        const __m128i lMask0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lBytes[0]));
+        const __m128i lMask1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lBytes[1]));
+        const __m128i lMask2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(lBytes[2]));
+        for (; i + 16 <= aPixels; i += 16)
+        {
+            const __m128i *lSrc = reinterpret_cast<const __m128i *>(aSrc + 3 * i);
+            const __m128i lOut = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(lSrc), lMask0),
+                                                           _mm_shuffle_epi8(_mm_loadu_si128(lSrc + 1), lMask1)),
+                                              _mm_shuffle_epi8(_mm_loadu_si128(lSrc + 2), lMask2));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + i), lOut);
+        }
+    }
+    else
+    {
+        const __m128i lShift = _mm_cvtsi32_si128(8 * aChannel);
+        const __m128i lLow = _mm_set1_epi32(0xFF);
+        for (; i + 16 <= aPixels; i += 16)
+        {
+            const __m128i *lSrc = reinterpret_cast<const __m128i *>(aSrc + 4 * i);
+            __m128i lPart[4];
+            for (int v = 0; v < 4; ++v)
+                lPart[v] = _mm_and_si128(_mm_srl_epi32(_mm_loadu_si128(lSrc + v), lShift), lLow);
+            const __m128i lOut = _mm_packus_epi16(_mm_packus_epi32(lPart[0], lPart[1]),
+                                                  _mm_packus_epi32(lPart[2], lPart[3]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + i), lOut);
+        }
+    }
+    extractScalar(aSrc + aBytesPerPixel * i + aChannel, aDst + i, aPixels - i, aBytesPerPixel);
+}
+
+__attribute__((target("avx2")))
+void extractAvx2(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels, int aBytesPerPixel, int aChannel)
+{
+    size_t i = 0;
+    if (aBytesPerPixel == 3)
+    {
+        // Pixels 0-15 in the low lanes and 16-31 in the high lanes, gathered as in extractSse4().
+        uint8_t lBytes[3][16];
+        channelMasks(aChannel, lBytes);
+        __m256i lMask[3];
+        for (int v = 0; v < 3; ++v)
+            lMask[v] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lBytes[v])));
+        for (; i + 32 <= aPixels; i += 32)
+        {
+            const uint8_t *lSrc = aSrc + 3 * i;
+            __m256i lOut = _mm256_setzero_si256();
+            for (int v = 0; v < 3; ++v)
+            {
+                const __m256i lIn = _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(lSrc + 48 + 16 * v),
+                                                        reinterpret_cast<const __m128i *>(lSrc + 16 * v));
+                lOut = _mm256_or_si256(lOut, _mm256_shuffle_epi8(lIn, lMask[v]));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(aDst + i), lOut);
+        }
+    }
+    else
+    {
+        const __m128i lShift = _mm_cvtsi32_si128(8 * aChannel);
+        const __m256i lLow = _mm256_set1_epi32(0xFF);
+        // The packs work within lanes, leaving groups of four pixels in the order 0 2 4 6 1 3 5 7.
+        const __m256i lOrder = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+        for (; i + 32 <= aPixels; i += 32)
+        {
+            const __m256i *lSrc = reinterpret_cast<const __m256i *>(aSrc + 4 * i);
+            __m256i lPart[4];
+            for (int v = 0; v < 4; ++v)
+                lPart[v] = _mm256_and_si256(_mm256_srl_epi32(_mm256_loadu_si256(lSrc + v), lShift), lLow);
+            const __m256i lPacked = _mm256_packus_epi16(_mm256_packus_epi32(lPart[0], lPart[1]),
+                                                        _mm256_packus_epi32(lPart[2], lPart[3]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(aDst + i), _mm256_permutevar8x32_epi32(lPacked, lOrder));
+        }
+    }
+    extractSse4(aSrc + aBytesPerPixel * i, aDst + i, aPixels - i, aBytesPerPixel, aChannel);
+}
+
+// From four vertically averaged pixels, gathers the even (left) or odd (right) pixel of each
+// pair; the second variant places them after the six bytes the first produces.
+#define READERD_DOWN_EVEN_LO 0, 1, 2, 6, 7, 8, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define READERD_DOWN_ODD_LO 3, 4, 5, 9, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+#define READERD_DOWN_EVEN_HI -1, -1, -1, -1, -1, -1, 0, 1, 2, 6, 7, 8, -1, -1, -1, -1
+#define READERD_DOWN_ODD_HI -1, -1, -1, -1, -1, -1, 3, 4, 5, 9, 10, 11, -1, -1, -1, -1
+
+__attribute__((target("sse4.1")))
+void downscaleSse4(const uint8_t *aTop, const uint8_t *aBottom, uint8_t *aDst, size_t aPixels)
+{
+    const __m128i lEvenLo = _mm_setr_epi8(READERD_DOWN_EVEN_LO);
+    const __m128i lOddLo = _mm_setr_epi8(READERD_DOWN_ODD_LO);
+    const __m128i lEvenHi = _mm_setr_epi8(READERD_DOWN_EVEN_HI);
+    const __m128i lOddHi = _mm_setr_epi8(READERD_DOWN_ODD_HI);
+    size_t i = 0;
+    for (; i + 12 <= aPixels; i += 8)
+    {
+        const size_t lOffset = 3 * i;
+        const __m128i lV0 = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(aTop + lOffset)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(aBottom + lOffset)));
+        const __m128i lV1 = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(aTop + lOffset + 12)),
+                                         _mm_loadu_si128(reinterpret_cast<const __m128i *>(aBottom + lOffset + 12)));
+        const __m128i lEven = _mm_or_si128(_mm_shuffle_epi8(lV0, lEvenLo), _mm_shuffle_epi8(lV1, lEvenHi));
+        const __m128i lOdd = _mm_or_si128(_mm_shuffle_epi8(lV0, lOddLo), _mm_shuffle_epi8(lV1, lOddHi));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDst + lOffset / 2), _mm_avg_epu8(lEven, lOdd));
+    }
+    downscaleScalar(aTop + 3 * i, aBottom + 3 * i, aDst + 3 * i / 2, aPixels - i);
+}
+
+// Loads 16 bytes at aBytes into the low lane and 16 bytes at aBytes + 24 into the high lane.
+__attribute__((target("avx2")))
+inline __m256i loadLanes(const uint8_t *aBytes)
+{
+    return _mm256_loadu2_m128i(reinterpret_cast<const __m128i *>(aBytes + 24),
+                               reinterpret_cast<const __m128i *>(aBytes));
+}
+
+__attribute__((target("avx2")))
+void downscaleAvx2(const uint8_t *aTop, const uint8_t *aBottom, uint8_t *aDst, size_t aPixels)
+{
+    const __m256i lEvenLo = _mm256_setr_epi8(READERD_DOWN_EVEN_LO, READERD_DOWN_EVEN_LO);
+    const __m256i lOddLo = _mm256_setr_epi8(READERD_DOWN_ODD_LO, READERD_DOWN_ODD_LO);
+    const __m256i lEvenHi = _mm256_setr_epi8(READERD_DOWN_EVEN_HI, READERD_DOWN_EVEN_HI);
+    const __m256i lOddHi = _mm256_setr_epi8(READERD_DOWN_ODD_HI, READERD_DOWN_ODD_HI);
+    size_t i = 0;
+    for (; i + 20 <= aPixels; i += 16)
+    {
+        // Low lanes cover input pixels 0-7, high lanes 8-15; each yields four output pixels.
+        const size_t lOffset = 3 * i;
+        const __m256i lV0 = _mm256_avg_epu8(loadLanes(aTop + lOffset), loadLanes(aBottom + lOffset));
+        const __m256i lV1 = _mm256_avg_epu8(loadLanes(aTop + lOffset + 12), loadLanes(aBottom + lOffset + 12));
+        const __m256i lEven = _mm256_or_si256(_mm256_shuffle_epi8(lV0, lEvenLo), _mm256_shuffle_epi8(lV1, lEvenHi));
+        const __m256i lOdd = _mm256_or_si256(_mm256_shuffle_epi8(lV0, lOddLo), _mm256_shuffle_epi8(lV1, lOddHi));
+        const __m256i lOut = _mm256_avg_epu8(lEven, lOdd);
+        uint8_t *lDst = aDst + lOffset / 2;
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lDst), _mm256_castsi256_si128(lOut));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(lDst + 12), _mm256_extracti128_si256(lOut, 1));
+    }
+    downscaleSse4(aTop + 3 * i, aBottom + 3 * i, aDst + 3 * i / 2, aPixels - i);
+}
+
+#endif // READERD_X86
+
+SimdLevel supportedLevel()
+{
+#ifdef READERD_X86
+    if (__builtin_cpu_supports("avx2"))
+        return SIMD_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return SIMD_SSE4;
+#endif
+    return SIMD_SCALAR;
+}
+
+SimdLevel initialLevel()
+{
+    SimdLevel lLevel = supportedLevel();
+    if (const char *lEnv = std::getenv("READERD_SIMD"))
+    {
+        const std::string lName = lEnv;
+        if (lName == "scalar")
+            lLevel = SIMD_SCALAR;
+        else if (lName == "sse4" && lLevel > SIMD_SSE4)
+            lLevel = SIMD_SSE4;
+    }
+    return lLevel;
+}
+
+std::atomic<SimdLevel> gLevel{initialLevel()};
+
+inline SimdLevel currentLevel()
+{
+    return gLevel.load(std::memory_order_relaxed);
+}
+
+// Calls aRow(y) for every row, split into bands across aTiles when there is one.
+template <typename RowFunction>
+void forRows(int aRows, TileExecutor *aTiles, const RowFunction &aRow)
+{
+    if (aTiles == nullptr)
+    {
+        for (int y = 0; y < aRows; ++y)
+            aRow(y);
+        return;
+    }
+    aTiles->forRows(aRows, [&aRow](int aBegin, int aEnd) {
+        for (int y = aBegin; y < aEnd; ++y)
+            aRow(y);
+    });
+}
+
+uint32_t readLe32(const uint8_t *aBytes)
+{
+    return static_cast<uint32_t>(aBytes[0]) | static_cast<uint32_t>(aBytes[1]) << 8 |
+           static_cast<uint32_t>(aBytes[2]) << 16 | static_cast<uint32_t>(aBytes[3]) << 24;
+}
+
+uint16_t readLe16(const uint8_t *aBytes)
+{
+    return static_cast<uint16_t>(aBytes[0] | aBytes[1] << 8);
+}
+
+} // namespace
+
+SimdLevel simdLevel()
+{
+    return currentLevel();
+}
+
+SimdLevel setSimdLevel(SimdLevel aLevel)
+{
+    const SimdLevel lLevel = aLevel < supportedLevel() ? aLevel : supportedLevel();
+    gLevel.store(lLevel, std::memory_order_relaxed);
+    return lLevel;
+}
+
+const char *simdLevelName(SimdLevel aLevel)
+{
+    switch (aLevel)
+    {
+    case SIMD_SCALAR:
+        return "scalar";
+    case SIMD_SSE4:
+        return "sse4";
+    case SIMD_AVX2:
+        return "avx2";
+    }
+    return "unknown";
+}
+
+bool parseBitmap(std::span<const uint8_t> aBytes, BitmapView *aView)
+{
+    // BITMAPFILEHEADER (14 bytes) followed by at least a BITMAPINFOHEADER (40 bytes).
+    if (aBytes.size() < 54 || aBytes[0] != 'B' || aBytes[1] != 'M')
+        return false;
+
+    const uint8_t *lInfo = aBytes.data() + 14;
+    const uint32_t lPixelOffset = readLe32(aBytes.data() + 10);
+    const int32_t lWidth = static_cast<int32_t>(readLe32(lInfo + 4));
+    const int32_t lHeight = static_cast<int32_t>(readLe32(lInfo + 8));
+    const uint16_t lBitsPerPixel = readLe16(lInfo + 14);
+    const uint32_t lCompression = readLe32(lInfo + 16);
+
+    if (readLe32(lInfo) < 40 || lCompression != 0 || (lBitsPerPixel != 24 && lBitsPerPixel != 32))
+        return false;
+    if (lWidth <= 0 || lHeight == 0 || lHeight == INT32_MIN)
+        return false;
+
+    const int lRows = lHeight < 0 ? -lHeight : lHeight;
+    const size_t lStride = (static_cast<size_t>(lWidth) * lBitsPerPixel + 31) / 32 * 4;
+    if (lPixelOffset > aBytes.size() || lStride * static_cast<size_t>(lRows) > aBytes.size() - lPixelOffset)
+        return false;
+
+    aView->puPixels = aBytes.data() + lPixelOffset;
+    aView->puWidth = lWidth;
+    aView->puHeight = lRows;
+    aView->puBitsPerPixel = lBitsPerPixel;
+    aView->puStride = static_cast<ptrdiff_t>(lStride);
+    aView->puBottomUp = lHeight > 0;
+    return true;
+}
+
+bool isImageDataType(MMMReaderDataType aDataType)
+{
+    switch (aDataType)
+    {
+    case CD_IMAGEIR:
+    case CD_IMAGEIRREAR:
+    case CD_IMAGEVIS:
+    case CD_IMAGEVISREAR:
+    case CD_IMAGEVIS_OVD1:
+    case CD_IMAGEVIS_OVD2:
+    case CD_IMAGEPHOTO:
+    case CD_IMAGEUV:
+    case CD_IMAGEUVREAR:
+    case CD_IMAGECOAXVIS:
+    case CD_IMAGECOAXIR:
+    case CD_IMAGEBARCODE:
+    case CD_IMAGEBARCODEREAR:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isInfraredDataType(MMMReaderDataType aDataType)
+{
+    return aDataType == CD_IMAGEIR || aDataType == CD_IMAGEIRREAR || aDataType == CD_IMAGECOAXIR;
+}
+
+void swizzleBgrToRgb(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+#ifdef READERD_X86
+    switch (currentLevel())
+    {
+    case SIMD_AVX2:
+        return swizzleAvx2(aSrc, aDst, aPixels);
+    case SIMD_SSE4:
+        return swizzleSse4(aSrc, aDst, aPixels);
+    case SIMD_SCALAR:
+        break;
+    }
+#endif
+    swizzleScalar(aSrc, aDst, aPixels);
+}
+
+void unpackBgraToRgb(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+#ifdef READERD_X86
+    switch (currentLevel())
+    {
+    case SIMD_AVX2:
+        return unpackAvx2(aSrc, aDst, aPixels);
+    case SIMD_SSE4:
+        return unpackSse4(aSrc, aDst, aPixels);
+    case SIMD_SCALAR:
+        break;
+    }
+#endif
+    unpackScalar(aSrc, aDst, aPixels);
+}
+
+void greyscaleBgr(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+#ifdef READERD_X86
+    switch (currentLevel())
+    {
+    case SIMD_AVX2:
+        return greyAvx2(aSrc, aDst, aPixels);
+    case SIMD_SSE4:
+        return greySse4(aSrc, aDst, aPixels);
+    case SIMD_SCALAR:
+        break;
+    }
+#endif
+    greyScalar(aSrc, aDst, aPixels);
+}
+
+void greyscaleBgra(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)
+{
+#ifdef READERD_X86
+    switch (currentLevel())
+    {
+    case SIMD_AVX2:
+        return greyBgraAvx2(aSrc, aDst, aPixels);
+    case SIMD_SSE4:
+        return greyBgraSse4(aSrc, aDst, aPixels);
+    case SIMD_SCALAR:
+        break;
+    }
+#endif
+    greyBgraScalar(aSrc, aDst, aPixels);
+}
+
+void extractChannel(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels, int aBytesPerPixel, int aChannel)
+{
+#ifdef READERD_X86
+    switch (currentLevel())
+    {
+    case SIMD_AVX2:
+        return extractAvx2(aSrc, aDst, aPixels, aBytesPerPixel, aChannel);
+    case SIMD_SSE4:
+        return extractSse4(aSrc, aDst, aPixels, aBytesPerPixel, aChannel);
+    case SIMD_SCALAR:
+        break;
+    }
+#endif
+    extractScalar(aSrc + aChannel, aDst, aPixels, aBytesPerPixel);
+}
+
+void downscaleRowPair(const uint8_t *aTop, const uint8_t *aBottom, uint8_t *aDst, size_t aPixels)
+{
+#ifdef READERD_X86
+    switch (currentLevel())
+    {
+    case SIMD_AVX2:
+        return downscaleAvx2(aTop, aBottom, aDst, aPixels);
+    case SIMD_SSE4:
+        return downscaleSse4(aTop, aBottom, aDst, aPixels);
+    case SIMD_SCALAR:
+        break;
+    }
+#endif
+    downscaleScalar(aTop, aBottom, aDst, aPixels);
+}
+
+void bitmapToRgb(const BitmapView &aBitmap, uint8_t *aDst, TileExecutor *aTiles)
+{
+    const size_t lRowBytes = static_cast<size_t>(aBitmap.puWidth) * 3;
+    forRows(aBitmap.puHeight, aTiles, [&](int aRow) {
+        if (aBitmap.puBitsPerPixel == 24)
+            swizzleBgrToRgb(aBitmap.row(aRow), aDst + aRow * lRowBytes, aBitmap.puWidth);
+        else
+            unpackBgraToRgb(aBitmap.row(aRow), aDst + aRow * lRowBytes, aBitmap.puWidth);
+    });
+}
+
+void bitmapToGrey(const BitmapView &aBitmap, uint8_t *aDst, TileExecutor *aTiles)
+{
+    const size_t lWidth = static_cast<size_t>(aBitmap.puWidth);
+    forRows(aBitmap.puHeight, aTiles, [&](int aRow) {
+        if (aBitmap.puBitsPerPixel == 24)
+            greyscaleBgr(aBitmap.row(aRow), aDst + aRow * lWidth, lWidth);
+        else
+            greyscaleBgra(aBitmap.row(aRow), aDst + aRow * lWidth, lWidth);
+    });
+}
+
+void bitmapExtractChannel(const BitmapView &aBitmap, int aChannel, uint8_t *aDst, TileExecutor *aTiles)
+{
+    const size_t lWidth = static_cast<size_t>(aBitmap.puWidth);
+    const int lBytesPerPixel = aBitmap.puBitsPerPixel / 8;
+    forRows(aBitmap.puHeight, aTiles, [&](int aRow) {
+        extractChannel(aBitmap.row(aRow), aDst + aRow * lWidth, lWidth, lBytesPerPixel, aChannel);
+    });
+}
+
+void downscaleRgb(const uint8_t *aSrc, int aWidth, int aHeight, uint8_t *aDst, TileExecutor *aTiles)
+{
+    const size_t lRowBytes = static_cast<size_t>(aWidth) * 3;
+    const size_t lOutRowBytes = static_cast<size_t>(aWidth / 2) * 3;
+    forRows(aHeight / 2, aTiles, [&](int aRow) {
+        const uint8_t *lTop = aSrc + 2 * aRow * lRowBytes;
+        downscaleRowPair(lTop, lTop + lRowBytes, aDst + aRow * lOutRowBytes, aWidth);
+    });
+}
+
+TileExecutor::TileExecutor(unsigned aThreads)
+{
+    const unsigned lThreads = aThreads ? aThreads : std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < lThreads; ++i)
+        prWorkers.emplace_back(&TileExecutor::workerLoop, this);
+}
+
+TileExecutor::~TileExecutor()
+{
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        prStopping = true;
+    }
+    prStart.notify_all();
+    for (std::thread &lWorker : prWorkers)
+        lWorker.join();
+}
+
+void TileExecutor::forRows(int aRows, const std::function<void(int aBegin, int aEnd)> &aBand)
+{
+    if (aRows <= 0)
+        return;
+    if (prWorkers.empty())
+        return aBand(0, aRows);
+
+    std::lock_guard<std::mutex> lRun(prRunMutex);
+    {
+        std::unique_lock<std::mutex> lLock(prMutex);
+        // A worker that woke late for the previous call may still be looking at it.
+        prDone.wait(lLock, [this] { return prActive == 0; });
+
+        // About four bands per thread balances uneven cores without making bands so thin
+        // that rows stop sharing cache lines at the edges.
+        prBand = &aBand;
+        prRows = aRows;
+        prBandRows = std::max(8, aRows / static_cast<int>(4 * threads()));
+        prBandCount = (aRows + prBandRows - 1) / prBandRows;
+        prNextBand.store(0, std::memory_order_relaxed);
+        ++prGeneration;
+        ++prActive;
+    }
+    prStart.notify_all();
+
+    runBands();
+
+    std::unique_lock<std::mutex> lLock(prMutex);
+    --prActive;
+    prDone.wait(lLock, [this] { return prActive == 0; });
+    prBand = nullptr;
+}
+
+void TileExecutor::workerLoop()
+{
+    uint64_t lSeen = 0;
+    std::unique_lock<std::mutex> lLock(prMutex);
+    for (;;)
+    {
+        prStart.wait(lLock, [this, &lSeen] { return prStopping || prGeneration != lSeen; });
+        if (prStopping)
+            return;
+        lSeen = prGeneration;
+        ++prActive;
+        lLock.unlock();
+
+        runBands();
+
+        lLock.lock();
+        if (--prActive == 0)
+            prDone.notify_all();
+    }
+}
+
+void TileExecutor::runBands()
+{
+    for (;;)
+    {
+        const int lBand = prNextBand.fetch_add(1, std::memory_order_relaxed);
+        if (lBand >= prBandCount)
+            return;
+        const int lBegin = lBand * prBandRows;
+        (*prBand)(lBegin, std::min(prRows, lBegin + prBandRows));
+    }
+}
+
+ImageConverter::ImageConverter(ConvertTarget aTarget, Sink aSink, unsigned aThreads, BufferPool *aPool,
+                               size_t aMaxQueued)
+    : prTarget(aTarget)
+    , prSink(std::move(aSink))
+    , prPool(aPool)
+    , prQueue(aMaxQueued)
+{
+    for (unsigned i = 0; i < (aThreads ? aThreads : 1); ++i)
+        prWorkers.emplace_back(&ImageConverter::workerLoop, this);
+}
+
+ImageConverter::~ImageConverter()
+{
+    prQueue.close();
+    for (std::thread &lWorker : prWorkers)
+        lWorker.join();
+}
+
+void ImageConverter::onData(const DataItem &aItem)
+{
+    if (!isImageDataType(aItem.type()))
+        return;
+
+    const std::span<const uint8_t> lBytes = aItem.bytes();
+    if (lBytes.size() < 2 || lBytes[0] != 'B' || lBytes[1] != 'M')
+    {
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        ++prStats.puSkipped;
+        return;
+    }
+
+    // Check for space before retain() copies the image; a racing producer may still take
+    // the slot, in which case the copy is wasted but nothing blocks.
+    bool lQueued = false;
+    if (prQueue.size() < prQueue.capacity())
+        lQueued = prQueue.tryPush(Job{aItem.type(), aItem.document(), aItem.retain()});
+    if (!lQueued)
+    {
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        ++prStats.puDropped;
+    }
+}
+
+void ImageConverter::drain()
+{
+    prQueue.join();
+}
+
+ImageConverter::Stats ImageConverter::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prStatsMutex);
+    return prStats;
+}
+
+void ImageConverter::workerLoop()
+{
+    Job lJob;
+    while (prQueue.pop(&lJob))
+    {
+        ConvertedImage lImage;
+        const bool lConverted = convert(lJob, &lImage);
+        const double lConvertUs = lImage.puConvertUs;
+        lJob.puBytes = DataRef();
+        if (lConverted && prSink)
+            prSink(std::move(lImage));
+
+        {
+            std::lock_guard<std::mutex> lLock(prStatsMutex);
+            if (lConverted)
+            {
+                ++prStats.puConverted;
+                prStats.puConvertUs += lConvertUs;
+            }
+            else
+            {
+                ++prStats.puSkipped;
+            }
+        }
+        prQueue.taskDone();
+    }
+}
+
+bool ImageConverter::convert(const Job &aJob, ConvertedImage *aImage)
+{
+    BitmapView lBitmap;
+    if (!parseBitmap(aJob.puBytes.bytes(), &lBitmap))
+        return false;
+
+    const auto lStart = std::chrono::steady_clock::now();
+
+    aImage->puDataType = aJob.puDataType;
+    aImage->puDocument = aJob.puDocument;
+    aImage->puWidth = prTarget == CONVERT_RGB_HALF ? lBitmap.puWidth / 2 : lBitmap.puWidth;
+    aImage->puHeight = prTarget == CONVERT_RGB_HALF ? lBitmap.puHeight / 2 : lBitmap.puHeight;
+    aImage->puChannels = prTarget == CONVERT_GREY ? 1 : 3;
+
+    const size_t lBytes = static_cast<size_t>(aImage->puWidth) * aImage->puHeight * aImage->puChannels;
+    const auto lAcquire = [this](size_t aSize) {
+        return prPool ? prPool->acquire(aSize) : std::make_shared_for_overwrite<uint8_t[]>(aSize);
+    };
+    std::shared_ptr<uint8_t[]> lOut = lAcquire(lBytes);
+
+    switch (prTarget)
+    {
+    case CONVERT_RGB:
+        bitmapToRgb(lBitmap, lOut.get());
+        break;
+    case CONVERT_GREY:
+        if (isInfraredDataType(aJob.puDataType))
+            bitmapExtractChannel(lBitmap, 1, lOut.get());
+        else
+            bitmapToGrey(lBitmap, lOut.get());
+        break;
+    case CONVERT_RGB_HALF:
+    {
+        std::shared_ptr<uint8_t[]> lFull = lAcquire(static_cast<size_t>(lBitmap.puWidth) * lBitmap.puHeight * 3);
+        bitmapToRgb(lBitmap, lFull.get());
+        downscaleRgb(lFull.get(), lBitmap.puWidth, lBitmap.puHeight, lOut.get());
+        break;
+    }
+    }
+
+    aImage->puPixels = DataRef::adopt(std::move(lOut), lBytes);
+    aImage->puConvertUs =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - lStart).count();
+    return true;
+}
+
+} // namespace readerd
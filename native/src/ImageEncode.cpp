@@ -0,0 +1,374 @@
+#include "readerd/ImageEncode.h"
+#include "readerd/ImageConvert.h"
+#include "readerd/ReaderBackend.h"
+
+#include <bit>
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#ifdef READERD_HAVE_JPEG
+#include <jpeglib.h>
+#endif
+#ifdef READERD_HAVE_PNG
+#include <png.h>
+#endif
+
+namespace readerd {
+
+namespace {
+
+// Both codecs report errors by longjmp, so the functions that call them hold nothing with a
+// destructor; output goes to a vector owned by the caller.
+
+#ifdef READERD_HAVE_JPEG
+
+struct JpegError
+{
+    jpeg_error_mgr puManager;
+    std::jmp_buf puJump;
+    char puMessage[JMSG_LENGTH_MAX];
+};
+
+struct JpegDestination
+{
+    jpeg_destination_mgr puManager;
+    std::vector<uint8_t> *puBytes;
+};
+
+void onJpegError(j_common_ptr aInfo)
+{
+    JpegError *lError = reinterpret_cast<JpegError *>(aInfo->err);
+    (*aInfo->err->format_message)(aInfo, lError->puMessage);
+    std::longjmp(lError->puJump, 1);
+}
+
+void initJpegDestination(j_compress_ptr aInfo)
+{
+    JpegDestination *lDestination = reinterpret_cast<JpegDestination *>(aInfo->dest);
+    lDestination->puBytes->resize(64 * 1024);
+    lDestination->puManager.next_output_byte = lDestination->puBytes->data();
+    lDestination->puManager.free_in_buffer = lDestination->puBytes->size();
+}
+
+boolean growJpegDestination(j_compress_ptr aInfo)
+{
+    JpegDestination *lDestination = reinterpret_cast<JpegDestination *>(aInfo->dest);
+    const size_t lUsed = lDestination->puBytes->size();
+    lDestination->puBytes->resize(2 * lUsed);
+    lDestination->puManager.next_output_byte = lDestination->puBytes->data() + lUsed;
+    lDestination->puManager.free_in_buffer = lDestination->puBytes->size() - lUsed;
+    return TRUE;
+}
+
+void termJpegDestination(j_compress_ptr aInfo)
+{
+    JpegDestination *lDestination = reinterpret_cast<JpegDestination *>(aInfo->dest);
+    lDestination->puBytes->resize(lDestination->puBytes->size() - lDestination->puManager.free_in_buffer);
+}
+
+bool encodeJpeg(const uint8_t *aPixels, int aWidth, int aHeight, int aChannels, int aQuality,
+                std::vector<uint8_t> *aOut, std::string *aError)
+{
+    jpeg_compress_struct lInfo;
+    JpegError lError;
+    JpegDestination lDestination;
+    lInfo.err = jpeg_std_error(&lError.puManager);
+    lError.puManager.error_exit = onJpegError;
+    if (setjmp(lError.puJump))
+    {
+        jpeg_destroy_compress(&lInfo);
+        *aError = lError.puMessage;
+        return false;
+    }
+
+    jpeg_create_compress(&lInfo);
+    lDestination.puManager.init_destination = initJpegDestination;
+    lDestination.puManager.empty_output_buffer = growJpegDestination;
+    lDestination.puManager.term_destination = termJpegDestination;
+    lDestination.puBytes = aOut;
+    lInfo.dest = &lDestination.puManager;
+
+    lInfo.image_width = static_cast<JDIMENSION>(aWidth);
+    lInfo.image_height = static_cast<JDIMENSION>(aHeight);
+    lInfo.input_components = aChannels;
+    lInfo.in_color_space = aChannels == 1 ? JCS_GRAYSCALE : JCS_RGB;
+    jpeg_set_defaults(&lInfo);
+    jpeg_set_quality(&lInfo, aQuality, TRUE);
+    jpeg_start_compress(&lInfo, TRUE);
+    const size_t lRowBytes = static_cast<size_t>(aWidth) * aChannels;
+    while (lInfo.next_scanline < lInfo.image_height)
+    {
+        JSAMPROW lRow = const_cast<JSAMPROW>(aPixels + lInfo.next_scanline * lRowBytes);
+        jpeg_write_scanlines(&lInfo, &lRow, 1);
+    }
+    jpeg_finish_compress(&lInfo);
+    jpeg_destroy_compress(&lInfo);
+    return true;
+}
+
+#endif // READERD_HAVE_JPEG
+
+#ifdef READERD_HAVE_PNG
+
+void onPngError(png_structp aPng, png_const_charp aMessage)
+{
+    std::string *lError = static_cast<std::string *>(png_get_error_ptr(aPng));
+    *lError = aMessage;
+    png_longjmp(aPng, 1);
+}
+
+void onPngWarning(png_structp, png_const_charp)
+{
+}
+
+void writePng(png_structp aPng, png_bytep aData, png_size_t aLength)
+{
+    std::vector<uint8_t> *lOut = static_cast<std::vector<uint8_t> *>(png_get_io_ptr(aPng));
+    lOut->insert(lOut->end(), aData, aData + aLength);
+}
+
+void flushPng(png_structp)
+{
+}
+
+bool encodePng(const uint8_t *aPixels, int aWidth, int aHeight, int aChannels, int aLevel,
+               std::vector<uint8_t> *aOut, std::string *aError)
+{
+    png_structp lPng = png_create_write_struct(PNG_LIBPNG_VER_STRING, aError, onPngError, onPngWarning);
+    if (lPng == nullptr)
+    {
+        *aError = "png_create_write_struct failed";
+        return false;
+    }
+    png_infop lInfo = png_create_info_struct(lPng);
+    if (lInfo == nullptr)
+    {
+        png_destroy_write_struct(&lPng, nullptr);
+        *aError = "png_create_info_struct failed";
+        return false;
+    }
+    if (setjmp(png_jmpbuf(lPng)))
+    {
+        png_destroy_write_struct(&lPng, &lInfo);
+        return false;
+    }
+
+    png_set_write_fn(lPng, aOut, writePng, flushPng);
+    png_set_IHDR(lPng, lInfo, static_cast<png_uint_32>(aWidth), static_cast<png_uint_32>(aHeight), 8,
+                 aChannels == 1 ? PNG_COLOR_TYPE_GRAY : PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                 PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_set_compression_level(lPng, aLevel);
+    // The adaptive filter search costs more than it saves on scanned pages.
+    png_set_filter(lPng, PNG_FILTER_TYPE_BASE, PNG_FILTER_SUB | PNG_FILTER_UP);
+    png_write_info(lPng, lInfo);
+    const size_t lRowBytes = static_cast<size_t>(aWidth) * aChannels;
+    for (int y = 0; y < aHeight; ++y)
+        png_write_row(lPng, aPixels + y * lRowBytes);
+    png_write_end(lPng, lInfo);
+    png_destroy_write_struct(&lPng, &lInfo);
+    return true;
+}
+
+#endif // READERD_HAVE_PNG
+
+} // namespace
+
+const char *imageEncodingName(ImageEncoding aEncoding)
+{
+    return aEncoding == ENCODE_PNG ? "png" : "jpeg";
+}
+
+bool ImageEncoder::supported(ImageEncoding aEncoding)
+{
+    switch (aEncoding)
+    {
+    case ENCODE_JPEG:
+#ifdef READERD_HAVE_JPEG
+        return true;
+#else
+        return false;
+#endif
+    case ENCODE_PNG:
+#ifdef READERD_HAVE_PNG
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+bool ImageEncoder::encode(std::span<const uint8_t> aBitmap, MMMReaderDataType aDataType,
+                          const EncoderOptions &aOptions, EncodedImage *aImage, std::string *aError)
+{
+    BitmapView lBitmap;
+    if (!parseBitmap(aBitmap, &lBitmap))
+    {
+        *aError = "not an uncompressed 24/32bpp BMP";
+        return false;
+    }
+    if (!supported(aOptions.puEncoding))
+    {
+        *aError = std::string(imageEncodingName(aOptions.puEncoding)) + " support was not built in";
+        return false;
+    }
+
+    const auto lStart = std::chrono::steady_clock::now();
+    const bool lPhoto = aDataType == CD_IMAGEPHOTO;
+    const int lChannels = isInfraredDataType(aDataType) ? 1 : 3;
+    int lHalvings = 0;
+    if (!lPhoto && aOptions.puScaleDown > 1)
+        lHalvings = std::bit_width(static_cast<unsigned>(aOptions.puScaleDown)) - 1;
+    int lWidth = lBitmap.puWidth;
+    int lHeight = lBitmap.puHeight;
+
+    // Scratch planes are reused by each worker from one image to the next.
+    thread_local std::vector<uint8_t> tPixels;
+    thread_local std::vector<uint8_t> tScaled;
+    if (lChannels == 1 && lHalvings == 0)
+    {
+        tPixels.resize(static_cast<size_t>(lWidth) * lHeight);
+        bitmapExtractChannel(lBitmap, 1, tPixels.data());
+    }
+    else
+    {
+        tPixels.resize(static_cast<size_t>(lWidth) * lHeight * 3);
+        bitmapToRgb(lBitmap, tPixels.data());
+        for (; lHalvings > 0 && lWidth >= 2 && lHeight >= 2; --lHalvings)
+        {
+            tScaled.resize(static_cast<size_t>(lWidth / 2) * (lHeight / 2) * 3);
+            downscaleRgb(tPixels.data(), lWidth, lHeight, tScaled.data());
+            tPixels.swap(tScaled);
+            lWidth /= 2;
+            lHeight /= 2;
+        }
+        if (lChannels == 1)
+        {
+            const size_t lPixels = static_cast<size_t>(lWidth) * lHeight;
+            tScaled.resize(lPixels);
+            extractChannel(tPixels.data(), tScaled.data(), lPixels, 3, 1);
+            tPixels.swap(tScaled);
+        }
+    }
+
+    auto lOut = std::make_shared<std::vector<uint8_t>>();
+    bool lEncoded = false;
+#ifdef READERD_HAVE_JPEG
+    if (aOptions.puEncoding == ENCODE_JPEG)
+    {
+        const int lQuality = lPhoto ? aOptions.puPhotoQuality : aOptions.puImageQuality;
+        lEncoded = encodeJpeg(tPixels.data(), lWidth, lHeight, lChannels, lQuality, lOut.get(), aError);
+    }
+#endif
+#ifdef READERD_HAVE_PNG
+    if (aOptions.puEncoding == ENCODE_PNG)
+        lEncoded = encodePng(tPixels.data(), lWidth, lHeight, lChannels, aOptions.puPngLevel, lOut.get(), aError);
+#endif
+    if (!lEncoded)
+        return false;
+
+    aImage->puDataType = aDataType;
+    aImage->puEncoding = aOptions.puEncoding;
+    aImage->puWidth = lWidth;
+    aImage->puHeight = lHeight;
+    aImage->puChannels = lChannels;
+    const size_t lSize = lOut->size();
+    aImage->puBytes = DataRef::adopt(std::shared_ptr<const uint8_t[]>(lOut, lOut->data()), lSize);
+    aImage->puEncodeUs =
+        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - lStart).count();
+    return true;
+}
+
+ImageEncoder::ImageEncoder(const EncoderOptions &aOptions, Sink aSink)
+    : prOptions(aOptions)
+    , prSink(std::move(aSink))
+    , prQueue(aOptions.puQueueCapacity)
+{
+    for (unsigned i = 0; i < (aOptions.puThreads ? aOptions.puThreads : 1); ++i)
+        prWorkers.emplace_back(&ImageEncoder::workerLoop, this);
+}
+
+ImageEncoder::~ImageEncoder()
+{
+    prQueue.close();
+    for (std::thread &lWorker : prWorkers)
+        lWorker.join();
+}
+
+void ImageEncoder::onData(const DataItem &aItem)
+{
+    if (!isImageDataType(aItem.type()))
+        return;
+
+    const std::span<const uint8_t> lBytes = aItem.bytes();
+    if (lBytes.size() < 2 || lBytes[0] != 'B' || lBytes[1] != 'M')
+    {
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        ++prStats.puSkipped;
+        return;
+    }
+
+    bool lQueued = false;
+    if (prQueue.size() < prQueue.capacity())
+        lQueued = prQueue.tryPush(Job{aItem.type(), aItem.document(), aItem.retain()});
+    if (!lQueued)
+    {
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        ++prStats.puDropped;
+    }
+}
+
+bool ImageEncoder::waitForCapacity(size_t aImages, std::chrono::milliseconds aTimeout)
+{
+    return prQueue.waitForSpace(aImages, aTimeout);
+}
+
+void ImageEncoder::drain()
+{
+    prQueue.join();
+}
+
+ImageEncoder::Stats ImageEncoder::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prStatsMutex);
+    return prStats;
+}
+
+void ImageEncoder::workerLoop()
+{
+    Job lJob;
+    while (prQueue.pop(&lJob))
+    {
+        EncodedImage lImage;
+        std::string lError;
+        const size_t lInputBytes = lJob.puBytes.size();
+        const bool lEncoded = encode(lJob.puBytes.bytes(), lJob.puDataType, prOptions, &lImage, &lError);
+        lImage.puDocument = lJob.puDocument;
+        lJob.puBytes = DataRef();
+
+        {
+            std::lock_guard<std::mutex> lLock(prStatsMutex);
+            if (lEncoded)
+            {
+                ++prStats.puEncoded;
+                prStats.puInputBytes += lInputBytes;
+                prStats.puOutputBytes += lImage.puBytes.size();
+                prStats.puEncodeUs += lImage.puEncodeUs;
+            }
+            else
+            {
+                ++prStats.puFailed;
+            }
+        }
+        if (!lEncoded)
+            std::fprintf(stderr, "readerd: encoding %s failed: %s\n", dataTypeName(lJob.puDataType).c_str(),
+                         lError.c_str());
+        else if (prSink)
+            prSink(std::move(lImage));
+        prQueue.taskDone();
+    }
+}
+
+} // namespace readerd
@@ -0,0 +1,297 @@
+#include "readerd/LaneOrchestrator.h"
+
+#include "readerd/ReaderBackend.h"
+#include "readerd/WorkerProcess.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <sched.h>
+#include <sys/wait.h>
+
+namespace readerd {
+
+namespace {
+
+constexpr auto kConnectRetry = std::chrono::milliseconds(50);
+
+std::vector<int> allowedCpus()
+{
+    std::vector<int> lCpus;
+    cpu_set_t lSet;
+    CPU_ZERO(&lSet);
+    if (sched_getaffinity(0, sizeof(lSet), &lSet) != 0)
+        return lCpus;
+    for (int lCpu = 0; lCpu < CPU_SETSIZE; ++lCpu)
+    {
+        if (CPU_ISSET(lCpu, &lSet))
+            lCpus.push_back(lCpu);
+    }
+    return lCpus;
+}
+
+} // namespace
+
+struct LaneOrchestrator::Lane
+{
+    size_t puIndex = 0;
+    std::string puScanner;
+    std::vector<int> puCpus;
+    std::string puSocketPath;
+    pid_t puPid = -1;
+    std::thread puThread;
+    std::atomic<uint64_t> puDocuments{0};
+    std::atomic<uint64_t> puRecords{0};
+    std::atomic<uint64_t> puBytes{0};
+    bool puRunning = false;     ///< Guarded by prMutex, like puExitStatus.
+    int puExitStatus = 0;
+};
+
+LaneOrchestrator::LaneOrchestrator(const LaneOptions &aOptions)
+    : prOptions(aOptions)
+    , prServer(aOptions.puSocketPath, aOptions.puClientQueueLimit, aOptions.puFraming)
+{
+}
+
+LaneOrchestrator::~LaneOrchestrator()
+{
+    stop();
+}
+
+MMMReaderErrorCode LaneOrchestrator::start(std::string *aError)
+{
+    std::vector<std::string> lScanners = prOptions.puScanners;
+    if (lScanners.empty())
+    {
+        std::unique_ptr<ReaderBackend> lBackend = createBackend(prOptions.puBackendSpec, aError);
+        if (!lBackend)
+            return ERROR_PARAMETER_INVALID;
+        const MMMReaderErrorCode lResult = lBackend->getConnectedScanners(&lScanners);
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            *aError = "MMMReader_GetConnectedScanners failed: " + errorCodeName(lResult);
+            return lResult;
+        }
+        if (lScanners.empty())
+        {
+            *aError = "no readers are connected";
+            return ERROR_READER_NOT_CONNECTED;
+        }
+    }
+
+    // Split the CPUs into one disjoint run per lane; with fewer CPUs than lanes, lanes share
+    // them round-robin.
+    std::vector<int> lCpus;
+    if (prOptions.puPinCpus)
+        lCpus = prOptions.puCpus.empty() ? allowedCpus() : prOptions.puCpus;
+    const size_t lPerLane = std::max<size_t>(1, lCpus.size() / lScanners.size());
+
+    for (size_t i = 0; i < lScanners.size(); ++i)
+    {
+        auto lLane = std::make_unique<Lane>();
+        lLane->puIndex = i;
+        lLane->puScanner = lScanners[i];
+        for (size_t j = 0; j < lPerLane && !lCpus.empty(); ++j)
+            lLane->puCpus.push_back(lCpus[(i * lPerLane + j) % lCpus.size()]);
+        lLane->puSocketPath = workerSocketPath("lane", static_cast<uint32_t>(i));
+        prLanes.push_back(std::move(lLane));
+    }
+
+    const MMMReaderErrorCode lResult = prServer.start(aError);
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        prLanes.clear();
+        return lResult;
+    }
+
+    prStartTime = std::chrono::steady_clock::now();
+    for (const std::unique_ptr<Lane> &lLane : prLanes)
+    {
+        std::vector<std::string> lArguments = {prOptions.puWorkerPath, "--backend", prOptions.puBackendSpec,
+                                               "--scanner", lLane->puScanner, "--socket", lLane->puSocketPath,
+                                               "--framing", "documents"};
+        lArguments.insert(lArguments.end(), prOptions.puWorkerArguments.begin(), prOptions.puWorkerArguments.end());
+        std::filesystem::remove(lLane->puSocketPath);
+        const pid_t lPid = spawnWorker(lArguments, lLane->puCpus, -1, aError);
+        if (lPid < 0)
+        {
+            stop();
+            return ERROR_OS_ERROR;
+        }
+
+        std::lock_guard<std::mutex> lLock(prMutex);
+        lLane->puPid = lPid;
+        lLane->puRunning = true;
+        ++prRunningLanes;
+    }
+
+    for (const std::unique_ptr<Lane> &lLane : prLanes)
+        lLane->puThread = std::thread(&LaneOrchestrator::laneLoop, this, std::ref(*lLane));
+    return NO_ERROR_OCCURRED;
+}
+
+void LaneOrchestrator::stop()
+{
+    prStopping = true;
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        for (const std::unique_ptr<Lane> &lLane : prLanes)
+        {
+            if (lLane->puRunning)
+                kill(lLane->puPid, SIGTERM);
+        }
+    }
+    for (const std::unique_ptr<Lane> &lLane : prLanes)
+    {
+        if (lLane->puThread.joinable())
+            lLane->puThread.join();
+        // A lane whose thread never started still has its worker to wait for.
+        reap(*lLane, true);
+        std::filesystem::remove(lLane->puSocketPath);
+    }
+    prServer.stop();
+}
+
+bool LaneOrchestrator::waitForDocuments(uint64_t aCount, std::chrono::milliseconds aTimeout)
+{
+    std::unique_lock<std::mutex> lLock(prMutex);
+    return prProgress.wait_for(lLock, aTimeout,
+                               [&] { return prDocuments.load() >= aCount || prRunningLanes == 0; });
+}
+
+std::vector<LaneStats> LaneOrchestrator::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    std::vector<LaneStats> lStats;
+    for (const std::unique_ptr<Lane> &lLane : prLanes)
+    {
+        LaneStats lLaneStats;
+        lLaneStats.puScanner = lLane->puScanner;
+        lLaneStats.puCpus = lLane->puCpus;
+        lLaneStats.puPid = lLane->puPid;
+        lLaneStats.puDocuments = lLane->puDocuments.load();
+        lLaneStats.puRecords = lLane->puRecords.load();
+        lLaneStats.puBytes = lLane->puBytes.load();
+        lLaneStats.puRunning = lLane->puRunning;
+        lLaneStats.puExitStatus = lLane->puExitStatus;
+        lStats.push_back(std::move(lLaneStats));
+    }
+    return lStats;
+}
+
+double LaneOrchestrator::elapsedSeconds() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - prStartTime).count();
+}
+
+void LaneOrchestrator::reap(Lane &aLane, bool aWait)
+{
+    // Only the lane's own thread reaps it, or stop() once that thread is joined, so the wait
+    // itself needs no lock.
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (!aLane.puRunning)
+            return;
+    }
+    int lStatus = 0;
+    pid_t lPid;
+    do
+        lPid = waitpid(aLane.puPid, &lStatus, aWait ? 0 : WNOHANG);
+    while (lPid < 0 && errno == EINTR);
+    if (lPid == 0)
+        return;
+    std::lock_guard<std::mutex> lLock(prMutex);
+    aLane.puRunning = false;
+    aLane.puExitStatus = lStatus;
+    --prRunningLanes;
+    prProgress.notify_all();
+}
+
+bool LaneOrchestrator::connectLane(Lane &aLane, ResultClient &aClient)
+{
+    // The worker binds its socket before it initialises the reader, but not at once.
+    std::string lError;
+    while (!prStopping)
+    {
+        if (aClient.connect(aLane.puSocketPath, &lError) == NO_ERROR_OCCURRED)
+            return true;
+        reap(aLane, false);
+        {
+            std::lock_guard<std::mutex> lLock(prMutex);
+            if (!aLane.puRunning)
+                return false;
+        }
+        std::this_thread::sleep_for(kConnectRetry);
+    }
+    return false;
+}
+
+void LaneOrchestrator::laneLoop(Lane &aLane)
+{
+    ResultClient lClient;
+    std::string lError;
+    if (connectLane(aLane, lClient))
+    {
+        DocumentRelay lRelay(prServer, prNextDocument);
+        lRelay.setScanner(static_cast<uint32_t>(aLane.puIndex), aLane.puScanner);
+        Frame lFrame;
+        while (lClient.readFrame(&lFrame, &lError))
+        {
+            aLane.puRecords += lFrame.puRecords.size();
+            aLane.puBytes += lFrame.puBytes.size();
+            const uint32_t lEnded = lRelay.relay(lFrame);
+            if (lEnded > 0)
+            {
+                aLane.puDocuments += lEnded;
+                prDocuments += lEnded;
+                std::lock_guard<std::mutex> lLock(prMutex);
+                prProgress.notify_all();
+            }
+        }
+    }
+
+    if (!lError.empty() && !prStopping)
+        std::fprintf(stderr, "readerd: lane %zu (%s): %s\n", aLane.puIndex, aLane.puScanner.c_str(), lError.c_str());
+    reap(aLane, true);
+    if (!prStopping)
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        std::fprintf(stderr, "readerd: lane %zu (%s) worker exited with status %d\n", aLane.puIndex,
+                     aLane.puScanner.c_str(),
+                     WIFEXITED(aLane.puExitStatus) ? WEXITSTATUS(aLane.puExitStatus) : 128 + WTERMSIG(aLane.puExitStatus));
+    }
+}
+
+bool parseCpuList(const std::string &aList, std::vector<int> *aCpus)
+{
+    aCpus->clear();
+    size_t lStart = 0;
+    while (lStart <= aList.size())
+    {
+        const size_t lEnd = std::min(aList.find(',', lStart), aList.size());
+        const std::string lToken = aList.substr(lStart, lEnd - lStart);
+        char *lRest = nullptr;
+        const long lFirst = std::strtol(lToken.c_str(), &lRest, 10);
+        long lLast = lFirst;
+        if (lRest == lToken.c_str())
+            return false;
+        if (*lRest == '-')
+        {
+            const char *lSecond = lRest + 1;
+            lLast = std::strtol(lSecond, &lRest, 10);
+            if (lRest == lSecond)
+                return false;
+        }
+        if (*lRest != '\0' || lFirst < 0 || lLast < lFirst || lLast >= CPU_SETSIZE)
+            return false;
+        for (long lCpu = lFirst; lCpu <= lLast; ++lCpu)
+            aCpus->push_back(static_cast<int>(lCpu));
+        lStart = lEnd + 1;
+    }
+    return !aCpus->empty();
+}
+
+} // namespace readerd
@@ -0,0 +1,587 @@
+#include "readerd/MrzParser.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define READERD_X86 1
+#endif
+
+namespace readerd {
+
+namespace {
+
+// Codelines checked together by one kernel call.
+constexpr int kLanes = 16;
+
+// Longest MRZ, as the joined lines of a TD1.
+constexpr int kMaxMrzLength = 90;
+
+constexpr int kWeights[3] = {7, 3, 1};
+
+// A run of characters in the joined lines of an MRZ.
+struct MrzRange
+{
+    int puBegin;
+    int puLength;
+};
+
+// A check digit at puCheck over the concatenation of up to four ranges.
+struct MrzCheck
+{
+    MMMReaderCheckDigitType puType;
+    int puCheck;
+    MrzRange puRanges[4];
+};
+
+struct MrzLayout
+{
+    MrzFormat puFormat;
+    int puLines;
+    int puLineLength;
+    const char *puDocId;
+    MrzRange puName;
+    MrzRange puDocNumber;
+    MrzRange puNationality;
+    MrzRange puDateOfBirth;
+    int puSex;
+    MrzRange puExpiryDate;
+    MrzRange puOptional1;
+    MrzRange puOptional2;
+    int puCheckCount;
+    MrzCheck puChecks[MAX_CHECKDIGITDATA_COUNT];
+};
+
+// Positions are in the lines joined without separators, so the second line of a TD3 starts
+// at 44 and the third line of a TD1 at 60.
+const MrzLayout kLayouts[] = {
+    {MRZ_TD1, 3, 30, "IDTHREELINE", {60, 30}, {5, 9}, {45, 3}, {30, 6}, 37, {38, 6}, {15, 15}, {48, 11}, 4,
+     {{CDT_DocID, 14, {{5, 9}}},
+      {CDT_DOB, 36, {{30, 6}}},
+      {CDT_Expiry, 44, {{38, 6}}},
+      {CDT_Overall, 59, {{5, 25}, {30, 7}, {38, 7}, {48, 11}}}}},
+    {MRZ_TD2, 2, 36, "IDTWOLINE", {5, 31}, {36, 9}, {46, 3}, {49, 6}, 56, {57, 6}, {64, 7}, {0, 0}, 4,
+     {{CDT_DocID, 45, {{36, 9}}},
+      {CDT_DOB, 55, {{49, 6}}},
+      {CDT_Expiry, 63, {{57, 6}}},
+      {CDT_Overall, 71, {{36, 10}, {49, 7}, {57, 14}}}}},
+    {MRZ_TD3, 2, 44, "PASSPORT", {5, 39}, {44, 9}, {54, 3}, {57, 6}, 64, {65, 6}, {72, 14}, {0, 0}, 5,
+     {{CDT_DocID, 53, {{44, 9}}},
+      {CDT_DOB, 63, {{57, 6}}},
+      {CDT_Expiry, 71, {{65, 6}}},
+      {CDT_OptionalData, 86, {{72, 14}}},
+      {CDT_Overall, 87, {{44, 10}, {57, 7}, {65, 22}}}}},
+    {MRZ_MRVA, 2, 44, "LONGVISA", {5, 39}, {44, 9}, {54, 3}, {57, 6}, 64, {65, 6}, {72, 16}, {0, 0}, 3,
+     {{CDT_DocID, 53, {{44, 9}}},
+      {CDT_DOB, 63, {{57, 6}}},
+      {CDT_Expiry, 71, {{65, 6}}}}},
+    {MRZ_MRVB, 2, 36, "SHORTVISA", {5, 31}, {36, 9}, {46, 3}, {49, 6}, 56, {57, 6}, {64, 8}, {0, 0}, 3,
+     {{CDT_DocID, 45, {{36, 9}}},
+      {CDT_DOB, 55, {{49, 6}}},
+      {CDT_Expiry, 63, {{57, 6}}}}},
+};
+
+const MrzLayout *findLayout(int aLines, int aLineLength, char aFirst)
+{
+    const bool lVisa = aFirst == 'V';
+    for (const MrzLayout &lLayout : kLayouts)
+    {
+        const bool lVisaLayout = lLayout.puFormat == MRZ_MRVA || lLayout.puFormat == MRZ_MRVB;
+        if (lLayout.puLines == aLines && lLayout.puLineLength == aLineLength
+            && (lLayout.puLines == 3 || lVisa == lVisaLayout))
+            return &lLayout;
+    }
+    return nullptr;
+}
+
+inline uint8_t characterValue(char aChar)
+{
+    if (aChar >= '0' && aChar <= '9')
+        return static_cast<uint8_t>(aChar - '0');
+    if (aChar >= 'A' && aChar <= 'Z')
+        return static_cast<uint8_t>(aChar - 'A' + 10);
+    return 0;
+}
+
+// Splits a codeline into its lines and joins them into aJoined. Returns the layout, or
+// nullptr when the line count and lengths match none.
+const MrzLayout *joinCodeline(std::string_view aCodeline, char *aJoined)
+{
+    int lLines = 0;
+    int lLineLength = 0;
+    int lLength = 0;
+    size_t lStart = 0;
+    while (lStart <= aCodeline.size())
+    {
+        size_t lEnd = aCodeline.find_first_of("\r\n|", lStart);
+        if (lEnd == std::string_view::npos)
+            lEnd = aCodeline.size();
+        std::string_view lLine = aCodeline.substr(lStart, lEnd - lStart);
+        while (!lLine.empty() && lLine.back() == ' ')
+            lLine.remove_suffix(1);
+        if (!lLine.empty())
+        {
+            if (lLength + static_cast<int>(lLine.size()) > kMaxMrzLength
+                || (lLines > 0 && static_cast<int>(lLine.size()) != lLineLength))
+                return nullptr;
+            std::memcpy(aJoined + lLength, lLine.data(), lLine.size());
+            lLineLength = static_cast<int>(lLine.size());
+            lLength += lLineLength;
+            ++lLines;
+        }
+        lStart = lEnd + 1;
+    }
+    if (lLines == 0)
+        return nullptr;
+
+    // Concatenated lines: the total length alone tells the layout apart.
+    if (lLines == 1)
+    {
+        if (lLength == 90)
+            return findLayout(3, 30, aJoined[0]);
+        if (lLength == 88 || lLength == 72)
+            return findLayout(2, lLength / 2, aJoined[0]);
+        return nullptr;
+    }
+    return findLayout(lLines, lLineLength, aJoined[0]);
+}
+
+// Codelines of one layout waiting for their check digits. puColumns holds the joined lines
+// transposed, column i being character i of every lane, and is turned into character
+// values in place by the kernels. Lanes past puCount keep stale values whose digits are
+// never read.
+struct LaneGroup
+{
+    const MrzLayout *puLayout = nullptr;
+    int puCount = 0;
+    size_t puIndex[kLanes];
+    char puChars[kLanes][kMaxMrzLength];
+    alignas(32) uint8_t puColumns[kMaxMrzLength][kLanes] = {};
+};
+
+// Check digit kernels: map each column to character values, then for every check of the
+// layout leave the expected digit of each lane (0-9) in aDigits[check][lane].
+
+void checkDigitsScalar(LaneGroup *aGroup, uint8_t (*aDigits)[kLanes])
+{
+    const MrzLayout &lLayout = *aGroup->puLayout;
+    const int lLength = lLayout.puLines * lLayout.puLineLength;
+    for (int c = 0; c < lLength; ++c)
+    {
+        for (int i = 0; i < kLanes; ++i)
+            aGroup->puColumns[c][i] = characterValue(static_cast<char>(aGroup->puColumns[c][i]));
+    }
+    for (int lCheck = 0; lCheck < lLayout.puCheckCount; ++lCheck)
+    {
+        int lSums[kLanes] = {};
+        int lTap = 0;
+        for (const MrzRange &lRange : lLayout.puChecks[lCheck].puRanges)
+        {
+            for (int c = lRange.puBegin; c < lRange.puBegin + lRange.puLength; ++c, ++lTap)
+            {
+                for (int i = 0; i < kLanes; ++i)
+                    lSums[i] += aGroup->puColumns[c][i] * kWeights[lTap % 3];
+            }
+        }
+        for (int i = 0; i < kLanes; ++i)
+            aDigits[lCheck][i] = static_cast<uint8_t>(lSums[i] % 10);
+    }
+}
+
+#ifdef READERD_X86
+
+// Digits become 0-9, letters 10-35 and everything else, the filler included, 0.
+__attribute__((target("sse4.1")))
+inline __m128i characterValues(__m128i aChars)
+{
+    const __m128i lDigit = _mm_sub_epi8(aChars, _mm_set1_epi8('0'));
+    const __m128i lIsDigit = _mm_cmpeq_epi8(_mm_min_epu8(lDigit, _mm_set1_epi8(9)), lDigit);
+    const __m128i lLetter = _mm_sub_epi8(aChars, _mm_set1_epi8('A'));
+    const __m128i lIsLetter = _mm_cmpeq_epi8(_mm_min_epu8(lLetter, _mm_set1_epi8(25)), lLetter);
+    return _mm_or_si128(_mm_and_si128(lDigit, lIsDigit),
+                        _mm_and_si128(_mm_add_epi8(lLetter, _mm_set1_epi8(10)), lIsLetter));
+}
+
+__attribute__((target("sse4.1")))
+void mapColumnsSse4(LaneGroup *aGroup, int aLength)
+{
+    for (int c = 0; c < aLength; ++c)
+    {
+        __m128i *lColumn = reinterpret_cast<__m128i *>(aGroup->puColumns[c]);
+        _mm_store_si128(lColumn, characterValues(_mm_load_si128(lColumn)));
+    }
+}
+
+// The longest check (the TD1 composite) has 50 characters, so a sum stays below
+// 50 * 35 * 7 = 12250 and fits 16-bit lanes, where multiplying by 6554 and keeping the high
+// half divides by 10 exactly.
+__attribute__((target("sse4.1")))
+inline __m128i modulo10(__m128i aSums)
+{
+    const __m128i lQuotient = _mm_mulhi_epu16(aSums, _mm_set1_epi16(6554));
+    return _mm_sub_epi16(aSums, _mm_mullo_epi16(lQuotient, _mm_set1_epi16(10)));
+}
+
+__attribute__((target("sse4.1")))
+void checkDigitsSse4(LaneGroup *aGroup, uint8_t (*aDigits)[kLanes])
+{
+    const MrzLayout &lLayout = *aGroup->puLayout;
+    mapColumnsSse4(aGroup, lLayout.puLines * lLayout.puLineLength);
+    for (int lCheck = 0; lCheck < lLayout.puCheckCount; ++lCheck)
+    {
+        __m128i lLow = _mm_setzero_si128();
+        __m128i lHigh = _mm_setzero_si128();
+        int lTap = 0;
+        for (const MrzRange &lRange : lLayout.puChecks[lCheck].puRanges)
+        {
+            for (int c = lRange.puBegin; c < lRange.puBegin + lRange.puLength; ++c, ++lTap)
+            {
+                const __m128i lValues = _mm_load_si128(reinterpret_cast<const __m128i *>(aGroup->puColumns[c]));
+                const __m128i lWeight = _mm_set1_epi16(static_cast<short>(kWeights[lTap % 3]));
+                lLow = _mm_add_epi16(lLow, _mm_mullo_epi16(_mm_cvtepu8_epi16(lValues), lWeight));
+                lHigh = _mm_add_epi16(lHigh,
+                    _mm_mullo_epi16(_mm_unpackhi_epi8(lValues, _mm_setzero_si128()), lWeight));
+            }
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDigits[lCheck]),
+                         _mm_packus_epi16(modulo10(lLow), modulo10(lHigh)));
+    }
+}
+
+__attribute__((target("avx2")))
+void checkDigitsAvx2(LaneGroup *aGroup, uint8_t (*aDigits)[kLanes])
+{
+    const MrzLayout &lLayout = *aGroup->puLayout;
+    mapColumnsSse4(aGroup, lLayout.puLines * lLayout.puLineLength);
+    for (int lCheck = 0; lCheck < lLayout.puCheckCount; ++lCheck)
+    {
+        __m256i lSums = _mm256_setzero_si256();
+        int lTap = 0;
+        for (const MrzRange &lRange : lLayout.puChecks[lCheck].puRanges)
+        {
+            for (int c = lRange.puBegin; c < lRange.puBegin + lRange.puLength; ++c, ++lTap)
+            {
+                const __m256i lValues = _mm256_cvtepu8_epi16(
+                    _mm_load_si128(reinterpret_cast<const __m128i *>(aGroup->puColumns[c])));
+                lSums = _mm256_add_epi16(lSums,
+                    _mm256_mullo_epi16(lValues, _mm256_set1_epi16(static_cast<short>(kWeights[lTap % 3]))));
+            }
+        }
+        const __m256i lQuotient = _mm256_mulhi_epu16(lSums, _mm256_set1_epi16(6554));
+        const __m256i lDigits = _mm256_sub_epi16(lSums, _mm256_mullo_epi16(lQuotient, _mm256_set1_epi16(10)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(aDigits[lCheck]),
+                         _mm_packus_epi16(_mm256_castsi256_si128(lDigits), _mm256_extracti128_si256(lDigits, 1)));
+    }
+}
+
+#endif // READERD_X86
+
+void checkDigits(LaneGroup *aGroup, uint8_t (*aDigits)[kLanes])
+{
+    switch (simdLevel())
+    {
+#ifdef READERD_X86
+    case SIMD_AVX2:
+        checkDigitsAvx2(aGroup, aDigits);
+        return;
+    case SIMD_SSE4:
+        checkDigitsSse4(aGroup, aDigits);
+        return;
+#endif
+    default:
+        checkDigitsScalar(aGroup, aDigits);
+        return;
+    }
+}
+
+// Copies at most aSize - 1 characters so the field stays NUL-terminated.
+void copyField(char *aField, size_t aSize, std::string_view aValue)
+{
+    const size_t lLength = std::min(aValue.size(), aSize - 1);
+    std::memcpy(aField, aValue.data(), lLength);
+    aField[lLength] = '\0';
+}
+
+std::string_view trimFillers(std::string_view aValue)
+{
+    while (!aValue.empty() && aValue.back() == '<')
+        aValue.remove_suffix(1);
+    return aValue;
+}
+
+std::string_view rangeOf(const char *aJoined, MrzRange aRange)
+{
+    return std::string_view(aJoined + aRange.puBegin, static_cast<size_t>(aRange.puLength));
+}
+
+// YYMMDD with a two-digit year; -1 throughout when any of it is not a digit.
+MMMReaderDate parseDate(std::string_view aDate)
+{
+    for (char lChar : aDate)
+    {
+        if (lChar < '0' || lChar > '9')
+            return MMMReaderDate{-1, -1, -1};
+    }
+    auto lPair = [&aDate](size_t aAt) { return (aDate[aAt] - '0') * 10 + (aDate[aAt + 1] - '0'); };
+    return MMMReaderDate{lPair(4), lPair(2), lPair(0)};
+}
+
+const char *docType(char aCode)
+{
+    switch (aCode)
+    {
+    case 'P':
+        return "PASSPORT";
+    case 'V':
+        return "VISA";
+    case 'I':
+    case 'A':
+    case 'C':
+        return "IDENTITY CARD";
+    default:
+        return "UNKNOWN DOCUMENT";
+    }
+}
+
+// Primary identifier, then "<<", then the given names separated by single fillers.
+void parseName(std::string_view aName, MMMReaderCodelineData *aData)
+{
+    aName = trimFillers(aName);
+    const size_t lSplit = aName.find("<<");
+    std::string lSurname(aName.substr(0, lSplit));
+    std::replace(lSurname.begin(), lSurname.end(), '<', ' ');
+    copyField(aData->Surname, sizeof(aData->Surname), lSurname);
+    if (lSplit == std::string_view::npos)
+        return;
+
+    std::string lForenames;
+    int lNames = 0;
+    std::string_view lRest = aName.substr(lSplit + 2);
+    while (!lRest.empty())
+    {
+        const size_t lEnd = std::min(lRest.find('<'), lRest.size());
+        const std::string_view lName = lRest.substr(0, lEnd);
+        lRest.remove_prefix(std::min(lEnd + 1, lRest.size()));
+        if (lName.empty())
+            continue;
+        if (lNames == 0)
+            copyField(aData->Forename, sizeof(aData->Forename), lName);
+        else if (lNames == 1)
+            copyField(aData->SecondName, sizeof(aData->SecondName), lName);
+        if (lNames++ > 0)
+            lForenames += ' ';
+        lForenames += lName;
+    }
+    copyField(aData->Forenames, sizeof(aData->Forenames), lForenames);
+}
+
+void fillFields(const MrzLayout &aLayout, const char *aJoined, MMMReaderCodelineData *aData)
+{
+    std::memset(aData, 0, sizeof(*aData));
+
+    // Data is the lines joined with CR; at most 92 characters, so it always fits.
+    char *const lLines[] = {aData->Line1, aData->Line2, aData->Line3};
+    char *lData = aData->Data;
+    for (int i = 0; i < aLayout.puLines; ++i)
+    {
+        const std::string_view lLine = rangeOf(aJoined, {i * aLayout.puLineLength, aLayout.puLineLength});
+        copyField(lLines[i], MAX_CODELINE_LENGTH, lLine);
+        if (i > 0)
+            *lData++ = '\r';
+        lData = std::copy(lLine.begin(), lLine.end(), lData);
+    }
+    aData->LineCount = aLayout.puLines;
+
+    copyField(aData->DocId, sizeof(aData->DocId), aLayout.puDocId);
+    copyField(aData->DocType, sizeof(aData->DocType), docType(aJoined[0]));
+    copyField(aData->IssuingState, sizeof(aData->IssuingState), trimFillers(rangeOf(aJoined, {2, 3})));
+    copyField(aData->Nationality, sizeof(aData->Nationality), trimFillers(rangeOf(aJoined, aLayout.puNationality)));
+    copyField(aData->DocNumber, sizeof(aData->DocNumber), trimFillers(rangeOf(aJoined, aLayout.puDocNumber)));
+    parseName(rangeOf(aJoined, aLayout.puName), aData);
+
+    const std::string_view lDateOfBirth = rangeOf(aJoined, aLayout.puDateOfBirth);
+    const std::string_view lExpiryDate = rangeOf(aJoined, aLayout.puExpiryDate);
+    copyField(aData->DateOfBirthMRZ, sizeof(aData->DateOfBirthMRZ), lDateOfBirth);
+    copyField(aData->ExpiryDateMRZ, sizeof(aData->ExpiryDateMRZ), lExpiryDate);
+    aData->DateOfBirth = parseDate(lDateOfBirth);
+    aData->ExpiryDate = parseDate(lExpiryDate);
+
+    const char lSex = aJoined[aLayout.puSex];
+    aData->ShortSex = lSex == 'M' || lSex == 'F' ? lSex : 'U';
+    copyField(aData->Sex, sizeof(aData->Sex), lSex == 'M' ? "Male" : lSex == 'F' ? "Female" : "Unknown");
+
+    copyField(aData->OptionalData1, sizeof(aData->OptionalData1), trimFillers(rangeOf(aJoined, aLayout.puOptional1)));
+    copyField(aData->OptionalData2, sizeof(aData->OptionalData2), trimFillers(rangeOf(aJoined, aLayout.puOptional2)));
+}
+
+MMMReaderCheckDigitResult checkResult(char aRead, int aExpected)
+{
+    // A filler stands for a check digit of zero over an empty field.
+    const bool lDigit = (aRead >= '0' && aRead <= '9') || aRead == '<';
+    return lDigit && characterValue(aRead) == aExpected ? CDR_Valid : CDR_Invalid;
+}
+
+void setCheckDigit(const MrzLayout &aLayout, MMMReaderCheckDigitType aType, int aPosition, char aRead, int aExpected,
+                   MMMReaderCodelineCheckDigitData *aDigit)
+{
+    aDigit->puCheckDigitType = aType;
+    aDigit->puCodelineNumber = aPosition / aLayout.puLineLength + 1;
+    aDigit->puCodelinePos = aPosition % aLayout.puLineLength;
+    aDigit->puValueExpected = static_cast<char>('0' + aExpected);
+    aDigit->puValueRead = aRead;
+    aDigit->puResult = checkResult(aRead, aExpected);
+}
+
+// A TD1 document number longer than nine characters runs on into the optional data after a
+// filler at the check digit position, and ends with its own check digit there.
+void extendDocumentNumber(const char *aJoined, MMMReaderCodelineData *aData)
+{
+    const std::string_view lOverflow = trimFillers(rangeOf(aJoined, {15, 15}));
+    const size_t lLength = std::min(lOverflow.find('<'), lOverflow.size());
+    if (aJoined[14] != '<' || lLength < 2)
+        return;
+
+    std::string lNumber(rangeOf(aJoined, {5, 9}));
+    lNumber.append(lOverflow.substr(0, lLength - 1));
+    copyField(aData->DocNumber, sizeof(aData->DocNumber), lNumber);
+    copyField(aData->OptionalData1, sizeof(aData->OptionalData1),
+              lOverflow.substr(std::min(lLength + 1, lOverflow.size())));
+    setCheckDigit(kLayouts[0], CDT_DocID, static_cast<int>(15 + lLength - 1), lOverflow[lLength - 1],
+                  mrzCheckDigit(lNumber) - '0', &aData->CheckDigitDataList[0]);
+}
+
+size_t flushGroup(LaneGroup *aGroup, std::span<MMMReaderCodelineData> aResults)
+{
+    if (aGroup->puCount == 0)
+        return 0;
+    const MrzLayout &lLayout = *aGroup->puLayout;
+    const int lLength = lLayout.puLines * lLayout.puLineLength;
+
+    for (int c = 0; c < lLength; ++c)
+    {
+        for (int i = 0; i < aGroup->puCount; ++i)
+            aGroup->puColumns[c][i] = static_cast<uint8_t>(aGroup->puChars[i][c]);
+    }
+    uint8_t lDigits[MAX_CHECKDIGITDATA_COUNT][kLanes];
+    checkDigits(aGroup, lDigits);
+
+    size_t lValid = 0;
+    for (int i = 0; i < aGroup->puCount; ++i)
+    {
+        const char *lJoined = aGroup->puChars[i];
+        MMMReaderCodelineData &lData = aResults[aGroup->puIndex[i]];
+        fillFields(lLayout, lJoined, &lData);
+        for (int lCheck = 0; lCheck < lLayout.puCheckCount; ++lCheck)
+        {
+            const MrzCheck &lSpec = lLayout.puChecks[lCheck];
+            setCheckDigit(lLayout, lSpec.puType, lSpec.puCheck, lJoined[lSpec.puCheck], lDigits[lCheck][i],
+                          &lData.CheckDigitDataList[lCheck]);
+        }
+        lData.CheckDigitDataListCount = lLayout.puCheckCount;
+        if (lLayout.puFormat == MRZ_TD1)
+            extendDocumentNumber(lJoined, &lData);
+
+        lData.CodelineValidationResult = CDR_Valid;
+        for (int lCheck = 0; lCheck < lLayout.puCheckCount; ++lCheck)
+        {
+            if (lData.CheckDigitDataList[lCheck].puResult != CDR_Valid)
+                lData.CodelineValidationResult = CDR_Invalid;
+        }
+        lValid += lData.CodelineValidationResult == CDR_Valid ? 1 : 0;
+    }
+    aGroup->puCount = 0;
+    return lValid;
+}
+
+// Parses aCodelines[aBegin, aEnd), gathering each layout into its own group of lanes.
+size_t parseRange(std::span<const std::string_view> aCodelines, size_t aBegin, size_t aEnd,
+                  std::span<MMMReaderCodelineData> aResults, std::span<MrzFormat> aFormats)
+{
+    LaneGroup lGroups[MRZ_FORMAT_COUNT];
+    size_t lValid = 0;
+    for (size_t lIndex = aBegin; lIndex < aEnd; ++lIndex)
+    {
+        char lJoined[kMaxMrzLength];
+        const MrzLayout *lLayout = joinCodeline(aCodelines[lIndex], lJoined);
+        if (!aFormats.empty())
+            aFormats[lIndex] = lLayout ? lLayout->puFormat : MRZ_UNKNOWN;
+        if (lLayout == nullptr)
+        {
+            std::memset(&aResults[lIndex], 0, sizeof(aResults[lIndex]));
+            continue;
+        }
+
+        LaneGroup &lGroup = lGroups[lLayout->puFormat];
+        lGroup.puLayout = lLayout;
+        std::memcpy(lGroup.puChars[lGroup.puCount], lJoined, static_cast<size_t>(lLayout->puLines * lLayout->puLineLength));
+        lGroup.puIndex[lGroup.puCount] = lIndex;
+        if (++lGroup.puCount == kLanes)
+            lValid += flushGroup(&lGroup, aResults);
+    }
+    for (LaneGroup &lGroup : lGroups)
+        lValid += flushGroup(&lGroup, aResults);
+    return lValid;
+}
+
+} // namespace
+
+const char *mrzFormatName(MrzFormat aFormat)
+{
+    switch (aFormat)
+    {
+    case MRZ_TD1:
+        return "td1";
+    case MRZ_TD2:
+        return "td2";
+    case MRZ_TD3:
+        return "td3";
+    case MRZ_MRVA:
+        return "mrva";
+    case MRZ_MRVB:
+        return "mrvb";
+    default:
+        return "unknown";
+    }
+}
+
+char mrzCheckDigit(std::string_view aChars)
+{
+    int lSum = 0;
+    for (size_t i = 0; i < aChars.size(); ++i)
+        lSum += characterValue(aChars[i]) * kWeights[i % 3];
+    return static_cast<char>('0' + lSum % 10);
+}
+
+MrzFormat parseMrz(std::string_view aCodeline, MMMReaderCodelineData *aData)
+{
+    MrzFormat lFormat = MRZ_UNKNOWN;
+    parseRange(std::span<const std::string_view>(&aCodeline, 1), 0, 1,
+               std::span<MMMReaderCodelineData>(aData, 1), std::span<MrzFormat>(&lFormat, 1));
+    return lFormat;
+}
+
+MrzBatchParser::MrzBatchParser(unsigned aThreads)
+    : prTiles(aThreads)
+{
+}
+
+size_t MrzBatchParser::parse(std::span<const std::string_view> aCodelines, std::span<MMMReaderCodelineData> aResults,
+                             std::span<MrzFormat> aFormats)
+{
+    // TileExecutor works in int rows; a row here is a block of codelines.
+    constexpr size_t kBlock = 4 * kLanes;
+    const size_t lCount = std::min(aCodelines.size(), aResults.size());
+    const int lBlocks = static_cast<int>((lCount + kBlock - 1) / kBlock);
+    std::atomic<size_t> lValid{0};
+    prTiles.forRows(lBlocks, [&](int aBegin, int aEnd) {
+        const size_t lEnd = std::min(static_cast<size_t>(aEnd) * kBlock, lCount);
+        lValid.fetch_add(parseRange(aCodelines, static_cast<size_t>(aBegin) * kBlock, lEnd, aResults, aFormats),
+                         std::memory_order_relaxed);
+    });
+    return lValid.load();
+}
+
+} // namespace readerd
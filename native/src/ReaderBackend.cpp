@@ -0,0 +1,411 @@
+#include "readerd/ReaderBackend.h"
+
+#include "readerd/SimulatedBackend.h"
+#ifdef READERD_WITH_SDK
+#include "readerd/SdkBackend.h"
+#endif
+
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+namespace readerd {
+
+namespace {
+
+struct DataTypeName
+{
+    MMMReaderDataType puDataType;
+    const char *puName;
+};
+
+const DataTypeName kDataTypeNames[] = {
+    {CD_CODELINE, "CD_CODELINE"},
+    {CD_CODELINE_DATA, "CD_CODELINE_DATA"},
+    {CD_CHECKSUM, "CD_CHECKSUM"},
+    {CD_CHECKSUMEXTENDED, "CD_CHECKSUMEXTENDED"},
+    {CD_IMAGEIR, "CD_IMAGEIR"},
+    {CD_IMAGEIRREAR, "CD_IMAGEIRREAR"},
+    {CD_IMAGEVIS, "CD_IMAGEVIS"},
+    {CD_IMAGEVISREAR, "CD_IMAGEVISREAR"},
+    {CD_IMAGEVIS_OVD1, "CD_IMAGEVIS_OVD1"},
+    {CD_IMAGEVIS_OVD2, "CD_IMAGEVIS_OVD2"},
+    {CD_IMAGEPHOTO, "CD_IMAGEPHOTO"},
+    {CD_IMAGEUV, "CD_IMAGEUV"},
+    {CD_IMAGEUVREAR, "CD_IMAGEUVREAR"},
+    {CD_IMAGECOAXVIS, "CD_IMAGECOAXVIS"},
+    {CD_IMAGECOAXIR, "CD_IMAGECOAXIR"},
+    {CD_IMAGEBARCODE, "CD_IMAGEBARCODE"},
+    {CD_IMAGEBARCODEREAR, "CD_IMAGEBARCODEREAR"},
+    {CD_SECURITYCHECK, "CD_SECURITYCHECK"},
+    {CD_SCDG1_CODELINE, "CD_SCDG1_CODELINE"},
+    {CD_SCDG1_CODELINE_DATA, "CD_SCDG1_CODELINE_DATA"},
+    {CD_SCDG2_PHOTO, "CD_SCDG2_PHOTO"},
+    {CD_SCDG3_FINGERPRINTS, "CD_SCDG3_FINGERPRINTS"},
+    {CD_SCDG1_VALIDATE, "CD_SCDG1_VALIDATE"},
+    {CD_SCDG2_VALIDATE, "CD_SCDG2_VALIDATE"},
+    {CD_SCDG3_VALIDATE, "CD_SCDG3_VALIDATE"},
+    {CD_SCDG4_VALIDATE, "CD_SCDG4_VALIDATE"},
+    {CD_SCDG5_VALIDATE, "CD_SCDG5_VALIDATE"},
+    {CD_SCDG6_VALIDATE, "CD_SCDG6_VALIDATE"},
+    {CD_SCDG7_VALIDATE, "CD_SCDG7_VALIDATE"},
+    {CD_SCDG8_VALIDATE, "CD_SCDG8_VALIDATE"},
+    {CD_SCDG9_VALIDATE, "CD_SCDG9_VALIDATE"},
+    {CD_SCDG10_VALIDATE, "CD_SCDG10_VALIDATE"},
+    {CD_SCDG11_VALIDATE, "CD_SCDG11_VALIDATE"},
+    {CD_SCDG12_VALIDATE, "CD_SCDG12_VALIDATE"},
+    {CD_SCDG13_VALIDATE, "CD_SCDG13_VALIDATE"},
+    {CD_SCDG14_VALIDATE, "CD_SCDG14_VALIDATE"},
+    {CD_SCDG15_VALIDATE, "CD_SCDG15_VALIDATE"},
+    {CD_SCDG16_VALIDATE, "CD_SCDG16_VALIDATE"},
+    {CD_SCSIGNEDATTRS_VALIDATE, "CD_SCSIGNEDATTRS_VALIDATE"},
+    {CD_SCSIGNATURE_VALIDATE, "CD_SCSIGNATURE_VALIDATE"},
+    {CD_SCAIRBAUD, "CD_SCAIRBAUD"},
+    {CD_SCCHIPID, "CD_SCCHIPID"},
+    {CD_SCEF_COM_FILE, "CD_SCEF_COM_FILE"},
+    {CD_SCEF_SOD_FILE, "CD_SCEF_SOD_FILE"},
+    {CD_SCDG1_FILE, "CD_SCDG1_FILE"},
+    {CD_SCDG2_FILE, "CD_SCDG2_FILE"},
+    {CD_SCDG3_FILE, "CD_SCDG3_FILE"},
+    {CD_SCDG4_FILE, "CD_SCDG4_FILE"},
+    {CD_SCDG5_FILE, "CD_SCDG5_FILE"},
+    {CD_SCDG6_FILE, "CD_SCDG6_FILE"},
+    {CD_SCDG7_FILE, "CD_SCDG7_FILE"},
+    {CD_SCDG8_FILE, "CD_SCDG8_FILE"},
+    {CD_SCDG9_FILE, "CD_SCDG9_FILE"},
+    {CD_SCDG10_FILE, "CD_SCDG10_FILE"},
+    {CD_SCDG11_FILE, "CD_SCDG11_FILE"},
+    {CD_SCDG12_FILE, "CD_SCDG12_FILE"},
+    {CD_SCDG13_FILE, "CD_SCDG13_FILE"},
+    {CD_SCDG14_FILE, "CD_SCDG14_FILE"},
+    {CD_SCDG15_FILE, "CD_SCDG15_FILE"},
+    {CD_SCDG16_FILE, "CD_SCDG16_FILE"},
+    {CD_SCEF_CVCA_FILE, "CD_SCEF_CVCA_FILE"},
+    {CD_SCBAC_STATUS, "CD_SCBAC_STATUS"},
+    {CD_BACKEY_CORRECTION, "CD_BACKEY_CORRECTION"},
+    {CD_ACTIVE_AUTHENTICATION, "CD_ACTIVE_AUTHENTICATION"},
+    {CD_VALIDATE_DOC_SIGNER_CERT, "CD_VALIDATE_DOC_SIGNER_CERT"},
+    {CD_SCTERMINAL_AUTHENTICATION_STATUS, "CD_SCTERMINAL_AUTHENTICATION_STATUS"},
+    {CD_SCCHIP_AUTHENTICATION_STATUS, "CD_SCCHIP_AUTHENTICATION_STATUS"},
+    {CD_SCCROSSCHECK_EFCOM_EFSOD, "CD_SCCROSSCHECK_EFCOM_EFSOD"},
+    {CD_PASSIVE_AUTHENTICATION, "CD_PASSIVE_AUTHENTICATION"},
+    {CD_SAC_STATUS, "CD_SAC_STATUS"},
+    {CD_SCEF_CARD_ACCESS_FILE, "CD_SCEF_CARD_ACCESS_FILE"},
+    {CD_EFCOM_DG_MAP, "CD_EFCOM_DG_MAP"},
+    {CD_EFSOD_HASH_MAP, "CD_EFSOD_HASH_MAP"},
+    {CD_DOC_SIGNER_CERT, "CD_DOC_SIGNER_CERT"},
+    {CD_SWIPE_MSR_DATA, "CD_SWIPE_MSR_DATA"},
+    {CD_AAMVA_DATA, "CD_AAMVA_DATA"},
+    {CD_QAINFO, "CD_QAINFO"},
+    {CD_UHF_TAGID, "CD_UHF_TAGID"},
+    {CD_UHF_EPC, "CD_UHF_EPC"},
+    {CD_UHF_MEMORY, "CD_UHF_MEMORY"},
+    {CD_SWIPE_AAMVA_DATA, "CD_SWIPE_AAMVA_DATA"},
+    {CD_READ_PROGRESS, "CD_READ_PROGRESS"},
+    {CD_INSPECTION, "CD_INSPECTION"},
+    {CD_IDENTIFIED_RESULT, "CD_IDENTIFIED_RESULT"},
+    {CD_COMPLETION_RESULT, "CD_COMPLETION_RESULT"},
+    {CD_PROCESS_RESULT_GENERAL, "CD_PROCESS_RESULT_GENERAL"},
+    {CD_PROCESS_RESULT_ICAOMRZ, "CD_PROCESS_RESULT_ICAOMRZ"},
+    {CD_PROCESS_RESULT_ICAOMRZQA, "CD_PROCESS_RESULT_ICAOMRZQA"},
+    {CD_PROCESS_RESULT_TEXT_COMPARE, "CD_PROCESS_RESULT_TEXT_COMPARE"},
+    {CD_PROCESS_RESULT_TEXT_ZONE, "CD_PROCESS_RESULT_TEXT_ZONE"},
+    {CD_PROCESS_RESULT_IMAGE_COMPARE, "CD_PROCESS_RESULT_IMAGE_COMPARE"},
+    {CD_PROCESS_RESULT_IMAGE_ZONE, "CD_PROCESS_RESULT_IMAGE_ZONE"},
+    {CD_PROCESS_RESULT_BARCODE, "CD_PROCESS_RESULT_BARCODE"},
+    {CD_PROCESS_RESULT_MAG, "CD_PROCESS_RESULT_MAG"},
+    {CD_PROCESS_RESULT_RF, "CD_PROCESS_RESULT_RF"},
+    {CD_VERIFIER_RESULT, "CD_VERIFIER_RESULT"},
+    {CD_IMAGEPHOTODATA, "CD_IMAGEPHOTODATA"},
+    {CD_SCDG1_EID_DOCUMENT_TYPE, "CD_SCDG1_EID_DOCUMENT_TYPE"},
+    {CD_SCDG2_EID_ISSUING_ENTITY, "CD_SCDG2_EID_ISSUING_ENTITY"},
+    {CD_SCDG3_EID_VALIDITY_PERIOD, "CD_SCDG3_EID_VALIDITY_PERIOD"},
+    {CD_SCDG4_EID_GIVEN_NAMES, "CD_SCDG4_EID_GIVEN_NAMES"},
+    {CD_SCDG5_EID_FAMILY_NAMES, "CD_SCDG5_EID_FAMILY_NAMES"},
+    {CD_SCDG6_EID_NOM_DE_PLUME, "CD_SCDG6_EID_NOM_DE_PLUME"},
+    {CD_SCDG7_EID_ACADEMIC_TITLE, "CD_SCDG7_EID_ACADEMIC_TITLE"},
+    {CD_SCDG8_EID_DATE_OF_BIRTH, "CD_SCDG8_EID_DATE_OF_BIRTH"},
+    {CD_SCDG9_EID_PLACE_OF_BIRTH, "CD_SCDG9_EID_PLACE_OF_BIRTH"},
+    {CD_SCDG10_EID_NATIONALITY, "CD_SCDG10_EID_NATIONALITY"},
+    {CD_SCDG11_EID_SEX, "CD_SCDG11_EID_SEX"},
+    {CD_SCDG12_EID_OPTIONAL_DATA_R, "CD_SCDG12_EID_OPTIONAL_DATA_R"},
+    {CD_SCDG13_EID_BIRTH_NAME, "CD_SCDG13_EID_BIRTH_NAME"},
+    {CD_SCDG14_EID_WRITTEN_SIGNATURE, "CD_SCDG14_EID_WRITTEN_SIGNATURE"},
+    {CD_SCDG17_EID_PLACE_OF_RESIDENCE, "CD_SCDG17_EID_PLACE_OF_RESIDENCE"},
+    {CD_SCDG18_EID_MUNICIPALITY_ID, "CD_SCDG18_EID_MUNICIPALITY_ID"},
+    {CD_SCDG19_EID_RESIDENCE_PERMIT_1, "CD_SCDG19_EID_RESIDENCE_PERMIT_1"},
+    {CD_SCDG20_EID_RESIDENCE_PERMIT_2, "CD_SCDG20_EID_RESIDENCE_PERMIT_2"},
+    {CD_SCDG21_EID_OPTIONAL_DATA_RW, "CD_SCDG21_EID_OPTIONAL_DATA_RW"},
+    {CD_SCDG1_VALIDATE_EID, "CD_SCDG1_VALIDATE_EID"},
+    {CD_SCDG2_VALIDATE_EID, "CD_SCDG2_VALIDATE_EID"},
+    {CD_SCDG3_VALIDATE_EID, "CD_SCDG3_VALIDATE_EID"},
+    {CD_SCDG4_VALIDATE_EID, "CD_SCDG4_VALIDATE_EID"},
+    {CD_SCDG5_VALIDATE_EID, "CD_SCDG5_VALIDATE_EID"},
+    {CD_SCDG6_VALIDATE_EID, "CD_SCDG6_VALIDATE_EID"},
+    {CD_SCDG7_VALIDATE_EID, "CD_SCDG7_VALIDATE_EID"},
+    {CD_SCDG8_VALIDATE_EID, "CD_SCDG8_VALIDATE_EID"},
+    {CD_SCDG9_VALIDATE_EID, "CD_SCDG9_VALIDATE_EID"},
+    {CD_SCDG10_VALIDATE_EID, "CD_SCDG10_VALIDATE_EID"},
+    {CD_SCDG11_VALIDATE_EID, "CD_SCDG11_VALIDATE_EID"},
+    {CD_SCDG12_VALIDATE_EID, "CD_SCDG12_VALIDATE_EID"},
+    {CD_SCDG13_VALIDATE_EID, "CD_SCDG13_VALIDATE_EID"},
+    {CD_SCDG14_VALIDATE_EID, "CD_SCDG14_VALIDATE_EID"},
+    {CD_SCDG15_VALIDATE_EID, "CD_SCDG15_VALIDATE_EID"},
+    {CD_SCDG16_VALIDATE_EID, "CD_SCDG16_VALIDATE_EID"},
+    {CD_SCDG17_VALIDATE_EID, "CD_SCDG17_VALIDATE_EID"},
+    {CD_SCDG18_VALIDATE_EID, "CD_SCDG18_VALIDATE_EID"},
+    {CD_SCDG19_VALIDATE_EID, "CD_SCDG19_VALIDATE_EID"},
+    {CD_SCDG20_VALIDATE_EID, "CD_SCDG20_VALIDATE_EID"},
+    {CD_SCDG21_VALIDATE_EID, "CD_SCDG21_VALIDATE_EID"},
+    {CD_SCDG22_VALIDATE_EID, "CD_SCDG22_VALIDATE_EID"},
+    {CD_SCSIGNEDATTRS_VALIDATE_CARD_SECURITY_FILE, "CD_SCSIGNEDATTRS_VALIDATE_CARD_SECURITY_FILE"},
+    {CD_SCSIGNEDATTRS_VALIDATE_CHIP_SECURITY_FILE, "CD_SCSIGNEDATTRS_VALIDATE_CHIP_SECURITY_FILE"},
+    {CD_SCSIGNATURE_VALIDATE_CARD_SECURITY_FILE, "CD_SCSIGNATURE_VALIDATE_CARD_SECURITY_FILE"},
+    {CD_SCSIGNATURE_VALIDATE_CHIP_SECURITY_FILE, "CD_SCSIGNATURE_VALIDATE_CHIP_SECURITY_FILE"},
+    {CD_SCDG1_FILE_EID, "CD_SCDG1_FILE_EID"},
+    {CD_SCDG2_FILE_EID, "CD_SCDG2_FILE_EID"},
+    {CD_SCDG3_FILE_EID, "CD_SCDG3_FILE_EID"},
+    {CD_SCDG4_FILE_EID, "CD_SCDG4_FILE_EID"},
+    {CD_SCDG5_FILE_EID, "CD_SCDG5_FILE_EID"},
+    {CD_SCDG6_FILE_EID, "CD_SCDG6_FILE_EID"},
+    {CD_SCDG7_FILE_EID, "CD_SCDG7_FILE_EID"},
+    {CD_SCDG8_FILE_EID, "CD_SCDG8_FILE_EID"},
+    {CD_SCDG9_FILE_EID, "CD_SCDG9_FILE_EID"},
+    {CD_SCDG10_FILE_EID, "CD_SCDG10_FILE_EID"},
+    {CD_SCDG11_FILE_EID, "CD_SCDG11_FILE_EID"},
+    {CD_SCDG12_FILE_EID, "CD_SCDG12_FILE_EID"},
+    {CD_SCDG13_FILE_EID, "CD_SCDG13_FILE_EID"},
+    {CD_SCDG14_FILE_EID, "CD_SCDG14_FILE_EID"},
+    {CD_SCDG15_FILE_EID, "CD_SCDG15_FILE_EID"},
+    {CD_SCDG16_FILE_EID, "CD_SCDG16_FILE_EID"},
+    {CD_SCDG17_FILE_EID, "CD_SCDG17_FILE_EID"},
+    {CD_SCDG18_FILE_EID, "CD_SCDG18_FILE_EID"},
+    {CD_SCDG19_FILE_EID, "CD_SCDG19_FILE_EID"},
+    {CD_SCDG20_FILE_EID, "CD_SCDG20_FILE_EID"},
+    {CD_SCDG21_FILE_EID, "CD_SCDG21_FILE_EID"},
+    {CD_SCDG22_FILE_EID, "CD_SCDG22_FILE_EID"},
+    {CD_VALIDATE_DOC_SIGNER_CERT_CARD_SECURITY_FILE, "CD_VALIDATE_DOC_SIGNER_CERT_CARD_SECURITY_FILE"},
+    {CD_VALIDATE_DOC_SIGNER_CERT_CHIP_SECURITY_FILE, "CD_VALIDATE_DOC_SIGNER_CERT_CHIP_SECURITY_FILE"},
+    {CD_SCEF_CHIP_SECURITY_FILE, "CD_SCEF_CHIP_SECURITY_FILE"},
+    {CD_SCEF_CARD_SECURITY_FILE, "CD_SCEF_CARD_SECURITY_FILE"},
+    {CD_SCDG1_FILE_EDL, "CD_SCDG1_FILE_EDL"},
+    {CD_SCDG2_FILE_EDL, "CD_SCDG2_FILE_EDL"},
+    {CD_SCDG3_FILE_EDL, "CD_SCDG3_FILE_EDL"},
+    {CD_SCDG4_FILE_EDL, "CD_SCDG4_FILE_EDL"},
+    {CD_SCDG5_FILE_EDL, "CD_SCDG5_FILE_EDL"},
+    {CD_SCDG6_FILE_EDL, "CD_SCDG6_FILE_EDL"},
+    {CD_SCDG7_FILE_EDL, "CD_SCDG7_FILE_EDL"},
+    {CD_SCDG8_FILE_EDL, "CD_SCDG8_FILE_EDL"},
+    {CD_SCDG9_FILE_EDL, "CD_SCDG9_FILE_EDL"},
+    {CD_SCDG10_FILE_EDL, "CD_SCDG10_FILE_EDL"},
+    {CD_SCDG11_FILE_EDL, "CD_SCDG11_FILE_EDL"},
+    {CD_SCDG12_FILE_EDL, "CD_SCDG12_FILE_EDL"},
+    {CD_SCDG13_FILE_EDL, "CD_SCDG13_FILE_EDL"},
+    {CD_SCDG14_FILE_EDL, "CD_SCDG14_FILE_EDL"},
+    {CD_SCDG1_VALIDATE_EDL, "CD_SCDG1_VALIDATE_EDL"},
+    {CD_SCDG2_VALIDATE_EDL, "CD_SCDG2_VALIDATE_EDL"},
+    {CD_SCDG3_VALIDATE_EDL, "CD_SCDG3_VALIDATE_EDL"},
+    {CD_SCDG4_VALIDATE_EDL, "CD_SCDG4_VALIDATE_EDL"},
+    {CD_SCDG5_VALIDATE_EDL, "CD_SCDG5_VALIDATE_EDL"},
+    {CD_SCDG6_VALIDATE_EDL, "CD_SCDG6_VALIDATE_EDL"},
+    {CD_SCDG7_VALIDATE_EDL, "CD_SCDG7_VALIDATE_EDL"},
+    {CD_SCDG8_VALIDATE_EDL, "CD_SCDG8_VALIDATE_EDL"},
+    {CD_SCDG9_VALIDATE_EDL, "CD_SCDG9_VALIDATE_EDL"},
+    {CD_SCDG10_VALIDATE_EDL, "CD_SCDG10_VALIDATE_EDL"},
+    {CD_SCDG11_VALIDATE_EDL, "CD_SCDG11_VALIDATE_EDL"},
+    {CD_SCDG12_VALIDATE_EDL, "CD_SCDG12_VALIDATE_EDL"},
+    {CD_SCDG13_VALIDATE_EDL, "CD_SCDG13_VALIDATE_EDL"},
+    {CD_SCDG14_VALIDATE_EDL, "CD_SCDG14_VALIDATE_EDL"},
+    {CD_SCDG1_EDL_DATA, "CD_SCDG1_EDL_DATA"},
+    {CD_SCDG6_EDL_PHOTO, "CD_SCDG6_EDL_PHOTO"},
+    {CD_SCDG7_EDL_FINGERPRINTS, "CD_SCDG7_EDL_FINGERPRINTS"},
+    {CD_DATAPAGE_TO_CHIP_MRZ_COMPARISON, "CD_DATAPAGE_TO_CHIP_MRZ_COMPARISON"},
+    {CD_DATAPAGE_TO_CHIP_FACE_COMPARISON, "CD_DATAPAGE_TO_CHIP_FACE_COMPARISON"},
+    {CD_DETECT_PROGRESS, "CD_DETECT_PROGRESS"},
+    {CD_DATA_CAPTURE_LITE, "CD_DATA_CAPTURE_LITE"},
+    {CD_DATA_CAPTURE_LITE_QAOCR, "CD_DATA_CAPTURE_LITE_QAOCR"},
+    {CD_IDV_REMOTE_DOCUMENT_VERIFICATION, "CD_IDV_REMOTE_DOCUMENT_VERIFICATION"},
+    {CD_IDV_REMOTE_CHIP_VERIFICATION, "CD_IDV_REMOTE_CHIP_VERIFICATION"},
+    {CD_IDV_REMOTE_FACE_MATCH, "CD_IDV_REMOTE_FACE_MATCH"},
+    {CD_TEXT_DATA_EXTRACTED, "CD_TEXT_DATA_EXTRACTED"},
+    {CD_DIGITAL_GREEN_CERTIFICATE, "CD_DIGITAL_GREEN_CERTIFICATE"},
+    {CD_DGC_SIGNATURE_VALIDATE, "CD_DGC_SIGNATURE_VALIDATE"},
+    {CD_DGC_DOC_SIGNER_CERT_VALIDATE, "CD_DGC_DOC_SIGNER_CERT_VALIDATE"},
+};
+
+} // namespace
+
+MMMReaderErrorCode ReaderBackend::loadAndProcessScan(std::span<const ScanFile> aFiles, bool aSendDataFlag)
+{
+    namespace fs = std::filesystem;
+
+    // One scratch directory per backend; the SDK has read the previous scan by now.
+    std::error_code lError;
+    const fs::path lDirectory = fs::temp_directory_path(lError)
+        / ("readerd-scan-" + std::to_string(::getpid()) + "-" + std::to_string(reinterpret_cast<uintptr_t>(this)));
+    fs::remove_all(lDirectory, lError);
+    fs::create_directories(lDirectory, lError);
+    if (lError)
+        return ERROR_WRITING_FILE;
+    for (const ScanFile &lFile : aFiles)
+    {
+        const fs::path lName(lFile.puName);
+        if (lName.empty() || lName != lName.filename() || lName == "." || lName == "..")
+            return ERROR_PARAMETER_INVALID;
+        std::ofstream lOut(lDirectory / lName, std::ios::binary);
+        if (!lOut.write(reinterpret_cast<const char *>(lFile.puBytes.data()),
+                        static_cast<std::streamsize>(lFile.puBytes.size())))
+            return ERROR_WRITING_FILE;
+    }
+    return loadAndProcessFromScanDirectory(lDirectory.c_str(), aSendDataFlag);
+}
+
+std::unique_ptr<ReaderBackend> createBackend(const std::string &aSpec, std::string *aError)
+{
+    const size_t lColon = aSpec.find(':');
+    const std::string lName = aSpec.substr(0, lColon);
+    const std::string lOptions = lColon == std::string::npos ? std::string() : aSpec.substr(lColon + 1);
+
+    if (lName == "sim")
+    {
+        SimulatedOptions lSimOptions;
+        if (!SimulatedOptions::parse(lOptions, &lSimOptions, aError))
+            return nullptr;
+        return std::make_unique<SimulatedBackend>(lSimOptions);
+    }
+
+    if (lName == "sdk")
+    {
+#ifdef READERD_WITH_SDK
+        if (!lOptions.empty())
+        {
+            *aError = "the sdk backend takes its settings from the SDK ini files";
+            return nullptr;
+        }
+        return std::make_unique<SdkBackend>();
+#else
+        *aError = "this build does not include the SDK backend (configure with -DREADERD_WITH_SDK=ON)";
+        return nullptr;
+#endif
+    }
+
+    *aError = "unknown backend '" + lName + "'";
+    return nullptr;
+}
+
+std::string errorCodeName(MMMReaderErrorCode aCode)
+{
+    switch (aCode)
+    {
+    case NO_ERROR_OCCURRED: return "NO_ERROR_OCCURRED";
+    case UNKNOWN_ERROR_OCCURRED: return "UNKNOWN_ERROR_OCCURRED";
+    case ERROR_FEATURE_NOT_ENABLED: return "ERROR_FEATURE_NOT_ENABLED";
+    case ERROR_FEATURE_NOT_SUPPORTED: return "ERROR_FEATURE_NOT_SUPPORTED";
+    case ERROR_NOT_INITIALISED: return "ERROR_NOT_INITIALISED";
+    case ERROR_ALREADY_INITIALISED: return "ERROR_ALREADY_INITIALISED";
+    case ERROR_INITIALISATION_FAILED: return "ERROR_INITIALISATION_FAILED";
+    case ERROR_READER_NOT_CONNECTED: return "ERROR_READER_NOT_CONNECTED";
+    case ERROR_FILE_DOES_NOT_EXIST: return "ERROR_FILE_DOES_NOT_EXIST";
+    case ERROR_READING_FILE: return "ERROR_READING_FILE";
+    case ERROR_WRITING_FILE: return "ERROR_WRITING_FILE";
+    case ERROR_LOADING_DLL: return "ERROR_LOADING_DLL";
+    case ERROR_INVALID_CONFIG_FILE_FORMAT: return "ERROR_INVALID_CONFIG_FILE_FORMAT";
+    case ERROR_OS_ERROR: return "ERROR_OS_ERROR";
+    case ERROR_ALLOCATING_MEMORY: return "ERROR_ALLOCATING_MEMORY";
+    case ERROR_PARAMETER_INVALID: return "ERROR_PARAMETER_INVALID";
+    case ERROR_INDEX_OUT_OF_BOUNDS: return "ERROR_INDEX_OUT_OF_BOUNDS";
+    case ERROR_STRING_BUFFER_TOO_SMALL: return "ERROR_STRING_BUFFER_TOO_SMALL";
+    case ERROR_DATA_BUFFER_TOO_SMALL: return "ERROR_DATA_BUFFER_TOO_SMALL";
+    case ERROR_IMAGE_WRONG_FORMAT: return "ERROR_IMAGE_WRONG_FORMAT";
+    case ERROR_TIMED_OUT: return "ERROR_TIMED_OUT";
+    case ERROR_CURRENTLY_IN_USE: return "ERROR_CURRENTLY_IN_USE";
+    case ERROR_OPERATION_CANCELLED: return "ERROR_OPERATION_CANCELLED";
+    case ERROR_ALREADY_STARTED: return "ERROR_ALREADY_STARTED";
+    case ERROR_NOT_STARTED: return "ERROR_NOT_STARTED";
+    case ERROR_RF_BAC_FAILURE: return "ERROR_RF_BAC_FAILURE";
+    case ERROR_RF_DG_NOT_PRESENT: return "ERROR_RF_DG_NOT_PRESENT";
+    case ERROR_RF_GET_DATA_ITEM_FAILED: return "ERROR_RF_GET_DATA_ITEM_FAILED";
+    case ERROR_RF_VALIDATE_DATA_ITEM_FAILED: return "ERROR_RF_VALIDATE_DATA_ITEM_FAILED";
+    case ERROR_RF_CERTS_LOAD_FAILED: return "ERROR_RF_CERTS_LOAD_FAILED";
+    case ERROR_RF_ABORTED: return "ERROR_RF_ABORTED";
+    case ERROR_INVALID_STATE_CHANGE: return "ERROR_INVALID_STATE_CHANGE";
+    case ERROR_BLOCKING_ONLY: return "ERROR_BLOCKING_ONLY";
+    case ERROR_NO_DOC_ON_WINDOW: return "ERROR_NO_DOC_ON_WINDOW";
+    case ERROR_EXCEPTION_OCCURRED: return "ERROR_EXCEPTION_OCCURRED";
+    default: return "MMMReaderErrorCode(" + std::to_string(static_cast<int>(aCode)) + ")";
+    }
+}
+
+std::string eventCodeName(MMMReaderEventCode aEvent)
+{
+    switch (aEvent)
+    {
+    case DOC_ON_WINDOW: return "DOC_ON_WINDOW";
+    case DOC_REMOVED: return "DOC_REMOVED";
+    case START_OF_DOCUMENT_DATA: return "START_OF_DOCUMENT_DATA";
+    case END_OF_DOCUMENT_DATA: return "END_OF_DOCUMENT_DATA";
+    case AUTOMATIC_STATE_CHANGE: return "AUTOMATIC_STATE_CHANGE";
+    case RF_CHIP_OPENED_SUCCESSFULLY: return "RF_CHIP_OPENED_SUCCESSFULLY";
+    case RF_APPLICATION_OPENED_SUCCESSFULLY: return "RF_APPLICATION_OPENED_SUCCESSFULLY";
+    case RF_CHIP_OPEN_FAILED: return "RF_CHIP_OPEN_FAILED";
+    case READER_ERROR_RESOLVED: return "READER_ERROR_RESOLVED";
+    case SETTINGS_INITIALISED: return "SETTINGS_INITIALISED";
+    case PLUGINS_INITIALISED: return "PLUGINS_INITIALISED";
+    case START_OF_PLUGINS_DECODE: return "START_OF_PLUGINS_DECODE";
+    case RF_CHIP_OPEN_TIMEOUT: return "RF_CHIP_OPEN_TIMEOUT";
+    case RF_CHIP_REMOVAL_SUCCESS: return "RF_CHIP_REMOVAL_SUCCESS";
+    case RF_CHIP_REMOVAL_TIMEOUT: return "RF_CHIP_REMOVAL_TIMEOUT";
+    case READY_FOR_SMARTCARD: return "READY_FOR_SMARTCARD";
+    case BEGIN_RESOLVING_ERROR: return "BEGIN_RESOLVING_ERROR";
+    case COM_PORT_OPEN: return "COM_PORT_OPEN";
+    case COM_PORT_CLOSED: return "COM_PORT_CLOSED";
+    case READING_DATA: return "READING_DATA";
+    case DATA_READ: return "DATA_READ";
+    case START_OF_SWIPE_DATA: return "START_OF_SWIPE_DATA";
+    case END_OF_SWIPE_DATA: return "END_OF_SWIPE_DATA";
+    case DEVICE_CONNECTED: return "DEVICE_CONNECTED";
+    case DEVICE_DISCONNECTED: return "DEVICE_DISCONNECTED";
+    case SWIPE_READER_CONNECTED: return "SWIPE_READER_CONNECTED";
+    case SWIPE_READER_DISCONNECTED: return "SWIPE_READER_DISCONNECTED";
+    case READER_STATE_CHANGED: return "READER_STATE_CHANGED";
+    case UHF_READ_TIMEOUT: return "UHF_READ_TIMEOUT";
+    case UHF_READ_COMPLETE: return "UHF_READ_COMPLETE";
+    case DOC_FEED_COMPLETE: return "DOC_FEED_COMPLETE";
+    case DOC_FEED_FAILED: return "DOC_FEED_FAILED";
+    case DIRT_DETECTED_ON_SCANNER_WINDOW: return "DIRT_DETECTED_ON_SCANNER_WINDOW";
+    case SWIPE_REQUESTED: return "SWIPE_REQUESTED";
+    case UHF_REQUESTED: return "UHF_REQUESTED";
+    case RF_CHIP_DETECTED: return "RF_CHIP_DETECTED";
+    case FLIP_DOCUMENT_OVER: return "FLIP_DOCUMENT_OVER";
+    case READER_CONNECTED: return "READER_CONNECTED";
+    case READER_DISCONNECTED: return "READER_DISCONNECTED";
+    default: return "MMMReaderEventCode(" + std::to_string(static_cast<int>(aEvent)) + ")";
+    }
+}
+
+std::string dataTypeName(MMMReaderDataType aDataType)
+{
+    for (const DataTypeName &lEntry : kDataTypeNames)
+    {
+        if (lEntry.puDataType == aDataType)
+            return lEntry.puName;
+    }
+    if (aDataType >= CD_PLUGIN)
+        return "CD_PLUGIN+" + std::to_string(static_cast<int>(aDataType - CD_PLUGIN));
+    return "MMMReaderDataType(" + std::to_string(static_cast<int>(aDataType)) + ")";
+}
+
+bool dataTypeFromName(const std::string &aName, MMMReaderDataType *aDataType)
+{
+    for (const DataTypeName &lEntry : kDataTypeNames)
+    {
+        if (aName == lEntry.puName)
+        {
+            *aDataType = lEntry.puDataType;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace readerd
@@ -0,0 +1,419 @@
+#include "readerd/ReaderDaemon.h"
+
+#include "readerd/BulkFetch.h"
+#include "readerd/CodelineCodec.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace readerd {
+
+ReaderDaemon::ReaderDaemon(std::unique_ptr<ReaderBackend> aBackend, const DaemonOptions &aOptions)
+    : prBackend(std::move(aBackend))
+    , prServer(aOptions.puSocketPath, aOptions.puClientQueueLimit, aOptions.puFraming)
+    , prPool(aOptions.puPoolLimit)
+    , prPoolForLarge(aOptions.puPoolLimit ? &prPool : nullptr)
+    , prPoolThreshold(aOptions.puPoolThreshold)
+    , prBus(aOptions.puBusCapacity)
+    , prSharedRingName(aOptions.puSharedRing)
+    , prSharedRingBytes(aOptions.puSharedRingBytes)
+    , prCertificatePath(aOptions.puCertificateStore)
+    , prRevocationRefreshMs(aOptions.puRevocationRefreshMs)
+    , prScanner(aOptions.puScanner)
+    , prStandby(aOptions.puStandby)
+    , prCompactCodelines(aOptions.puCompactCodelines)
+    , prBlocking(aOptions.puBlocking)
+{
+    if (aOptions.puConvertImages)
+    {
+        prConverter = std::make_unique<ImageConverter>(
+            aOptions.puConvertTarget, [this](ConvertedImage &&aImage) { publishImage(std::move(aImage)); },
+            aOptions.puConvertThreads, prPoolForLarge);
+    }
+    if (aOptions.puEncodeImages)
+    {
+        prEncoder = std::make_unique<ImageEncoder>(
+            aOptions.puEncoder, [this](EncodedImage &&aImage) { publishImage(std::move(aImage)); });
+    }
+    if (!aOptions.puRevocationLists.empty())
+    {
+        RevocationSource lSource;
+        lSource.puDirectory = aOptions.puRevocationLists;
+        prRevocations = std::make_unique<RevocationCache>(lSource);
+    }
+}
+
+ReaderDaemon::~ReaderDaemon()
+{
+    stop();
+}
+
+void ReaderDaemon::addConsumer(DataConsumer *aConsumer)
+{
+    prConsumers.push_back(aConsumer);
+}
+
+void ReaderDaemon::addAsyncConsumer(DataConsumer *aConsumer)
+{
+    prBus.subscribe(aConsumer);
+    prHasBus = true;
+}
+
+MMMReaderErrorCode ReaderDaemon::start(std::string *aError)
+{
+    std::string lIgnored;
+    if (aError == nullptr)
+        aError = &lIgnored;
+    // A step that fails takes down what the steps before it started, as stop() would.
+    const size_t lConsumers = prConsumers.size();
+    auto lFail = [this, lConsumers](MMMReaderErrorCode aResult) {
+        prBus.stop();
+        prSharedRing.close();
+        prServer.stop();
+        if (prRevocations)
+            prRevocations->stopWatching();
+        prConsumers.resize(lConsumers);
+        return aResult;
+    };
+
+    if (!prCertificatePath.empty())
+    {
+        const MMMReaderErrorCode lOpened = prCertificates.open(prCertificatePath, aError);
+        if (lOpened != NO_ERROR_OCCURRED)
+            return lOpened;
+    }
+    if (prRevocations)
+    {
+        RevocationRefreshStats lLoaded;
+        const MMMReaderErrorCode lLoadResult = prRevocations->refresh(&lLoaded, aError);
+        if (lLoadResult != NO_ERROR_OCCURRED)
+            return lLoadResult;
+        prRevocations->startWatching(prRevocationRefreshMs);
+    }
+    MMMReaderErrorCode lResult = prServer.start(aError);
+    if (lResult != NO_ERROR_OCCURRED)
+        return lFail(lResult);
+    if (!prSharedRingName.empty())
+    {
+        lResult = prSharedRing.create(prSharedRingName, prSharedRingBytes, aError);
+        if (lResult != NO_ERROR_OCCURRED)
+            return lFail(lResult);
+        prConsumers.push_back(&prSharedRing);
+    }
+
+    if (prConverter)
+        prConsumers.push_back(prConverter.get());
+    if (prEncoder)
+        prConsumers.push_back(prEncoder.get());
+    if (prHasBus)
+    {
+        prBus.start();
+        prConsumers.push_back(&prBus);
+    }
+
+    prStartTime = std::chrono::steady_clock::now();
+    if (!prScanner.empty())
+    {
+        lResult = prBackend->selectScanner(prScanner.c_str());
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            *aError = "MMMReader_SelectScanner(" + prScanner + ") failed: " + errorCodeName(lResult);
+            return lFail(lResult);
+        }
+    }
+    if (prStandby)
+    {
+        // Set before initialising, this is the state the reader starts in.
+        lResult = prBackend->setState(READER_SUSPENDED, false);
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            *aError = "MMMReader_SetState(READER_SUSPENDED) failed: " + errorCodeName(lResult);
+            return lFail(lResult);
+        }
+    }
+    if (prBlocking)
+        lResult = prBackend->initialise(nullptr, nullptr, &ReaderDaemon::onError,
+                                        &ReaderDaemon::onCertificate, this);
+    else
+        lResult = prBackend->initialise(&ReaderDaemon::onData, &ReaderDaemon::onEvent,
+                                        &ReaderDaemon::onError, &ReaderDaemon::onCertificate, this);
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        *aError = "MMMReader_Initialise failed: " + errorCodeName(lResult);
+        return lFail(lResult);
+    }
+    prStarted = true;
+
+    if (prBlocking)
+    {
+        prBlockingRunning = true;
+        prBlockingThread = std::thread(&ReaderDaemon::blockingLoop, this);
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode ReaderDaemon::activate()
+{
+    if (!prStarted)
+        return ERROR_NOT_INITIALISED;
+    return prBackend->setState(READER_ENABLED, true);
+}
+
+void ReaderDaemon::stop()
+{
+    if (!prStarted)
+        return;
+    prStarted = false;
+    prBlockingRunning = false;
+    if (prBlockingThread.joinable())
+        prBlockingThread.join();
+    prBackend->shutdown();
+    if (prConverter)
+        prConverter->drain();
+    if (prEncoder)
+        prEncoder->drain();
+    prBus.stop();
+    prSharedRing.close();
+    prServer.stop();
+    if (prRevocations)
+        prRevocations->stopWatching();
+}
+
+bool ReaderDaemon::waitForDocuments(uint64_t aCount, std::chrono::milliseconds aTimeout)
+{
+    std::unique_lock<std::mutex> lLock(prDocumentMutex);
+    return prDocumentDone.wait_for(lLock, aTimeout, [this, aCount] { return prDocuments.load() >= aCount; });
+}
+
+DaemonStats ReaderDaemon::stats() const
+{
+    DaemonStats lStats;
+    lStats.puDocuments = prDocuments.load();
+    lStats.puDataItems = prDataItems.load();
+    lStats.puDataBytes = prDataBytes.load();
+    lStats.puPinnedBytes = prPinnedBytes.load();
+    lStats.puEvents = prEvents.load();
+    lStats.puErrors = prErrors.load();
+    const BufferPool::Stats lPool = prPool.stats();
+    lStats.puPoolHits = lPool.puHits;
+    lStats.puPoolMisses = lPool.puMisses;
+    if (prConverter)
+    {
+        const ImageConverter::Stats lConverter = prConverter->stats();
+        lStats.puImagesConverted = lConverter.puConverted;
+        lStats.puImagesDropped = lConverter.puDropped;
+    }
+    if (prEncoder)
+    {
+        const ImageEncoder::Stats lEncoder = prEncoder->stats();
+        lStats.puImagesEncoded = lEncoder.puEncoded;
+        lStats.puEncodeDropped = lEncoder.puDropped;
+        lStats.puEncodedBytes = lEncoder.puOutputBytes;
+    }
+    lStats.puBusDropped = prBus.stats().puDropped;
+    const SharedRingWriter::Stats lRing = prSharedRing.stats();
+    lStats.puRingDocuments = lRing.puDocuments;
+    lStats.puRingDropped = lRing.puDropped;
+    lStats.puElapsedSeconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - prStartTime).count();
+    return lStats;
+}
+
+void ReaderDaemon::onData(void *aParam, MMMReaderDataType aDataType, int aDataLen, void *aDataPtr)
+{
+    static_cast<ReaderDaemon *>(aParam)->handleData(aDataType, aDataLen, aDataPtr);
+}
+
+void ReaderDaemon::onEvent(void *aParam, MMMReaderEventCode aEventCode)
+{
+    static_cast<ReaderDaemon *>(aParam)->handleEvent(aEventCode);
+}
+
+void ReaderDaemon::onError(MMMReaderErrorCode aErrorCode, RTCHAR *aErrorMsg, void *aParam)
+{
+    static_cast<ReaderDaemon *>(aParam)->handleError(aErrorCode, aErrorMsg);
+}
+
+bool ReaderDaemon::onCertificate(void *aParam, char *aCertIdentifier, int aCertIdentifierLen, CERT_TYPE aCertType,
+                                 char *aCertBuffer, int *aCertBufferLen)
+{
+    // An unopened store has no certificates, so the SDK falls back as if none were found.
+    ReaderDaemon *lDaemon = static_cast<ReaderDaemon *>(aParam);
+    if (aCertType == CT_CERTIFICATE_REVOCATION_LIST)
+        return lDaemon->prRevocations
+            && lDaemon->prRevocations->provide(aCertIdentifier, aCertIdentifierLen, aCertBuffer, aCertBufferLen);
+    return lDaemon->prCertificates.provide(aCertIdentifier, aCertIdentifierLen, aCertType, aCertBuffer,
+                                           aCertBufferLen);
+}
+
+void ReaderDaemon::handleData(MMMReaderDataType aDataType, int aDataLen, const void *aDataPtr)
+{
+    if (aDataLen < 0 || (aDataLen > 0 && aDataPtr == nullptr))
+        return;
+
+    const size_t lLen = static_cast<size_t>(aDataLen);
+    const DataItem lItem(aDataType, prCurrentDocument.load(), aDataPtr, lLen,
+                         lLen >= prPoolThreshold ? prPoolForLarge : nullptr);
+    dispatchData(lItem);
+}
+
+void ReaderDaemon::dispatchData(const DataItem &aItem)
+{
+    ++prDataItems;
+    prDataBytes += aItem.size();
+
+    if (prServer.hasClients())
+        publishData(aItem);
+
+    for (DataConsumer *lConsumer : prConsumers)
+        lConsumer->onData(aItem);
+
+    if (aItem.size() > 0 && aItem.retained())
+        prPinnedBytes += aItem.size();
+}
+
+void ReaderDaemon::publishData(const DataItem &aItem)
+{
+    RecordHeader lHeader;
+    lHeader.puKind = RK_DATA;
+    lHeader.puCode = static_cast<uint32_t>(aItem.type());
+    lHeader.puDocument = aItem.document();
+
+    const MMMReaderCodelineData *lCodeline = aItem.as<MMMReaderCodelineData>();
+    if (prCompactCodelines && lCodeline != nullptr
+        && (aItem.type() == CD_CODELINE_DATA || aItem.type() == CD_SCDG1_CODELINE_DATA))
+    {
+        // A fresh slab either way, but a tenth the size of the struct.
+        std::vector<uint8_t> lEncoded;
+        encodeCodeline(*lCodeline, &lEncoded);
+        lHeader.puKind = RK_CODELINE;
+        lHeader.puLength = static_cast<uint32_t>(lEncoded.size());
+        prServer.publish(lHeader, DataRef::copyOf(lEncoded.data(), lEncoded.size()));
+        return;
+    }
+
+    lHeader.puLength = static_cast<uint32_t>(aItem.size());
+    prServer.publish(lHeader, aItem.retain());
+}
+
+void ReaderDaemon::handleEvent(MMMReaderEventCode aEventCode)
+{
+    ++prEvents;
+    if (aEventCode == START_OF_DOCUMENT_DATA)
+        ++prCurrentDocument;
+    const uint32_t lDocument = prCurrentDocument.load();
+
+    RecordHeader lHeader;
+    lHeader.puKind = RK_EVENT;
+    lHeader.puCode = static_cast<uint32_t>(aEventCode);
+    lHeader.puDocument = lDocument;
+    lHeader.puLength = 0;
+    prServer.publish(lHeader, DataRef());
+
+    for (DataConsumer *lConsumer : prConsumers)
+        lConsumer->onEvent(aEventCode, lDocument);
+
+    if (aEventCode == END_OF_DOCUMENT_DATA)
+    {
+        prPool.endOfDocument();
+        {
+            std::lock_guard<std::mutex> lLock(prDocumentMutex);
+            ++prDocuments;
+        }
+        prDocumentDone.notify_all();
+    }
+}
+
+void ReaderDaemon::handleError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg)
+{
+    ++prErrors;
+    const char *lMessage = aErrorMsg ? aErrorMsg : "";
+    const uint32_t lDocument = prCurrentDocument.load();
+    std::fprintf(stderr, "readerd: %s - %s\n", errorCodeName(aErrorCode).c_str(), lMessage);
+
+    RecordHeader lHeader;
+    lHeader.puKind = RK_ERROR;
+    lHeader.puCode = static_cast<uint32_t>(aErrorCode);
+    lHeader.puDocument = lDocument;
+    lHeader.puLength = static_cast<uint32_t>(std::strlen(lMessage));
+    prServer.publish(lHeader, DataRef::copyOf(lMessage, lHeader.puLength));
+
+    for (DataConsumer *lConsumer : prConsumers)
+        lConsumer->onError(aErrorCode, lMessage, lDocument);
+}
+
+void ReaderDaemon::blockingLoop()
+{
+    BulkFetcher lFetcher(*prBackend);
+    BulkResult lResult;
+    size_t lImagesPerDocument = 1;
+
+    while (prBlockingRunning)
+    {
+        // Backpressure: leave the next document on the window until the encoder has room for
+        // as many images as the last one had.
+        if (prEncoder && !prEncoder->waitForCapacity(lImagesPerDocument, std::chrono::milliseconds(200)))
+            continue;
+
+        MMMReaderErrorCode lError = prBackend->waitForDocumentOnWindow(200);
+        if (lError == ERROR_TIMED_OUT)
+            continue;
+        if (lError == NO_ERROR_OCCURRED)
+            lError = prBackend->readDocument();
+        if (lError != NO_ERROR_OCCURRED)
+        {
+            if (prBlockingRunning)
+                handleError(lError, "blocking read failed");
+            continue;
+        }
+
+        // Blocking mode has no event stream; frame the document the way the callbacks would.
+        handleEvent(START_OF_DOCUMENT_DATA);
+        lError = lFetcher.fetch(BulkFetcher::defaultDataTypes(), &lResult);
+        if (lError != NO_ERROR_OCCURRED)
+            handleError(lError, "bulk GetData failed");
+        else
+        {
+            const uint32_t lDocument = prCurrentDocument.load();
+            lImagesPerDocument = 0;
+            for (const BulkEntry &lEntry : lResult.entries())
+            {
+                lImagesPerDocument += isImageDataType(lEntry.puDataType) ? 1 : 0;
+                dispatchData(DataItem(lEntry.puDataType, lDocument, lResult.slice(lEntry)));
+            }
+        }
+        handleEvent(END_OF_DOCUMENT_DATA);
+        prBackend->clearData();
+    }
+}
+
+void ReaderDaemon::publishImage(ConvertedImage &&aImage)
+{
+    const ImageRecordHeader lImageHeader{static_cast<uint32_t>(aImage.puWidth),
+                                         static_cast<uint32_t>(aImage.puHeight),
+                                         static_cast<uint32_t>(aImage.puChannels), IP_PIXELS};
+
+    RecordHeader lHeader;
+    lHeader.puKind = RK_IMAGE;
+    lHeader.puCode = static_cast<uint32_t>(aImage.puDataType);
+    lHeader.puDocument = aImage.puDocument;
+    lHeader.puLength = static_cast<uint32_t>(sizeof(lImageHeader) + aImage.puPixels.size());
+    prServer.publish(lHeader, DataRef::copyOf(&lImageHeader, sizeof(lImageHeader)), aImage.puPixels);
+}
+
+void ReaderDaemon::publishImage(EncodedImage &&aImage)
+{
+    const ImageRecordHeader lImageHeader{static_cast<uint32_t>(aImage.puWidth),
+                                         static_cast<uint32_t>(aImage.puHeight),
+                                         static_cast<uint32_t>(aImage.puChannels),
+                                         aImage.puEncoding == ENCODE_PNG ? IP_PNG : IP_JPEG};
+
+    RecordHeader lHeader;
+    lHeader.puKind = RK_IMAGE;
+    lHeader.puCode = static_cast<uint32_t>(aImage.puDataType);
+    lHeader.puDocument = aImage.puDocument;
+    lHeader.puLength = static_cast<uint32_t>(sizeof(lImageHeader) + aImage.puBytes.size());
+    prServer.publish(lHeader, DataRef::copyOf(&lImageHeader, sizeof(lImageHeader)), aImage.puBytes);
+}
+
+} // namespace readerd
@@ -0,0 +1,382 @@
+#include "readerd/ReaderSupervisor.h"
+
+#include "readerd/ResultClient.h"
+#include "readerd/WorkerProcess.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace readerd {
+
+namespace {
+
+constexpr auto kPollInterval = std::chrono::milliseconds(10);
+constexpr auto kConnectRetry = std::chrono::milliseconds(10);
+constexpr auto kRespawnDelay = std::chrono::milliseconds(500);
+
+double millisecondsSince(std::chrono::steady_clock::time_point aStart)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+std::string describeStatus(int aStatus)
+{
+    if (WIFSIGNALED(aStatus))
+        return "was killed by signal " + std::to_string(WTERMSIG(aStatus));
+    return "exited with status " + std::to_string(WEXITSTATUS(aStatus));
+}
+
+} // namespace
+
+struct ReaderSupervisor::Worker
+{
+    uint32_t puIndex = 0;
+    pid_t puPid = -1;
+    int puHeartbeatFd = -1;
+    std::string puSocketPath;
+    std::thread puRelay;
+    std::atomic<bool> puActive{false};      ///< Its documents are relayed.
+    std::atomic<bool> puRetired{false};
+    bool puPromote = false;                 ///< Send SIGUSR1 once it is on standby.
+    bool puExited = false;
+    int puExitStatus = 0;
+    std::atomic<char> puBeat{0};            ///< The last heartbeat: 'S', 'A' or 'F'.
+    std::chrono::steady_clock::time_point puStarted;
+    std::chrono::steady_clock::time_point puLastBeat;
+};
+
+ReaderSupervisor::ReaderSupervisor(const SupervisorOptions &aOptions)
+    : prOptions(aOptions)
+    , prServer(aOptions.puSocketPath, aOptions.puClientQueueLimit, aOptions.puFraming)
+{
+}
+
+ReaderSupervisor::~ReaderSupervisor()
+{
+    stop();
+}
+
+MMMReaderErrorCode ReaderSupervisor::start(std::string *aError)
+{
+    MMMReaderErrorCode lResult = prServer.start(aError);
+    if (lResult != NO_ERROR_OCCURRED)
+        return lResult;
+
+    std::unique_ptr<Worker> lWorker = spawn(false, aError);
+    if (!lWorker)
+    {
+        prServer.stop();
+        return ERROR_OS_ERROR;
+    }
+    lWorker->puActive = true;
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        prActive = std::move(lWorker);
+    }
+    prMonitor = std::thread(&ReaderSupervisor::monitorLoop, this);
+    return NO_ERROR_OCCURRED;
+}
+
+void ReaderSupervisor::stop()
+{
+    if (prStopping.exchange(true))
+        return;
+    if (prMonitor.joinable())
+        prMonitor.join();
+    retire(prStandby, SIGTERM);
+    retire(prActive, SIGTERM);
+    prServer.stop();
+}
+
+bool ReaderSupervisor::waitForDocuments(uint64_t aCount, std::chrono::milliseconds aTimeout)
+{
+    std::unique_lock<std::mutex> lLock(prMutex);
+    return prProgress.wait_for(lLock, aTimeout, [&] { return prDocuments.load() >= aCount; });
+}
+
+SupervisorStats ReaderSupervisor::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    SupervisorStats lStats = prStats;
+    lStats.puDocuments = prDocuments.load();
+    lStats.puActivePid = prActive ? prActive->puPid : 0;
+    lStats.puStandbyPid = prStandby ? prStandby->puPid : 0;
+    lStats.puStandbyReady = prStandby && prStandby->puBeat == 'S';
+    return lStats;
+}
+
+std::unique_ptr<ReaderSupervisor::Worker> ReaderSupervisor::spawn(bool aStandby, std::string *aError)
+{
+    auto lWorker = std::make_unique<Worker>();
+    lWorker->puIndex = prNextWorker++;
+    lWorker->puSocketPath = workerSocketPath("worker", lWorker->puIndex);
+
+    int lPipe[2];
+    if (pipe2(lPipe, O_CLOEXEC | O_NONBLOCK) != 0)
+    {
+        *aError = std::string("pipe: ") + std::strerror(errno);
+        return nullptr;
+    }
+    std::vector<std::string> lArguments = {prOptions.puWorkerPath, "--backend", prOptions.puBackendSpec,
+                                           "--socket", lWorker->puSocketPath, "--framing", "documents",
+                                           "--heartbeat-fd", std::to_string(lPipe[1])};
+    if (!prOptions.puScanner.empty())
+        lArguments.insert(lArguments.end(), {"--scanner", prOptions.puScanner});
+    if (aStandby)
+        lArguments.push_back("--standby");
+    lArguments.insert(lArguments.end(), prOptions.puWorkerArguments.begin(), prOptions.puWorkerArguments.end());
+
+    std::filesystem::remove(lWorker->puSocketPath);
+    lWorker->puPid = spawnWorker(lArguments, {}, lPipe[1], aError);
+    ::close(lPipe[1]);
+    if (lWorker->puPid < 0)
+    {
+        ::close(lPipe[0]);
+        return nullptr;
+    }
+    lWorker->puHeartbeatFd = lPipe[0];
+    lWorker->puStarted = std::chrono::steady_clock::now();
+    lWorker->puRelay = std::thread(&ReaderSupervisor::relayLoop, this, std::ref(*lWorker));
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        ++prStats.puWorkersStarted;
+    }
+    return lWorker;
+}
+
+void ReaderSupervisor::retire(std::unique_ptr<Worker> &aWorker, int aSignal)
+{
+    if (!aWorker)
+        return;
+    aWorker->puActive = false;
+    aWorker->puRetired = true;
+    if (!aWorker->puExited)
+    {
+        kill(aWorker->puPid, aSignal);
+        while (waitpid(aWorker->puPid, &aWorker->puExitStatus, 0) < 0 && errno == EINTR)
+        {
+        }
+    }
+    if (aWorker->puRelay.joinable())
+        aWorker->puRelay.join();
+    if (aWorker->puHeartbeatFd >= 0)
+        ::close(aWorker->puHeartbeatFd);
+    std::filesystem::remove(aWorker->puSocketPath);
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    aWorker.reset();
+}
+
+bool ReaderSupervisor::hasExited(Worker &aWorker)
+{
+    if (!aWorker.puExited && waitpid(aWorker.puPid, &aWorker.puExitStatus, WNOHANG) == aWorker.puPid)
+        aWorker.puExited = true;
+    return aWorker.puExited;
+}
+
+void ReaderSupervisor::readHeartbeats(std::chrono::milliseconds aTimeout)
+{
+    Worker *lWorkers[2] = {prActive.get(), prStandby.get()};
+    pollfd lFds[2];
+    nfds_t lCount = 0;
+    for (Worker *lWorker : lWorkers)
+    {
+        if (lWorker != nullptr && lWorker->puHeartbeatFd >= 0)
+            lFds[lCount++] = pollfd{lWorker->puHeartbeatFd, POLLIN, 0};
+    }
+    if (lCount == 0)
+    {
+        std::this_thread::sleep_for(aTimeout);
+        return;
+    }
+    if (poll(lFds, lCount, static_cast<int>(aTimeout.count())) <= 0)
+        return;
+
+    for (Worker *lWorker : lWorkers)
+    {
+        if (lWorker == nullptr || lWorker->puHeartbeatFd < 0)
+            continue;
+        char lBeats[64];
+        const ssize_t lRead = ::read(lWorker->puHeartbeatFd, lBeats, sizeof(lBeats));
+        if (lRead > 0)
+        {
+            lWorker->puBeat = lBeats[lRead - 1];
+            lWorker->puLastBeat = std::chrono::steady_clock::now();
+        }
+        else if (lRead == 0)
+        {
+            // The worker is going; waitpid() will say how.
+            ::close(lWorker->puHeartbeatFd);
+            lWorker->puHeartbeatFd = -1;
+        }
+    }
+}
+
+void ReaderSupervisor::failover(const std::string &aReason)
+{
+    std::fprintf(stderr, "readerd: worker %u (pid %d) %s, failing over\n", prActive->puIndex,
+                 static_cast<int>(prActive->puPid), aReason.c_str());
+    prFailoverTime = std::chrono::steady_clock::now();
+    prRecovering = true;
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        ++prStats.puFailovers;
+    }
+
+    // The old worker must let go of the reader before the new one connects to it.
+    retire(prActive, SIGKILL);
+
+    std::unique_ptr<Worker> lNext = std::move(prStandby);
+    if (lNext && lNext->puBeat == 'S')
+        kill(lNext->puPid, SIGUSR1);
+    else if (lNext)
+        lNext->puPromote = true;    // Still initialising: promoted once it is on standby.
+    else
+    {
+        std::string lError;
+        lNext = spawn(false, &lError);
+        if (!lNext)
+        {
+            std::fprintf(stderr, "readerd: cannot start a worker: %s\n", lError.c_str());
+            prRetryTime = std::chrono::steady_clock::now() + kRespawnDelay;
+            return;
+        }
+        std::lock_guard<std::mutex> lLock(prMutex);
+        ++prStats.puColdStarts;
+    }
+    lNext->puActive = true;
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prActive = std::move(lNext);
+}
+
+void ReaderSupervisor::monitorLoop()
+{
+    while (!prStopping)
+    {
+        readHeartbeats(kPollInterval);
+        const auto lNow = std::chrono::steady_clock::now();
+
+        if (!prActive)
+        {
+            // A cold start failed to spawn; keep trying.
+            if (lNow >= prRetryTime)
+            {
+                std::string lError;
+                std::unique_ptr<Worker> lWorker = spawn(false, &lError);
+                if (!lWorker)
+                {
+                    prRetryTime = lNow + kRespawnDelay;
+                    continue;
+                }
+                lWorker->puActive = true;
+                std::lock_guard<std::mutex> lLock(prMutex);
+                ++prStats.puColdStarts;
+                prActive = std::move(lWorker);
+            }
+            continue;
+        }
+
+        // A dead or hung standby is replaced.
+        if (prStandby)
+        {
+            const bool lSilent = prStandby->puBeat == 0
+                                     ? lNow - prStandby->puStarted > prOptions.puStartTimeout
+                                     : lNow - prStandby->puLastBeat > prOptions.puHangTimeout;
+            if (hasExited(*prStandby) || lSilent)
+            {
+                std::fprintf(stderr, "readerd: standby worker %u (pid %d) %s\n", prStandby->puIndex,
+                             static_cast<int>(prStandby->puPid),
+                             prStandby->puExited ? describeStatus(prStandby->puExitStatus).c_str() : "stopped answering");
+                retire(prStandby, SIGKILL);
+                prRetryTime = lNow + kRespawnDelay;
+            }
+        }
+
+        std::string lReason;
+        if (hasExited(*prActive))
+            lReason = describeStatus(prActive->puExitStatus);
+        else if (prActive->puBeat == 'F')
+            lReason = "reported a fatal error";
+        else if (prActive->puBeat == 0 && lNow - prActive->puStarted > prOptions.puStartTimeout)
+            lReason = "did not start";
+        else if (prActive->puBeat != 0 && lNow - prActive->puLastBeat > prOptions.puHangTimeout)
+            lReason = "stopped answering";
+        else if (prFailoverRequested.exchange(false))
+            lReason = "is being reset";
+        if (!lReason.empty())
+        {
+            failover(lReason);
+            continue;
+        }
+
+        if (prActive->puPromote && prActive->puBeat == 'S')
+        {
+            kill(prActive->puPid, SIGUSR1);
+            prActive->puPromote = false;
+        }
+        if (prRecovering && prActive->puBeat == 'A')
+        {
+            prRecovering = false;
+            const double lRecoveryMs = millisecondsSince(prFailoverTime);
+            std::fprintf(stderr, "readerd: worker %u (pid %d) took over in %.1f ms\n", prActive->puIndex,
+                         static_cast<int>(prActive->puPid), lRecoveryMs);
+            std::lock_guard<std::mutex> lLock(prMutex);
+            prStats.puLastRecoveryMs = lRecoveryMs;
+            prStats.puMaxRecoveryMs = std::max(prStats.puMaxRecoveryMs, lRecoveryMs);
+        }
+
+        // The standby is started once the active worker is reading, not to compete with it
+        // while it initialises.
+        if (prOptions.puStandby && !prStandby && !prRecovering && prActive->puBeat == 'A' && lNow >= prRetryTime)
+        {
+            std::string lError;
+            std::unique_ptr<Worker> lWorker = spawn(true, &lError);
+            if (!lWorker)
+            {
+                std::fprintf(stderr, "readerd: cannot start a standby worker: %s\n", lError.c_str());
+                prRetryTime = lNow + kRespawnDelay;
+                continue;
+            }
+            std::lock_guard<std::mutex> lLock(prMutex);
+            prStandby = std::move(lWorker);
+        }
+    }
+}
+
+void ReaderSupervisor::relayLoop(Worker &aWorker)
+{
+    ResultClient lClient;
+    std::string lError;
+    while (lClient.connect(aWorker.puSocketPath, &lError) != NO_ERROR_OCCURRED)
+    {
+        if (aWorker.puRetired)
+            return;
+        std::this_thread::sleep_for(kConnectRetry);
+    }
+
+    DocumentRelay lRelay(prServer, prNextDocument);
+    Frame lFrame;
+    while (lClient.readFrame(&lFrame, &lError))
+    {
+        // A standby only reports its own state changes, which clients have no use for.
+        if (!aWorker.puActive)
+            continue;
+        const uint32_t lEnded = lRelay.relay(lFrame);
+        if (lEnded > 0)
+        {
+            prDocuments += lEnded;
+            std::lock_guard<std::mutex> lLock(prMutex);
+            prProgress.notify_all();
+        }
+    }
+}
+
+} // namespace readerd
@@ -0,0 +1,311 @@
+#include "readerd/ReplayEngine.h"
+#include "readerd/CorpusPack.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace readerd {
+
+struct ReplayEngine::Worker
+{
+    ReplayEngine *puEngine = nullptr;
+    int puIndex = 0;
+    std::unique_ptr<ReaderBackend> puBackend;
+
+    std::mutex puMutex;
+    std::condition_variable puDone;
+    ReplayRecord *puRecord = nullptr;
+    uint32_t puStarted = 0;     ///< Sequence of the record START_OF_DOCUMENT_DATA was raised for.
+    uint32_t puStale = 0;       ///< Timed-out documents whose END_OF_DOCUMENT_DATA is still to come.
+    bool puFinished = false;
+    MMMReaderErrorCode puError = NO_ERROR_OCCURRED;
+};
+
+ReplayEngine::ReplayEngine(const ReplayOptions &aOptions)
+    : prOptions(aOptions)
+{
+}
+
+void ReplayEngine::addConsumer(DataConsumer *aConsumer)
+{
+    prConsumers.push_back(aConsumer);
+}
+
+bool ReplayEngine::listCorpus(const std::string &aRoot, std::vector<std::string> *aCorpus, std::string *aError)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code lError;
+    fs::directory_iterator lDir(aRoot, lError);
+    if (lError)
+    {
+        *aError = "cannot open corpus '" + aRoot + "': " + lError.message();
+        return false;
+    }
+
+    aCorpus->clear();
+    bool lHasFiles = false;
+    for (const fs::directory_entry &lEntry : lDir)
+    {
+        if (lEntry.is_directory())
+            aCorpus->push_back(lEntry.path().string());
+        else if (lEntry.is_regular_file())
+            lHasFiles = true;
+    }
+    if (aCorpus->empty() && lHasFiles)
+        aCorpus->push_back(aRoot);
+    std::sort(aCorpus->begin(), aCorpus->end());
+
+    if (aCorpus->empty())
+    {
+        *aError = "corpus '" + aRoot + "' contains no scan directories";
+        return false;
+    }
+    return true;
+}
+
+double ReplayEngine::microsecondsSinceStart() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - prStartTime).count();
+}
+
+MMMReaderErrorCode ReplayEngine::run(const std::vector<std::string> &aCorpus, std::string *aError)
+{
+    prDirectories = &aCorpus;
+    prPack = nullptr;
+    return runCorpus(aCorpus.size(), aError);
+}
+
+MMMReaderErrorCode ReplayEngine::run(const CorpusPack &aPack, std::string *aError)
+{
+    prDirectories = nullptr;
+    prPack = &aPack;
+    return runCorpus(aPack.size(), aError);
+}
+
+MMMReaderErrorCode ReplayEngine::runCorpus(size_t aEntries, std::string *aError)
+{
+    if (aEntries == 0 || prOptions.puConcurrency < 1 || prOptions.puRepeat < 1)
+    {
+        *aError = "nothing to replay";
+        return ERROR_PARAMETER_INVALID;
+    }
+
+    std::vector<std::unique_ptr<Worker>> lWorkers;
+    for (int i = 0; i < prOptions.puConcurrency; ++i)
+    {
+        auto lWorker = std::make_unique<Worker>();
+        lWorker->puEngine = this;
+        lWorker->puIndex = i;
+        lWorker->puBackend = createBackend(prOptions.puBackendSpec, aError);
+        if (!lWorker->puBackend)
+        {
+            shutdownWorkers(lWorkers);
+            return ERROR_PARAMETER_INVALID;
+        }
+        if (i == 1 && std::string(lWorker->puBackend->name()) == "sdk")
+        {
+            *aError = "the sdk backend holds one reader per process; replay it with a concurrency of 1";
+            shutdownWorkers(lWorkers);
+            return ERROR_PARAMETER_INVALID;
+        }
+
+        const MMMReaderErrorCode lResult = lWorker->puBackend->initialise(
+            &ReplayEngine::onData, &ReplayEngine::onEvent, &ReplayEngine::onError, nullptr, lWorker.get());
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            *aError = "MMMReader_Initialise failed: " + errorCodeName(lResult);
+            shutdownWorkers(lWorkers);
+            return lResult;
+        }
+        lWorkers.push_back(std::move(lWorker));
+    }
+
+    prRecords.assign(aEntries * static_cast<size_t>(prOptions.puRepeat), ReplayRecord());
+    prNext = 0;
+    prStartTime = std::chrono::steady_clock::now();
+
+    std::vector<std::thread> lThreads;
+    for (std::unique_ptr<Worker> &lWorker : lWorkers)
+        lThreads.emplace_back(&ReplayEngine::workerLoop, this, std::ref(*lWorker));
+    for (std::thread &lThread : lThreads)
+        lThread.join();
+
+    prElapsedSeconds = microsecondsSinceStart() / 1e6;
+    shutdownWorkers(lWorkers);
+    return NO_ERROR_OCCURRED;
+}
+
+void ReplayEngine::shutdownWorkers(std::vector<std::unique_ptr<Worker>> &aWorkers)
+{
+    for (std::unique_ptr<Worker> &lWorker : aWorkers)
+        lWorker->puBackend->shutdown();
+}
+
+void ReplayEngine::workerLoop(Worker &aWorker)
+{
+    const size_t lEntries = prPack ? prPack->size() : prDirectories->size();
+    std::vector<ScanFile> lFiles;
+    for (;;)
+    {
+        const size_t lSequence = prNext++;
+        if (lSequence >= prRecords.size())
+            return;
+
+        // Pacing is against the run start rather than the previous document, so a slow
+        // document does not push every later one back.
+        if (prOptions.puRate > 0.0)
+        {
+            const auto lDue = prStartTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(static_cast<double>(lSequence) / prOptions.puRate));
+            std::this_thread::sleep_until(lDue);
+        }
+
+        ReplayRecord &lRecord = prRecords[lSequence];
+        lRecord.puSequence = static_cast<uint32_t>(lSequence + 1);
+        lRecord.puWorker = aWorker.puIndex;
+        const size_t lEntry = lSequence % lEntries;
+        if (prPack)
+        {
+            lRecord.puDirectory = prPack->name(lEntry);
+            prPack->files(lEntry, &lFiles);
+            // About the entry this worker takes next, with every worker as quick as this one.
+            prPack->prefetch((lSequence + static_cast<size_t>(prOptions.puConcurrency)) % lEntries);
+        }
+        else
+            lRecord.puDirectory = (*prDirectories)[lEntry];
+        {
+            std::lock_guard<std::mutex> lLock(aWorker.puMutex);
+            aWorker.puRecord = &lRecord;
+            aWorker.puStarted = 0;
+            aWorker.puFinished = false;
+            aWorker.puError = NO_ERROR_OCCURRED;
+        }
+
+        lRecord.puStartUs = microsecondsSinceStart();
+        lRecord.puResult = prPack ? aWorker.puBackend->loadAndProcessScan(lFiles, prOptions.puSendData)
+                                  : aWorker.puBackend->loadAndProcessFromScanDirectory(
+                                        lRecord.puDirectory.c_str(), prOptions.puSendData);
+
+        std::unique_lock<std::mutex> lLock(aWorker.puMutex);
+        if (lRecord.puResult == NO_ERROR_OCCURRED
+            && !aWorker.puDone.wait_for(lLock, std::chrono::milliseconds(prOptions.puDocumentTimeoutMs),
+                                        [&aWorker] { return aWorker.puFinished; }))
+        {
+            lRecord.puResult = ERROR_TIMED_OUT;
+            ++aWorker.puStale;
+        }
+        if (lRecord.puResult == NO_ERROR_OCCURRED)
+            lRecord.puResult = aWorker.puError;
+        if (lRecord.puEndUs == 0.0)
+            lRecord.puEndUs = microsecondsSinceStart();
+        aWorker.puRecord = nullptr;
+        lLock.unlock();
+
+        aWorker.puBackend->clearData();
+    }
+}
+
+void ReplayEngine::onData(void *aParam, MMMReaderDataType aDataType, int aDataLen, void *aDataPtr)
+{
+    Worker &lWorker = *static_cast<Worker *>(aParam);
+    if (aDataLen < 0 || (aDataLen > 0 && aDataPtr == nullptr))
+        return;
+
+    uint32_t lDocument = 0;
+    {
+        std::lock_guard<std::mutex> lLock(lWorker.puMutex);
+        ReplayRecord *lRecord = lWorker.puRecord;
+        // Data before this record's START belongs to a document that timed out.
+        if (lRecord == nullptr || lWorker.puStarted != lRecord->puSequence)
+            return;
+        if (lRecord->puItems++ == 0)
+            lRecord->puFirstDataUs = lWorker.puEngine->microsecondsSinceStart();
+        lRecord->puBytes += static_cast<uint64_t>(aDataLen);
+        lDocument = lRecord->puSequence;
+    }
+
+    const DataItem lItem(aDataType, lDocument, aDataPtr, static_cast<size_t>(aDataLen));
+    for (DataConsumer *lConsumer : lWorker.puEngine->prConsumers)
+        lConsumer->onData(lItem);
+}
+
+void ReplayEngine::onEvent(void *aParam, MMMReaderEventCode aEventCode)
+{
+    Worker &lWorker = *static_cast<Worker *>(aParam);
+
+    uint32_t lDocument = 0;
+    {
+        std::lock_guard<std::mutex> lLock(lWorker.puMutex);
+        if (lWorker.puRecord == nullptr)
+            return;
+        lDocument = lWorker.puRecord->puSequence;
+        // The callbacks do not name the document. The backend finishes documents in order, so
+        // while one that timed out has not ended, its START and END are the ones arriving.
+        if (aEventCode == START_OF_DOCUMENT_DATA)
+        {
+            if (lWorker.puStale > 0 || lWorker.puStarted == lDocument)
+                return;
+            lWorker.puStarted = lDocument;
+        }
+        if (aEventCode == END_OF_DOCUMENT_DATA)
+        {
+            if (lWorker.puStarted != lDocument)
+            {
+                if (lWorker.puStale > 0)
+                    --lWorker.puStale;
+                return;
+            }
+            lWorker.puRecord->puEndUs = lWorker.puEngine->microsecondsSinceStart();
+            lWorker.puFinished = true;
+        }
+    }
+
+    for (DataConsumer *lConsumer : lWorker.puEngine->prConsumers)
+        lConsumer->onEvent(aEventCode, lDocument);
+    if (aEventCode == END_OF_DOCUMENT_DATA)
+        lWorker.puDone.notify_all();
+}
+
+void ReplayEngine::onError(MMMReaderErrorCode aErrorCode, RTCHAR *aErrorMsg, void *aParam)
+{
+    Worker &lWorker = *static_cast<Worker *>(aParam);
+
+    uint32_t lDocument = 0;
+    {
+        std::lock_guard<std::mutex> lLock(lWorker.puMutex);
+        if (lWorker.puRecord != nullptr)
+        {
+            lDocument = lWorker.puRecord->puSequence;
+            lWorker.puError = aErrorCode;
+        }
+    }
+
+    for (DataConsumer *lConsumer : lWorker.puEngine->prConsumers)
+        lConsumer->onError(aErrorCode, aErrorMsg ? aErrorMsg : "", lDocument);
+}
+
+void ReplayEngine::writeCsv(std::FILE *aFile, const std::vector<ReplayRecord> &aRecords)
+{
+    std::fprintf(aFile, "sequence,worker,directory,result,start_us,first_data_us,end_us,latency_us,items,bytes\n");
+    for (const ReplayRecord &lRecord : aRecords)
+    {
+        std::fprintf(aFile, "%u,%d,\"%s\",%s,%.1f,%.1f,%.1f,%.1f,%u,%llu\n",
+            lRecord.puSequence,
+            lRecord.puWorker,
+            lRecord.puDirectory.c_str(),
+            errorCodeName(lRecord.puResult).c_str(),
+            lRecord.puStartUs,
+            lRecord.puFirstDataUs,
+            lRecord.puEndUs,
+            lRecord.latencyUs(),
+            lRecord.puItems,
+            static_cast<unsigned long long>(lRecord.puBytes));
+    }
+}
+
+} // namespace readerd
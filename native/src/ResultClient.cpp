@@ -0,0 +1,132 @@
+#include "readerd/ResultClient.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace readerd {
+
+ResultClient::~ResultClient()
+{
+    close();
+}
+
+MMMReaderErrorCode ResultClient::connect(const std::string &aAddress, std::string *aError)
+{
+    close();
+    SocketAddress lAddress;
+    if (!SocketAddress::parse(aAddress, &lAddress, aError))
+        return ERROR_PARAMETER_INVALID;
+
+    prFd = ::socket(lAddress.family(), SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (prFd < 0)
+    {
+        *aError = std::string("socket: ") + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    if (::connect(prFd, lAddress.get(), lAddress.puLength) != 0)
+    {
+        *aError = "connect " + aAddress + ": " + std::strerror(errno);
+        close();
+        return ERROR_OS_ERROR;
+    }
+    if (lAddress.puTcp)
+    {
+        const int lOn = 1;
+        ::setsockopt(prFd, IPPROTO_TCP, TCP_NODELAY, &lOn, sizeof(lOn));
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+void ResultClient::close()
+{
+    if (prFd >= 0)
+        ::close(prFd);
+    prFd = -1;
+}
+
+bool ResultClient::readFrame(Frame *aFrame, std::string *aError)
+{
+    aError->clear();
+    aFrame->puRecords.clear();
+    if (!readFully(&aFrame->puHeader, sizeof(aFrame->puHeader), aError))
+        return false;
+
+    const FrameHeader &lHeader = aFrame->puHeader;
+    if (lHeader.puMagic != kFrameMagic || lHeader.puVersion != kFrameVersion)
+    {
+        *aError = "not a readerd document frame (is the server running with --framing documents?)";
+        return false;
+    }
+    if (lHeader.puLength > kMaxFrameBytes)
+    {
+        *aError = "frame of " + std::to_string(lHeader.puLength) + " bytes refused";
+        return false;
+    }
+
+    aFrame->puBytes.resize(static_cast<size_t>(lHeader.puLength));
+    if (!readFully(aFrame->puBytes.data(), aFrame->puBytes.size(), aError))
+    {
+        if (aError->empty())
+            *aError = "stream ended inside a frame";
+        return false;
+    }
+    if (!parseRecords(aFrame->puBytes, lHeader.puRecords, &aFrame->puRecords))
+    {
+        *aError = "frame records do not match its length";
+        return false;
+    }
+    return true;
+}
+
+bool ResultClient::parseRecords(std::span<const uint8_t> aBytes, uint32_t aRecords, std::vector<FrameRecord> *aOut)
+{
+    aOut->clear();
+    // The count comes off the wire; every record takes a header, so a frame cannot hold more.
+    if (aRecords > aBytes.size() / sizeof(RecordHeader))
+        return false;
+    aOut->reserve(aRecords);
+    size_t lOffset = 0;
+    for (uint32_t i = 0; i < aRecords; ++i)
+    {
+        FrameRecord lRecord;
+        if (aBytes.size() - lOffset < sizeof(lRecord.puHeader))
+            return false;
+        std::memcpy(&lRecord.puHeader, aBytes.data() + lOffset, sizeof(lRecord.puHeader));
+        lOffset += sizeof(lRecord.puHeader);
+        if (aBytes.size() - lOffset < lRecord.puHeader.puLength)
+            return false;
+        lRecord.puPayload = aBytes.subspan(lOffset, lRecord.puHeader.puLength);
+        lOffset += lRecord.puHeader.puLength;
+        aOut->push_back(lRecord);
+    }
+    return lOffset == aBytes.size();
+}
+
+bool ResultClient::readFully(void *aBuffer, size_t aLen, std::string *aError)
+{
+    uint8_t *lCursor = static_cast<uint8_t *>(aBuffer);
+    size_t lLeft = aLen;
+    while (lLeft > 0)
+    {
+        const ssize_t lRead = ::recv(prFd, lCursor, lLeft, MSG_WAITALL);
+        if (lRead == 0)
+            return false;
+        if (lRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            *aError = std::string("recv: ") + std::strerror(errno);
+            return false;
+        }
+        lCursor += lRead;
+        lLeft -= static_cast<size_t>(lRead);
+    }
+    return true;
+}
+
+} // namespace readerd
@@ -0,0 +1,380 @@
+#include "readerd/ResultServer.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace readerd {
+
+ResultServer::ResultServer(const std::string &aAddress, size_t aClientQueueLimit, ServerFraming aFraming)
+    : prAddressSpec(aAddress)
+    , prClientQueueLimit(aClientQueueLimit)
+    , prFraming(aFraming)
+{
+}
+
+ResultServer::~ResultServer()
+{
+    stop();
+}
+
+MMMReaderErrorCode ResultServer::start(std::string *aError)
+{
+    if (!SocketAddress::parse(prAddressSpec, &prAddress, aError))
+        return ERROR_PARAMETER_INVALID;
+
+    prListenFd = ::socket(prAddress.family(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (prListenFd < 0)
+    {
+        *aError = std::string("socket: ") + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+
+    if (prAddress.puTcp)
+    {
+        // Let a restarted daemon take the port back while old connections are in TIME_WAIT.
+        const int lOn = 1;
+        ::setsockopt(prListenFd, SOL_SOCKET, SO_REUSEADDR, &lOn, sizeof(lOn));
+    }
+    else
+    {
+        // A stale socket file from a previous (crashed) daemon would make bind() fail.
+        ::unlink(prAddress.puPath.c_str());
+    }
+    if (::bind(prListenFd, prAddress.get(), prAddress.puLength) != 0 || ::listen(prListenFd, 16) != 0)
+    {
+        *aError = "bind " + prAddressSpec + ": " + std::strerror(errno);
+        ::close(prListenFd);
+        prListenFd = -1;
+        return ERROR_OS_ERROR;
+    }
+
+    prWakeFd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (prWakeFd < 0)
+    {
+        *aError = std::string("eventfd: ") + std::strerror(errno);
+        ::close(prListenFd);
+        prListenFd = -1;
+        return ERROR_OS_ERROR;
+    }
+
+    prRunning = true;
+    prThread = std::thread(&ResultServer::ioLoop, this);
+    return NO_ERROR_OCCURRED;
+}
+
+void ResultServer::stop()
+{
+    if (!prRunning.exchange(false))
+        return;
+    wake();
+    prThread.join();
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    for (auto &lClient : prClients)
+        ::close(lClient->puFd);
+    prClients.clear();
+    prClientCount = 0;
+    ::close(prListenFd);
+    ::close(prWakeFd);
+    prListenFd = prWakeFd = -1;
+    if (!prAddress.puTcp)
+        ::unlink(prAddress.puPath.c_str());
+
+    std::lock_guard<std::mutex> lBatchLock(prBatchMutex);
+    prBatches.clear();
+}
+
+void ResultServer::wake()
+{
+    const uint64_t lOne = 1;
+    ssize_t lIgnored = ::write(prWakeFd, &lOne, sizeof(lOne));
+    (void)lIgnored;
+}
+
+void ResultServer::publish(const RecordHeader &aHeader, const DataRef &aPayload)
+{
+    publish(aHeader, DataRef(), aPayload);
+}
+
+void ResultServer::publish(const RecordHeader &aHeader, const DataRef &aPayloadHead, const DataRef &aPayloadBody)
+{
+    // Documents are followed without clients too, so that one a client joins in the middle of
+    // is skipped rather than sent to it record by record.
+    if (!hasClients() && prFraming != SF_DOCUMENTS)
+        return;
+
+    const DataRef lChunks[3] = {DataRef::copyOf(&aHeader, sizeof(aHeader)), aPayloadHead, aPayloadBody};
+    const size_t lBytes = lChunks[0].size() + aPayloadHead.size() + aPayloadBody.size();
+    if (prFraming == SF_DOCUMENTS)
+        batchRecord(aHeader, lChunks, lBytes);
+    else
+        enqueue(lChunks, 3, lBytes);
+}
+
+void ResultServer::batchRecord(const RecordHeader &aHeader, const DataRef (&aChunks)[3], size_t aBytes)
+{
+    const bool lStart = aHeader.puKind == RK_EVENT && aHeader.puCode == START_OF_DOCUMENT_DATA;
+    const bool lEnd = aHeader.puKind == RK_EVENT && aHeader.puCode == END_OF_DOCUMENT_DATA;
+
+    if (aBytes > kMaxFrameBytes)
+    {
+        std::fprintf(stderr, "readerd: record of %zu bytes does not fit a frame; not sent\n", aBytes);
+        return;
+    }
+
+    // Held while queueing too, so that frames reach every client in the order they closed.
+    std::lock_guard<std::mutex> lLock(prBatchMutex);
+    if (lStart)
+    {
+        // A document that never ended (the reader was reset mid-read) goes out as it is.
+        for (auto lIt = prBatches.begin(); lIt != prBatches.end();)
+        {
+            if (!lIt->second.puSkipped)
+                sendBatch(lIt->first, lIt->second, 0);
+            lIt = prBatches.erase(lIt);
+        }
+        prBatches[aHeader.puDocument].puSkipped = !hasClients();
+    }
+
+    auto lIt = prBatches.find(aHeader.puDocument);
+    if (lIt != prBatches.end() && lIt->second.puSkipped)
+    {
+        if (lEnd)
+            prBatches.erase(lIt);
+        return;
+    }
+    if (lIt == prBatches.end())
+    {
+        if (!hasClients())
+            return;
+        const DataRef lFramed[4] = {frameHeader(aHeader.puDocument, 0, 1, aBytes), aChunks[0], aChunks[1],
+                                    aChunks[2]};
+        enqueue(lFramed, 4, sizeof(FrameHeader) + aBytes);
+        return;
+    }
+
+    Batch &lBatch = lIt->second;
+    if (lBatch.puBytes + aBytes > kMaxFrameBytes)
+    {
+        // A client would refuse the whole as one frame: what is held goes out now.
+        sendBatch(aHeader.puDocument, lBatch, 0);
+        lBatch = Batch();
+        lBatch.puSplit = true;
+    }
+    for (const DataRef &lChunk : aChunks)
+    {
+        if (!lChunk.empty())
+            lBatch.puChunks.push_back(lChunk);
+    }
+    ++lBatch.puRecords;
+    lBatch.puBytes += aBytes;
+
+    if (lEnd)
+    {
+        sendBatch(aHeader.puDocument, lBatch, lBatch.puSplit ? 0 : FF_DOCUMENT);
+        prBatches.erase(lIt);
+    }
+}
+
+void ResultServer::sendBatch(uint32_t aDocument, Batch &aBatch, uint16_t aFlags)
+{
+    if (aBatch.puRecords == 0)
+        return;
+    aBatch.puChunks.insert(aBatch.puChunks.begin(), frameHeader(aDocument, aFlags, aBatch.puRecords, aBatch.puBytes));
+    enqueue(aBatch.puChunks.data(), aBatch.puChunks.size(), sizeof(FrameHeader) + aBatch.puBytes);
+}
+
+DataRef ResultServer::frameHeader(uint32_t aDocument, uint16_t aFlags, uint32_t aRecords, size_t aBytes)
+{
+    const FrameHeader lHeader{kFrameMagic, kFrameVersion, aFlags, aDocument, aRecords, static_cast<uint64_t>(aBytes)};
+    return DataRef::copyOf(&lHeader, sizeof(lHeader));
+}
+
+void ResultServer::enqueue(const DataRef *aChunks, size_t aCount, size_t aBytes)
+{
+    bool lNeedWake = false;
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        for (auto &lClient : prClients)
+        {
+            lNeedWake = lNeedWake || lClient->puQueue.empty();
+            for (size_t i = 0; i < aCount; ++i)
+            {
+                if (!aChunks[i].empty())
+                    lClient->puQueue.push_back(aChunks[i]);
+            }
+            lClient->puQueuedBytes += aBytes;
+        }
+    }
+    if (lNeedWake)
+        wake();
+}
+
+size_t ResultServer::clientCount() const
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    return prClients.size();
+}
+
+void ResultServer::acceptClients()
+{
+    for (;;)
+    {
+        const int lFd = ::accept4(prListenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (lFd < 0)
+            return;
+        if (prAddress.puTcp)
+        {
+            // Frames are written whole; do not hold the tail of one back waiting for an ACK.
+            const int lOn = 1;
+            ::setsockopt(lFd, IPPROTO_TCP, TCP_NODELAY, &lOn, sizeof(lOn));
+        }
+        auto lClient = std::make_unique<Client>();
+        lClient->puFd = lFd;
+        std::lock_guard<std::mutex> lLock(prMutex);
+        prClients.push_back(std::move(lClient));
+        prClientCount = prClients.size();
+    }
+}
+
+bool ResultServer::flushClient(Client &aClient)
+{
+    static const size_t kMaxIov = 64;
+    iovec lIov[kMaxIov];
+
+    while (!aClient.puQueue.empty())
+    {
+        size_t lCount = 0;
+        for (auto lIt = aClient.puQueue.begin(); lIt != aClient.puQueue.end() && lCount < kMaxIov; ++lIt)
+        {
+            const size_t lSkip = lCount == 0 ? aClient.puOffset : 0;
+            lIov[lCount].iov_base = const_cast<uint8_t *>(lIt->data() + lSkip);
+            lIov[lCount].iov_len = lIt->size() - lSkip;
+            ++lCount;
+        }
+
+        msghdr lMessage;
+        std::memset(&lMessage, 0, sizeof(lMessage));
+        lMessage.msg_iov = lIov;
+        lMessage.msg_iovlen = lCount;
+        ssize_t lWritten = ::sendmsg(aClient.puFd, &lMessage, MSG_NOSIGNAL);
+        if (lWritten < 0)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+        // Retire every chunk that was written completely; remember how far into the
+        // first remaining one the socket got.
+        size_t lRemaining = static_cast<size_t>(lWritten);
+        while (lRemaining > 0)
+        {
+            const size_t lLeft = aClient.puQueue.front().size() - aClient.puOffset;
+            if (lRemaining < lLeft)
+            {
+                aClient.puOffset += lRemaining;
+                break;
+            }
+            lRemaining -= lLeft;
+            aClient.puQueuedBytes -= aClient.puQueue.front().size();
+            aClient.puQueue.pop_front();
+            aClient.puOffset = 0;
+        }
+    }
+    return true;
+}
+
+void ResultServer::ioLoop()
+{
+    // After stop() keep flushing for a short while so that clients receive the records
+    // of the last document instead of a truncated stream.
+    const auto kDrainTime = std::chrono::seconds(2);
+    std::chrono::steady_clock::time_point lDrainDeadline{};
+
+    std::vector<pollfd> lPollFds;
+    for (;;)
+    {
+        if (!prRunning)
+        {
+            const auto lNow = std::chrono::steady_clock::now();
+            if (lDrainDeadline == std::chrono::steady_clock::time_point{})
+                lDrainDeadline = lNow + kDrainTime;
+
+            std::lock_guard<std::mutex> lLock(prMutex);
+            bool lPending = false;
+            for (auto &lClient : prClients)
+                lPending = lPending || !lClient->puQueue.empty();
+            if (!lPending || lNow >= lDrainDeadline)
+                break;
+        }
+
+        lPollFds.clear();
+        lPollFds.push_back(pollfd{prListenFd, POLLIN, 0});
+        lPollFds.push_back(pollfd{prWakeFd, POLLIN, 0});
+        {
+            std::lock_guard<std::mutex> lLock(prMutex);
+            for (auto &lClient : prClients)
+            {
+                const short lEvents = lClient->puQueue.empty() ? POLLIN : (POLLIN | POLLOUT);
+                lPollFds.push_back(pollfd{lClient->puFd, lEvents, 0});
+            }
+        }
+
+        if (::poll(lPollFds.data(), lPollFds.size(), prRunning ? 1000 : 50) < 0 && errno != EINTR)
+            break;
+
+        if (lPollFds[1].revents & POLLIN)
+        {
+            uint64_t lCounter;
+            ssize_t lIgnored = ::read(prWakeFd, &lCounter, sizeof(lCounter));
+            (void)lIgnored;
+        }
+
+        {
+            std::lock_guard<std::mutex> lLock(prMutex);
+            for (size_t i = 0; i < prClients.size();)
+            {
+                Client &lClient = *prClients[i];
+                bool lKeep = true;
+
+                // Clients do not send anything; drain input so that a hang-up is noticed.
+                char lDiscard[256];
+                const ssize_t lRead = ::recv(lClient.puFd, lDiscard, sizeof(lDiscard), MSG_DONTWAIT);
+                if (lRead == 0 || (lRead < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                    lKeep = false;
+
+                if (lKeep)
+                    lKeep = flushClient(lClient);
+
+                if (lKeep && lClient.puQueuedBytes > prClientQueueLimit)
+                {
+                    lKeep = false;
+                    ++prDroppedClients;
+                }
+
+                if (lKeep)
+                {
+                    ++i;
+                    continue;
+                }
+                ::close(lClient.puFd);
+                prClients.erase(prClients.begin() + static_cast<std::ptrdiff_t>(i));
+                prClientCount = prClients.size();
+            }
+        }
+
+        if (lPollFds[0].revents & POLLIN)
+            acceptClients();
+    }
+}
+
+} // namespace readerd
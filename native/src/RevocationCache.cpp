@@ -0,0 +1,330 @@
+#include "readerd/RevocationCache.h"
+
+#include "readerd/CertificateStore.h"
+#include "readerd/TlvReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <string_view>
+
+namespace readerd {
+
+namespace {
+
+uint64_t issuerHash(std::span<const uint8_t> aIssuer)
+{
+    return std::hash<std::string_view>()(
+        std::string_view(reinterpret_cast<const char *>(aIssuer.data()), aIssuer.size()));
+}
+
+bool makeSerial(std::span<const uint8_t> aSerial, RevokedSerial *aOut)
+{
+    if (aSerial.size() > kMaxSerialLength)
+        return false;
+    aOut->fill(0);
+    (*aOut)[0] = static_cast<uint8_t>(aSerial.size());
+    std::copy(aSerial.begin(), aSerial.end(), aOut->begin() + 1);
+    return true;
+}
+
+// A UTCTime (YYMMDDHHMMSSZ) or GeneralizedTime (YYYYMMDDHHMMSSZ), with a four digit year.
+bool takeTime(TlvReader *aReader, std::string *aTime)
+{
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lContent;
+    if (!aReader->next(&lTag, &lContent) || (lTag != kTagUtcTime && lTag != kTagGeneralizedTime))
+        return false;
+    aTime->assign(lContent.begin(), lContent.end());
+    if (lTag == kTagUtcTime && aTime->size() >= 2)
+        aTime->insert(0, (*aTime)[0] >= '5' ? "19" : "20");
+    return true;
+}
+
+// Seconds since the epoch of a time as takeTime() returns it, or 0 if it does not parse.
+int64_t epochSeconds(const std::string &aTime)
+{
+    std::tm lTime{};
+    if (aTime.size() < 14 || std::sscanf(aTime.c_str(), "%4d%2d%2d%2d%2d%2d", &lTime.tm_year, &lTime.tm_mon,
+                                         &lTime.tm_mday, &lTime.tm_hour, &lTime.tm_min, &lTime.tm_sec) != 6)
+        return 0;
+    lTime.tm_year -= 1900;
+    lTime.tm_mon -= 1;
+    return static_cast<int64_t>(::timegm(&lTime));
+}
+
+bool isTime(TlvReader aReader)
+{
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lContent;
+    return aReader.next(&lTag, &lContent) && (lTag == kTagUtcTime || lTag == kTagGeneralizedTime);
+}
+
+// Every list in one file, DER or PEM.
+void readLists(std::vector<uint8_t> aFile, std::vector<std::shared_ptr<const RevocationList>> *aLists)
+{
+    std::vector<std::vector<uint8_t>> lBlocks;
+    if (!decodePem(aFile, "X509 CRL", &lBlocks))
+        lBlocks.push_back(std::move(aFile));
+    for (std::vector<uint8_t> &lDer : lBlocks)
+    {
+        auto lList = std::make_shared<RevocationList>();
+        if (parseRevocationList(std::move(lDer), lList.get()))
+            aLists->push_back(std::move(lList));
+    }
+}
+
+} // namespace
+
+const char *revocationStatusName(RevocationStatus aStatus)
+{
+    switch (aStatus)
+    {
+    case RS_GOOD:
+        return "good";
+    case RS_REVOKED:
+        return "revoked";
+    case RS_STALE:
+        return "stale";
+    default:
+        return "unknown";
+    }
+}
+
+bool parseRevocationList(std::vector<uint8_t> aDer, RevocationList *aList)
+{
+    *aList = RevocationList();
+    aList->puDer = std::move(aDer);
+    std::span<const uint8_t> lList, lTbs, lIgnored, lIssuer, lRevoked;
+
+    // CertificateList { tbsCertList { version OPTIONAL, signature, issuer, thisUpdate,
+    // nextUpdate OPTIONAL, revokedCertificates SEQUENCE OF { userCertificate, revocationDate,
+    // crlEntryExtensions OPTIONAL } OPTIONAL, [0] crlExtensions OPTIONAL }, ... }.
+    TlvReader lOuter(aList->puDer);
+    if (!lOuter.expect(kTagSequence, &lList) || !lOuter.atEnd())
+        return false;
+    TlvReader lListReader(lList);
+    if (!lListReader.expect(kTagSequence, &lTbs))
+        return false;
+    TlvReader lFields(lTbs);
+    lFields.optional(kTagInteger, &lIgnored);
+    if (!lFields.expect(kTagSequence, &lIgnored) || !lFields.expect(kTagSequence, &lIgnored, &lIssuer)
+        || !takeTime(&lFields, &aList->puThisUpdate))
+        return false;
+    if (isTime(lFields) && !takeTime(&lFields, &aList->puNextUpdate))
+        return false;
+    aList->puNextUpdateTime = aList->puNextUpdate.empty() ? 0 : epochSeconds(aList->puNextUpdate);
+    aList->puIssuer = lIssuer;
+
+    if (lFields.optional(kTagSequence, &lRevoked))
+    {
+        TlvReader lEntries(lRevoked);
+        std::span<const uint8_t> lEntry, lSerial;
+        while (!lEntries.atEnd())
+        {
+            if (!lEntries.expect(kTagSequence, &lEntry))
+                return false;
+            TlvReader lEntryReader(lEntry);
+            RevokedSerial lKey;
+            if (!lEntryReader.expect(kTagInteger, &lSerial) || !makeSerial(lSerial, &lKey))
+                return false;
+            aList->puSerials.push_back(lKey);
+        }
+    }
+    std::sort(aList->puSerials.begin(), aList->puSerials.end());
+    aList->puSerials.erase(std::unique(aList->puSerials.begin(), aList->puSerials.end()), aList->puSerials.end());
+    return true;
+}
+
+RevocationCache::RevocationCache(const RevocationSource &aSource)
+    : prSource(aSource)
+    , prIndex(std::make_shared<IssuerIndex>())
+{
+}
+
+RevocationCache::~RevocationCache()
+{
+    stopWatching();
+}
+
+MMMReaderErrorCode RevocationCache::refresh(RevocationRefreshStats *aStats, std::string *aError)
+{
+    *aStats = RevocationRefreshStats();
+    std::lock_guard<std::mutex> lRefreshLock(prRefreshMutex);
+
+    std::vector<ListedFile> lListed;
+    const MMMReaderErrorCode lResult =
+        listFiles(prSource.puDirectory, prSource.puIncludeSubDirs, prSource.puExtensions, &lListed, aError);
+    if (lResult != NO_ERROR_OCCURRED)
+        return lResult;
+
+    std::map<std::string, FileState> lFiles;
+    for (const ListedFile &lListedFile : lListed)
+    {
+        const std::string &lPath = lListedFile.puPath;
+        FileState lState;
+        lState.puSize = lListedFile.puSize;
+        lState.puModified = lListedFile.puModified;
+        ++aStats->puFiles;
+
+        // A list is replaced by writing a new file and renaming it over the old one, which
+        // changes the modification time even when the size stays.
+        const auto lKnown = prFiles.find(lPath);
+        if (lKnown != prFiles.end() && lKnown->second.puSize == lState.puSize
+            && lKnown->second.puModified == lState.puModified)
+        {
+            aStats->puSkipped += lKnown->second.puLists.empty();
+            lFiles.emplace(lPath, std::move(lKnown->second));
+            continue;
+        }
+        std::vector<uint8_t> lFile;
+        if (readFile(lPath, &lFile))
+            readLists(std::move(lFile), &lState.puLists);
+        ++aStats->puParsed;
+        if (lState.puLists.empty())
+            ++aStats->puSkipped;
+        lFiles.emplace(lPath, std::move(lState));
+    }
+    for (const auto &lKnown : prFiles)
+        aStats->puRemoved += lFiles.count(lKnown.first) == 0;
+    prFiles = std::move(lFiles);
+
+    // The index is rebuilt whole, which is a few hundred hash inserts; the lists themselves
+    // are shared with the previous one.
+    auto lIndex = std::make_shared<IssuerIndex>();
+    for (const auto &lFile : prFiles)
+    {
+        for (const std::shared_ptr<const RevocationList> &lList : lFile.second.puLists)
+        {
+            const uint64_t lHash = issuerHash(lList->puIssuer);
+            bool lNewIssuer = true;
+            for (auto [lIt, lEnd] = lIndex->equal_range(lHash); lIt != lEnd; ++lIt)
+            {
+                if (!equal(lIt->second->puIssuer, lList->puIssuer))
+                    continue;
+                if (lList->puThisUpdate > lIt->second->puThisUpdate)
+                    lIt->second = lList;
+                lNewIssuer = false;
+                break;
+            }
+            if (lNewIssuer)
+                lIndex->emplace(lHash, lList);
+        }
+    }
+    aStats->puLists = lIndex->size();
+    for (const auto &lEntry : *lIndex)
+        aStats->puSerials += lEntry.second->puSerials.size();
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prIndex = std::move(lIndex);
+    return NO_ERROR_OCCURRED;
+}
+
+void RevocationCache::startWatching(int aIntervalMs)
+{
+    stopWatching();
+    prWatching = true;
+    prWatcher = std::thread(&RevocationCache::watchLoop, this, aIntervalMs);
+}
+
+void RevocationCache::stopWatching()
+{
+    {
+        std::lock_guard<std::mutex> lLock(prWatchMutex);
+        prWatching = false;
+    }
+    prWatchWake.notify_all();
+    if (prWatcher.joinable())
+        prWatcher.join();
+}
+
+void RevocationCache::watchLoop(int aIntervalMs)
+{
+    std::unique_lock<std::mutex> lLock(prWatchMutex);
+    while (!prWatchWake.wait_for(lLock, std::chrono::milliseconds(aIntervalMs), [this] { return !prWatching; }))
+    {
+        lLock.unlock();
+        RevocationRefreshStats lStats;
+        std::string lError;
+        if (refresh(&lStats, &lError) != NO_ERROR_OCCURRED)
+            std::fprintf(stderr, "readerd: revocation list refresh failed: %s\n", lError.c_str());
+        lLock.lock();
+    }
+}
+
+std::shared_ptr<const RevocationList> RevocationCache::find(std::span<const uint8_t> aIssuer) const
+{
+    std::shared_ptr<const IssuerIndex> lIndex;
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        lIndex = prIndex;
+    }
+    for (auto [lIt, lEnd] = lIndex->equal_range(issuerHash(aIssuer)); lIt != lEnd; ++lIt)
+    {
+        if (equal(lIt->second->puIssuer, aIssuer))
+            return lIt->second;
+    }
+    return nullptr;
+}
+
+RevocationStatus RevocationCache::check(std::span<const uint8_t> aIssuer, std::span<const uint8_t> aSerial) const
+{
+    const std::shared_ptr<const RevocationList> lList = find(aIssuer);
+    if (!lList)
+        return RS_UNKNOWN;
+    // A revocation is for good, so a stale list still answers RS_REVOKED.
+    RevokedSerial lKey;
+    if (makeSerial(aSerial, &lKey) && std::binary_search(lList->puSerials.begin(), lList->puSerials.end(), lKey))
+        return RS_REVOKED;
+    const auto lNow = std::chrono::system_clock::now().time_since_epoch();
+    if (lList->puNextUpdateTime != 0 && std::chrono::duration_cast<std::chrono::seconds>(lNow).count() > lList->puNextUpdateTime)
+        return RS_STALE;
+    return RS_GOOD;
+}
+
+RevocationStatus RevocationCache::checkIssuerSerial(std::span<const uint8_t> aIssuerAndSerialNumber) const
+{
+    // IssuerAndSerialNumber ::= SEQUENCE { issuer Name, serialNumber INTEGER }.
+    std::span<const uint8_t> lContent, lIssuer, lIgnored, lSerial;
+    TlvReader lReader(aIssuerAndSerialNumber);
+    if (!lReader.expect(kTagSequence, &lContent))
+        return RS_UNKNOWN;
+    TlvReader lFields(lContent);
+    if (!lFields.expect(kTagSequence, &lIgnored, &lIssuer) || !lFields.expect(kTagInteger, &lSerial))
+        return RS_UNKNOWN;
+    return check(lIssuer, lSerial);
+}
+
+bool RevocationCache::provide(const char *aCertIdentifier, int aCertIdentifierLen, char *aCertBuffer,
+                              int *aCertBufferLen) const
+{
+    if (aCertIdentifier == nullptr || aCertIdentifierLen <= 0 || aCertBufferLen == nullptr)
+        return false;
+    std::span<const uint8_t> lContent, lIssuer, lIgnored;
+    TlvReader lReader(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(aCertIdentifier),
+                                               static_cast<size_t>(aCertIdentifierLen)));
+    if (!lReader.expect(kTagSequence, &lContent))
+        return false;
+    TlvReader lFields(lContent);
+    if (!lFields.expect(kTagSequence, &lIgnored, &lIssuer))
+        return false;
+    const std::shared_ptr<const RevocationList> lList = find(lIssuer);
+    if (!lList)
+        return false;
+
+    // Too small a buffer: say how much is needed, and the SDK calls again with that much.
+    const int lLength = static_cast<int>(lList->puDer.size());
+    if (aCertBuffer == nullptr || *aCertBufferLen < lLength)
+    {
+        *aCertBufferLen = lLength;
+        return false;
+    }
+    std::memcpy(aCertBuffer, lList->puDer.data(), lList->puDer.size());
+    *aCertBufferLen = lLength;
+    return true;
+}
+
+} // namespace readerd
@@ -0,0 +1,83 @@
+#include "readerd/RfChip.h"
+
+#include "readerd/SecurityObject.h"
+#include "readerd/SimulatedRfChip.h"
+
+#ifdef READERD_WITH_SDK
+#include "readerd/SdkRfChip.h"
+#endif
+
+namespace readerd {
+
+namespace {
+
+const MMMReaderDataType kFileTypes[kMaxDataGroup + 1] = {
+    CD_SCDG1_FILE,  CD_SCDG1_FILE,  CD_SCDG2_FILE,  CD_SCDG3_FILE,  CD_SCDG4_FILE,  CD_SCDG5_FILE,
+    CD_SCDG6_FILE,  CD_SCDG7_FILE,  CD_SCDG8_FILE,  CD_SCDG9_FILE,  CD_SCDG10_FILE, CD_SCDG11_FILE,
+    CD_SCDG12_FILE, CD_SCDG13_FILE, CD_SCDG14_FILE, CD_SCDG15_FILE, CD_SCDG16_FILE};
+
+const MMMReaderDataType kValidateTypes[kMaxDataGroup + 1] = {
+    CD_SCDG1_VALIDATE,  CD_SCDG1_VALIDATE,  CD_SCDG2_VALIDATE,  CD_SCDG3_VALIDATE,  CD_SCDG4_VALIDATE,
+    CD_SCDG5_VALIDATE,  CD_SCDG6_VALIDATE,  CD_SCDG7_VALIDATE,  CD_SCDG8_VALIDATE,  CD_SCDG9_VALIDATE,
+    CD_SCDG10_VALIDATE, CD_SCDG11_VALIDATE, CD_SCDG12_VALIDATE, CD_SCDG13_VALIDATE, CD_SCDG14_VALIDATE,
+    CD_SCDG15_VALIDATE, CD_SCDG16_VALIDATE};
+
+} // namespace
+
+std::unique_ptr<RfChip> createChip(const std::string &aSpec, std::string *aError)
+{
+    const size_t lColon = aSpec.find(':');
+    const std::string lName = aSpec.substr(0, lColon);
+    const std::string lOptions = lColon == std::string::npos ? std::string() : aSpec.substr(lColon + 1);
+
+    if (lName == "sim")
+    {
+        SimulatedChipOptions lSimOptions;
+        if (!SimulatedChipOptions::parse(lOptions, &lSimOptions, aError))
+            return nullptr;
+        return std::make_unique<SimulatedRfChip>(lSimOptions);
+    }
+
+    if (lName == "sdk")
+    {
+#ifdef READERD_WITH_SDK
+        // Everything else comes from the SDK INI files.
+        std::unique_ptr<CertificateStore> lCertificates;
+        if (lOptions.rfind("certs=", 0) == 0)
+        {
+            lCertificates = std::make_unique<CertificateStore>();
+            if (lCertificates->open(lOptions.substr(6), aError) != NO_ERROR_OCCURRED)
+                return nullptr;
+        }
+        else if (!lOptions.empty())
+        {
+            *aError = "the sdk chip takes only certs=STORE; its settings come from the SDK ini files";
+            return nullptr;
+        }
+        return std::make_unique<SdkRfChip>(std::move(lCertificates));
+#else
+        *aError = "this build does not include the SDK backend (configure with -DREADERD_WITH_SDK=ON)";
+        return nullptr;
+#endif
+    }
+
+    *aError = "unknown chip '" + lName + "'";
+    return nullptr;
+}
+
+MMMReaderRFItem dataGroupItem(int aDataGroup)
+{
+    return static_cast<MMMReaderRFItem>(RFID_DG1 + (aDataGroup - 1));
+}
+
+MMMReaderDataType dataGroupFileType(int aDataGroup)
+{
+    return kFileTypes[aDataGroup >= 1 && aDataGroup <= kMaxDataGroup ? aDataGroup : 1];
+}
+
+MMMReaderDataType dataGroupValidateType(int aDataGroup)
+{
+    return kValidateTypes[aDataGroup >= 1 && aDataGroup <= kMaxDataGroup ? aDataGroup : 1];
+}
+
+} // namespace readerd
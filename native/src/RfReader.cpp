@@ -0,0 +1,245 @@
+#include "readerd/RfReader.h"
+
+#include <chrono>
+
+namespace readerd {
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point aStart)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+void raise(MMMReaderHLDataCallback aCallback, void *aParam, MMMReaderDataType aDataType,
+           const std::vector<uint8_t> &aBytes)
+{
+    // The callback only reads the data, as with the SDK's own buffers.
+    if (aCallback)
+        aCallback(aParam, aDataType, static_cast<int>(aBytes.size()), const_cast<uint8_t *>(aBytes.data()));
+}
+
+void raiseCode(MMMReaderHLDataCallback aCallback, void *aParam, MMMReaderDataType aDataType, int aCode)
+{
+    if (aCallback)
+        aCallback(aParam, aDataType, sizeof(aCode), &aCode);
+}
+
+} // namespace
+
+RfReader::RfReader(const RfReadOptions &aOptions)
+    : prOptions(aOptions)
+    , prJobs(aOptions.puQueueDepth)
+{
+    if (prOptions.puPipelined)
+        prValidator = std::thread(&RfReader::validatorLoop, this);
+}
+
+RfReader::~RfReader()
+{
+    prJobs.close();
+    if (prValidator.joinable())
+        prValidator.join();
+}
+
+void RfReader::validate(Job &aJob)
+{
+    const auto lStart = std::chrono::steady_clock::now();
+    int lCode = RFID_VC_NOT_PERFORMED;
+    const std::vector<uint8_t> &lExpected = prSecurityObject.puDigests[aJob.puDataGroup];
+    std::vector<uint8_t> lDigest;
+    if (prHaveSecurityObject && !lExpected.empty()
+        && computeDigest(prSecurityObject.puAlgorithm, aJob.puBytes, &lDigest))
+        lCode = lDigest == lExpected ? RFID_VC_VALID : RFID_VC_INVALID;
+    prStats->puValidateMs += elapsedMs(lStart);
+    if (lCode == RFID_VC_INVALID)
+        ++prStats->puInvalid;
+    // The cache keeps the outcome of the digests; revocation is checked again on every read.
+    if (prFilling)
+        prFilling->puValidation[aJob.puDataGroup] = lCode;
+    if (lCode == RFID_VC_VALID && prSignerRevoked)
+        lCode = RFID_VC_VALID_WITH_REVOKED_CERT;
+
+    raise(prCallback, prParam, dataGroupFileType(aJob.puDataGroup), aJob.puBytes);
+    raiseCode(prCallback, prParam, dataGroupValidateType(aJob.puDataGroup), lCode);
+    if (prFilling)
+        prFilling->puFiles[aJob.puDataGroup] = std::move(aJob.puBytes);
+}
+
+void RfReader::validatorLoop()
+{
+    Job lJob;
+    while (prJobs.pop(&lJob))
+    {
+        validate(lJob);
+        prJobs.taskDone();
+    }
+}
+
+bool RfReader::serveCached(RfChip &aChip, const std::vector<uint8_t> &aEfSod, RfReadStats *aStats)
+{
+    const std::shared_ptr<const CachedChip> lCached = prOptions.puCache->find(aEfSod);
+    if (!lCached)
+        return false;
+    // The groups a full read of this chip would read: those asked for, else those its EF.COM
+    // lists. Another reader may have cached fewer of them, and then the chip is read in full.
+    std::vector<int> lGroups = prOptions.puDataGroups;
+    if (lGroups.empty() && !parseEfCom(lCached->puEfCom, &lGroups))
+        return false;
+    for (int lGroup : lGroups)
+    {
+        if (lGroup >= 1 && lGroup <= kMaxDataGroup && !lCached->puKnown[lGroup])
+            return false;
+    }
+    if (prOptions.puCache->options().puRequireActiveAuthentication)
+    {
+        // Active Authentication proves the chip holds the key in its own DG15, so that DG15 must
+        // be the one EF.SOD vouches for; a clone could carry its own DG15 and key beside a copied
+        // EF.SOD. A chip that fails either is read in full, and reported as any other would be.
+        std::vector<uint8_t> lDG15, lDigest;
+        const auto lReadStart = std::chrono::steady_clock::now();
+        const MMMReaderErrorCode lRead = aChip.getFile(RFID_DG15, &lDG15);
+        aStats->puReadMs += elapsedMs(lReadStart);
+        if (lRead != NO_ERROR_OCCURRED)
+            return false;
+        aStats->puBytes += lDG15.size();
+        const std::vector<uint8_t> &lExpected = prSecurityObject.puDigests[15];
+        const bool lVouched = !lExpected.empty() && computeDigest(prSecurityObject.puAlgorithm, lDG15, &lDigest)
+            ? lDigest == lExpected
+            : lCached->puKnown[15] && !lCached->puFiles[15].empty() && lDG15 == lCached->puFiles[15];
+        if (!lVouched)
+            return false;
+        if (aChip.checkActiveAuthentication(&aStats->puActiveAuthentication) != NO_ERROR_OCCURRED
+            || aStats->puActiveAuthentication != RFID_VC_VALID)
+            return false;
+    }
+
+    aStats->puCacheHit = true;
+    raise(prCallback, prParam, CD_SCEF_COM_FILE, lCached->puEfCom);
+    raise(prCallback, prParam, CD_SCEF_SOD_FILE, aEfSod);
+    for (int lGroup : lGroups)
+    {
+        if (lGroup < 1 || lGroup > kMaxDataGroup || lCached->puFiles[lGroup].empty())
+            continue;
+        const std::vector<uint8_t> &lFile = lCached->puFiles[lGroup];
+        int lCode = lCached->puValidation[lGroup];
+        if (lCode == RFID_VC_VALID && prSignerRevoked)
+            lCode = RFID_VC_VALID_WITH_REVOKED_CERT;
+        ++aStats->puDataGroups;
+        raise(prCallback, prParam, dataGroupFileType(lGroup), lFile);
+        raiseCode(prCallback, prParam, dataGroupValidateType(lGroup), lCode);
+    }
+    return true;
+}
+
+MMMReaderErrorCode RfReader::read(RfChip &aChip, MMMReaderHLDataCallback aCallback, void *aParam,
+                                  RfReadStats *aStats)
+{
+    *aStats = RfReadStats();
+    prCallback = aCallback;
+    prParam = aParam;
+    prStats = aStats;
+    const auto lStart = std::chrono::steady_clock::now();
+
+    // The tuner takes over once EF.SOD tells what kind of chip this is.
+    BlockSizeTuner *lTuner = nullptr;
+    auto lGetFile = [&aChip, aStats, &lTuner](MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes) {
+        const auto lReadStart = std::chrono::steady_clock::now();
+        const MMMReaderErrorCode lResult =
+            lTuner != nullptr ? lTuner->getFile(aChip, aItem, aBytes) : aChip.getFile(aItem, aBytes);
+        aStats->puReadMs += elapsedMs(lReadStart);
+        if (lResult == NO_ERROR_OCCURRED)
+            aStats->puBytes += aBytes->size();
+        return lResult;
+    };
+
+    auto lFinish = [this, &aChip, aStats, lStart](MMMReaderErrorCode aResult) {
+        aStats->puTotalMs = elapsedMs(lStart);
+        aStats->puBlockSize = aChip.readBlockSize();
+        prCallback = nullptr;
+        prParam = nullptr;
+        prStats = nullptr;
+        return aResult;
+    };
+
+    // The digests are needed before the first data group is in, so EF.SOD goes first. With a
+    // cache it goes ahead of EF.COM too, as it may be all that is read.
+    std::vector<uint8_t> lEfCom, lEfSod;
+    MMMReaderErrorCode lResult = NO_ERROR_OCCURRED;
+    if (prOptions.puCache == nullptr)
+    {
+        lResult = lGetFile(RFID_EF_COM, &lEfCom);
+        if (lResult != NO_ERROR_OCCURRED)
+            return lFinish(lResult);
+    }
+    const MMMReaderErrorCode lSodResult = lGetFile(RFID_EF_SOD, &lEfSod);
+    if (lSodResult != NO_ERROR_OCCURRED && lSodResult != ERROR_RF_DG_NOT_PRESENT)
+        return lFinish(lSodResult);
+    prHaveSecurityObject = lSodResult == NO_ERROR_OCCURRED && parseEfSod(lEfSod, &prSecurityObject);
+    if (prOptions.puTuner != nullptr
+        && prOptions.puTuner->begin(aChip, blockProfileKey(prHaveSecurityObject ? &prSecurityObject : nullptr))
+               == NO_ERROR_OCCURRED)
+        lTuner = prOptions.puTuner;
+    prSignerRevoked = false;
+    if (prHaveSecurityObject && prOptions.puRevocations != nullptr && !prSecurityObject.puSignerIssuer.empty())
+    {
+        const auto lCheckStart = std::chrono::steady_clock::now();
+        aStats->puSignerStatus =
+            prOptions.puRevocations->check(prSecurityObject.puSignerIssuer, prSecurityObject.puSignerSerial);
+        aStats->puRevocationUs = elapsedMs(lCheckStart) * 1000.0;
+        prSignerRevoked = aStats->puSignerStatus == RS_REVOKED;
+    }
+    if (prOptions.puCache != nullptr)
+    {
+        if (prHaveSecurityObject && serveCached(aChip, lEfSod, aStats))
+            return lFinish(NO_ERROR_OCCURRED);
+        lResult = lGetFile(RFID_EF_COM, &lEfCom);
+        if (lResult != NO_ERROR_OCCURRED)
+            return lFinish(lResult);
+        if (prHaveSecurityObject)
+        {
+            prFilling = std::make_unique<CachedChip>();
+            prFilling->puEfCom = lEfCom;
+        }
+    }
+    raise(aCallback, aParam, CD_SCEF_COM_FILE, lEfCom);
+    if (lSodResult == NO_ERROR_OCCURRED)
+        raise(aCallback, aParam, CD_SCEF_SOD_FILE, lEfSod);
+
+    std::vector<int> lGroups = prOptions.puDataGroups;
+    if (lGroups.empty())
+        parseEfCom(lEfCom, &lGroups);
+
+    for (int lGroup : lGroups)
+    {
+        if (lGroup < 1 || lGroup > kMaxDataGroup)
+            continue;
+        Job lJob;
+        lJob.puDataGroup = lGroup;
+        const MMMReaderErrorCode lRead = lGetFile(dataGroupItem(lGroup), &lJob.puBytes);
+        if (lRead != NO_ERROR_OCCURRED && lRead != ERROR_RF_DG_NOT_PRESENT)
+        {
+            lResult = lRead;
+            break;
+        }
+        if (prFilling)
+            prFilling->puKnown[lGroup] = true;
+        if (lRead == ERROR_RF_DG_NOT_PRESENT)
+            continue;
+        ++aStats->puDataGroups;
+        // The queue only fills when hashing falls behind the chip; then the chip waits.
+        if (!prOptions.puPipelined || !prJobs.push(std::move(lJob), std::chrono::hours(1)))
+            validate(lJob);
+    }
+
+    const auto lDrainStart = std::chrono::steady_clock::now();
+    prJobs.join();
+    aStats->puDrainMs = elapsedMs(lDrainStart);
+    // A chip with a data group that does not match is read in full every time.
+    if (prFilling && lResult == NO_ERROR_OCCURRED && aStats->puInvalid == 0)
+        prOptions.puCache->store(lEfSod, std::move(*prFilling));
+    prFilling.reset();
+    return lFinish(lResult);
+}
+
+} // namespace readerd
@@ -0,0 +1,786 @@
+#include "readerd/ScanArchive.h"
+#include "readerd/CodelineCodec.h"
+#include "readerd/ImageConvert.h"
+#include "readerd/ReaderBackend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace readerd {
+
+namespace {
+
+constexpr uint32_t kValidationField = CF_STRING_COUNT + 1;
+
+const uint8_t kPadding[8] = {};
+
+uint64_t alignUp(uint64_t aBytes)
+{
+    return (aBytes + 7) & ~uint64_t(7);
+}
+
+uint64_t bitmapBytes(uint32_t aRows)
+{
+    return (aRows + 63) / 64 * sizeof(uint64_t);
+}
+
+size_t valueWidth(ArchiveColumnKind aKind)
+{
+    switch (aKind)
+    {
+    case ACK_INT32:
+        return sizeof(int32_t);
+    case ACK_FLOAT32:
+        return sizeof(float);
+    case ACK_INT64:
+        return sizeof(int64_t);
+    case ACK_BLOB:
+        return sizeof(ArchiveBlobRef);
+    default:
+        return 0;
+    }
+}
+
+bool isCodelineDataType(MMMReaderDataType aDataType)
+{
+    return aDataType == CD_CODELINE_DATA || aDataType == CD_SCDG1_CODELINE_DATA;
+}
+
+struct DataTypeKind
+{
+    MMMReaderDataType puDataType;
+    ArchiveColumnKind puKind;
+};
+
+// The data types stored by value, with the kind of the type MMMReaderHighLevelAPI.h says to cast
+// them to: int, float, a TRISTATE or MMMReaderValidationCode (both int sized), or a
+// NUL-terminated string as the Java sample prints it. The rest are blobs.
+const DataTypeKind kDataTypeKinds[] = {
+    {CD_CHECKSUM, ACK_INT32},
+    {CD_SECURITYCHECK, ACK_INT32},
+    {CD_SCDG1_VALIDATE, ACK_INT32},
+    {CD_SCDG2_VALIDATE, ACK_INT32},
+    {CD_SCDG3_VALIDATE, ACK_INT32},
+    {CD_SCDG4_VALIDATE, ACK_INT32},
+    {CD_SCDG5_VALIDATE, ACK_INT32},
+    {CD_SCDG6_VALIDATE, ACK_INT32},
+    {CD_SCDG7_VALIDATE, ACK_INT32},
+    {CD_SCDG8_VALIDATE, ACK_INT32},
+    {CD_SCDG9_VALIDATE, ACK_INT32},
+    {CD_SCDG10_VALIDATE, ACK_INT32},
+    {CD_SCDG11_VALIDATE, ACK_INT32},
+    {CD_SCDG12_VALIDATE, ACK_INT32},
+    {CD_SCDG13_VALIDATE, ACK_INT32},
+    {CD_SCDG14_VALIDATE, ACK_INT32},
+    {CD_SCDG15_VALIDATE, ACK_INT32},
+    {CD_SCDG16_VALIDATE, ACK_INT32},
+    {CD_SCSIGNEDATTRS_VALIDATE, ACK_INT32},
+    {CD_SCSIGNATURE_VALIDATE, ACK_INT32},
+    {CD_SCBAC_STATUS, ACK_INT32},
+    {CD_ACTIVE_AUTHENTICATION, ACK_INT32},
+    {CD_VALIDATE_DOC_SIGNER_CERT, ACK_INT32},
+    {CD_SCTERMINAL_AUTHENTICATION_STATUS, ACK_INT32},
+    {CD_SCCHIP_AUTHENTICATION_STATUS, ACK_INT32},
+    {CD_PASSIVE_AUTHENTICATION, ACK_INT32},
+    {CD_SAC_STATUS, ACK_INT32},
+    {CD_SCDG1_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG2_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG3_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG4_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG5_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG6_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG7_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG8_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG9_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG10_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG11_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG12_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG13_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG14_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG15_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG16_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG17_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG18_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG19_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG20_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG21_VALIDATE_EID, ACK_INT32},
+    {CD_SCDG22_VALIDATE_EID, ACK_INT32},
+    {CD_SCSIGNEDATTRS_VALIDATE_CARD_SECURITY_FILE, ACK_INT32},
+    {CD_SCSIGNEDATTRS_VALIDATE_CHIP_SECURITY_FILE, ACK_INT32},
+    {CD_SCSIGNATURE_VALIDATE_CARD_SECURITY_FILE, ACK_INT32},
+    {CD_SCSIGNATURE_VALIDATE_CHIP_SECURITY_FILE, ACK_INT32},
+    {CD_SCDG1_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG2_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG3_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG4_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG5_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG6_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG7_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG8_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG9_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG10_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG11_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG12_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG13_VALIDATE_EDL, ACK_INT32},
+    {CD_SCDG14_VALIDATE_EDL, ACK_INT32},
+    {CD_VALIDATE_DOC_SIGNER_CERT_CARD_SECURITY_FILE, ACK_INT32},
+    {CD_VALIDATE_DOC_SIGNER_CERT_CHIP_SECURITY_FILE, ACK_INT32},
+    {CD_DGC_SIGNATURE_VALIDATE, ACK_INT32},
+    {CD_DGC_DOC_SIGNER_CERT_VALIDATE, ACK_INT32},
+    {CD_READ_PROGRESS, ACK_FLOAT32},
+    {CD_CODELINE, ACK_STRING},
+    {CD_SCDG1_CODELINE, ACK_STRING},
+    {CD_SCCHIPID, ACK_STRING},
+    {CD_SCAIRBAUD, ACK_STRING},
+};
+
+ArchiveColumnKind columnKind(MMMReaderDataType aDataType)
+{
+    for (const DataTypeKind &lEntry : kDataTypeKinds)
+    {
+        if (lEntry.puDataType == aDataType)
+            return lEntry.puKind;
+    }
+    return ACK_BLOB;
+}
+
+bool writeAll(int aFd, const uint8_t *aData, size_t aLen)
+{
+    while (aLen > 0)
+    {
+        const ssize_t lWritten = ::write(aFd, aData, aLen);
+        if (lWritten < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        aData += lWritten;
+        aLen -= static_cast<size_t>(lWritten);
+    }
+    return true;
+}
+
+// Walks the chunks of the archive in aFd and returns where the last complete one ends.
+uint64_t validLength(int aFd, uint64_t aSize)
+{
+    uint64_t lOffset = sizeof(ArchiveFileHeader);
+    ArchiveChunkHeader lChunk;
+    while (lOffset + sizeof(lChunk) <= aSize)
+    {
+        if (::pread(aFd, &lChunk, sizeof(lChunk), static_cast<off_t>(lOffset)) != static_cast<ssize_t>(sizeof(lChunk))
+            || lChunk.puMagic != kArchiveChunkMagic || lChunk.puLength > aSize - lOffset - sizeof(lChunk))
+            break;
+        lOffset += sizeof(lChunk) + lChunk.puLength;
+    }
+    return lOffset;
+}
+
+} // namespace
+
+std::string archiveColumnName(uint32_t aColumn)
+{
+    if (aColumn == kArchiveDocumentColumn)
+        return "document";
+    if (aColumn == kArchiveTimeColumn)
+        return "time";
+    const MMMReaderDataType lDataType = static_cast<MMMReaderDataType>(aColumn >> 8);
+    const uint32_t lField = aColumn & 0xFF;
+    if (lField == 0)
+        return dataTypeName(lDataType);
+    if (lField == kValidationField)
+        return dataTypeName(lDataType) + ".CodelineValidationResult";
+    return dataTypeName(lDataType) + "." + codelineFieldName(static_cast<CodelineField>(lField - 1));
+}
+
+bool archiveColumnFromName(const std::string &aName, uint32_t *aColumn)
+{
+    if (aName == "document" || aName == "time")
+    {
+        *aColumn = aName == "document" ? kArchiveDocumentColumn : kArchiveTimeColumn;
+        return true;
+    }
+    const size_t lDot = aName.find('.');
+    MMMReaderDataType lDataType;
+    if (!dataTypeFromName(aName.substr(0, lDot), &lDataType))
+        return false;
+    if (lDot == std::string::npos)
+    {
+        *aColumn = archiveColumnId(lDataType);
+        return true;
+    }
+    const std::string lField = aName.substr(lDot + 1);
+    if (lField == "CodelineValidationResult")
+    {
+        *aColumn = archiveColumnId(lDataType, kValidationField);
+        return true;
+    }
+    for (int i = 0; i < CF_STRING_COUNT; ++i)
+    {
+        if (lField == codelineFieldName(static_cast<CodelineField>(i)))
+        {
+            *aColumn = archiveColumnId(lDataType, static_cast<uint32_t>(i + 1));
+            return true;
+        }
+    }
+    return false;
+}
+
+// A column of the segment being built. Rows are filled in order, at most once each, and
+// rows a document skipped are padded with zeros (or empty strings) when the next one comes.
+struct ArchiveWriter::Column
+{
+    ArchiveColumnKind puKind;
+    std::vector<uint64_t> puBits;
+    std::vector<uint8_t> puValues;
+    std::vector<uint32_t> puOffsets;    ///< ACK_STRING: start of each row in puChars.
+    std::string puChars;
+
+    void mark(uint32_t aRow)
+    {
+        puBits.resize(aRow / 64 + 1);
+        puBits[aRow / 64] |= uint64_t(1) << (aRow % 64);
+    }
+
+    void set(uint32_t aRow, const void *aValue)
+    {
+        const size_t lWidth = valueWidth(puKind);
+        puValues.resize((aRow + 1) * lWidth);
+        std::memcpy(puValues.data() + aRow * lWidth, aValue, lWidth);
+        mark(aRow);
+    }
+
+    void setString(uint32_t aRow, std::string_view aValue)
+    {
+        puOffsets.resize(aRow + 1, static_cast<uint32_t>(puChars.size()));
+        puChars.append(aValue);
+        mark(aRow);
+    }
+
+    // Pads every part to aRows and appends the column to aOut.
+    void finish(uint32_t aRows, std::vector<uint8_t> *aOut)
+    {
+        puBits.resize(bitmapBytes(aRows) / sizeof(uint64_t));
+        const uint8_t *lBits = reinterpret_cast<const uint8_t *>(puBits.data());
+        aOut->insert(aOut->end(), lBits, lBits + puBits.size() * sizeof(uint64_t));
+        if (puKind == ACK_STRING)
+        {
+            puOffsets.resize(aRows + 1, static_cast<uint32_t>(puChars.size()));
+            const uint8_t *lOffsets = reinterpret_cast<const uint8_t *>(puOffsets.data());
+            aOut->insert(aOut->end(), lOffsets, lOffsets + puOffsets.size() * sizeof(uint32_t));
+            aOut->insert(aOut->end(), puChars.begin(), puChars.end());
+        }
+        else
+        {
+            puValues.resize(aRows * valueWidth(puKind));
+            aOut->insert(aOut->end(), puValues.begin(), puValues.end());
+        }
+        aOut->resize(alignUp(aOut->size()));
+    }
+};
+
+ArchiveWriter::ArchiveWriter() = default;
+
+ArchiveWriter::~ArchiveWriter()
+{
+    close();
+}
+
+MMMReaderErrorCode ArchiveWriter::open(const std::string &aPath, const ArchiveOptions &aOptions, std::string *aError)
+{
+    close();
+    const int lFd = ::open(aPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (lFd < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+
+    struct stat lStat;
+    if (::fstat(lFd, &lStat) != 0)
+    {
+        *aError = "stat " + aPath + ": " + std::strerror(errno);
+        ::close(lFd);
+        return ERROR_OS_ERROR;
+    }
+    uint64_t lSize = static_cast<uint64_t>(lStat.st_size);
+    if (lSize == 0)
+    {
+        const ArchiveFileHeader lHeader{kArchiveMagic, kArchiveVersion, 0};
+        if (!writeAll(lFd, reinterpret_cast<const uint8_t *>(&lHeader), sizeof(lHeader)))
+        {
+            *aError = "write " + aPath + ": " + std::strerror(errno);
+            ::close(lFd);
+            return ERROR_OS_ERROR;
+        }
+        lSize = sizeof(lHeader);
+    }
+    else
+    {
+        ArchiveFileHeader lHeader{};
+        if (::pread(lFd, &lHeader, sizeof(lHeader), 0) != static_cast<ssize_t>(sizeof(lHeader))
+            || lHeader.puMagic != kArchiveMagic || lHeader.puVersion != kArchiveVersion)
+        {
+            *aError = aPath + " is not a readerd archive";
+            ::close(lFd);
+            return ERROR_UNKNOWN_DATA_FORMAT;
+        }
+        const uint64_t lValid = validLength(lFd, lSize);
+        if (lValid < lSize && ::ftruncate(lFd, static_cast<off_t>(lValid)) != 0)
+        {
+            *aError = "truncate " + aPath + ": " + std::strerror(errno);
+            ::close(lFd);
+            return ERROR_OS_ERROR;
+        }
+        lSize = lValid;
+    }
+    ::lseek(lFd, static_cast<off_t>(lSize), SEEK_SET);
+
+    prOptions = aOptions;
+    prOptions.puSegmentDocuments = std::max<uint32_t>(aOptions.puSegmentDocuments, 1);
+    prFd = lFd;
+    prFileSize = lSize;
+    prFailed = false;
+    prStats = Stats();
+    prQueue = std::make_unique<BoundedQueue<Document>>(aOptions.puQueueDocuments);
+    prWriter = std::thread(&ArchiveWriter::writerLoop, this);
+    return NO_ERROR_OCCURRED;
+}
+
+void ArchiveWriter::close()
+{
+    if (prFd < 0)
+        return;
+    prQueue->close();
+    if (prWriter.joinable())
+        prWriter.join();
+    flushSegment();
+    ::close(prFd);
+    prFd = -1;
+    std::lock_guard<std::mutex> lLock(prOpenMutex);
+    prOpen.clear();
+}
+
+void ArchiveWriter::onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument)
+{
+    if (prFd < 0)
+        return;
+    if (aEventCode == START_OF_DOCUMENT_DATA)
+    {
+        const auto lNow = std::chrono::system_clock::now().time_since_epoch();
+        std::lock_guard<std::mutex> lLock(prOpenMutex);
+        Document &lDocument = prOpen[aDocument];
+        lDocument.puSequence = aDocument;
+        lDocument.puTimeUs = std::chrono::duration_cast<std::chrono::microseconds>(lNow).count();
+        lDocument.puItems.clear();
+    }
+    else if (aEventCode == END_OF_DOCUMENT_DATA)
+    {
+        Document lDocument;
+        {
+            std::lock_guard<std::mutex> lLock(prOpenMutex);
+            auto lIt = prOpen.find(aDocument);
+            if (lIt == prOpen.end())
+                return;
+            lDocument = std::move(lIt->second);
+            prOpen.erase(lIt);
+        }
+        // A writer stuck for a minute is not coming back; the document is dropped after all.
+        const bool lQueued = prOptions.puWaitForWriter ? prQueue->push(std::move(lDocument), std::chrono::minutes(1))
+                                                       : prQueue->tryPush(std::move(lDocument));
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        ++(lQueued ? prStats.puDocuments : prStats.puDropped);
+    }
+}
+
+void ArchiveWriter::onData(const DataItem &aItem)
+{
+    if (prFd < 0)
+        return;
+    // Only the size of an image is kept without puStoreImages, so there is nothing to retain.
+    const bool lSizeOnly = !prOptions.puStoreImages && isImageDataType(aItem.type());
+    DataRef lData = lSizeOnly ? DataRef() : aItem.retain();
+    std::lock_guard<std::mutex> lLock(prOpenMutex);
+    auto lIt = prOpen.find(aItem.document());
+    if (lIt == prOpen.end())
+        return;
+    if (lSizeOnly)
+    {
+        // Stands in for the image: just its size.
+        const uint64_t lSize = aItem.size();
+        lData = DataRef::copyOf(&lSize, sizeof(lSize));
+    }
+    lIt->second.puItems.emplace_back(aItem.type(), std::move(lData));
+}
+
+ArchiveWriter::Stats ArchiveWriter::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prStatsMutex);
+    return prStats;
+}
+
+void ArchiveWriter::writerLoop()
+{
+    Document lDocument;
+    while (prQueue->pop(&lDocument))
+    {
+        appendDocument(lDocument);
+        lDocument = Document();
+        prQueue->taskDone();
+    }
+}
+
+bool ArchiveWriter::append(std::span<const std::span<const uint8_t>> aParts)
+{
+    if (prFailed)
+        return false;
+    uint64_t lSize = prFileSize;
+    for (const std::span<const uint8_t> &lPart : aParts)
+    {
+        if (!writeAll(prFd, lPart.data(), lPart.size()))
+        {
+            std::fprintf(stderr, "readerd: archive write failed: %s\n", std::strerror(errno));
+            // A torn chunk mid-file would end the archive for readers, and the next open()
+            // would cut off everything after it, so it goes now. If it cannot, nothing more
+            // is appended and the next open() cuts it off.
+            if (::ftruncate(prFd, static_cast<off_t>(prFileSize)) != 0
+                || ::lseek(prFd, static_cast<off_t>(prFileSize), SEEK_SET) < 0)
+            {
+                std::fprintf(stderr, "readerd: archive truncate failed: %s; archiving stopped\n",
+                             std::strerror(errno));
+                prFailed = true;
+            }
+            return false;
+        }
+        lSize += lPart.size();
+    }
+    std::lock_guard<std::mutex> lLock(prStatsMutex);
+    prStats.puBytes += lSize - prFileSize;
+    prFileSize = lSize;
+    return true;
+}
+
+void ArchiveWriter::appendDocument(Document &aDocument)
+{
+    // The last item of each data type wins.
+    std::map<MMMReaderDataType, const DataRef *> lItems;
+    for (const auto &[lDataType, lData] : aDocument.puItems)
+        lItems[lDataType] = &lData;
+
+    const uint32_t lRow = prRows;
+    // Every column id has one kind, fixed by columnKind(), so a column is always found.
+    auto lColumn = [this](uint32_t aId, ArchiveColumnKind aKind) -> Column & {
+        return prColumns.try_emplace(aId, Column{aKind, {}, {}, {}, {}}).first->second;
+    };
+    uint64_t lMismatched = 0;
+    auto lMismatch = [this, &lMismatched](MMMReaderDataType aDataType, size_t aSize, ArchiveColumnKind aKind) {
+        ++lMismatched;
+        if (prMismatchedTypes.insert(aDataType).second)
+            std::fprintf(stderr, "readerd: archive: %s item of %zu bytes does not fit a %s column; not archived\n",
+                         dataTypeName(aDataType).c_str(), aSize, aKind == ACK_FLOAT32 ? "float" : "int32");
+    };
+    const int64_t lSequence = aDocument.puSequence;
+    lColumn(kArchiveDocumentColumn, ACK_INT64).set(lRow, &lSequence);
+    lColumn(kArchiveTimeColumn, ACK_INT64).set(lRow, &aDocument.puTimeUs);
+
+    // Blobs go out first, as one chunk, so their file offsets are known for the refs.
+    std::vector<std::span<const uint8_t>> lParts;
+    std::vector<std::pair<uint32_t, ArchiveBlobRef>> lRefs;
+    ArchiveChunkHeader lChunk{kArchiveChunkMagic, AC_BLOBS, 0};
+    lParts.emplace_back(reinterpret_cast<const uint8_t *>(&lChunk), sizeof(lChunk));
+
+    for (const auto &[lDataType, lData] : lItems)
+    {
+        const std::span<const uint8_t> lBytes = lData->bytes();
+        const uint32_t lId = archiveColumnId(lDataType);
+        const ArchiveColumnKind lKind = columnKind(lDataType);
+        if (isCodelineDataType(lDataType))
+        {
+            if (lBytes.size() < sizeof(MMMReaderCodelineData))
+            {
+                lMismatch(lDataType, lBytes.size(), ACK_STRING);
+                continue;
+            }
+            const MMMReaderCodelineData &lCodeline = *reinterpret_cast<const MMMReaderCodelineData *>(lBytes.data());
+            for (int f = CF_LINE1; f < CF_STRING_COUNT; ++f)
+            {
+                const std::string_view lValue = codelineField(lCodeline, static_cast<CodelineField>(f));
+                if (!lValue.empty())
+                    lColumn(archiveColumnId(lDataType, f + 1), ACK_STRING).setString(lRow, lValue);
+            }
+            const int32_t lResult = lCodeline.CodelineValidationResult;
+            lColumn(archiveColumnId(lDataType, kValidationField), ACK_INT32).set(lRow, &lResult);
+        }
+        else if (lKind == ACK_STRING)
+        {
+            const char *lChars = reinterpret_cast<const char *>(lBytes.data());
+            lColumn(lId, ACK_STRING).setString(lRow, std::string_view(lChars, strnlen(lChars, lBytes.size())));
+        }
+        else if (lKind == ACK_INT32 || lKind == ACK_FLOAT32)
+        {
+            // Both are four bytes; the kind tells a reader how to take them.
+            if (lBytes.size() != valueWidth(lKind))
+                lMismatch(lDataType, lBytes.size(), lKind);
+            else
+                lColumn(lId, lKind).set(lRow, lBytes.data());
+        }
+        else if (!prOptions.puStoreImages && isImageDataType(lDataType))
+        {
+            uint64_t lSize = 0;
+            std::memcpy(&lSize, lBytes.data(), std::min(lBytes.size(), sizeof(lSize)));
+            lRefs.emplace_back(lId, ArchiveBlobRef{kArchiveNotStored, lSize});
+        }
+        else
+        {
+            const uint64_t lOffset = prFileSize + sizeof(lChunk) + lChunk.puLength;
+            lRefs.emplace_back(lId, ArchiveBlobRef{lOffset, lBytes.size()});
+            lParts.push_back(lBytes);
+            lParts.emplace_back(kPadding, alignUp(lBytes.size()) - lBytes.size());
+            lChunk.puLength += alignUp(lBytes.size());
+        }
+    }
+
+    if (lChunk.puLength > 0 && !append(lParts))
+    {
+        // append() took the torn chunk off again; the document is still indexed, with its
+        // blobs marked as not stored.
+        for (auto &lRef : lRefs)
+            lRef.second.puOffset = kArchiveNotStored;
+    }
+    for (const auto &[lId, lRef] : lRefs)
+        lColumn(lId, ACK_BLOB).set(lRow, &lRef);
+    if (lMismatched > 0)
+    {
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        prStats.puMismatched += lMismatched;
+    }
+
+    if (++prRows >= prOptions.puSegmentDocuments)
+        flushSegment();
+}
+
+void ArchiveWriter::flushSegment()
+{
+    if (prRows == 0)
+        return;
+
+    std::vector<uint8_t> lSegment(sizeof(ArchiveSegmentHeader) + prColumns.size() * sizeof(ArchiveColumnEntry));
+    std::vector<ArchiveColumnEntry> lEntries;
+    for (auto &[lId, lColumn] : prColumns)
+    {
+        const uint64_t lOffset = lSegment.size();
+        lColumn.finish(prRows, &lSegment);
+        lEntries.push_back(ArchiveColumnEntry{lId, static_cast<uint32_t>(lColumn.puKind), lOffset,
+                                              lSegment.size() - lOffset});
+    }
+    const ArchiveSegmentHeader lHeader{prRows, static_cast<uint32_t>(lEntries.size())};
+    std::memcpy(lSegment.data(), &lHeader, sizeof(lHeader));
+    std::memcpy(lSegment.data() + sizeof(lHeader), lEntries.data(), lEntries.size() * sizeof(ArchiveColumnEntry));
+
+    const ArchiveChunkHeader lChunk{kArchiveChunkMagic, AC_SEGMENT, lSegment.size()};
+    const std::span<const uint8_t> lParts[] = {
+        std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(&lChunk), sizeof(lChunk)),
+        std::span<const uint8_t>(lSegment),
+    };
+    if (append(lParts))
+    {
+        std::lock_guard<std::mutex> lLock(prStatsMutex);
+        ++prStats.puSegments;
+    }
+    prColumns.clear();
+    prRows = 0;
+}
+
+int64_t ArchiveColumn::integer(uint32_t aRow) const
+{
+    if (prKind == ACK_INT32)
+    {
+        int32_t lValue;
+        std::memcpy(&lValue, prValues + aRow * sizeof(lValue), sizeof(lValue));
+        return lValue;
+    }
+    if (prKind == ACK_INT64)
+    {
+        int64_t lValue;
+        std::memcpy(&lValue, prValues + aRow * sizeof(lValue), sizeof(lValue));
+        return lValue;
+    }
+    return 0;
+}
+
+float ArchiveColumn::real(uint32_t aRow) const
+{
+    if (prKind != ACK_FLOAT32)
+        return 0;
+    float lValue;
+    std::memcpy(&lValue, prValues + aRow * sizeof(lValue), sizeof(lValue));
+    return lValue;
+}
+
+std::string_view ArchiveColumn::string(uint32_t aRow) const
+{
+    if (prKind != ACK_STRING)
+        return {};
+    const uint32_t *lOffsets = reinterpret_cast<const uint32_t *>(prValues);
+    const char *lChars = reinterpret_cast<const char *>(lOffsets + prRows + 1);
+    // The open checked the last offset against the column; a row past it is damage.
+    if (lOffsets[aRow] > lOffsets[aRow + 1] || lOffsets[aRow + 1] > lOffsets[prRows])
+        return {};
+    return std::string_view(lChars + lOffsets[aRow], lOffsets[aRow + 1] - lOffsets[aRow]);
+}
+
+std::span<const uint8_t> ArchiveColumn::blob(uint32_t aRow) const
+{
+    if (prKind != ACK_BLOB)
+        return {};
+    ArchiveBlobRef lRef;
+    std::memcpy(&lRef, prValues + aRow * sizeof(lRef), sizeof(lRef));
+    if (lRef.puOffset == kArchiveNotStored || lRef.puOffset > prFileSize || lRef.puLength > prFileSize - lRef.puOffset)
+        return {};
+    return std::span<const uint8_t>(prFile + lRef.puOffset, lRef.puLength);
+}
+
+uint64_t ArchiveColumn::blobSize(uint32_t aRow) const
+{
+    if (prKind != ACK_BLOB)
+        return 0;
+    ArchiveBlobRef lRef;
+    std::memcpy(&lRef, prValues + aRow * sizeof(lRef), sizeof(lRef));
+    return lRef.puLength;
+}
+
+ArchiveColumn ArchiveSegment::column(uint32_t aId) const
+{
+    ArchiveColumn lColumn;
+    const std::span<const ArchiveColumnEntry> lEntries = columns();
+    const auto lIt = std::lower_bound(lEntries.begin(), lEntries.end(), aId,
+        [](const ArchiveColumnEntry &aEntry, uint32_t aKey) { return aEntry.puId < aKey; });
+    if (lIt == lEntries.end() || lIt->puId != aId)
+        return lColumn;
+
+    const uint8_t *lBase = reinterpret_cast<const uint8_t *>(prHeader);
+    lColumn.prId = aId;
+    lColumn.prKind = static_cast<ArchiveColumnKind>(lIt->puKind);
+    lColumn.prRows = rows();
+    lColumn.prBits = reinterpret_cast<const uint64_t *>(lBase + lIt->puOffset);
+    lColumn.prValues = lBase + lIt->puOffset + bitmapBytes(rows());
+    lColumn.prFile = prFile;
+    lColumn.prFileSize = prFileSize;
+    return lColumn;
+}
+
+bool ArchiveSegment::validate(uint64_t aLength) const
+{
+    const uint64_t lDirectory = sizeof(ArchiveSegmentHeader) + uint64_t(prHeader->puColumns) * sizeof(ArchiveColumnEntry);
+    if (lDirectory > aLength)
+        return false;
+    const uint8_t *lBase = reinterpret_cast<const uint8_t *>(prHeader);
+    for (const ArchiveColumnEntry &lEntry : columns())
+    {
+        if (lEntry.puOffset < lDirectory || lEntry.puOffset > aLength || lEntry.puLength > aLength - lEntry.puOffset)
+            return false;
+        uint64_t lNeeded = bitmapBytes(rows());
+        if (lEntry.puKind == ACK_STRING)
+        {
+            lNeeded += (uint64_t(rows()) + 1) * sizeof(uint32_t);
+            if (lNeeded > lEntry.puLength)
+                return false;
+            uint32_t lChars;
+            std::memcpy(&lChars, lBase + lEntry.puOffset + lNeeded - sizeof(uint32_t), sizeof(lChars));
+            lNeeded += lChars;
+        }
+        else
+        {
+            const size_t lWidth = valueWidth(static_cast<ArchiveColumnKind>(lEntry.puKind));
+            if (lWidth == 0)
+                return false;
+            lNeeded += uint64_t(rows()) * lWidth;
+        }
+        if (lNeeded > lEntry.puLength)
+            return false;
+    }
+    return true;
+}
+
+ArchiveReader::~ArchiveReader()
+{
+    close();
+}
+
+MMMReaderErrorCode ArchiveReader::open(const std::string &aPath, std::string *aError)
+{
+    close();
+    const int lFd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    struct stat lStat;
+    void *lMapping = MAP_FAILED;
+    if (::fstat(lFd, &lStat) == 0 && lStat.st_size >= static_cast<off_t>(sizeof(ArchiveFileHeader)))
+        lMapping = ::mmap(nullptr, static_cast<size_t>(lStat.st_size), PROT_READ, MAP_SHARED, lFd, 0);
+    const int lErrno = errno;
+    ::close(lFd);
+    if (lMapping == MAP_FAILED)
+    {
+        *aError = "mapping " + aPath + ": " + (lErrno ? std::strerror(lErrno) : "file too short");
+        return ERROR_OS_ERROR;
+    }
+    prData = static_cast<const uint8_t *>(lMapping);
+    prSize = static_cast<size_t>(lStat.st_size);
+
+    const ArchiveFileHeader *lHeader = reinterpret_cast<const ArchiveFileHeader *>(prData);
+    if (lHeader->puMagic != kArchiveMagic || lHeader->puVersion != kArchiveVersion)
+    {
+        *aError = aPath + " is not a readerd archive";
+        close();
+        return ERROR_UNKNOWN_DATA_FORMAT;
+    }
+
+    uint64_t lOffset = sizeof(ArchiveFileHeader);
+    while (lOffset + sizeof(ArchiveChunkHeader) <= prSize)
+    {
+        const ArchiveChunkHeader *lChunk = reinterpret_cast<const ArchiveChunkHeader *>(prData + lOffset);
+        if (lChunk->puMagic != kArchiveChunkMagic || lChunk->puLength > prSize - lOffset - sizeof(*lChunk))
+            break;
+        if (lChunk->puType == AC_SEGMENT && lChunk->puLength >= sizeof(ArchiveSegmentHeader))
+        {
+            ArchiveSegment lSegment;
+            lSegment.prHeader = reinterpret_cast<const ArchiveSegmentHeader *>(lChunk + 1);
+            lSegment.prEntries = reinterpret_cast<const ArchiveColumnEntry *>(lSegment.prHeader + 1);
+            lSegment.prFile = prData;
+            lSegment.prFileSize = prSize;
+            if (lSegment.validate(lChunk->puLength))
+                prSegments.push_back(lSegment);
+        }
+        lOffset += sizeof(*lChunk) + lChunk->puLength;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+void ArchiveReader::close()
+{
+    if (prData != nullptr)
+        ::munmap(const_cast<uint8_t *>(prData), prSize);
+    prData = nullptr;
+    prSize = 0;
+    prSegments.clear();
+}
+
+uint64_t ArchiveReader::documents() const
+{
+    uint64_t lDocuments = 0;
+    for (const ArchiveSegment &lSegment : prSegments)
+        lDocuments += lSegment.rows();
+    return lDocuments;
+}
+
+} // namespace readerd
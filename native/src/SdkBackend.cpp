@@ -0,0 +1,130 @@
+#include "readerd/SdkBackend.h"
+
+#include "MMMReaderLowLevelAPI.h"
+
+#include <cstring>
+
+namespace readerd {
+
+SdkBackend::~SdkBackend()
+{
+    if (MMMReader_IsInitialised())
+        MMMReader_Shutdown();
+}
+
+MMMReaderErrorCode SdkBackend::initialise(
+    MMMReaderHLDataCallback aDataCallback,
+    MMMReaderEventCallback aEventCallback,
+    MMMReaderErrorCallback aErrorCallback,
+    MMMReaderCertificateCallback aCertCallback,
+    void *aParam)
+{
+    return MMMReader_Initialise(
+        aDataCallback, aEventCallback, aErrorCallback, aCertCallback, false, false, aParam);
+}
+
+MMMReaderErrorCode SdkBackend::shutdown()
+{
+    return MMMReader_Shutdown();
+}
+
+MMMReaderErrorCode SdkBackend::reset()
+{
+    return MMMReader_Reset();
+}
+
+ReaderState SdkBackend::getState()
+{
+    return MMMReader_GetState();
+}
+
+MMMReaderErrorCode SdkBackend::setState(ReaderState aNewState, bool aForceRedetect)
+{
+    return MMMReader_SetState(aNewState, aForceRedetect);
+}
+
+bool SdkBackend::isDocumentOnWindow()
+{
+    return MMMReader_IsDocumentOnWindow();
+}
+
+MMMReaderErrorCode SdkBackend::waitForDocumentOnWindow(int aTimeout)
+{
+    return MMMReader_WaitForDocumentOnWindow(aTimeout);
+}
+
+MMMReaderErrorCode SdkBackend::readDocument()
+{
+    return MMMReader_ReadDocument();
+}
+
+MMMReaderErrorCode SdkBackend::getData(
+    MMMReaderDataType aDataType,
+    void *aDataPtr,
+    int *aDataLen,
+    int aIndex)
+{
+    return MMMReader_GetData(aDataType, aDataPtr, aDataLen, aIndex);
+}
+
+MMMReaderErrorCode SdkBackend::getDataCount(MMMReaderDataType aDataType, int *aItemCount)
+{
+    return MMMReader_GetDataCount(aDataType, aItemCount);
+}
+
+MMMReaderErrorCode SdkBackend::clearData()
+{
+    return MMMReader_ClearData();
+}
+
+MMMReaderErrorCode SdkBackend::getConnectedScanners(std::vector<std::string> *aSerialNumbers)
+{
+    // The length is passed by value, so there is no size query: grow until the list fits.
+    std::vector<char> lBuffer(1024);
+    int lCount = 0;
+    MMMReaderErrorCode lResult;
+    while ((lResult = MMMReader_GetConnectedScanners(lBuffer.data(), static_cast<int>(lBuffer.size()), &lCount))
+           == ERROR_STRING_BUFFER_TOO_SMALL && lBuffer.size() < 1024 * 1024)
+        lBuffer.resize(lBuffer.size() * 4);
+    aSerialNumbers->clear();
+    if (lResult != NO_ERROR_OCCURRED || lCount == 0)
+        return lResult;
+
+    // Separated by ';'.
+    const std::string lList(lBuffer.data(), strnlen(lBuffer.data(), lBuffer.size()));
+    for (size_t lStart = 0; lStart <= lList.size();)
+    {
+        size_t lEnd = lList.find(';', lStart);
+        if (lEnd == std::string::npos)
+            lEnd = lList.size();
+        if (lEnd > lStart)
+            aSerialNumbers->push_back(lList.substr(lStart, lEnd - lStart));
+        lStart = lEnd + 1;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SdkBackend::selectScanner(const char *aSerialNumber)
+{
+    return MMMReader_SelectScanner(aSerialNumber);
+}
+
+MMMReaderErrorCode SdkBackend::loadSettings(MMMReaderSettings *aSettings, const char *aIniPath)
+{
+    if (aIniPath == nullptr)
+        return MMMReader_LL_LoadSettings(aSettings);
+    std::string lPath = aIniPath;
+    return MMMReader_LL_LoadSettingsFromIniFile(aSettings, lPath.data());
+}
+
+std::string SdkBackend::settingsVersion()
+{
+    return "ll-api-" + std::to_string(MMMReader_LL_GetAPIVersion());
+}
+
+MMMReaderErrorCode SdkBackend::loadAndProcessFromScanDirectory(const char *aDirectoryPath, bool aSendDataFlag)
+{
+    return MMMReader_LoadAndProcessFromScanDirectory(aDirectoryPath, aSendDataFlag);
+}
+
+} // namespace readerd
@@ -0,0 +1,155 @@
+#include "readerd/SdkRfChip.h"
+
+#include "MMMReaderLowLevelAPI.h"
+
+#include <string>
+
+namespace readerd {
+
+namespace {
+
+void onChipOpened(void *aParam, MMMReaderEventCode aEvent)
+{
+    *static_cast<MMMReaderEventCode *>(aParam) = aEvent;
+}
+
+void onFileData(void *aParam, int, MMMReaderDataFormat, int aDataLen, void *aDataPtr)
+{
+    std::vector<uint8_t> &lBytes = *static_cast<std::vector<uint8_t> *>(aParam);
+    const uint8_t *lData = static_cast<const uint8_t *>(aDataPtr);
+    if (lData != nullptr && aDataLen > 0)
+        lBytes.assign(lData, lData + aDataLen);
+}
+
+void onChipId(void *aParam, int, MMMReaderDataFormat, int, void *aDataPtr)
+{
+    if (aDataPtr != nullptr)
+        *static_cast<std::string *>(aParam) = static_cast<const char *>(aDataPtr);
+}
+
+void onInteger(void *aParam, int, MMMReaderDataFormat, int, void *aDataPtr)
+{
+    if (aDataPtr != nullptr)
+        *static_cast<int *>(aParam) = *static_cast<const int *>(aDataPtr);
+}
+
+void applyBlockSize(RFProcessSettings *aProcess, int aBytes)
+{
+    aProcess->puReadBinaryBufferSize = aBytes;
+    aProcess->puForceExtendedAPDU = aBytes > kMaxShortReadBlock;
+    aProcess->puReadBinaryUseEFATRIfPresent = false;
+}
+
+} // namespace
+
+SdkRfChip::SdkRfChip(std::unique_ptr<CertificateStore> aCertificates)
+    : prCertificates(std::move(aCertificates))
+{
+}
+
+SdkRfChip::~SdkRfChip()
+{
+    if (prInitialised)
+        MMMReader_RFShutdown();
+}
+
+MMMReaderErrorCode SdkRfChip::waitForOpen(const char *aBacKey, int aTimeoutMs)
+{
+    if (!prInitialised)
+    {
+        prSettings = std::make_unique<MMMReaderSettings>();
+        MMMReaderErrorCode lResult = MMMReader_LL_LoadSettings(prSettings.get());
+        RFProcessSettings &lProcess = prSettings->puRFIDSettings.puRFProcessSettings;
+        if (prBlockSize > 0)
+            applyBlockSize(&lProcess, prBlockSize);
+        if (prCertificates)
+        {
+            lProcess.puExternalDSCMode = ECM_CERT_CALLBACK;
+            lProcess.puExternalCSCMode = ECM_CERT_CALLBACK;
+        }
+        // The last argument reaches the certificate callback.
+        if (lResult == NO_ERROR_OCCURRED)
+            lResult = MMMReader_RFInitialise(&prSettings->puRFIDSettings, nullptr, nullptr, false, false,
+                                             prCertificates.get());
+        if (lResult == NO_ERROR_OCCURRED && prCertificates)
+            lResult = MMMReader_RFSetCertificateCallback(&CertificateStore::certificateCallback);
+        if (lResult != NO_ERROR_OCCURRED)
+            return lResult;
+        prInitialised = true;
+    }
+
+    // The outcome arrives as an event, before the blocking call returns.
+    const RFProcessSettings &lProcess = prSettings->puRFIDSettings.puRFProcessSettings;
+    std::string lKey = aBacKey != nullptr ? aBacKey : "";
+    MMMReaderEventCode lEvent = RF_CHIP_OPEN_FAILED;
+    const MMMReaderErrorCode lResult = MMMReader_RFWaitForOpen(
+        true, lKey.empty() ? nullptr : lKey.data(), lProcess.puAntennaMode, lProcess.puMaxAPDUAttempts,
+        lProcess.puDefaultChipBaudRate, lProcess.puSelectLDSApplication, aTimeoutMs, onChipOpened, &lEvent, nullptr, 0);
+    if (lResult != NO_ERROR_OCCURRED)
+        return lResult;
+    if (lEvent == RF_CHIP_OPEN_TIMEOUT)
+        return ERROR_TIMED_OUT;
+    if (lEvent != RF_CHIP_OPENED_SUCCESSFULLY && lEvent != RF_APPLICATION_OPENED_SUCCESSFULLY)
+        return ERROR_RF_BAC_FAILURE;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SdkRfChip::getFile(MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes)
+{
+    aBytes->clear();
+    const MMMReaderErrorCode lResult = MMMReader_RFGetFile(true, aItem, onFileData, aBytes, 0, nullptr);
+    if (lResult == NO_ERROR_OCCURRED && aBytes->empty())
+        return ERROR_RF_DG_NOT_PRESENT;
+    return lResult;
+}
+
+MMMReaderErrorCode SdkRfChip::powerOff()
+{
+    return MMMReader_RFPowerOff(true, nullptr, nullptr, nullptr);
+}
+
+MMMReaderErrorCode SdkRfChip::getChipId(std::string *aId)
+{
+    aId->clear();
+    return MMMReader_RFGetChipId(true, onChipId, aId, 0, nullptr);
+}
+
+MMMReaderErrorCode SdkRfChip::getTransferCounters(int *aApduMs, int *aBytesRead)
+{
+    *aApduMs = 0;
+    *aBytesRead = 0;
+    MMMReaderErrorCode lResult = MMMReader_RFGetChipApduTime(true, onInteger, aApduMs, 0, nullptr);
+    if (lResult == NO_ERROR_OCCURRED)
+        lResult = MMMReader_RFGetChipBytesRead(true, onInteger, aBytesRead, 0, nullptr);
+    return lResult;
+}
+
+MMMReaderErrorCode SdkRfChip::checkActiveAuthentication(int *aResult)
+{
+    *aResult = RFID_VC_NOT_PERFORMED;
+    return MMMReader_RFCheckActiveAuthentication(true, onInteger, aResult, 0, nullptr);
+}
+
+int SdkRfChip::readBlockSize() const
+{
+    if (prBlockSize > 0)
+        return prBlockSize;
+    if (prSettings)
+        return prSettings->puRFIDSettings.puRFProcessSettings.puReadBinaryBufferSize;
+    return kMaxShortReadBlock;
+}
+
+MMMReaderErrorCode SdkRfChip::setReadBlockSize(int aBytes)
+{
+    if (aBytes <= 0)
+        return ERROR_PARAMETER_INVALID;
+    prBlockSize = aBytes;
+    if (!prInitialised)
+        return NO_ERROR_OCCURRED;
+    // Only the certificate settings make the update reload anything, so this is cheap.
+    RFProcessSettings &lProcess = prSettings->puRFIDSettings.puRFProcessSettings;
+    applyBlockSize(&lProcess, aBytes);
+    return MMMReader_RFUpdateSettings(&lProcess);
+}
+
+} // namespace readerd
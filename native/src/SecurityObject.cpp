@@ -0,0 +1,349 @@
+#include "readerd/SecurityObject.h"
+
+#include "readerd/CertificateStore.h"
+#include "readerd/TlvReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef READERD_HAVE_OPENSSL
+#include <openssl/evp.h>
+#endif
+
+namespace readerd {
+
+namespace {
+
+// Contents of the object identifiers involved.
+const uint8_t kOidSha1[] = {0x2B, 0x0E, 0x03, 0x02, 0x1A};
+const uint8_t kOidSha224[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x04};
+const uint8_t kOidSha256[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x01};
+const uint8_t kOidSha384[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x02};
+const uint8_t kOidSha512[] = {0x60, 0x86, 0x48, 0x01, 0x65, 0x03, 0x04, 0x02, 0x03};
+const uint8_t kOidSignedData[] = {0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02};
+const uint8_t kOidLdsSecurityObject[] = {0x67, 0x81, 0x08, 0x01, 0x01, 0x01};
+const uint8_t kOidEcdsaWithSha256[] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x03, 0x02};
+
+constexpr uint32_t kTagEfCom = 0x60;
+constexpr uint32_t kTagEfSod = 0x77;
+constexpr uint32_t kTagTagList = 0x5C;
+
+// Data group tags, by data group number.
+const uint8_t kDataGroupTags[kMaxDataGroup + 1] = {
+    0, 0x61, 0x75, 0x63, 0x76, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6A, 0x6B, 0x6C, 0x6D, 0x6E, 0x6F, 0x70};
+
+struct OidName
+{
+    DigestAlgorithm puAlgorithm;
+    std::span<const uint8_t> puOid;
+};
+
+const OidName kDigestOids[] = {
+    {DA_SHA1, kOidSha1},     {DA_SHA224, kOidSha224}, {DA_SHA256, kOidSha256},
+    {DA_SHA384, kOidSha384}, {DA_SHA512, kOidSha512},
+};
+
+void appendTlv(std::vector<uint8_t> *aOut, uint32_t aTag, std::span<const uint8_t> aContent)
+{
+    if (aTag > 0xFF)
+        aOut->push_back(static_cast<uint8_t>(aTag >> 8));
+    aOut->push_back(static_cast<uint8_t>(aTag));
+    const size_t lLength = aContent.size();
+    if (lLength < 0x80)
+        aOut->push_back(static_cast<uint8_t>(lLength));
+    else if (lLength <= 0xFF)
+        aOut->insert(aOut->end(), {0x81, static_cast<uint8_t>(lLength)});
+    else if (lLength <= 0xFFFF)
+        aOut->insert(aOut->end(), {0x82, static_cast<uint8_t>(lLength >> 8), static_cast<uint8_t>(lLength)});
+    else
+        aOut->insert(aOut->end(), {0x83, static_cast<uint8_t>(lLength >> 16), static_cast<uint8_t>(lLength >> 8),
+                                   static_cast<uint8_t>(lLength)});
+    aOut->insert(aOut->end(), aContent.begin(), aContent.end());
+}
+
+std::vector<uint8_t> tlv(uint32_t aTag, std::span<const uint8_t> aContent)
+{
+    std::vector<uint8_t> lOut;
+    appendTlv(&lOut, aTag, aContent);
+    return lOut;
+}
+
+std::vector<uint8_t> smallInteger(int aValue)
+{
+    const uint8_t lValue = static_cast<uint8_t>(aValue);
+    return tlv(kTagInteger, std::span<const uint8_t>(&lValue, 1));
+}
+
+// The issuer and serial number of the first SignerInfo { version, sid, ... } in
+// aSignerInfos, where sid ::= CHOICE { IssuerAndSerialNumber, [0] SubjectKeyIdentifier }.
+void findSigner(std::span<const uint8_t> aCertificates, std::span<const uint8_t> aSignerInfos,
+                SecurityObject *aObject)
+{
+    std::span<const uint8_t> lSignerInfo, lIgnored, lSid, lIssuer, lSerial;
+    TlvReader lInfos(aSignerInfos);
+    if (!lInfos.expect(kTagSequence, &lSignerInfo))
+        return;
+    TlvReader lInfo(lSignerInfo);
+    uint32_t lTag = 0;
+    if (!lInfo.expect(kTagInteger, &lIgnored) || !lInfo.next(&lTag, &lSid))
+        return;
+    if (lTag == kTagSequence)
+    {
+        TlvReader lFields(lSid);
+        if (!lFields.expect(kTagSequence, &lIgnored, &lIssuer) || !lFields.expect(kTagInteger, &lSerial))
+            return;
+    }
+    else if (lTag == kTagImplicit0)
+    {
+        TlvReader lCertificateReader(aCertificates);
+        std::span<const uint8_t> lElement;
+        CertificateFields lFields;
+        while (lIssuer.empty() && lCertificateReader.next(&lTag, &lIgnored, &lElement))
+        {
+            if (parseCertificate(lElement, &lFields) && equal(lFields.puKeyId, lSid))
+            {
+                lIssuer = lFields.puIssuer;
+                lSerial = lFields.puSerial;
+            }
+        }
+    }
+    aObject->puSignerIssuer.assign(lIssuer.begin(), lIssuer.end());
+    aObject->puSignerSerial.assign(lSerial.begin(), lSerial.end());
+}
+
+} // namespace
+
+const char *digestAlgorithmName(DigestAlgorithm aAlgorithm)
+{
+    switch (aAlgorithm)
+    {
+    case DA_SHA1:
+        return "SHA-1";
+    case DA_SHA224:
+        return "SHA-224";
+    case DA_SHA256:
+        return "SHA-256";
+    case DA_SHA384:
+        return "SHA-384";
+    case DA_SHA512:
+        return "SHA-512";
+    default:
+        return "none";
+    }
+}
+
+bool digestSupported()
+{
+#ifdef READERD_HAVE_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool computeDigest(DigestAlgorithm aAlgorithm, std::span<const uint8_t> aData, std::vector<uint8_t> *aDigest)
+{
+#ifdef READERD_HAVE_OPENSSL
+    const EVP_MD *lMd = nullptr;
+    switch (aAlgorithm)
+    {
+    case DA_SHA1:
+        lMd = EVP_sha1();
+        break;
+    case DA_SHA224:
+        lMd = EVP_sha224();
+        break;
+    case DA_SHA256:
+        lMd = EVP_sha256();
+        break;
+    case DA_SHA384:
+        lMd = EVP_sha384();
+        break;
+    case DA_SHA512:
+        lMd = EVP_sha512();
+        break;
+    default:
+        return false;
+    }
+    unsigned int lLength = EVP_MAX_MD_SIZE;
+    aDigest->resize(lLength);
+    if (EVP_Digest(aData.data(), aData.size(), aDigest->data(), &lLength, lMd, nullptr) != 1)
+        return false;
+    aDigest->resize(lLength);
+    return true;
+#else
+    (void)aAlgorithm;
+    (void)aData;
+    aDigest->clear();
+    return false;
+#endif
+}
+
+bool parseEfSod(std::span<const uint8_t> aEfSod, SecurityObject *aObject)
+{
+    *aObject = SecurityObject();
+    std::span<const uint8_t> lContentInfo, lOid, lExplicit, lSignedData, lIgnored, lEncap, lEContent, lLds;
+
+    // EF.SOD: ContentInfo { signedData, [0] SignedData { version, digestAlgorithms,
+    // encapContentInfo { ldsSecurityObject, [0] OCTET STRING }, ... } }.
+    TlvReader lFile(aEfSod);
+    if (!lFile.expect(kTagEfSod, &lContentInfo))
+        return false;
+    TlvReader lInfo(lContentInfo);
+    if (!lInfo.expect(kTagSequence, &lContentInfo))
+        return false;
+    lInfo = TlvReader(lContentInfo);
+    if (!lInfo.expect(kTagOid, &lOid) || !equal(lOid, kOidSignedData) || !lInfo.expect(kTagContext0, &lExplicit))
+        return false;
+    TlvReader lSigned(lExplicit);
+    if (!lSigned.expect(kTagSequence, &lSignedData))
+        return false;
+    lSigned = TlvReader(lSignedData);
+    if (!lSigned.expect(kTagInteger, &lIgnored) || !lSigned.expect(kTagSet, &lIgnored)
+        || !lSigned.expect(kTagSequence, &lEncap))
+        return false;
+    TlvReader lEncapReader(lEncap);
+    if (!lEncapReader.expect(kTagOid, &lOid) || !equal(lOid, kOidLdsSecurityObject)
+        || !lEncapReader.expect(kTagContext0, &lExplicit))
+        return false;
+    TlvReader lOctets(lExplicit);
+    if (!lOctets.expect(kTagOctetString, &lEContent))
+        return false;
+    std::span<const uint8_t> lCertificates, lSignerInfos;
+    lSigned.optional(kTagContext0, &lCertificates);
+    lSigned.optional(kTagContext1, &lIgnored);
+    if (lSigned.expect(kTagSet, &lSignerInfos))
+        findSigner(lCertificates, lSignerInfos, aObject);
+
+    // LDSSecurityObject { version, hashAlgorithm { algorithm, parameters }, dataGroupHashValues
+    // SEQUENCE OF { dataGroupNumber, dataGroupHashValue } }.
+    TlvReader lObjectReader(lEContent);
+    if (!lObjectReader.expect(kTagSequence, &lLds))
+        return false;
+    TlvReader lFields(lLds);
+    std::span<const uint8_t> lAlgorithm, lHashes;
+    if (!lFields.expect(kTagInteger, &lIgnored) || !lFields.expect(kTagSequence, &lAlgorithm)
+        || !lFields.expect(kTagSequence, &lHashes))
+        return false;
+    TlvReader lAlgorithmReader(lAlgorithm);
+    if (!lAlgorithmReader.expect(kTagOid, &lOid))
+        return false;
+    for (const OidName &lName : kDigestOids)
+    {
+        if (equal(lOid, lName.puOid))
+            aObject->puAlgorithm = lName.puAlgorithm;
+    }
+
+    TlvReader lHashReader(lHashes);
+    while (!lHashReader.atEnd())
+    {
+        std::span<const uint8_t> lEntry, lNumber, lDigest;
+        if (!lHashReader.expect(kTagSequence, &lEntry))
+            return false;
+        TlvReader lEntryReader(lEntry);
+        if (!lEntryReader.expect(kTagInteger, &lNumber) || !lEntryReader.expect(kTagOctetString, &lDigest)
+            || lNumber.size() != 1 || lNumber[0] < 1 || lNumber[0] > kMaxDataGroup)
+            return false;
+        aObject->puDigests[lNumber[0]].assign(lDigest.begin(), lDigest.end());
+    }
+    return true;
+}
+
+std::vector<uint8_t> buildEfSod(const SecurityObject &aObject, std::span<const uint8_t> aSigner)
+{
+    std::span<const uint8_t> lAlgorithmOid = kOidSha256;
+    for (const OidName &lName : kDigestOids)
+    {
+        if (lName.puAlgorithm == aObject.puAlgorithm)
+            lAlgorithmOid = lName.puOid;
+    }
+    const std::vector<uint8_t> lAlgorithm = tlv(kTagSequence, tlv(kTagOid, lAlgorithmOid));
+
+    std::vector<uint8_t> lHashes;
+    for (int lGroup = 1; lGroup <= kMaxDataGroup; ++lGroup)
+    {
+        if (aObject.puDigests[lGroup].empty())
+            continue;
+        std::vector<uint8_t> lEntry = smallInteger(lGroup);
+        appendTlv(&lEntry, kTagOctetString, aObject.puDigests[lGroup]);
+        appendTlv(&lHashes, kTagSequence, lEntry);
+    }
+    std::vector<uint8_t> lLds = smallInteger(0);
+    lLds.insert(lLds.end(), lAlgorithm.begin(), lAlgorithm.end());
+    appendTlv(&lLds, kTagSequence, lHashes);
+
+    std::vector<uint8_t> lEncap = tlv(kTagOid, kOidLdsSecurityObject);
+    appendTlv(&lEncap, kTagContext0, tlv(kTagOctetString, tlv(kTagSequence, lLds)));
+
+    std::vector<uint8_t> lSignedData = smallInteger(3);
+    appendTlv(&lSignedData, kTagSet, lAlgorithm);
+    appendTlv(&lSignedData, kTagSequence, lEncap);
+    CertificateFields lSigner;
+    if (!aSigner.empty() && parseCertificate(aSigner, &lSigner))
+    {
+        // SignerInfo { version, sid, digestAlgorithm, signatureAlgorithm, signature }.
+        std::vector<uint8_t> lSid(lSigner.puIssuer.begin(), lSigner.puIssuer.end());
+        appendTlv(&lSid, kTagInteger, lSigner.puSerial);
+        std::vector<uint8_t> lSignerInfo = smallInteger(1);
+        appendTlv(&lSignerInfo, kTagSequence, lSid);
+        lSignerInfo.insert(lSignerInfo.end(), lAlgorithm.begin(), lAlgorithm.end());
+        appendTlv(&lSignerInfo, kTagSequence, tlv(kTagOid, kOidEcdsaWithSha256));
+        appendTlv(&lSignerInfo, kTagOctetString, std::span<const uint8_t>());
+        appendTlv(&lSignedData, kTagContext0, lSigner.puDer);
+        appendTlv(&lSignedData, kTagSet, tlv(kTagSequence, lSignerInfo));
+    }
+    else
+    {
+        appendTlv(&lSignedData, kTagSet, std::span<const uint8_t>());
+    }
+
+    std::vector<uint8_t> lContentInfo = tlv(kTagOid, kOidSignedData);
+    appendTlv(&lContentInfo, kTagContext0, tlv(kTagSequence, lSignedData));
+    return tlv(kTagEfSod, tlv(kTagSequence, lContentInfo));
+}
+
+bool parseEfCom(std::span<const uint8_t> aEfCom, std::vector<int> *aDataGroups)
+{
+    aDataGroups->clear();
+    std::span<const uint8_t> lContent;
+    TlvReader lFile(aEfCom);
+    if (!lFile.expect(kTagEfCom, &lContent))
+        return false;
+    TlvReader lFields(lContent);
+    uint32_t lTag = 0;
+    std::span<const uint8_t> lValue;
+    while (lFields.next(&lTag, &lValue))
+    {
+        if (lTag != kTagTagList)
+            continue;
+        for (uint8_t lGroupTag : lValue)
+        {
+            const uint8_t *lFound = std::find(std::begin(kDataGroupTags) + 1, std::end(kDataGroupTags), lGroupTag);
+            if (lFound != std::end(kDataGroupTags))
+                aDataGroups->push_back(static_cast<int>(lFound - std::begin(kDataGroupTags)));
+        }
+        return true;
+    }
+    return false;
+}
+
+std::vector<uint8_t> buildEfCom(const std::vector<int> &aDataGroups)
+{
+    static const uint8_t kLdsVersion[] = {'0', '1', '0', '7'};
+    static const uint8_t kUnicodeVersion[] = {'0', '4', '0', '0', '0', '0'};
+    std::vector<uint8_t> lTags;
+    for (int lGroup : aDataGroups)
+        lTags.push_back(dataGroupTag(lGroup));
+
+    std::vector<uint8_t> lContent = tlv(0x5F01, kLdsVersion);
+    appendTlv(&lContent, 0x5F36, kUnicodeVersion);
+    appendTlv(&lContent, kTagTagList, lTags);
+    return tlv(kTagEfCom, lContent);
+}
+
+uint8_t dataGroupTag(int aDataGroup)
+{
+    return aDataGroup >= 1 && aDataGroup <= kMaxDataGroup ? kDataGroupTags[aDataGroup] : 0;
+}
+
+} // namespace readerd
@@ -0,0 +1,277 @@
+#include "readerd/SettingsSnapshot.h"
+
+#include "readerd/Fnv.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace readerd {
+
+namespace {
+
+bool isIniFile(const std::filesystem::path &aPath)
+{
+    std::string lExtension = aPath.extension().string();
+    std::transform(lExtension.begin(), lExtension.end(), lExtension.begin(),
+                   [](unsigned char aChar) { return static_cast<char>(std::tolower(aChar)); });
+    return lExtension == ".ini";
+}
+
+// Folds the path, size and contents of aPath into aHash.
+bool hashFile(const std::string &aPath, uint64_t *aHash, std::string *aError)
+{
+    const int lFd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return false;
+    }
+    uint64_t lHash = fnv1a(aPath.data(), aPath.size() + 1, *aHash);
+    uint64_t lSize = 0;
+    uint8_t lBuffer[16384];
+    ssize_t lRead;
+    while ((lRead = ::read(lFd, lBuffer, sizeof(lBuffer))) != 0)
+    {
+        if (lRead < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            *aError = "read " + aPath + ": " + std::strerror(errno);
+            ::close(lFd);
+            return false;
+        }
+        lHash = fnv1a(lBuffer, static_cast<size_t>(lRead), lHash);
+        lSize += static_cast<uint64_t>(lRead);
+    }
+    ::close(lFd);
+    *aHash = fnv1a(&lSize, sizeof(lSize), lHash);
+    return true;
+}
+
+} // namespace
+
+MMMReaderErrorCode settingsKey(const MMMReaderSettings &aSettings, const SettingsSource &aSource,
+                               const std::string &aSdkVersion, SettingsKey *aKey, std::string *aError)
+{
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> lFiles;
+    if (!aSource.puIniPath.empty())
+        lFiles.push_back(aSource.puIniPath);
+    else if (aSettings.puBinDir != nullptr)
+        lFiles.push_back((fs::path(aSettings.puBinDir) / "MMMReader.ini").string());
+
+    std::vector<std::string> lDirectories = aSource.puWatchDirectories;
+    if (aSettings.puCfgDir != nullptr)
+        lDirectories.insert(lDirectories.begin(), aSettings.puCfgDir);
+    for (const std::string &lDirectory : lDirectories)
+    {
+        // Not recursive: plugins keep their settings in the Config folder too. A folder that
+        // does not exist holds no settings.
+        std::vector<std::string> lIniFiles;
+        std::error_code lError;
+        for (fs::directory_iterator lDir(lDirectory, lError), lEnd; !lError && lDir != lEnd; lDir.increment(lError))
+        {
+            if (lDir->is_regular_file() && isIniFile(lDir->path()))
+                lIniFiles.push_back(lDir->path().string());
+        }
+        std::sort(lIniFiles.begin(), lIniFiles.end());
+        lFiles.insert(lFiles.end(), lIniFiles.begin(), lIniFiles.end());
+    }
+
+    *aKey = SettingsKey();
+    uint64_t lHash = kFnvOffset;
+    for (const std::string &lFile : lFiles)
+    {
+        if (!hashFile(lFile, &lHash, aError))
+            return ERROR_READING_FILE;
+    }
+    aKey->puFilesHash = lHash;
+    aKey->puFiles = static_cast<uint32_t>(lFiles.size());
+    std::strncpy(aKey->puSdkVersion, aSdkVersion.c_str(), sizeof(aKey->puSdkVersion) - 1);
+    return NO_ERROR_OCCURRED;
+}
+
+SettingsSnapshot::~SettingsSnapshot()
+{
+    close();
+}
+
+MMMReaderErrorCode SettingsSnapshot::write(const MMMReaderSettings &aSettings, const SettingsKey &aKey,
+                                           const std::string &aPath, std::string *aError)
+{
+    SettingsSnapshotHeader lHeader{};
+    lHeader.puMagic = kSettingsSnapshotMagic;
+    lHeader.puVersion = kSettingsSnapshotVersion;
+    lHeader.puSettingsSize = sizeof(MMMReaderSettings);
+    lHeader.puFiles = aKey.puFiles;
+    lHeader.puFilesHash = aKey.puFilesHash;
+    std::memcpy(lHeader.puSdkVersion, aKey.puSdkVersion, sizeof(lHeader.puSdkVersion));
+
+    std::vector<uint8_t> lFile(kSettingsSnapshotBody + sizeof(MMMReaderSettings));
+    MMMReaderSettings lSettings = aSettings;
+    std::string lNames;
+    for (size_t i = 0; i < std::size(kSettingsDirectories); ++i)
+    {
+        const RTCHAR *lDirectory = lSettings.*kSettingsDirectories[i];
+        lHeader.puDirectories[i] = lDirectory != nullptr ? static_cast<uint32_t>(lNames.size()) : kNoSettingsDirectory;
+        if (lDirectory != nullptr)
+            lNames.append(lDirectory, std::strlen(lDirectory) + 1);
+        lSettings.*kSettingsDirectories[i] = nullptr;
+    }
+    std::memcpy(lFile.data() + kSettingsSnapshotBody, &lSettings, sizeof(lSettings));
+    lFile.insert(lFile.end(), lNames.begin(), lNames.end());
+    lHeader.puLength = lFile.size();
+    lHeader.puChecksum = fnv1a(lFile.data() + sizeof(lHeader), lFile.size() - sizeof(lHeader));
+
+    // Written beside the old snapshot and renamed over it, so that a reader sees one or the
+    // other. The magic goes in last.
+    const std::string lTemporary = aPath + ".tmp" + std::to_string(::getpid());
+    const int lFd = ::open(lTemporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (lFd < 0)
+    {
+        *aError = "open " + lTemporary + ": " + std::strerror(errno);
+        return ERROR_WRITING_FILE;
+    }
+    const uint32_t lMagic = lHeader.puMagic;
+    lHeader.puMagic = 0;
+    std::memcpy(lFile.data(), &lHeader, sizeof(lHeader));
+    bool lWritten = ::pwrite(lFd, lFile.data(), lFile.size(), 0) == static_cast<ssize_t>(lFile.size())
+        && ::fsync(lFd) == 0
+        && ::pwrite(lFd, &lMagic, sizeof(lMagic), 0) == static_cast<ssize_t>(sizeof(lMagic));
+    const int lErrno = errno;
+    ::close(lFd);
+    lWritten = lWritten && ::rename(lTemporary.c_str(), aPath.c_str()) == 0;
+    if (!lWritten)
+    {
+        *aError = "write " + aPath + ": " + std::strerror(lErrno ? lErrno : errno);
+        ::unlink(lTemporary.c_str());
+        return ERROR_WRITING_FILE;
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SettingsSnapshot::open(const std::string &aPath, std::string *aError)
+{
+    close();
+    const int lFd = ::open(aPath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (lFd < 0)
+    {
+        *aError = "open " + aPath + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    // Private and writable, so that the directory members can be fixed up in place.
+    struct stat lStat;
+    void *lMapping = MAP_FAILED;
+    const bool lLongEnough = ::fstat(lFd, &lStat) == 0
+        && lStat.st_size >= static_cast<off_t>(kSettingsSnapshotBody + sizeof(MMMReaderSettings));
+    if (lLongEnough)
+        lMapping = ::mmap(nullptr, static_cast<size_t>(lStat.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, lFd, 0);
+    const int lErrno = errno;
+    ::close(lFd);
+    if (!lLongEnough)
+    {
+        *aError = aPath + " is not a readerd settings snapshot";
+        return ERROR_UNKNOWN_DATA_FORMAT;
+    }
+    if (lMapping == MAP_FAILED)
+    {
+        *aError = "mapping " + aPath + ": " + std::strerror(lErrno);
+        return ERROR_OS_ERROR;
+    }
+    prData = static_cast<uint8_t *>(lMapping);
+    prSize = static_cast<size_t>(lStat.st_size);
+
+    const SettingsSnapshotHeader &lHeader = *reinterpret_cast<const SettingsSnapshotHeader *>(prData);
+    bool lValid = lHeader.puMagic == kSettingsSnapshotMagic && lHeader.puVersion == kSettingsSnapshotVersion
+        && lHeader.puSettingsSize == sizeof(MMMReaderSettings) && lHeader.puLength == prSize
+        && lHeader.puChecksum == fnv1a(prData + sizeof(lHeader), prSize - sizeof(lHeader));
+
+    // The names must end inside the file; the checksum does not prove they were written so.
+    MMMReaderSettings *lSettings = reinterpret_cast<MMMReaderSettings *>(prData + kSettingsSnapshotBody);
+    char *lNames = reinterpret_cast<char *>(prData + kSettingsSnapshotBody + sizeof(MMMReaderSettings));
+    const size_t lNameBytes = prSize - kSettingsSnapshotBody - sizeof(MMMReaderSettings);
+    for (size_t i = 0; lValid && i < std::size(kSettingsDirectories); ++i)
+    {
+        const uint32_t lOffset = lHeader.puDirectories[i];
+        if (lOffset == kNoSettingsDirectory)
+            continue;
+        lValid = lOffset < lNameBytes && std::memchr(lNames + lOffset, '\0', lNameBytes - lOffset) != nullptr;
+        if (lValid)
+            lSettings->*kSettingsDirectories[i] = lNames + lOffset;
+    }
+    if (!lValid)
+    {
+        *aError = aPath + " is not a readerd settings snapshot";
+        close();
+        return ERROR_UNKNOWN_DATA_FORMAT;
+    }
+    prSettings = lSettings;
+    return NO_ERROR_OCCURRED;
+}
+
+void SettingsSnapshot::close()
+{
+    if (prData != nullptr)
+        ::munmap(prData, prSize);
+    prData = nullptr;
+    prSize = 0;
+    prSettings = nullptr;
+}
+
+bool SettingsSnapshot::matches(const SettingsKey &aKey) const
+{
+    if (prData == nullptr)
+        return false;
+    const SettingsSnapshotHeader &lHeader = *reinterpret_cast<const SettingsSnapshotHeader *>(prData);
+    return lHeader.puFiles == aKey.puFiles && lHeader.puFilesHash == aKey.puFilesHash
+        && std::memcmp(lHeader.puSdkVersion, aKey.puSdkVersion, sizeof(lHeader.puSdkVersion)) == 0;
+}
+
+MMMReaderErrorCode loadSettingsCached(ReaderBackend &aBackend, const SettingsSource &aSource,
+                                      SettingsSnapshot *aSnapshot, MMMReaderSettings *aSettings,
+                                      SettingsLoadResult *aResult)
+{
+    *aResult = SettingsLoadResult();
+    const std::string lVersion = aBackend.settingsVersion();
+
+    // The snapshot names the folders the key is taken over, so it is opened first; if any of
+    // the files in them has changed since, the key no longer matches.
+    std::string lError;
+    SettingsKey lKey;
+    if (aSnapshot->open(aSource.puSnapshotPath, &lError) != NO_ERROR_OCCURRED)
+        aResult->puMissReason = lError;
+    else if (settingsKey(aSnapshot->settings(), aSource, lVersion, &lKey, &lError) != NO_ERROR_OCCURRED)
+        aResult->puMissReason = lError;
+    else if (!aSnapshot->matches(lKey))
+        aResult->puMissReason = "the configuration files or the SDK have changed";
+    else
+    {
+        std::memcpy(static_cast<void *>(aSettings), &aSnapshot->settings(), sizeof(*aSettings));
+        aResult->puFromSnapshot = true;
+        return NO_ERROR_OCCURRED;
+    }
+    aSnapshot->close();
+
+    const MMMReaderErrorCode lResult
+        = aBackend.loadSettings(aSettings, aSource.puIniPath.empty() ? nullptr : aSource.puIniPath.c_str());
+    if (lResult != NO_ERROR_OCCURRED)
+        return lResult;
+
+    if (settingsKey(*aSettings, aSource, lVersion, &lKey, &lError) != NO_ERROR_OCCURRED
+        || SettingsSnapshot::write(*aSettings, lKey, aSource.puSnapshotPath, &lError) != NO_ERROR_OCCURRED)
+        std::fprintf(stderr, "readerd: settings snapshot not saved: %s\n", lError.c_str());
+    else
+        aResult->puSnapshotWritten = true;
+    return NO_ERROR_OCCURRED;
+}
+
+} // namespace readerd
@@ -0,0 +1,337 @@
+#include "readerd/SharedRing.h"
+
+#include "readerd/ResultServer.h"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace readerd {
+
+namespace {
+
+const uint32_t kRingMagic = 0x52534452;     // "RDSR"
+const uint32_t kRingVersion = 1;
+const uint32_t kPadKind = 0;
+
+// Records start on 8-byte boundaries; the data area starts on its own cache line.
+constexpr size_t kRecordAlignment = 8;
+constexpr size_t kDataOffset = (sizeof(SharedRingHeader) + 63) & ~size_t(63);
+
+size_t alignUp(size_t aValue)
+{
+    return (aValue + kRecordAlignment - 1) & ~(kRecordAlignment - 1);
+}
+
+// Shared (not FUTEX_PRIVATE) operations, since the word lives in memory mapped by two
+// processes.
+void futexWait(std::atomic<uint32_t> *aWord, uint32_t aExpected, std::chrono::milliseconds aTimeout)
+{
+    timespec lTimeout;
+    lTimeout.tv_sec = static_cast<time_t>(aTimeout.count() / 1000);
+    lTimeout.tv_nsec = static_cast<long>(aTimeout.count() % 1000) * 1000000L;
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(aWord), FUTEX_WAIT, aExpected, &lTimeout, nullptr, 0);
+}
+
+void futexWakeAll(std::atomic<uint32_t> *aWord)
+{
+    ::syscall(SYS_futex, reinterpret_cast<uint32_t *>(aWord), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+} // namespace
+
+SharedRingWriter::~SharedRingWriter()
+{
+    close();
+}
+
+MMMReaderErrorCode SharedRingWriter::create(const std::string &aName, size_t aCapacity, std::string *aError)
+{
+    close();
+    const size_t lCapacity = alignUp(aCapacity);
+    if (lCapacity < 2 * sizeof(RecordHeader))
+    {
+        *aError = "shared ring too small";
+        return ERROR_PARAMETER_INVALID;
+    }
+
+    // A ring left behind by a daemon that crashed is replaced, not reused.
+    ::shm_unlink(aName.c_str());
+    const int lFd = ::shm_open(aName.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (lFd < 0)
+    {
+        *aError = "shm_open " + aName + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    const size_t lBytes = kDataOffset + lCapacity;
+    void *lMapping = MAP_FAILED;
+    if (::ftruncate(lFd, static_cast<off_t>(lBytes)) == 0)
+        lMapping = ::mmap(nullptr, lBytes, PROT_READ | PROT_WRITE, MAP_SHARED, lFd, 0);
+    const int lErrno = errno;
+    ::close(lFd);
+    if (lMapping == MAP_FAILED)
+    {
+        *aError = "mapping " + aName + ": " + std::strerror(lErrno);
+        ::shm_unlink(aName.c_str());
+        return ERROR_OS_ERROR;
+    }
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prName = aName;
+    prMappedBytes = lBytes;
+    prHeader = new (lMapping) SharedRingHeader();
+    prData = static_cast<uint8_t *>(lMapping) + kDataOffset;
+    prHeader->puCapacity = lCapacity;
+    prHeader->puVersion = kRingVersion;
+    prHeader->puHead.store(0);
+    prHeader->puTail.store(0);
+    prHeader->puSequence.store(0);
+    prHeader->puWaiters.store(0);
+    prHeader->puClosed.store(0);
+    prHeader->puReaderPid.store(0);
+    // Readers check the magic last.
+    std::atomic_thread_fence(std::memory_order_release);
+    prHeader->puMagic = kRingMagic;
+    return NO_ERROR_OCCURRED;
+}
+
+void SharedRingWriter::close()
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    if (prHeader == nullptr)
+        return;
+    prHeader->puClosed.store(1);
+    prHeader->puSequence.fetch_add(1);
+    futexWakeAll(&prHeader->puSequence);
+    ::munmap(prHeader, prMappedBytes);
+    ::shm_unlink(prName.c_str());
+    prHeader = nullptr;
+    prData = nullptr;
+    prInDocument = false;
+}
+
+SharedRingWriter::Stats SharedRingWriter::stats() const
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    return prStats;
+}
+
+void SharedRingWriter::onData(const DataItem &aItem)
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    if (prInDocument)
+        write(RK_DATA, static_cast<uint32_t>(aItem.type()), aItem.document(), aItem.bytes());
+}
+
+void SharedRingWriter::onError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg, uint32_t aDocument)
+{
+    const char *lText = aErrorMsg ? aErrorMsg : "";
+    std::lock_guard<std::mutex> lLock(prMutex);
+    if (prInDocument)
+        write(RK_ERROR, static_cast<uint32_t>(aErrorCode), aDocument,
+              std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(lText), std::strlen(lText)));
+}
+
+void SharedRingWriter::onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument)
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    if (prHeader == nullptr)
+        return;
+    if (aEventCode == START_OF_DOCUMENT_DATA)
+    {
+        // Anything written since the last commit belongs to a document that never ended.
+        prReserve = prHeader->puHead.load(std::memory_order_relaxed);
+        prInDocument = prHeader->puReaderPid.load(std::memory_order_acquire) != 0;
+    }
+    if (!prInDocument)
+        return;
+
+    write(RK_EVENT, static_cast<uint32_t>(aEventCode), aDocument, {});
+    if (aEventCode == END_OF_DOCUMENT_DATA && prInDocument)
+    {
+        prStats.puBytes += prReserve - prHeader->puHead.load(std::memory_order_relaxed);
+        ++prStats.puDocuments;
+        prInDocument = false;
+        prHeader->puHead.store(prReserve, std::memory_order_release);
+        prHeader->puSequence.fetch_add(1, std::memory_order_seq_cst);
+        if (prHeader->puWaiters.load(std::memory_order_seq_cst) != 0)
+            futexWakeAll(&prHeader->puSequence);
+    }
+}
+
+void SharedRingWriter::write(uint32_t aKind, uint32_t aCode, uint32_t aDocument, std::span<const uint8_t> aPayload)
+{
+    const uint64_t lCapacity = prHeader->puCapacity;
+    const size_t lSize = alignUp(sizeof(RecordHeader) + aPayload.size());
+    uint64_t lPosition = prReserve;
+    uint64_t lOffset = lPosition % lCapacity;
+    const uint64_t lPadding = lCapacity - lOffset < lSize ? lCapacity - lOffset : 0;
+
+    if (lPadding + lSize > lCapacity - (lPosition - prHeader->puTail.load(std::memory_order_acquire)))
+    {
+        prInDocument = false;
+        if (readerGone())
+            return;
+        // The reader is too far behind (or the item is larger than the ring): drop the
+        // document rather than wait.
+        ++prStats.puDropped;
+        return;
+    }
+
+    if (lPadding != 0)
+    {
+        if (lPadding >= sizeof(RecordHeader))
+        {
+            const RecordHeader lPad{kPadKind, 0, aDocument, static_cast<uint32_t>(lPadding - sizeof(RecordHeader))};
+            std::memcpy(prData + lOffset, &lPad, sizeof(lPad));
+        }
+        lPosition += lPadding;
+        lOffset = 0;
+    }
+
+    const RecordHeader lHeader{aKind, aCode, aDocument, static_cast<uint32_t>(aPayload.size())};
+    std::memcpy(prData + lOffset, &lHeader, sizeof(lHeader));
+    if (!aPayload.empty())
+        std::memcpy(prData + lOffset + sizeof(lHeader), aPayload.data(), aPayload.size());
+    prReserve = lPosition + lSize;
+}
+
+bool SharedRingWriter::readerGone()
+{
+    // A reader that was killed never clears its pid, and its tail would hold the ring full
+    // for good. Checked only when the ring is full, so a live reader costs nothing.
+    uint32_t lPid = prHeader->puReaderPid.load(std::memory_order_acquire);
+    if (lPid == 0 || ::kill(static_cast<pid_t>(lPid), 0) == 0 || errno != ESRCH)
+        return false;
+    // A reader attaching now stores its pid after its tail, so it either wins here or finds
+    // the tail already at the head.
+    if (prHeader->puReaderPid.compare_exchange_strong(lPid, 0, std::memory_order_acq_rel))
+    {
+        prHeader->puTail.store(prHeader->puHead.load(std::memory_order_relaxed), std::memory_order_release);
+        std::fprintf(stderr, "readerd: shared ring reader %u exited without detaching\n", lPid);
+    }
+    return true;
+}
+
+SharedRingReader::~SharedRingReader()
+{
+    close();
+}
+
+MMMReaderErrorCode SharedRingReader::open(const std::string &aName, std::string *aError)
+{
+    close();
+    const int lFd = ::shm_open(aName.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (lFd < 0)
+    {
+        *aError = "shm_open " + aName + ": " + std::strerror(errno);
+        return ERROR_OS_ERROR;
+    }
+    struct stat lStat;
+    void *lMapping = MAP_FAILED;
+    if (::fstat(lFd, &lStat) == 0 && static_cast<size_t>(lStat.st_size) > kDataOffset)
+        lMapping = ::mmap(nullptr, static_cast<size_t>(lStat.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, lFd, 0);
+    ::close(lFd);
+    if (lMapping == MAP_FAILED)
+    {
+        *aError = "cannot map " + aName;
+        return ERROR_OS_ERROR;
+    }
+
+    SharedRingHeader *lHeader = static_cast<SharedRingHeader *>(lMapping);
+    const size_t lBytes = static_cast<size_t>(lStat.st_size);
+    if (lHeader->puMagic != kRingMagic || lHeader->puVersion != kRingVersion
+        || lHeader->puCapacity != lBytes - kDataOffset)
+    {
+        ::munmap(lMapping, lBytes);
+        *aError = aName + " is not a readerd shared ring";
+        return ERROR_UNKNOWN_DATA_FORMAT;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    prHeader = lHeader;
+    prData = static_cast<const uint8_t *>(lMapping) + kDataOffset;
+    prMappedBytes = lBytes;
+
+    // Start with the next document; whatever is committed now is skipped.
+    prNext = prHeader->puHead.load(std::memory_order_acquire);
+    prHeader->puTail.store(prNext, std::memory_order_release);
+    prHeader->puReaderPid.store(static_cast<uint32_t>(::getpid()), std::memory_order_release);
+    return NO_ERROR_OCCURRED;
+}
+
+void SharedRingReader::close()
+{
+    if (prHeader == nullptr)
+        return;
+    prHeader->puReaderPid.store(0);
+    ::munmap(prHeader, prMappedBytes);
+    prHeader = nullptr;
+    prData = nullptr;
+}
+
+bool SharedRingReader::closed() const
+{
+    return prHeader == nullptr || prHeader->puClosed.load(std::memory_order_acquire) != 0;
+}
+
+bool SharedRingReader::next(SharedDocument *aDocument, std::chrono::milliseconds aTimeout)
+{
+    aDocument->puRecords.clear();
+    if (prHeader == nullptr)
+        return false;
+    prHeader->puTail.store(prNext, std::memory_order_release);
+
+    uint64_t lHead = prHeader->puHead.load(std::memory_order_acquire);
+    if (lHead == prNext)
+    {
+        const uint32_t lSequence = prHeader->puSequence.load(std::memory_order_seq_cst);
+        prHeader->puWaiters.fetch_add(1, std::memory_order_seq_cst);
+        lHead = prHeader->puHead.load(std::memory_order_acquire);
+        if (lHead == prNext && prHeader->puClosed.load() == 0)
+            futexWait(&prHeader->puSequence, lSequence, aTimeout);
+        prHeader->puWaiters.fetch_sub(1, std::memory_order_seq_cst);
+        lHead = prHeader->puHead.load(std::memory_order_acquire);
+        if (lHead == prNext)
+            return false;
+    }
+
+    // Committed space always holds whole documents, so walk records up to the end of this one.
+    const uint64_t lCapacity = prHeader->puCapacity;
+    uint64_t lPosition = prNext;
+    while (lPosition < lHead)
+    {
+        const uint64_t lOffset = lPosition % lCapacity;
+        if (lCapacity - lOffset < sizeof(RecordHeader))
+        {
+            lPosition += lCapacity - lOffset;
+            continue;
+        }
+        FrameRecord lRecord;
+        std::memcpy(&lRecord.puHeader, prData + lOffset, sizeof(lRecord.puHeader));
+        lPosition += alignUp(sizeof(RecordHeader) + lRecord.puHeader.puLength);
+        if (lRecord.puHeader.puKind == kPadKind)
+            continue;
+
+        lRecord.puPayload = std::span<const uint8_t>(prData + lOffset + sizeof(RecordHeader), lRecord.puHeader.puLength);
+        aDocument->puDocument = lRecord.puHeader.puDocument;
+        aDocument->puRecords.push_back(lRecord);
+        if (lRecord.puHeader.puKind == RK_EVENT && lRecord.puHeader.puCode == END_OF_DOCUMENT_DATA)
+            break;
+    }
+    prNext = lPosition;
+    return true;
+}
+
+} // namespace readerd
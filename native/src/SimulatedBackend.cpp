@@ -0,0 +1,846 @@
+#include "readerd/SimulatedBackend.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+#include <tuple>
+
+namespace readerd {
+
+namespace {
+
+const char *const kSurnames[] = {"ERIKSSON", "MUSTERMANN", "DUPONT", "JANSEN", "SMITH", "ROSSI"};
+const char *const kForenames[] = {"ANNA<MARIA", "ERIKA", "JEAN", "PIETER", "JOHN", "GIULIA"};
+const char *const kStates[] = {"UTO", "D<<", "FRA", "NLD", "GBR", "ITA"};
+
+int mrzValue(char aChar)
+{
+    if (aChar >= '0' && aChar <= '9')
+        return aChar - '0';
+    if (aChar >= 'A' && aChar <= 'Z')
+        return aChar - 'A' + 10;
+    return 0;
+}
+
+char checkDigit(const std::string &aField)
+{
+    static const int kWeights[3] = {7, 3, 1};
+    int lSum = 0;
+    for (size_t i = 0; i < aField.size(); ++i)
+        lSum += mrzValue(aField[i]) * kWeights[i % 3];
+    return static_cast<char>('0' + lSum % 10);
+}
+
+std::string padField(std::string aValue, size_t aLength)
+{
+    aValue.resize(aLength, '<');
+    return aValue;
+}
+
+void copyField(char *aDest, size_t aDestLen, const std::string &aValue)
+{
+    std::snprintf(aDest, aDestLen, "%s", aValue.c_str());
+}
+
+using Bytes = std::shared_ptr<const std::span<const uint8_t>>;
+
+Bytes ownBytes(std::vector<uint8_t> aBytes)
+{
+    struct Owned
+    {
+        std::vector<uint8_t> puBytes;
+        std::span<const uint8_t> puView;
+    };
+    auto lOwned = std::make_shared<Owned>();
+    lOwned->puBytes = std::move(aBytes);
+    lOwned->puView = lOwned->puBytes;
+    return Bytes(lOwned, &lOwned->puView);
+}
+
+Bytes makeBytes(const void *aData, size_t aLen)
+{
+    const uint8_t *lBytes = static_cast<const uint8_t *>(aData);
+    return ownBytes(std::vector<uint8_t>(lBytes, lBytes + aLen));
+}
+
+template <typename T>
+Bytes makeValue(const T &aValue)
+{
+    return makeBytes(&aValue, sizeof(aValue));
+}
+
+void putLE16(std::vector<uint8_t> &aOut, size_t aPos, uint32_t aValue)
+{
+    aOut[aPos] = static_cast<uint8_t>(aValue);
+    aOut[aPos + 1] = static_cast<uint8_t>(aValue >> 8);
+}
+
+void putLE32(std::vector<uint8_t> &aOut, size_t aPos, uint32_t aValue)
+{
+    putLE16(aOut, aPos, aValue & 0xFFFF);
+    putLE16(aOut, aPos + 2, aValue >> 16);
+}
+
+// Builds a bottom-up 24bpp BMP as returned by the SDK when the image format is set to BMP.
+Bytes makeBitmap(int aWidth, int aHeight, int aSeed, bool aGrey)
+{
+    const size_t lStride = (static_cast<size_t>(aWidth) * 3 + 3) & ~static_cast<size_t>(3);
+    const size_t lPixelBytes = lStride * static_cast<size_t>(aHeight);
+    const size_t lHeaderBytes = 14 + 40;
+
+    std::vector<uint8_t> lOut(lHeaderBytes + lPixelBytes, 0);
+
+    lOut[0] = 'B';
+    lOut[1] = 'M';
+    putLE32(lOut, 2, static_cast<uint32_t>(lOut.size()));
+    putLE32(lOut, 10, static_cast<uint32_t>(lHeaderBytes));
+    putLE32(lOut, 14, 40);
+    putLE32(lOut, 18, static_cast<uint32_t>(aWidth));
+    putLE32(lOut, 22, static_cast<uint32_t>(aHeight));
+    putLE16(lOut, 26, 1);
+    putLE16(lOut, 28, 24);
+    putLE32(lOut, 34, static_cast<uint32_t>(lPixelBytes));
+    putLE32(lOut, 38, 11811);
+    putLE32(lOut, 42, 11811);
+
+    for (int y = 0; y < aHeight; ++y)
+    {
+        uint8_t *lRow = lOut.data() + lHeaderBytes + lStride * static_cast<size_t>(y);
+        for (int x = 0; x < aWidth; ++x)
+        {
+            const uint8_t lBase = static_cast<uint8_t>((x + y) / 8 + aSeed * 37);
+            const uint8_t lTexture = static_cast<uint8_t>((x ^ y) & 0x1F);
+            uint8_t *lPixel = lRow + x * 3;
+            if (aGrey)
+            {
+                lPixel[0] = lPixel[1] = lPixel[2] = static_cast<uint8_t>(lBase + lTexture);
+            }
+            else
+            {
+                lPixel[0] = static_cast<uint8_t>(lBase + lTexture);
+                lPixel[1] = static_cast<uint8_t>(lBase + y / 4);
+                lPixel[2] = static_cast<uint8_t>(lBase + x / 4);
+            }
+        }
+    }
+    return ownBytes(std::move(lOut));
+}
+
+Bytes makeChipFile(uint8_t aTag, size_t aSize, uint32_t aSeed)
+{
+    std::vector<uint8_t> lFile(aSize < 4 ? 4 : aSize);
+    const size_t lBodyLen = lFile.size() - 4;
+    lFile[0] = aTag;
+    lFile[1] = 0x82;
+    lFile[2] = static_cast<uint8_t>(lBodyLen >> 8);
+    lFile[3] = static_cast<uint8_t>(lBodyLen);
+    uint32_t lState = aSeed * 2654435761u + 1;
+    for (size_t i = 4; i < lFile.size(); ++i)
+    {
+        lState = lState * 1664525u + 1013904223u;
+        lFile[i] = static_cast<uint8_t>(lState >> 24);
+    }
+    return ownBytes(std::move(lFile));
+}
+
+// Scan files are named CD_NAME[.index][.ext].
+bool scanFileDataType(std::string_view aFileName, MMMReaderDataType *aDataType, int *aIndex)
+{
+    const size_t lDot = aFileName.find('.');
+    if (!dataTypeFromName(std::string(aFileName.substr(0, lDot)), aDataType))
+        return false;
+    *aIndex = 0;
+    if (lDot != std::string_view::npos)
+    {
+        const std::string lRest(aFileName.substr(lDot + 1));
+        char *lEnd = nullptr;
+        const long lValue = std::strtol(lRest.c_str(), &lEnd, 10);
+        if (lEnd != lRest.c_str() && (*lEnd == '.' || *lEnd == '\0'))
+            *aIndex = static_cast<int>(lValue);
+    }
+    return true;
+}
+
+} // namespace
+
+bool SimulatedOptions::parse(const std::string &aSpec, SimulatedOptions *aOptions, std::string *aError)
+{
+    std::stringstream lStream(aSpec);
+    std::string lPair;
+    while (std::getline(lStream, lPair, ','))
+    {
+        if (lPair.empty())
+            continue;
+        const size_t lEquals = lPair.find('=');
+        if (lEquals == std::string::npos)
+        {
+            *aError = "expected key=value, got '" + lPair + "'";
+            return false;
+        }
+        const std::string lKey = lPair.substr(0, lEquals);
+        const char *lText = lPair.c_str() + lEquals + 1;
+        char *lEnd = nullptr;
+        const long lValue = std::strtol(lText, &lEnd, 10);
+        if (lEnd == lText || *lEnd != '\0' || lValue < 0)
+        {
+            *aError = "invalid value for '" + lKey + "'";
+            return false;
+        }
+        const int lInt = static_cast<int>(lValue);
+
+        if (lKey == "docs")
+            aOptions->puDocumentCount = lInt;
+        else if (lKey == "live")
+            aOptions->puLive = lInt != 0;
+        else if (lKey == "width")
+            aOptions->puImageWidth = lInt;
+        else if (lKey == "height")
+            aOptions->puImageHeight = lInt;
+        else if (lKey == "uv")
+            aOptions->puCaptureUV = lInt != 0;
+        else if (lKey == "rf")
+            aOptions->puReadRF = lInt != 0;
+        else if (lKey == "dg2")
+            aOptions->puDG2Size = lInt;
+        else if (lKey == "scanners")
+            aOptions->puScannerCount = lInt;
+        else if (lKey == "init_ms")
+            aOptions->puInitialiseDelayMs = lInt;
+        else if (lKey == "settings_ms")
+            aOptions->puSettingsDelayMs = lInt;
+        else if (lKey == "detect_us")
+            aOptions->puDetectUs = lInt;
+        else if (lKey == "capture_us")
+            aOptions->puCaptureUs = lInt;
+        else if (lKey == "ocr_us")
+            aOptions->puOcrUs = lInt;
+        else if (lKey == "rf_us")
+            aOptions->puRfGroupUs = lInt;
+        else if (lKey == "gap_us")
+            aOptions->puGapUs = lInt;
+        else
+        {
+            *aError = "unknown simulated backend option '" + lKey + "'";
+            return false;
+        }
+    }
+    if (aOptions->puImageWidth <= 0 || aOptions->puImageHeight <= 0)
+    {
+        *aError = "image dimensions must be positive";
+        return false;
+    }
+    return true;
+}
+
+SimulatedBackend::SimulatedBackend(const SimulatedOptions &aOptions)
+    : prOptions(aOptions)
+{
+}
+
+SimulatedBackend::~SimulatedBackend()
+{
+    shutdown();
+}
+
+void SimulatedBackend::buildSharedPayloads()
+{
+    // Images and chip files are identical for every document, as the cost being measured is
+    // the delivery path rather than the content. They are built once per initialise.
+    prImageIR = makeBitmap(prOptions.puImageWidth, prOptions.puImageHeight, 1, true);
+    prImageVIS = makeBitmap(prOptions.puImageWidth, prOptions.puImageHeight, 2, false);
+    prImageUV = makeBitmap(prOptions.puImageWidth, prOptions.puImageHeight, 3, false);
+    prImagePhoto = makeBitmap(413, 531, 4, false);
+
+    static const uint8_t kEFCom[] = {
+        0x60, 0x16, 0x5F, 0x01, 0x04, '0', '1', '0', '7', 0x5F, 0x36, 0x06,
+        '0', '4', '0', '0', '0', '0', 0x5C, 0x04, 0x61, 0x75, 0x6E, 0x77};
+    prEFCom = makeBytes(kEFCom, sizeof(kEFCom));
+    prEFSod = makeChipFile(0x77, 1900, 7);
+    prDG2 = makeChipFile(0x75, static_cast<size_t>(prOptions.puDG2Size), 11);
+}
+
+void SimulatedBackend::buildDocument(int aSerial, std::vector<Step> *aSteps) const
+{
+    const size_t lPick = static_cast<size_t>(aSerial) % (sizeof(kSurnames) / sizeof(kSurnames[0]));
+    const std::string lState = kStates[lPick];
+
+    char lDocNumber[16];
+    std::snprintf(lDocNumber, sizeof(lDocNumber), "L%08d", aSerial % 100000000);
+    const std::string lDocField = lDocNumber;
+    const std::string lDob = "740812";
+    const std::string lExpiry = "320415";
+    const std::string lOptional = padField("ZE184226B", 14);
+    const char lSex = (aSerial & 1) ? 'M' : 'F';
+
+    const std::string lLine1 = padField(
+        std::string("P<") + lState + kSurnames[lPick] + "<<" + kForenames[lPick], 44);
+    std::string lLine2 = lDocField + checkDigit(lDocField) + lState + lDob + checkDigit(lDob) + lSex
+        + lExpiry + checkDigit(lExpiry) + lOptional + checkDigit(lOptional);
+    lLine2 += checkDigit(lLine2.substr(0, 10) + lLine2.substr(13, 7) + lLine2.substr(21, 22));
+
+    const std::string lCodeline = lLine1 + "\r" + lLine2;
+
+    MMMReaderCodelineData lData;
+    std::memset(&lData, 0, sizeof(lData));
+    copyField(lData.Data, sizeof(lData.Data), lCodeline);
+    lData.LineCount = 2;
+    copyField(lData.Line1, sizeof(lData.Line1), lLine1);
+    copyField(lData.Line2, sizeof(lData.Line2), lLine2);
+    copyField(lData.DocId, sizeof(lData.DocId), "PASSPORT");
+    copyField(lData.DocType, sizeof(lData.DocType), "PASSPORT");
+    copyField(lData.Surname, sizeof(lData.Surname), kSurnames[lPick]);
+    copyField(lData.Forenames, sizeof(lData.Forenames), kForenames[lPick]);
+    copyField(lData.IssuingState, sizeof(lData.IssuingState), lState);
+    copyField(lData.Nationality, sizeof(lData.Nationality), lState);
+    copyField(lData.DocNumber, sizeof(lData.DocNumber), lDocField);
+    copyField(lData.DateOfBirthMRZ, sizeof(lData.DateOfBirthMRZ), lDob);
+    copyField(lData.ExpiryDateMRZ, sizeof(lData.ExpiryDateMRZ), lExpiry);
+    copyField(lData.Sex, sizeof(lData.Sex), lSex == 'M' ? "Male" : "Female");
+    copyField(lData.OptionalData1, sizeof(lData.OptionalData1), "ZE184226B");
+    lData.ShortSex = lSex;
+    lData.DateOfBirth = MMMReaderDate{12, 8, 74};
+    lData.ExpiryDate = MMMReaderDate{15, 4, 32};
+    lData.CodelineValidationResult = CDR_Valid;
+
+    std::vector<Step> &lSteps = *aSteps;
+    lSteps.clear();
+
+    auto lEvent = [&lSteps](MMMReaderEventCode aEvent, int aDelayUs = 0) {
+        Step lStep;
+        lStep.puDelayUs = aDelayUs;
+        lStep.puIsEvent = true;
+        lStep.puEvent = aEvent;
+        lSteps.push_back(lStep);
+    };
+    auto lItem = [&lSteps](MMMReaderDataType aType, Payload aPayload, int aDelayUs = 0) {
+        Step lStep;
+        lStep.puDelayUs = aDelayUs;
+        lStep.puDataType = aType;
+        lStep.puPayload = std::move(aPayload);
+        lSteps.push_back(lStep);
+    };
+
+    // Detection runs between the document landing on the window and the reader committing
+    // to a read, which is where the SDK spends it too.
+    lEvent(DOC_ON_WINDOW);
+    lEvent(START_OF_DOCUMENT_DATA, prOptions.puDetectUs);
+
+    const float lProgressCaptured = 0.3f;
+    lItem(CD_IMAGEIR, prImageIR, prOptions.puCaptureUs);
+    lItem(CD_IMAGEVIS, prImageVIS, prOptions.puCaptureUs);
+    if (prOptions.puCaptureUV)
+        lItem(CD_IMAGEUV, prImageUV, prOptions.puCaptureUs);
+    lItem(CD_READ_PROGRESS, makeValue(lProgressCaptured));
+
+    lItem(CD_CODELINE, makeBytes(lCodeline.c_str(), lCodeline.size() + 1), prOptions.puOcrUs);
+    lItem(CD_CODELINE_DATA, makeValue(lData));
+    lItem(CD_CHECKSUM, makeValue(1));
+    lItem(CD_IMAGEPHOTO, prImagePhoto);
+    lItem(CD_SECURITYCHECK, makeValue(0));
+
+    if (prOptions.puReadRF)
+    {
+        // Every 17th document fails BAC so that downstream statistics have something to find.
+        const bool lBacOk = aSerial % 17 != 0;
+        lEvent(lBacOk ? RF_CHIP_OPENED_SUCCESSFULLY : RF_CHIP_OPEN_FAILED, prOptions.puRfGroupUs);
+        lItem(CD_SCBAC_STATUS, makeValue(lBacOk ? TS_SUCCESS : TS_FAILURE));
+        if (lBacOk)
+        {
+            std::vector<uint8_t> lDG1 = {0x61, 0x5B, 0x5F, 0x1F, 0x58};
+            lDG1.insert(lDG1.end(), lLine1.begin(), lLine1.end());
+            lDG1.insert(lDG1.end(), lLine2.begin(), lLine2.end());
+            const std::string lChipCodeline = lLine1 + lLine2;
+
+            lItem(CD_SCEF_COM_FILE, prEFCom, prOptions.puRfGroupUs);
+            lItem(CD_SCEF_SOD_FILE, prEFSod, prOptions.puRfGroupUs);
+            lItem(CD_SCDG1_FILE, makeBytes(lDG1.data(), lDG1.size()), prOptions.puRfGroupUs);
+            lItem(CD_SCDG1_CODELINE, makeBytes(lChipCodeline.c_str(), lChipCodeline.size() + 1));
+            lItem(CD_SCDG1_VALIDATE, makeValue(RFID_VC_VALID));
+            lItem(CD_SCDG2_FILE, prDG2, prOptions.puRfGroupUs);
+            lItem(CD_SCDG2_VALIDATE, makeValue(RFID_VC_VALID));
+            lItem(CD_SCSIGNEDATTRS_VALIDATE, makeValue(RFID_VC_VALID));
+            lItem(CD_SCSIGNATURE_VALIDATE, makeValue(RFID_VC_VALID));
+        }
+    }
+
+    lItem(CD_READ_PROGRESS, makeValue(1.0f));
+    lEvent(END_OF_DOCUMENT_DATA);
+    lEvent(DOC_REMOVED);
+}
+
+bool SimulatedBackend::sleepUnlessStopped(int aMicroseconds)
+{
+    std::unique_lock<std::mutex> lLock(prMutex);
+    if (aMicroseconds > 0)
+        prWakeup.wait_for(lLock, std::chrono::microseconds(aMicroseconds), [this] { return prStopping; });
+    return !prStopping;
+}
+
+bool SimulatedBackend::moreDocuments() const
+{
+    return prOptions.puLive
+        && (prOptions.puDocumentCount == 0 || prDocumentsPresented.load() < prOptions.puDocumentCount);
+}
+
+void SimulatedBackend::runDocument(const std::vector<Step> &aSteps, bool aDeliverEvents, bool aDeliverData)
+{
+    for (const Step &lStep : aSteps)
+    {
+        if (lStep.puDelayUs > 0 && !sleepUnlessStopped(lStep.puDelayUs))
+            return;
+
+        if (lStep.puIsEvent)
+        {
+            if (lStep.puEvent == START_OF_DOCUMENT_DATA)
+                changeState(READER_READING);
+            if (aDeliverEvents)
+                raiseEvent(lStep.puEvent);
+            if (lStep.puEvent == END_OF_DOCUMENT_DATA)
+                changeState(READER_ENABLED);
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lLock(prMutex);
+            prStore.push_back(StoredItem{lStep.puDataType, lStep.puPayload});
+        }
+        if (aDeliverData && prDataCallback)
+        {
+            prDataCallback(
+                prParam,
+                lStep.puDataType,
+                static_cast<int>(lStep.puPayload->size()),
+                const_cast<uint8_t *>(lStep.puPayload->data()));
+        }
+    }
+}
+
+void SimulatedBackend::workerLoop()
+{
+    std::vector<Step> lSteps;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lLock(prMutex);
+            prWakeup.wait(lLock, [this] {
+                return prStopping || (prState.load() == READER_ENABLED && moreDocuments());
+            });
+            if (prStopping)
+                return;
+            prStore.clear();
+        }
+
+        if (!sleepUnlessStopped(prOptions.puGapUs))
+            return;
+
+        const int lSerial = ++prDocumentsPresented;
+        buildDocument(lSerial, &lSteps);
+        runDocument(lSteps, true, true);
+    }
+}
+
+void SimulatedBackend::changeState(ReaderState aNewState)
+{
+    if (prState.exchange(aNewState) != aNewState)
+        raiseEvent(READER_STATE_CHANGED);
+}
+
+void SimulatedBackend::raiseEvent(MMMReaderEventCode aEvent)
+{
+    if (prEventCallback)
+        prEventCallback(prParam, aEvent);
+}
+
+MMMReaderErrorCode SimulatedBackend::initialise(
+    MMMReaderHLDataCallback aDataCallback,
+    MMMReaderEventCallback aEventCallback,
+    MMMReaderErrorCallback aErrorCallback,
+    MMMReaderCertificateCallback /*aCertCallback*/,
+    void *aParam)
+{
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (prInitialised)
+            return ERROR_ALREADY_INITIALISED;
+        prInitialised = true;
+        prStopping = false;
+        prDocumentPending = false;
+        prStore.clear();
+    }
+
+    prDataCallback = aDataCallback;
+    prEventCallback = aEventCallback;
+    prErrorCallback = aErrorCallback;
+    prParam = aParam;
+    prDocumentsPresented = 0;
+
+    if (prOptions.puInitialiseDelayMs > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(prOptions.puInitialiseDelayMs));
+    buildSharedPayloads();
+
+    raiseEvent(SETTINGS_INITIALISED);
+    raiseEvent(PLUGINS_INITIALISED);
+    changeState(prStartupState);
+
+    // As with the SDK, supplying either callback selects Non-Blocking mode.
+    if (prDataCallback || prEventCallback)
+        prWorker = std::thread(&SimulatedBackend::workerLoop, this);
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (!prInitialised)
+            return ERROR_NOT_INITIALISED;
+        prStopping = true;
+    }
+    prWakeup.notify_all();
+    if (prWorker.joinable())
+        prWorker.join();
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prInitialised = false;
+    prStore.clear();
+    prState = READER_TERMINATED;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::reset()
+{
+    MMMReaderHLDataCallback lData = prDataCallback;
+    MMMReaderEventCallback lEvent = prEventCallback;
+    MMMReaderErrorCallback lError = prErrorCallback;
+    void *lParam = prParam;
+
+    const MMMReaderErrorCode lResult = shutdown();
+    if (lResult != NO_ERROR_OCCURRED)
+        return lResult;
+    return initialise(lData, lEvent, lError, nullptr, lParam);
+}
+
+ReaderState SimulatedBackend::getState()
+{
+    return prState.load();
+}
+
+MMMReaderErrorCode SimulatedBackend::setState(ReaderState aNewState, bool /*aForceRedetect*/)
+{
+    switch (aNewState)
+    {
+    case READER_ENABLED:
+    case READER_DISABLED:
+    case READER_ASLEEP:
+    case READER_SUSPENDED:
+        break;
+    default:
+        return ERROR_INVALID_STATE_CHANGE;
+    }
+    {
+        // As with the SDK, a state set before initialising is the one the reader starts in.
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (!prInitialised)
+        {
+            prStartupState = aNewState;
+            return NO_ERROR_OCCURRED;
+        }
+    }
+    changeState(aNewState);
+    prWakeup.notify_all();
+    return NO_ERROR_OCCURRED;
+}
+
+bool SimulatedBackend::isDocumentOnWindow()
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    return prDocumentPending;
+}
+
+MMMReaderErrorCode SimulatedBackend::waitForDocumentOnWindow(int aTimeout)
+{
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (!prInitialised)
+            return ERROR_NOT_INITIALISED;
+        if (prDocumentPending)
+            return NO_ERROR_OCCURRED;
+    }
+
+    if (!moreDocuments() || prState.load() != READER_ENABLED)
+    {
+        sleepUnlessStopped(aTimeout * 1000);
+        return ERROR_TIMED_OUT;
+    }
+
+    if (!sleepUnlessStopped(prOptions.puGapUs + prOptions.puDetectUs))
+        return ERROR_OPERATION_CANCELLED;
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prDocumentPending = true;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::readDocument()
+{
+    if (prDataCallback || prEventCallback)
+        return ERROR_BLOCKING_ONLY;
+
+    const MMMReaderErrorCode lWait = waitForDocumentOnWindow(0);
+    if (lWait == ERROR_TIMED_OUT)
+        return ERROR_NO_DOC_ON_WINDOW;
+    if (lWait != NO_ERROR_OCCURRED)
+        return lWait;
+
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        prStore.clear();
+        prDocumentPending = false;
+    }
+
+    std::vector<Step> lSteps;
+    buildDocument(++prDocumentsPresented, &lSteps);
+    // The detect delay has already been spent in waitForDocumentOnWindow().
+    for (Step &lStep : lSteps)
+    {
+        if (lStep.puIsEvent && lStep.puEvent == START_OF_DOCUMENT_DATA)
+            lStep.puDelayUs = 0;
+    }
+    runDocument(lSteps, false, false);
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::getData(
+    MMMReaderDataType aDataType,
+    void *aDataPtr,
+    int *aDataLen,
+    int aIndex)
+{
+    if (aDataLen == nullptr)
+        return ERROR_PARAMETER_INVALID;
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    if (!prInitialised)
+        return ERROR_NOT_INITIALISED;
+
+    int lSeen = 0;
+    for (const StoredItem &lItem : prStore)
+    {
+        if (lItem.puDataType != aDataType || lSeen++ != aIndex)
+            continue;
+
+        const int lSize = static_cast<int>(lItem.puPayload->size());
+        if (aDataPtr == nullptr)
+        {
+            *aDataLen = lSize;
+            return NO_ERROR_OCCURRED;
+        }
+        if (*aDataLen < lSize)
+        {
+            *aDataLen = lSize;
+            return ERROR_DATA_BUFFER_TOO_SMALL;
+        }
+        std::memcpy(aDataPtr, lItem.puPayload->data(), lItem.puPayload->size());
+        *aDataLen = lSize;
+        return NO_ERROR_OCCURRED;
+    }
+
+    *aDataLen = 0;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::getDataCount(MMMReaderDataType aDataType, int *aItemCount)
+{
+    if (aItemCount == nullptr)
+        return ERROR_PARAMETER_INVALID;
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    int lCount = 0;
+    for (const StoredItem &lItem : prStore)
+    {
+        if (lItem.puDataType == aDataType)
+            ++lCount;
+    }
+    *aItemCount = lCount;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::clearData()
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    prStore.clear();
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::getConnectedScanners(std::vector<std::string> *aSerialNumbers)
+{
+    aSerialNumbers->clear();
+    for (int i = 1; i <= prOptions.puScannerCount; ++i)
+    {
+        char lSerial[16];
+        std::snprintf(lSerial, sizeof(lSerial), "SIM%05d", i);
+        aSerialNumbers->push_back(lSerial);
+    }
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::selectScanner(const char *aSerialNumber)
+{
+    if (aSerialNumber == nullptr)
+        return ERROR_PARAMETER_INVALID;
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (prInitialised)
+            return ERROR_ALREADY_INITIALISED;
+    }
+    std::vector<std::string> lSerialNumbers;
+    getConnectedScanners(&lSerialNumbers);
+    if (std::find(lSerialNumbers.begin(), lSerialNumbers.end(), aSerialNumber) == lSerialNumbers.end())
+        return ERROR_READER_NOT_CONNECTED;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::loadSettings(MMMReaderSettings *aSettings, const char *aIniPath)
+{
+    namespace fs = std::filesystem;
+
+    if (aSettings == nullptr)
+        return ERROR_PARAMETER_INVALID;
+
+    // As with the SDK, the location file lives in the binaries folder unless one is named, and
+    // the other folders are found relative to it.
+    std::error_code lError;
+    const fs::path lExeDir = fs::read_symlink("/proc/self/exe", lError).parent_path();
+    fs::path lRoot = lExeDir;
+    if (aIniPath != nullptr)
+    {
+        if (!fs::is_regular_file(aIniPath, lError))
+            return ERROR_FILE_DOES_NOT_EXIST;
+        lRoot = fs::absolute(aIniPath, lError).parent_path();
+    }
+
+    if (prOptions.puSettingsDelayMs > 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(prOptions.puSettingsDelayMs));
+
+    // In the order of kSettingsDirectories.
+    prSettingsDirectories = {lRoot.string(),
+                             lExeDir.string(),
+                             lRoot.string(),
+                             (lRoot / "Config").string(),
+                             (lRoot / "Plugins").string(),
+                             (lRoot / "Data").string(),
+                             (lRoot / "Log").string(),
+                             (lRoot / "LayoutDatabase").string()};
+    std::memset(aSettings, 0, sizeof(*aSettings));
+    for (size_t i = 0; i < prSettingsDirectories.size(); ++i)
+        aSettings->*kSettingsDirectories[i] = prSettingsDirectories[i].data();
+    return NO_ERROR_OCCURRED;
+}
+
+std::string SimulatedBackend::settingsVersion()
+{
+    return "sim-1";
+}
+
+MMMReaderErrorCode SimulatedBackend::checkCanLoad()
+{
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        if (!prInitialised)
+            return ERROR_NOT_INITIALISED;
+    }
+    if (prState.load() == READER_READING)
+        return ERROR_CURRENTLY_IN_USE;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::loadAndProcessFromScanDirectory(const char *aDirectoryPath, bool aSendDataFlag)
+{
+    if (aDirectoryPath == nullptr)
+        return ERROR_PARAMETER_INVALID;
+    const MMMReaderErrorCode lCanLoad = checkCanLoad();
+    if (lCanLoad != NO_ERROR_OCCURRED)
+        return lCanLoad;
+
+    std::error_code lError;
+    std::filesystem::directory_iterator lDir(aDirectoryPath, lError);
+    if (lError)
+        return ERROR_FILE_DOES_NOT_EXIST;
+
+    std::vector<ScanItem> lItems;
+    for (const std::filesystem::directory_entry &lEntry : lDir)
+    {
+        if (!lEntry.is_regular_file())
+            continue;
+        MMMReaderDataType lDataType;
+        int lIndex;
+        if (!scanFileDataType(lEntry.path().filename().string(), &lDataType, &lIndex))
+            continue;
+
+        std::ifstream lFile(lEntry.path(), std::ios::binary);
+        std::vector<uint8_t> lBytes(static_cast<size_t>(lEntry.file_size()));
+        if (!lFile || !lFile.read(reinterpret_cast<char *>(lBytes.data()), static_cast<std::streamsize>(lBytes.size())))
+            return ERROR_READING_FILE;
+        lItems.push_back(ScanItem{lDataType, lIndex, ownBytes(std::move(lBytes))});
+    }
+    processScan(lItems, aSendDataFlag);
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedBackend::loadAndProcessScan(std::span<const ScanFile> aFiles, bool aSendDataFlag)
+{
+    const MMMReaderErrorCode lCanLoad = checkCanLoad();
+    if (lCanLoad != NO_ERROR_OCCURRED)
+        return lCanLoad;
+
+    std::vector<ScanItem> lItems;
+    for (const ScanFile &lFile : aFiles)
+    {
+        MMMReaderDataType lDataType;
+        int lIndex;
+        if (scanFileDataType(lFile.puName, &lDataType, &lIndex))
+            lItems.push_back(ScanItem{lDataType, lIndex, std::make_shared<const std::span<const uint8_t>>(lFile.puBytes)});
+    }
+    processScan(lItems, aSendDataFlag);
+    return NO_ERROR_OCCURRED;
+}
+
+void SimulatedBackend::processScan(std::vector<ScanItem> &aItems, bool aSendDataFlag)
+{
+    // Directory order is arbitrary; replay in data type order so runs are deterministic.
+    std::sort(aItems.begin(), aItems.end(), [](const ScanItem &aLeft, const ScanItem &aRight) {
+        return std::tie(aLeft.puDataType, aLeft.puIndex) < std::tie(aRight.puDataType, aRight.puIndex);
+    });
+
+    std::vector<Step> lSteps;
+    Step lStart;
+    lStart.puIsEvent = true;
+    lStart.puEvent = START_OF_DOCUMENT_DATA;
+    lSteps.push_back(lStart);
+    for (ScanItem &lItem : aItems)
+    {
+        Step lStep;
+        lStep.puDelayUs = lItem.puDataType == CD_CODELINE ? prOptions.puOcrUs : 0;
+        lStep.puDataType = lItem.puDataType;
+        lStep.puPayload = std::move(lItem.puPayload);
+        lSteps.push_back(std::move(lStep));
+    }
+    Step lEnd;
+    lEnd.puIsEvent = true;
+    lEnd.puEvent = END_OF_DOCUMENT_DATA;
+    lSteps.push_back(lEnd);
+
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        prStore.clear();
+    }
+    runDocument(lSteps, true, aSendDataFlag);
+}
+
+} // namespace readerd
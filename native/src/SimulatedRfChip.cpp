@@ -0,0 +1,243 @@
+#include "readerd/SimulatedRfChip.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <thread>
+
+namespace readerd {
+
+namespace {
+
+const char kMrz[] = "P<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<"
+                    "L898902C36UTO7408122F1204159ZE184226B<<<<<10";
+
+// A data group file of aSize bytes, or of just its header if that is longer: the tag and
+// length, then noise.
+std::vector<uint8_t> makeDataGroup(int aDataGroup, size_t aSize)
+{
+    const size_t lContent = aSize > 5 ? aSize - 5 : 0;
+    std::vector<uint8_t> lFile = {dataGroupTag(aDataGroup), 0x83, static_cast<uint8_t>(lContent >> 16),
+                                  static_cast<uint8_t>(lContent >> 8), static_cast<uint8_t>(lContent)};
+    uint32_t lState = 0x9E3779B9u * static_cast<uint32_t>(aDataGroup);
+    while (lFile.size() < aSize)
+    {
+        lState = lState * 1664525u + 1013904223u;
+        lFile.push_back(static_cast<uint8_t>(lState >> 24));
+    }
+    return lFile;
+}
+
+} // namespace
+
+bool SimulatedChipOptions::parse(const std::string &aSpec, SimulatedChipOptions *aOptions, std::string *aError)
+{
+    std::stringstream lStream(aSpec);
+    std::string lPair;
+    while (std::getline(lStream, lPair, ','))
+    {
+        if (lPair.empty())
+            continue;
+        const size_t lEquals = lPair.find('=');
+        if (lEquals == std::string::npos)
+        {
+            *aError = "expected key=value, got '" + lPair + "'";
+            return false;
+        }
+        const std::string lKey = lPair.substr(0, lEquals);
+        const char *lText = lPair.c_str() + lEquals + 1;
+        if (lKey == "signer")
+        {
+            std::ifstream lIn(lText, std::ios::binary);
+            aOptions->puSigner.assign(std::istreambuf_iterator<char>(lIn), std::istreambuf_iterator<char>());
+            if (!lIn || aOptions->puSigner.empty())
+            {
+                *aError = std::string("cannot read the signer certificate ") + lText;
+                return false;
+            }
+            continue;
+        }
+        char *lEnd = nullptr;
+        const long lValue = std::strtol(lText, &lEnd, 10);
+        if (lEnd == lText || *lEnd != '\0' || lValue < 0)
+        {
+            *aError = "invalid value for '" + lKey + "'";
+            return false;
+        }
+        const int lInt = static_cast<int>(lValue);
+
+        if (lKey == "dg2")
+            aOptions->puDG2Size = lInt;
+        else if (lKey == "dg3")
+            aOptions->puDG3Size = lInt;
+        else if (lKey == "dg14")
+            aOptions->puDG14Size = lInt;
+        else if (lKey == "tamper")
+            aOptions->puTamperedGroup = lInt;
+        else if (lKey == "block")
+            aOptions->puBlockSize = lInt;
+        else if (lKey == "max_block")
+            aOptions->puMaxBlock = lInt;
+        else if (lKey == "apdu_us")
+            aOptions->puApduUs = lInt;
+        else if (lKey == "ext_us")
+            aOptions->puExtendedApduUs = lInt;
+        else if (lKey == "aa" && lInt <= 2)
+            aOptions->puActiveAuth = lInt;
+        else if (lKey == "aa_us")
+            aOptions->puActiveAuthUs = lInt;
+        else if (lKey == "id")
+            aOptions->puChipId = lInt;
+        else if (lKey == "kbps")
+            aOptions->puKbps = lInt;
+        else if (lKey == "open_us")
+            aOptions->puOpenUs = lInt;
+        else
+        {
+            *aError = "unknown simulated chip option '" + lKey + "'";
+            return false;
+        }
+    }
+    if (aOptions->puBlockSize <= 0)
+    {
+        *aError = "the block size must be positive";
+        return false;
+    }
+    return true;
+}
+
+SimulatedRfChip::SimulatedRfChip(const SimulatedChipOptions &aOptions)
+    : prOptions(aOptions)
+    , prBlockSize(aOptions.puBlockSize)
+{
+    std::vector<uint8_t> lDG1 = {dataGroupTag(1), 0x5B, 0x5F, 0x1F, 0x58};
+    lDG1.insert(lDG1.end(), kMrz, kMrz + sizeof(kMrz) - 1);
+    prDataGroups[1] = lDG1;
+    if (prOptions.puDG2Size > 0)
+        prDataGroups[2] = makeDataGroup(2, static_cast<size_t>(prOptions.puDG2Size));
+    if (prOptions.puDG3Size > 0)
+        prDataGroups[3] = makeDataGroup(3, static_cast<size_t>(prOptions.puDG3Size));
+    if (prOptions.puDG14Size > 0)
+        prDataGroups[14] = makeDataGroup(14, static_cast<size_t>(prOptions.puDG14Size));
+    // The Active Authentication public key.
+    if (prOptions.puActiveAuth > 0)
+        prDataGroups[15] = makeDataGroup(15, 300);
+
+    std::vector<int> lPresent;
+    SecurityObject lObject;
+    lObject.puAlgorithm = DA_SHA256;
+    for (int lGroup = 1; lGroup <= kMaxDataGroup; ++lGroup)
+    {
+        if (prDataGroups[lGroup].empty())
+            continue;
+        lPresent.push_back(lGroup);
+        computeDigest(DA_SHA256, prDataGroups[lGroup], &lObject.puDigests[lGroup]);
+    }
+    prEfCom = buildEfCom(lPresent);
+    prEfSod = buildEfSod(lObject, prOptions.puSigner);
+
+    const int lTampered = prOptions.puTamperedGroup;
+    if (lTampered >= 1 && lTampered <= kMaxDataGroup && !prDataGroups[lTampered].empty())
+        prDataGroups[lTampered].back() ^= 0x01;
+}
+
+bool SimulatedRfChip::transfer(size_t aBytes)
+{
+    int64_t lApduUs = prOptions.puApduUs;
+    if (prBlockSize > kMaxShortReadBlock)
+        lApduUs += prOptions.puExtendedApduUs;
+    // A chip that cannot answer the block size fails the first READ BINARY.
+    const bool lAnswered = prOptions.puMaxBlock == 0 || prBlockSize <= prOptions.puMaxBlock;
+    const size_t lBlock = static_cast<size_t>(prBlockSize);
+    const int64_t lApdus = lAnswered ? static_cast<int64_t>((aBytes + lBlock - 1) / lBlock) : 1;
+    const int64_t lBytes = lAnswered ? static_cast<int64_t>(aBytes) : 0;
+    int64_t lUs = lApdus * lApduUs;
+    if (prOptions.puKbps > 0)
+        lUs += lBytes * 8 * 1000 / prOptions.puKbps;
+    if (lUs > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(lUs));
+    prApduUs += lUs;
+    prBytesRead += lBytes;
+    return lAnswered;
+}
+
+MMMReaderErrorCode SimulatedRfChip::waitForOpen(const char *aBacKey, int)
+{
+    if (aBacKey == nullptr || *aBacKey == '\0')
+        return ERROR_RF_BAC_FAILURE;
+    if (prOptions.puOpenUs > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(prOptions.puOpenUs));
+    prOpen = true;
+    prApduUs = 0;
+    prBytesRead = 0;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedRfChip::getFile(MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes)
+{
+    if (!prOpen)
+        return ERROR_RF_GET_DATA_ITEM_FAILED;
+    const std::vector<uint8_t> *lFile = nullptr;
+    if (aItem == RFID_EF_COM)
+        lFile = &prEfCom;
+    else if (aItem == RFID_EF_SOD)
+        lFile = &prEfSod;
+    else if (aItem >= RFID_DG1 && aItem <= RFID_DG16)
+        lFile = &prDataGroups[aItem - RFID_DG1 + 1];
+    if (lFile == nullptr || lFile->empty())
+        return ERROR_RF_DG_NOT_PRESENT;
+
+    if (!transfer(lFile->size()))
+        return ERROR_RF_GET_DATA_ITEM_FAILED;
+    *aBytes = *lFile;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedRfChip::checkActiveAuthentication(int *aResult)
+{
+    *aResult = RFID_VC_NOT_PERFORMED;
+    if (!prOpen)
+        return ERROR_RF_GET_DATA_ITEM_FAILED;
+    if (prOptions.puActiveAuth == 0)
+        return NO_ERROR_OCCURRED;
+    if (prOptions.puActiveAuthUs > 0)
+        std::this_thread::sleep_for(std::chrono::microseconds(prOptions.puActiveAuthUs));
+    prApduUs += prOptions.puActiveAuthUs;
+    *aResult = prOptions.puActiveAuth == 1 ? RFID_VC_VALID : RFID_VC_INVALID;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedRfChip::powerOff()
+{
+    prOpen = false;
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedRfChip::getChipId(std::string *aId)
+{
+    if (!prOpen)
+        return ERROR_RF_GET_DATA_ITEM_FAILED;
+    *aId = std::to_string(prOptions.puChipId);
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedRfChip::getTransferCounters(int *aApduMs, int *aBytesRead)
+{
+    if (!prOpen)
+        return ERROR_RF_GET_DATA_ITEM_FAILED;
+    *aApduMs = static_cast<int>(prApduUs / 1000);
+    *aBytesRead = static_cast<int>(prBytesRead);
+    return NO_ERROR_OCCURRED;
+}
+
+MMMReaderErrorCode SimulatedRfChip::setReadBlockSize(int aBytes)
+{
+    if (aBytes <= 0)
+        return ERROR_PARAMETER_INVALID;
+    prBlockSize = aBytes;
+    return NO_ERROR_OCCURRED;
+}
+
+} // namespace readerd
@@ -0,0 +1,60 @@
+#include "readerd/SocketAddress.h"
+
+#include <cstdlib>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+namespace readerd {
+
+bool SocketAddress::parse(const std::string &aSpec, SocketAddress *aAddress, std::string *aError)
+{
+    *aAddress = SocketAddress();
+    if (aSpec.rfind("tcp:", 0) != 0)
+    {
+        sockaddr_un *lUnix = reinterpret_cast<sockaddr_un *>(&aAddress->puStorage);
+        if (aSpec.empty() || aSpec.size() >= sizeof(lUnix->sun_path))
+        {
+            *aError = "bad socket path: " + aSpec;
+            return false;
+        }
+        lUnix->sun_family = AF_UNIX;
+        std::memcpy(lUnix->sun_path, aSpec.c_str(), aSpec.size() + 1);
+        aAddress->puLength = sizeof(sockaddr_un);
+        aAddress->puPath = aSpec;
+        return true;
+    }
+
+    const std::string lHostPort = aSpec.substr(4);
+    const size_t lColon = lHostPort.rfind(':');
+    char *lEnd = nullptr;
+    const unsigned long lPort =
+        lColon == std::string::npos ? 0 : std::strtoul(lHostPort.c_str() + lColon + 1, &lEnd, 10);
+    if (lColon == std::string::npos || lEnd == nullptr || *lEnd != '\0' || lPort == 0 || lPort > 65535)
+    {
+        *aError = "expected tcp:HOST:PORT, got " + aSpec;
+        return false;
+    }
+
+    std::string lHost = lHostPort.substr(0, lColon);
+    if (lHost.empty() || lHost == "*")
+        lHost = "0.0.0.0";
+    else if (lHost == "localhost")
+        lHost = "127.0.0.1";
+
+    sockaddr_in *lInet = reinterpret_cast<sockaddr_in *>(&aAddress->puStorage);
+    lInet->sin_family = AF_INET;
+    lInet->sin_port = htons(static_cast<uint16_t>(lPort));
+    if (::inet_pton(AF_INET, lHost.c_str(), &lInet->sin_addr) != 1)
+    {
+        *aError = "bad IPv4 address: " + lHost;
+        return false;
+    }
+    aAddress->puLength = sizeof(sockaddr_in);
+    aAddress->puTcp = true;
+    return true;
+}
+
+} // namespace readerd
@@ -0,0 +1,240 @@
+#include "readerd/Tracer.h"
+
+#include <algorithm>
+
+namespace readerd {
+
+namespace {
+
+const int kStageCount = TRACE_DOCUMENT + 1;
+
+bool startsWith(const std::string &aText, const char *aPrefix)
+{
+    return aText.compare(0, std::char_traits<char>::length(aPrefix), aPrefix) == 0;
+}
+
+} // namespace
+
+const char *traceStageName(TraceStage aStage)
+{
+    switch (aStage)
+    {
+    case TRACE_DETECT: return "detect";
+    case TRACE_CAPTURE: return "capture";
+    case TRACE_OCR: return "ocr";
+    case TRACE_RF: return "rf";
+    case TRACE_PLUGINS: return "plugins";
+    case TRACE_PROCESS: return "process";
+    case TRACE_DOCUMENT: return "document";
+    }
+    return "unknown";
+}
+
+Tracer::Tracer(size_t aMaxDocuments)
+    : prOrigin(std::chrono::steady_clock::now())
+    , prMaxDocuments(aMaxDocuments)
+{
+}
+
+double Tracer::now() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - prOrigin).count();
+}
+
+TraceStage Tracer::stageOf(MMMReaderDataType aDataType)
+{
+    if (aDataType >= CD_PLUGIN)
+        return TRACE_PLUGINS;
+
+    switch (aDataType)
+    {
+    case CD_IMAGEIR:
+    case CD_IMAGEIRREAR:
+    case CD_IMAGEVIS:
+    case CD_IMAGEVISREAR:
+    case CD_IMAGEVIS_OVD1:
+    case CD_IMAGEVIS_OVD2:
+    case CD_IMAGEUV:
+    case CD_IMAGEUVREAR:
+    case CD_IMAGECOAXVIS:
+    case CD_IMAGECOAXIR:
+    case CD_IMAGEBARCODE:
+    case CD_IMAGEBARCODEREAR:
+        return TRACE_CAPTURE;
+    case CD_CODELINE:
+    case CD_CODELINE_DATA:
+    case CD_CHECKSUM:
+    case CD_CHECKSUMEXTENDED:
+        return TRACE_OCR;
+    case CD_BACKEY_CORRECTION:
+    case CD_ACTIVE_AUTHENTICATION:
+    case CD_VALIDATE_DOC_SIGNER_CERT:
+    case CD_PASSIVE_AUTHENTICATION:
+    case CD_SAC_STATUS:
+    case CD_EFCOM_DG_MAP:
+    case CD_EFSOD_HASH_MAP:
+    case CD_DOC_SIGNER_CERT:
+        return TRACE_RF;
+    default:
+        break;
+    }
+
+    // The chip items all share the CD_SC prefix (CD_SCDG2_FILE, CD_SCBAC_STATUS, ...).
+    return startsWith(dataTypeName(aDataType), "CD_SC") ? TRACE_RF : TRACE_PROCESS;
+}
+
+void Tracer::onData(const DataItem &aItem)
+{
+    const double lNow = now();
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    auto lOpen = prOpen.find(aItem.document());
+    if (lOpen == prOpen.end())
+        return;
+
+    OpenDocument &lDocument = lOpen->second;
+    TraceSpan lSpan{stageOf(aItem.type()), dataTypeName(aItem.type()), lDocument.puLastMarkUs, lNow, aItem.size()};
+    lDocument.puTrace.puSpans.push_back(std::move(lSpan));
+    lDocument.puLastMarkUs = lNow;
+}
+
+void Tracer::onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument)
+{
+    const double lNow = now();
+
+    std::lock_guard<std::mutex> lLock(prMutex);
+    if (aEventCode == DOC_ON_WINDOW)
+    {
+        // Raised before START_OF_DOCUMENT_DATA, while the daemon still reports the previous
+        // document number; remembered until the next document opens.
+        prDocOnWindowUs = lNow;
+        return;
+    }
+
+    if (aEventCode == START_OF_DOCUMENT_DATA)
+    {
+        OpenDocument &lDocument = prOpen[aDocument];
+        lDocument = OpenDocument();
+        lDocument.puTrace.puDocument = aDocument;
+        lDocument.puStartUs = prDocOnWindowUs >= 0.0 ? prDocOnWindowUs : lNow;
+        lDocument.puLastMarkUs = lNow;
+        if (prDocOnWindowUs >= 0.0)
+            lDocument.puTrace.puSpans.push_back(TraceSpan{TRACE_DETECT, "detect", prDocOnWindowUs, lNow});
+        lDocument.puTrace.puEvents.emplace_back(lNow, aEventCode);
+        prDocOnWindowUs = -1.0;
+        return;
+    }
+
+    auto lOpen = prOpen.find(aDocument);
+    if (lOpen == prOpen.end())
+        return;
+    OpenDocument &lDocument = lOpen->second;
+    lDocument.puTrace.puEvents.emplace_back(lNow, aEventCode);
+
+    switch (aEventCode)
+    {
+    case RF_CHIP_OPENED_SUCCESSFULLY:
+    case RF_APPLICATION_OPENED_SUCCESSFULLY:
+    case RF_CHIP_OPEN_FAILED:
+    case RF_CHIP_OPEN_TIMEOUT:
+        lDocument.puTrace.puSpans.push_back(TraceSpan{TRACE_RF, eventCodeName(aEventCode), lDocument.puLastMarkUs, lNow});
+        lDocument.puLastMarkUs = lNow;
+        break;
+    case START_OF_PLUGINS_DECODE:
+        lDocument.puLastMarkUs = lNow;
+        break;
+    case END_OF_DOCUMENT_DATA:
+        finish(lDocument, lNow);
+        prOpen.erase(lOpen);
+        break;
+    default:
+        break;
+    }
+}
+
+void Tracer::finish(OpenDocument &aDocument, double aEndUs)
+{
+    TracedDocument &lTrace = aDocument.puTrace;
+
+    // One span per stage, covering the items attributed to it.
+    double lStart[kStageCount];
+    double lEnd[kStageCount];
+    uint64_t lBytes[kStageCount] = {};
+    std::fill(lStart, lStart + kStageCount, -1.0);
+    std::fill(lEnd, lEnd + kStageCount, -1.0);
+    for (const TraceSpan &lSpan : lTrace.puSpans)
+    {
+        const int lStage = lSpan.puStage;
+        if (lStart[lStage] < 0.0 || lSpan.puStartUs < lStart[lStage])
+            lStart[lStage] = lSpan.puStartUs;
+        lEnd[lStage] = std::max(lEnd[lStage], lSpan.puEndUs);
+        lBytes[lStage] += lSpan.puBytes;
+    }
+    for (int lStage = TRACE_CAPTURE; lStage < TRACE_PROCESS; ++lStage)
+    {
+        if (lStart[lStage] >= 0.0)
+        {
+            const TraceStage lTraceStage = static_cast<TraceStage>(lStage);
+            lTrace.puSpans.push_back(
+                TraceSpan{lTraceStage, traceStageName(lTraceStage), lStart[lStage], lEnd[lStage], lBytes[lStage]});
+        }
+    }
+
+    uint64_t lTotalBytes = 0;
+    for (int lStage = 0; lStage < kStageCount; ++lStage)
+        lTotalBytes += lBytes[lStage];
+    lTrace.puSpans.push_back(TraceSpan{TRACE_DOCUMENT, "document", aDocument.puStartUs, aEndUs, lTotalBytes});
+
+    prCompleted.push_back(std::move(lTrace));
+    while (prCompleted.size() > prMaxDocuments)
+        prCompleted.pop_front();
+}
+
+std::vector<TracedDocument> Tracer::documents() const
+{
+    std::lock_guard<std::mutex> lLock(prMutex);
+    return std::vector<TracedDocument>(prCompleted.begin(), prCompleted.end());
+}
+
+void Tracer::writeChromeTrace(std::FILE *aFile) const
+{
+    const std::vector<TracedDocument> lDocuments = documents();
+
+    std::fprintf(aFile, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool lFirst = true;
+    auto lSeparator = [&lFirst, aFile] {
+        if (!lFirst)
+            std::fputs(",\n", aFile);
+        lFirst = false;
+    };
+
+    for (const TracedDocument &lDocument : lDocuments)
+    {
+        lSeparator();
+        std::fprintf(aFile,
+            "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"document %u\"}}",
+            lDocument.puDocument, lDocument.puDocument);
+
+        for (const TraceSpan &lSpan : lDocument.puSpans)
+        {
+            lSeparator();
+            std::fprintf(aFile,
+                "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,"
+                "\"args\":{\"bytes\":%llu}}",
+                lSpan.puName.c_str(), traceStageName(lSpan.puStage), lDocument.puDocument,
+                lSpan.puStartUs, lSpan.puEndUs - lSpan.puStartUs,
+                static_cast<unsigned long long>(lSpan.puBytes));
+        }
+
+        for (const auto &lEvent : lDocument.puEvents)
+        {
+            lSeparator();
+            std::fprintf(aFile,
+                "{\"name\":\"%s\",\"cat\":\"event\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                eventCodeName(lEvent.second).c_str(), lDocument.puDocument, lEvent.first);
+        }
+    }
+    std::fprintf(aFile, "\n]}\n");
+}
+
+} // namespace readerd
@@ -0,0 +1,101 @@
+#include "readerd/WorkerProcess.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <memory>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+namespace readerd {
+
+pid_t spawnWorker(const std::vector<std::string> &aArguments, const std::vector<int> &aCpus, int aInheritFd,
+                  std::string *aError)
+{
+    std::vector<std::string> lArguments = aArguments;
+    std::vector<char *> lArgv;
+    for (std::string &lArgument : lArguments)
+        lArgv.push_back(lArgument.data());
+    lArgv.push_back(nullptr);
+
+    cpu_set_t lSet;
+    CPU_ZERO(&lSet);
+    for (int lCpu : aCpus)
+        CPU_SET(lCpu, &lSet);
+
+    // Everything the child needs is built above: after fork() only async-signal-safe calls.
+    const pid_t lPid = fork();
+    if (lPid == 0)
+    {
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (!aCpus.empty())
+            sched_setaffinity(0, sizeof(lSet), &lSet);
+        if (aInheritFd >= 0)
+            fcntl(aInheritFd, F_SETFD, 0);
+        execvp(lArgv[0], lArgv.data());
+        _exit(127);
+    }
+    if (lPid < 0)
+        *aError = std::string("fork: ") + std::strerror(errno);
+    return lPid;
+}
+
+std::string workerSocketPath(const char *aKind, uint32_t aIndex)
+{
+    return std::filesystem::temp_directory_path().string() + "/readerd-" + aKind + "-" + std::to_string(getpid())
+           + "-" + std::to_string(aIndex) + ".sock";
+}
+
+DocumentRelay::DocumentRelay(ResultServer &aServer, std::atomic<uint32_t> &aNextDocument)
+    : prServer(aServer)
+    , prNextDocument(aNextDocument)
+{
+}
+
+void DocumentRelay::setScanner(uint32_t aLane, const std::string &aSerial)
+{
+    prLane = aLane;
+    prScanner = DataRef::copyOf(aSerial.data(), aSerial.size());
+}
+
+uint32_t DocumentRelay::relay(Frame &aFrame)
+{
+    // Hand the frame buffer over to the published records; readFrame() starts a new one.
+    auto lBuffer = std::make_shared<std::vector<uint8_t>>(std::move(aFrame.puBytes));
+    aFrame.puBytes = std::vector<uint8_t>();
+    const DataRef lBytes = DataRef::adopt(std::shared_ptr<const uint8_t[]>(lBuffer, lBuffer->data()),
+                                          lBuffer->size());
+
+    uint32_t lEnded = 0;
+    for (const FrameRecord &lRecord : aFrame.puRecords)
+    {
+        RecordHeader lHeader = lRecord.puHeader;
+        if (!prHaveDocument || lHeader.puDocument != prLocalDocument)
+        {
+            prHaveDocument = true;
+            prLocalDocument = lHeader.puDocument;
+            prDocument = ++prNextDocument;
+        }
+        lHeader.puDocument = prDocument;
+        prServer.publish(lHeader, lRecord.puPayload.empty()
+                                      ? DataRef()
+                                      : lBytes.slice(lRecord.puPayload.data() - lBuffer->data(),
+                                                     lRecord.puPayload.size()));
+
+        if (lHeader.puKind != RK_EVENT)
+            continue;
+        if (lHeader.puCode == START_OF_DOCUMENT_DATA && !prScanner.empty())
+        {
+            prServer.publish(RecordHeader{RK_SCANNER, prLane, prDocument, static_cast<uint32_t>(prScanner.size())},
+                             prScanner);
+        }
+        else if (lHeader.puCode == END_OF_DOCUMENT_DATA)
+            ++lEnded;
+    }
+    return lEnded;
+}
+
+} // namespace readerd
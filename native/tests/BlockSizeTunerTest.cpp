@@ -0,0 +1,203 @@
+#include "readerd/BlockSizeTuner.h"
+
+#include "TestSupport.h"
+
+#include <ctime>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+/// A chip whose APDUs take 10 ms plus 1 ms per 100 bytes, so larger blocks read faster, and
+/// which fails every read with a block above puMaxBlock.
+class FakeChip : public RfChip
+{
+public:
+    int puMaxBlock = 4064;
+    size_t puFileBytes = 20000;
+    int puFailures = 0;
+
+    const char *name() const override { return "fake"; }
+    MMMReaderErrorCode waitForOpen(const char *, int) override { return NO_ERROR_OCCURRED; }
+    MMMReaderErrorCode powerOff() override { return NO_ERROR_OCCURRED; }
+    MMMReaderErrorCode getChipId(std::string *aId) override
+    {
+        *aId = "fake";
+        return NO_ERROR_OCCURRED;
+    }
+    MMMReaderErrorCode checkActiveAuthentication(int *aResult) override
+    {
+        *aResult = 0;
+        return NO_ERROR_OCCURRED;
+    }
+
+    MMMReaderErrorCode getFile(MMMReaderRFItem, std::vector<uint8_t> *aBytes) override
+    {
+        if (prBlock > puMaxBlock)
+        {
+            ++puFailures;
+            prApduMs += 10;
+            return ERROR_RF_GET_DATA_ITEM_FAILED;
+        }
+        const int lApdus = static_cast<int>((puFileBytes + prBlock - 1) / prBlock);
+        prApduMs += lApdus * (10 + prBlock / 100);
+        prBytesRead += static_cast<int>(puFileBytes);
+        aBytes->assign(puFileBytes, 0x5A);
+        return NO_ERROR_OCCURRED;
+    }
+
+    MMMReaderErrorCode getTransferCounters(int *aApduMs, int *aBytesRead) override
+    {
+        *aApduMs = prApduMs;
+        *aBytesRead = prBytesRead;
+        return NO_ERROR_OCCURRED;
+    }
+
+    int readBlockSize() const override { return prBlock; }
+    MMMReaderErrorCode setReadBlockSize(int aBytes) override
+    {
+        prBlock = aBytes;
+        return NO_ERROR_OCCURRED;
+    }
+
+private:
+    int prBlock = kMaxShortReadBlock;
+    int prApduMs = 0;
+    int prBytesRead = 0;
+};
+
+/// Reads \a aFiles files of a new chip like \a aChip in a session of profile \a aKey.
+void read(BlockSizeTuner *aTuner, FakeChip *aChip, const std::string &aKey, int aFiles)
+{
+    aChip->setReadBlockSize(kMaxShortReadBlock);
+    READERD_CHECK(aTuner->begin(*aChip, aKey) == NO_ERROR_OCCURRED);
+    std::vector<uint8_t> lBytes;
+    for (int i = 0; i < aFiles; ++i)
+    {
+        READERD_CHECK(aTuner->getFile(*aChip, RFID_DG2, &lBytes) == NO_ERROR_OCCURRED);
+        READERD_CHECK(lBytes.size() == aChip->puFileBytes);
+    }
+}
+
+void testClimbs()
+{
+    BlockSizeTuner lTuner;
+    FakeChip lChip;
+    READERD_CHECK(lTuner.blockSize() == 0);
+    read(&lTuner, &lChip, "fast", 1);
+    READERD_CHECK(lTuner.blockSize() == 480);
+    read(&lTuner, &lChip, "fast", 8);
+    READERD_CHECK(lTuner.blockSize() == 4064);
+
+    // A new chip of the kind starts where the last one ended.
+    read(&lTuner, &lChip, "fast", 0);
+    READERD_CHECK(lChip.readBlockSize() == 4064);
+    read(&lTuner, &lChip, "other", 0);
+    READERD_CHECK(lChip.readBlockSize() == kMaxShortReadBlock);
+}
+
+void testCeiling()
+{
+    BlockSizeTuner lTuner;
+    FakeChip lChip;
+    lChip.puMaxBlock = 480;
+
+    // Every failure at 992 reads the file again below it; only repeated ones stop the tries.
+    for (int i = 0; i < 10; ++i)
+        read(&lTuner, &lChip, "limited", 3);
+    READERD_CHECK(lChip.puFailures == kBlockCeilingFailures);
+    READERD_CHECK(lTuner.blockSize() == 480);
+
+    // A read that works at the size, even one too short to measure, starts the count again.
+    BlockSizeTuner lFlaky;
+    FakeChip lFlakyChip;
+    lFlakyChip.puMaxBlock = 480;
+    read(&lFlaky, &lFlakyChip, "flaky", 3);
+    read(&lFlaky, &lFlakyChip, "flaky", 1);
+    READERD_CHECK(lFlakyChip.puFailures == kBlockCeilingFailures - 1);
+    lFlakyChip.puMaxBlock = 4064;
+    lFlakyChip.puFileBytes = 1000;
+    read(&lFlaky, &lFlakyChip, "flaky", 1);
+    READERD_CHECK(lFlaky.blockSize() == 992);
+    lFlakyChip.puMaxBlock = 480;
+    lFlakyChip.puFileBytes = 20000;
+    for (int i = 0; i < 10; ++i)
+        read(&lFlaky, &lFlakyChip, "flaky", 3);
+    READERD_CHECK(lFlakyChip.puFailures == 2 * kBlockCeilingFailures - 1);
+}
+
+void testSaveLoad()
+{
+    TempDirectory lDirectory;
+    const std::string lPath = lDirectory.file("blocks.txt");
+    std::string lError;
+
+    BlockSizeTuner lTuner;
+    FakeChip lChip;
+    lChip.puMaxBlock = 480;
+    for (int i = 0; i < 6; ++i)
+        read(&lTuner, &lChip, "limited", 3);
+    read(&lTuner, &lChip, "fast-key", 0);
+    READERD_CHECK(lTuner.save(lPath, &lError) == NO_ERROR_OCCURRED);
+
+    // The ceiling is kept with the profile.
+    BlockSizeTuner lLoaded;
+    READERD_CHECK(lLoaded.load(lPath, &lError) == NO_ERROR_OCCURRED);
+    const int lFailures = lChip.puFailures;
+    read(&lLoaded, &lChip, "limited", 6);
+    READERD_CHECK(lChip.puFailures == lFailures);
+    READERD_CHECK(lLoaded.blockSize() == 480);
+
+    // A ceiling past kBlockCeilingSeconds is lifted, and the sizes above it tried again.
+    const auto lProfile = [](int64_t aCeilingTime) {
+        return "limited\t2 1 10 20 0 0 0 0 " + std::to_string(aCeilingTime) + " 0 0 3 0 0 0\n";
+    };
+    const int64_t lNow = static_cast<int64_t>(std::time(nullptr));
+    writeFile(lPath, bytes(lProfile(lNow - kBlockCeilingSeconds + 3600)));
+    BlockSizeTuner lRecent;
+    READERD_CHECK(lRecent.load(lPath, &lError) == NO_ERROR_OCCURRED);
+    lChip.puMaxBlock = 4064;
+    read(&lRecent, &lChip, "limited", 1);
+    READERD_CHECK(lRecent.blockSize() == 224);
+
+    writeFile(lPath, bytes(lProfile(lNow - kBlockCeilingSeconds - 1)));
+    BlockSizeTuner lExpired;
+    READERD_CHECK(lExpired.load(lPath, &lError) == NO_ERROR_OCCURRED);
+    read(&lExpired, &lChip, "limited", 1);
+    READERD_CHECK(lExpired.blockSize() == 480);
+
+    for (const char *lBad : {"limited\t2 1\n", "no tab\n", "limited\t9 1 0 0 0 0 0 0 0 0 0 0 0 0 0\n",
+                             "limited\t2 2 0 0 0 0 0 0 0 0 0 0 0 0 0\n"})
+    {
+        writeFile(lPath, bytes(lBad));
+        BlockSizeTuner lInvalid;
+        READERD_CHECK(lInvalid.load(lPath, &lError) == ERROR_INVALID_CONFIG_FILE_FORMAT);
+    }
+    BlockSizeTuner lMissing;
+    READERD_CHECK(lMissing.load(lDirectory.file("missing"), &lError) == NO_ERROR_OCCURRED);
+}
+
+void testProfileKey()
+{
+    SecurityObject lObject;
+    lObject.puAlgorithm = DA_SHA256;
+    const std::string lNoSigner = blockProfileKey(&lObject);
+    lObject.puSignerIssuer = name("CSCA Utopia");
+    const std::string lUtopia = blockProfileKey(&lObject);
+    lObject.puSignerIssuer = name("CSCA Elsewhere");
+    READERD_CHECK(blockProfileKey(nullptr) == "default");
+    READERD_CHECK(lNoSigner != lUtopia && lUtopia != blockProfileKey(&lObject));
+    READERD_CHECK(lUtopia.find_first_of("\t\n") == std::string::npos);
+}
+
+} // namespace
+
+int main()
+{
+    testClimbs();
+    testCeiling();
+    testSaveLoad();
+    testProfileKey();
+    return failures() == 0 ? 0 : 1;
+}
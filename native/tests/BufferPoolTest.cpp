@@ -0,0 +1,133 @@
+#include "readerd/BufferPool.h"
+#include "readerd/DataSlab.h"
+
+#include "TestSupport.h"
+
+#include <thread>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+void testClassSize()
+{
+    READERD_CHECK(BufferPool::classSize(0) == 4096);
+    READERD_CHECK(BufferPool::classSize(4096) == 4096);
+    READERD_CHECK(BufferPool::classSize(4097) == 5120);
+    READERD_CHECK(BufferPool::classSize(8192) == 8192);
+    READERD_CHECK(BufferPool::classSize(8193) == 10240);
+    for (size_t lSize = 4097; lSize < (1u << 24); lSize = lSize * 9 / 8 + 1)
+    {
+        const size_t lClass = BufferPool::classSize(lSize);
+        if (!READERD_CHECK(lClass >= lSize && lClass - lSize <= lSize / 4)
+            || !READERD_CHECK(BufferPool::classSize(lClass) == lClass))
+        {
+            std::fprintf(stderr, "  at %zu\n", lSize);
+        }
+    }
+}
+
+void testReuse()
+{
+    BufferPool lPool;
+    uint8_t *lFirst = nullptr;
+    {
+        std::shared_ptr<uint8_t[]> lBuffer = lPool.acquire(10000);
+        lFirst = lBuffer.get();
+        READERD_CHECK(lPool.stats().puInUseBytes == 10240 && lPool.stats().puCachedBytes == 0);
+    }
+    READERD_CHECK(lPool.stats().puInUseBytes == 0 && lPool.stats().puCachedBytes == 10240);
+
+    // Any size of the same class gets the same buffer back; another class does not.
+    std::shared_ptr<uint8_t[]> lSame = lPool.acquire(9000);
+    std::shared_ptr<uint8_t[]> lOther = lPool.acquire(20000);
+    READERD_CHECK(lSame.get() == lFirst && lOther.get() != lFirst);
+    READERD_CHECK(lPool.stats().puHits == 1 && lPool.stats().puMisses == 2);
+
+    // Buffers handed to DataRef come back too.
+    const Bytes lData(9500, 0x42);
+    lSame.reset();
+    {
+        const DataRef lRef = DataRef::copyOf(lData.data(), lData.size(), &lPool);
+        READERD_CHECK(lRef.data() == lFirst && Bytes(lRef.bytes().begin(), lRef.bytes().end()) == lData);
+        const DataRef lSlice = lRef.slice(100, 10);
+        READERD_CHECK(lSlice.data() == lFirst + 100 && lSlice.useCount() == 2);
+    }
+    READERD_CHECK(lPool.stats().puInUseBytes == BufferPool::classSize(20000));
+}
+
+void testLimits()
+{
+    // Nothing is cached beyond the pool's limit.
+    BufferPool lSmall(16384);
+    {
+        std::shared_ptr<uint8_t[]> lFirst = lSmall.acquire(10000);
+        std::shared_ptr<uint8_t[]> lSecond = lSmall.acquire(10000);
+    }
+    READERD_CHECK(lSmall.stats().puCachedBytes == 10240);
+
+    // A document boundary keeps twice what was in use at most since the one before.
+    const size_t lClass = BufferPool::classSize(100000);
+    BufferPool lPool;
+    {
+        std::shared_ptr<uint8_t[]> lBuffers[3] = {lPool.acquire(100000), lPool.acquire(100000), lPool.acquire(100000)};
+    }
+    lPool.endOfDocument();
+    READERD_CHECK(lPool.stats().puCachedBytes == 3 * lClass);
+    lPool.acquire(100000).reset();
+    lPool.endOfDocument();
+    READERD_CHECK(lPool.stats().puCachedBytes == 2 * lClass);
+
+    // Buffers still held at the boundary count for the next document.
+    std::shared_ptr<uint8_t[]> lHeld = lPool.acquire(100000);
+    lPool.endOfDocument();
+    lPool.endOfDocument();
+    READERD_CHECK(lPool.stats().puCachedBytes == lClass);
+}
+
+void testOutlivesPool()
+{
+    std::shared_ptr<uint8_t[]> lBuffer;
+    {
+        BufferPool lPool;
+        lBuffer = lPool.acquire(5000);
+    }
+    lBuffer[4999] = 1;
+    lBuffer.reset();
+}
+
+void testThreads()
+{
+    BufferPool lPool;
+    std::vector<std::thread> lThreads;
+    for (int t = 0; t < 4; ++t)
+    {
+        lThreads.emplace_back([&lPool, t] {
+            for (int i = 0; i < 2000; ++i)
+            {
+                std::shared_ptr<uint8_t[]> lBuffer = lPool.acquire(4096 + (i % 7) * 3000);
+                lBuffer[0] = static_cast<uint8_t>(t);
+                if (i % 100 == 0)
+                    lPool.endOfDocument();
+            }
+        });
+    }
+    for (std::thread &lThread : lThreads)
+        lThread.join();
+    const BufferPool::Stats lStats = lPool.stats();
+    READERD_CHECK(lStats.puInUseBytes == 0);
+    READERD_CHECK(lStats.puHits + lStats.puMisses == 8000 && lStats.puHits > lStats.puMisses);
+}
+
+} // namespace
+
+int main()
+{
+    testClassSize();
+    testReuse();
+    testLimits();
+    testOutlivesPool();
+    testThreads();
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#include "readerd/CertificateStore.h"
+#include "readerd/TlvReader.h"
+
+#include "TestSupport.h"
+
+#include <algorithm>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+Bytes masterList(std::initializer_list<Bytes> aCertificates)
+{
+    const Bytes lCertificates = der(0x31, aCertificates);
+    const Bytes lList = der(0x30, {der(0x02, {{0x00}}), lCertificates});
+    const Bytes lEncap = der(0x30, {der(0x06, {{0x67, 0x81, 0x08, 0x01, 0x01, 0x02}}), der(0xA0, {der(0x04, {lList})})});
+    const Bytes lSignedData = der(0x30, {der(0x02, {{0x03}}), der(0x31, {}), lEncap});
+    return der(0x30, {der(0x06, {{0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02}}), der(0xA0, {lSignedData})});
+}
+
+void testParseCertificate()
+{
+    const Bytes lDer = certificate({0x05, 0x39}, "CSCA Utopia", "DS Utopia", {0xAA, 0xBB, 0xCC});
+    CertificateFields lFields;
+    READERD_CHECK(parseCertificate(lDer, &lFields));
+    READERD_CHECK(equal(lFields.puDer, lDer));
+    READERD_CHECK(equal(lFields.puIssuer, name("CSCA Utopia")));
+    READERD_CHECK(equal(lFields.puSubject, name("DS Utopia")));
+    READERD_CHECK(equal(lFields.puSerial, Bytes({0x05, 0x39})));
+    READERD_CHECK(equal(lFields.puKeyId, Bytes({0xAA, 0xBB, 0xCC})));
+
+    READERD_CHECK(parseCertificate(certificate({0x01}, "A", "B"), &lFields) && lFields.puKeyId.empty());
+
+    for (size_t lLength = 0; lLength < lDer.size(); ++lLength)
+        READERD_CHECK(!parseCertificate(std::span<const uint8_t>(lDer).first(lLength), &lFields));
+    Bytes lTrailing = lDer;
+    lTrailing.push_back(0x00);
+    READERD_CHECK(!parseCertificate(lTrailing, &lFields));
+    Bytes lOverlong = lDer;
+    lOverlong[1] = 0x84;    // A length of four bytes that runs past the end.
+    READERD_CHECK(!parseCertificate(lOverlong, &lFields));
+    READERD_CHECK(!parseCertificate(der(0x30, {der(0x30, {der(0x02, {{0x01}})})}), &lFields));
+}
+
+void testParseMasterList()
+{
+    const Bytes lFirst = certificate({0x01}, "CSCA A", "CSCA A", {0x01});
+    const Bytes lSecond = certificate({0x02}, "CSCA B", "CSCA B", {0x02});
+    const Bytes lList = masterList({lFirst, lSecond});
+
+    std::vector<std::span<const uint8_t>> lCertificates;
+    READERD_CHECK(parseMasterList(lList, &lCertificates));
+    READERD_CHECK(lCertificates.size() == 2 && equal(lCertificates[0], lFirst) && equal(lCertificates[1], lSecond));
+
+    for (size_t lLength = 0; lLength < lList.size(); lLength += 5)
+    {
+        lCertificates.clear();
+        READERD_CHECK(!parseMasterList(std::span<const uint8_t>(lList).first(lLength), &lCertificates));
+    }
+    // Content types other than signedData and cscaMasterList.
+    for (const Bytes &lOid : {Bytes{0x2A, 0x86, 0x48, 0x86, 0xF7, 0x0D, 0x01, 0x07, 0x02}, Bytes{0x67, 0x81, 0x08}})
+    {
+        Bytes lWrongType = lList;
+        const auto lAt = std::search(lWrongType.begin(), lWrongType.end(), lOid.begin(), lOid.end());
+        READERD_CHECK(lAt != lWrongType.end());
+        lAt[lOid.size() - 1] ^= 0x01;
+        READERD_CHECK(!parseMasterList(lWrongType, &lCertificates));
+    }
+    READERD_CHECK(!parseMasterList(lFirst, &lCertificates));
+}
+
+void testStore()
+{
+    TempDirectory lDirectory;
+    const Bytes lCsca = certificate({0x11}, "CSCA Utopia", "CSCA Utopia", {0xC5, 0xCA});
+    const Bytes lSigner = certificate({0x22, 0x01}, "CSCA Utopia", "DS Utopia", {0xD5});
+    const Bytes lListed = certificate({0x33}, "CSCA Listed", "CSCA Listed", {0x1D});
+    writeFile(lDirectory.file("csca.cer"), lCsca);
+    writeFile(lDirectory.file("ds.der"), lSigner);
+    writeFile(lDirectory.file("list.ml"), masterList({lListed, lCsca}));
+    writeFile(lDirectory.file("junk.cer"), bytes("not a certificate"));
+    writeFile(lDirectory.file("ignored.txt"), lListed);
+
+    CertificateSource lSource;
+    lSource.puDirectory = lDirectory.path();
+    CertificateBuildStats lStats;
+    std::string lError;
+    const std::string lPath = lDirectory.file("certificates.store");
+    READERD_CHECK(CertificateStore::build(lSource, lPath, &lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puFiles == 4);
+    READERD_CHECK(lStats.puCertificates == 3);
+    READERD_CHECK(lStats.puDuplicates == 1);
+    READERD_CHECK(lStats.puSkipped == 1);
+
+    CertificateStore lStore;
+    READERD_CHECK(lStore.open(lPath, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStore.size() == 3);
+    READERD_CHECK(equal(lStore.find(CK_SUBJECT_KEY_ID, Bytes({0xC5, 0xCA})), lCsca));
+    READERD_CHECK(equal(lStore.find(CK_SUBJECT, name("CSCA Listed")), lListed));
+    READERD_CHECK(lStore.find(CK_SUBJECT_KEY_ID, Bytes({0xC5})).empty());
+    READERD_CHECK(lStore.find(CK_SUBJECT, name("Nobody")).empty());
+
+    // As the SDK names the document signer: an IssuerAndSerialNumber, or [0] a key identifier.
+    READERD_CHECK(equal(lStore.findSigner(der(0x30, {name("CSCA Utopia"), der(0x02, {{0x22, 0x01}})})), lSigner));
+    READERD_CHECK(equal(lStore.findSigner(der(0x80, {{0xD5}})), lSigner));
+    READERD_CHECK(lStore.findSigner(der(0x30, {name("CSCA Utopia"), der(0x02, {{0x22}})})).empty());
+    READERD_CHECK(equal(lStore.findAuthority(der(0x30, {der(0x80, {{0xC5, 0xCA}})})), lCsca));
+    lStore.close();
+
+    TempDirectory lEmpty;
+    writeFile(lEmpty.file("store"), bytes("RDCS but not a store"));
+    READERD_CHECK(lStore.open(lEmpty.file("store"), &lError) != NO_ERROR_OCCURRED);
+    READERD_CHECK(lStore.open(lEmpty.file("missing"), &lError) != NO_ERROR_OCCURRED);
+    lSource.puDirectory = lEmpty.file("missing");
+    READERD_CHECK(CertificateStore::build(lSource, lPath, &lStats, &lError) == ERROR_READING_FILE);
+}
+
+} // namespace
+
+int main()
+{
+    testParseCertificate();
+    testParseMasterList();
+    testStore();
+    return failures() == 0 ? 0 : 1;
+}
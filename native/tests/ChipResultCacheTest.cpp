@@ -0,0 +1,264 @@
+#include "readerd/ChipResultCache.h"
+#include "readerd/RfReader.h"
+
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+using std::chrono::milliseconds;
+
+/// The files of one chip. Without libcrypto the digests are stand-ins that are never checked.
+struct Passport
+{
+    Bytes puEfCom;
+    Bytes puEfSod;
+    std::array<Bytes, kMaxDataGroup + 1> puGroups;
+};
+
+Passport passport(uint8_t aSeed)
+{
+    Passport lPassport;
+    SecurityObject lObject;
+    lObject.puAlgorithm = DA_SHA256;
+    for (int lGroup : {1, 2, 15})
+    {
+        lPassport.puGroups[lGroup] = Bytes(100 * lGroup, static_cast<uint8_t>(aSeed + lGroup));
+        if (!computeDigest(DA_SHA256, lPassport.puGroups[lGroup], &lObject.puDigests[lGroup]))
+            lObject.puDigests[lGroup] = Bytes(32, static_cast<uint8_t>(aSeed + lGroup));
+    }
+    lPassport.puEfCom = buildEfCom({1, 2, 15});
+    lPassport.puEfSod = buildEfSod(lObject);
+    return lPassport;
+}
+
+/// Serves the files of a Passport, records which it was asked for, and passes or fails
+/// Active Authentication as told.
+class FakeChip : public RfChip
+{
+public:
+    explicit FakeChip(const Passport &aPassport)
+        : prPassport(aPassport)
+    {
+    }
+
+    int puActiveAuthentication = RFID_VC_VALID;
+    std::vector<MMMReaderRFItem> puReads;
+
+    const char *name() const override { return "fake"; }
+    MMMReaderErrorCode waitForOpen(const char *, int) override { return NO_ERROR_OCCURRED; }
+    MMMReaderErrorCode powerOff() override { return NO_ERROR_OCCURRED; }
+    MMMReaderErrorCode getChipId(std::string *aId) override
+    {
+        *aId = "fake";
+        return NO_ERROR_OCCURRED;
+    }
+    MMMReaderErrorCode checkActiveAuthentication(int *aResult) override
+    {
+        *aResult = puActiveAuthentication;
+        return NO_ERROR_OCCURRED;
+    }
+
+    MMMReaderErrorCode getFile(MMMReaderRFItem aItem, std::vector<uint8_t> *aBytes) override
+    {
+        puReads.push_back(aItem);
+        if (aItem == RFID_EF_COM)
+            *aBytes = prPassport.puEfCom;
+        else if (aItem == RFID_EF_SOD)
+            *aBytes = prPassport.puEfSod;
+        else
+        {
+            for (int lGroup = 1; lGroup <= kMaxDataGroup; ++lGroup)
+            {
+                if (dataGroupItem(lGroup) == aItem && !prPassport.puGroups[lGroup].empty())
+                {
+                    *aBytes = prPassport.puGroups[lGroup];
+                    return NO_ERROR_OCCURRED;
+                }
+            }
+            return ERROR_RF_DG_NOT_PRESENT;
+        }
+        return NO_ERROR_OCCURRED;
+    }
+
+    MMMReaderErrorCode getTransferCounters(int *aApduMs, int *aBytesRead) override
+    {
+        *aApduMs = 0;
+        *aBytesRead = 0;
+        return NO_ERROR_OCCURRED;
+    }
+    int readBlockSize() const override { return kMaxShortReadBlock; }
+    MMMReaderErrorCode setReadBlockSize(int) override { return NO_ERROR_OCCURRED; }
+
+private:
+    Passport prPassport;
+};
+
+/// The data items a read raises, in order.
+struct Items
+{
+    std::mutex puMutex;
+    std::vector<std::pair<int, Bytes>> puItems;
+
+    static void record(void *aParam, MMMReaderDataType aDataType, int aDataLen, void *aDataPtr)
+    {
+        Items *lItems = static_cast<Items *>(aParam);
+        const uint8_t *lData = static_cast<const uint8_t *>(aDataPtr);
+        std::lock_guard<std::mutex> lLock(lItems->puMutex);
+        lItems->puItems.emplace_back(aDataType, Bytes(lData, lData + aDataLen));
+    }
+};
+
+/// Reads \a aChip through \a aReader; returns the items raised.
+std::vector<std::pair<int, Bytes>> read(RfReader *aReader, FakeChip *aChip, RfReadStats *aStats)
+{
+    Items lItems;
+    READERD_CHECK(aReader->read(*aChip, &Items::record, &lItems, aStats) == NO_ERROR_OCCURRED);
+    return lItems.puItems;
+}
+
+bool readGroup(const FakeChip &aChip, int aGroup)
+{
+    return std::find(aChip.puReads.begin(), aChip.puReads.end(), dataGroupItem(aGroup)) != aChip.puReads.end();
+}
+
+void testCache()
+{
+    ChipCacheOptions lOptions;
+    lOptions.puTimeToLive = milliseconds(200);
+    lOptions.puMaxChips = 2;
+    ChipResultCache lCache(lOptions);
+    const Bytes lFirst = bytes("first EF.SOD");
+    const Bytes lSecond = bytes("second EF.SOD");
+    const Bytes lThird = bytes("third EF.SOD");
+
+    READERD_CHECK(lCache.find(lFirst) == nullptr);
+    CachedChip lChip;
+    lChip.puEfCom = bytes("EF.COM");
+    lCache.store(lFirst, lChip);
+    const auto lFound = lCache.find(lFirst);
+    READERD_CHECK(lFound != nullptr && lFound->puEfCom == bytes("EF.COM"));
+    READERD_CHECK(lCache.find(bytes("first EF.SOD ")) == nullptr);
+
+    // Full: the chip closest to expiry makes room; storing one already held replaces it.
+    std::this_thread::sleep_for(milliseconds(5));
+    lCache.store(lSecond, CachedChip());
+    std::this_thread::sleep_for(milliseconds(5));
+    lCache.store(lThird, CachedChip());
+    READERD_CHECK(lCache.size() == 2 && lCache.find(lFirst) == nullptr);
+    lCache.store(lSecond, lChip);
+    READERD_CHECK(lCache.size() == 2 && lCache.find(lSecond)->puEfCom == lChip.puEfCom);
+    READERD_CHECK(lCache.find(lThird) != nullptr);
+
+    // A chip is forgotten once its time to live is over, and a holder keeps its copy.
+    std::this_thread::sleep_for(milliseconds(250));
+    READERD_CHECK(lCache.find(lSecond) == nullptr && lCache.find(lThird) == nullptr);
+    READERD_CHECK(lCache.size() == 0 && lFound->puEfCom == bytes("EF.COM"));
+
+    lCache.store(lFirst, lChip);
+    lCache.clear();
+    READERD_CHECK(lCache.size() == 0);
+
+    lOptions.puMaxChips = 0;
+    ChipResultCache lDisabled(lOptions);
+    lDisabled.store(lFirst, lChip);
+    READERD_CHECK(lDisabled.size() == 0);
+}
+
+void testServed()
+{
+    ChipResultCache lCache{ChipCacheOptions()};
+    RfReadOptions lOptions;
+    lOptions.puCache = &lCache;
+    RfReader lReader(lOptions);
+    const Passport lPassport = passport(1);
+    RfReadStats lStats;
+
+    FakeChip lFirst(lPassport);
+    const auto lFull = read(&lReader, &lFirst, &lStats);
+    READERD_CHECK(!lStats.puCacheHit && lStats.puDataGroups == 3 && lCache.size() == 1);
+    READERD_CHECK(lFull.size() == 2 + 2 * 3 && lFull[0].first == CD_SCEF_COM_FILE);
+
+    // The same chip again: EF.SOD, then DG15 and Active Authentication, and nothing else.
+    FakeChip lAgain(lPassport);
+    READERD_CHECK(read(&lReader, &lAgain, &lStats) == lFull);
+    READERD_CHECK(lStats.puCacheHit && lStats.puActiveAuthentication == RFID_VC_VALID);
+    READERD_CHECK(lAgain.puReads == std::vector<MMMReaderRFItem>({RFID_EF_SOD, dataGroupItem(15)}));
+
+    // A copy that fails Active Authentication is read in full and reported as it is.
+    FakeChip lClone(lPassport);
+    lClone.puActiveAuthentication = RFID_VC_INVALID;
+    READERD_CHECK(read(&lReader, &lClone, &lStats) == lFull);
+    READERD_CHECK(!lStats.puCacheHit && readGroup(lClone, 2));
+
+    // So is one with a DG15 of its own beside the copied EF.SOD.
+    Passport lSwapped = lPassport;
+    lSwapped.puGroups[15] = Bytes(1500, 0x99);
+    FakeChip lImpostor(lSwapped);
+    read(&lReader, &lImpostor, &lStats);
+    READERD_CHECK(!lStats.puCacheHit && readGroup(lImpostor, 2));
+
+    // A chip with a data group that does not match its EF.SOD is not stored.
+    if (digestSupported())
+    {
+        Passport lTampered = passport(2);
+        lTampered.puGroups[2][0] ^= 1;
+        FakeChip lChip(lTampered);
+        read(&lReader, &lChip, &lStats);
+        READERD_CHECK(lStats.puInvalid == 1 && lCache.find(lTampered.puEfSod) == nullptr);
+    }
+
+    // Without the Active Authentication requirement EF.SOD alone is read.
+    ChipCacheOptions lTrusting;
+    lTrusting.puRequireActiveAuthentication = false;
+    ChipResultCache lTrustingCache(lTrusting);
+    lOptions.puCache = &lTrustingCache;
+    RfReader lTrustingReader(lOptions);
+    read(&lTrustingReader, &lFirst, &lStats);
+    READERD_CHECK(read(&lTrustingReader, &lClone, &lStats) == lFull);
+    READERD_CHECK(lStats.puCacheHit && lStats.puActiveAuthentication == RFID_VC_NOT_PERFORMED);
+}
+
+// A chip cached by a reader that read fewer data groups is served only to readers asking for
+// no more than those.
+void testPartialEntry()
+{
+    ChipResultCache lCache{ChipCacheOptions()};
+    const Passport lPassport = passport(3);
+    RfReadStats lStats;
+
+    RfReadOptions lOptions;
+    lOptions.puCache = &lCache;
+    lOptions.puDataGroups = {1};
+    RfReader lFaceless(lOptions);
+    FakeChip lFirst(lPassport);
+    read(&lFaceless, &lFirst, &lStats);
+    READERD_CHECK(!lStats.puCacheHit && lCache.size() == 1);
+
+    lOptions.puDataGroups.clear();
+    RfReader lEverything(lOptions);
+    FakeChip lSecond(lPassport);
+    read(&lEverything, &lSecond, &lStats);
+    READERD_CHECK(!lStats.puCacheHit && readGroup(lSecond, 2));
+
+    // That full read replaced the entry, so now every reader is served.
+    FakeChip lThird(lPassport);
+    read(&lFaceless, &lThird, &lStats);
+    READERD_CHECK(lStats.puCacheHit && !readGroup(lThird, 1));
+}
+
+} // namespace
+
+int main()
+{
+    testCache();
+    testServed();
+    testPartialEntry();
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include "readerd/CodelineCodec.h"
+
+#include "TestSupport.h"
+
+#include <cstring>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+void copyString(char *aField, size_t aSize, std::string_view aValue)
+{
+    std::memset(aField, 0, aSize);
+    std::memcpy(aField, aValue.data(), std::min(aValue.size(), aSize - 1));
+}
+
+MMMReaderCodelineData passport()
+{
+    MMMReaderCodelineData lData;
+    std::memset(&lData, 0, sizeof(lData));
+    copyString(lData.Line1, sizeof(lData.Line1), "P<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<");
+    copyString(lData.Line2, sizeof(lData.Line2), "L898902C36UTO7408122F1204159ZE184226B<<<<<10");
+    copyString(lData.Data, sizeof(lData.Data),
+               "P<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<\rL898902C36UTO7408122F1204159ZE184226B<<<<<10");
+    copyString(lData.DocType, sizeof(lData.DocType), "P");
+    copyString(lData.Surname, sizeof(lData.Surname), "ERIKSSON");
+    copyString(lData.Forenames, sizeof(lData.Forenames), "ANNA MARIA");
+    copyString(lData.IssuingState, sizeof(lData.IssuingState), "UTO");
+    copyString(lData.DocNumber, sizeof(lData.DocNumber), "L898902C3");
+    copyString(lData.Sex, sizeof(lData.Sex), "F");
+    lData.LineCount = 2;
+    lData.DateOfBirth = MMMReaderDate{12, 8, 1974};
+    lData.ExpiryDate = MMMReaderDate{15, 4, 2012};
+    lData.ShortSex = 'F';
+    lData.CheckDigitDataListCount = 2;
+    lData.CheckDigitDataList[0] = MMMReaderCodelineCheckDigitData{CDT_DocID, 2, 9, '6', '6', CDR_Valid};
+    lData.CheckDigitDataList[1] = MMMReaderCodelineCheckDigitData{CDT_Overall, 2, 43, '0', '1', CDR_Invalid};
+    lData.CodelineValidationResult = CDR_Warning;
+    lData.MrzOnRearSide = 1;
+    lData.ImageSource = -3;
+    return lData;
+}
+
+void testRoundTrip()
+{
+    const MMMReaderCodelineData lData = passport();
+    std::vector<uint8_t> lEncoded{0xEE};
+    const size_t lSize = encodeCodeline(lData, &lEncoded);
+    READERD_CHECK(lSize + 1 == lEncoded.size());
+
+    CodelineView lView;
+    READERD_CHECK(lView.parse(std::span<const uint8_t>(lEncoded).subspan(1)));
+    READERD_CHECK(lView.field(CF_SURNAME) == "ERIKSSON");
+    READERD_CHECK(lView.field(CF_DATA).empty());   // Rebuilt from the lines.
+    READERD_CHECK(lView.data() == lData.Data);
+    READERD_CHECK(lView.checkDigits().size() == 2);
+
+    MMMReaderCodelineData lDecoded;
+    std::memset(&lDecoded, 0xA5, sizeof(lDecoded));
+    lView.toStruct(&lDecoded);
+    READERD_CHECK(std::memcmp(&lDecoded, &lData, sizeof(lData)) == 0);
+
+    // Every truncation is refused rather than read past.
+    for (size_t lLength = 0; lLength < lSize; ++lLength)
+        READERD_CHECK(!lView.parse(std::span<const uint8_t>(lEncoded).subspan(1, lLength)));
+
+    MMMReaderCodelineData lEmpty;
+    std::memset(&lEmpty, 0, sizeof(lEmpty));
+    std::vector<uint8_t> lEmptyEncoded;
+    READERD_CHECK(encodeCodeline(lEmpty, &lEmptyEncoded) == 2);
+    READERD_CHECK(lView.parse(lEmptyEncoded) && lView.data().empty());
+
+    const uint8_t lUnknownVersion[] = {kCodelineCodecVersion + 1, 0};
+    READERD_CHECK(!lView.parse(lUnknownVersion));
+}
+
+// The bytes com.readerd.CompactCodeline decodes. A change here is a change of the wire format
+// and needs a new kCodelineCodecVersion and a matching change to the Java decoder.
+void testWireFormat()
+{
+    MMMReaderCodelineData lData;
+    std::memset(&lData, 0, sizeof(lData));
+    copyString(lData.Line1, sizeof(lData.Line1), "AB<");
+    copyString(lData.Data, sizeof(lData.Data), "AB<");
+    copyString(lData.Surname, sizeof(lData.Surname), "LEE");
+    lData.LineCount = 1;
+    lData.DateOfBirth = MMMReaderDate{12, 8, 74};
+    lData.ShortSex = 'F';
+    lData.CheckDigitDataListCount = 1;
+    lData.CheckDigitDataList[0] = MMMReaderCodelineCheckDigitData{CDT_DOB, 2, 13, '2', '2', CDR_Valid};
+    lData.CodelineValidationResult = CDR_Valid;
+    lData.ExpiredDocumentFlag = 1;
+    lData.ImageSource = -1;
+
+    const std::vector<uint8_t> lExpected = {
+        0x01,                       // version
+        0xC2, 0x80, 0xB0, 0x3F,     // presence: Line1, Surname, bits 18, 19, 21 to 26
+        0x03, 'A', 'B', '<',        // Line1
+        0x03, 'L', 'E', 'E',        // Surname
+        0x02,                       // LineCount 1
+        0x18, 0x10, 0x94, 0x01,     // DateOfBirth 12, 8, 74
+        'F',                        // ShortSex
+        0x01, 0x01, 0x02, 0x1A, '2', '2', 0x01,    // one CDT_DOB check digit, line 2, position 13
+        0x02,                       // CDR_Valid
+        0x02,                       // ExpiredDocumentFlag
+        0x01,                       // ImageSource -1
+    };
+    std::vector<uint8_t> lEncoded;
+    encodeCodeline(lData, &lEncoded);
+    READERD_CHECK(lEncoded == lExpected);
+
+    CodelineView lView;
+    READERD_CHECK(lView.parse(lExpected));
+    READERD_CHECK(lView.data() == "AB<");
+    READERD_CHECK(lView.dateOfBirth().Year == 74);
+    READERD_CHECK(lView.checkDigits().size() == 1 && lView.checkDigits()[0].puCodelinePos == 13);
+    READERD_CHECK(lView.validationResult() == CDR_Valid);
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testWireFormat();
+    return failures() == 0 ? 0 : 1;
+}
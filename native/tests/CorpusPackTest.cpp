@@ -0,0 +1,127 @@
+#include "readerd/CorpusPack.h"
+
+#include "TestSupport.h"
+
+#include <cstring>
+#include <iterator>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+Bytes contents(const ScanFile &aFile)
+{
+    return Bytes(aFile.puBytes.begin(), aFile.puBytes.end());
+}
+
+void testRoundTrip()
+{
+    TempDirectory lDirectory;
+    const std::string lFirst = lDirectory.file("scan-1");
+    const std::string lEmpty = lDirectory.file("scan-2");
+    const std::string lSecond = lDirectory.file("scan-3");
+    std::filesystem::create_directories(lFirst + "/nested");
+    std::filesystem::create_directories(lEmpty);
+    std::filesystem::create_directories(lSecond);
+    const Bytes lImage(1000, 0x42);
+    writeFile(lFirst + "/CD_IMAGEVIS.bmp", lImage);
+    writeFile(lFirst + "/CD_CODELINE.txt", bytes("P<UTO"));
+    writeFile(lFirst + "/empty", Bytes());
+    writeFile(lFirst + "/nested/ignored", bytes("not packed"));
+    writeFile(lSecond + "/CD_SECURITYCHECK", bytes("1"));
+
+    const std::string lPath = lDirectory.file("corpus.pack");
+    std::string lError;
+    READERD_CHECK(CorpusPack::write({lFirst, lEmpty, lSecond}, lPath, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(CorpusPack::isPack(lPath) && !std::filesystem::exists(lPath + ".tmp"));
+
+    CorpusPack lPack;
+    if (!READERD_CHECK(lPack.open(lPath, &lError) == NO_ERROR_OCCURRED) || !READERD_CHECK(lPack.size() == 3))
+        return;
+    READERD_CHECK(lPack.name(0) == lFirst && lPack.name(1) == lEmpty && lPack.name(2) == lSecond);
+    READERD_CHECK(lPack.contentBytes() == lImage.size() + 5 + 1);
+
+    // Files come in name order, each starting on a 64-byte boundary.
+    std::vector<ScanFile> lFiles;
+    lPack.files(0, &lFiles);
+    if (READERD_CHECK(lFiles.size() == 3))
+    {
+        READERD_CHECK(lFiles[0].puName == "CD_CODELINE.txt" && contents(lFiles[0]) == bytes("P<UTO"));
+        READERD_CHECK(lFiles[1].puName == "CD_IMAGEVIS.bmp" && contents(lFiles[1]) == lImage);
+        READERD_CHECK(lFiles[2].puName == "empty" && lFiles[2].puBytes.empty());
+        READERD_CHECK(reinterpret_cast<uintptr_t>(lFiles[1].puBytes.data()) % 64 == 0);
+    }
+    lPack.prefetch(0);
+    lPack.prefetch(1);
+    lPack.files(1, &lFiles);
+    READERD_CHECK(lFiles.empty());
+    lPack.files(2, &lFiles);
+    READERD_CHECK(lFiles.size() == 1 && contents(lFiles[0]) == bytes("1"));
+
+    // A pack written again over an open one replaces it; the old mapping stays readable.
+    READERD_CHECK(CorpusPack::write({lSecond}, lPath, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(contents(lFiles[0]) == bytes("1"));
+    CorpusPack lReplaced;
+    READERD_CHECK(lReplaced.open(lPath, &lError) == NO_ERROR_OCCURRED && lReplaced.size() == 1);
+}
+
+void testFailures()
+{
+    TempDirectory lDirectory;
+    const std::string lScan = lDirectory.file("scan");
+    std::filesystem::create_directories(lScan);
+    writeFile(lScan + "/CD_CODELINE.txt", bytes("P<UTO"));
+    const std::string lPath = lDirectory.file("corpus.pack");
+    std::string lError;
+    READERD_CHECK(CorpusPack::write({lScan}, lPath, &lError) == NO_ERROR_OCCURRED);
+    const auto lSize = std::filesystem::file_size(lPath);
+
+    // A failed write leaves the existing pack and no temporary file behind.
+    READERD_CHECK(CorpusPack::write({lScan, lDirectory.file("missing")}, lPath, &lError) == ERROR_READING_FILE);
+    READERD_CHECK(!lError.empty() && std::filesystem::file_size(lPath) == lSize);
+    READERD_CHECK(!std::filesystem::exists(lPath + ".tmp"));
+    READERD_CHECK(CorpusPack::write({lScan}, lDirectory.file("missing/corpus.pack"), &lError) == ERROR_WRITING_FILE);
+
+    CorpusPack lPack;
+    READERD_CHECK(lPack.open(lDirectory.file("missing"), &lError) == ERROR_OS_ERROR);
+    writeFile(lDirectory.file("short"), bytes("RDCP"));
+    READERD_CHECK(lPack.open(lDirectory.file("short"), &lError) == ERROR_OS_ERROR);
+
+    // Without its magic, as an interrupted write leaves it, the pack is not opened.
+    std::ifstream lIn(lPath, std::ios::binary);
+    const Bytes lGood((std::istreambuf_iterator<char>(lIn)), std::istreambuf_iterator<char>());
+    Bytes lBad = lGood;
+    lBad[0] = 0;
+    writeFile(lDirectory.file("bad"), lBad);
+    READERD_CHECK(!CorpusPack::isPack(lDirectory.file("bad")));
+    READERD_CHECK(lPack.open(lDirectory.file("bad"), &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+
+    // Nor is one whose index points outside the file.
+    CorpusPackHeader lHeader;
+    std::memcpy(&lHeader, lGood.data(), sizeof(lHeader));
+    for (uint64_t CorpusPackHeader::*lField : {&CorpusPackHeader::puIndexOffset, &CorpusPackHeader::puIndexLength,
+                                               &CorpusPackHeader::puEntries})
+    {
+        CorpusPackHeader lCorrupt = lHeader;
+        lCorrupt.*lField += 4096;
+        lBad = lGood;
+        std::memcpy(lBad.data(), &lCorrupt, sizeof(lCorrupt));
+        writeFile(lDirectory.file("bad"), lBad);
+        READERD_CHECK(lPack.open(lDirectory.file("bad"), &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+    }
+    lBad = lGood;
+    lBad.resize(lBad.size() - 1);
+    writeFile(lDirectory.file("bad"), lBad);
+    READERD_CHECK(lPack.open(lDirectory.file("bad"), &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+    READERD_CHECK(lPack.size() == 0);
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testFailures();
+    return failures() == 0 ? 0 : 1;
+}
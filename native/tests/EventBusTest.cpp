@@ -0,0 +1,235 @@
+#include "readerd/EventBus.h"
+#include "readerd/MpscRing.h"
+
+#include "TestSupport.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+void testRing()
+{
+    MpscRing<int> lRing(5);
+    READERD_CHECK(lRing.capacity() == 8 && MpscRing<int>(1).capacity() == 2);
+
+    // Many times round, so that the sequence numbers wrap the slots.
+    int lNext = 0;
+    int lExpected = 0;
+    for (int lRound = 0; lRound < 100; ++lRound)
+    {
+        for (int i = 0; i < 6; ++i)
+            READERD_CHECK(lRing.tryPush(lNext++));
+        READERD_CHECK(lRing.size() == 6);
+        int lItem = -1;
+        for (int i = 0; i < 6; ++i)
+            READERD_CHECK(lRing.tryPop(&lItem) && lItem == lExpected++);
+        READERD_CHECK(!lRing.tryPop(&lItem));
+    }
+
+    for (int i = 0; i < 8; ++i)
+        READERD_CHECK(lRing.tryPush(int(i)));
+    READERD_CHECK(!lRing.tryPush(8));
+    int lItem = -1;
+    READERD_CHECK(lRing.tryPop(&lItem) && lItem == 0);
+    READERD_CHECK(!lRing.tryPush(9, 7));
+    READERD_CHECK(lRing.tryPush(9, 8));
+}
+
+// Items from each producer come out in the order that producer pushed them, and none are lost.
+void testProducers()
+{
+    constexpr int kProducers = 4;
+    constexpr uint32_t kItems = 100000;
+    MpscRing<uint64_t> lRing(64);
+    std::vector<std::thread> lThreads;
+    for (int p = 0; p < kProducers; ++p)
+    {
+        lThreads.emplace_back([&lRing, p] {
+            for (uint32_t i = 0; i < kItems; ++i)
+            {
+                while (!lRing.tryPush(static_cast<uint64_t>(p) << 32 | i))
+                    std::this_thread::yield();
+            }
+        });
+    }
+
+    uint32_t lNext[kProducers] = {};
+    bool lOrdered = true;
+    for (uint64_t lPopped = 0; lPopped < kProducers * uint64_t{kItems};)
+    {
+        uint64_t lItem = 0;
+        if (!lRing.tryPop(&lItem))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        const size_t lProducer = lItem >> 32;
+        lOrdered = lOrdered && lProducer < kProducers && static_cast<uint32_t>(lItem) == lNext[lProducer];
+        if (lProducer < kProducers)
+            ++lNext[lProducer];
+        ++lPopped;
+    }
+    for (std::thread &lThread : lThreads)
+        lThread.join();
+    READERD_CHECK(lOrdered);
+    READERD_CHECK(lRing.size() == 0);
+}
+
+/// Records what it is handed, as "kind code document payload" lines. With puBlock set it
+/// waits in onData() until puBlock is cleared again.
+class Recorder : public DataConsumer
+{
+public:
+    std::atomic<bool> puBlock{false};
+    std::atomic<bool> puBlocked{false};
+
+    void onData(const DataItem &aItem) override
+    {
+        while (puBlock)
+        {
+            puBlocked = true;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        add("data " + std::to_string(aItem.type()) + " " + std::to_string(aItem.document()) + " " +
+            std::string(aItem.bytes().begin(), aItem.bytes().end()));
+    }
+
+    void onEvent(MMMReaderEventCode aEventCode, uint32_t aDocument) override
+    {
+        add("event " + std::to_string(aEventCode) + " " + std::to_string(aDocument));
+    }
+
+    void onError(MMMReaderErrorCode aErrorCode, const char *aErrorMsg, uint32_t aDocument) override
+    {
+        add("error " + std::to_string(aErrorCode) + " " + std::to_string(aDocument) + " " + aErrorMsg);
+    }
+
+    std::vector<std::string> lines()
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        return prLines;
+    }
+
+private:
+    void add(std::string aLine)
+    {
+        std::lock_guard<std::mutex> lLock(prMutex);
+        prLines.push_back(std::move(aLine));
+    }
+
+    std::mutex prMutex;
+    std::vector<std::string> prLines;
+};
+
+void sendData(EventBus *aBus, uint32_t aDocument, std::string aText)
+{
+    aBus->onData(DataItem(CD_CODELINE, aDocument, aText.data(), aText.size()));
+    // The bus has retained its copy; the caller's buffer may go.
+    aText.assign(aText.size(), '#');
+}
+
+void testDelivery()
+{
+    Recorder lFirst;
+    Recorder lSecond;
+    EventBus lBus(16);
+    lBus.subscribe(&lFirst);
+    lBus.subscribe(&lSecond);
+    lBus.start();
+
+    std::vector<std::string> lExpected;
+    for (uint32_t lDocument = 1; lDocument <= 50; ++lDocument)
+    {
+        lBus.onEvent(START_OF_DOCUMENT_DATA, lDocument);
+        sendData(&lBus, lDocument, "P<UTO" + std::to_string(lDocument));
+        lBus.onError(ERROR_TIMED_OUT, "slow", lDocument);
+        lBus.onEvent(END_OF_DOCUMENT_DATA, lDocument);
+        lExpected.push_back("event " + std::to_string(START_OF_DOCUMENT_DATA) + " " + std::to_string(lDocument));
+        lExpected.push_back("data " + std::to_string(CD_CODELINE) + " " + std::to_string(lDocument) + " P<UTO" +
+                            std::to_string(lDocument));
+        lExpected.push_back("error " + std::to_string(ERROR_TIMED_OUT) + " " + std::to_string(lDocument) + " slow");
+        lExpected.push_back("event " + std::to_string(END_OF_DOCUMENT_DATA) + " " + std::to_string(lDocument));
+
+        // Let the subscribers keep up; each ring holds four documents.
+        if (lDocument % 4 == 0)
+            lBus.drain();
+    }
+    lBus.drain();
+    READERD_CHECK(lFirst.lines() == lExpected);
+    READERD_CHECK(lSecond.lines() == lExpected);
+    READERD_CHECK(lBus.stats().puDelivered == 2 * lExpected.size() && lBus.stats().puDropped == 0);
+
+    // stop() delivers what is still queued.
+    for (uint32_t i = 0; i < 10; ++i)
+        lBus.onEvent(START_OF_DOCUMENT_DATA, 100 + i);
+    lBus.stop();
+    READERD_CHECK(lFirst.lines().size() == lExpected.size() + 10);
+}
+
+// A subscriber that falls behind loses data items but keeps the document boundaries, and
+// delays nobody else.
+void testSlowSubscriber()
+{
+    Recorder lSlow;
+    Recorder lFast;
+    EventBus lBus(16);
+    lBus.subscribe(&lSlow);
+    lBus.subscribe(&lFast);
+    lBus.start();
+
+    // Waits for the fast subscriber after every message, so that only the slow one drops.
+    size_t lSent = 0;
+    const auto lKeepUp = [&] {
+        ++lSent;
+        for (int i = 0; i < 5000 && lFast.lines().size() < lSent; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    };
+
+    lSlow.puBlock = true;
+    sendData(&lBus, 1, "first");
+    lKeepUp();
+    while (!lSlow.puBlocked)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    // The slow ring is empty again: 14 data items fit, the rest wait for the kept eighth.
+    for (int i = 0; i < 20; ++i)
+    {
+        sendData(&lBus, 1, "item " + std::to_string(i));
+        lKeepUp();
+    }
+    lBus.onEvent(END_OF_DOCUMENT_DATA, 1);
+    lKeepUp();
+    lBus.onEvent(START_OF_DOCUMENT_DATA, 2);
+    lKeepUp();
+    sendData(&lBus, 2, "dropped");
+    lKeepUp();
+    READERD_CHECK(lFast.lines().size() == 24);
+    READERD_CHECK(lBus.stats().puDropped == 7);
+
+    lSlow.puBlock = false;
+    lBus.drain();
+    const std::vector<std::string> lLines = lSlow.lines();
+    if (READERD_CHECK(lLines.size() == 17))
+    {
+        READERD_CHECK(lLines[14] == "data " + std::to_string(CD_CODELINE) + " 1 item 13");
+        READERD_CHECK(lLines[15] == "event " + std::to_string(END_OF_DOCUMENT_DATA) + " 1");
+        READERD_CHECK(lLines[16] == "event " + std::to_string(START_OF_DOCUMENT_DATA) + " 2");
+    }
+    READERD_CHECK(lBus.stats().puDelivered == 17 + 24 && lBus.stats().puMaxDepth == 16);
+}
+
+} // namespace
+
+int main()
+{
+    testRing();
+    testProducers();
+    testDelivery();
+    testSlowSubscriber();
+    return failures() == 0 ? 0 : 1;
+}
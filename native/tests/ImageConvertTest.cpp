@@ -0,0 +1,377 @@
+#include "readerd/BufferPool.h"
+#include "readerd/ImageConvert.h"
+
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+using RowKernel = std::function<void(const uint8_t *aSrc, uint8_t *aDst, size_t aPixels)>;
+
+constexpr SimdLevel kLevels[] = {SIMD_SCALAR, SIMD_SSE4, SIMD_AVX2};
+
+/// Bytes written around each output; a kernel must leave them alone.
+constexpr size_t kGuardBytes = 64;
+constexpr uint8_t kGuard = 0xA5;
+
+Bytes noise(size_t aSize, uint32_t aSeed)
+{
+    Bytes lBytes(aSize);
+    for (uint8_t &lByte : lBytes)
+    {
+        aSeed = aSeed * 1103515245 + 12345;
+        lByte = static_cast<uint8_t>(aSeed >> 16);
+    }
+    return lBytes;
+}
+
+uint8_t average(uint8_t aA, uint8_t aB)
+{
+    return static_cast<uint8_t>((aA + aB + 1) >> 1);
+}
+
+uint8_t luma(const uint8_t *aBgr)
+{
+    return static_cast<uint8_t>((38 * aBgr[2] + 75 * aBgr[1] + 15 * aBgr[0] + 64) >> 7);
+}
+
+// Row lengths around every vector width and their tails, and a few longer rows.
+std::vector<size_t> rowLengths()
+{
+    std::vector<size_t> lLengths;
+    for (size_t i = 0; i <= 130; ++i)
+        lLengths.push_back(i);
+    for (size_t lLength : {255u, 256u, 257u, 1001u, 4093u})
+        lLengths.push_back(lLength);
+    return lLengths;
+}
+
+/// Runs \a aKernel at SIMD_SCALAR over rows of rowLengths() pixels, read one byte past an
+/// aligned address, and checks the results against \a aExpected. Every other supported level
+/// must then produce the scalar output byte for byte, guard bytes included.
+void checkKernel(const char *aName, size_t aSrcBytes, const std::function<size_t(size_t)> &aDstBytes,
+                 const RowKernel &aKernel, const RowKernel &aExpected)
+{
+    const std::vector<size_t> lLengths = rowLengths();
+    const Bytes lSource = noise(lLengths.back() * aSrcBytes + 1, 7);
+    const auto lRun = [&](const RowKernel &aRun, size_t aPixels) {
+        Bytes lOut(aDstBytes(aPixels) + 2 * kGuardBytes, kGuard);
+        aRun(lSource.data() + 1, lOut.data() + kGuardBytes, aPixels);
+        return lOut;
+    };
+
+    const SimdLevel lInitial = simdLevel();
+    setSimdLevel(SIMD_SCALAR);
+    std::vector<Bytes> lScalar;
+    for (size_t lPixels : lLengths)
+    {
+        lScalar.push_back(lRun(aKernel, lPixels));
+        if (!READERD_CHECK(lScalar.back() == lRun(aExpected, lPixels)))
+            std::fprintf(stderr, "  %s, scalar, %zu pixels\n", aName, lPixels);
+    }
+    for (SimdLevel lLevel : kLevels)
+    {
+        if (lLevel == SIMD_SCALAR)
+            continue;
+        if (setSimdLevel(lLevel) != lLevel)
+        {
+            std::fprintf(stderr, "%s is not supported here; skipped\n", simdLevelName(lLevel));
+            continue;
+        }
+        for (size_t i = 0; i < lLengths.size(); ++i)
+        {
+            if (!READERD_CHECK(lRun(aKernel, lLengths[i]) == lScalar[i]))
+                std::fprintf(stderr, "  %s, %s, %zu pixels\n", aName, simdLevelName(lLevel), lLengths[i]);
+        }
+    }
+    setSimdLevel(lInitial);
+}
+
+size_t rgbBytes(size_t aPixels)
+{
+    return aPixels * 3;
+}
+
+void testRowKernels()
+{
+    checkKernel("swizzleBgrToRgb", 3, rgbBytes, swizzleBgrToRgb, [](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+        for (size_t i = 0; i < aPixels; ++i)
+        {
+            aDst[3 * i] = aSrc[3 * i + 2];
+            aDst[3 * i + 1] = aSrc[3 * i + 1];
+            aDst[3 * i + 2] = aSrc[3 * i];
+        }
+    });
+    checkKernel("unpackBgraToRgb", 4, rgbBytes, unpackBgraToRgb, [](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+        for (size_t i = 0; i < aPixels; ++i)
+        {
+            aDst[3 * i] = aSrc[4 * i + 2];
+            aDst[3 * i + 1] = aSrc[4 * i + 1];
+            aDst[3 * i + 2] = aSrc[4 * i];
+        }
+    });
+    checkKernel("greyscaleBgr", 3, [](size_t aPixels) { return aPixels; }, greyscaleBgr,
+                [](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+                    for (size_t i = 0; i < aPixels; ++i)
+                        aDst[i] = luma(aSrc + 3 * i);
+                });
+    checkKernel("greyscaleBgra", 4, [](size_t aPixels) { return aPixels; }, greyscaleBgra,
+                [](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+                    for (size_t i = 0; i < aPixels; ++i)
+                        aDst[i] = luma(aSrc + 4 * i);
+                });
+    for (int lBytesPerPixel : {3, 4})
+    {
+        for (int lChannel = 0; lChannel < 3; ++lChannel)
+        {
+            const std::string lName = "extractChannel " + std::to_string(lBytesPerPixel) + "/" + std::to_string(lChannel);
+            checkKernel(
+                lName.c_str(), lBytesPerPixel, [](size_t aPixels) { return aPixels; },
+                [=](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+                    extractChannel(aSrc, aDst, aPixels, lBytesPerPixel, lChannel);
+                },
+                [=](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+                    for (size_t i = 0; i < aPixels; ++i)
+                        aDst[i] = aSrc[i * lBytesPerPixel + lChannel];
+                });
+        }
+    }
+
+    // The source holds the top row followed by the bottom one.
+    checkKernel(
+        "downscaleRowPair", 6, [](size_t aPixels) { return aPixels / 2 * 3; },
+        [](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) { downscaleRowPair(aSrc, aSrc + 3 * aPixels, aDst, aPixels); },
+        [](const uint8_t *aSrc, uint8_t *aDst, size_t aPixels) {
+            const uint8_t *lBottom = aSrc + 3 * aPixels;
+            for (size_t i = 0; i + 1 < aPixels; i += 2)
+            {
+                for (size_t c = 0; c < 3; ++c)
+                {
+                    aDst[i / 2 * 3 + c] = average(average(aSrc[3 * i + c], lBottom[3 * i + c]),
+                                                  average(aSrc[3 * i + 3 + c], lBottom[3 * i + 3 + c]));
+                }
+            }
+        });
+}
+
+void putLe(Bytes *aBytes, uint32_t aValue, int aSize)
+{
+    for (int i = 0; i < aSize; ++i)
+        aBytes->push_back(static_cast<uint8_t>(aValue >> (8 * i)));
+}
+
+/// A BMP of \a aPixels, given top-down and packed at \a aBits / 8 bytes per pixel, with rows
+/// padded to four bytes.
+Bytes bitmap(const Bytes &aPixels, int aWidth, int aHeight, int aBits, bool aBottomUp)
+{
+    const size_t lRowBytes = static_cast<size_t>(aWidth) * aBits / 8;
+    const size_t lStride = (lRowBytes + 3) / 4 * 4;
+    Bytes lBmp{'B', 'M'};
+    putLe(&lBmp, static_cast<uint32_t>(54 + lStride * aHeight), 4);
+    putLe(&lBmp, 0, 4);
+    putLe(&lBmp, 54, 4);
+    putLe(&lBmp, 40, 4);
+    putLe(&lBmp, static_cast<uint32_t>(aWidth), 4);
+    putLe(&lBmp, static_cast<uint32_t>(aBottomUp ? aHeight : -aHeight), 4);
+    putLe(&lBmp, 1, 2);
+    putLe(&lBmp, static_cast<uint32_t>(aBits), 2);
+    lBmp.resize(54);
+    for (int y = 0; y < aHeight; ++y)
+    {
+        const uint8_t *lRow = aPixels.data() + (aBottomUp ? aHeight - 1 - y : y) * lRowBytes;
+        lBmp.insert(lBmp.end(), lRow, lRow + lRowBytes);
+        lBmp.resize(lBmp.size() + lStride - lRowBytes, 0xEE);
+    }
+    return lBmp;
+}
+
+void testParseBitmap()
+{
+    const Bytes lPixels = noise(5 * 3 * 3, 1);
+    const Bytes lBmp = bitmap(lPixels, 5, 3, 24, true);
+    BitmapView lView;
+    if (!READERD_CHECK(parseBitmap(lBmp, &lView)))
+        return;
+    READERD_CHECK(lView.puWidth == 5 && lView.puHeight == 3 && lView.puBitsPerPixel == 24);
+    READERD_CHECK(lView.puStride == 16 && lView.puBottomUp);
+    READERD_CHECK(std::equal(lPixels.begin(), lPixels.begin() + 15, lView.row(0)));
+
+    READERD_CHECK(parseBitmap(bitmap(noise(5 * 3 * 4, 1), 5, 3, 32, false), &lView) && !lView.puBottomUp);
+    READERD_CHECK(!parseBitmap(std::span<const uint8_t>(lBmp).first(lBmp.size() - 1), &lView));
+    READERD_CHECK(!parseBitmap(bytes("BM and then not much"), &lView));
+    Bytes lCompressed = lBmp;
+    lCompressed[30] = 1;
+    READERD_CHECK(!parseBitmap(lCompressed, &lView));
+    Bytes lPalette = lBmp;
+    lPalette[28] = 8;
+    READERD_CHECK(!parseBitmap(lPalette, &lView));
+}
+
+void testTileExecutor()
+{
+    for (unsigned lThreads : {1u, 3u, 8u})
+    {
+        TileExecutor lTiles(lThreads);
+        READERD_CHECK(lTiles.threads() == lThreads);
+        for (int lRows : {0, 1, 7, 1000})
+        {
+            std::vector<int> lCovered(lRows, 0);
+            lTiles.forRows(lRows, [&](int aBegin, int aEnd) {
+                for (int y = aBegin; y < aEnd; ++y)
+                    ++lCovered[y];
+            });
+            READERD_CHECK(std::count(lCovered.begin(), lCovered.end(), 1) == lRows);
+        }
+    }
+}
+
+// The tiled helpers write exactly what the untiled ones do, at every level.
+void testTiledImages()
+{
+    const int kWidth = 301;
+    const int kHeight = 97;
+    TileExecutor lTiles(4);
+    const SimdLevel lInitial = simdLevel();
+    for (int lBits : {24, 32})
+    {
+        const Bytes lBmp = bitmap(noise(kWidth * kHeight * lBits / 8, lBits), kWidth, kHeight, lBits, true);
+        BitmapView lView;
+        READERD_CHECK(parseBitmap(lBmp, &lView));
+        for (SimdLevel lLevel : kLevels)
+        {
+            if (setSimdLevel(lLevel) != lLevel)
+                continue;
+            Bytes lRgb(kWidth * kHeight * 3);
+            Bytes lTiledRgb(lRgb.size());
+            bitmapToRgb(lView, lRgb.data());
+            bitmapToRgb(lView, lTiledRgb.data(), &lTiles);
+            READERD_CHECK(lRgb == lTiledRgb);
+
+            Bytes lGrey(kWidth * kHeight);
+            Bytes lTiledGrey(lGrey.size());
+            bitmapToGrey(lView, lGrey.data());
+            bitmapToGrey(lView, lTiledGrey.data(), &lTiles);
+            READERD_CHECK(lGrey == lTiledGrey);
+            bitmapExtractChannel(lView, 2, lGrey.data());
+            bitmapExtractChannel(lView, 2, lTiledGrey.data(), &lTiles);
+            READERD_CHECK(lGrey == lTiledGrey);
+
+            Bytes lHalf(kWidth / 2 * (kHeight / 2) * 3);
+            Bytes lTiledHalf(lHalf.size());
+            downscaleRgb(lRgb.data(), kWidth, kHeight, lHalf.data());
+            downscaleRgb(lRgb.data(), kWidth, kHeight, lTiledHalf.data(), &lTiles);
+            READERD_CHECK(lHalf == lTiledHalf);
+        }
+    }
+    setSimdLevel(lInitial);
+}
+
+// Whole images through ImageConverter, with an odd width so that rows are padded.
+void testConverter()
+{
+    const int kWidth = 37;
+    const int kHeight = 9;
+    const Bytes lBgr = noise(kWidth * kHeight * 3, 2);
+    const Bytes lBgra = noise(kWidth * kHeight * 4, 3);
+    BufferPool lPool;
+
+    std::mutex lMutex;
+    std::vector<ConvertedImage> lImages;
+    const auto lSink = [&](ConvertedImage &&aImage) {
+        std::lock_guard<std::mutex> lLock(lMutex);
+        lImages.push_back(std::move(aImage));
+    };
+    const auto lConvert = [&](ConvertTarget aTarget, const Bytes &aBmp) {
+        lImages.clear();
+        ImageConverter lConverter(aTarget, lSink, 2, &lPool);
+        lConverter.onData(DataItem(CD_IMAGEVIS, 4, aBmp.data(), aBmp.size()));
+        lConverter.drain();
+        READERD_CHECK(lConverter.stats().puConverted == 1);
+        return lImages.size() == 1;
+    };
+
+    Bytes lRgb(lBgr.size());
+    for (size_t i = 0; i < lBgr.size(); i += 3)
+    {
+        lRgb[i] = lBgr[i + 2];
+        lRgb[i + 1] = lBgr[i + 1];
+        lRgb[i + 2] = lBgr[i];
+    }
+    if (READERD_CHECK(lConvert(CONVERT_RGB, bitmap(lBgr, kWidth, kHeight, 24, true))))
+    {
+        const ConvertedImage &lImage = lImages[0];
+        READERD_CHECK(lImage.puDocument == 4 && lImage.puWidth == kWidth && lImage.puHeight == kHeight);
+        READERD_CHECK(lImage.puChannels == 3 && Bytes(lImage.puPixels.bytes().begin(), lImage.puPixels.bytes().end()) == lRgb);
+    }
+
+    Bytes lGrey(kWidth * kHeight);
+    for (size_t i = 0; i < lGrey.size(); ++i)
+        lGrey[i] = luma(lBgra.data() + 4 * i);
+    if (READERD_CHECK(lConvert(CONVERT_GREY, bitmap(lBgra, kWidth, kHeight, 32, false))))
+    {
+        const ConvertedImage &lImage = lImages[0];
+        READERD_CHECK(lImage.puChannels == 1 && Bytes(lImage.puPixels.bytes().begin(), lImage.puPixels.bytes().end()) == lGrey);
+    }
+
+    if (READERD_CHECK(lConvert(CONVERT_RGB_HALF, bitmap(lBgr, kWidth, kHeight, 24, true))))
+    {
+        const ConvertedImage &lImage = lImages[0];
+        READERD_CHECK(lImage.puWidth == kWidth / 2 && lImage.puHeight == kHeight / 2);
+        const uint8_t *lHalf = lImage.puPixels.data();
+        bool lMatches = true;
+        for (int y = 0; y < kHeight / 2; ++y)
+        {
+            for (int x = 0; x < kWidth / 2; ++x)
+            {
+                for (int c = 0; c < 3; ++c)
+                {
+                    const auto lAt = [&](int aY, int aX) { return lRgb[(aY * kWidth + aX) * 3 + c]; };
+                    const uint8_t lWant = average(average(lAt(2 * y, 2 * x), lAt(2 * y + 1, 2 * x)),
+                                                  average(lAt(2 * y, 2 * x + 1), lAt(2 * y + 1, 2 * x + 1)));
+                    lMatches = lMatches && lHalf[(y * (kWidth / 2) + x) * 3 + c] == lWant;
+                }
+            }
+        }
+        READERD_CHECK(lMatches);
+    }
+
+    // Infrared greyscale is the green channel.
+    Bytes lInfrared(kWidth * kHeight);
+    for (size_t i = 0; i < lInfrared.size(); ++i)
+        lInfrared[i] = lBgr[3 * i + 1];
+    const Bytes lIrBmp = bitmap(lBgr, kWidth, kHeight, 24, true);
+    lImages.clear();
+    {
+        ImageConverter lConverter(CONVERT_GREY, lSink);
+        lConverter.onData(DataItem(CD_IMAGEIR, 4, lIrBmp.data(), lIrBmp.size()));
+        lConverter.drain();
+    }
+    if (READERD_CHECK(lImages.size() == 1))
+        READERD_CHECK(Bytes(lImages[0].puPixels.bytes().begin(), lImages[0].puPixels.bytes().end()) == lInfrared);
+
+    // A JPEG photo is counted as skipped; data that is not an image is not looked at.
+    ImageConverter lConverter(CONVERT_RGB, lSink);
+    const Bytes lJpeg{0xFF, 0xD8, 0xFF, 0xE0};
+    lConverter.onData(DataItem(CD_IMAGEPHOTO, 5, lJpeg.data(), lJpeg.size()));
+    lConverter.onData(DataItem(CD_CODELINE, 5, lJpeg.data(), lJpeg.size()));
+    lConverter.drain();
+    READERD_CHECK(lConverter.stats().puSkipped == 1 && lConverter.stats().puConverted == 0);
+}
+
+} // namespace
+
+int main()
+{
+    testRowKernels();
+    testParseBitmap();
+    testTileExecutor();
+    testTiledImages();
+    testConverter();
+    return failures() == 0 ? 0 : 1;
+}
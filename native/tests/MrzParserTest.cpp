@@ -0,0 +1,115 @@
+#include "readerd/ImageConvert.h"
+#include "readerd/MrzParser.h"
+
+#include "TestSupport.h"
+
+#include <cstring>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+// The specimens of ICAO Doc 9303.
+const char *const kSpecimens[] = {
+    "P<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<\rL898902C36UTO7408122F1204159ZE184226B<<<<<10",
+    "I<UTOD231458907<<<<<<<<<<<<<<<\r7408122F1204159UTO<<<<<<<<<<<6\rERIKSSON<<ANNA<MARIA<<<<<<<<<<",
+    "I<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<\rD231458907UTO7408122F1204159<<<<<<<6",
+    "V<UTOERIKSSON<<ANNA<MARIA<<<<<<<<<<<<<<<<<<<\rL8988901C4XXX4009078F96121096ZE184226B<<<<<<",
+};
+
+void testCheckDigits()
+{
+    READERD_CHECK(mrzCheckDigit("L898902C3") == '6');
+    READERD_CHECK(mrzCheckDigit("740812") == '2');
+    READERD_CHECK(mrzCheckDigit("120415") == '9');
+    READERD_CHECK(mrzCheckDigit("ZE184226B<<<<<") == '1');
+    READERD_CHECK(mrzCheckDigit("D23145890") == '7');
+    READERD_CHECK(mrzCheckDigit("<<<<<<<<<") == '0');
+    READERD_CHECK(mrzCheckDigit("") == '0');
+
+    const MrzFormat kFormats[] = {MRZ_TD3, MRZ_TD1, MRZ_TD2, MRZ_MRVA};
+    for (size_t i = 0; i < std::size(kSpecimens); ++i)
+    {
+        MMMReaderCodelineData lData;
+        READERD_CHECK(parseMrz(kSpecimens[i], &lData) == kFormats[i]);
+        READERD_CHECK(lData.CodelineValidationResult == CDR_Valid);
+    }
+}
+
+// Enough codelines of each layout to fill several lanes of sixteen, with one character of most
+// of them changed so that some check digits fail, deterministically.
+std::vector<std::string> corpus()
+{
+    static const char kAlphabet[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ<";
+    std::vector<std::string> lCodelines;
+    uint32_t lState = 12345;
+    for (int i = 0; i < 400; ++i)
+    {
+        std::string lCodeline = kSpecimens[i % std::size(kSpecimens)];
+        lState = lState * 1103515245 + 12345;
+        if (i % 5 != 0)
+        {
+            const size_t lAt = (lState >> 8) % lCodeline.size();
+            if (lCodeline[lAt] != '\r')
+                lCodeline[lAt] = kAlphabet[(lState >> 20) % (sizeof(kAlphabet) - 1)];
+        }
+        lCodelines.push_back(std::move(lCodeline));
+    }
+    return lCodelines;
+}
+
+// The batch parser, and parseMrz() with it, agrees with parseMrz() on the scalar kernels at
+// every SimdLevel the CPU supports.
+void testBatchMatchesScalar()
+{
+    const std::vector<std::string> lCodelines = corpus();
+    const std::vector<std::string_view> lViews(lCodelines.begin(), lCodelines.end());
+
+    const SimdLevel lInitial = simdLevel();
+    setSimdLevel(SIMD_SCALAR);
+    std::vector<MMMReaderCodelineData> lExpected(lViews.size());
+    std::vector<MrzFormat> lExpectedFormats(lViews.size());
+    size_t lExpectedValid = 0;
+    for (size_t i = 0; i < lViews.size(); ++i)
+    {
+        lExpectedFormats[i] = parseMrz(lViews[i], &lExpected[i]);
+        lExpectedValid += lExpected[i].CodelineValidationResult == CDR_Valid;
+    }
+    READERD_CHECK(lExpectedValid >= lViews.size() / 5 && lExpectedValid < lViews.size());
+
+    MrzBatchParser lParser(2);
+    for (SimdLevel lLevel : {SIMD_SCALAR, SIMD_SSE4, SIMD_AVX2})
+    {
+        if (setSimdLevel(lLevel) != lLevel)
+        {
+            std::fprintf(stderr, "%s is not supported here; skipped\n", simdLevelName(lLevel));
+            continue;
+        }
+        std::vector<MMMReaderCodelineData> lResults(lViews.size());
+        std::vector<MrzFormat> lFormats(lViews.size());
+        const size_t lValid = lParser.parse(lViews, lResults, lFormats);
+        READERD_CHECK(lValid == lExpectedValid);
+        for (size_t i = 0; i < lViews.size(); ++i)
+        {
+            if (!READERD_CHECK(lFormats[i] == lExpectedFormats[i])
+                || !READERD_CHECK(std::memcmp(&lResults[i], &lExpected[i], sizeof(lResults[i])) == 0))
+            {
+                std::fprintf(stderr, "  at %s, codeline %zu\n", simdLevelName(lLevel), i);
+            }
+            MMMReaderCodelineData lSingle;
+            parseMrz(lViews[i], &lSingle);
+            READERD_CHECK(std::memcmp(&lSingle, &lExpected[i], sizeof(lSingle)) == 0);
+        }
+    }
+    setSimdLevel(lInitial);
+}
+
+} // namespace
+
+int main()
+{
+    testCheckDigits();
+    testBatchMatchesScalar();
+    return failures() == 0 ? 0 : 1;
+}
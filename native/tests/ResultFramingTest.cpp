@@ -0,0 +1,151 @@
+#include "readerd/ResultClient.h"
+#include "readerd/ResultServer.h"
+
+#include "TestSupport.h"
+
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+void publishEvent(ResultServer *aServer, MMMReaderEventCode aEvent, uint32_t aDocument)
+{
+    aServer->publish(RecordHeader{RK_EVENT, static_cast<uint32_t>(aEvent), aDocument, 0}, DataRef());
+}
+
+void publishData(ResultServer *aServer, uint32_t aDocument, const Bytes &aPayload)
+{
+    aServer->publish(RecordHeader{RK_DATA, CD_IMAGEVIS, aDocument, static_cast<uint32_t>(aPayload.size())},
+                     DataRef::copyOf(aPayload.data(), aPayload.size()));
+}
+
+/// Connects \a aClient and waits for the server's I/O thread to take it on.
+bool connect(ResultServer *aServer, ResultClient *aClient, const std::string &aAddress, size_t aClients)
+{
+    std::string lError;
+    if (aClient->connect(aAddress, &lError) != NO_ERROR_OCCURRED)
+        return false;
+    for (int i = 0; i < 500 && aServer->clientCount() < aClients; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    return aServer->clientCount() == aClients;
+}
+
+void testDocuments()
+{
+    TempDirectory lDirectory;
+    const std::string lAddress = lDirectory.file("results.sock");
+    ResultServer lServer(lAddress, 256u << 20, SF_DOCUMENTS);
+    std::string lError;
+    READERD_CHECK(lServer.start(&lError) == NO_ERROR_OCCURRED);
+
+    // Begun before anyone connected: the client joins in the middle and starts with the next.
+    publishEvent(&lServer, START_OF_DOCUMENT_DATA, 1);
+    ResultClient lClient;
+    if (!READERD_CHECK(connect(&lServer, &lClient, lAddress, 1)))
+        return;
+    publishData(&lServer, 1, Bytes(100, 0x11));
+    publishEvent(&lServer, END_OF_DOCUMENT_DATA, 1);
+
+    const Bytes lPayload = bytes("an image");
+    publishEvent(&lServer, START_OF_DOCUMENT_DATA, 2);
+    publishData(&lServer, 2, lPayload);
+    publishEvent(&lServer, END_OF_DOCUMENT_DATA, 2);
+    const char kMessage[] = "late";
+    lServer.publish(RecordHeader{RK_ERROR, ERROR_TIMED_OUT, 2, sizeof(kMessage)}, DataRef::copyOf(kMessage, sizeof(kMessage)));
+
+    Frame lFrame;
+    READERD_CHECK(lClient.readFrame(&lFrame, &lError));
+    READERD_CHECK(lFrame.isDocument() && lFrame.puHeader.puDocument == 2);
+    if (READERD_CHECK(lFrame.puRecords.size() == 3))
+    {
+        READERD_CHECK(lFrame.puRecords[0].puHeader.puCode == START_OF_DOCUMENT_DATA);
+        READERD_CHECK(Bytes(lFrame.puRecords[1].puPayload.begin(), lFrame.puRecords[1].puPayload.end()) == lPayload);
+        READERD_CHECK(lFrame.puRecords[2].puHeader.puCode == END_OF_DOCUMENT_DATA);
+    }
+    // Outside a document a record is a frame of its own.
+    READERD_CHECK(lClient.readFrame(&lFrame, &lError));
+    READERD_CHECK(!lFrame.isDocument() && lFrame.puRecords.size() == 1);
+    READERD_CHECK(lFrame.puRecords[0].puHeader.puKind == RK_ERROR);
+
+    // Too large for one frame: sent as several, none of them marked as the whole document.
+    const Bytes lLarge(kMaxFrameBytes * 2 / 3, 0x22);
+    publishEvent(&lServer, START_OF_DOCUMENT_DATA, 3);
+    publishData(&lServer, 3, lLarge);
+    publishData(&lServer, 3, lLarge);
+    publishEvent(&lServer, END_OF_DOCUMENT_DATA, 3);
+    size_t lRecords = 0;
+    for (int i = 0; i < 2; ++i)
+    {
+        READERD_CHECK(lClient.readFrame(&lFrame, &lError));
+        READERD_CHECK(!lFrame.isDocument() && lFrame.puHeader.puDocument == 3);
+        READERD_CHECK(lFrame.puHeader.puLength <= kMaxFrameBytes);
+        lRecords += lFrame.puRecords.size();
+    }
+    READERD_CHECK(lRecords == 4);
+
+    lServer.stop();
+    READERD_CHECK(!lClient.readFrame(&lFrame, &lError) && lError.empty());
+}
+
+// A frame claiming more than kMaxFrameBytes is refused before anything is allocated for it.
+void testOversizedFrame()
+{
+    TempDirectory lDirectory;
+    const std::string lAddress = lDirectory.file("raw.sock");
+    const int lListen = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un lName{};
+    lName.sun_family = AF_UNIX;
+    std::strncpy(lName.sun_path, lAddress.c_str(), sizeof(lName.sun_path) - 1);
+    READERD_CHECK(::bind(lListen, reinterpret_cast<const sockaddr *>(&lName), sizeof(lName)) == 0);
+    READERD_CHECK(::listen(lListen, 1) == 0);
+
+    ResultClient lClient;
+    std::string lError;
+    READERD_CHECK(lClient.connect(lAddress, &lError) == NO_ERROR_OCCURRED);
+    const int lPeer = ::accept(lListen, nullptr, nullptr);
+    const FrameHeader lHeader{kFrameMagic, kFrameVersion, FF_DOCUMENT, 1, 1, kMaxFrameBytes + 1};
+    READERD_CHECK(::write(lPeer, &lHeader, sizeof(lHeader)) == static_cast<ssize_t>(sizeof(lHeader)));
+    Frame lFrame;
+    READERD_CHECK(!lClient.readFrame(&lFrame, &lError) && !lError.empty());
+    ::close(lPeer);
+    ::close(lListen);
+}
+
+void testParseRecords()
+{
+    Bytes lBody;
+    for (uint32_t lLength : {3u, 0u})
+    {
+        const RecordHeader lHeader{RK_DATA, CD_CODELINE, 1, lLength};
+        const auto *lRaw = reinterpret_cast<const uint8_t *>(&lHeader);
+        lBody.insert(lBody.end(), lRaw, lRaw + sizeof(lHeader));
+        lBody.insert(lBody.end(), lLength, 0x33);
+    }
+    std::vector<FrameRecord> lRecords;
+    READERD_CHECK(ResultClient::parseRecords(lBody, 2, &lRecords) && lRecords.size() == 2);
+    READERD_CHECK(lRecords[0].puPayload.size() == 3 && lRecords[1].puPayload.empty());
+    READERD_CHECK(!ResultClient::parseRecords(lBody, 1, &lRecords));     // Bytes left over.
+    READERD_CHECK(!ResultClient::parseRecords(lBody, 3, &lRecords));
+    READERD_CHECK(!ResultClient::parseRecords(lBody, 0xFFFFFFFF, &lRecords));
+    READERD_CHECK(!ResultClient::parseRecords(std::span<const uint8_t>(lBody).first(lBody.size() - 1), 2, &lRecords));
+}
+
+} // namespace
+
+int main()
+{
+    // A server that stops sending would leave readFrame() waiting for good.
+    ::alarm(60);
+    testDocuments();
+    testOversizedFrame();
+    testParseRecords();
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+#include "readerd/RevocationCache.h"
+#include "readerd/TlvReader.h"
+
+#include "TestSupport.h"
+
+#include <chrono>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+/// An unsigned CRL of \a aIssuer revoking \a aSerials; with an empty \a aNextUpdate it has none.
+Bytes revocationList(std::string_view aIssuer, std::string_view aThisUpdate, std::string_view aNextUpdate,
+                     std::initializer_list<Bytes> aSerials)
+{
+    const Bytes lAlgorithm = der(0x30, {der(0x06, {{0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x03, 0x02}})});
+    Bytes lEntries;
+    for (const Bytes &lSerial : aSerials)
+    {
+        const Bytes lEntry = der(0x30, {der(0x02, {lSerial}), der(0x17, {bytes("250101000000Z")})});
+        lEntries.insert(lEntries.end(), lEntry.begin(), lEntry.end());
+    }
+    const Bytes lNextUpdate = aNextUpdate.empty() ? Bytes() : der(0x18, {bytes(aNextUpdate)});
+    const Bytes lRevoked = aSerials.size() == 0 ? Bytes() : der(0x30, {lEntries});
+    const Bytes lTbs = der(0x30, {der(0x02, {{0x01}}), lAlgorithm, name(aIssuer), der(0x18, {bytes(aThisUpdate)}),
+                                  lNextUpdate, lRevoked});
+    return der(0x30, {lTbs, lAlgorithm, der(0x03, {{0x00}})});
+}
+
+constexpr std::string_view kFuture = "20991231235959Z";
+
+void testParse()
+{
+    const Bytes lDer = revocationList("CSCA Utopia", "20250101000000Z", kFuture, {{0x05}, {0x01, 0x00}, {0x05}});
+    RevocationList lList;
+    READERD_CHECK(parseRevocationList(lDer, &lList));
+    READERD_CHECK(equal(lList.puIssuer, name("CSCA Utopia")));
+    READERD_CHECK(lList.puThisUpdate == "20250101000000Z");
+    READERD_CHECK(lList.puNextUpdate == kFuture);
+    READERD_CHECK(lList.puNextUpdateTime == 4102444799);
+    READERD_CHECK(lList.puSerials.size() == 2);     // Sorted, and the repeated serial once.
+
+    READERD_CHECK(parseRevocationList(revocationList("CSCA Utopia", "20250101000000Z", "", {}), &lList));
+    READERD_CHECK(lList.puNextUpdate.empty() && lList.puNextUpdateTime == 0 && lList.puSerials.empty());
+
+    for (size_t lLength = 0; lLength < lDer.size(); ++lLength)
+        READERD_CHECK(!parseRevocationList(Bytes(lDer.begin(), lDer.begin() + static_cast<long>(lLength)), &lList));
+    Bytes lTrailing = lDer;
+    lTrailing.push_back(0x00);
+    READERD_CHECK(!parseRevocationList(lTrailing, &lList));
+    READERD_CHECK(!parseRevocationList(revocationList("CSCA Utopia", "20250101000000Z", kFuture,
+                                                      {Bytes(kMaxSerialLength + 1, 0x7F)}),
+                                       &lList));
+    READERD_CHECK(!parseRevocationList(certificate({0x01}, "CSCA Utopia", "DS Utopia"), &lList));
+}
+
+// Replaces the file at aPath and moves its modification time, so that a refresh within the
+// resolution of the file system clock still sees it change.
+void replaceFile(const std::string &aPath, const Bytes &aBytes, int aSecondsLater)
+{
+    std::filesystem::file_time_type lBefore{};
+    std::error_code lError;
+    if (std::filesystem::exists(aPath))
+        lBefore = std::filesystem::last_write_time(aPath);
+    writeFile(aPath, aBytes);
+    std::filesystem::last_write_time(aPath, lBefore + std::chrono::seconds(aSecondsLater), lError);
+}
+
+void testRefresh()
+{
+    TempDirectory lDirectory;
+    RevocationSource lSource;
+    lSource.puDirectory = lDirectory.path();
+    RevocationCache lCache(lSource);
+    RevocationRefreshStats lStats;
+    std::string lError;
+
+    const Bytes lUtopia = name("CSCA Utopia");
+    const Bytes lRevoked = {0x0A, 0x01};
+    const Bytes lGood = {0x0B};
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puFiles == 0 && lStats.puLists == 0);
+    READERD_CHECK(lCache.check(lUtopia, lRevoked) == RS_UNKNOWN);
+
+    // Added.
+    const std::string lPath = lDirectory.file("utopia.crl");
+    writeFile(lPath, revocationList("CSCA Utopia", "20250101000000Z", kFuture, {lRevoked}));
+    writeFile(lDirectory.file("junk.crl"), bytes("not a list"));
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puFiles == 2 && lStats.puParsed == 2 && lStats.puSkipped == 1);
+    READERD_CHECK(lStats.puLists == 1 && lStats.puSerials == 1);
+    READERD_CHECK(lCache.check(lUtopia, lRevoked) == RS_REVOKED);
+    READERD_CHECK(lCache.check(lUtopia, lGood) == RS_GOOD);
+    READERD_CHECK(lCache.check(name("CSCA Elsewhere"), lRevoked) == RS_UNKNOWN);
+    READERD_CHECK(lCache.checkIssuerSerial(der(0x30, {lUtopia, der(0x02, {lRevoked})})) == RS_REVOKED);
+
+    // Unchanged files are not read again.
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puFiles == 2 && lStats.puParsed == 0 && lStats.puSkipped == 1);
+
+    // Replaced: the new list revokes lGood as well and is past its nextUpdate.
+    replaceFile(lPath, revocationList("CSCA Utopia", "20250201000000Z", "20250301000000Z", {lRevoked, lGood}), 1);
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puParsed == 1 && lStats.puSerials == 2);
+    READERD_CHECK(lCache.check(lUtopia, lGood) == RS_REVOKED);
+    READERD_CHECK(lCache.check(lUtopia, Bytes({0x0C})) == RS_STALE);
+
+    // Of two lists of one issuer, the later thisUpdate wins.
+    writeFile(lDirectory.file("utopia-old.crl"), revocationList("CSCA Utopia", "20240101000000Z", kFuture, {}));
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puLists == 1);
+    READERD_CHECK(lCache.check(lUtopia, lGood) == RS_REVOKED);
+
+    // Handed to the SDK as it asks for it: too small a buffer is told the length needed.
+    const Bytes lRequest = der(0x30, {lUtopia, der(0x02, {lGood})});
+    int lLength = 0;
+    READERD_CHECK(!lCache.provide(reinterpret_cast<const char *>(lRequest.data()), static_cast<int>(lRequest.size()),
+                                  nullptr, &lLength));
+    std::vector<char> lBuffer(static_cast<size_t>(lLength));
+    READERD_CHECK(lLength > 0 && lCache.provide(reinterpret_cast<const char *>(lRequest.data()),
+                                                static_cast<int>(lRequest.size()), lBuffer.data(), &lLength));
+    READERD_CHECK(static_cast<size_t>(lLength) == lCache.find(lUtopia)->puDer.size());
+
+    // Deleted: the older list of the issuer takes over, then none is left.
+    std::filesystem::remove(lPath);
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puRemoved == 1 && lStats.puLists == 1);
+    READERD_CHECK(lCache.check(lUtopia, lGood) == RS_GOOD);
+    std::filesystem::remove(lDirectory.file("utopia-old.crl"));
+    READERD_CHECK(lCache.refresh(&lStats, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lStats.puRemoved == 1 && lStats.puLists == 0);
+    READERD_CHECK(lCache.check(lUtopia, lRevoked) == RS_UNKNOWN);
+    READERD_CHECK(lCache.find(lUtopia) == nullptr);
+
+    // A directory that cannot be listed is reported.
+    RevocationSource lMissing;
+    lMissing.puDirectory = lDirectory.file("missing");
+    RevocationCache lMissingCache(lMissing);
+    READERD_CHECK(lMissingCache.refresh(&lStats, &lError) == ERROR_READING_FILE && !lError.empty());
+}
+
+} // namespace
+
+int main()
+{
+    testParse();
+    testRefresh();
+    return failures() == 0 ? 0 : 1;
+}
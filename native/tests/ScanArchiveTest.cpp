@@ -0,0 +1,133 @@
+#include "readerd/ScanArchive.h"
+
+#include "TestSupport.h"
+
+#include <csignal>
+#include <sys/resource.h>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+/// Feeds one document of a security check result and an image to \a aWriter.
+void scan(ArchiveWriter *aWriter, uint32_t aDocument, int32_t aSecurityCheck, const Bytes &aImage)
+{
+    aWriter->onEvent(START_OF_DOCUMENT_DATA, aDocument);
+    aWriter->onData(DataItem(CD_SECURITYCHECK, aDocument, &aSecurityCheck, sizeof(aSecurityCheck)));
+    aWriter->onData(DataItem(CD_IMAGEVIS, aDocument, aImage.data(), aImage.size()));
+    aWriter->onEvent(END_OF_DOCUMENT_DATA, aDocument);
+}
+
+Bytes image(size_t aSize, uint8_t aSeed)
+{
+    Bytes lImage(aSize);
+    for (size_t i = 0; i < aSize; ++i)
+        lImage[i] = static_cast<uint8_t>(aSeed + i * 7);
+    return lImage;
+}
+
+ArchiveOptions options(uint32_t aSegmentDocuments)
+{
+    ArchiveOptions lOptions;
+    lOptions.puSegmentDocuments = aSegmentDocuments;
+    lOptions.puWaitForWriter = true;
+    return lOptions;
+}
+
+void testRoundTrip()
+{
+    TempDirectory lDirectory;
+    const std::string lPath = lDirectory.file("scans.rdar");
+    const Bytes lFirst = image(1001, 1);
+    const Bytes lSecond = image(64, 2);
+    std::string lError;
+
+    ArchiveWriter lWriter;
+    READERD_CHECK(lWriter.open(lPath, options(2), &lError) == NO_ERROR_OCCURRED);
+    scan(&lWriter, 1, 7, lFirst);
+    scan(&lWriter, 2, -3, lSecond);
+    lWriter.onEvent(START_OF_DOCUMENT_DATA, 3);     // Never ended, so never archived.
+    lWriter.close();
+    READERD_CHECK(lWriter.stats().puDocuments == 2 && lWriter.stats().puSegments == 1);
+
+    // A torn chunk at the end, as a crash leaves it, is cut off when the writer opens it again.
+    const ArchiveChunkHeader lTorn{kArchiveChunkMagic, AC_BLOBS, 4096};
+    {
+        std::ofstream lOut(lPath, std::ios::binary | std::ios::app);
+        lOut.write(reinterpret_cast<const char *>(&lTorn), sizeof(lTorn));
+    }
+    READERD_CHECK(lWriter.open(lPath, options(2), &lError) == NO_ERROR_OCCURRED);
+    scan(&lWriter, 4, 1, lSecond);
+    lWriter.close();
+
+    ArchiveReader lReader;
+    READERD_CHECK(lReader.open(lPath, &lError) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lReader.documents() == 3);
+    if (!READERD_CHECK(lReader.segments().size() == 2))
+        return;
+    const ArchiveSegment &lSegment = lReader.segments()[0];
+    const ArchiveColumn lDocuments = lSegment.column(kArchiveDocumentColumn);
+    const ArchiveColumn lChecks = lSegment.column(archiveColumnId(CD_SECURITYCHECK));
+    const ArchiveColumn lImages = lSegment.column(archiveColumnId(CD_IMAGEVIS));
+    READERD_CHECK(lSegment.rows() == 2);
+    READERD_CHECK(lDocuments.integer(0) == 1 && lDocuments.integer(1) == 2);
+    READERD_CHECK(lChecks.kind() == ACK_INT32 && lChecks.integer(0) == 7 && lChecks.integer(1) == -3);
+    READERD_CHECK(lImages.kind() == ACK_BLOB && lImages.present(0));
+    READERD_CHECK(Bytes(lImages.blob(0).begin(), lImages.blob(0).end()) == lFirst);
+    READERD_CHECK(Bytes(lImages.blob(1).begin(), lImages.blob(1).end()) == lSecond);
+    READERD_CHECK(!lSegment.column(archiveColumnId(CD_CODELINE)).valid());
+    READERD_CHECK(lReader.segments()[1].column(kArchiveDocumentColumn).integer(0) == 4);
+
+    READERD_CHECK(lReader.open(lDirectory.file("missing"), &lError) != NO_ERROR_OCCURRED);
+    writeFile(lDirectory.file("junk"), bytes("not an archive at all"));
+    READERD_CHECK(lReader.open(lDirectory.file("junk"), &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+}
+
+// A chunk that does not fit under the file size limit fails part-way. It is cut off again, so
+// the segment and the documents after it are still read, and its blob reads as not stored.
+void testFailedAppend()
+{
+    TempDirectory lDirectory;
+    const std::string lPath = lDirectory.file("scans.rdar");
+    const Bytes lSmall = image(64, 3);
+    const Bytes lLarge = image(256 * 1024, 4);
+    std::string lError;
+
+    rlimit lLimit{};
+    ::getrlimit(RLIMIT_FSIZE, &lLimit);
+    const rlimit lInitial = lLimit;
+    std::signal(SIGXFSZ, SIG_IGN);
+    lLimit.rlim_cur = 64 * 1024;
+    if (!READERD_CHECK(::setrlimit(RLIMIT_FSIZE, &lLimit) == 0))
+        return;
+
+    ArchiveWriter lWriter;
+    READERD_CHECK(lWriter.open(lPath, options(1), &lError) == NO_ERROR_OCCURRED);
+    scan(&lWriter, 1, 1, lSmall);
+    scan(&lWriter, 2, 2, lLarge);
+    scan(&lWriter, 3, 3, lSmall);
+    lWriter.close();
+    ::setrlimit(RLIMIT_FSIZE, &lInitial);
+
+    READERD_CHECK(lWriter.stats().puSegments == 3);
+    READERD_CHECK(std::filesystem::file_size(lPath) == lWriter.stats().puBytes + sizeof(ArchiveFileHeader));
+    ArchiveReader lReader;
+    READERD_CHECK(lReader.open(lPath, &lError) == NO_ERROR_OCCURRED);
+    if (!READERD_CHECK(lReader.segments().size() == 3))
+        return;
+    const ArchiveColumn lFailed = lReader.segments()[1].column(archiveColumnId(CD_IMAGEVIS));
+    READERD_CHECK(lFailed.present(0) && lFailed.blob(0).empty());
+    READERD_CHECK(lReader.segments()[1].column(archiveColumnId(CD_SECURITYCHECK)).integer(0) == 2);
+    const ArchiveColumn lAfter = lReader.segments()[2].column(archiveColumnId(CD_IMAGEVIS));
+    READERD_CHECK(Bytes(lAfter.blob(0).begin(), lAfter.blob(0).end()) == lSmall);
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testFailedAppend();
+    return failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+#include "readerd/SecurityObject.h"
+
+#include "TestSupport.h"
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+void testEfSodRoundTrip()
+{
+    SecurityObject lObject;
+    lObject.puAlgorithm = DA_SHA256;
+    for (int lGroup : {1, 2, 14, 15})
+        lObject.puDigests[lGroup] = Bytes(32, static_cast<uint8_t>(lGroup));
+
+    SecurityObject lParsed;
+    const Bytes lUnsigned = buildEfSod(lObject);
+    READERD_CHECK(parseEfSod(lUnsigned, &lParsed));
+    READERD_CHECK(lParsed.puAlgorithm == DA_SHA256);
+    READERD_CHECK(lParsed.puDigests == lObject.puDigests);
+    READERD_CHECK(lParsed.puSignerIssuer.empty() && lParsed.puSignerSerial.empty());
+
+    // The signer certificate is named by issuer and serial number.
+    const Bytes lSigner = certificate({0x01, 0x23}, "CSCA", "Document Signer");
+    const Bytes lSigned = buildEfSod(lObject, lSigner);
+    READERD_CHECK(parseEfSod(lSigned, &lParsed));
+    READERD_CHECK(lParsed.puDigests == lObject.puDigests);
+    READERD_CHECK(lParsed.puSignerIssuer == name("CSCA"));
+    READERD_CHECK(lParsed.puSignerSerial == Bytes({0x01, 0x23}));
+
+    for (size_t lLength = 0; lLength < lSigned.size(); lLength += 7)
+        READERD_CHECK(!parseEfSod(std::span<const uint8_t>(lSigned).first(lLength), &lParsed));
+    Bytes lWrongTag = lSigned;
+    lWrongTag[0] = 0x60;
+    READERD_CHECK(!parseEfSod(lWrongTag, &lParsed));
+}
+
+void testEfComRoundTrip()
+{
+    const std::vector<int> lGroups = {1, 2, 3, 11, 12, 14, 15, 16};
+    std::vector<int> lParsed = {7};
+    const Bytes lEfCom = buildEfCom(lGroups);
+    READERD_CHECK(parseEfCom(lEfCom, &lParsed));
+    READERD_CHECK(lParsed == lGroups);
+
+    READERD_CHECK(parseEfCom(buildEfCom({}), &lParsed) && lParsed.empty());
+    READERD_CHECK(!parseEfCom(std::span<const uint8_t>(lEfCom).first(lEfCom.size() - 1), &lParsed));
+    READERD_CHECK(!parseEfCom(buildEfSod(SecurityObject()), &lParsed));
+}
+
+} // namespace
+
+int main()
+{
+    testEfSodRoundTrip();
+    testEfComRoundTrip();
+    return failures() == 0 ? 0 : 1;
+}
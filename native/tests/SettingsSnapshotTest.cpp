@@ -0,0 +1,187 @@
+#include "readerd/SettingsSnapshot.h"
+#include "readerd/SimulatedBackend.h"
+
+#include "TestSupport.h"
+
+#include <cstring>
+#include <iterator>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+/// Whether \a aA and \a aB agree on everything but the directory members.
+bool sameSettings(const MMMReaderSettings &aA, const MMMReaderSettings &aB)
+{
+    MMMReaderSettings lA;
+    MMMReaderSettings lB;
+    std::memcpy(static_cast<void *>(&lA), &aA, sizeof(lA));
+    std::memcpy(static_cast<void *>(&lB), &aB, sizeof(lB));
+    for (RTCHAR *MMMReaderSettings::*lMember : kSettingsDirectories)
+    {
+        lA.*lMember = nullptr;
+        lB.*lMember = nullptr;
+    }
+    return std::memcmp(&lA, &lB, sizeof(lA)) == 0;
+}
+
+Bytes readAll(const std::string &aPath)
+{
+    std::ifstream lIn(aPath, std::ios::binary);
+    return Bytes((std::istreambuf_iterator<char>(lIn)), std::istreambuf_iterator<char>());
+}
+
+void testRoundTrip()
+{
+    TempDirectory lDirectory;
+    const std::string lPath = lDirectory.file("settings.snapshot");
+    std::string lError;
+
+    MMMReaderSettings lSettings;
+    uint8_t *lRaw = reinterpret_cast<uint8_t *>(&lSettings);
+    for (size_t i = 0; i < sizeof(lSettings); ++i)
+        lRaw[i] = static_cast<uint8_t>(i * 13);
+    std::string lNames[std::size(kSettingsDirectories)];
+    for (size_t i = 0; i < std::size(kSettingsDirectories); ++i)
+    {
+        lNames[i] = "/opt/reader/folder-" + std::to_string(i);
+        lSettings.*kSettingsDirectories[i] = i == 2 ? nullptr : lNames[i].data();
+    }
+    SettingsKey lKey;
+    lKey.puFiles = 3;
+    lKey.puFilesHash = 0x1234;
+    std::strcpy(lKey.puSdkVersion, "3.7.1.16");
+    READERD_CHECK(SettingsSnapshot::write(lSettings, lKey, lPath, &lError) == NO_ERROR_OCCURRED);
+
+    SettingsSnapshot lSnapshot;
+    READERD_CHECK(!lSnapshot.matches(lKey));
+    if (!READERD_CHECK(lSnapshot.open(lPath, &lError) == NO_ERROR_OCCURRED))
+        return;
+    READERD_CHECK(sameSettings(lSnapshot.settings(), lSettings));
+    for (size_t i = 0; i < std::size(kSettingsDirectories); ++i)
+    {
+        const RTCHAR *lDirectory = lSnapshot.settings().*kSettingsDirectories[i];
+        READERD_CHECK(i == 2 ? lDirectory == nullptr : lDirectory != nullptr && lNames[i] == lDirectory);
+    }
+    READERD_CHECK(lSnapshot.matches(lKey));
+    SettingsKey lOther = lKey;
+    lOther.puFilesHash = 0x1235;
+    READERD_CHECK(!lSnapshot.matches(lOther));
+    lOther = lKey;
+    std::strcpy(lOther.puSdkVersion, "3.7.1.17");
+    READERD_CHECK(!lSnapshot.matches(lOther));
+
+    // Anything changed after the header fails the checksum; a snapshot without its magic or
+    // cut short is not opened either.
+    const Bytes lGood = readAll(lPath);
+    const std::string lBadPath = lDirectory.file("bad");
+    for (size_t lAt : {size_t{0}, size_t{kSettingsSnapshotBody} + 7, lGood.size() - 1})
+    {
+        Bytes lBad = lGood;
+        lBad[lAt] ^= 0x01;
+        writeFile(lBadPath, lBad);
+        READERD_CHECK(lSnapshot.open(lBadPath, &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+    }
+    writeFile(lBadPath, Bytes(lGood.begin(), lGood.end() - 1));
+    READERD_CHECK(lSnapshot.open(lBadPath, &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+    writeFile(lBadPath, Bytes(lGood.begin(), lGood.begin() + 64));
+    READERD_CHECK(lSnapshot.open(lBadPath, &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+    READERD_CHECK(lSnapshot.open(lDirectory.file("missing"), &lError) == ERROR_OS_ERROR);
+    READERD_CHECK(!lSnapshot.matches(lKey));
+
+    READERD_CHECK(SettingsSnapshot::write(lSettings, lKey, lDirectory.file("missing/x"), &lError) == ERROR_WRITING_FILE);
+}
+
+void testKey()
+{
+    TempDirectory lDirectory;
+    const std::string lConfig = lDirectory.file("Config");
+    const std::string lPlugins = lDirectory.file("Plugins");
+    std::filesystem::create_directories(lConfig);
+    std::filesystem::create_directories(lPlugins);
+    writeFile(lDirectory.file("MMMReader.ini"), bytes("[Location]\n"));
+    writeFile(lConfig + "/Camera.ini", bytes("[Camera]\nGain=3\n"));
+
+    std::string lBin = lDirectory.path();
+    std::string lCfg = lConfig;
+    MMMReaderSettings lSettings{};
+    lSettings.puBinDir = lBin.data();
+    lSettings.puCfgDir = lCfg.data();
+    SettingsSource lSource;
+    lSource.puWatchDirectories = {lPlugins, lDirectory.file("absent")};
+
+    std::string lError;
+    const auto lKey = [&](const std::string &aVersion) {
+        SettingsKey lResult;
+        READERD_CHECK(settingsKey(lSettings, lSource, aVersion, &lResult, &lError) == NO_ERROR_OCCURRED);
+        return lResult;
+    };
+    const auto lSame = [](const SettingsKey &aA, const SettingsKey &aB) {
+        return aA.puFiles == aB.puFiles && aA.puFilesHash == aB.puFilesHash
+            && std::strcmp(aA.puSdkVersion, aB.puSdkVersion) == 0;
+    };
+
+    const SettingsKey lBase = lKey("sim-1");
+    READERD_CHECK(lBase.puFiles == 2 && std::strcmp(lBase.puSdkVersion, "sim-1") == 0);
+    READERD_CHECK(lSame(lKey("sim-1"), lBase));
+    READERD_CHECK(!lSame(lKey("sim-2"), lBase));
+
+    // Only INI files count, whatever the case of their extension.
+    writeFile(lConfig + "/notes.txt", bytes("ignored"));
+    READERD_CHECK(lSame(lKey("sim-1"), lBase));
+    writeFile(lConfig + "/Camera.ini", bytes("[Camera]\nGain=4\n"));
+    READERD_CHECK(!lSame(lKey("sim-1"), lBase));
+    writeFile(lPlugins + "/Plugin.INI", bytes("[Plugin]\n"));
+    READERD_CHECK(lKey("sim-1").puFiles == 3);
+
+    lSource.puIniPath = lDirectory.file("missing.ini");
+    SettingsKey lMissing;
+    READERD_CHECK(settingsKey(lSettings, lSource, "sim-1", &lMissing, &lError) == ERROR_READING_FILE);
+}
+
+void testLoadCached()
+{
+    TempDirectory lDirectory;
+    const std::string lIni = lDirectory.file("MMMReader.ini");
+    writeFile(lIni, bytes("[Location]\n"));
+    std::filesystem::create_directories(lDirectory.file("Config"));
+    writeFile(lDirectory.file("Config/Camera.ini"), bytes("[Camera]\n"));
+
+    SimulatedBackend lBackend{SimulatedOptions()};
+    SettingsSource lSource;
+    lSource.puIniPath = lIni;
+    lSource.puSnapshotPath = lDirectory.file("settings.snapshot");
+
+    SettingsSnapshot lSnapshot;
+    MMMReaderSettings lParsed;
+    SettingsLoadResult lResult;
+    READERD_CHECK(loadSettingsCached(lBackend, lSource, &lSnapshot, &lParsed, &lResult) == NO_ERROR_OCCURRED);
+    READERD_CHECK(!lResult.puFromSnapshot && lResult.puSnapshotWritten && !lResult.puMissReason.empty());
+
+    MMMReaderSettings lCached;
+    READERD_CHECK(loadSettingsCached(lBackend, lSource, &lSnapshot, &lCached, &lResult) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lResult.puFromSnapshot && !lResult.puSnapshotWritten);
+    READERD_CHECK(sameSettings(lCached, lParsed));
+    READERD_CHECK(std::string(lCached.puCfgDir) == lParsed.puCfgDir);
+
+    // An edited INI file makes the snapshot stale; it is parsed and saved again.
+    writeFile(lDirectory.file("Config/Camera.ini"), bytes("[Camera]\nGain=1\n"));
+    READERD_CHECK(loadSettingsCached(lBackend, lSource, &lSnapshot, &lCached, &lResult) == NO_ERROR_OCCURRED);
+    READERD_CHECK(!lResult.puFromSnapshot && lResult.puSnapshotWritten);
+    READERD_CHECK(loadSettingsCached(lBackend, lSource, &lSnapshot, &lCached, &lResult) == NO_ERROR_OCCURRED);
+    READERD_CHECK(lResult.puFromSnapshot);
+
+    lSource.puIniPath = lDirectory.file("missing.ini");
+    READERD_CHECK(loadSettingsCached(lBackend, lSource, &lSnapshot, &lCached, &lResult) == ERROR_FILE_DOES_NOT_EXIST);
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testKey();
+    testLoadCached();
+    return failures() == 0 ? 0 : 1;
+}
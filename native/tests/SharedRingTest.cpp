@@ -0,0 +1,170 @@
+#include "readerd/SharedRing.h"
+
+#include "TestSupport.h"
+
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace readerd;
+using namespace readerd::test;
+
+namespace {
+
+using std::chrono::milliseconds;
+
+std::string ringName(const char *aSuffix)
+{
+    return "/readerd-test-" + std::to_string(::getpid()) + "-" + aSuffix;
+}
+
+Bytes payload(size_t aSize, uint32_t aDocument)
+{
+    Bytes lPayload(aSize);
+    for (size_t i = 0; i < aSize; ++i)
+        lPayload[i] = static_cast<uint8_t>(aDocument * 31 + i);
+    return lPayload;
+}
+
+/// Writes document \a aDocument with one data item of \a aSize bytes.
+void writeDocument(SharedRingWriter *aWriter, uint32_t aDocument, size_t aSize)
+{
+    const Bytes lPayload = payload(aSize, aDocument);
+    aWriter->onEvent(START_OF_DOCUMENT_DATA, aDocument);
+    aWriter->onData(DataItem(CD_IMAGEVIS, aDocument, lPayload.data(), lPayload.size()));
+    aWriter->onEvent(END_OF_DOCUMENT_DATA, aDocument);
+}
+
+/// Whether \a aDocument is what writeDocument() wrote.
+bool isDocument(const SharedDocument &aDocument, uint32_t aNumber, size_t aSize)
+{
+    const Bytes lPayload = payload(aSize, aNumber);
+    return aDocument.puDocument == aNumber && aDocument.puRecords.size() == 3
+        && aDocument.puRecords[0].puHeader.puCode == START_OF_DOCUMENT_DATA
+        && Bytes(aDocument.puRecords[1].puPayload.begin(), aDocument.puRecords[1].puPayload.end()) == lPayload
+        && aDocument.puRecords[2].puHeader.puCode == END_OF_DOCUMENT_DATA;
+}
+
+void testDocuments()
+{
+    const std::string lName = ringName("documents");
+    SharedRingWriter lWriter;
+    SharedRingReader lReader;
+    std::string lError;
+    READERD_CHECK(lWriter.create(lName, 4096, &lError) == NO_ERROR_OCCURRED);
+
+    // Nothing is written while no reader is attached, and a reader starts with the next document.
+    writeDocument(&lWriter, 1, 100);
+    READERD_CHECK(lWriter.stats().puDocuments == 0);
+    if (!READERD_CHECK(lReader.open(lName, &lError) == NO_ERROR_OCCURRED))
+        return;
+    SharedDocument lDocument;
+    READERD_CHECK(!lReader.next(&lDocument, milliseconds(1)) && !lReader.closed());
+
+    lWriter.onEvent(START_OF_DOCUMENT_DATA, 2);
+    lWriter.onError(ERROR_TIMED_OUT, "late", 2);
+    lWriter.onEvent(END_OF_DOCUMENT_DATA, 2);
+    if (READERD_CHECK(lReader.next(&lDocument, milliseconds(1000))) && READERD_CHECK(lDocument.puRecords.size() == 3))
+    {
+        const FrameRecord &lRecord = lDocument.puRecords[1];
+        READERD_CHECK(lRecord.puHeader.puKind == RK_ERROR && lRecord.puHeader.puCode == ERROR_TIMED_OUT);
+        READERD_CHECK(std::string(lRecord.puPayload.begin(), lRecord.puPayload.end()) == "late");
+    }
+
+    // Sizes that leave every kind of gap at the end of the ring, each read as it is committed.
+    bool lMatches = true;
+    for (uint32_t i = 0; i < 300; ++i)
+    {
+        const size_t lSize = (i * 397) % 1500;
+        writeDocument(&lWriter, 10 + i, lSize);
+        lMatches = lMatches && lReader.next(&lDocument, milliseconds(1000)) && isDocument(lDocument, 10 + i, lSize);
+    }
+    READERD_CHECK(lMatches);
+    READERD_CHECK(lWriter.stats().puDocuments == 301 && lWriter.stats().puDropped == 0);
+
+    // A reader waiting for a document is woken when it is committed.
+    std::thread lLater([&lWriter] {
+        std::this_thread::sleep_for(milliseconds(50));
+        writeDocument(&lWriter, 400, 10);
+    });
+    const auto lStart = std::chrono::steady_clock::now();
+    READERD_CHECK(lReader.next(&lDocument, milliseconds(10000)) && isDocument(lDocument, 400, 10));
+    READERD_CHECK(std::chrono::steady_clock::now() - lStart < milliseconds(5000));
+    lLater.join();
+
+    // A reader that falls behind loses the documents that do not fit, never part of one.
+    for (uint32_t i = 0; i < 5; ++i)
+        writeDocument(&lWriter, 500 + i, 1000);
+    const uint64_t lDropped = lWriter.stats().puDropped;
+    READERD_CHECK(lDropped >= 2 && lDropped < 5);
+    for (uint32_t i = 0; i < 5 - lDropped; ++i)
+        READERD_CHECK(lReader.next(&lDocument, milliseconds(1000)) && isDocument(lDocument, 500 + i, 1000));
+    READERD_CHECK(!lReader.next(&lDocument, milliseconds(1)));
+    writeDocument(&lWriter, 600, 1000);
+    READERD_CHECK(lReader.next(&lDocument, milliseconds(1000)) && isDocument(lDocument, 600, 1000));
+
+    lWriter.close();
+    READERD_CHECK(!lReader.next(&lDocument, milliseconds(1000)) && lReader.closed());
+}
+
+// A reader process that exits without detaching is detached when the ring fills.
+void testDeadReader()
+{
+    const std::string lName = ringName("dead");
+    SharedRingWriter lWriter;
+    std::string lError;
+    READERD_CHECK(lWriter.create(lName, 4096, &lError) == NO_ERROR_OCCURRED);
+
+    const pid_t lChild = ::fork();
+    if (lChild == 0)
+    {
+        SharedRingReader lReader;
+        ::_exit(lReader.open(lName, &lError) == NO_ERROR_OCCURRED ? 0 : 1);
+    }
+    int lStatus = 0;
+    READERD_CHECK(::waitpid(lChild, &lStatus, 0) == lChild && WIFEXITED(lStatus) && WEXITSTATUS(lStatus) == 0);
+
+    for (uint32_t i = 0; i < 5; ++i)
+        writeDocument(&lWriter, 1 + i, 1000);
+    READERD_CHECK(lWriter.stats().puDocuments == 3 && lWriter.stats().puDropped == 0);
+
+    SharedRingReader lReader;
+    READERD_CHECK(lReader.open(lName, &lError) == NO_ERROR_OCCURRED);
+    SharedDocument lDocument;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        writeDocument(&lWriter, 10 + i, 1000);
+        READERD_CHECK(lReader.next(&lDocument, milliseconds(1000)) && isDocument(lDocument, 10 + i, 1000));
+    }
+}
+
+void testOpen()
+{
+    SharedRingReader lReader;
+    std::string lError;
+    READERD_CHECK(lReader.open(ringName("missing"), &lError) == ERROR_OS_ERROR && !lError.empty());
+    READERD_CHECK(lReader.closed());
+
+    const std::string lName = ringName("junk");
+    const int lFd = ::shm_open(lName.c_str(), O_CREAT | O_RDWR, 0600);
+    READERD_CHECK(lFd >= 0 && ::ftruncate(lFd, 8192) == 0);
+    ::close(lFd);
+    READERD_CHECK(lReader.open(lName, &lError) == ERROR_UNKNOWN_DATA_FORMAT);
+    ::shm_unlink(lName.c_str());
+
+    SharedRingWriter lWriter;
+    READERD_CHECK(lWriter.create(lName, 16, &lError) == ERROR_PARAMETER_INVALID);
+}
+
+} // namespace
+
+int main()
+{
+    testDocuments();
+    testDeadReader();
+    testOpen();
+    return failures() == 0 ? 0 : 1;
+}
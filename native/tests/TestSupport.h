@@ -0,0 +1,127 @@
+#ifndef READERD_TESTS_TESTSUPPORT_H
+#define READERD_TESTS_TESTSUPPORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace readerd::test {
+
+/// Checks that failed so far; main() returns it, so any failure fails the ctest run.
+inline int &failures()
+{
+    static int sFailures = 0;
+    return sFailures;
+}
+
+inline bool report(bool aPassed, const char *aCondition, const char *aFile, int aLine)
+{
+    if (!aPassed)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", aFile, aLine, aCondition);
+        ++failures();
+    }
+    return aPassed;
+}
+
+#define READERD_CHECK(aCondition) ::readerd::test::report(static_cast<bool>(aCondition), #aCondition, __FILE__, __LINE__)
+
+using Bytes = std::vector<uint8_t>;
+
+inline Bytes bytes(std::string_view aText)
+{
+    return Bytes(aText.begin(), aText.end());
+}
+
+/// One DER element: \a aTag, the definite length and the concatenation of \a aParts.
+inline Bytes der(uint8_t aTag, std::initializer_list<Bytes> aParts)
+{
+    Bytes lContent;
+    for (const Bytes &lPart : aParts)
+        lContent.insert(lContent.end(), lPart.begin(), lPart.end());
+    Bytes lOut{aTag};
+    if (lContent.size() < 0x80)
+        lOut.push_back(static_cast<uint8_t>(lContent.size()));
+    else
+    {
+        Bytes lLength;
+        for (size_t lLeft = lContent.size(); lLeft > 0; lLeft >>= 8)
+            lLength.insert(lLength.begin(), static_cast<uint8_t>(lLeft));
+        lOut.push_back(static_cast<uint8_t>(0x80 | lLength.size()));
+        lOut.insert(lOut.end(), lLength.begin(), lLength.end());
+    }
+    lOut.insert(lOut.end(), lContent.begin(), lContent.end());
+    return lOut;
+}
+
+/// A Name holding only the commonName \a aCommonName.
+inline Bytes name(std::string_view aCommonName)
+{
+    return der(0x30, {der(0x31, {der(0x30, {der(0x06, {{0x55, 0x04, 0x03}}), der(0x0C, {bytes(aCommonName)})})})});
+}
+
+/// An unsigned certificate with the fields CertificateStore indexes; without \a aKeyId it has
+/// no extensions.
+inline Bytes certificate(const Bytes &aSerial, std::string_view aIssuer, std::string_view aSubject,
+                         const Bytes &aKeyId = {})
+{
+    const Bytes lAlgorithm = der(0x30, {der(0x06, {{0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x04, 0x03, 0x02}})});
+    const Bytes lValidity = der(0x30, {der(0x17, {bytes("250101000000Z")}), der(0x17, {bytes("350101000000Z")})});
+    const Bytes lKeyInfo = der(0x30, {lAlgorithm, der(0x03, {{0x00, 0x04}})});
+    Bytes lExtensions;
+    if (!aKeyId.empty())
+    {
+        lExtensions = der(0xA3, {der(0x30, {der(0x30, {der(0x06, {{0x55, 0x1D, 0x0E}}),
+                                                       der(0x04, {der(0x04, {aKeyId})})})})});
+    }
+    const Bytes lTbs = der(0x30, {der(0xA0, {der(0x02, {{0x02}})}), der(0x02, {aSerial}), lAlgorithm, name(aIssuer),
+                                  lValidity, name(aSubject), lKeyInfo, lExtensions});
+    return der(0x30, {lTbs, lAlgorithm, der(0x03, {{0x00}})});
+}
+
+/// A new empty directory under the system temporary directory, removed by the destructor.
+class TempDirectory
+{
+public:
+    TempDirectory()
+    {
+        std::string lTemplate = (std::filesystem::temp_directory_path() / "readerd-test-XXXXXX").string();
+        if (::mkdtemp(lTemplate.data()) == nullptr)
+        {
+            std::perror("mkdtemp");
+            std::exit(1);
+        }
+        prPath = lTemplate;
+    }
+
+    ~TempDirectory()
+    {
+        std::error_code lError;
+        std::filesystem::remove_all(prPath, lError);
+    }
+
+    TempDirectory(const TempDirectory &) = delete;
+    TempDirectory &operator=(const TempDirectory &) = delete;
+
+    const std::string &path() const { return prPath; }
+    std::string file(std::string_view aName) const { return prPath + "/" + std::string(aName); }
+
+private:
+    std::string prPath;
+};
+
+inline void writeFile(const std::string &aPath, const Bytes &aBytes)
+{
+    std::ofstream lOut(aPath, std::ios::binary | std::ios::trunc);
+    lOut.write(reinterpret_cast<const char *>(aBytes.data()), static_cast<std::streamsize>(aBytes.size()));
+}
+
+} // namespace readerd::test
+
+#endif // READERD_TESTS_TESTSUPPORT_H
@@ -0,0 +1,230 @@
+// Queries a columnar scan archive written by readerd --archive: what it holds, and rates of
+// a condition grouped by another column, reading only the columns involved.
+
+#include "readerd/ScanArchive.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-archive info FILE\n"
+        "       readerd-archive rate FILE --where COLUMN=VALUE [--by COLUMN]\n"
+        "\n"
+        "  info               list the segments and, per column, its kind, documents and bytes\n"
+        "  rate               count the documents where COLUMN equals VALUE out of those that have\n"
+        "                     COLUMN at all, per value of the --by column\n"
+        "\n"
+        "Columns are data type names (CD_SCBAC_STATUS), or for codeline data a field\n"
+        "(CD_CODELINE_DATA.IssuingState, CD_CODELINE_DATA.CodelineValidationResult), or\n"
+        "'document' and 'time'. For example the BAC failure rate per issuing state:\n"
+        "\n"
+        "  readerd-archive rate scans.rda --by CD_CODELINE_DATA.IssuingState --where CD_SCBAC_STATUS=-1\n");
+}
+
+const char *kindName(uint32_t aKind)
+{
+    switch (aKind)
+    {
+    case readerd::ACK_INT32:
+        return "int32";
+    case readerd::ACK_INT64:
+        return "int64";
+    case readerd::ACK_STRING:
+        return "string";
+    case readerd::ACK_BLOB:
+        return "blob";
+    case readerd::ACK_FLOAT32:
+        return "float";
+    default:
+        return "unknown";
+    }
+}
+
+std::string valueOf(const readerd::ArchiveColumn &aColumn, uint32_t aRow)
+{
+    if (!aColumn.present(aRow))
+        return std::string();
+    if (aColumn.kind() == readerd::ACK_STRING)
+        return std::string(aColumn.string(aRow));
+    if (aColumn.kind() == readerd::ACK_BLOB)
+        return std::to_string(aColumn.blobSize(aRow));
+    if (aColumn.kind() == readerd::ACK_FLOAT32)
+    {
+        char lValue[32];
+        std::snprintf(lValue, sizeof(lValue), "%g", aColumn.real(aRow));
+        return lValue;
+    }
+    return std::to_string(aColumn.integer(aRow));
+}
+
+int info(const readerd::ArchiveReader &aArchive)
+{
+    struct Totals
+    {
+        uint32_t puKind = 0;
+        uint64_t puDocuments = 0;
+        uint64_t puBytes = 0;       ///< Of the column itself.
+        uint64_t puBlobBytes = 0;   ///< Referenced in the AC_BLOBS chunks.
+    };
+    std::map<uint32_t, Totals> lColumns;
+    for (const readerd::ArchiveSegment &lSegment : aArchive.segments())
+    {
+        for (const readerd::ArchiveColumnEntry &lEntry : lSegment.columns())
+        {
+            Totals &lTotals = lColumns[lEntry.puId];
+            lTotals.puKind = lEntry.puKind;
+            lTotals.puBytes += lEntry.puLength;
+            const readerd::ArchiveColumn lColumn = lSegment.column(lEntry.puId);
+            for (uint32_t lRow = 0; lRow < lSegment.rows(); ++lRow)
+            {
+                if (!lColumn.present(lRow))
+                    continue;
+                ++lTotals.puDocuments;
+                lTotals.puBlobBytes += lColumn.blobSize(lRow);
+            }
+        }
+    }
+
+    std::printf("segments=%zu documents=%llu columns=%zu\n", aArchive.segments().size(),
+                static_cast<unsigned long long>(aArchive.documents()), lColumns.size());
+    for (const auto &[lId, lTotals] : lColumns)
+    {
+        std::printf("%-44s %-6s documents=%llu bytes=%llu", readerd::archiveColumnName(lId).c_str(),
+                    kindName(lTotals.puKind), static_cast<unsigned long long>(lTotals.puDocuments),
+                    static_cast<unsigned long long>(lTotals.puBytes));
+        if (lTotals.puKind == readerd::ACK_BLOB)
+            std::printf(" blob_bytes=%llu", static_cast<unsigned long long>(lTotals.puBlobBytes));
+        std::printf("\n");
+    }
+    return 0;
+}
+
+int rate(const readerd::ArchiveReader &aArchive, uint32_t aBy, bool aGrouped, uint32_t aWhere,
+         const std::string &aValue)
+{
+    struct Group
+    {
+        uint64_t puDocuments = 0;
+        uint64_t puMatches = 0;
+    };
+    std::map<std::string, Group> lGroups;
+    const long long lInteger = std::strtoll(aValue.c_str(), nullptr, 0);
+    const float lReal = std::strtof(aValue.c_str(), nullptr);
+
+    const auto lStart = std::chrono::steady_clock::now();
+    uint64_t lScanned = 0;
+    for (const readerd::ArchiveSegment &lSegment : aArchive.segments())
+    {
+        lScanned += lSegment.rows();
+        const readerd::ArchiveColumn lWhere = lSegment.column(aWhere);
+        if (!lWhere.valid())
+            continue;
+        const readerd::ArchiveColumn lBy = aGrouped ? lSegment.column(aBy) : readerd::ArchiveColumn();
+        const bool lIsString = lWhere.kind() == readerd::ACK_STRING;
+        for (uint32_t lRow = 0; lRow < lSegment.rows(); ++lRow)
+        {
+            if (!lWhere.present(lRow))
+                continue;
+            Group &lGroup = lGroups[aGrouped ? valueOf(lBy, lRow) : std::string("all")];
+            ++lGroup.puDocuments;
+            if (lIsString ? lWhere.string(lRow) == aValue
+                          : lWhere.kind() == readerd::ACK_FLOAT32 ? lWhere.real(lRow) == lReal
+                                                                  : lWhere.integer(lRow) == lInteger)
+                ++lGroup.puMatches;
+        }
+    }
+    const double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+
+    std::vector<std::pair<std::string, Group>> lSorted(lGroups.begin(), lGroups.end());
+    std::stable_sort(lSorted.begin(), lSorted.end(),
+        [](const auto &aLeft, const auto &aRight) { return aLeft.second.puDocuments > aRight.second.puDocuments; });
+    for (const auto &[lKey, lGroup] : lSorted)
+    {
+        std::printf("%-20s documents=%llu matches=%llu rate=%.4f\n", lKey.empty() ? "(none)" : lKey.c_str(),
+                    static_cast<unsigned long long>(lGroup.puDocuments),
+                    static_cast<unsigned long long>(lGroup.puMatches),
+                    static_cast<double>(lGroup.puMatches) / static_cast<double>(lGroup.puDocuments));
+    }
+    std::printf("scanned=%llu groups=%zu elapsed=%.3fs\n", static_cast<unsigned long long>(lScanned),
+                lGroups.size(), lSeconds);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 3)
+    {
+        printUsage();
+        return argc == 2 && std::string(argv[1]) == "--help" ? 0 : 2;
+    }
+    const std::string lCommand = argv[1];
+    const std::string lPath = argv[2];
+    std::string lBy;
+    std::string lWhere;
+
+    for (int i = 3; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--by" && lHasValue)
+            lBy = argv[++i];
+        else if (lArg == "--where" && lHasValue)
+            lWhere = argv[++i];
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+    if (lCommand != "info" && lCommand != "rate")
+    {
+        printUsage();
+        return 2;
+    }
+
+    uint32_t lByColumn = 0;
+    uint32_t lWhereColumn = 0;
+    std::string lValue;
+    if (lCommand == "rate")
+    {
+        const size_t lEquals = lWhere.find('=');
+        if (lEquals == std::string::npos)
+        {
+            printUsage();
+            return 2;
+        }
+        lValue = lWhere.substr(lEquals + 1);
+        lWhere.resize(lEquals);
+        for (const std::string *lName : {&lWhere, &lBy})
+        {
+            if (!lName->empty()
+                && !readerd::archiveColumnFromName(*lName, lName == &lWhere ? &lWhereColumn : &lByColumn))
+            {
+                std::fprintf(stderr, "readerd-archive: unknown column %s\n", lName->c_str());
+                return 2;
+            }
+        }
+    }
+
+    std::string lError;
+    readerd::ArchiveReader lArchive;
+    if (lArchive.open(lPath, &lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-archive: %s\n", lError.c_str());
+        return 1;
+    }
+    if (lCommand == "info")
+        return info(lArchive);
+    return rate(lArchive, lByColumn, !lBy.empty(), lWhereColumn, lValue);
+}
@@ -0,0 +1,554 @@
+// Latency and throughput benchmark for the high-level read loop: Blocking mode
+// (MMMReader_ReadDocument + MMMReader_GetData) and Non-Blocking mode (the callback path
+// through ReaderDaemon), reported as HDR histogram percentiles. Also times the greyscale and
+// IR channel kernels on the backend's full-page frames.
+
+#include "readerd/BulkFetch.h"
+#include "readerd/Histogram.h"
+#include "readerd/ImageConvert.h"
+#include "readerd/ReaderDaemon.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+uint64_t nanosecondsBetween(Clock::time_point aStart, Clock::time_point aEnd)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(aEnd - aStart).count());
+}
+
+struct BenchResult
+{
+    std::string puMode;
+    std::string puFetch;
+    uint64_t puDocuments = 0;
+    uint64_t puErrors = 0;
+    double puElapsedSeconds = 0.0;
+
+    /// Whole document, then the phases that make it up, keyed by name.
+    std::map<std::string, readerd::Histogram> puStages;
+    std::map<MMMReaderDataType, readerd::Histogram> puDataTypes;
+
+    readerd::Histogram &stage(const std::string &aName) { return puStages.try_emplace(aName).first->second; }
+
+    readerd::Histogram &dataType(MMMReaderDataType aDataType)
+    {
+        return puDataTypes.try_emplace(aDataType, 60ull * 1000 * 1000 * 1000).first->second;
+    }
+
+    double documentsPerHour() const
+    {
+        return puElapsedSeconds > 0.0 ? puDocuments * 3600.0 / puElapsedSeconds : 0.0;
+    }
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-bench [--backend SPEC] [--mode blocking|callback|both|images] [--fetch bulk|probe]\n"
+        "                     [--documents N] [--warmup N] [--threads N] [--handler-us N] [--async]\n"
+        "                     [--json FILE]\n"
+        "\n"
+        "  --backend SPEC     reader backend (default: sim)\n"
+        "  --mode MODE        read loop to measure, or the image kernels (default: both)\n"
+        "  --fetch HOW        Blocking mode: one BulkFetcher pass, or a size probe and a fetch\n"
+        "                     per item as the Java sample does (default: bulk)\n"
+        "  --documents N      measured documents per mode, or frames per kernel (default: 500)\n"
+        "  --warmup N         documents read before measuring (default: 20)\n"
+        "  --threads N        images: threads the tiled kernels use (default: all cores)\n"
+        "  --handler-us N     callback: add an application handler that takes N us per item\n"
+        "  --async            callback: run that handler on the EventBus instead of the callback thread\n"
+        "  --json FILE        write the results as JSON\n");
+}
+
+// Blocking mode: document latency runs from MMMReader_ReadDocument() to the last item
+// fetched; per data type is the time spent in MMMReader_GetData() for it (probe fetch only).
+bool runBlocking(const std::string &aBackendSpec, bool aBulk, uint64_t aDocuments, uint64_t aWarmup,
+                 BenchResult *aResult)
+{
+    std::string lError;
+    std::unique_ptr<readerd::ReaderBackend> lBackend = readerd::createBackend(aBackendSpec, &lError);
+    if (!lBackend)
+    {
+        std::fprintf(stderr, "readerd-bench: %s\n", lError.c_str());
+        return false;
+    }
+    MMMReaderErrorCode lResult = lBackend->initialise(nullptr, nullptr, nullptr, nullptr, nullptr);
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-bench: MMMReader_Initialise failed: %s\n", readerd::errorCodeName(lResult).c_str());
+        return false;
+    }
+
+    aResult->puMode = "blocking";
+    aResult->puFetch = aBulk ? "bulk" : "probe";
+    readerd::BulkFetcher lFetcher(*lBackend);
+    readerd::BulkResult lBulk;
+    std::vector<uint8_t> lBuffer;
+    Clock::time_point lMeasureStart = Clock::now();
+
+    for (uint64_t lRead = 0; lRead < aWarmup + aDocuments;)
+    {
+        lResult = lBackend->waitForDocumentOnWindow(1000);
+        if (lResult == ERROR_TIMED_OUT)
+            continue;
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-bench: %s\n", readerd::errorCodeName(lResult).c_str());
+            return false;
+        }
+        const bool lMeasured = lRead >= aWarmup;
+        if (lRead == aWarmup)
+            lMeasureStart = Clock::now();
+        ++lRead;
+
+        const Clock::time_point lStart = Clock::now();
+        lResult = lBackend->readDocument();
+        const Clock::time_point lReadDone = Clock::now();
+
+        if (lResult == NO_ERROR_OCCURRED && aBulk)
+            lResult = lFetcher.fetch(readerd::BulkFetcher::defaultDataTypes(), &lBulk);
+        for (MMMReaderDataType lDataType : readerd::BulkFetcher::defaultDataTypes())
+        {
+            if (aBulk || lResult != NO_ERROR_OCCURRED)
+                break;
+            int lCount = 0;
+            lResult = lBackend->getDataCount(lDataType, &lCount);
+            for (int lIndex = 0; lIndex < lCount && lResult == NO_ERROR_OCCURRED; ++lIndex)
+            {
+                const Clock::time_point lItemStart = Clock::now();
+                int lLen = 0;
+                lResult = lBackend->getData(lDataType, nullptr, &lLen, lIndex);
+                if (lResult == NO_ERROR_OCCURRED)
+                {
+                    lBuffer.resize(static_cast<size_t>(lLen));
+                    lResult = lBackend->getData(lDataType, lBuffer.data(), &lLen, lIndex);
+                }
+                if (lMeasured)
+                    aResult->dataType(lDataType).record(nanosecondsBetween(lItemStart, Clock::now()));
+            }
+        }
+        const Clock::time_point lDone = Clock::now();
+        lBackend->clearData();
+
+        if (!lMeasured)
+            continue;
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            ++aResult->puErrors;
+            continue;
+        }
+        ++aResult->puDocuments;
+        aResult->stage("document").record(nanosecondsBetween(lStart, lDone));
+        aResult->stage("read").record(nanosecondsBetween(lStart, lReadDone));
+        aResult->stage("fetch").record(nanosecondsBetween(lReadDone, lDone));
+    }
+
+    aResult->puElapsedSeconds = std::chrono::duration<double>(Clock::now() - lMeasureStart).count();
+    lBackend->shutdown();
+    return true;
+}
+
+// Non-Blocking mode: document latency runs from DOC_ON_WINDOW to END_OF_DOCUMENT_DATA as
+// seen by a consumer of ReaderDaemon; per data type is the arrival time after
+// START_OF_DOCUMENT_DATA.
+class CallbackRecorder : public readerd::DataConsumer
+{
+public:
+    CallbackRecorder(BenchResult *aResult, uint64_t aWarmup)
+        : prResult(aResult)
+        , prWarmup(aWarmup)
+    {
+    }
+
+    void onData(const readerd::DataItem &aItem) override
+    {
+        if (measured())
+            prResult->dataType(aItem.type()).record(nanosecondsBetween(prStart, Clock::now()));
+    }
+
+    void onEvent(MMMReaderEventCode aEventCode, uint32_t /*aDocument*/) override
+    {
+        const Clock::time_point lNow = Clock::now();
+        switch (aEventCode)
+        {
+        case DOC_ON_WINDOW:
+            prOnWindow = lNow;
+            prSawOnWindow = true;
+            break;
+        case START_OF_DOCUMENT_DATA:
+            prStart = lNow;
+            if (!prSawOnWindow)
+                prOnWindow = lNow;
+            if (prCompleted == prWarmup)
+                prMeasureStart = prOnWindow;
+            break;
+        case END_OF_DOCUMENT_DATA:
+            if (measured())
+            {
+                ++prResult->puDocuments;
+                prResult->stage("document").record(nanosecondsBetween(prOnWindow, lNow));
+                prResult->stage("detect").record(nanosecondsBetween(prOnWindow, prStart));
+                prResult->stage("data").record(nanosecondsBetween(prStart, lNow));
+                prMeasureEnd = lNow;
+            }
+            ++prCompleted;
+            prSawOnWindow = false;
+            break;
+        default:
+            break;
+        }
+    }
+
+    void onError(MMMReaderErrorCode /*aErrorCode*/, const char * /*aErrorMsg*/, uint32_t /*aDocument*/) override
+    {
+        if (measured())
+            ++prResult->puErrors;
+    }
+
+    double measuredSeconds() const { return std::chrono::duration<double>(prMeasureEnd - prMeasureStart).count(); }
+
+private:
+    bool measured() const { return prCompleted >= prWarmup; }
+
+    BenchResult *prResult;
+    const uint64_t prWarmup;
+    uint64_t prCompleted = 0;
+    bool prSawOnWindow = false;
+    Clock::time_point prOnWindow;
+    Clock::time_point prStart;
+    Clock::time_point prMeasureStart;
+    Clock::time_point prMeasureEnd;
+};
+
+// Stands in for the work the Java sample does inside its callbacks: list updates and a
+// blocking socket write per item.
+class SlowHandler : public readerd::DataConsumer
+{
+public:
+    explicit SlowHandler(std::chrono::microseconds aPerItem)
+        : prPerItem(aPerItem)
+    {
+    }
+
+    void onData(const readerd::DataItem & /*aItem*/) override { std::this_thread::sleep_for(prPerItem); }
+
+private:
+    const std::chrono::microseconds prPerItem;
+};
+
+bool runCallback(const std::string &aBackendSpec, uint64_t aDocuments, uint64_t aWarmup, unsigned aHandlerUs,
+                 bool aAsync, BenchResult *aResult)
+{
+    std::string lError;
+    std::unique_ptr<readerd::ReaderBackend> lBackend = readerd::createBackend(aBackendSpec, &lError);
+    if (!lBackend)
+    {
+        std::fprintf(stderr, "readerd-bench: %s\n", lError.c_str());
+        return false;
+    }
+
+    aResult->puMode = "callback";
+    aResult->puFetch = aHandlerUs == 0 ? "callback" : aAsync ? "async handler" : "sync handler";
+    readerd::DaemonOptions lOptions;
+    lOptions.puSocketPath = "/tmp/readerd-bench-" + std::to_string(::getpid()) + ".sock";
+    CallbackRecorder lRecorder(aResult, aWarmup);
+    SlowHandler lHandler{std::chrono::microseconds(aHandlerUs)};
+    readerd::ReaderDaemon lDaemon(std::move(lBackend), lOptions);
+    lDaemon.addConsumer(&lRecorder);
+    if (aHandlerUs != 0 && aAsync)
+        lDaemon.addAsyncConsumer(&lHandler);
+    else if (aHandlerUs != 0)
+        lDaemon.addConsumer(&lHandler);
+    if (lDaemon.start(&lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-bench: %s\n", lError.c_str());
+        return false;
+    }
+    while (!lDaemon.waitForDocuments(aWarmup + aDocuments, std::chrono::seconds(1)))
+    {
+    }
+    lDaemon.stop();
+    aResult->puElapsedSeconds = lRecorder.measuredSeconds();
+    if (lDaemon.stats().puBusDropped != 0)
+        std::fprintf(stderr, "readerd-bench: the handler fell behind, %llu messages dropped\n",
+            static_cast<unsigned long long>(lDaemon.stats().puBusDropped));
+    return true;
+}
+
+// Stand-in for MMMReader_ConvertToGreyscale, which takes a Gdiplus::Bitmap and so only exists
+// in Windows builds of the low-level API: the per-pixel floating point loop it performs.
+void referenceGreyscale(const readerd::BitmapView &aBitmap, uint8_t *aDst)
+{
+    const int lBytesPerPixel = aBitmap.puBitsPerPixel / 8;
+    for (int y = 0; y < aBitmap.puHeight; ++y)
+    {
+        for (int x = 0; x < aBitmap.puWidth; ++x)
+        {
+            const uint8_t *lPixel = aBitmap.row(y) + x * lBytesPerPixel;
+            aDst[static_cast<size_t>(y) * aBitmap.puWidth + x] =
+                static_cast<uint8_t>(0.299f * lPixel[2] + 0.587f * lPixel[1] + 0.114f * lPixel[0] + 0.5f);
+        }
+    }
+}
+
+// Fetches CD_IMAGEVIS and CD_IMAGEIR of one document from the backend.
+bool captureFrames(const std::string &aBackendSpec, std::vector<uint8_t> *aVisible, std::vector<uint8_t> *aInfrared)
+{
+    std::string lError;
+    std::unique_ptr<readerd::ReaderBackend> lBackend = readerd::createBackend(aBackendSpec, &lError);
+    if (!lBackend)
+    {
+        std::fprintf(stderr, "readerd-bench: %s\n", lError.c_str());
+        return false;
+    }
+    MMMReaderErrorCode lResult = lBackend->initialise(nullptr, nullptr, nullptr, nullptr, nullptr);
+    while (lResult == NO_ERROR_OCCURRED || lResult == ERROR_TIMED_OUT)
+    {
+        lResult = lBackend->waitForDocumentOnWindow(1000);
+        if (lResult == NO_ERROR_OCCURRED)
+            break;
+    }
+    if (lResult == NO_ERROR_OCCURRED)
+        lResult = lBackend->readDocument();
+
+    const auto lFetch = [&lBackend, &lResult](MMMReaderDataType aDataType, std::vector<uint8_t> *aOut) {
+        int lLen = 0;
+        if (lResult == NO_ERROR_OCCURRED)
+            lResult = lBackend->getData(aDataType, nullptr, &lLen, 0);
+        if (lResult != NO_ERROR_OCCURRED)
+            return;
+        aOut->resize(static_cast<size_t>(lLen));
+        lResult = lBackend->getData(aDataType, aOut->data(), &lLen, 0);
+    };
+    lFetch(CD_IMAGEVIS, aVisible);
+    lFetch(CD_IMAGEIR, aInfrared);
+    lBackend->clearData();
+    lBackend->shutdown();
+
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-bench: capturing frames: %s\n", readerd::errorCodeName(lResult).c_str());
+        return false;
+    }
+    return true;
+}
+
+// Image kernels: time per full-page frame for the reference loop and for greyscale (visible
+// image) and channel extraction (IR image) at each SIMD level, single-threaded and tiled.
+bool runImages(const std::string &aBackendSpec, uint64_t aFrames, uint64_t aWarmup, unsigned aThreads,
+               BenchResult *aResult)
+{
+    std::vector<uint8_t> lVisibleBytes;
+    std::vector<uint8_t> lInfraredBytes;
+    if (!captureFrames(aBackendSpec, &lVisibleBytes, &lInfraredBytes))
+        return false;
+
+    readerd::BitmapView lVisible;
+    readerd::BitmapView lInfrared;
+    if (!readerd::parseBitmap(lVisibleBytes, &lVisible) || !readerd::parseBitmap(lInfraredBytes, &lInfrared))
+    {
+        std::fprintf(stderr, "readerd-bench: images are not uncompressed 24/32bpp BMPs\n");
+        return false;
+    }
+
+    readerd::TileExecutor lTiles(aThreads);
+    aResult->puMode = "images";
+    aResult->puFetch = std::to_string(lVisible.puWidth) + "x" + std::to_string(lVisible.puHeight) + "@"
+        + std::to_string(lTiles.threads()) + "t";
+    std::vector<uint8_t> lOut(static_cast<size_t>(lVisible.puWidth) * lVisible.puHeight);
+    std::vector<uint8_t> lIrOut(static_cast<size_t>(lInfrared.puWidth) * lInfrared.puHeight);
+
+    const Clock::time_point lRunStart = Clock::now();
+    const auto lMeasure = [&](const std::string &aName, const auto &aKernel) {
+        readerd::Histogram &lHistogram = aResult->stage(aName);
+        for (uint64_t i = 0; i < aWarmup + aFrames; ++i)
+        {
+            const Clock::time_point lStart = Clock::now();
+            aKernel();
+            if (i >= aWarmup)
+                lHistogram.record(nanosecondsBetween(lStart, Clock::now()));
+        }
+    };
+
+    lMeasure("grey reference", [&] { referenceGreyscale(lVisible, lOut.data()); });
+    lMeasure("ir reference", [&] { referenceGreyscale(lInfrared, lIrOut.data()); });
+
+    const readerd::SimdLevel lBest = readerd::simdLevel();
+    for (int lLevel = readerd::SIMD_SCALAR; lLevel <= lBest; ++lLevel)
+    {
+        readerd::setSimdLevel(static_cast<readerd::SimdLevel>(lLevel));
+        const std::string lName = readerd::simdLevelName(static_cast<readerd::SimdLevel>(lLevel));
+        lMeasure("grey " + lName, [&] { readerd::bitmapToGrey(lVisible, lOut.data()); });
+        lMeasure("grey " + lName + " tiled", [&] { readerd::bitmapToGrey(lVisible, lOut.data(), &lTiles); });
+        lMeasure("ir " + lName, [&] { readerd::bitmapExtractChannel(lInfrared, 1, lIrOut.data()); });
+        lMeasure("ir " + lName + " tiled", [&] { readerd::bitmapExtractChannel(lInfrared, 1, lIrOut.data(), &lTiles); });
+    }
+    readerd::setSimdLevel(lBest);
+
+    aResult->puDocuments = aFrames;
+    aResult->puElapsedSeconds = std::chrono::duration<double>(Clock::now() - lRunStart).count();
+    return true;
+}
+
+double micros(uint64_t aNanoseconds)
+{
+    return static_cast<double>(aNanoseconds) / 1000.0;
+}
+
+void printHistogram(const char *aName, const readerd::Histogram &aHistogram)
+{
+    std::printf("  %-28s %8llu %10.1f %10.1f %10.1f %10.1f %10.1f\n", aName,
+        static_cast<unsigned long long>(aHistogram.count()),
+        micros(aHistogram.valueAtPercentile(50.0)), micros(aHistogram.valueAtPercentile(95.0)),
+        micros(aHistogram.valueAtPercentile(99.0)), micros(aHistogram.max()), aHistogram.mean() / 1000.0);
+}
+
+void printResult(const BenchResult &aResult)
+{
+    std::printf("%s (%s): documents=%llu errors=%llu elapsed=%.3fs docs/hour=%.0f\n",
+        aResult.puMode.c_str(), aResult.puFetch.c_str(),
+        static_cast<unsigned long long>(aResult.puDocuments), static_cast<unsigned long long>(aResult.puErrors),
+        aResult.puElapsedSeconds, aResult.documentsPerHour());
+    std::printf("  %-28s %8s %10s %10s %10s %10s %10s\n", "us", "count", "p50", "p95", "p99", "max", "mean");
+    for (const auto &lStage : aResult.puStages)
+        printHistogram(lStage.first.c_str(), lStage.second);
+    for (const auto &lDataType : aResult.puDataTypes)
+        printHistogram(readerd::dataTypeName(lDataType.first).c_str(), lDataType.second);
+}
+
+void writeHistogramJson(std::FILE *aFile, const std::string &aName, const readerd::Histogram &aHistogram)
+{
+    std::fprintf(aFile,
+        "\"%s\":{\"count\":%llu,\"p50_us\":%.3f,\"p95_us\":%.3f,\"p99_us\":%.3f,\"max_us\":%.3f,\"mean_us\":%.3f}",
+        aName.c_str(), static_cast<unsigned long long>(aHistogram.count()),
+        micros(aHistogram.valueAtPercentile(50.0)), micros(aHistogram.valueAtPercentile(95.0)),
+        micros(aHistogram.valueAtPercentile(99.0)), micros(aHistogram.max()), aHistogram.mean() / 1000.0);
+}
+
+void writeJson(std::FILE *aFile, const std::string &aBackendSpec, const std::vector<BenchResult> &aResults)
+{
+    std::fprintf(aFile, "{\"backend\":\"%s\",\"results\":[", aBackendSpec.c_str());
+    for (size_t i = 0; i < aResults.size(); ++i)
+    {
+        const BenchResult &lResult = aResults[i];
+        std::fprintf(aFile,
+            "%s\n{\"mode\":\"%s\",\"fetch\":\"%s\",\"documents\":%llu,\"errors\":%llu,\"elapsed_s\":%.6f,"
+            "\"docs_per_hour\":%.1f,\"stages\":{",
+            i ? "," : "", lResult.puMode.c_str(), lResult.puFetch.c_str(),
+            static_cast<unsigned long long>(lResult.puDocuments), static_cast<unsigned long long>(lResult.puErrors),
+            lResult.puElapsedSeconds, lResult.documentsPerHour());
+        bool lFirst = true;
+        for (const auto &lStage : lResult.puStages)
+        {
+            std::fputs(lFirst ? "" : ",", aFile);
+            writeHistogramJson(aFile, lStage.first, lStage.second);
+            lFirst = false;
+        }
+        std::fputs("},\"data_types\":{", aFile);
+        lFirst = true;
+        for (const auto &lDataType : lResult.puDataTypes)
+        {
+            std::fputs(lFirst ? "" : ",", aFile);
+            writeHistogramJson(aFile, readerd::dataTypeName(lDataType.first), lDataType.second);
+            lFirst = false;
+        }
+        std::fputs("}}", aFile);
+    }
+    std::fputs("\n]}\n", aFile);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string lBackendSpec = "sim";
+    std::string lMode = "both";
+    std::string lFetch = "bulk";
+    std::string lJsonPath;
+    uint64_t lDocuments = 500;
+    uint64_t lWarmup = 20;
+    unsigned lThreads = 0;
+    unsigned lHandlerUs = 0;
+    bool lAsync = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--backend" && lHasValue)
+            lBackendSpec = argv[++i];
+        else if (lArg == "--mode" && lHasValue)
+            lMode = argv[++i];
+        else if (lArg == "--fetch" && lHasValue)
+            lFetch = argv[++i];
+        else if (lArg == "--documents" && lHasValue)
+            lDocuments = std::strtoull(argv[++i], nullptr, 10);
+        else if (lArg == "--warmup" && lHasValue)
+            lWarmup = std::strtoull(argv[++i], nullptr, 10);
+        else if (lArg == "--threads" && lHasValue)
+            lThreads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (lArg == "--handler-us" && lHasValue)
+            lHandlerUs = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (lArg == "--async")
+            lAsync = true;
+        else if (lArg == "--json" && lHasValue)
+            lJsonPath = argv[++i];
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+    if ((lMode != "blocking" && lMode != "callback" && lMode != "both" && lMode != "images")
+        || (lFetch != "bulk" && lFetch != "probe") || lDocuments == 0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::vector<BenchResult> lResults;
+    if (lMode == "images")
+    {
+        lResults.emplace_back();
+        if (!runImages(lBackendSpec, lDocuments, lWarmup, lThreads, &lResults.back()))
+            return 1;
+        printResult(lResults.back());
+    }
+    if (lMode == "blocking" || lMode == "both")
+    {
+        lResults.emplace_back();
+        if (!runBlocking(lBackendSpec, lFetch == "bulk", lDocuments, lWarmup, &lResults.back()))
+            return 1;
+        printResult(lResults.back());
+    }
+    if (lMode == "callback" || lMode == "both")
+    {
+        lResults.emplace_back();
+        if (!runCallback(lBackendSpec, lDocuments, lWarmup, lHandlerUs, lAsync, &lResults.back()))
+            return 1;
+        printResult(lResults.back());
+    }
+
+    if (!lJsonPath.empty())
+    {
+        std::FILE *lFile = std::fopen(lJsonPath.c_str(), "w");
+        if (lFile == nullptr)
+        {
+            std::fprintf(stderr, "readerd-bench: cannot write %s\n", lJsonPath.c_str());
+            return 1;
+        }
+        writeJson(lFile, lBackendSpec, lResults);
+        std::fclose(lFile);
+    }
+    return 0;
+}
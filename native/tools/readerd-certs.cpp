@@ -0,0 +1,168 @@
+// Builds a certificate store from a folder of certificates and master lists, and times
+// lookups in it against scanning the folder as the SDK's file store does.
+
+#include "readerd/CertificateStore.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-certs --build DIR --store FILE [--recursive] [--extensions LIST]\n"
+        "       readerd-certs --store FILE [--lookups N] [--scan DIR]\n"
+        "\n"
+        "  --build DIR        index every certificate in DIR into FILE\n"
+        "  --store FILE       the certificate store\n"
+        "  --recursive        include the subfolders of DIR, as puCertsIncludeSubDirs\n"
+        "  --extensions LIST  file extensions to read, as puCertFileExtensions (default: cer;crt;der;pem;ml)\n"
+        "  --lookups N        look up N stored certificates at random, by key identifier and by issuer\n"
+        "                     and serial number (default: 100000)\n"
+        "  --scan DIR         also time finding 100 of them by reading the DER files of DIR one by one\n");
+}
+
+double elapsedUs(std::chrono::steady_clock::time_point aStart)
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - aStart).count();
+}
+
+std::vector<uint8_t> issuerSerial(const readerd::CertificateFields &aFields)
+{
+    std::vector<uint8_t> lKey(aFields.puIssuer.begin(), aFields.puIssuer.end());
+    lKey.insert(lKey.end(), aFields.puSerial.begin(), aFields.puSerial.end());
+    return lKey;
+}
+
+// The SDK's way: read and parse file after file until one matches.
+bool scanFor(const std::string &aDirectory, const readerd::CertificateFields &aWanted)
+{
+    const std::vector<uint8_t> lWanted = issuerSerial(aWanted);
+    for (const auto &lEntry : std::filesystem::recursive_directory_iterator(aDirectory))
+    {
+        if (!lEntry.is_regular_file())
+            continue;
+        std::ifstream lIn(lEntry.path(), std::ios::binary);
+        const std::vector<uint8_t> lFile((std::istreambuf_iterator<char>(lIn)), std::istreambuf_iterator<char>());
+        readerd::CertificateFields lFields;
+        if (readerd::parseCertificate(lFile, &lFields) && issuerSerial(lFields) == lWanted)
+            return true;
+    }
+    return false;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    readerd::CertificateSource lSource;
+    std::string lStorePath;
+    std::string lScanDirectory;
+    unsigned long lLookups = 100000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--build" && lHasValue)
+            lSource.puDirectory = argv[++i];
+        else if (lArg == "--store" && lHasValue)
+            lStorePath = argv[++i];
+        else if (lArg == "--recursive")
+            lSource.puIncludeSubDirs = true;
+        else if (lArg == "--extensions" && lHasValue)
+            lSource.puExtensions = argv[++i];
+        else if (lArg == "--lookups" && lHasValue)
+            lLookups = std::strtoul(argv[++i], nullptr, 10);
+        else if (lArg == "--scan" && lHasValue)
+            lScanDirectory = argv[++i];
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+    if (lStorePath.empty())
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::string lError;
+    if (!lSource.puDirectory.empty())
+    {
+        readerd::CertificateBuildStats lStats;
+        const auto lStart = std::chrono::steady_clock::now();
+        if (readerd::CertificateStore::build(lSource, lStorePath, &lStats, &lError) != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-certs: %s\n", lError.c_str());
+            return 1;
+        }
+        std::printf("built %s: %llu files, %llu certificates, %llu duplicates, %llu files skipped, %.1f ms\n",
+                    lStorePath.c_str(), static_cast<unsigned long long>(lStats.puFiles),
+                    static_cast<unsigned long long>(lStats.puCertificates),
+                    static_cast<unsigned long long>(lStats.puDuplicates),
+                    static_cast<unsigned long long>(lStats.puSkipped), elapsedUs(lStart) / 1000.0);
+        return 0;
+    }
+
+    readerd::CertificateStore lStore;
+    const auto lOpenStart = std::chrono::steady_clock::now();
+    if (lStore.open(lStorePath, &lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-certs: %s\n", lError.c_str());
+        return 1;
+    }
+    std::printf("opened %s: %zu certificates in %.1f us\n", lStorePath.c_str(), lStore.size(),
+                elapsedUs(lOpenStart));
+    if (lStore.size() == 0)
+        return 0;
+
+    // The keys are made up front, so that only the lookups are timed.
+    std::mt19937 lRandom(1);
+    std::vector<readerd::CertificateFields> lWanted(std::min<unsigned long>(lLookups, 4096));
+    for (readerd::CertificateFields &lFields : lWanted)
+        readerd::parseCertificate(lStore.certificate(lRandom() % lStore.size()), &lFields);
+    std::vector<std::vector<uint8_t>> lIssuerSerials;
+    for (const readerd::CertificateFields &lFields : lWanted)
+        lIssuerSerials.push_back(issuerSerial(lFields));
+
+    unsigned long lMissed = 0;
+    auto lStart = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < lLookups; ++i)
+    {
+        const readerd::CertificateFields &lFields = lWanted[i % lWanted.size()];
+        if (!lFields.puKeyId.empty() && lStore.find(readerd::CK_SUBJECT_KEY_ID, lFields.puKeyId).empty())
+            ++lMissed;
+    }
+    const double lKeyIdUs = elapsedUs(lStart);
+    lStart = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < lLookups; ++i)
+    {
+        if (lStore.find(readerd::CK_ISSUER_SERIAL, lIssuerSerials[i % lIssuerSerials.size()]).empty())
+            ++lMissed;
+    }
+    const double lIssuerUs = elapsedUs(lStart);
+    std::printf("%lu lookups: by key identifier %.3f us, by issuer and serial %.3f us each, %lu missed\n",
+                lLookups, lKeyIdUs / lLookups, lIssuerUs / lLookups, lMissed);
+
+    if (!lScanDirectory.empty())
+    {
+        const size_t lScans = std::min<size_t>(100, lWanted.size());
+        size_t lFound = 0;
+        lStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lScans; ++i)
+            lFound += scanFor(lScanDirectory, lWanted[i]);
+        std::printf("%zu folder scans: %.3f ms each, %zu found\n", lScans, elapsedUs(lStart) / 1000.0 / lScans, lFound);
+    }
+    return lMissed > 0 ? 1 : 0;
+}
@@ -0,0 +1,172 @@
+// Reference consumer of the document-framed result stream: connects to a readerd started
+// with --framing documents, or attaches to the shared memory ring of one started with --shm,
+// reads one document at a time and reports what arrived.
+
+#include "readerd/CodelineCodec.h"
+#include "readerd/ReaderBackend.h"
+#include "readerd/ResultClient.h"
+#include "readerd/SharedRing.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-client [--socket ADDRESS | --shm NAME] [--documents N] [--verbose]\n"
+        "\n"
+        "  --socket ADDRESS   AF_UNIX socket path or tcp:HOST:PORT of the daemon (default: /tmp/readerd.sock)\n"
+        "  --shm NAME         read from the daemon's shared memory ring instead\n"
+        "  --documents N      exit after N complete documents (default: until the daemon exits)\n"
+        "  --verbose          print every frame and its records\n");
+}
+
+void printRecords(const std::vector<readerd::FrameRecord> &aRecords)
+{
+    for (const readerd::FrameRecord &lRecord : aRecords)
+    {
+        const readerd::RecordHeader &lHeader = lRecord.puHeader;
+        const std::string lCode = lHeader.puKind == readerd::RK_EVENT
+            ? readerd::eventCodeName(static_cast<MMMReaderEventCode>(lHeader.puCode))
+            : lHeader.puKind == readerd::RK_ERROR
+            ? readerd::errorCodeName(static_cast<MMMReaderErrorCode>(lHeader.puCode))
+            : lHeader.puKind == readerd::RK_SCANNER
+            ? "scanner " + std::string(reinterpret_cast<const char *>(lRecord.puPayload.data()), lRecord.puPayload.size())
+            : readerd::dataTypeName(static_cast<MMMReaderDataType>(lHeader.puCode));
+        std::printf("  %-32s %10u bytes\n", lCode.c_str(), lHeader.puLength);
+
+        readerd::CodelineView lCodeline;
+        if (lHeader.puKind == readerd::RK_CODELINE && lCodeline.parse(lRecord.puPayload))
+        {
+            const std::string_view lDocNumber = lCodeline.field(readerd::CF_DOC_NUMBER);
+            const std::string_view lSurname = lCodeline.field(readerd::CF_SURNAME);
+            std::printf("    %.*s %.*s\n", static_cast<int>(lDocNumber.size()), lDocNumber.data(),
+                static_cast<int>(lSurname.size()), lSurname.data());
+        }
+    }
+}
+
+void printSummary(unsigned long long aFrames, unsigned long long aDocuments, unsigned long long aRecords,
+                  unsigned long long aBytes, std::chrono::steady_clock::time_point aStart)
+{
+    const double lSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - aStart).count();
+    std::printf("frames=%llu documents=%llu records=%llu bytes=%llu elapsed=%.3fs MB/s=%.1f\n", aFrames,
+        aDocuments, aRecords, aBytes, lSeconds, lSeconds > 0.0 ? aBytes / lSeconds / 1e6 : 0.0);
+}
+
+// Every document committed to the ring is complete, so each one counts as a frame and a
+// document; the payloads are read in place from the mapping.
+int readSharedRing(const std::string &aName, unsigned long long aDocumentLimit, bool aVerbose)
+{
+    std::string lError;
+    readerd::SharedRingReader lReader;
+    if (lReader.open(aName, &lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-client: %s\n", lError.c_str());
+        return 1;
+    }
+
+    unsigned long long lDocuments = 0;
+    unsigned long long lRecords = 0;
+    unsigned long long lBytes = 0;
+    const auto lStart = std::chrono::steady_clock::now();
+
+    readerd::SharedDocument lDocument;
+    while (!aDocumentLimit || lDocuments < aDocumentLimit)
+    {
+        if (!lReader.next(&lDocument, std::chrono::milliseconds(500)))
+        {
+            if (lReader.closed())
+                break;
+            continue;
+        }
+        ++lDocuments;
+        lRecords += lDocument.puRecords.size();
+        unsigned long long lDocumentBytes = 0;
+        for (const readerd::FrameRecord &lRecord : lDocument.puRecords)
+            lDocumentBytes += sizeof(lRecord.puHeader) + lRecord.puPayload.size();
+        lBytes += lDocumentBytes;
+        if (aVerbose)
+        {
+            std::printf("document %u: %zu records, %llu bytes\n", lDocument.puDocument, lDocument.puRecords.size(),
+                lDocumentBytes);
+            printRecords(lDocument.puRecords);
+        }
+    }
+    printSummary(lDocuments, lDocuments, lRecords, lBytes, lStart);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string lAddress = "/tmp/readerd.sock";
+    std::string lSharedRing;
+    unsigned long long lDocumentLimit = 0;
+    bool lVerbose = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--socket" && lHasValue)
+            lAddress = argv[++i];
+        else if (lArg == "--shm" && lHasValue)
+            lSharedRing = argv[++i];
+        else if (lArg == "--documents" && lHasValue)
+            lDocumentLimit = std::strtoull(argv[++i], nullptr, 10);
+        else if (lArg == "--verbose")
+            lVerbose = true;
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    if (!lSharedRing.empty())
+        return readSharedRing(lSharedRing, lDocumentLimit, lVerbose);
+
+    std::string lError;
+    readerd::ResultClient lClient;
+    if (lClient.connect(lAddress, &lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-client: %s\n", lError.c_str());
+        return 1;
+    }
+
+    unsigned long long lFrames = 0;
+    unsigned long long lDocuments = 0;
+    unsigned long long lRecords = 0;
+    unsigned long long lBytes = 0;
+    const auto lStart = std::chrono::steady_clock::now();
+
+    readerd::Frame lFrame;
+    while (lClient.readFrame(&lFrame, &lError))
+    {
+        ++lFrames;
+        lDocuments += lFrame.isDocument() ? 1 : 0;
+        lRecords += lFrame.puRecords.size();
+        lBytes += sizeof(lFrame.puHeader) + lFrame.puHeader.puLength;
+
+        if (lVerbose)
+        {
+            std::printf("document %u: %s, %zu records, %llu bytes\n", lFrame.puHeader.puDocument,
+                lFrame.isDocument() ? "complete" : "single record", lFrame.puRecords.size(),
+                static_cast<unsigned long long>(lFrame.puHeader.puLength));
+            printRecords(lFrame.puRecords);
+        }
+        if (lDocumentLimit && lDocuments >= lDocumentLimit)
+            break;
+    }
+    if (!lError.empty())
+        std::fprintf(stderr, "readerd-client: %s\n", lError.c_str());
+
+    printSummary(lFrames, lDocuments, lRecords, lBytes, lStart);
+    return lError.empty() ? 0 : 1;
+}
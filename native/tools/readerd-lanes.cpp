@@ -0,0 +1,178 @@
+// Runs one readerd per connected reader, each pinned to its own CPUs, and streams the
+// documents of all of them on one socket.
+
+#include "readerd/LaneOrchestrator.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+namespace {
+
+volatile std::sig_atomic_t gStopRequested = 0;
+
+void onSignal(int)
+{
+    gStopRequested = 1;
+}
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-lanes [--backend SPEC] [--scanners LIST] [--socket ADDRESS]\n"
+        "                     [--framing records|documents] [--documents N] [--cpus LIST] [--no-pin]\n"
+        "                     [--worker PATH] [-- WORKER ARGUMENTS]\n"
+        "\n"
+        "  --backend SPEC     reader backend of every worker, as for readerd (default: sdk)\n"
+        "  --scanners LIST    comma-separated serial numbers to run a worker for\n"
+        "                     (default: every connected reader)\n"
+        "  --socket ADDRESS   AF_UNIX socket path or tcp:HOST:PORT the merged results are streamed on\n"
+        "                     (default: /tmp/readerd.sock)\n"
+        "  --framing HOW      send each record as it arrives, or each document as one frame\n"
+        "                     (default: records)\n"
+        "  --documents N      exit after N documents have been read in all (default: run until signalled)\n"
+        "  --cpus LIST        CPUs to split between the workers, e.g. 0-7 (default: all allowed)\n"
+        "  --no-pin           leave the workers unpinned\n"
+        "  --worker PATH      readerd executable (default: the one next to readerd-lanes)\n"
+        "\n"
+        "Arguments after -- are passed to every worker, e.g. -- --blocking --compact-codelines.\n"
+        "Each document is followed by an RK_SCANNER record naming the reader it came from.\n");
+}
+
+bool parseFraming(const std::string &aName, readerd::ServerFraming *aFraming)
+{
+    if (aName == "records")
+        *aFraming = readerd::SF_RECORDS;
+    else if (aName == "documents")
+        *aFraming = readerd::SF_DOCUMENTS;
+    else
+        return false;
+    return true;
+}
+
+std::vector<std::string> splitList(const std::string &aList)
+{
+    std::vector<std::string> lItems;
+    size_t lStart = 0;
+    while (lStart <= aList.size())
+    {
+        const size_t lEnd = std::min(aList.find(',', lStart), aList.size());
+        if (lEnd > lStart)
+            lItems.push_back(aList.substr(lStart, lEnd - lStart));
+        lStart = lEnd + 1;
+    }
+    return lItems;
+}
+
+std::string defaultWorker()
+{
+    std::error_code lError;
+    const std::filesystem::path lSelf = std::filesystem::read_symlink("/proc/self/exe", lError);
+    if (!lError)
+    {
+        const std::filesystem::path lSibling = lSelf.parent_path() / "readerd";
+        if (std::filesystem::exists(lSibling, lError))
+            return lSibling.string();
+    }
+    return "readerd";
+}
+
+void printStats(const std::vector<readerd::LaneStats> &aStats, double aSeconds)
+{
+    uint64_t lDocuments = 0;
+    for (const readerd::LaneStats &lLane : aStats)
+    {
+        std::string lCpus;
+        for (int lCpu : lLane.puCpus)
+        {
+            if (!lCpus.empty())
+                lCpus += ',';
+            lCpus += std::to_string(lCpu);
+        }
+        std::printf("%s: pid=%d cpus=%s documents=%llu records=%llu bytes=%llu",
+                    lLane.puScanner.c_str(), static_cast<int>(lLane.puPid), lCpus.empty() ? "any" : lCpus.c_str(),
+                    static_cast<unsigned long long>(lLane.puDocuments),
+                    static_cast<unsigned long long>(lLane.puRecords), static_cast<unsigned long long>(lLane.puBytes));
+        if (!lLane.puRunning && WIFEXITED(lLane.puExitStatus))
+            std::printf(" exit=%d", WEXITSTATUS(lLane.puExitStatus));
+        else if (!lLane.puRunning && WIFSIGNALED(lLane.puExitStatus))
+            std::printf(" signal=%d", WTERMSIG(lLane.puExitStatus));
+        std::printf("\n");
+        lDocuments += lLane.puDocuments;
+    }
+    std::printf("lanes=%zu documents=%llu elapsed=%.3fs docs/hour=%.0f\n", aStats.size(),
+                static_cast<unsigned long long>(lDocuments), aSeconds,
+                aSeconds > 0.0 ? static_cast<double>(lDocuments) * 3600.0 / aSeconds : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    readerd::LaneOptions lOptions;
+    lOptions.puWorkerPath = defaultWorker();
+    uint64_t lDocuments = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--backend" && lHasValue)
+            lOptions.puBackendSpec = argv[++i];
+        else if (lArg == "--scanners" && lHasValue)
+            lOptions.puScanners = splitList(argv[++i]);
+        else if (lArg == "--socket" && lHasValue)
+            lOptions.puSocketPath = argv[++i];
+        else if (lArg == "--framing" && lHasValue && parseFraming(argv[i + 1], &lOptions.puFraming))
+            ++i;
+        else if (lArg == "--documents" && lHasValue)
+            lDocuments = std::strtoull(argv[++i], nullptr, 10);
+        else if (lArg == "--cpus" && lHasValue && readerd::parseCpuList(argv[i + 1], &lOptions.puCpus))
+            ++i;
+        else if (lArg == "--no-pin")
+            lOptions.puPinCpus = false;
+        else if (lArg == "--worker" && lHasValue)
+            lOptions.puWorkerPath = argv[++i];
+        else if (lArg == "--")
+        {
+            lOptions.puWorkerArguments.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::string lError;
+    readerd::LaneOrchestrator lOrchestrator(lOptions);
+    if (lOrchestrator.start(&lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-lanes: %s\n", lError.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "readerd-lanes: %zu lanes, streaming on %s\n", lOrchestrator.stats().size(),
+                 lOptions.puSocketPath.c_str());
+
+    // Ends on the document count, or once every worker has ended.
+    while (!gStopRequested)
+    {
+        const uint64_t lTarget = lDocuments ? lDocuments : ~0ull;
+        if (lOrchestrator.waitForDocuments(lTarget, std::chrono::milliseconds(200)))
+            break;
+    }
+
+    const double lSeconds = lOrchestrator.elapsedSeconds();
+    lOrchestrator.stop();
+    printStats(lOrchestrator.stats(), lSeconds);
+    return 0;
+}
@@ -0,0 +1,294 @@
+// Replays a corpus of saved scan directories through MMMReader_LoadAndProcessFromScanDirectory
+// and reports per-document timing, or captures such a corpus from a backend.
+
+#include "readerd/BulkFetch.h"
+#include "readerd/CorpusPack.h"
+#include "readerd/ReplayEngine.h"
+#include "readerd/ScanArchive.h"
+#include "readerd/Tracer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-replay --corpus DIR [--backend SPEC] [--concurrency N] [--rate DOCS/S]\n"
+        "                      [--repeat N] [--no-data] [--csv FILE] [--trace FILE] [--archive FILE]\n"
+        "       readerd-replay --capture DIR --documents N [--backend SPEC]\n"
+        "       readerd-replay --corpus DIR --pack FILE\n"
+        "\n"
+        "  --corpus DIR       directory of scan directories to replay, or a pack written by --pack\n"
+        "  --backend SPEC     reader backend (default: sim:live=0 for replay, sim for capture)\n"
+        "  --concurrency N    backends replaying in parallel (default: 1)\n"
+        "  --rate DOCS/S      start documents at this rate across all workers (default: unpaced)\n"
+        "  --repeat N         passes over the corpus (default: 1)\n"
+        "  --no-data          raise events only; leave the data for MMMReader_GetData\n"
+        "  --csv FILE         write one line of timing per document to FILE\n"
+        "  --trace FILE       write per-stage spans of each document as Chrome trace JSON\n"
+        "  --archive FILE     append every replayed document to the columnar archive FILE\n"
+        "  --capture DIR      read N documents in Blocking mode and save each as a scan directory\n"
+        "  --pack FILE        bundle the scan directories of the corpus into one file that replays\n"
+        "                     without reading each scan from disk\n");
+}
+
+// Saves each document as DIR/docNNNNNN/<data type>.<index>.<ext>, the layout the simulated
+// backend replays.
+int capture(const std::string &aBackendSpec, const std::string &aDirectory, unsigned long aDocuments)
+{
+    namespace fs = std::filesystem;
+
+    std::string lError;
+    std::unique_ptr<readerd::ReaderBackend> lBackend = readerd::createBackend(aBackendSpec, &lError);
+    if (!lBackend)
+    {
+        std::fprintf(stderr, "readerd-replay: %s\n", lError.c_str());
+        return 2;
+    }
+    MMMReaderErrorCode lResult = lBackend->initialise(nullptr, nullptr, nullptr, nullptr, nullptr);
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-replay: MMMReader_Initialise failed: %s\n",
+            readerd::errorCodeName(lResult).c_str());
+        return 1;
+    }
+
+    readerd::BulkFetcher lFetcher(*lBackend);
+    readerd::BulkResult lDocument;
+    unsigned long lSaved = 0;
+    while (lSaved < aDocuments)
+    {
+        lResult = lBackend->waitForDocumentOnWindow(1000);
+        if (lResult == ERROR_TIMED_OUT)
+            continue;
+        if (lResult == NO_ERROR_OCCURRED)
+            lResult = lBackend->readDocument();
+        if (lResult == NO_ERROR_OCCURRED)
+            lResult = lFetcher.fetch(readerd::BulkFetcher::defaultDataTypes(), &lDocument);
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-replay: read failed: %s\n", readerd::errorCodeName(lResult).c_str());
+            return 1;
+        }
+
+        char lName[32];
+        std::snprintf(lName, sizeof(lName), "doc%06lu", lSaved + 1);
+        const fs::path lScanDirectory = fs::path(aDirectory) / lName;
+        std::error_code lFsError;
+        fs::create_directories(lScanDirectory, lFsError);
+        if (lFsError)
+        {
+            std::fprintf(stderr, "readerd-replay: %s: %s\n", lScanDirectory.c_str(), lFsError.message().c_str());
+            return 1;
+        }
+
+        for (const readerd::BulkEntry &lEntry : lDocument.entries())
+        {
+            const std::span<const uint8_t> lBytes = lDocument.bytes(lEntry);
+            const bool lBitmap = lBytes.size() > 2 && lBytes[0] == 'B' && lBytes[1] == 'M';
+            const std::string lFileName = readerd::dataTypeName(lEntry.puDataType) + "."
+                + std::to_string(lEntry.puIndex) + (lBitmap ? ".bmp" : ".bin");
+
+            std::FILE *lFile = std::fopen((lScanDirectory / lFileName).c_str(), "wb");
+            if (lFile == nullptr || std::fwrite(lBytes.data(), 1, lBytes.size(), lFile) != lBytes.size())
+            {
+                std::fprintf(stderr, "readerd-replay: cannot write %s\n", (lScanDirectory / lFileName).c_str());
+                if (lFile)
+                    std::fclose(lFile);
+                return 1;
+            }
+            std::fclose(lFile);
+        }
+        lBackend->clearData();
+        ++lSaved;
+    }
+
+    lBackend->shutdown();
+    std::printf("captured %lu documents into %s\n", lSaved, aDirectory.c_str());
+    return 0;
+}
+
+double percentile(const std::vector<double> &aSorted, double aFraction)
+{
+    if (aSorted.empty())
+        return 0.0;
+    const size_t lIndex = static_cast<size_t>(aFraction * static_cast<double>(aSorted.size() - 1) + 0.5);
+    return aSorted[std::min(lIndex, aSorted.size() - 1)];
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    readerd::ReplayOptions lOptions;
+    std::string lBackendSpec;
+    std::string lCorpus;
+    std::string lCaptureDirectory;
+    std::string lPackPath;
+    std::string lCsvPath;
+    std::string lTracePath;
+    std::string lArchivePath;
+    unsigned long lDocuments = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--corpus" && lHasValue)
+            lCorpus = argv[++i];
+        else if (lArg == "--backend" && lHasValue)
+            lBackendSpec = argv[++i];
+        else if (lArg == "--concurrency" && lHasValue)
+            lOptions.puConcurrency = std::atoi(argv[++i]);
+        else if (lArg == "--rate" && lHasValue)
+            lOptions.puRate = std::atof(argv[++i]);
+        else if (lArg == "--repeat" && lHasValue)
+            lOptions.puRepeat = std::atoi(argv[++i]);
+        else if (lArg == "--no-data")
+            lOptions.puSendData = false;
+        else if (lArg == "--csv" && lHasValue)
+            lCsvPath = argv[++i];
+        else if (lArg == "--trace" && lHasValue)
+            lTracePath = argv[++i];
+        else if (lArg == "--archive" && lHasValue)
+            lArchivePath = argv[++i];
+        else if (lArg == "--capture" && lHasValue)
+            lCaptureDirectory = argv[++i];
+        else if (lArg == "--pack" && lHasValue)
+            lPackPath = argv[++i];
+        else if (lArg == "--documents" && lHasValue)
+            lDocuments = std::strtoul(argv[++i], nullptr, 10);
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    if (!lCaptureDirectory.empty())
+    {
+        if (lDocuments == 0)
+        {
+            printUsage();
+            return 2;
+        }
+        return capture(lBackendSpec.empty() ? "sim" : lBackendSpec, lCaptureDirectory, lDocuments);
+    }
+
+    if (lCorpus.empty())
+    {
+        printUsage();
+        return 2;
+    }
+    if (!lBackendSpec.empty())
+        lOptions.puBackendSpec = lBackendSpec;
+
+    std::string lError;
+    std::vector<std::string> lScanDirectories;
+    readerd::CorpusPack lPack;
+    if (readerd::CorpusPack::isPack(lCorpus))
+    {
+        if (lPack.open(lCorpus, &lError) != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-replay: %s\n", lError.c_str());
+            return 2;
+        }
+    }
+    else if (!readerd::ReplayEngine::listCorpus(lCorpus, &lScanDirectories, &lError))
+    {
+        std::fprintf(stderr, "readerd-replay: %s\n", lError.c_str());
+        return 2;
+    }
+
+    if (!lPackPath.empty())
+    {
+        if (lScanDirectories.empty())
+        {
+            std::fprintf(stderr, "readerd-replay: %s is already a pack\n", lCorpus.c_str());
+            return 2;
+        }
+        if (readerd::CorpusPack::write(lScanDirectories, lPackPath, &lError) != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-replay: %s\n", lError.c_str());
+            return 1;
+        }
+        std::printf("packed=%zu file=%s\n", lScanDirectories.size(), lPackPath.c_str());
+        return 0;
+    }
+
+    readerd::Tracer lTracer;
+    readerd::ReplayEngine lEngine(lOptions);
+    if (!lTracePath.empty())
+        lEngine.addConsumer(&lTracer);
+    readerd::ArchiveWriter lArchive;
+    if (!lArchivePath.empty())
+    {
+        readerd::ArchiveOptions lArchiveOptions;
+        lArchiveOptions.puWaitForWriter = true;
+        if (lArchive.open(lArchivePath, lArchiveOptions, &lError) != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-replay: %s\n", lError.c_str());
+            return 1;
+        }
+        lEngine.addConsumer(&lArchive);
+    }
+    const MMMReaderErrorCode lResult = lPack.size() ? lEngine.run(lPack, &lError)
+                                                    : lEngine.run(lScanDirectories, &lError);
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-replay: %s\n", lError.c_str());
+        return 1;
+    }
+    lArchive.close();
+
+    if (!lCsvPath.empty())
+    {
+        std::FILE *lFile = std::fopen(lCsvPath.c_str(), "w");
+        if (lFile == nullptr)
+        {
+            std::fprintf(stderr, "readerd-replay: cannot write %s\n", lCsvPath.c_str());
+            return 1;
+        }
+        readerd::ReplayEngine::writeCsv(lFile, lEngine.records());
+        std::fclose(lFile);
+    }
+
+    if (!lTracePath.empty())
+    {
+        std::FILE *lFile = std::fopen(lTracePath.c_str(), "w");
+        if (lFile == nullptr)
+        {
+            std::fprintf(stderr, "readerd-replay: cannot write %s\n", lTracePath.c_str());
+            return 1;
+        }
+        lTracer.writeChromeTrace(lFile);
+        std::fclose(lFile);
+    }
+
+    std::vector<double> lLatencies;
+    size_t lFailures = 0;
+    unsigned long long lBytes = 0;
+    for (const readerd::ReplayRecord &lRecord : lEngine.records())
+    {
+        if (lRecord.puResult != NO_ERROR_OCCURRED)
+            ++lFailures;
+        lLatencies.push_back(lRecord.latencyUs());
+        lBytes += lRecord.puBytes;
+    }
+    std::sort(lLatencies.begin(), lLatencies.end());
+
+    const double lElapsed = lEngine.elapsedSeconds();
+    std::printf("documents=%zu failures=%zu bytes=%llu elapsed=%.3fs docs/hour=%.0f "
+                "latency_us p50=%.0f p95=%.0f p99=%.0f max=%.0f\n",
+        lLatencies.size(), lFailures, lBytes, lElapsed,
+        lElapsed > 0.0 ? lLatencies.size() * 3600.0 / lElapsed : 0.0,
+        percentile(lLatencies, 0.50), percentile(lLatencies, 0.95), percentile(lLatencies, 0.99),
+        lLatencies.empty() ? 0.0 : lLatencies.back());
+    return lFailures == 0 ? 0 : 1;
+}
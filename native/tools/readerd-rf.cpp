@@ -0,0 +1,236 @@
+// Reads the data groups of an RFID chip through the low-level RF calls and checks them
+// against EF.SOD, with the checks overlapped with the chip reads or after each of them.
+
+#include "readerd/ReaderBackend.h"
+#include "readerd/RfReader.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Listing
+{
+    bool puPrint = true;    ///< Only the first read is listed.
+};
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-rf [--chip SPEC] [--bac KEY] [--groups N,N,...] [--sequential] [--reads N]\n"
+        "                  [--depth N] [--adaptive] [--block-profiles FILE] [--crls DIR]\n"
+        "                  [--cache-ttl SECONDS] [--cache-without-aa]\n"
+        "\n"
+        "  --chip SPEC        RFID chip: sim[:key=value,...] or sdk (default: sim)\n"
+        "  --bac KEY          BAC key: document number, date of birth and expiry with their check\n"
+        "                     digits (default: the ICAO 9303 specimen)\n"
+        "  --groups LIST      data groups to read, in order (default: every one EF.COM lists)\n"
+        "  --sequential       check each data group before reading the next\n"
+        "  --reads N          read the chip N times and report the mean (default: 1)\n"
+        "  --depth N          data groups read ahead of their checks at most (default: 4)\n"
+        "  --adaptive         tune the READ BINARY block size to the chip as it is read\n"
+        "  --block-profiles FILE\n"
+        "                     load and save the block sizes learnt per kind of chip (implies --adaptive)\n"
+        "  --crls DIR         check the document signer against the revocation lists in DIR\n"
+        "  --cache-ttl SECONDS  serve a chip read again within SECONDS from memory, after reading\n"
+        "                     EF.SOD and passing Active Authentication\n"
+        "  --cache-without-aa also serve chips without Active Authentication from the cache\n"
+        "\n"
+        "Simulated chip options: dg2, dg3, dg14 (file sizes), tamper (data group whose digest\n"
+        "does not match), block (READ BINARY size), max_block (largest block answered), apdu_us,\n"
+        "ext_us (extra per extended length APDU), kbps, open_us, id (chip identifier), signer (DER\n"
+        "document signer certificate file to name in EF.SOD), aa (Active Authentication: 0 none,\n"
+        "1 passes, 2 fails), aa_us.\n");
+}
+
+bool parseGroups(const std::string &aList, std::vector<int> *aGroups)
+{
+    std::stringstream lStream(aList);
+    std::string lItem;
+    while (std::getline(lStream, lItem, ','))
+    {
+        char *lEnd = nullptr;
+        const long lGroup = std::strtol(lItem.c_str(), &lEnd, 10);
+        if (lEnd == lItem.c_str() || *lEnd != '\0' || lGroup < 1 || lGroup > readerd::kMaxDataGroup)
+            return false;
+        aGroups->push_back(static_cast<int>(lGroup));
+    }
+    return !aGroups->empty();
+}
+
+const char *validationName(int aCode)
+{
+    switch (aCode)
+    {
+    case RFID_VC_VALID:
+        return "valid";
+    case RFID_VC_INVALID:
+        return "INVALID";
+    case RFID_VC_VALID_WITH_REVOKED_CERT:
+        return "valid, signer REVOKED";
+    case RFID_VC_NOT_PERFORMED:
+        return "not checked";
+    default:
+        return "unknown";
+    }
+}
+
+void onData(void *aParam, MMMReaderDataType aDataType, int aDataLen, void *aDataPtr)
+{
+    Listing &lListing = *static_cast<Listing *>(aParam);
+    const std::string lName = readerd::dataTypeName(aDataType);
+    const bool lIsCheck = lName.size() > 9 && lName.compare(lName.size() - 9, 9, "_VALIDATE") == 0;
+    if (!lListing.puPrint)
+        return;
+    if (lIsCheck)
+        std::printf("  %-20s %s\n", lName.c_str(), validationName(*static_cast<const int *>(aDataPtr)));
+    else
+        std::printf("  %-20s %d bytes\n", lName.c_str(), aDataLen);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string lChipSpec = "sim";
+    std::string lBacKey = "L898902C<369080619406236";
+    readerd::RfReadOptions lOptions;
+    int lReads = 1;
+    bool lAdaptive = false;
+    std::string lProfilesPath;
+    std::string lRevocationDirectory;
+    readerd::ChipCacheOptions lCacheOptions;
+    bool lCaching = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--chip" && lHasValue)
+            lChipSpec = argv[++i];
+        else if (lArg == "--bac" && lHasValue)
+            lBacKey = argv[++i];
+        else if (lArg == "--groups" && lHasValue && parseGroups(argv[i + 1], &lOptions.puDataGroups))
+            ++i;
+        else if (lArg == "--sequential")
+            lOptions.puPipelined = false;
+        else if (lArg == "--reads" && lHasValue)
+            lReads = std::max(1, std::atoi(argv[++i]));
+        else if (lArg == "--depth" && lHasValue)
+            lOptions.puQueueDepth = std::strtoul(argv[++i], nullptr, 10);
+        else if (lArg == "--adaptive")
+            lAdaptive = true;
+        else if (lArg == "--block-profiles" && lHasValue)
+        {
+            lProfilesPath = argv[++i];
+            lAdaptive = true;
+        }
+        else if (lArg == "--crls" && lHasValue)
+            lRevocationDirectory = argv[++i];
+        else if (lArg == "--cache-ttl" && lHasValue)
+        {
+            lCacheOptions.puTimeToLive = std::chrono::seconds(std::max(1, std::atoi(argv[++i])));
+            lCaching = true;
+        }
+        else if (lArg == "--cache-without-aa")
+            lCacheOptions.puRequireActiveAuthentication = false;
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    std::string lError;
+    std::unique_ptr<readerd::RfChip> lChip = readerd::createChip(lChipSpec, &lError);
+    if (!lChip)
+    {
+        std::fprintf(stderr, "readerd-rf: %s\n", lError.c_str());
+        return 2;
+    }
+    if (!readerd::digestSupported())
+        std::fprintf(stderr, "readerd-rf: built without libcrypto, data groups are not checked\n");
+
+    readerd::BlockSizeTuner lTuner;
+    if (!lProfilesPath.empty() && lTuner.load(lProfilesPath, &lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-rf: %s\n", lError.c_str());
+        return 2;
+    }
+    if (lAdaptive)
+        lOptions.puTuner = &lTuner;
+
+    readerd::RevocationSource lSource;
+    lSource.puDirectory = lRevocationDirectory;
+    readerd::RevocationCache lRevocations(lSource);
+    if (!lRevocationDirectory.empty())
+    {
+        readerd::RevocationRefreshStats lLoaded;
+        if (lRevocations.refresh(&lLoaded, &lError) != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-rf: %s\n", lError.c_str());
+            return 2;
+        }
+        std::printf("revocation lists: %llu issuers, %llu revoked serial numbers, %llu files skipped\n",
+                    static_cast<unsigned long long>(lLoaded.puLists),
+                    static_cast<unsigned long long>(lLoaded.puSerials),
+                    static_cast<unsigned long long>(lLoaded.puSkipped));
+        lOptions.puRevocations = &lRevocations;
+    }
+
+    readerd::ChipResultCache lCache(lCacheOptions);
+    if (lCaching)
+        lOptions.puCache = &lCache;
+
+    readerd::RfReader lReader(lOptions);
+    Listing lListing;
+    readerd::RfReadStats lTotal;
+    for (int lRead = 0; lRead < lReads; ++lRead)
+    {
+        MMMReaderErrorCode lResult = lChip->waitForOpen(lBacKey.c_str(), 5000);
+        readerd::RfReadStats lStats;
+        if (lResult == NO_ERROR_OCCURRED)
+            lResult = lReader.read(*lChip, onData, &lListing, &lStats);
+        lChip->powerOff();
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd-rf: reading the chip failed: %s\n",
+                         readerd::errorCodeName(lResult).c_str());
+            return 1;
+        }
+        lListing.puPrint = false;
+        if (lAdaptive)
+            std::printf("read %d: %.3f ms, chip %.3f ms, next block %d bytes\n", lRead + 1, lStats.puTotalMs,
+                        lStats.puReadMs, lStats.puBlockSize);
+        else if (lCaching)
+            std::printf("read %d: %.3f ms, chip %.3f ms, %s\n", lRead + 1, lStats.puTotalMs, lStats.puReadMs,
+                        lStats.puCacheHit ? "from the cache" : "in full");
+        lTotal.puTotalMs += lStats.puTotalMs;
+        lTotal.puReadMs += lStats.puReadMs;
+        lTotal.puValidateMs += lStats.puValidateMs;
+        lTotal.puDrainMs += lStats.puDrainMs;
+        lTotal.puBytes = lStats.puBytes;
+        lTotal.puDataGroups = lStats.puDataGroups;
+        lTotal.puInvalid += lStats.puInvalid;
+        lTotal.puSignerStatus = lStats.puSignerStatus;
+        lTotal.puRevocationUs += lStats.puRevocationUs;
+    }
+    if (!lProfilesPath.empty() && lTuner.save(lProfilesPath, &lError) != NO_ERROR_OCCURRED)
+        std::fprintf(stderr, "readerd-rf: %s\n", lError.c_str());
+
+    std::printf("%s: %d data groups, %llu bytes, %d invalid; per read: total %.3f ms, chip %.3f ms, "
+                "checks %.3f ms, left after the last read %.3f ms\n",
+                lOptions.puPipelined ? "pipelined" : "sequential", lTotal.puDataGroups,
+                static_cast<unsigned long long>(lTotal.puBytes), lTotal.puInvalid, lTotal.puTotalMs / lReads,
+                lTotal.puReadMs / lReads, lTotal.puValidateMs / lReads, lTotal.puDrainMs / lReads);
+    if (lOptions.puRevocations != nullptr)
+        std::printf("document signer: %s, checked in %.3f us\n", readerd::revocationStatusName(lTotal.puSignerStatus),
+                    lTotal.puRevocationUs / lReads);
+    return lTotal.puInvalid > 0 ? 3 : 0;
+}
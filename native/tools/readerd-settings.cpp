@@ -0,0 +1,90 @@
+// Loads the SDK settings through a snapshot, as a start of the low-level API would: mapped
+// when the configuration files are unchanged, parsed and saved again when they are not.
+
+#include "readerd/SettingsSnapshot.h"
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace {
+
+const char *const kDirectoryNames[] = {"reader", "exe", "bin", "config", "plugins", "data", "log", "layouts"};
+static_assert(std::size(kDirectoryNames) == std::size(readerd::kSettingsDirectories));
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-settings [--backend SPEC] [--ini FILE] [--watch DIR]... [--snapshot FILE]\n"
+        "\n"
+        "  --backend SPEC     reader backend, as for readerd (default: sdk)\n"
+        "  --ini FILE         location file to load instead of MMMReader.ini in the binaries folder\n"
+        "  --watch DIR        also take the INI files in DIR for part of the snapshot key\n"
+        "  --snapshot FILE    where the snapshot is kept (default: readerd-settings.snap)\n"
+        "\n"
+        "Prints whether the snapshot was used, the load time and the SDK folders.\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string lBackendSpec = "sdk";
+    readerd::SettingsSource lSource;
+    lSource.puSnapshotPath = "readerd-settings.snap";
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--backend" && lHasValue)
+            lBackendSpec = argv[++i];
+        else if (lArg == "--ini" && lHasValue)
+            lSource.puIniPath = argv[++i];
+        else if (lArg == "--watch" && lHasValue)
+            lSource.puWatchDirectories.push_back(argv[++i]);
+        else if (lArg == "--snapshot" && lHasValue)
+            lSource.puSnapshotPath = argv[++i];
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    std::string lError;
+    std::unique_ptr<readerd::ReaderBackend> lBackend = readerd::createBackend(lBackendSpec, &lError);
+    if (!lBackend)
+    {
+        std::fprintf(stderr, "readerd-settings: %s\n", lError.c_str());
+        return 2;
+    }
+
+    // Large, so not on the stack.
+    auto lSettings = std::make_unique<MMMReaderSettings>();
+    readerd::SettingsSnapshot lSnapshot;
+    readerd::SettingsLoadResult lLoad;
+    const auto lStart = std::chrono::steady_clock::now();
+    const MMMReaderErrorCode lResult = readerd::loadSettingsCached(*lBackend, lSource, &lSnapshot, lSettings.get(),
+                                                                   &lLoad);
+    const double lMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - lStart).count();
+    if (lResult != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-settings: loading settings failed: %s\n",
+                     readerd::errorCodeName(lResult).c_str());
+        return 1;
+    }
+
+    if (lLoad.puFromSnapshot)
+        std::printf("snapshot hit: %s in %.3f ms\n", lSource.puSnapshotPath.c_str(), lMs);
+    else
+        std::printf("snapshot miss (%s): parsed in %.3f ms%s\n", lLoad.puMissReason.c_str(), lMs,
+                    lLoad.puSnapshotWritten ? ", snapshot saved" : "");
+    for (size_t i = 0; i < std::size(kDirectoryNames); ++i)
+    {
+        const RTCHAR *lDirectory = (*lSettings).*readerd::kSettingsDirectories[i];
+        std::printf("  %-8s %s\n", kDirectoryNames[i], lDirectory != nullptr ? lDirectory : "-");
+    }
+    return 0;
+}
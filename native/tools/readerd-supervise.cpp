@@ -0,0 +1,152 @@
+// Serves one reader through a readerd worker process with a warm standby, failing over to it
+// when the worker crashes or hangs, and on SIGUSR1 in place of a reader reset.
+
+#include "readerd/ReaderSupervisor.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+volatile std::sig_atomic_t gStopRequested = 0;
+volatile std::sig_atomic_t gFailoverRequested = 0;
+
+void onSignal(int)
+{
+    gStopRequested = 1;
+}
+
+void onFailover(int)
+{
+    gFailoverRequested = 1;
+}
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd-supervise [--backend SPEC] [--scanner SERIAL] [--socket ADDRESS]\n"
+        "                         [--framing records|documents] [--documents N] [--hang-ms N]\n"
+        "                         [--start-ms N] [--no-standby] [--worker PATH] [-- WORKER ARGUMENTS]\n"
+        "\n"
+        "  --backend SPEC     reader backend of the workers, as for readerd (default: sdk)\n"
+        "  --scanner SERIAL   serial number of the reader, when several are connected\n"
+        "  --socket ADDRESS   AF_UNIX socket path or tcp:HOST:PORT results are streamed on\n"
+        "                     (default: /tmp/readerd.sock)\n"
+        "  --framing HOW      send each record as it arrives, or each document as one frame\n"
+        "                     (default: records)\n"
+        "  --documents N      exit after N documents have been read (default: run until signalled)\n"
+        "  --hang-ms N        fail over when the worker's heartbeats stop for this long (default: 1000)\n"
+        "  --start-ms N       give a worker this long to initialise (default: 30000)\n"
+        "  --no-standby       keep no standby worker: every failover is a cold start\n"
+        "  --worker PATH      readerd executable (default: the one next to readerd-supervise)\n"
+        "\n"
+        "Arguments after -- are passed to every worker. SIGUSR1 fails over to the standby, as a\n"
+        "reset of the reader that needs no cold start.\n");
+}
+
+bool parseFraming(const std::string &aName, readerd::ServerFraming *aFraming)
+{
+    if (aName == "records")
+        *aFraming = readerd::SF_RECORDS;
+    else if (aName == "documents")
+        *aFraming = readerd::SF_DOCUMENTS;
+    else
+        return false;
+    return true;
+}
+
+std::string defaultWorker()
+{
+    std::error_code lError;
+    const std::filesystem::path lSelf = std::filesystem::read_symlink("/proc/self/exe", lError);
+    if (!lError)
+    {
+        const std::filesystem::path lSibling = lSelf.parent_path() / "readerd";
+        if (std::filesystem::exists(lSibling, lError))
+            return lSibling.string();
+    }
+    return "readerd";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    readerd::SupervisorOptions lOptions;
+    lOptions.puWorkerPath = defaultWorker();
+    uint64_t lDocuments = 0;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--backend" && lHasValue)
+            lOptions.puBackendSpec = argv[++i];
+        else if (lArg == "--scanner" && lHasValue)
+            lOptions.puScanner = argv[++i];
+        else if (lArg == "--socket" && lHasValue)
+            lOptions.puSocketPath = argv[++i];
+        else if (lArg == "--framing" && lHasValue && parseFraming(argv[i + 1], &lOptions.puFraming))
+            ++i;
+        else if (lArg == "--documents" && lHasValue)
+            lDocuments = std::strtoull(argv[++i], nullptr, 10);
+        else if (lArg == "--hang-ms" && lHasValue)
+            lOptions.puHangTimeout = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+        else if (lArg == "--start-ms" && lHasValue)
+            lOptions.puStartTimeout = std::chrono::milliseconds(std::strtoul(argv[++i], nullptr, 10));
+        else if (lArg == "--no-standby")
+            lOptions.puStandby = false;
+        else if (lArg == "--worker" && lHasValue)
+            lOptions.puWorkerPath = argv[++i];
+        else if (lArg == "--")
+        {
+            lOptions.puWorkerArguments.assign(argv + i + 1, argv + argc);
+            break;
+        }
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGUSR1, onFailover);
+
+    std::string lError;
+    readerd::ReaderSupervisor lSupervisor(lOptions);
+    if (lSupervisor.start(&lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd-supervise: %s\n", lError.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "readerd-supervise: streaming on %s\n", lOptions.puSocketPath.c_str());
+
+    while (!gStopRequested)
+    {
+        if (gFailoverRequested)
+        {
+            gFailoverRequested = 0;
+            lSupervisor.requestFailover();
+        }
+        const uint64_t lTarget = lDocuments ? lDocuments : ~0ull;
+        if (lSupervisor.waitForDocuments(lTarget, std::chrono::milliseconds(50)))
+            break;
+    }
+
+    lSupervisor.stop();
+    const readerd::SupervisorStats lStats = lSupervisor.stats();
+    std::printf("documents=%llu failovers=%llu cold_starts=%llu workers=%llu last_recovery_ms=%.1f "
+                "max_recovery_ms=%.1f\n",
+                static_cast<unsigned long long>(lStats.puDocuments),
+                static_cast<unsigned long long>(lStats.puFailovers),
+                static_cast<unsigned long long>(lStats.puColdStarts),
+                static_cast<unsigned long long>(lStats.puWorkersStarted), lStats.puLastRecoveryMs,
+                lStats.puMaxRecoveryMs);
+    return 0;
+}
@@ -0,0 +1,339 @@
+// Headless reader daemon: owns the document reader and streams every data item, event and
+// error to clients connected to a local socket.
+
+#include "readerd/ReaderDaemon.h"
+#include "readerd/ScanArchive.h"
+#include "readerd/Tracer.h"
+
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+volatile std::sig_atomic_t gStopRequested = 0;
+volatile std::sig_atomic_t gActivateRequested = 0;
+
+void onSignal(int)
+{
+    gStopRequested = 1;
+}
+
+void onActivate(int)
+{
+    gActivateRequested = 1;
+}
+
+void printUsage()
+{
+    std::fprintf(stderr,
+        "usage: readerd [--backend SPEC] [--scanner SERIAL] [--socket ADDRESS] [--framing records|documents]\n"
+        "               [--documents N] [--list-scanners]\n"
+        "               [--queue-limit MB] [--blocking] [--trace FILE] [--convert rgb|grey|half] [--convert-threads N]\n"
+        "               [--encode jpeg|png] [--encode-threads N] [--quality N] [--photo-quality N]\n"
+        "               [--scale-down N] [--shm NAME] [--shm-mb N] [--compact-codelines]\n"
+        "               [--archive FILE] [--archive-no-images] [--standby] [--heartbeat-fd FD]\n"
+        "               [--certs STORE] [--crls DIR] [--crl-refresh SECONDS]\n"
+        "\n"
+        "  --backend SPEC     reader backend, \"sim[:key=value,...]\" or \"sdk\" (default: sim)\n"
+        "  --scanner SERIAL   drive the reader with this serial number when several are connected\n"
+        "  --list-scanners    print the serial numbers of the connected readers and exit\n"
+        "  --socket ADDRESS   AF_UNIX socket path or tcp:HOST:PORT results are streamed on\n"
+        "                     (default: /tmp/readerd.sock)\n"
+        "  --framing HOW      send each record as it arrives, or each document as one frame\n"
+        "                     (default: records)\n"
+        "  --documents N      exit after N documents have been read (default: run until signalled)\n"
+        "  --queue-limit MB   disconnect clients that fall this far behind (default: 256)\n"
+        "  --blocking         read in Blocking mode, collecting each document with one bulk GetData pass\n"
+        "  --trace FILE       write per-stage spans of each document as Chrome trace JSON on exit\n"
+        "  --convert TARGET   also stream each BMP image as raw RGB, greyscale or half-size RGB pixels\n"
+        "  --convert-threads N  worker threads converting images (default: 2)\n"
+        "  --encode FORMAT    also stream each BMP image encoded as JPEG or PNG\n"
+        "  --encode-threads N worker threads encoding images (default: 2)\n"
+        "  --quality N        JPEG quality of page images, 1-100 (default: 80)\n"
+        "  --photo-quality N  JPEG quality of CD_IMAGEPHOTO, 1-100 (default: 90)\n"
+        "  --scale-down N     shrink page images by N (a power of two) before encoding (default: 1)\n"
+        "  --shm NAME         also publish each document into the shared memory ring NAME (e.g. /readerd)\n"
+        "  --shm-mb N         size of the shared memory ring (default: 256)\n"
+        "  --compact-codelines  send parsed codelines in the compact encoding instead of the raw struct\n"
+        "  --archive FILE     append every document to the columnar archive FILE (see readerd-archive)\n"
+        "  --archive-no-images  archive only the size of each image\n"
+        "  --standby          initialise with the reader suspended and start reading on SIGUSR1\n"
+        "  --heartbeat-fd FD  write a byte to FD every 200 ms while the reader answers: S on standby,\n"
+        "                     A when reading, F once it reports a fatal error (see readerd-supervise)\n"
+        "  --certs STORE      answer the SDK's certificate requests from a store built by readerd-certs\n"
+        "  --crls DIR         answer the SDK's revocation list requests from the lists in DIR\n"
+        "  --crl-refresh SECONDS  how often DIR is checked for new or changed lists (default: 60)\n");
+}
+
+bool parseFraming(const std::string &aName, readerd::ServerFraming *aFraming)
+{
+    if (aName == "records")
+        *aFraming = readerd::SF_RECORDS;
+    else if (aName == "documents")
+        *aFraming = readerd::SF_DOCUMENTS;
+    else
+        return false;
+    return true;
+}
+
+bool parseConvertTarget(const std::string &aName, readerd::ConvertTarget *aTarget)
+{
+    if (aName == "rgb")
+        *aTarget = readerd::CONVERT_RGB;
+    else if (aName == "grey")
+        *aTarget = readerd::CONVERT_GREY;
+    else if (aName == "half")
+        *aTarget = readerd::CONVERT_RGB_HALF;
+    else
+        return false;
+    return true;
+}
+
+bool parseEncoding(const std::string &aName, readerd::ImageEncoding *aEncoding)
+{
+    if (aName == "jpeg")
+        *aEncoding = readerd::ENCODE_JPEG;
+    else if (aName == "png")
+        *aEncoding = readerd::ENCODE_PNG;
+    else
+        return false;
+    return true;
+}
+
+/// Asks the reader for its state first, so that the heartbeats stop if the SDK is wedged.
+void sendHeartbeat(int aFd, readerd::ReaderBackend &aBackend, bool aStandby)
+{
+    const ReaderState lState = aBackend.getState();
+    const char lBeat = lState == READER_FATAL_ERRORED ? 'F' : aStandby ? 'S' : 'A';
+    // A full pipe means the supervisor is behind, a broken one that it is gone: either way
+    // there is nothing to do here.
+    [[maybe_unused]] const ssize_t lWritten = ::write(aFd, &lBeat, 1);
+}
+
+void printStats(const readerd::DaemonStats &aStats)
+{
+    std::printf("documents=%llu items=%llu bytes=%llu pinned=%llu pool=%llu/%llu converted=%llu/%llu "
+                "encoded=%llu/%llu encoded_bytes=%llu ring=%llu/%llu events=%llu errors=%llu elapsed=%.3fs "
+                "docs/hour=%.0f\n",
+        static_cast<unsigned long long>(aStats.puDocuments),
+        static_cast<unsigned long long>(aStats.puDataItems),
+        static_cast<unsigned long long>(aStats.puDataBytes),
+        static_cast<unsigned long long>(aStats.puPinnedBytes),
+        static_cast<unsigned long long>(aStats.puPoolHits),
+        static_cast<unsigned long long>(aStats.puPoolHits + aStats.puPoolMisses),
+        static_cast<unsigned long long>(aStats.puImagesConverted),
+        static_cast<unsigned long long>(aStats.puImagesConverted + aStats.puImagesDropped),
+        static_cast<unsigned long long>(aStats.puImagesEncoded),
+        static_cast<unsigned long long>(aStats.puImagesEncoded + aStats.puEncodeDropped),
+        static_cast<unsigned long long>(aStats.puEncodedBytes),
+        static_cast<unsigned long long>(aStats.puRingDocuments),
+        static_cast<unsigned long long>(aStats.puRingDocuments + aStats.puRingDropped),
+        static_cast<unsigned long long>(aStats.puEvents),
+        static_cast<unsigned long long>(aStats.puErrors),
+        aStats.puElapsedSeconds,
+        aStats.documentsPerHour());
+    std::fflush(stdout);
+}
+
+void printArchiveStats(const readerd::ArchiveWriter::Stats &aStats)
+{
+    std::printf("archived=%llu dropped=%llu mismatched=%llu segments=%llu archive_bytes=%llu\n",
+        static_cast<unsigned long long>(aStats.puDocuments),
+        static_cast<unsigned long long>(aStats.puDropped),
+        static_cast<unsigned long long>(aStats.puMismatched),
+        static_cast<unsigned long long>(aStats.puSegments),
+        static_cast<unsigned long long>(aStats.puBytes));
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string lBackendSpec = "sim";
+    bool lListScanners = false;
+    readerd::DaemonOptions lOptions;
+    unsigned long long lDocuments = 0;
+    std::string lTracePath;
+    std::string lArchivePath;
+    readerd::ArchiveOptions lArchiveOptions;
+    int lHeartbeatFd = -1;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string lArg = argv[i];
+        const bool lHasValue = i + 1 < argc;
+        if (lArg == "--backend" && lHasValue)
+            lBackendSpec = argv[++i];
+        else if (lArg == "--scanner" && lHasValue)
+            lOptions.puScanner = argv[++i];
+        else if (lArg == "--list-scanners")
+            lListScanners = true;
+        else if (lArg == "--socket" && lHasValue)
+            lOptions.puSocketPath = argv[++i];
+        else if (lArg == "--framing" && lHasValue && parseFraming(argv[i + 1], &lOptions.puFraming))
+            ++i;
+        else if (lArg == "--documents" && lHasValue)
+            lDocuments = std::strtoull(argv[++i], nullptr, 10);
+        else if (lArg == "--queue-limit" && lHasValue)
+            lOptions.puClientQueueLimit = std::strtoull(argv[++i], nullptr, 10) * 1024u * 1024u;
+        else if (lArg == "--blocking")
+            lOptions.puBlocking = true;
+        else if (lArg == "--trace" && lHasValue)
+            lTracePath = argv[++i];
+        else if (lArg == "--convert" && lHasValue && parseConvertTarget(argv[i + 1], &lOptions.puConvertTarget))
+        {
+            lOptions.puConvertImages = true;
+            ++i;
+        }
+        else if (lArg == "--convert-threads" && lHasValue)
+            lOptions.puConvertThreads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (lArg == "--encode" && lHasValue && parseEncoding(argv[i + 1], &lOptions.puEncoder.puEncoding))
+        {
+            lOptions.puEncodeImages = true;
+            ++i;
+        }
+        else if (lArg == "--encode-threads" && lHasValue)
+            lOptions.puEncoder.puThreads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        else if (lArg == "--quality" && lHasValue)
+            lOptions.puEncoder.puImageQuality = std::atoi(argv[++i]);
+        else if (lArg == "--photo-quality" && lHasValue)
+            lOptions.puEncoder.puPhotoQuality = std::atoi(argv[++i]);
+        else if (lArg == "--scale-down" && lHasValue)
+            lOptions.puEncoder.puScaleDown = std::atoi(argv[++i]);
+        else if (lArg == "--compact-codelines")
+            lOptions.puCompactCodelines = true;
+        else if (lArg == "--shm" && lHasValue)
+            lOptions.puSharedRing = argv[++i];
+        else if (lArg == "--archive" && lHasValue)
+            lArchivePath = argv[++i];
+        else if (lArg == "--archive-no-images")
+            lArchiveOptions.puStoreImages = false;
+        else if (lArg == "--standby")
+            lOptions.puStandby = true;
+        else if (lArg == "--heartbeat-fd" && lHasValue)
+            lHeartbeatFd = std::atoi(argv[++i]);
+        else if (lArg == "--certs" && lHasValue)
+            lOptions.puCertificateStore = argv[++i];
+        else if (lArg == "--crls" && lHasValue)
+            lOptions.puRevocationLists = argv[++i];
+        else if (lArg == "--crl-refresh" && lHasValue)
+            lOptions.puRevocationRefreshMs = std::max(1, std::atoi(argv[++i])) * 1000;
+        else if (lArg == "--shm-mb" && lHasValue)
+            lOptions.puSharedRingBytes = std::strtoull(argv[++i], nullptr, 10) * 1024u * 1024u;
+        else
+        {
+            printUsage();
+            return lArg == "--help" ? 0 : 2;
+        }
+    }
+
+    if (lOptions.puEncodeImages && !readerd::ImageEncoder::supported(lOptions.puEncoder.puEncoding))
+    {
+        std::fprintf(stderr, "readerd: built without %s support\n",
+            readerd::imageEncodingName(lOptions.puEncoder.puEncoding));
+        return 2;
+    }
+
+    std::string lError;
+    std::unique_ptr<readerd::ReaderBackend> lBackend = readerd::createBackend(lBackendSpec, &lError);
+    if (!lBackend)
+    {
+        std::fprintf(stderr, "readerd: %s\n", lError.c_str());
+        return 2;
+    }
+
+    if (lListScanners)
+    {
+        std::vector<std::string> lSerialNumbers;
+        const MMMReaderErrorCode lResult = lBackend->getConnectedScanners(&lSerialNumbers);
+        if (lResult != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd: MMMReader_GetConnectedScanners failed: %s\n",
+                readerd::errorCodeName(lResult).c_str());
+            return 1;
+        }
+        for (const std::string &lSerialNumber : lSerialNumbers)
+            std::printf("%s\n", lSerialNumber.c_str());
+        return 0;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::signal(SIGUSR1, onActivate);
+    if (lHeartbeatFd >= 0)
+        std::signal(SIGPIPE, SIG_IGN);
+
+    readerd::Tracer lTracer;
+    readerd::ReaderDaemon lDaemon(std::move(lBackend), lOptions);
+    if (!lTracePath.empty())
+        lDaemon.addConsumer(&lTracer);
+    readerd::ArchiveWriter lArchive;
+    if (!lArchivePath.empty())
+    {
+        if (lArchive.open(lArchivePath, lArchiveOptions, &lError) != NO_ERROR_OCCURRED)
+        {
+            std::fprintf(stderr, "readerd: %s\n", lError.c_str());
+            return 1;
+        }
+        lDaemon.addConsumer(&lArchive);
+    }
+    if (lDaemon.start(&lError) != NO_ERROR_OCCURRED)
+    {
+        std::fprintf(stderr, "readerd: %s\n", lError.c_str());
+        return 1;
+    }
+    std::fprintf(stderr, "readerd: %s backend ready, streaming on %s\n",
+        lDaemon.backend().name(), lOptions.puSocketPath.c_str());
+
+    // A standby polls for SIGUSR1 often, so that taking over costs milliseconds.
+    bool lStandby = lOptions.puStandby;
+    int lExitCode = 0;
+    while (!gStopRequested)
+    {
+        if (lStandby && gActivateRequested)
+        {
+            const MMMReaderErrorCode lResult = lDaemon.activate();
+            if (lResult != NO_ERROR_OCCURRED)
+            {
+                std::fprintf(stderr, "readerd: MMMReader_SetState(READER_ENABLED) failed: %s\n",
+                    readerd::errorCodeName(lResult).c_str());
+                lExitCode = 1;
+                break;
+            }
+            lStandby = false;
+        }
+        if (lHeartbeatFd >= 0)
+            sendHeartbeat(lHeartbeatFd, lDaemon.backend(), lStandby);
+        const uint64_t lTarget = lDocuments ? lDocuments : ~0ull;
+        if (lDaemon.waitForDocuments(lTarget, std::chrono::milliseconds(lStandby ? 10 : 200)))
+            break;
+    }
+
+    lDaemon.stop();
+    printStats(lDaemon.stats());
+    if (!lArchivePath.empty())
+    {
+        lArchive.close();
+        printArchiveStats(lArchive.stats());
+    }
+
+    if (!lTracePath.empty())
+    {
+        std::FILE *lFile = std::fopen(lTracePath.c_str(), "w");
+        if (lFile == nullptr)
+        {
+            std::fprintf(stderr, "readerd: cannot write %s\n", lTracePath.c_str());
+            return 1;
+        }
+        lTracer.writeChromeTrace(lFile);
+        std::fclose(lFile);
+    }
+    return lExitCode;
+}
@@ -0,0 +1,256 @@
+package com.readerd;
+
+import java.nio.ByteBuffer;
+import java.nio.charset.StandardCharsets;
+
+/**
+ * Read-only view of a codeline in the compact encoding that readerd sends as RK_CODELINE
+ * records (see native/include/readerd/CodelineCodec.h for the layout).
+ *
+ * The record is walked once to find where each member starts; the strings stay in the
+ * buffer and are only decoded when a getter asks for them, and {@link #slice(int)} hands
+ * them out without any copy at all. This replaces building a CodelineData from the raw
+ * struct with ConstructCodelineData.
+ */
+public final class CompactCodeline {
+    public static final int VERSION = 1;
+
+    // String members, in the order they are encoded.
+    public static final int DATA = 0;
+    public static final int LINE1 = 1;
+    public static final int LINE2 = 2;
+    public static final int LINE3 = 3;
+    public static final int DOC_ID = 4;
+    public static final int DOC_TYPE = 5;
+    public static final int SURNAME = 6;
+    public static final int FORENAME = 7;
+    public static final int SECOND_NAME = 8;
+    public static final int FORENAMES = 9;
+    public static final int DATE_OF_BIRTH_MRZ = 10;
+    public static final int EXPIRY_DATE_MRZ = 11;
+    public static final int ISSUING_STATE = 12;
+    public static final int NATIONALITY = 13;
+    public static final int DOC_NUMBER = 14;
+    public static final int SEX = 15;
+    public static final int OPTIONAL_DATA1 = 16;
+    public static final int OPTIONAL_DATA2 = 17;
+    public static final int STRING_COUNT = 18;
+
+    private static final int LINE_COUNT_BIT = 1 << 18;
+    private static final int DATE_OF_BIRTH_BIT = 1 << 19;
+    private static final int EXPIRY_DATE_BIT = 1 << 20;
+    private static final int SHORT_SEX_BIT = 1 << 21;
+    private static final int CHECK_DIGITS_BIT = 1 << 22;
+    private static final int VALIDATION_RESULT_BIT = 1 << 23;
+    private static final int FLAGS_BIT = 1 << 24;
+    private static final int IMAGE_SOURCE_BIT = 1 << 25;
+    private static final int DATA_FROM_LINES_BIT = 1 << 26;
+
+    private static final int MAX_STRING_LENGTH = 200;
+    private static final int MAX_CHECK_DIGITS = 5;
+
+    /** One entry of the codeline's check digit list. */
+    public static final class CheckDigit {
+        public final int type;
+        public final int line;
+        public final int position;
+        public final char expected;
+        public final char read;
+        public final int result;
+
+        CheckDigit(int type, int line, int position, char expected, char read, int result) {
+            this.type = type;
+            this.line = line;
+            this.position = position;
+            this.expected = expected;
+            this.read = read;
+            this.result = result;
+        }
+    }
+
+    private final ByteBuffer buffer;
+    private final int[] offsets = new int[STRING_COUNT];
+    private final int[] lengths = new int[STRING_COUNT];
+    private int position;
+    private boolean dataFromLines;
+    private int lineCount;
+    private final int[] dateOfBirth = new int[3];
+    private final int[] expiryDate = new int[3];
+    private char shortSex;
+    private CheckDigit[] checkDigits = new CheckDigit[0];
+    private int validationResult;
+    private boolean mrzOnRearSide;
+    private boolean expiredDocument;
+    private int imageSource;
+
+    private CompactCodeline(ByteBuffer buffer) {
+        this.buffer = buffer;
+        this.position = buffer.position();
+    }
+
+    /**
+     * Parses the record between the buffer's position and limit. The buffer is not copied
+     * and must not change while the view is in use.
+     *
+     * @throws IllegalArgumentException if the record is truncated or has another version
+     */
+    public static CompactCodeline parse(ByteBuffer record) {
+        CompactCodeline view = new CompactCodeline(record.duplicate());
+        view.walk();
+        return view;
+    }
+
+    public static CompactCodeline parse(byte[] record, int offset, int length) {
+        return parse(ByteBuffer.wrap(record, offset, length));
+    }
+
+    private void walk() {
+        if (readByte() != VERSION) {
+            throw new IllegalArgumentException("unsupported codeline encoding");
+        }
+        int presence = readVarint();
+        for (int i = 0; i < STRING_COUNT; ++i) {
+            if ((presence & (1 << i)) == 0) {
+                continue;
+            }
+            int length = readVarint();
+            if (length < 0 || length > MAX_STRING_LENGTH || length > buffer.limit() - position) {
+                throw new IllegalArgumentException("truncated codeline");
+            }
+            offsets[i] = position;
+            lengths[i] = length;
+            position += length;
+        }
+        dataFromLines = (presence & DATA_FROM_LINES_BIT) != 0;
+        if ((presence & LINE_COUNT_BIT) != 0) {
+            lineCount = readSigned();
+        }
+        if ((presence & DATE_OF_BIRTH_BIT) != 0) {
+            readDate(dateOfBirth);
+        }
+        if ((presence & EXPIRY_DATE_BIT) != 0) {
+            readDate(expiryDate);
+        }
+        if ((presence & SHORT_SEX_BIT) != 0) {
+            shortSex = (char) readByte();
+        }
+        if ((presence & CHECK_DIGITS_BIT) != 0) {
+            int count = readVarint();
+            if (count < 0 || count > MAX_CHECK_DIGITS) {
+                throw new IllegalArgumentException("too many check digits");
+            }
+            checkDigits = new CheckDigit[count];
+            for (int i = 0; i < count; ++i) {
+                int type = readByte();
+                int line = readByte();
+                int pos = readSigned();
+                char expected = (char) readByte();
+                char read = (char) readByte();
+                checkDigits[i] = new CheckDigit(type, line, pos, expected, read, readByte());
+            }
+        }
+        if ((presence & VALIDATION_RESULT_BIT) != 0) {
+            validationResult = readSigned();
+        }
+        if ((presence & FLAGS_BIT) != 0) {
+            int flags = readByte();
+            mrzOnRearSide = (flags & 1) != 0;
+            expiredDocument = (flags & 2) != 0;
+        }
+        if ((presence & IMAGE_SOURCE_BIT) != 0) {
+            imageSource = readSigned();
+        }
+    }
+
+    private int readByte() {
+        if (position >= buffer.limit()) {
+            throw new IllegalArgumentException("truncated codeline");
+        }
+        return buffer.get(position++) & 0xFF;
+    }
+
+    private int readVarint() {
+        int value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            int b = readByte();
+            value |= (b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw new IllegalArgumentException("malformed varint");
+    }
+
+    private int readSigned() {
+        int value = readVarint();
+        return (value >>> 1) ^ -(value & 1);
+    }
+
+    private void readDate(int[] date) {
+        date[0] = readSigned();
+        date[1] = readSigned();
+        date[2] = readSigned();
+    }
+
+    /** The bytes of string member {@code field}, without copying; empty when not present. */
+    public ByteBuffer slice(int field) {
+        ByteBuffer view = buffer.duplicate();
+        view.limit(offsets[field] + lengths[field]).position(offsets[field]);
+        return view.slice();
+    }
+
+    public String getString(int field) {
+        if (lengths[field] == 0) {
+            return "";
+        }
+        byte[] bytes = new byte[lengths[field]];
+        ByteBuffer view = buffer.duplicate();
+        view.position(offsets[field]);
+        view.get(bytes);
+        return new String(bytes, StandardCharsets.US_ASCII);
+    }
+
+    /** The full codeline, rebuilt from the lines when the encoder left it out. */
+    public String getData() {
+        if (!dataFromLines) {
+            return getString(DATA);
+        }
+        StringBuilder data = new StringBuilder(getString(LINE1));
+        if (lineCount >= 2) {
+            data.append('\r').append(getString(LINE2));
+        }
+        if (lineCount >= 3) {
+            data.append('\r').append(getString(LINE3));
+        }
+        return data.toString();
+    }
+
+    public String getLine1() { return getString(LINE1); }
+    public String getLine2() { return getString(LINE2); }
+    public String getLine3() { return getString(LINE3); }
+    public String getDocId() { return getString(DOC_ID); }
+    public String getDocType() { return getString(DOC_TYPE); }
+    public String getSurname() { return getString(SURNAME); }
+    public String getForename() { return getString(FORENAME); }
+    public String getSecondName() { return getString(SECOND_NAME); }
+    public String getForenames() { return getString(FORENAMES); }
+    public String getDateOfBirthMRZ() { return getString(DATE_OF_BIRTH_MRZ); }
+    public String getExpiryDateMRZ() { return getString(EXPIRY_DATE_MRZ); }
+    public String getIssuingState() { return getString(ISSUING_STATE); }
+    public String getNationality() { return getString(NATIONALITY); }
+    public String getDocNumber() { return getString(DOC_NUMBER); }
+    public String getSex() { return getString(SEX); }
+    public String getOptionalData1() { return getString(OPTIONAL_DATA1); }
+    public String getOptionalData2() { return getString(OPTIONAL_DATA2); }
+
+    public int getLineCount() { return lineCount; }
+    /** Day, month and year, all zero when the reader did not parse a date. */
+    public int[] getDateOfBirth() { return dateOfBirth.clone(); }
+    public int[] getExpiryDate() { return expiryDate.clone(); }
+    public char getShortSex() { return shortSex; }
+    public CheckDigit[] getCheckDigits() { return checkDigits.clone(); }
+    public int getCodelineValidationResult() { return validationResult; }
+    public boolean isMrzOnRearSide() { return mrzOnRearSide; }
+    public boolean isExpiredDocument() { return expiredDocument; }
+    public int getImageSource() { return imageSource; }
+}